@@ -0,0 +1,169 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CASM_DBG_BUF_SIZE 65536
+static char casm_dbg_buf[CASM_DBG_BUF_SIZE];
+static size_t casm_dbg_len = 0;
+
+static inline void casm_dbg_flush(void) {
+    fwrite(casm_dbg_buf, 1, casm_dbg_len, stdout);
+    casm_dbg_len = 0;
+    fflush(stdout);
+}
+
+static inline void casm_dbg_reserve(size_t n) {
+    if (casm_dbg_len + n > CASM_DBG_BUF_SIZE) casm_dbg_flush();
+}
+
+static inline void casm_dbg_str(const char* s, size_t n) {
+    memcpy(casm_dbg_buf + casm_dbg_len, s, n);
+    casm_dbg_len += n;
+}
+
+static inline void casm_dbg_text(const char* s, size_t n) {
+    casm_dbg_reserve(n);
+    if (n > CASM_DBG_BUF_SIZE) {
+        fwrite(s, 1, n, stdout);
+        fflush(stdout);
+        return;
+    }
+    casm_dbg_str(s, n);
+}
+
+static inline void casm_dbg_u32(uint32_t v) {
+    char tmp[10];
+    int i = 10;
+    do { tmp[--i] = (char)('0' + v % 10); v /= 10; } while (v);
+    casm_dbg_str(tmp + i, (size_t)(10 - i));
+}
+
+static inline void casm_dbg_u64(uint64_t v) {
+    char tmp[20];
+    int i = 20;
+    if (v <= UINT32_MAX) { casm_dbg_u32((uint32_t)v); return; }
+    do { tmp[--i] = (char)('0' + v % 10); v /= 10; } while (v);
+    casm_dbg_str(tmp + i, (size_t)(20 - i));
+}
+
+static inline void casm_dbg_i32(int32_t v) {
+    if (v < 0) { casm_dbg_buf[casm_dbg_len++] = '-'; casm_dbg_u32(0u - (uint32_t)v); }
+    else casm_dbg_u32((uint32_t)v);
+}
+
+static inline void casm_dbg_i64(int64_t v) {
+    if (v < 0) { casm_dbg_buf[casm_dbg_len++] = '-'; casm_dbg_u64(0u - (uint64_t)v); }
+    else casm_dbg_u64((uint64_t)v);
+}
+
+static inline void casm_dbg_bool(_Bool v) {
+    if (v) casm_dbg_str("true", 4);
+    else casm_dbg_str("false", 5);
+}
+
+int32_t main(void);
+
+int32_t main(void) {
+    int32_t __v0;
+    int32_t __v1;
+    int64_t __v2;
+    int32_t __v3;
+    int32_t __v4;
+    int32_t __phi4;
+    int64_t __v5;
+    int64_t __phi5;
+    _Bool __v6;
+    int32_t __v7;
+    int32_t __v8;
+    int32_t __phi8;
+    int64_t __v9;
+    int64_t __phi9;
+    _Bool __v10;
+    int32_t __v11;
+    int64_t __v12;
+    int64_t __v13;
+    int32_t __v14;
+    int32_t __v15;
+    int32_t __v16;
+    int32_t __v17;
+    int32_t __phi17;
+    int64_t __v18;
+    int64_t __phi18;
+    int32_t __v19;
+    _Bool __v20;
+    int32_t __v21;
+    int64_t __v22;
+    int64_t __v23;
+    int32_t __v24;
+    int32_t __v25;
+    int32_t __v26;
+    int32_t __v27;
+    int32_t __v29;
+    atexit(casm_dbg_flush);
+    __v0 = 20000;
+    __v1 = 1001;
+    __v2 = 0;
+    __v3 = 0;
+    __phi4 = __v3;
+    __phi5 = __v2;
+b1:;
+    __v4 = __phi4;
+    __v5 = __phi5;
+    __v6 = __v4 < __v0;
+    if (!__v6) {
+        goto b9;
+    }
+    __v7 = 0;
+    __phi8 = __v7;
+    __phi9 = __v5;
+b3:;
+    __v8 = __phi8;
+    __v9 = __phi9;
+    __v10 = __v8 < __v1;
+    if (!__v10) {
+        goto b5;
+    }
+    __v11 = (int32_t)((uint32_t)__v8 * (uint32_t)__v4);
+    __v12 = (int64_t)__v11;
+    __v13 = (int64_t)((uint64_t)__v9 + (uint64_t)__v12);
+    __v14 = 1;
+    __v15 = (int32_t)((uint32_t)__v8 + (uint32_t)__v14);
+    __phi8 = __v15;
+    __phi9 = __v13;
+    goto b3;
+b5:;
+    __v16 = 0;
+    __phi17 = __v16;
+    __phi18 = __v9;
+b6:;
+    __v17 = __phi17;
+    __v18 = __phi18;
+    __v19 = 8;
+    __v20 = __v17 < __v19;
+    if (!__v20) {
+        goto b8;
+    }
+    __v21 = (int32_t)((uint32_t)__v17 * (uint32_t)__v4);
+    __v22 = (int64_t)__v21;
+    __v23 = (int64_t)((uint64_t)__v18 + (uint64_t)__v22);
+    __v24 = 1;
+    __v25 = (int32_t)((uint32_t)__v17 + (uint32_t)__v24);
+    __phi17 = __v25;
+    __phi18 = __v23;
+    goto b6;
+b8:;
+    __v26 = 1;
+    __v27 = (int32_t)((uint32_t)__v4 + (uint32_t)__v26);
+    __phi4 = __v27;
+    __phi5 = __v18;
+    goto b1;
+b9:;
+    casm_dbg_reserve(63);
+    casm_dbg_str("examples/loop_benchmark.csm:16:4: total = ", 42);
+    casm_dbg_i64(__v5);
+    casm_dbg_str("\n", 1);
+    __v29 = 0;
+    return __v29;
+}
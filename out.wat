@@ -0,0 +1,311 @@
+(module
+  (import "host" "debug_begin" (func $debug_begin (param i32 i32)))
+  (import "host" "debug_value_i32" (func $debug_value_i32 (param i32)))
+  (import "host" "debug_value_i64" (func $debug_value_i64 (param i64)))
+  (import "host" "debug_value_u32" (func $debug_value_u32 (param i32)))
+  (import "host" "debug_value_u64" (func $debug_value_u64 (param i64)))
+  (import "host" "debug_value_bool" (func $debug_value_bool (param i32)))
+  (import "host" "debug_end" (func $debug_end))
+  (func $momentum (param $p i32) (param $velocity i64) (result i64)
+    local.get $p
+    i64.load
+    local.get $velocity
+    i64.mul
+    local.get $p
+    i32.load16_s offset=12
+    i64.extend_i32_s
+    i64.add
+    return
+  )
+
+  (func $total_mass (param $a i32) (param $b i32) (result i64)
+    local.get $a
+    i64.load
+    local.get $b
+    i64.load
+    i64.add
+    local.get $a
+    call $momentum__spec1
+    i64.add
+    return
+  )
+
+  (func $body_end (param $h i32) (result i32)
+    local.get $h
+    i32.load offset=1
+    local.get $h
+    i32.load offset=5
+    i32.add
+    return
+  )
+
+  (func $main (result i32) (local $__fp i32) (local $__elem_i32 i32)
+    global.get $__sp
+    i32.const 64
+    i32.sub
+    local.tee $__fp
+    global.set $__sp
+    local.get $__fp
+    i32.const 0
+    i32.lt_s
+    if
+      unreachable
+    end
+    local.get $__fp
+    i64.const 0
+    i64.store
+    local.get $__fp
+    i64.const 0
+    i64.store offset=8
+    local.get $__fp
+    i32.const 1
+    i32.store8 offset=14
+    local.get $__fp
+    i64.const 40
+    i64.store
+    local.get $__fp
+    i32.const -3
+    i32.store16 offset=12
+    local.get $__fp
+    i32.const 7
+    i32.store offset=8
+    i32.const 1048576
+    i32.const 91
+    call $debug_begin
+    local.get $__fp
+    i32.load8_u offset=14
+    call $debug_value_u32
+    local.get $__fp
+    i64.load
+    call $debug_value_i64
+    local.get $__fp
+    i32.load16_s offset=12
+    call $debug_value_i32
+    local.get $__fp
+    i32.load offset=8
+    call $debug_value_i32
+    call $debug_end
+    i32.const 1048667
+    i32.const 59
+    call $debug_begin
+    local.get $__fp
+    i32.const 0
+    i32.add
+    call $momentum__spec2
+    call $debug_value_i64
+    call $debug_end
+    local.get $__fp
+    i64.const 0
+    i64.store offset=16
+    local.get $__fp
+    i64.const 0
+    i64.store offset=24
+    local.get $__fp
+    local.get $__fp
+    i64.load
+    i64.const 2
+    i64.add
+    i64.store offset=16
+    i32.const 1048726
+    i32.const 85
+    call $debug_begin
+    local.get $__fp
+    i32.load8_u offset=30
+    call $debug_value_u32
+    local.get $__fp
+    i64.load offset=16
+    call $debug_value_i64
+    local.get $__fp
+    i32.const 0
+    i32.add
+    local.get $__fp
+    i32.const 16
+    i32.add
+    call $total_mass
+    call $debug_value_i64
+    call $debug_end
+    local.get $__fp
+    local.get $__fp
+    i32.load16_s offset=12
+    i32.const 20000
+    i32.mul
+    i32.const 16
+    i32.shl
+    i32.const 16
+    i32.shr_s
+    i32.store16 offset=28
+    i32.const 1048811
+    i32.const 70
+    call $debug_begin
+    local.get $__fp
+    i32.load16_s offset=28
+    call $debug_value_i32
+    local.get $__fp
+    local.get $__fp
+    i32.load offset=8
+    local.tee $__elem_i32
+    i32.store offset=24
+    local.get $__elem_i32
+    call $debug_value_i32
+    call $debug_end
+    local.get $__fp
+    i64.const 0
+    i64.store offset=32
+    local.get $__fp
+    i64.const 0
+    i64.store offset=40
+    local.get $__fp
+    i32.const 9
+    i32.store8 offset=32
+    local.get $__fp
+    i32.const 100
+    i32.store offset=33
+    local.get $__fp
+    local.get $__fp
+    i32.load offset=33
+    local.get $__fp
+    i32.load offset=33
+    i32.add
+    i32.store offset=37
+    i32.const 1048881
+    i32.const 83
+    call $debug_begin
+    local.get $__fp
+    i32.const 32
+    i32.add
+    call $body_end
+    call $debug_value_u32
+    local.get $__fp
+    i32.load8_u offset=32
+    call $debug_value_u32
+    local.get $__fp
+    i32.load offset=37
+    call $debug_value_u32
+    call $debug_end
+    local.get $__fp
+    i64.const 0
+    i64.store offset=48
+    local.get $__fp
+    i64.const 0
+    i64.store offset=56
+    local.get $__fp
+    local.get $__fp
+    i32.load offset=56
+    i32.store offset=56
+    local.get $__fp
+    local.get $__fp
+    i64.load offset=48
+    local.get $__fp
+    i32.const 0
+    i32.add
+    i64.const 0
+    call $momentum
+    i64.add
+    i64.store offset=48
+    local.get $__fp
+    local.get $__fp
+    i32.load offset=56
+    i32.const 1
+    i32.add
+    i32.store offset=56
+    local.get $__fp
+    local.get $__fp
+    i64.load offset=48
+    local.get $__fp
+    i32.const 0
+    i32.add
+    i64.const 1
+    call $momentum
+    i64.add
+    i64.store offset=48
+    local.get $__fp
+    local.get $__fp
+    i32.load offset=56
+    i32.const 2
+    i32.add
+    i32.store offset=56
+    local.get $__fp
+    local.get $__fp
+    i64.load offset=48
+    local.get $__fp
+    i32.const 0
+    i32.add
+    i64.const 2
+    call $momentum
+    i64.add
+    i64.store offset=48
+    local.get $__fp
+    local.get $__fp
+    i32.load offset=56
+    i32.const 3
+    i32.add
+    i32.store offset=56
+    local.get $__fp
+    local.get $__fp
+    i64.load offset=48
+    local.get $__fp
+    i32.const 0
+    i32.add
+    i64.const 3
+    call $momentum
+    i64.add
+    i64.store offset=48
+    local.get $__fp
+    local.get $__fp
+    i32.load offset=56
+    i32.const 4
+    i32.add
+    i32.store offset=56
+    local.get $__fp
+    local.get $__fp
+    i64.load offset=48
+    local.get $__fp
+    i32.const 0
+    i32.add
+    i64.const 4
+    call $momentum
+    i64.add
+    i64.store offset=48
+    i32.const 1048964
+    i32.const 69
+    call $debug_begin
+    local.get $__fp
+    i32.load offset=56
+    call $debug_value_i32
+    local.get $__fp
+    i64.load offset=48
+    call $debug_value_i64
+    call $debug_end
+    i32.const 0
+    local.get $__fp
+    i32.const 64
+    i32.add
+    global.set $__sp
+    return
+  )
+
+  (func $momentum__spec1 (param $p i32) (result i64)
+    i32.const 0
+    local.get $p
+    i32.load16_s offset=12
+    i32.add
+    return
+  )
+
+  (func $momentum__spec2 (param $p i32) (result i64)
+    local.get $p
+    i64.load
+    i64.const 1
+    i64.shl
+    local.get $p
+    i32.load16_s offset=12
+    i64.extend_i32_s
+    i64.add
+    return
+  )
+  (memory 17)
+  (global $__sp (mut i32) (i32.const 1048576))
+  (data (i32.const 1048576) "tests/dbg_cases/types/structs/test.csm:30:4: p.kind = %, p.mass = %, p.charge = %, p.id = %" "tests/dbg_cases/types/structs/test.csm:31:4: momentum() = %" "tests/dbg_cases/types/structs/test.csm:36:4: q.kind = %, q.mass = %, total_mass() = %" "tests/dbg_cases/types/structs/test.csm:40:4: q.charge = %, expr(=) = %" "tests/dbg_cases/types/structs/test.csm:44:4: body_end() = %, h.tag = %, h.flags = %" "tests/dbg_cases/types/structs/test.csm:52:4: acc.id = %, acc.mass = %")
+  (export "memory" (memory 0))
+  (export "main" (func $main))
+)
@@ -27,6 +27,31 @@ if [ ! -f "./bin/test_codegen" ]; then
     exit 1
 fi
 
+if [ ! -f "./bin/test_optimizer" ]; then
+    echo "✗ bin/test_optimizer binary not found. Run 'make build-debug' first."
+    exit 1
+fi
+
+if [ ! -f "./bin/test_ir" ]; then
+    echo "✗ bin/test_ir binary not found. Run 'make build-debug' first."
+    exit 1
+fi
+
+if [ ! -f "./bin/test_x86" ]; then
+    echo "✗ bin/test_x86 binary not found. Run 'make build-debug' first."
+    exit 1
+fi
+
+if [ ! -f "./bin/test_interpreter" ]; then
+    echo "✗ bin/test_interpreter binary not found. Run 'make build-debug' first."
+    exit 1
+fi
+
+if [ ! -f "./bin/test_wat_strength" ]; then
+    echo "✗ bin/test_wat_strength binary not found. Run 'make build-debug' first."
+    exit 1
+fi
+
 if [ ! -f "./bin/casm" ]; then
     echo "✗ bin/casm binary not found. Run 'make build-debug' first."
     exit 1
@@ -95,6 +120,111 @@ else
 fi
 rm -f "$codegen_output"
 
+# Run optimizer tests with timeout
+echo ""
+echo "Running optimizer tests (timeout: ${UNIT_TEST_TIMEOUT}s)..."
+optimizer_output=$(mktemp)
+if timeout ${UNIT_TEST_TIMEOUT} ./bin/test_optimizer >"$optimizer_output" 2>&1; then
+    echo "✓ Optimizer tests passed"
+    cat "$optimizer_output"
+else
+    EXIT_CODE=$?
+    if [ $EXIT_CODE -eq 124 ]; then
+        echo "✗ Optimizer tests timed out after ${UNIT_TEST_TIMEOUT}s"
+        exit 1
+    else
+        echo "✗ Optimizer tests failed"
+        echo "Error output:"
+        cat "$optimizer_output"
+        exit 1
+    fi
+fi
+rm -f "$optimizer_output"
+
+# Run IR tests with timeout
+echo ""
+echo "Running IR tests (timeout: ${UNIT_TEST_TIMEOUT}s)..."
+ir_output=$(mktemp)
+if timeout ${UNIT_TEST_TIMEOUT} ./bin/test_ir >"$ir_output" 2>&1; then
+    echo "✓ IR tests passed"
+    cat "$ir_output"
+else
+    EXIT_CODE=$?
+    if [ $EXIT_CODE -eq 124 ]; then
+        echo "✗ IR tests timed out after ${UNIT_TEST_TIMEOUT}s"
+        exit 1
+    else
+        echo "✗ IR tests failed"
+        echo "Error output:"
+        cat "$ir_output"
+        exit 1
+    fi
+fi
+rm -f "$ir_output"
+
+# Run x86-64 tests with timeout
+echo ""
+echo "Running x86-64 tests (timeout: ${UNIT_TEST_TIMEOUT}s)..."
+x86_output=$(mktemp)
+if timeout ${UNIT_TEST_TIMEOUT} ./bin/test_x86 >"$x86_output" 2>&1; then
+    echo "✓ x86-64 tests passed"
+    cat "$x86_output"
+else
+    EXIT_CODE=$?
+    if [ $EXIT_CODE -eq 124 ]; then
+        echo "✗ x86-64 tests timed out after ${UNIT_TEST_TIMEOUT}s"
+        exit 1
+    else
+        echo "✗ x86-64 tests failed"
+        echo "Error output:"
+        cat "$x86_output"
+        exit 1
+    fi
+fi
+rm -f "$x86_output"
+
+# Run interpreter tests with timeout
+echo ""
+echo "Running interpreter tests (timeout: ${UNIT_TEST_TIMEOUT}s)..."
+interpreter_output=$(mktemp)
+if timeout ${UNIT_TEST_TIMEOUT} ./bin/test_interpreter >"$interpreter_output" 2>&1; then
+    echo "✓ Interpreter tests passed"
+    cat "$interpreter_output"
+else
+    EXIT_CODE=$?
+    if [ $EXIT_CODE -eq 124 ]; then
+        echo "✗ Interpreter tests timed out after ${UNIT_TEST_TIMEOUT}s"
+        exit 1
+    else
+        echo "✗ Interpreter tests failed"
+        echo "Error output:"
+        cat "$interpreter_output"
+        exit 1
+    fi
+fi
+rm -f "$interpreter_output"
+
+# Run WAT strength reduction tests with timeout
+echo ""
+echo "Running WAT strength reduction tests (timeout: ${UNIT_TEST_TIMEOUT}s)..."
+strength_output=$(mktemp)
+if timeout ${UNIT_TEST_TIMEOUT} ./bin/test_wat_strength >"$strength_output" 2>&1; then
+    echo "✓ WAT strength reduction tests passed"
+    cat "$strength_output"
+else
+    EXIT_CODE=$?
+    if [ $EXIT_CODE -eq 124 ]; then
+        echo "✗ WAT strength reduction tests timed out after ${UNIT_TEST_TIMEOUT}s"
+        exit 1
+    else
+        echo "✗ WAT strength reduction tests failed"
+        echo "Error output:"
+        cat "$strength_output"
+        exit 1
+    fi
+fi
+rm -f "$strength_output"
+
 # Test supported examples (those without unsupported control flow)
 echo ""
 echo "Running example tests (timeout: ${EXAMPLE_TEST_TIMEOUT}s per file)..."
@@ -110,6 +240,7 @@ SUPPORTED_EXAMPLES=(
     "examples/if_statement.csm"
     "examples/while_loop.csm"
     "examples/for_loop.csm"
+    "examples/loop_benchmark.csm"
 )
 
 for example in "${SUPPORTED_EXAMPLES[@]}"; do
@@ -140,7 +271,7 @@ echo ""
 echo "Running dbg tests (timeout: 2s per test)..."
 echo "Cleaning coverage data before DBG tests..."
 find ./bin -name "*.gcda" -delete 2>/dev/null || true
-if timeout 30 tests/run_dbg_tests.sh; then
+if timeout 240 tests/run_dbg_tests.sh; then
     DBG_TEST_RESULT="PASSED"
     echo "✓ DBG tests passed"
 else
@@ -2,10 +2,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-/* Forward declaration */
-static void ast_statement_free_contents(ASTStatement* stmt);
-static void ast_expression_free_contents(ASTExpression* expr);
-
 const char* type_to_string(CasmType type) {
     switch (type) {
         case TYPE_I8: return "i8";
@@ -18,6 +14,7 @@ const char* type_to_string(CasmType type) {
         case TYPE_U64: return "u64";
         case TYPE_BOOL: return "bool";
         case TYPE_VOID: return "void";
+        case TYPE_STRUCT: return "struct";
     }
     return "unknown";
 }
@@ -44,6 +41,10 @@ ASTProgram* ast_program_create(void) {
     program->import_count = 0;
     program->functions = NULL;
     program->function_count = 0;
+    program->globals = NULL;
+    program->global_count = 0;
+    program->structs = NULL;
+    program->struct_count = 0;
     program->source_cache = NULL;  /* Will be set for merged programs */
     return program;
 }
@@ -58,6 +59,14 @@ void ast_program_free(ASTProgram* program) {
         ast_function_free(&program->functions[i]);
     }
     xfree(program->functions);
+    for (int i = 0; i < program->global_count; i++) {
+        ast_global_free_contents(&program->globals[i]);
+    }
+    xfree(program->globals);
+    for (int i = 0; i < program->struct_count; i++) {
+        ast_struct_free_contents(&program->structs[i]);
+    }
+    xfree(program->structs);
     xfree(program);
 }
 
@@ -155,7 +164,7 @@ void ast_statement_free(ASTStatement* stmt) {
 }
 
 /* Free statement contents only (for embedded statements in arrays) */
-static void ast_statement_free_contents(ASTStatement* stmt) {
+void ast_statement_free_contents(ASTStatement* stmt) {
     if (!stmt) return;
     
     switch (stmt->type) {
@@ -170,10 +179,7 @@ static void ast_statement_free_contents(ASTStatement* stmt) {
             }
             break;
         case STMT_VAR_DECL:
-            if (stmt->as.var_decl_stmt.var_decl.initializer) {
-                ast_expression_free(stmt->as.var_decl_stmt.var_decl.initializer);
-            }
-            xfree(stmt->as.var_decl_stmt.var_decl.name);
+            ast_var_decl_free_contents(&stmt->as.var_decl_stmt.var_decl);
             break;
         case STMT_IF:
             ast_expression_free(stmt->as.if_stmt.condition);
@@ -213,11 +219,15 @@ static void ast_statement_free_contents(ASTStatement* stmt) {
             xfree(dbg->arg_names);
             break;
         }
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
     }
 }
 
 ASTExpression* ast_expression_create(ExpressionType type, SourceLocation location) {
     ASTExpression* expr = xmalloc(sizeof(ASTExpression));
+    memset(expr, 0, sizeof(ASTExpression));
     expr->type = type;
     expr->location = location;
     return expr;
@@ -230,7 +240,7 @@ void ast_expression_free(ASTExpression* expr) {
 }
 
 /* Free expression contents only (for embedded expressions in arrays) */
-static void ast_expression_free_contents(ASTExpression* expr) {
+void ast_expression_free_contents(ASTExpression* expr) {
     if (!expr) return;
     
     switch (expr->type) {
@@ -252,16 +262,198 @@ static void ast_expression_free_contents(ASTExpression* expr) {
         case EXPR_VARIABLE:
             xfree(expr->as.variable.name);
             break;
+        case EXPR_INDEX:
+            xfree(expr->as.index.array_name);
+            ast_expression_free(expr->as.index.index);
+            break;
+        case EXPR_FIELD:
+            xfree(expr->as.field.object_name);
+            xfree(expr->as.field.field_name);
+            break;
         case EXPR_LITERAL:
             /* Literals have no sub-allocations */
             break;
     }
 }
 
+void ast_expression_clone_into(ASTExpression* dst, const ASTExpression* src) {
+    *dst = *src;
+    switch (src->type) {
+        case EXPR_BINARY_OP:
+            dst->as.binary_op.left = ast_expression_clone(src->as.binary_op.left);
+            dst->as.binary_op.right = ast_expression_clone(src->as.binary_op.right);
+            break;
+        case EXPR_UNARY_OP:
+            dst->as.unary_op.operand = ast_expression_clone(src->as.unary_op.operand);
+            break;
+        case EXPR_FUNCTION_CALL: {
+            const ASTFunctionCall* call = &src->as.function_call;
+            dst->as.function_call.function_name = xstrdup(call->function_name);
+            dst->as.function_call.arguments = NULL;
+            if (call->argument_count > 0) {
+                dst->as.function_call.arguments = xmalloc(call->argument_count * sizeof(ASTExpression));
+                for (int i = 0; i < call->argument_count; i++) {
+                    ast_expression_clone_into(&dst->as.function_call.arguments[i], &call->arguments[i]);
+                }
+            }
+            break;
+        }
+        case EXPR_VARIABLE:
+            dst->as.variable.name = xstrdup(src->as.variable.name);
+            break;
+        case EXPR_INDEX:
+            dst->as.index.array_name = xstrdup(src->as.index.array_name);
+            dst->as.index.index = ast_expression_clone(src->as.index.index);
+            break;
+        case EXPR_FIELD:
+            dst->as.field.object_name = xstrdup(src->as.field.object_name);
+            dst->as.field.field_name = xstrdup(src->as.field.field_name);
+            break;
+        case EXPR_LITERAL:
+            break;
+    }
+}
+
+ASTExpression* ast_expression_clone(const ASTExpression* src) {
+    if (!src) return NULL;
+    ASTExpression* expr = xmalloc(sizeof(ASTExpression));
+    ast_expression_clone_into(expr, src);
+    return expr;
+}
+
+ASTBlock ast_block_clone(const ASTBlock* src) {
+    ASTBlock block = *src;
+    block.statements = NULL;
+    if (src->statement_count > 0) {
+        block.statements = xmalloc(src->statement_count * sizeof(ASTStatement));
+        for (int i = 0; i < src->statement_count; i++) {
+            ast_statement_clone_into(&block.statements[i], &src->statements[i]);
+        }
+    }
+    return block;
+}
+
+void ast_statement_clone_into(ASTStatement* dst, const ASTStatement* src) {
+    *dst = *src;
+    switch (src->type) {
+        case STMT_RETURN:
+            dst->as.return_stmt.value = ast_expression_clone(src->as.return_stmt.value);
+            break;
+        case STMT_EXPR:
+            dst->as.expr_stmt.expr = ast_expression_clone(src->as.expr_stmt.expr);
+            break;
+        case STMT_VAR_DECL:
+            ast_var_decl_clone_into(&dst->as.var_decl_stmt.var_decl, &src->as.var_decl_stmt.var_decl);
+            break;
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &src->as.if_stmt;
+            dst->as.if_stmt.condition = ast_expression_clone(if_stmt->condition);
+            dst->as.if_stmt.then_body = ast_block_clone(&if_stmt->then_body);
+            ASTElseIfClause** tail = &dst->as.if_stmt.else_if_chain;
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                *tail = xmalloc(sizeof(ASTElseIfClause));
+                (*tail)->condition = ast_expression_clone(clause->condition);
+                (*tail)->body = ast_block_clone(&clause->body);
+                tail = &(*tail)->next;
+            }
+            *tail = NULL;
+            if (if_stmt->else_body) {
+                dst->as.if_stmt.else_body = xmalloc(sizeof(ASTBlock));
+                *dst->as.if_stmt.else_body = ast_block_clone(if_stmt->else_body);
+            }
+            break;
+        }
+        case STMT_WHILE:
+            dst->as.while_stmt.condition = ast_expression_clone(src->as.while_stmt.condition);
+            dst->as.while_stmt.body = ast_block_clone(&src->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            if (src->as.for_stmt.init) {
+                dst->as.for_stmt.init = xmalloc(sizeof(ASTStatement));
+                ast_statement_clone_into(dst->as.for_stmt.init, src->as.for_stmt.init);
+            }
+            dst->as.for_stmt.condition = ast_expression_clone(src->as.for_stmt.condition);
+            dst->as.for_stmt.update = ast_expression_clone(src->as.for_stmt.update);
+            dst->as.for_stmt.body = ast_block_clone(&src->as.for_stmt.body);
+            break;
+        case STMT_BLOCK:
+            dst->as.block_stmt.block = ast_block_clone(&src->as.block_stmt.block);
+            break;
+        case STMT_DBG: {
+            const ASTDbgStmt* dbg = &src->as.dbg_stmt;
+            ASTDbgStmt* copy = &dst->as.dbg_stmt;
+            copy->arguments = xmalloc((dbg->argument_count + 1) * sizeof(ASTExpression));
+            copy->arg_names = xmalloc((dbg->argument_count + 1) * sizeof(char*));
+            for (int i = 0; i < dbg->argument_count; i++) {
+                ast_expression_clone_into(&copy->arguments[i], &dbg->arguments[i]);
+                copy->arg_names[i] = xstrdup(dbg->arg_names[i]);
+            }
+            break;
+        }
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+}
+
+void ast_var_decl_free_contents(ASTVarDecl* decl) {
+    if (!decl) return;
+    if (decl->initializer) {
+        ast_expression_free(decl->initializer);
+    }
+    xfree(decl->elements);
+    xfree(decl->struct_name);
+    xfree(decl->name);
+}
+
+void ast_var_decl_clone_into(ASTVarDecl* dst, const ASTVarDecl* src) {
+    *dst = *src;
+    dst->name = xstrdup(src->name);
+    dst->initializer = ast_expression_clone(src->initializer);
+    dst->struct_name = xstrdup(src->struct_name);
+    dst->elements = NULL;
+    if (src->element_count > 0) {
+        dst->elements = xmalloc(src->element_count * sizeof(long));
+        memcpy(dst->elements, src->elements, src->element_count * sizeof(long));
+    }
+}
+
+void ast_global_free_contents(ASTGlobalVar* global) {
+    if (!global) return;
+    ast_var_decl_free_contents(&global->decl);
+    xfree(global->module_path);
+    xfree(global->allocated_name);
+}
+
+void ast_struct_free_contents(ASTStructDef* def) {
+    if (!def) return;
+    for (int i = 0; i < def->field_count; i++) {
+        xfree(def->fields[i].name);
+    }
+    xfree(def->fields);
+    xfree(def->name);
+    xfree(def->module_path);
+    xfree(def->allocated_name);
+}
+
+void ast_struct_clone_into(ASTStructDef* dst, const ASTStructDef* src) {
+    *dst = *src;
+    dst->name = xstrdup(src->name);
+    dst->module_path = xstrdup(src->module_path);
+    dst->allocated_name = xstrdup(src->allocated_name);
+    dst->fields = xmalloc((src->field_count + 1) * sizeof(ASTStructField));
+    for (int i = 0; i < src->field_count; i++) {
+        dst->fields[i] = src->fields[i];
+        dst->fields[i].name = xstrdup(src->fields[i].name);
+    }
+}
+
 ASTParameter* ast_parameter_create(const char* name, TypeNode type, SourceLocation location) {
     ASTParameter* param = xmalloc(sizeof(ASTParameter));
     param->name = xstrdup(name);
     param->type = type;
+    param->struct_name = NULL;
+    param->struct_index = -1;
     param->location = location;
     return param;
 }
@@ -269,6 +461,7 @@ ASTParameter* ast_parameter_create(const char* name, TypeNode type, SourceLocati
 void ast_parameter_free(ASTParameter* param) {
     if (!param) return;
     xfree(param->name);
+    xfree(param->struct_name);
 }
 
 ASTElseIfClause* ast_else_if_create(ASTExpression* cond, ASTBlock body, SourceLocation location) {
@@ -288,3 +481,31 @@ void ast_else_if_free(ASTElseIfClause* clause) {
     xfree(clause);
 }
 
+/* Helper: Check if a statement leaves its loop through `kind` */
+static int statement_exits_loop(const ASTStatement* stmt, StatementType kind) {
+    switch (stmt->type) {
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            return stmt->type == kind;
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            if (ast_block_exits_loop(&if_stmt->then_body, kind)) return 1;
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                if (ast_block_exits_loop(&clause->body, kind)) return 1;
+            }
+            return if_stmt->else_body && ast_block_exits_loop(if_stmt->else_body, kind);
+        }
+        case STMT_BLOCK:
+            return ast_block_exits_loop(&stmt->as.block_stmt.block, kind);
+        default:
+            /* A nested loop's break/continue are its own */
+            return 0;
+    }
+}
+
+int ast_block_exits_loop(const ASTBlock* body, StatementType kind) {
+    for (int i = 0; i < body->statement_count; i++) {
+        if (statement_exits_loop(&body->statements[i], kind)) return 1;
+    }
+    return 0;
+}
@@ -11,6 +11,7 @@ typedef struct ASTProgram ASTProgram;
 typedef struct ASTImportStatement ASTImportStatement;
 typedef struct ASTFunctionDef ASTFunctionDef;
 typedef struct ASTVarDecl ASTVarDecl;
+typedef struct ASTGlobalVar ASTGlobalVar;
 typedef struct ASTParameter ASTParameter;
 typedef struct ASTBlock ASTBlock;
 typedef struct ASTStatement ASTStatement;
@@ -30,6 +31,9 @@ typedef struct ASTUnaryOp ASTUnaryOp;
 typedef struct ASTFunctionCall ASTFunctionCall;
 typedef struct ASTLiteral ASTLiteral;
 typedef struct ASTVariable ASTVariable;
+typedef struct ASTIndexExpr ASTIndexExpr;
+typedef struct ASTFieldExpr ASTFieldExpr;
+typedef struct ASTStructDef ASTStructDef;
 
 /* Type representation */
 typedef enum {
@@ -43,6 +47,7 @@ typedef enum {
     TYPE_U64,
     TYPE_BOOL,
     TYPE_VOID,
+    TYPE_STRUCT,     /* Named struct; see struct_name / struct_index */
 } CasmType;
 
 typedef struct {
@@ -53,18 +58,64 @@ typedef struct {
 const char* type_to_string(CasmType type);
 CasmType token_type_to_casm_type(TokenType tok_type);
 
-/* Parameter for function definitions */
+/* Parameter for function definitions. Struct parameters are passed by
+ * reference and are read-only inside the callee. */
 struct ASTParameter {
     char* name;
     TypeNode type;
+    char* struct_name;           /* Struct type name (NULL unless TYPE_STRUCT) */
+    int struct_index;            /* Index into ASTProgram.structs (set by semantic analysis) */
     SourceLocation location;
 };
 
-/* Variable declaration */
+/* Variable declaration. Arrays (`T name[N]`, optionally `= {c, ...}`)
+ * have no initializer expression; their elements start as the listed
+ * constants followed by zeros. Struct locals (`S name`, optionally
+ * `= {c, ...}` in field declaration order) work the same way. */
 struct ASTVarDecl {
     char* name;
-    TypeNode type;
+    TypeNode type;               /* Element type for arrays */
     ASTExpression* initializer;  /* NULL if no initializer */
+    int array_length;            /* Element count, 0 for scalars */
+    long* elements;              /* Array/struct initializer constants (NULL if none) */
+    int element_count;
+    char* struct_name;           /* Struct type name (NULL unless TYPE_STRUCT) */
+    int struct_index;            /* Index into ASTProgram.structs (set by semantic analysis) */
+    SourceLocation location;
+};
+
+/* Largest element count of an array (module-level / local) */
+#define MAX_ARRAY_LENGTH (1 << 20)
+#define MAX_LOCAL_ARRAY_LENGTH (1 << 16)
+
+/* Module-level variable: an array, or a scalar (decl.array_length == 0)
+ * whose constant initializer semantic analysis stores as decl.elements[0] */
+struct ASTGlobalVar {
+    ASTVarDecl decl;
+    char* module_path;           /* Source file path (NULL for single-file programs) */
+    char* allocated_name;        /* Final name in generated code (set by name allocation) */
+    int folded;                  /* Read-only scalar whose uses were all replaced by its value */
+};
+
+/* Struct field. Offsets are assigned by the layout engine (layout.h). */
+typedef struct {
+    char* name;
+    TypeNode type;
+    int offset;                  /* Byte offset within the struct */
+    SourceLocation location;
+} ASTStructField;
+
+/* Struct type: `struct Name { T field; ... }` or `packed struct Name { ... }`.
+ * Like module-level arrays, struct types are private to their module. */
+struct ASTStructDef {
+    char* name;
+    ASTStructField* fields;      /* Declaration order */
+    int field_count;
+    int packed;                  /* No padding, fields kept in declaration order */
+    int size;                    /* Set by layout */
+    int align;
+    char* module_path;           /* Source file path (NULL for single-file programs) */
+    char* allocated_name;        /* Final tag in generated C (set by name allocation) */
     SourceLocation location;
 };
 
@@ -78,6 +129,8 @@ typedef enum {
     STMT_FOR,
     STMT_BLOCK,
     STMT_DBG,
+    STMT_BREAK,        /* Leave the innermost loop; no payload */
+    STMT_CONTINUE,     /* Start the innermost loop's next iteration (after a for update); no payload */
 } StatementType;
 
 struct ASTReturnStmt {
@@ -169,6 +222,8 @@ typedef enum {
     EXPR_FUNCTION_CALL,
     EXPR_LITERAL,
     EXPR_VARIABLE,
+    EXPR_INDEX,
+    EXPR_FIELD,
 } ExpressionType;
 
 typedef enum {
@@ -177,6 +232,13 @@ typedef enum {
     BINOP_MUL,       /* * */
     BINOP_DIV,       /* / */
     BINOP_MOD,       /* % */
+    BINOP_BIT_AND,   /* & */
+    BINOP_BIT_OR,    /* | */
+    BINOP_BIT_XOR,   /* ^ */
+    BINOP_SHL,       /* << */
+    BINOP_SHR,       /* >> (arithmetic for signed types, logical for unsigned) */
+    BINOP_ROTL,      /* rotl(x, n) */
+    BINOP_ROTR,      /* rotr(x, n) */
     BINOP_EQ,        /* == */
     BINOP_NE,        /* != */
     BINOP_LT,        /* < */
@@ -191,6 +253,11 @@ typedef enum {
 typedef enum {
     UNOP_NEG,        /* - (negation) */
     UNOP_NOT,        /* ! (logical not) */
+    UNOP_BIT_NOT,    /* ~ */
+    UNOP_POPCOUNT,   /* popcount(x) */
+    UNOP_CLZ,        /* clz(x): leading zeros within the operand's width */
+    UNOP_CTZ,        /* ctz(x): trailing zeros, the width for 0 */
+    UNOP_CAST,       /* x as T: wrap or extend to target_type */
 } UnaryOpType;
 
 typedef enum {
@@ -208,6 +275,7 @@ struct ASTBinaryOp {
 struct ASTUnaryOp {
     ASTExpression* operand;
     UnaryOpType op;
+    CasmType target_type;   /* UNOP_CAST only */
     SourceLocation location;
 };
 
@@ -227,8 +295,35 @@ struct ASTLiteral {
     SourceLocation location;
 };
 
+/* A struct variable (resolved_type TYPE_STRUCT) only appears as a call
+ * argument; it then carries its struct type and whether the name already
+ * holds an address (a struct parameter being passed on). */
 struct ASTVariable {
     char* name;
+    int struct_index;       /* Set by semantic analysis for struct variables */
+    int by_reference;
+    SourceLocation location;
+};
+
+/* Array element: name[index]. Also the left side of element assignment,
+ * and the form semantic analysis gives every use of a scalar global. */
+struct ASTIndexExpr {
+    char* array_name;
+    ASTExpression* index;
+    int global_index;       /* Index into ASTProgram.globals, -1 for a local array (set by semantic analysis) */
+    int array_length;       /* Length of the indexed array (set by semantic analysis) */
+    int bounds_checked;     /* Cleared once the index is proven to be in range */
+    int scalar;             /* A scalar global `g`, read or written as element 0 of a one-element array */
+    SourceLocation location;
+};
+
+/* Struct field: object.field. Also the left side of field assignment. */
+struct ASTFieldExpr {
+    char* object_name;
+    char* field_name;
+    int struct_index;       /* Index into ASTProgram.structs (set by semantic analysis) */
+    int field_index;        /* Index into the struct's fields (set by semantic analysis) */
+    int by_reference;       /* Object is a struct parameter, i.e. an address */
     SourceLocation location;
 };
 
@@ -241,6 +336,8 @@ struct ASTExpression {
         ASTFunctionCall function_call;
         ASTLiteral literal;
         ASTVariable variable;
+        ASTIndexExpr index;
+        ASTFieldExpr field;
     } as;
     CasmType resolved_type;  /* filled by semantic analyzer */
 };
@@ -274,6 +371,10 @@ struct ASTProgram {
     int import_count;
     ASTFunctionDef* functions;
     int function_count;
+    ASTGlobalVar* globals;
+    int global_count;
+    ASTStructDef* structs;
+    int struct_count;
     struct ModuleCache* source_cache;  /* For merged programs: keeps source module cache alive */
 };
 
@@ -294,15 +395,34 @@ void ast_block_add_statement(ASTBlock* block, ASTStatement stmt);
 
 ASTStatement* ast_statement_create(StatementType type, SourceLocation location);
 void ast_statement_free(ASTStatement* stmt);
+void ast_statement_free_contents(ASTStatement* stmt);  /* For statements embedded in arrays */
 
 ASTExpression* ast_expression_create(ExpressionType type, SourceLocation location);
 void ast_expression_free(ASTExpression* expr);
+void ast_expression_free_contents(ASTExpression* expr);  /* For expressions embedded in arrays */
+
+void ast_var_decl_free_contents(ASTVarDecl* decl);
+void ast_var_decl_clone_into(ASTVarDecl* dst, const ASTVarDecl* src);
+void ast_global_free_contents(ASTGlobalVar* global);
+void ast_struct_free_contents(ASTStructDef* def);
+void ast_struct_clone_into(ASTStructDef* dst, const ASTStructDef* src);
 
 ASTParameter* ast_parameter_create(const char* name, TypeNode type, SourceLocation location);
 void ast_parameter_free(ASTParameter* param);
 
+/* Deep copies (used by passes that duplicate code, e.g. inlining) */
+void ast_expression_clone_into(ASTExpression* dst, const ASTExpression* src);
+ASTExpression* ast_expression_clone(const ASTExpression* src);
+void ast_statement_clone_into(ASTStatement* dst, const ASTStatement* src);
+ASTBlock ast_block_clone(const ASTBlock* src);
+
 /* Helper functions for control flow statements */
 ASTElseIfClause* ast_else_if_create(ASTExpression* cond, ASTBlock body, SourceLocation location);
 void ast_else_if_free(ASTElseIfClause* clause);
 
+/* Check if a loop body contains a statement of `kind` (STMT_BREAK or
+ * STMT_CONTINUE) that applies to that loop, i.e. one not inside a nested
+ * loop. Passes that restructure loops use this to leave such loops alone. */
+int ast_block_exits_loop(const ASTBlock* body, StatementType kind);
+
 #endif /* AST_H */
@@ -0,0 +1,593 @@
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include "bytecode.h"
+#include "types.h"
+#include "utils.h"
+
+/* Compilation of SSA IR functions to register bytecode. Every IR value
+ * gets its own register (its value id); constants are loaded once at
+ * function entry since SSA values never change. Phi copies are placed on
+ * the incoming edges, going through scratch registers when they overlap. */
+
+/* State for the function being compiled */
+typedef struct {
+    const IrFunction* ir;
+    BcFunction* func;
+    BcProgram* program;
+    const IrModule* module;
+    const char* source_filename;
+    int* block_pc;              /* Code index of each block */
+    int* patches;               /* Code indices whose imm is a block id to resolve */
+    int patch_count;
+    int patch_capacity;
+    int* use_counts;
+    int scratch_base;           /* First scratch register for phi copies */
+    int* array_offsets;         /* First slot of each local array */
+    const int* global_offsets;  /* First slot of each global array */
+} BcCompiler;
+
+/* Helper: Append an instruction and return its index */
+static int emit(BcCompiler* c, BcOpcode op, int dst, int a, int b, long long imm) {
+    BcFunction* func = c->func;
+    if (func->code_count >= func->code_capacity) {
+        func->code_capacity = func->code_capacity == 0 ? 32 : func->code_capacity * 2;
+        func->code = xrealloc(func->code, func->code_capacity * sizeof(BcInstr));
+    }
+    BcInstr* instr = &func->code[func->code_count];
+    instr->handler = NULL;
+    instr->op = op;
+    instr->dst = dst;
+    instr->a = a;
+    instr->b = b;
+    instr->imm = imm;
+    return func->code_count++;
+}
+
+/* Helper: Point a jump at a block; its code index is filled in at the end */
+static void target_block(BcCompiler* c, int index, int block) {
+    c->func->code[index].imm = block;
+    if (c->patch_count >= c->patch_capacity) {
+        c->patch_capacity = c->patch_capacity == 0 ? 16 : c->patch_capacity * 2;
+        c->patches = xrealloc(c->patches, c->patch_capacity * sizeof(int));
+    }
+    c->patches[c->patch_count++] = index;
+}
+
+/* Helper: Emit a jump to a block */
+static void emit_jump(BcCompiler* c, int block) {
+    target_block(c, emit(c, BC_JMP, -1, -1, -1, 0), block);
+}
+
+/* Helper: Store a list of operand registers and return its start */
+static int add_call_args(BcFunction* func, const int* regs, int count) {
+    if (func->call_arg_count + count > func->call_arg_capacity) {
+        while (func->call_arg_count + count > func->call_arg_capacity) {
+            func->call_arg_capacity = func->call_arg_capacity == 0 ? 16 : func->call_arg_capacity * 2;
+        }
+        func->call_args = xrealloc(func->call_args, func->call_arg_capacity * sizeof(int));
+    }
+    int start = func->call_arg_count;
+    for (int i = 0; i < count; i++) {
+        func->call_args[func->call_arg_count++] = regs[i];
+    }
+    return start;
+}
+
+/* Helper: Check if a type is a signed integer */
+static int is_signed_type(CasmType type) {
+    return type == TYPE_I8 || type == TYPE_I16 || type == TYPE_I32 || type == TYPE_I64;
+}
+
+/* Helper: Pick the 64-bit, i32 or u32 variant of an arithmetic opcode */
+static BcOpcode sized_opcode(BcOpcode op64, CasmType type) {
+    if (type == TYPE_I32) return (BcOpcode)(op64 + 1);
+    if (type == TYPE_U32) return (BcOpcode)(op64 + 2);
+    return op64;
+}
+
+/* Helper: Opcode converting a canonical value to `type` (BC_MOV if none needed) */
+static BcOpcode conversion_opcode(CasmType type) {
+    switch (type) {
+        case TYPE_I8:   return BC_WRAP_I8;
+        case TYPE_I16:  return BC_WRAP_I16;
+        case TYPE_I32:  return BC_WRAP_I32;
+        case TYPE_U8:   return BC_WRAP_U8;
+        case TYPE_U16:  return BC_WRAP_U16;
+        case TYPE_U32:  return BC_WRAP_U32;
+        case TYPE_BOOL: return BC_TO_BOOL;
+        default:        return BC_MOV;
+    }
+}
+
+/* Helper: Map a comparison to an opcode from `base` (BC_EQ or BC_JEQ),
+ * swapping the operands for > and >=. Negating first gives the opposite
+ * test (!(a < b) is b <= a). */
+static BcOpcode comparison_opcode(IrOpcode op, int is_signed, int negate, BcOpcode base,
+                                  int* swap) {
+    if (negate) {
+        switch (op) {
+            case IR_EQ: op = IR_NE; break;
+            case IR_NE: op = IR_EQ; break;
+            case IR_LT: op = IR_GE; break;
+            case IR_GE: op = IR_LT; break;
+            case IR_GT: op = IR_LE; break;
+            case IR_LE: op = IR_GT; break;
+            default: break;
+        }
+    }
+    *swap = (op == IR_GT || op == IR_GE);
+    int offset = 0;
+    switch (op) {
+        case IR_EQ: offset = 0; break;
+        case IR_NE: offset = 1; break;
+        case IR_LT: case IR_GT: offset = is_signed ? 2 : 3; break;
+        case IR_LE: case IR_GE: offset = is_signed ? 4 : 5; break;
+        default: break;
+    }
+    return (BcOpcode)(base + offset);
+}
+
+/* Helper: Whether a comparison is only used by its block's branch, right
+ * after it, so the branch can test it directly */
+static int is_fused_compare(const BcCompiler* c, int value) {
+    const IrInstr* instr = &c->ir->values[value];
+    if (instr->op < IR_EQ || instr->op > IR_GE) return 0;
+    const IrBlock* block = &c->ir->blocks[instr->block];
+    return block->term.kind == IR_TERM_BRANCH && block->term.value == value &&
+           block->instrs[block->instr_count - 1] == value && c->use_counts[value] == 1;
+}
+
+/* Helper: Index of a function in the module by name, or -1 */
+static int function_index(const IrModule* module, const char* name) {
+    for (int i = 0; i < module->function_count; i++) {
+        if (strcmp(module->functions[i]->name, name) == 0) return i;
+    }
+    return -1;
+}
+
+/* Helper: Record a dbg statement's text and value kinds; returns its index */
+static int add_dbg_line(BcCompiler* c, const IrInstr* instr) {
+    BcProgram* program = c->program;
+    if (program->dbg_line_count >= program->dbg_line_capacity) {
+        program->dbg_line_capacity = program->dbg_line_capacity == 0 ? 8 : program->dbg_line_capacity * 2;
+        program->dbg_lines = xrealloc(program->dbg_lines, program->dbg_line_capacity * sizeof(BcDbgLine));
+    }
+    const ASTDbgStmt* dbg = instr->dbg;
+    int count = instr->arg_count;
+    BcDbgLine* line = &program->dbg_lines[program->dbg_line_count];
+    line->value_count = count;
+    line->text = xmalloc((count + 1) * sizeof(char*));
+    line->text_lengths = xmalloc((count + 1) * sizeof(size_t));
+    line->kinds = xmalloc((count + 1) * sizeof(BcDbgKind));
+
+    /* Same labels as the C backend */
+    char prefix[512];
+    snprintf(prefix, sizeof(prefix), "%s:%d:%d: ",
+             c->source_filename, dbg->location.line, dbg->location.column);
+    for (int i = 0; i < count; i++) {
+        const char* name = NULL;
+        char fallback[32];
+        if (dbg->arg_names[i] && strlen(dbg->arg_names[i]) > 0) {
+            name = dbg->arg_names[i];
+        } else {
+            snprintf(fallback, sizeof(fallback), "arg%d", i);
+            name = fallback;
+        }
+        size_t len = strlen(prefix) + strlen(name) + 3;
+        line->text[i] = xmalloc(len + 1);
+        snprintf(line->text[i], len + 1, "%s%s = ", prefix, name);
+        line->text_lengths[i] = len;
+        snprintf(prefix, sizeof(prefix), ", ");
+
+        CasmType type = c->ir->values[instr->args[i]].type;
+        line->kinds[i] = type == TYPE_BOOL ? BC_DBG_BOOL :
+                         is_signed_type(type) ? BC_DBG_SIGNED : BC_DBG_UNSIGNED;
+    }
+    size_t len = count == 0 ? strlen(prefix) : 0;
+    line->text[count] = xmalloc(len + 2);
+    memcpy(line->text[count], prefix, len);
+    line->text[count][len] = '\n';
+    line->text[count][len + 1] = '\0';
+    line->text_lengths[count] = len + 1;
+
+    return program->dbg_line_count++;
+}
+
+/* Helper: Emit the phi copies for the edge from `from` to `to`. `nth`
+ * picks the edge when both branch targets are the same block. */
+static void emit_edge_copies(BcCompiler* c, int from, int to, int nth) {
+    const IrBlock* target = &c->ir->blocks[to];
+    int pred = -1;
+    for (int i = 0; i < target->pred_count; i++) {
+        if (target->preds[i] == from && nth-- == 0) {
+            pred = i;
+            break;
+        }
+    }
+    if (pred < 0) return;
+
+    int count = 0;
+    int overlap = 0;
+    for (int i = 0; i < target->instr_count; i++) {
+        const IrInstr* phi = &c->ir->values[target->instrs[i]];
+        if (phi->op != IR_PHI) break;
+        count++;
+    }
+    for (int i = 0; i < count && !overlap; i++) {
+        for (int j = 0; j < count; j++) {
+            const IrInstr* phi = &c->ir->values[target->instrs[j]];
+            if (i != j && phi->args[pred] == target->instrs[i]) {
+                overlap = 1;
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        int dst = target->instrs[i];
+        int src = c->ir->values[dst].args[pred];
+        if (overlap) {
+            emit(c, BC_MOV, c->scratch_base + i, src, -1, 0);
+        } else if (src != dst) {
+            emit(c, BC_MOV, dst, src, -1, 0);
+        }
+    }
+    if (overlap) {
+        for (int i = 0; i < count; i++) {
+            emit(c, BC_MOV, target->instrs[i], c->scratch_base + i, -1, 0);
+        }
+    }
+}
+
+/* Helper: Whether an edge carries phi copies */
+static int edge_has_copies(const BcCompiler* c, int from, int to, int nth) {
+    const IrBlock* target = &c->ir->blocks[to];
+    int pred = -1;
+    for (int i = 0; i < target->pred_count; i++) {
+        if (target->preds[i] == from && nth-- == 0) {
+            pred = i;
+            break;
+        }
+    }
+    for (int i = 0; i < target->instr_count && pred >= 0; i++) {
+        const IrInstr* phi = &c->ir->values[target->instrs[i]];
+        if (phi->op != IR_PHI) break;
+        if (phi->args[pred] != target->instrs[i]) return 1;
+    }
+    return 0;
+}
+
+/* Helper: Copies for an edge, then a jump unless the target is next */
+static void emit_edge(BcCompiler* c, int from, int to, int nth) {
+    emit_edge_copies(c, from, to, nth);
+    if (to != from + 1) {
+        emit_jump(c, to);
+    }
+}
+
+/* Compile one instruction */
+static void compile_instruction(BcCompiler* c, int value) {
+    const IrInstr* instr = &c->ir->values[value];
+    int a = instr->arg_count > 0 ? instr->args[0] : -1;
+    int b = instr->arg_count > 1 ? instr->args[1] : -1;
+
+    switch (instr->op) {
+        case IR_CONST:      /* Loaded at function entry */
+        case IR_UNDEF:
+        case IR_PARAM:      /* Stored by the caller */
+        case IR_PHI:        /* Written by the incoming edges */
+            break;
+
+        case IR_CONV:
+            emit(c, conversion_opcode(instr->type), value, a, -1, 0);
+            break;
+
+        case IR_ADD:
+            emit(c, sized_opcode(BC_ADD, instr->type), value, a, b, 0);
+            break;
+        case IR_SUB:
+            emit(c, sized_opcode(BC_SUB, instr->type), value, a, b, 0);
+            break;
+        case IR_MUL:
+            emit(c, sized_opcode(BC_MUL, instr->type), value, a, b, 0);
+            break;
+        case IR_NEG:
+            emit(c, sized_opcode(BC_NEG, instr->type), value, a, -1, 0);
+            break;
+
+        case IR_AND:
+            emit(c, BC_AND, value, a, b, 0);
+            break;
+        case IR_OR:
+            emit(c, BC_OR, value, a, b, 0);
+            break;
+        case IR_XOR:
+            emit(c, BC_XOR, value, a, b, 0);
+            break;
+        case IR_SHL:
+            emit(c, sized_opcode(BC_SHL, instr->type), value, a, b, 0);
+            break;
+        case IR_SHR:
+            emit(c, is_signed_type(instr->type) ? BC_SHR_S : BC_SHR_U, value, a, b,
+                 get_type_size_bits(instr->type) == 64 ? 63 : 31);
+            break;
+        case IR_ROTL:
+        case IR_ROTR:
+            emit(c, instr->op == IR_ROTL ? BC_ROTL : BC_ROTR, value, a, b, instr->type);
+            break;
+        case IR_POPCOUNT:
+        case IR_CLZ:
+        case IR_CTZ: {
+            BcOpcode op = instr->op == IR_POPCOUNT ? BC_POPCOUNT : instr->op == IR_CLZ ? BC_CLZ : BC_CTZ;
+            emit(c, op, value, a, -1, instr->type);
+            break;
+        }
+
+        case IR_DIV:
+        case IR_MOD: {
+            int is_signed = is_signed_type(instr->type);
+            BcOpcode op = instr->op == IR_DIV ? (is_signed ? BC_DIV_S : BC_DIV_U)
+                                              : (is_signed ? BC_MOD_S : BC_MOD_U);
+            long long min = instr->type == TYPE_I64 ? LLONG_MIN : INT_MIN;
+            emit(c, op, value, a, b, min);
+            break;
+        }
+
+        case IR_NOT:
+            emit(c, BC_NOT, value, a, -1, 0);
+            break;
+
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_GT:
+        case IR_LE:
+        case IR_GE: {
+            if (is_fused_compare(c, value)) break;
+            int swap = 0;
+            int is_signed = is_signed_type(c->ir->values[a].type);
+            BcOpcode op = comparison_opcode(instr->op, is_signed, 0, BC_EQ, &swap);
+            emit(c, op, value, swap ? b : a, swap ? a : b, 0);
+            break;
+        }
+
+        case IR_CALL: {
+            int start = add_call_args(c->func, instr->args, instr->arg_count);
+            int callee = function_index(c->module, instr->callee);
+            emit(c, BC_CALL, instr->type == TYPE_VOID ? -1 : value, start, instr->arg_count, callee);
+            break;
+        }
+
+        case IR_DBG: {
+            int start = add_call_args(c->func, instr->args, instr->arg_count);
+            emit(c, BC_DBG, -1, start, instr->arg_count, add_dbg_line(c, instr));
+            break;
+        }
+
+        case IR_LOAD:
+        case IR_STORE: {
+            int global = IR_IS_GLOBAL_ARRAY(instr->imm);
+            int index = IR_ARRAY_INDEX(instr->imm);
+            long long offset = global ? c->global_offsets[index] : c->array_offsets[index];
+            if (instr->op == IR_LOAD) {
+                emit(c, global ? BC_LOAD_G : BC_LOAD, value, a, -1, offset);
+            } else {
+                emit(c, global ? BC_STORE_G : BC_STORE, -1, a, b, offset);
+            }
+            break;
+        }
+
+        case IR_BOUNDS_CHECK:
+            emit(c, BC_CHECK, -1, a, -1, ir_array_ref(c->module, c->ir, instr->imm)->length);
+            break;
+
+        case IR_ARRAY_INIT:
+            emit(c, BC_ARRAY_INIT, -1, -1, c->ir->arrays[instr->imm].length,
+                 c->array_offsets[instr->imm]);
+            break;
+    }
+}
+
+/* Helper: Lay out arrays as consecutive slots holding their initial
+ * contents. Fills offsets and returns the image (NULL if no slots). */
+static long long* layout_arrays(const IrArray* arrays, int count, int* offsets, int* out_slots) {
+    int slots = 0;
+    for (int i = 0; i < count; i++) {
+        offsets[i] = slots;
+        slots += arrays[i].length;
+    }
+    *out_slots = slots;
+    if (slots == 0) return NULL;
+
+    long long* image = xmalloc(slots * sizeof(long long));
+    memset(image, 0, slots * sizeof(long long));
+    for (int i = 0; i < count; i++) {
+        if (arrays[i].init_count > 0) {
+            memcpy(image + offsets[i], arrays[i].init, arrays[i].init_count * sizeof(long long));
+        }
+    }
+    return image;
+}
+
+/* Compile a block's terminator */
+static void compile_terminator(BcCompiler* c, int b) {
+    const IrTerminator* term = &c->ir->blocks[b].term;
+
+    switch (term->kind) {
+        case IR_TERM_JUMP:
+            emit_edge(c, b, term->targets[0], 0);
+            break;
+
+        case IR_TERM_BRANCH: {
+            int if_true = term->targets[0];
+            int if_false = term->targets[1];
+            int false_nth = if_true == if_false ? 1 : 0;
+            const IrInstr* cond = &c->ir->values[term->value];
+
+            /* Jump to the false side (or its copies) when the condition fails */
+            int jump = -1;
+            if (is_fused_compare(c, term->value)) {
+                int swap = 0;
+                int x = cond->args[0];
+                int y = cond->args[1];
+                BcOpcode op = comparison_opcode(cond->op, is_signed_type(c->ir->values[x].type),
+                                                1, BC_JEQ, &swap);
+                jump = emit(c, op, -1, swap ? y : x, swap ? x : y, 0);
+            } else {
+                jump = emit(c, BC_JZ, -1, term->value, -1, 0);
+            }
+
+            if (!edge_has_copies(c, b, if_false, false_nth)) {
+                target_block(c, jump, if_false);
+                emit_edge_copies(c, b, if_true, 0);
+                if (if_true != b + 1) emit_jump(c, if_true);
+            } else {
+                emit_edge_copies(c, b, if_true, 0);
+                emit_jump(c, if_true);
+                c->func->code[jump].imm = c->func->code_count;
+                emit_edge(c, b, if_false, false_nth);
+            }
+            break;
+        }
+
+        case IR_TERM_RETURN:
+            if (term->value >= 0) {
+                emit(c, BC_RET, -1, term->value, -1, 0);
+            } else {
+                emit(c, BC_RET_VOID, -1, -1, -1, 0);
+            }
+            break;
+
+        case IR_TERM_UNREACHABLE:
+        case IR_TERM_NONE:
+            emit(c, BC_TRAP, -1, -1, -1, 0);
+            break;
+    }
+}
+
+/* Compile one function */
+static BcFunction* compile_function(BcProgram* program, const IrModule* module,
+                                    const IrFunction* ir, const int* global_offsets,
+                                    const char* source_filename) {
+    BcFunction* func = xmalloc(sizeof(BcFunction));
+    memset(func, 0, sizeof(BcFunction));
+    func->name = xstrdup(ir->name);
+    func->param_count = ir->param_count;
+    func->param_registers = xmalloc((ir->param_count + 1) * sizeof(int));
+    for (int i = 0; i < ir->param_count; i++) {
+        func->param_registers[i] = -1;
+    }
+
+    BcCompiler c;
+    memset(&c, 0, sizeof(BcCompiler));
+    c.ir = ir;
+    c.func = func;
+    c.program = program;
+    c.module = module;
+    c.source_filename = source_filename;
+    c.block_pc = xmalloc((ir->block_count + 1) * sizeof(int));
+    c.use_counts = xmalloc((ir->value_count + 1) * sizeof(int));
+    memset(c.use_counts, 0, (ir->value_count + 1) * sizeof(int));
+    c.array_offsets = xmalloc((ir->array_count + 1) * sizeof(int));
+    c.global_offsets = global_offsets;
+    func->array_image = layout_arrays(ir->arrays, ir->array_count, c.array_offsets, &func->array_slots);
+
+    /* Registers: one per value, then scratch for the widest set of phis */
+    int max_phis = 0;
+    for (int b = 0; b < ir->block_count; b++) {
+        int phis = 0;
+        const IrBlock* block = &ir->blocks[b];
+        while (phis < block->instr_count && ir->values[block->instrs[phis]].op == IR_PHI) phis++;
+        if (phis > max_phis) max_phis = phis;
+        const IrTerminator* term = &block->term;
+        if (term->value >= 0 && (term->kind == IR_TERM_BRANCH || term->kind == IR_TERM_RETURN)) {
+            c.use_counts[term->value]++;
+        }
+    }
+    for (int v = 0; v < ir->value_count; v++) {
+        const IrInstr* instr = &ir->values[v];
+        for (int a = 0; a < instr->arg_count; a++) {
+            c.use_counts[instr->args[a]]++;
+        }
+        if (instr->op == IR_PARAM) {
+            func->param_registers[instr->imm] = v;
+        }
+    }
+    c.scratch_base = ir->value_count;
+    func->register_count = ir->value_count + max_phis;
+
+    /* Constants never change, so load them once */
+    for (int v = 0; v < ir->value_count; v++) {
+        const IrInstr* instr = &ir->values[v];
+        if (instr->op == IR_CONST || instr->op == IR_UNDEF) {
+            emit(&c, BC_LOADK, v, -1, -1, instr->op == IR_CONST ? instr->imm : 0);
+        }
+    }
+
+    for (int b = 0; b < ir->block_count; b++) {
+        const IrBlock* block = &ir->blocks[b];
+        c.block_pc[b] = func->code_count;
+        for (int i = 0; i < block->instr_count; i++) {
+            compile_instruction(&c, block->instrs[i]);
+        }
+        compile_terminator(&c, b);
+    }
+
+    for (int i = 0; i < c.patch_count; i++) {
+        BcInstr* instr = &func->code[c.patches[i]];
+        instr->imm = c.block_pc[instr->imm];
+    }
+
+    xfree(c.block_pc);
+    xfree(c.patches);
+    xfree(c.use_counts);
+    xfree(c.array_offsets);
+    return func;
+}
+
+BcProgram* bc_compile_module(const IrModule* module, const char* source_filename) {
+    BcProgram* program = xmalloc(sizeof(BcProgram));
+    memset(program, 0, sizeof(BcProgram));
+    program->main_index = -1;
+    program->function_count = module->function_count;
+    program->functions = xmalloc((module->function_count + 1) * sizeof(BcFunction*));
+    int* global_offsets = xmalloc((module->global_count + 1) * sizeof(int));
+    program->global_image = layout_arrays(module->globals, module->global_count, global_offsets,
+                                          &program->global_slots);
+    for (int i = 0; i < module->function_count; i++) {
+        program->functions[i] = compile_function(program, module, module->functions[i], global_offsets,
+                                                 source_filename ? source_filename : "unknown.csm");
+        if (strcmp(module->functions[i]->name, "main") == 0) {
+            program->main_index = i;
+        }
+    }
+    xfree(global_offsets);
+    return program;
+}
+
+void bc_program_free(BcProgram* program) {
+    if (!program) return;
+    for (int i = 0; i < program->function_count; i++) {
+        BcFunction* func = program->functions[i];
+        xfree(func->name);
+        xfree(func->param_registers);
+        xfree(func->code);
+        xfree(func->call_args);
+        xfree(func->array_image);
+        xfree(func);
+    }
+    xfree(program->functions);
+    xfree(program->global_image);
+    for (int i = 0; i < program->dbg_line_count; i++) {
+        BcDbgLine* line = &program->dbg_lines[i];
+        for (int j = 0; j <= line->value_count; j++) {
+            xfree(line->text[j]);
+        }
+        xfree(line->text);
+        xfree(line->text_lengths);
+        xfree(line->kinds);
+    }
+    xfree(program->dbg_lines);
+    xfree(program);
+}
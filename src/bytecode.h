@@ -0,0 +1,142 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stddef.h>
+#include "ir.h"
+
+/* Register-based bytecode for the built-in interpreter.
+ *
+ * Each function has a frame of 64-bit registers, one per IR value plus a
+ * few scratch registers for phi copies. Values are kept in canonical
+ * form: signed types sign-extended, unsigned types zero-extended, bools 0
+ * or 1, so one 64-bit comparison works for every type and 32-bit
+ * arithmetic only has to re-wrap its result. Operands are register
+ * numbers in `a` and `b`; `imm` carries constants, jump targets (code
+ * indices), callee indices, dbg line indices and array offsets.
+ *
+ * Array elements are 64-bit slots holding canonical values. Globals live
+ * in one program-wide memory; each frame gets its own block of slots for
+ * the function's local arrays. */
+typedef enum {
+    BC_LOADK,       /* dst = imm */
+    BC_MOV,         /* dst = a */
+    BC_ADD,         /* 64-bit, wrapping */
+    BC_ADD_I32,
+    BC_ADD_U32,
+    BC_SUB,
+    BC_SUB_I32,
+    BC_SUB_U32,
+    BC_MUL,
+    BC_MUL_I32,
+    BC_MUL_U32,
+    BC_DIV_S,       /* Traps on b == 0 and on a == imm (the type's minimum) with b == -1 */
+    BC_DIV_U,       /* Traps on b == 0 */
+    BC_MOD_S,
+    BC_MOD_U,
+    BC_AND,
+    BC_OR,
+    BC_XOR,
+    BC_SHL,         /* Count masked to 63, or 31 for the 32-bit forms */
+    BC_SHL_I32,
+    BC_SHL_U32,
+    BC_SHR_S,       /* dst = a >> (b & imm) */
+    BC_SHR_U,
+    BC_ROTL,        /* Rotates and bit counts: imm is the CasmType */
+    BC_ROTR,
+    BC_POPCOUNT,
+    BC_CLZ,
+    BC_CTZ,
+    BC_NEG,
+    BC_NEG_I32,
+    BC_NEG_U32,
+    BC_NOT,         /* bool */
+    BC_WRAP_I8,     /* dst = a converted to the type */
+    BC_WRAP_I16,
+    BC_WRAP_I32,
+    BC_WRAP_U8,
+    BC_WRAP_U16,
+    BC_WRAP_U32,
+    BC_TO_BOOL,
+    BC_EQ,          /* dst = (a op b); > and >= swap their operands */
+    BC_NE,
+    BC_LT_S,
+    BC_LT_U,
+    BC_LE_S,
+    BC_LE_U,
+    BC_JMP,         /* goto imm */
+    BC_JNZ,         /* if (a) goto imm */
+    BC_JZ,          /* if (!a) goto imm */
+    BC_JEQ,         /* if (a op b) goto imm */
+    BC_JNE,
+    BC_JLT_S,
+    BC_JLT_U,
+    BC_JLE_S,
+    BC_JLE_U,
+    BC_CALL,        /* dst (-1 to drop) = functions[imm](registers call_args[a .. a+b)) */
+    BC_RET,         /* return a */
+    BC_RET_VOID,
+    BC_DBG,         /* print dbg_lines[imm] with registers call_args[a .. a+b) */
+    BC_TRAP,        /* unreachable */
+    BC_LOAD,        /* dst = local slot imm + a */
+    BC_LOAD_G,      /* dst = global slot imm + a */
+    BC_STORE,       /* local slot imm + a = b */
+    BC_STORE_G,     /* global slot imm + a = b */
+    BC_CHECK,       /* Trap unless a < imm (unsigned) */
+    BC_ARRAY_INIT,  /* Reset local slots imm .. imm+b from the function's image */
+    BC_OP_COUNT
+} BcOpcode;
+
+typedef struct {
+    const void* handler;    /* Dispatch address, filled in by the interpreter */
+    BcOpcode op;
+    int dst;
+    int a;
+    int b;
+    long long imm;
+} BcInstr;
+
+typedef enum {
+    BC_DBG_SIGNED,
+    BC_DBG_UNSIGNED,
+    BC_DBG_BOOL
+} BcDbgKind;
+
+/* A dbg statement: text[0] value[0] text[1] ... value[n-1] text[n] */
+typedef struct {
+    char** text;
+    size_t* text_lengths;
+    BcDbgKind* kinds;
+    int value_count;
+} BcDbgLine;
+
+typedef struct {
+    char* name;
+    int param_count;
+    int* param_registers;   /* Register receiving each parameter, or -1 if unused */
+    int register_count;
+    BcInstr* code;
+    int code_count;
+    int code_capacity;
+    int* call_args;         /* Operand register lists of calls and dbg statements */
+    int call_arg_count;
+    int call_arg_capacity;
+    long long* array_image; /* Initial contents of the local array slots */
+    int array_slots;
+} BcFunction;
+
+typedef struct {
+    BcFunction** functions;
+    int function_count;
+    BcDbgLine* dbg_lines;
+    int dbg_line_count;
+    int dbg_line_capacity;
+    int main_index;         /* -1 if there is no main */
+    long long* global_image;/* Initial contents of the global array slots */
+    int global_slots;
+} BcProgram;
+
+/* Compile a verified IR module. source_filename is used in dbg text. */
+BcProgram* bc_compile_module(const IrModule* module, const char* source_filename);
+void bc_program_free(BcProgram* program);
+
+#endif /* BYTECODE_H */
@@ -29,19 +29,23 @@ static void collect_function_calls(ASTExpression* expr, char*** out_calls, int*
         ASTFunctionCall* call = &expr->as.function_call;
         
         /* Check if already in list */
+        int already_added = 0;
         for (int i = 0; i < *out_count; i++) {
             if (strcmp((*out_calls)[i], call->function_name) == 0) {
-                return;  /* Already added */
+                already_added = 1;
+                break;
             }
         }
 
         /* Add to list */
-        if (*out_count >= *out_capacity) {
-            *out_capacity = (*out_capacity == 0) ? 10 : *out_capacity * 2;
-            *out_calls = xrealloc(*out_calls, *out_capacity * sizeof(char*));
-        }
+        if (!already_added) {
+            if (*out_count >= *out_capacity) {
+                *out_capacity = (*out_capacity == 0) ? 10 : *out_capacity * 2;
+                *out_calls = xrealloc(*out_calls, *out_capacity * sizeof(char*));
+            }
 
-        (*out_calls)[(*out_count)++] = xstrdup(call->function_name);
+            (*out_calls)[(*out_count)++] = xstrdup(call->function_name);
+        }
     }
 
     /* Recursively check subexpressions */
@@ -53,6 +57,15 @@ static void collect_function_calls(ASTExpression* expr, char*** out_calls, int*
         case EXPR_UNARY_OP:
             collect_function_calls(expr->as.unary_op.operand, out_calls, out_count, out_capacity);
             break;
+        case EXPR_INDEX:
+            collect_function_calls(expr->as.index.index, out_calls, out_count, out_capacity);
+            break;
+        case EXPR_FUNCTION_CALL:
+            /* Arguments can themselves be calls, e.g. f(g(x)) */
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                collect_function_calls(&expr->as.function_call.arguments[i], out_calls, out_count, out_capacity);
+            }
+            break;
         default:
             break;
     }
@@ -133,6 +146,9 @@ static void collect_calls_from_statement(ASTStatement* stmt, char*** out_calls,
             }
             break;
         }
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
     }
 }
 
@@ -274,3 +290,100 @@ uint32_t* call_graph_get_reachable_functions(CallGraph* graph, int* out_count) {
     *out_count = visited_count;
     return visited;
 }
+
+/* Helper: Check if an expression reads or writes a module-level array */
+static int expression_uses_global(const ASTExpression* expr) {
+    if (!expr) return 0;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            return expression_uses_global(expr->as.binary_op.left) ||
+                   expression_uses_global(expr->as.binary_op.right);
+        case EXPR_UNARY_OP:
+            return expression_uses_global(expr->as.unary_op.operand);
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                if (expression_uses_global(&expr->as.function_call.arguments[i])) return 1;
+            }
+            return 0;
+        case EXPR_INDEX:
+            return expr->as.index.global_index >= 0 || expression_uses_global(expr->as.index.index);
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Check if a block contains a dbg statement or touches a
+ * module-level array at any depth */
+static int block_has_effects(const ASTBlock* block);
+
+static int statement_has_effects(const ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_DBG:
+            return 1;
+        case STMT_RETURN:
+            return expression_uses_global(stmt->as.return_stmt.value);
+        case STMT_EXPR:
+            return expression_uses_global(stmt->as.expr_stmt.expr);
+        case STMT_VAR_DECL:
+            return expression_uses_global(stmt->as.var_decl_stmt.var_decl.initializer);
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            if (expression_uses_global(if_stmt->condition) || block_has_effects(&if_stmt->then_body)) return 1;
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                if (expression_uses_global(clause->condition) || block_has_effects(&clause->body)) return 1;
+            }
+            return if_stmt->else_body && block_has_effects(if_stmt->else_body);
+        }
+        case STMT_WHILE:
+            return expression_uses_global(stmt->as.while_stmt.condition) ||
+                   block_has_effects(&stmt->as.while_stmt.body);
+        case STMT_FOR:
+            return (stmt->as.for_stmt.init && statement_has_effects(stmt->as.for_stmt.init)) ||
+                   expression_uses_global(stmt->as.for_stmt.condition) ||
+                   expression_uses_global(stmt->as.for_stmt.update) ||
+                   block_has_effects(&stmt->as.for_stmt.body);
+        case STMT_BLOCK:
+            return block_has_effects(&stmt->as.block_stmt.block);
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            return 0;
+    }
+    return 0;
+}
+
+static int block_has_effects(const ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        if (statement_has_effects(&block->statements[i])) return 1;
+    }
+    return 0;
+}
+
+int* call_graph_find_pure_functions(CallGraph* graph, ASTProgram* program) {
+    if (!graph || graph->node_count == 0) return NULL;
+
+    int* pure = xmalloc(graph->node_count * sizeof(int));
+    for (int i = 0; i < graph->node_count; i++) {
+        pure[i] = !block_has_effects(&program->functions[i].body);
+    }
+
+    /* Impurity flows from callees to callers */
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < graph->node_count; i++) {
+            if (!pure[i]) continue;
+            for (int j = 0; j < graph->nodes[i].callee_count && pure[i]; j++) {
+                uint32_t callee_id = graph->nodes[i].callees[j].callee_id;
+                for (int k = 0; k < graph->node_count; k++) {
+                    if (graph->nodes[k].symbol_id == callee_id && !pure[k]) {
+                        pure[i] = 0;
+                        changed = 1;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return pure;
+}
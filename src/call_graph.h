@@ -45,4 +45,11 @@ void call_graph_free(CallGraph* graph);
  * Caller must free the returned array */
 uint32_t* call_graph_get_reachable_functions(CallGraph* graph, int* out_count);
 
+/* Find functions without observable effects: no dbg() and no access to a
+ * module-level array in their body or in anything they call, directly or
+ * indirectly, so a call's result depends on its arguments alone. Returns an array indexed like
+ * graph->nodes (which follows program->functions), 1 = pure.
+ * Caller must free the returned array */
+int* call_graph_find_pure_functions(CallGraph* graph, ASTProgram* program);
+
 #endif /* CALL_GRAPH_H */
@@ -1,20 +1,169 @@
 #include <stdio.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include "codegen.h"
+#include "ir.h"
+#include "layout.h"
 #include "utils.h"
 
 /* Global variable to track source filename for dbg output */
 static const char* g_source_filename = "unknown.csm";
 
-/* Global counter for unique dbg temporary variables */
-static int g_dbg_tmp_counter = 0;
+/* dbg() output runtime, emitted once when the program uses dbg().
+ * Lines are formatted straight into a static buffer with per-type integer
+ * formatters and written with fwrite when the buffer fills and at exit.
+ * casm_dbg_text() writes a piece too long for the buffer straight out
+ * once the buffer is flushed. */
+static const char* const g_dbg_runtime =
+    "#define CASM_DBG_BUF_SIZE 65536\n"
+    "static char casm_dbg_buf[CASM_DBG_BUF_SIZE];\n"
+    "static size_t casm_dbg_len = 0;\n"
+    "\n"
+    "static inline void casm_dbg_flush(void) {\n"
+    "    fwrite(casm_dbg_buf, 1, casm_dbg_len, stdout);\n"
+    "    casm_dbg_len = 0;\n"
+    "    fflush(stdout);\n"
+    "}\n"
+    "\n"
+    "static inline void casm_dbg_reserve(size_t n) {\n"
+    "    if (casm_dbg_len + n > CASM_DBG_BUF_SIZE) casm_dbg_flush();\n"
+    "}\n"
+    "\n"
+    "static inline void casm_dbg_str(const char* s, size_t n) {\n"
+    "    memcpy(casm_dbg_buf + casm_dbg_len, s, n);\n"
+    "    casm_dbg_len += n;\n"
+    "}\n"
+    "\n"
+    "static inline void casm_dbg_text(const char* s, size_t n) {\n"
+    "    casm_dbg_reserve(n);\n"
+    "    if (n > CASM_DBG_BUF_SIZE) {\n"
+    "        fwrite(s, 1, n, stdout);\n"
+    "        fflush(stdout);\n"
+    "        return;\n"
+    "    }\n"
+    "    casm_dbg_str(s, n);\n"
+    "}\n"
+    "\n"
+    "static inline void casm_dbg_u32(uint32_t v) {\n"
+    "    char tmp[10];\n"
+    "    int i = 10;\n"
+    "    do { tmp[--i] = (char)('0' + v % 10); v /= 10; } while (v);\n"
+    "    casm_dbg_str(tmp + i, (size_t)(10 - i));\n"
+    "}\n"
+    "\n"
+    "static inline void casm_dbg_u64(uint64_t v) {\n"
+    "    char tmp[20];\n"
+    "    int i = 20;\n"
+    "    if (v <= UINT32_MAX) { casm_dbg_u32((uint32_t)v); return; }\n"
+    "    do { tmp[--i] = (char)('0' + v % 10); v /= 10; } while (v);\n"
+    "    casm_dbg_str(tmp + i, (size_t)(20 - i));\n"
+    "}\n"
+    "\n"
+    "static inline void casm_dbg_i32(int32_t v) {\n"
+    "    if (v < 0) { casm_dbg_buf[casm_dbg_len++] = '-'; casm_dbg_u32(0u - (uint32_t)v); }\n"
+    "    else casm_dbg_u32((uint32_t)v);\n"
+    "}\n"
+    "\n"
+    "static inline void casm_dbg_i64(int64_t v) {\n"
+    "    if (v < 0) { casm_dbg_buf[casm_dbg_len++] = '-'; casm_dbg_u64(0u - (uint64_t)v); }\n"
+    "    else casm_dbg_u64((uint64_t)v);\n"
+    "}\n"
+    "\n"
+    "static inline void casm_dbg_bool(_Bool v) {\n"
+    "    if (v) casm_dbg_str(\"true\", 4);\n"
+    "    else casm_dbg_str(\"false\", 5);\n"
+    "}\n"
+    "\n";
 
-/* Global reference to the program being compiled (for function call resolution) */
-static ASTProgram* g_current_program = NULL;
+/* Checked array indexing, emitted when the program has arrays. An index
+ * outside [0, length) stops the program like a WebAssembly trap would;
+ * with dbg() in the program, the lines buffered so far go out first. */
+static const char* const g_array_fail_head =
+    "static void casm_bounds_fail(void) {\n";
 
-/* Global reference to the current function being compiled (for module context in calls) */
-static ASTFunctionDef* g_current_function = NULL;
+static const char* const g_array_runtime =
+    "    fprintf(stderr, \"Error: array index out of bounds\\n\");\n"
+    "    exit(1);\n"
+    "}\n"
+    "\n"
+    "static inline int64_t casm_index(int64_t i, int64_t n) {\n"
+    "    if ((uint64_t)i >= (uint64_t)n) casm_bounds_fail();\n"
+    "    return i;\n"
+    "}\n"
+    "\n";
+
+/* Trapping division, emitted when the program divides: a zero divisor
+ * and the minimum i32 or i64 divided by -1 stop the program like the
+ * corresponding WebAssembly traps. */
+static const char* const g_div_fail_head =
+    "static void casm_div_fail(int overflow) {\n";
+
+static const char* const g_div_runtime =
+    "    fprintf(stderr, overflow ? \"Error: integer overflow\\n\" : \"Error: integer division by zero\\n\");\n"
+    "    exit(1);\n"
+    "}\n"
+    "\n";
+
+/* Bit intrinsics, emitted when the program uses them. Operands arrive
+ * zero-extended from the width w of their type; the builtins compile to
+ * single instructions where the target has them. */
+static const char* const g_bits_runtime =
+    "static inline uint64_t casm_rotl(uint64_t x, uint64_t n, int w) {\n"
+    "    uint64_t mask = w == 64 ? ~0ULL : (1ULL << w) - 1;\n"
+    "    n &= (uint64_t)(w - 1);\n"
+    "    return n ? ((x << n) | (x >> (w - n))) & mask : x;\n"
+    "}\n"
+    "\n"
+    "static inline uint64_t casm_rotr(uint64_t x, uint64_t n, int w) {\n"
+    "    return casm_rotl(x, (uint64_t)w - (n & (uint64_t)(w - 1)), w);\n"
+    "}\n"
+    "\n"
+    "static inline int casm_popcount(uint64_t x) {\n"
+    "    return __builtin_popcountll(x);\n"
+    "}\n"
+    "\n"
+    "static inline int casm_clz(uint64_t x, int w) {\n"
+    "    return x ? __builtin_clzll(x) - (64 - w) : w;\n"
+    "}\n"
+    "\n"
+    "static inline int casm_ctz(uint64_t x, int w) {\n"
+    "    return x ? __builtin_ctzll(x) : w;\n"
+    "}\n"
+    "\n";
+
+/* Largest number of bytes a single dbg() line may reserve at once */
+#define DBG_MAX_RESERVE 4096
+
+/* Whether the program being compiled uses dbg() (and so gets the runtime) */
+static int g_program_has_dbg = 0;
+
+/* Whether the program declares arrays (and so gets checked indexing) */
+static int g_program_has_arrays = 0;
+
+/* Whether the program uses rotates or bit counts (and so gets the bit runtime) */
+static int g_program_has_bit_intrinsics = 0;
+
+/* Whether the program divides (and so gets the division traps) */
+static int g_program_has_division = 0;
+
+/* Options for the program being generated */
+static CodegenOptions g_options;
+
+/* Helper: Emit a trapping runtime whose failure routine starts with
+ * `head`; the dbg runtime precedes it */
+static void emit_fail_runtime(OutputSink* out, const char* head, const char* rest) {
+    output_sink_append(out, head);
+    if (g_program_has_dbg) {
+        output_sink_append(out, "    casm_dbg_flush();\n");
+    }
+    output_sink_append(out, rest);
+}
+
+/* Helper: Emit the checked indexing runtime */
+static void emit_array_runtime(OutputSink* out) {
+    emit_fail_runtime(out, g_array_fail_head, g_array_runtime);
+}
 
 /* Helper: Map CASM type to C type string */
 static const char* casm_type_to_c_type(CasmType type) {
@@ -33,6 +182,16 @@ static const char* casm_type_to_c_type(CasmType type) {
     }
 }
 
+/* Helper: Unsigned C type of the same width as a type */
+static const char* unsigned_c_type(CasmType type) {
+    switch (get_type_size_bits(type)) {
+        case 8:  return "uint8_t";
+        case 16: return "uint16_t";
+        case 32: return "uint32_t";
+        default: return "uint64_t";
+    }
+}
+
 /* Helper: Convert qualified name to mangled name (module:name -> module_name) */
 static char* mangle_function_name(const char* qualified_name) {
     char* mangled = xstrdup(qualified_name);
@@ -44,536 +203,1004 @@ static char* mangle_function_name(const char* qualified_name) {
     return mangled;
 }
 
-/* Helper: Look up the allocated name for a function call */
-static const char* get_call_target_name(const char* call_name) {
-    if (!g_current_program || !call_name) {
-        return call_name;
-    }
-    
-    /* If we have module context, prefer functions from the same module */
-    if (g_current_function && g_current_function->module_path) {
-        for (int i = 0; i < g_current_program->function_count; i++) {
-            ASTFunctionDef* func = &g_current_program->functions[i];
-            if (func->allocated_name && 
-                strcmp(func->name, call_name) == 0 &&
-                strcmp(func->module_path, g_current_function->module_path) == 0) {
-                return func->allocated_name;
-            }
-        }
-    }
-    
-    /* Fallback: Try to find any function with this name that has an allocated_name */
-    for (int i = 0; i < g_current_program->function_count; i++) {
-        ASTFunctionDef* func = &g_current_program->functions[i];
-        if (func->allocated_name && strcmp(func->name, call_name) == 0) {
-            return func->allocated_name;
-        }
+/* Helper: Formatter used by the dbg runtime for a type */
+static const char* dbg_formatter_name(CasmType type) {
+    switch (type) {
+        case TYPE_I8:
+        case TYPE_I16:
+        case TYPE_I32:   return "casm_dbg_i32";
+        case TYPE_I64:   return "casm_dbg_i64";
+        case TYPE_U8:
+        case TYPE_U16:
+        case TYPE_U32:   return "casm_dbg_u32";
+        case TYPE_U64:   return "casm_dbg_u64";
+        case TYPE_BOOL:  return "casm_dbg_bool";
+        default:         return "casm_dbg_i32";
     }
-    
-    /* Not found - use the original name */
-    return call_name;
 }
 
-/* Helper: Check if expression is a function call */
-static int is_function_call(ASTExpression* expr) {
-    return expr && expr->type == EXPR_FUNCTION_CALL;
+/* Helper: Maximum printed width of a value of the given type */
+static int dbg_max_value_width(CasmType type) {
+    switch (type) {
+        case TYPE_I64:   return 20;
+        case TYPE_U64:   return 20;
+        case TYPE_BOOL:  return 5;
+        default:         return 11;
+    }
 }
 
-/* Helper: Emit expression to file */
-static void emit_expression(FILE* out, ASTExpression* expr);
+/* Helper: Emit "<c type> <name>" */
+static void emit_typed_name(OutputSink* out, CasmType type, const char* name) {
+    output_sink_append(out, casm_type_to_c_type(type));
+    output_sink_append_char(out, ' ');
+    output_sink_append(out, name);
+}
 
-/* Helper: Emit expression that may need parentheses if it contains assignment */
-static void emit_expression_in_context(FILE* out, ASTExpression* expr, int needs_parens_for_assign) {
-    if (!expr) return;
-    
-    /* If this is an assignment and we're in a context that needs parentheses, wrap it */
-    if (needs_parens_for_assign && expr->type == EXPR_BINARY_OP && expr->as.binary_op.op == BINOP_ASSIGN) {
-        fprintf(out, "(");
-        emit_expression(out, expr);
-        fprintf(out, ")");
+/* Helper: Emit an integer literal. Negative values (only produced by
+ * constant folding) are parenthesized so they never merge with a
+ * preceding '-' operator. */
+static void emit_int_literal(OutputSink* out, long value) {
+    if (value >= 0) {
+        output_sink_append_int(out, value);
+    } else if (value == LONG_MIN) {
+        output_sink_append(out, "(-9223372036854775807LL - 1)");
     } else {
-        emit_expression(out, expr);
+        output_sink_append_char(out, '(');
+        output_sink_append_int(out, value);
+        output_sink_append_char(out, ')');
     }
 }
 
 /* Helper: Print indent */
-static void print_indent(FILE* out, int indent) {
-    for (int i = 0; i < indent; i++) {
-        fprintf(out, "    ");
-    }
+static void print_indent(OutputSink* out, int indent) {
+    output_sink_append_spaces(out, indent * 4);
 }
 
-/* Helper: Emit binary operator */
-static const char* binop_to_string(BinaryOpType op) {
-    switch (op) {
-        case BINOP_ADD: return "+";
-        case BINOP_SUB: return "-";
-        case BINOP_MUL: return "*";
-        case BINOP_DIV: return "/";
-        case BINOP_MOD: return "%";
-        case BINOP_EQ:  return "==";
-        case BINOP_NE:  return "!=";
-        case BINOP_LT:  return "<";
-        case BINOP_GT:  return ">";
-        case BINOP_LE:  return "<=";
-        case BINOP_GE:  return ">=";
-        case BINOP_AND: return "&&";
-        case BINOP_OR:  return "||";
-        case BINOP_ASSIGN: return "=";
-        default:        return "?";
-    }
-}
-
-/* Helper: Emit unary operator */
-static const char* unop_to_string(UnaryOpType op) {
-    switch (op) {
-        case UNOP_NEG: return "-";
-        case UNOP_NOT: return "!";
-        default:       return "?";
+/* Helper: C tag of a struct type */
+static const char* struct_c_name(const ASTStructDef* def) {
+    return def->allocated_name ? def->allocated_name : def->name;
+}
+
+/* Helper: Emit dbg text as the contents of a C string literal */
+static void emit_dbg_literal(OutputSink* out, const char* text, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] == '"' || text[i] == '\\') {
+            output_sink_append_char(out, '\\');
+            output_sink_append_char(out, text[i]);
+        } else if (text[i] == '\n') {
+            output_sink_append(out, "\\n");
+        } else {
+            output_sink_append_char(out, text[i]);
+        }
     }
 }
 
-/* Emit a single expression */
-static void emit_expression(FILE* out, ASTExpression* expr) {
-    if (!expr) return;
-    
-    switch (expr->type) {
-        case EXPR_LITERAL:
-            if (expr->as.literal.type == LITERAL_INT) {
-                fprintf(out, "%ld", expr->as.literal.value.int_value);
-            } else {
-                fprintf(out, "%s", expr->as.literal.value.bool_value ? "true" : "false");
-            }
-            break;
-            
-        case EXPR_VARIABLE:
-            fprintf(out, "%s", expr->as.variable.name);
-            break;
-            
-        case EXPR_BINARY_OP: {
-            /* Assignment doesn't need parentheses and has different spacing */
-            if (expr->as.binary_op.op == BINOP_ASSIGN) {
-                emit_expression(out, expr->as.binary_op.left);
-                fprintf(out, " = ");
-                emit_expression(out, expr->as.binary_op.right);
-            } else {
-                fprintf(out, "(");
-                /* Parenthesize assignment sub-expressions to preserve precedence */
-                emit_expression_in_context(out, expr->as.binary_op.left, 1);
-                fprintf(out, " %s ", binop_to_string(expr->as.binary_op.op));
-                emit_expression_in_context(out, expr->as.binary_op.right, 1);
-                fprintf(out, ")");
-            }
-            break;
+/* Helper: Emit a casm_dbg_str() call for a piece of literal dbg text */
+static void emit_dbg_text(OutputSink* out, const char* text, size_t len, int indent) {
+    print_indent(out, indent);
+    output_sink_append(out, "casm_dbg_str(\"");
+    emit_dbg_literal(out, text, len);
+    output_sink_append(out, "\", ");
+    output_sink_append_int(out, (long long)len);
+    output_sink_append(out, ");\n");
+}
+
+/* Helper: Emit a piece of dbg text for a line too long to reserve at once.
+ * casm_dbg_text() makes room for it, or writes it straight out. */
+static void emit_dbg_piece(OutputSink* out, const char* text, size_t len, int indent) {
+    print_indent(out, indent);
+    output_sink_append(out, "casm_dbg_text(\"");
+    emit_dbg_literal(out, text, len);
+    output_sink_append(out, "\", ");
+    output_sink_append_int(out, (long long)len);
+    output_sink_append(out, ");\n");
+}
+
+/* Helper: Split the line "file:line:col: name = value, ..." a dbg()
+ * statement prints into literal text pieces; piece k is the text written
+ * before value k, and the last one ends the line. Free with
+ * free_dbg_text_pieces(). */
+static char** dbg_text_pieces(const ASTDbgStmt* dbg) {
+    int count = dbg->argument_count;
+    char** pieces = xmalloc((count + 1) * sizeof(char*));
+    for (int i = 0; i <= count; i++) {
+        char prefix[512];
+        const char* name = NULL;
+        char fallback[32];
+        
+        if (i == 0) {
+            snprintf(prefix, sizeof(prefix), "%s:%d:%d: ",
+                     g_source_filename, dbg->location.line, dbg->location.column);
+        } else {
+            snprintf(prefix, sizeof(prefix), ", ");
         }
         
-        case EXPR_UNARY_OP: {
-            fprintf(out, "(%s", unop_to_string(expr->as.unary_op.op));
-            /* Parenthesize assignment sub-expressions */
-            emit_expression_in_context(out, expr->as.unary_op.operand, 1);
-            fprintf(out, ")");
+        if (i == count) {
+            /* Trailing text: end of line */
+            size_t len = (i == 0 ? strlen(prefix) : 0);
+            pieces[i] = xmalloc(len + 2);
+            memcpy(pieces[i], prefix, len);
+            pieces[i][len] = '\n';
+            pieces[i][len + 1] = '\0';
             break;
         }
         
-        case EXPR_FUNCTION_CALL: {
-            /* Look up the actual function name (handles allocated names with mangling) */
-            const char* call_target = get_call_target_name(expr->as.function_call.function_name);
-            char* mangled_name = mangle_function_name(call_target);
-            fprintf(out, "%s(", mangled_name);
-            xfree(mangled_name);
-            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
-                if (i > 0) fprintf(out, ", ");
-                /* Parenthesize assignment sub-expressions in function arguments */
-                emit_expression_in_context(out, &expr->as.function_call.arguments[i], 1);
-            }
-            fprintf(out, ")");
-            break;
+        if (dbg->arg_names[i] && strlen(dbg->arg_names[i]) > 0) {
+            name = dbg->arg_names[i];
+        } else {
+            snprintf(fallback, sizeof(fallback), "arg%d", i);
+            name = fallback;
+        }
+        
+        size_t len = strlen(prefix) + strlen(name) + 3;
+        pieces[i] = xmalloc(len + 1);
+        snprintf(pieces[i], len + 1, "%s%s = ", prefix, name);
+    }
+    return pieces;
+}
+
+static void free_dbg_text_pieces(char** pieces, int count) {
+    for (int i = 0; i <= count; i++) {
+        xfree(pieces[i]);
+    }
+    xfree(pieces);
+}
+
+/* Emit struct types with their fields in layout order */
+static void emit_structs(OutputSink* out, const ASTStructDef* structs, int struct_count) {
+    if (struct_count == 0) return;
+    for (int i = 0; i < struct_count; i++) {
+        const ASTStructDef* def = &structs[i];
+        int* order = xmalloc((def->field_count + 1) * sizeof(int));
+        layout_fields_by_offset(def, order);
+        output_sink_append(out, "struct ");
+        output_sink_append(out, struct_c_name(def));
+        output_sink_append(out, " {\n");
+        for (int f = 0; f < def->field_count; f++) {
+            print_indent(out, 1);
+            emit_typed_name(out, def->fields[order[f]].type.type, def->fields[order[f]].name);
+            output_sink_append(out, ";\n");
         }
+        output_sink_append(out, def->packed ? "} __attribute__((packed));\n" : "};\n");
+        xfree(order);
     }
+    output_sink_append(out, "\n");
 }
 
-/* Forward declaration for emit_statement */
-static void emit_statement(FILE* out, ASTStatement* stmt, int indent);
+/* ===== C from the SSA IR =====
+ *
+ * The compiler's C target. Each IR value becomes a local __vN assigned
+ * once where its instruction is, each block a label, and control flow
+ * gotos, so the C compiler sees the same program the other IR backends
+ * run, with narrow operands already promoted. Phi arguments are copied
+ * into __phiN by each predecessor and read back at the top of the block,
+ * which makes the copies for a block parallel. Arithmetic that may wrap
+ * goes through the unsigned type of its width, so no result is undefined
+ * behaviour. */
 
-/* Emit a block of statements */
-static void emit_block(FILE* out, ASTBlock* block, int indent) {
-    for (int i = 0; i < block->statement_count; i++) {
-        emit_statement(out, &block->statements[i], indent);
+/* State for the function being generated */
+static const IrModule* g_ir_module = NULL;
+static const IrFunction* g_ir_func = NULL;
+static int* g_ir_uses = NULL;           /* Per value: operands and terminators reading it */
+
+/* Helper: Emit the C expression for IR parameter `index`: its own C
+ * parameter, or a field read through its struct's pointer */
+static void emit_ir_param(OutputSink* out, int index) {
+    const IrParamOrigin* origin = &g_ir_func->param_origins[index];
+    if (origin->struct_index < 0) {
+        output_sink_append(out, "__p");
+        output_sink_append_int(out, index);
+        return;
     }
+    const ASTStructDef* def = &g_ir_module->structs[origin->struct_index];
+    output_sink_append(out, "__s");
+    output_sink_append_int(out, index - origin->field);
+    output_sink_append(out, "->");
+    output_sink_append(out, def->fields[origin->field].name);
 }
 
-/* Emit a statement */
-static void emit_statement(FILE* out, ASTStatement* stmt, int indent) {
-    if (!stmt) return;
-    
-    switch (stmt->type) {
-        case STMT_VAR_DECL: {
-            ASTVarDecl* var = &stmt->as.var_decl_stmt.var_decl;
-            print_indent(out, indent);
-            fprintf(out, "%s %s", casm_type_to_c_type(var->type.type), var->name);
-            if (var->initializer) {
-                fprintf(out, " = ");
-                emit_expression(out, var->initializer);
-            }
-            fprintf(out, ";\n");
-            break;
+/* Helper: Check if an instruction is a struct field parameter, which is
+ * read through the struct's pointer where it is used */
+static int ir_is_struct_param(const IrInstr* instr) {
+    return instr->op == IR_PARAM && g_ir_func->param_origins[instr->imm].struct_index >= 0;
+}
+
+/* Helper: Mark a struct parameter as used when none of its fields are,
+ * for the C compiler's sake; done at its first field */
+static void emit_ir_struct_param_use(OutputSink* out, const IrInstr* instr) {
+    const IrParamOrigin* origin = &g_ir_func->param_origins[instr->imm];
+    if (origin->field > 0) return;
+    int field_count = g_ir_module->structs[origin->struct_index].field_count;
+    const IrBlock* entry = &g_ir_func->blocks[0];
+    for (int i = 0; i < entry->instr_count; i++) {
+        int value = entry->instrs[i];
+        const IrInstr* param = &g_ir_func->values[value];
+        if (param->op == IR_PARAM && param->imm >= instr->imm && param->imm < instr->imm + field_count &&
+            g_ir_uses[value] > 0) {
+            return;
         }
-        
-        case STMT_EXPR: {
-            print_indent(out, indent);
-            emit_expression(out, stmt->as.expr_stmt.expr);
-            fprintf(out, ";\n");
-            break;
+    }
+    print_indent(out, 1);
+    output_sink_append(out, "(void)__s");
+    output_sink_append_int(out, instr->imm);
+    output_sink_append(out, ";\n");
+}
+
+/* Helper: C name of an array operand */
+static void emit_ir_array_name(OutputSink* out, long long imm) {
+    if (IR_IS_GLOBAL_ARRAY(imm)) {
+        output_sink_append(out, g_ir_module->globals[IR_ARRAY_INDEX(imm)].name);
+    } else {
+        output_sink_append(out, "__a");
+        output_sink_append_int(out, IR_ARRAY_INDEX(imm));
+    }
+}
+
+/* Helper: Emit a value: its __vN variable, or for a struct field
+ * parameter the read through the struct's pointer */
+static void emit_ir_value(OutputSink* out, int value) {
+    const IrInstr* instr = &g_ir_func->values[value];
+    if (ir_is_struct_param(instr)) {
+        emit_ir_param(out, (int)instr->imm);
+        return;
+    }
+    output_sink_append(out, "__v");
+    output_sink_append_int(out, value);
+}
+
+/* Helper: Emit "(<unsigned type>)__vN", the operand form for wrapping arithmetic */
+static void emit_ir_unsigned(OutputSink* out, int value) {
+    output_sink_append_char(out, '(');
+    output_sink_append(out, unsigned_c_type(g_ir_func->values[value].type));
+    output_sink_append_char(out, ')');
+    emit_ir_value(out, value);
+}
+
+/* Helper: Emit a shift count masked to the width of the shifted type */
+static void emit_ir_shift_count(OutputSink* out, const IrInstr* instr) {
+    output_sink_append_char(out, '(');
+    emit_ir_unsigned(out, instr->args[1]);
+    output_sink_append(out, get_type_size_bits(instr->type) == 64 ? " & 63)" : " & 31)");
+}
+
+/* Helper: Which predecessor slot of `to` the edge from `from` is. Both
+ * edges of a branch may go to the same block; `second` picks the later one. */
+static int ir_pred_slot(const IrBlock* to, int from, int second) {
+    int first = -1;
+    for (int i = 0; i < to->pred_count; i++) {
+        if (to->preds[i] != from) continue;
+        if (!second || first >= 0) return i;
+        first = i;
+    }
+    return first;
+}
+
+/* Helper: Emit the phi copies and jump for the edge from `from` to `to`.
+ * With `fallthrough` the jump is left out when `to` is the next block. */
+static void emit_ir_edge(OutputSink* out, int from, int to, int second, int fallthrough, int indent) {
+    const IrBlock* target = &g_ir_func->blocks[to];
+    int slot = ir_pred_slot(target, from, second);
+    for (int i = 0; i < target->instr_count; i++) {
+        const IrInstr* phi = &g_ir_func->values[target->instrs[i]];
+        if (phi->op != IR_PHI) break;
+        if (g_ir_uses[target->instrs[i]] == 0) continue;
+        print_indent(out, indent);
+        output_sink_append(out, "__phi");
+        output_sink_append_int(out, target->instrs[i]);
+        output_sink_append(out, " = ");
+        emit_ir_value(out, phi->args[slot]);
+        output_sink_append(out, ";\n");
+    }
+    if (!fallthrough || to != from + 1) {
+        print_indent(out, indent);
+        output_sink_append(out, "goto b");
+        output_sink_append_int(out, to);
+        output_sink_append(out, ";\n");
+    }
+}
+
+/* Emit an IR dbg statement through the buffered dbg runtime */
+static void emit_ir_dbg(OutputSink* out, const IrInstr* instr) {
+    const ASTDbgStmt* dbg = instr->dbg;
+    int count = instr->arg_count;
+    char** pieces = dbg_text_pieces(dbg);
+
+    size_t total = 0;
+    for (int i = 0; i <= count; i++) {
+        total += strlen(pieces[i]);
+        if (i < count) total += dbg_max_value_width(g_ir_func->values[instr->args[i]].type);
+    }
+    int reserve_once = total <= DBG_MAX_RESERVE;
+    if (reserve_once) {
+        print_indent(out, 1);
+        output_sink_append(out, "casm_dbg_reserve(");
+        output_sink_append_int(out, (long long)total);
+        output_sink_append(out, ");\n");
+    }
+
+    for (int i = 0; i <= count; i++) {
+        size_t len = strlen(pieces[i]);
+        if (reserve_once) {
+            emit_dbg_text(out, pieces[i], len, 1);
+        } else {
+            emit_dbg_piece(out, pieces[i], len, 1);
         }
-        
-        case STMT_RETURN: {
-            print_indent(out, indent);
-            fprintf(out, "return");
-            if (stmt->as.return_stmt.value) {
-                fprintf(out, " ");
-                emit_expression(out, stmt->as.return_stmt.value);
-            }
-            fprintf(out, ";\n");
-            break;
+        if (i == count) break;
+
+        CasmType type = g_ir_func->values[instr->args[i]].type;
+        if (!reserve_once) {
+            print_indent(out, 1);
+            output_sink_append(out, "casm_dbg_reserve(");
+            output_sink_append_int(out, dbg_max_value_width(type));
+            output_sink_append(out, ");\n");
         }
-        
-        case STMT_IF: {
-            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
-            
-            print_indent(out, indent);
-            fprintf(out, "if (");
-            emit_expression(out, if_stmt->condition);
-            fprintf(out, ") {\n");
-            emit_block(out, &if_stmt->then_body, indent + 1);
-            print_indent(out, indent);
-            fprintf(out, "}");
-            
-            /* Emit else-if chain */
-            for (ASTElseIfClause* elif = if_stmt->else_if_chain; elif; elif = elif->next) {
-                fprintf(out, " else if (");
-                emit_expression(out, elif->condition);
-                fprintf(out, ") {\n");
-                emit_block(out, &elif->body, indent + 1);
-                print_indent(out, indent);
-                fprintf(out, "}");
+        print_indent(out, 1);
+        output_sink_append(out, dbg_formatter_name(type));
+        output_sink_append_char(out, '(');
+        emit_ir_value(out, instr->args[i]);
+        output_sink_append(out, ");\n");
+    }
+    free_dbg_text_pieces(pieces, count);
+}
+
+/* Helper: Find a module function by name */
+static const IrFunction* find_ir_function(const char* name) {
+    for (int i = 0; i < g_ir_module->function_count; i++) {
+        if (strcmp(g_ir_module->functions[i]->name, name) == 0) {
+            return g_ir_module->functions[i];
+        }
+    }
+    return NULL;
+}
+
+/* Helper: Check if a call's arguments args[first..] are the fields of one
+ * of the current function's own struct parameters, in order; returns
+ * that parameter's index or -1 */
+static int ir_forwarded_struct(const IrInstr* call, int first, int struct_index, int field_count) {
+    const IrInstr* head = &g_ir_func->values[call->args[first]];
+    if (head->op != IR_PARAM) return -1;
+    int base = (int)head->imm;
+    for (int f = 0; f < field_count; f++) {
+        const IrInstr* arg = &g_ir_func->values[call->args[first + f]];
+        if (arg->op != IR_PARAM || arg->imm != base + f) return -1;
+        const IrParamOrigin* origin = &g_ir_func->param_origins[arg->imm];
+        if (origin->struct_index != struct_index || origin->field != f) return -1;
+    }
+    return base;
+}
+
+/* Helper: Emit a call. The fields passed for a struct parameter become
+ * the address of a compound literal, or the caller's own pointer when it
+ * forwards a struct parameter unchanged. */
+static void emit_ir_call(OutputSink* out, const IrInstr* instr) {
+    const IrFunction* callee = find_ir_function(instr->callee);
+    char* mangled_name = mangle_function_name(instr->callee);
+    output_sink_append(out, mangled_name);
+    xfree(mangled_name);
+    output_sink_append_char(out, '(');
+    for (int i = 0; i < instr->arg_count; i++) {
+        const IrParamOrigin* origin = callee && i < callee->param_count ? &callee->param_origins[i] : NULL;
+        if (i > 0) output_sink_append(out, ", ");
+        if (!origin || origin->struct_index < 0) {
+            emit_ir_value(out, instr->args[i]);
+            continue;
+        }
+        const ASTStructDef* def = &g_ir_module->structs[origin->struct_index];
+        int forwarded = ir_forwarded_struct(instr, i, origin->struct_index, def->field_count);
+        if (forwarded >= 0) {
+            output_sink_append(out, "__s");
+            output_sink_append_int(out, forwarded);
+        } else {
+            output_sink_append(out, "&(struct ");
+            output_sink_append(out, struct_c_name(def));
+            output_sink_append(out, "){");
+            for (int f = 0; f < def->field_count; f++) {
+                if (f > 0) output_sink_append(out, ", ");
+                output_sink_append_char(out, '.');
+                output_sink_append(out, def->fields[f].name);
+                output_sink_append(out, " = ");
+                emit_ir_value(out, instr->args[i + f]);
             }
-            
-            /* Emit else block if present */
-            if (if_stmt->else_body) {
-                fprintf(out, " else {\n");
-                emit_block(out, if_stmt->else_body, indent + 1);
-                print_indent(out, indent);
-                fprintf(out, "}\n");
+            output_sink_append_char(out, '}');
+        }
+        i += def->field_count - 1;
+    }
+    output_sink_append_char(out, ')');
+}
+
+/* Helper: C operator of a binary IR instruction that maps onto one directly */
+static const char* ir_operator(IrOpcode op) {
+    switch (op) {
+        case IR_ADD: return "+";
+        case IR_SUB: return "-";
+        case IR_MUL: return "*";
+        case IR_DIV: return "/";
+        case IR_MOD: return "%";
+        case IR_AND: return "&";
+        case IR_OR:  return "|";
+        case IR_XOR: return "^";
+        case IR_EQ:  return "==";
+        case IR_NE:  return "!=";
+        case IR_LT:  return "<";
+        case IR_GT:  return ">";
+        case IR_LE:  return "<=";
+        case IR_GE:  return ">=";
+        default:     return "?";
+    }
+}
+
+/* Helper: Check if a division's divisor may be zero */
+static int ir_division_may_trap(const IrFunction* func, const IrInstr* instr) {
+    const IrInstr* divisor = &func->values[instr->args[1]];
+    return divisor->op != IR_CONST || divisor->imm == 0;
+}
+
+/* Helper: Check if a signed division may see the minimum of a type whose
+ * operands C does not promote past it, divided by -1 */
+static int ir_division_may_overflow(const IrFunction* func, const IrInstr* instr) {
+    if (instr->type != TYPE_I32 && instr->type != TYPE_I64) return 0;
+    const IrInstr* divisor = &func->values[instr->args[1]];
+    return divisor->op != IR_CONST || divisor->imm == -1;
+}
+
+/* Helper: Emit the traps of a division or remainder: a zero divisor, and
+ * for division the minimum value divided by -1 */
+static void emit_ir_division_checks(OutputSink* out, const IrInstr* instr) {
+    if (ir_division_may_trap(g_ir_func, instr)) {
+        print_indent(out, 1);
+        output_sink_append(out, "if (");
+        emit_ir_value(out, instr->args[1]);
+        output_sink_append(out, " == 0) casm_div_fail(0);\n");
+    }
+    if (instr->op == IR_DIV && ir_division_may_overflow(g_ir_func, instr)) {
+        print_indent(out, 1);
+        output_sink_append(out, "if (");
+        emit_ir_value(out, instr->args[1]);
+        output_sink_append(out, " == -1 && ");
+        emit_ir_value(out, instr->args[0]);
+        output_sink_append(out, " == ");
+        emit_int_literal(out, instr->type == TYPE_I64 ? LONG_MIN : INT_MIN);
+        output_sink_append(out, ") casm_div_fail(1);\n");
+    }
+}
+
+/* Emit one instruction as a statement */
+static void emit_ir_instr(OutputSink* out, int value) {
+    const IrInstr* instr = &g_ir_func->values[value];
+    if (ir_is_struct_param(instr)) {
+        emit_ir_struct_param_use(out, instr);
+        return;
+    }
+    const char* c_type = casm_type_to_c_type(instr->type);
+    int used = instr->type != TYPE_VOID && g_ir_uses[value] > 0;
+
+    /* Unused values are left out, except for calls and divisions, which
+     * may have effects or trap */
+    if (!used && instr->type != TYPE_VOID) {
+        if (instr->op == IR_PARAM && !ir_is_struct_param(instr)) {
+            print_indent(out, 1);
+            output_sink_append(out, "(void)__p");
+            output_sink_append_int(out, instr->imm);
+            output_sink_append(out, ";\n");
+            return;
+        }
+        if (instr->op == IR_DIV || instr->op == IR_MOD) {
+            emit_ir_division_checks(out, instr);
+            return;
+        }
+        if (instr->op != IR_CALL) return;
+    }
+
+    switch (instr->op) {
+        case IR_PHI:
+            print_indent(out, 1);
+            emit_ir_value(out, value);
+            output_sink_append(out, " = __phi");
+            output_sink_append_int(out, value);
+            output_sink_append(out, ";\n");
+            return;
+        case IR_DBG:
+            emit_ir_dbg(out, instr);
+            return;
+        case IR_STORE:
+            print_indent(out, 1);
+            emit_ir_array_name(out, instr->imm);
+            output_sink_append_char(out, '[');
+            emit_ir_value(out, instr->args[0]);
+            output_sink_append(out, "] = ");
+            emit_ir_value(out, instr->args[1]);
+            output_sink_append(out, ";\n");
+            return;
+        case IR_BOUNDS_CHECK:
+            print_indent(out, 1);
+            output_sink_append(out, "if ((uint64_t)");
+            emit_ir_value(out, instr->args[0]);
+            output_sink_append(out, " >= ");
+            output_sink_append_int(out, ir_array_ref(g_ir_module, g_ir_func, instr->imm)->length);
+            output_sink_append(out, ") casm_bounds_fail();\n");
+            return;
+        case IR_ARRAY_INIT: {
+            const IrArray* array = &g_ir_func->arrays[instr->imm];
+            print_indent(out, 1);
+            if (array->init_count > 0) {
+                output_sink_append(out, "memcpy(__a");
+                output_sink_append_int(out, instr->imm);
+                output_sink_append(out, ", __a");
+                output_sink_append_int(out, instr->imm);
+                output_sink_append(out, "_init, sizeof(__a");
             } else {
-                fprintf(out, "\n");
+                output_sink_append(out, "memset(__a");
+                output_sink_append_int(out, instr->imm);
+                output_sink_append(out, ", 0, sizeof(__a");
             }
-            break;
+            output_sink_append_int(out, instr->imm);
+            output_sink_append(out, "));\n");
+            return;
         }
-        
-        case STMT_WHILE: {
-            ASTWhileStmt* while_stmt = &stmt->as.while_stmt;
-            
-            print_indent(out, indent);
-            fprintf(out, "while (");
-            emit_expression(out, while_stmt->condition);
-            fprintf(out, ") {\n");
-            emit_block(out, &while_stmt->body, indent + 1);
-            print_indent(out, indent);
-            fprintf(out, "}\n");
+        default:
             break;
-        }
-        
-        case STMT_FOR: {
-            ASTForStmt* for_stmt = &stmt->as.for_stmt;
-            
-            print_indent(out, indent);
-            fprintf(out, "for (");
-            
-            /* Emit init */
-            if (for_stmt->init) {
-                if (for_stmt->init->type == STMT_VAR_DECL) {
-                    /* Variable declaration in for init */
-                    ASTVarDecl* var = &for_stmt->init->as.var_decl_stmt.var_decl;
-                    fprintf(out, "%s %s", casm_type_to_c_type(var->type.type), var->name);
-                    if (var->initializer) {
-                        fprintf(out, " = ");
-                        emit_expression(out, var->initializer);
-                    }
-                } else if (for_stmt->init->type == STMT_EXPR) {
-                    /* Expression statement in for init */
-                    emit_expression(out, for_stmt->init->as.expr_stmt.expr);
-                }
-            }
-            fprintf(out, "; ");
-            
-            /* Emit condition */
-            if (for_stmt->condition) {
-                emit_expression(out, for_stmt->condition);
+    }
+
+    if (instr->op == IR_DIV || instr->op == IR_MOD) {
+        emit_ir_division_checks(out, instr);
+    }
+    print_indent(out, 1);
+    if (used) {
+        emit_ir_value(out, value);
+        output_sink_append(out, " = ");
+    }
+
+    switch (instr->op) {
+        case IR_CONST:
+            emit_int_literal(out, instr->imm);
+            break;
+        case IR_PARAM:
+            emit_ir_param(out, (int)instr->imm);
+            break;
+        case IR_UNDEF:
+            output_sink_append_char(out, '0');
+            break;
+        case IR_CONV:
+            /* A C conversion wraps, extends and tests for bool exactly like the IR */
+            output_sink_append_char(out, '(');
+            output_sink_append(out, c_type);
+            output_sink_append_char(out, ')');
+            emit_ir_value(out, instr->args[0]);
+            break;
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+            output_sink_append_char(out, '(');
+            output_sink_append(out, c_type);
+            output_sink_append(out, ")(");
+            emit_ir_unsigned(out, instr->args[0]);
+            output_sink_append_char(out, ' ');
+            output_sink_append(out, ir_operator(instr->op));
+            output_sink_append_char(out, ' ');
+            emit_ir_unsigned(out, instr->args[1]);
+            output_sink_append_char(out, ')');
+            break;
+        case IR_MOD:
+            /* x % -1 is 0, also for the minimum value where C's is undefined */
+            if (ir_division_may_overflow(g_ir_func, instr)) {
+                emit_ir_value(out, instr->args[1]);
+                output_sink_append(out, " == -1 ? 0 : ");
             }
-            fprintf(out, "; ");
-            
-            /* Emit update */
-            if (for_stmt->update) {
-                emit_expression(out, for_stmt->update);
+            emit_ir_value(out, instr->args[0]);
+            output_sink_append(out, " % ");
+            emit_ir_value(out, instr->args[1]);
+            break;
+        case IR_DIV:
+        case IR_AND:
+        case IR_OR:
+        case IR_XOR:
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_GT:
+        case IR_LE:
+        case IR_GE:
+            emit_ir_value(out, instr->args[0]);
+            output_sink_append_char(out, ' ');
+            output_sink_append(out, ir_operator(instr->op));
+            output_sink_append_char(out, ' ');
+            emit_ir_value(out, instr->args[1]);
+            break;
+        case IR_SHL:
+            output_sink_append_char(out, '(');
+            output_sink_append(out, c_type);
+            output_sink_append(out, ")(");
+            emit_ir_unsigned(out, instr->args[0]);
+            output_sink_append(out, " << ");
+            emit_ir_shift_count(out, instr);
+            output_sink_append_char(out, ')');
+            break;
+        case IR_SHR:
+            /* Arithmetic for signed types, as C compilers shift them */
+            emit_ir_value(out, instr->args[0]);
+            output_sink_append(out, " >> ");
+            emit_ir_shift_count(out, instr);
+            break;
+        case IR_ROTL:
+        case IR_ROTR:
+            output_sink_append_char(out, '(');
+            output_sink_append(out, c_type);
+            output_sink_append(out, instr->op == IR_ROTL ? ")casm_rotl(" : ")casm_rotr(");
+            emit_ir_unsigned(out, instr->args[0]);
+            output_sink_append(out, ", (uint64_t)");
+            emit_ir_value(out, instr->args[1]);
+            output_sink_append(out, ", ");
+            output_sink_append_int(out, get_type_size_bits(instr->type));
+            output_sink_append_char(out, ')');
+            break;
+        case IR_NEG:
+            output_sink_append_char(out, '(');
+            output_sink_append(out, c_type);
+            output_sink_append(out, ")(0 - ");
+            emit_ir_unsigned(out, instr->args[0]);
+            output_sink_append_char(out, ')');
+            break;
+        case IR_NOT:
+            output_sink_append_char(out, '!');
+            emit_ir_value(out, instr->args[0]);
+            break;
+        case IR_POPCOUNT:
+        case IR_CLZ:
+        case IR_CTZ: {
+            CasmType operand_type = g_ir_func->values[instr->args[0]].type;
+            output_sink_append_char(out, '(');
+            output_sink_append(out, c_type);
+            output_sink_append(out, instr->op == IR_POPCOUNT ? ")casm_popcount(" :
+                                    instr->op == IR_CLZ ? ")casm_clz(" : ")casm_ctz(");
+            emit_ir_unsigned(out, instr->args[0]);
+            if (instr->op != IR_POPCOUNT) {
+                output_sink_append(out, ", ");
+                output_sink_append_int(out, get_type_size_bits(operand_type));
             }
-            fprintf(out, ") {\n");
-            
-            emit_block(out, &for_stmt->body, indent + 1);
-            print_indent(out, indent);
-            fprintf(out, "}\n");
+            output_sink_append_char(out, ')');
             break;
         }
-        
-        case STMT_BLOCK: {
-            /* Emit nested block with braces to preserve scoping */
-            print_indent(out, indent);
-            fprintf(out, "{\n");
-            emit_block(out, &stmt->as.block_stmt.block, indent + 1);
-            print_indent(out, indent);
-            fprintf(out, "}\n");
+        case IR_CALL:
+            emit_ir_call(out, instr);
+            break;
+        case IR_LOAD:
+            emit_ir_array_name(out, instr->imm);
+            output_sink_append_char(out, '[');
+            emit_ir_value(out, instr->args[0]);
+            output_sink_append_char(out, ']');
+            break;
+        default:
+            break;
+    }
+    output_sink_append(out, ";\n");
+}
+
+/* Emit a block's label (when something jumps to it), instructions and
+ * terminator */
+static void emit_ir_block(OutputSink* out, int index, const int* labeled) {
+    const IrBlock* block = &g_ir_func->blocks[index];
+    if (labeled[index]) {
+        output_sink_append(out, "b");
+        output_sink_append_int(out, index);
+        output_sink_append(out, ":;\n");
+    }
+
+    for (int i = 0; i < block->instr_count; i++) {
+        emit_ir_instr(out, block->instrs[i]);
+    }
+
+    switch (block->term.kind) {
+        case IR_TERM_JUMP:
+            emit_ir_edge(out, index, block->term.targets[0], 0, 1, 1);
+            break;
+        case IR_TERM_BRANCH: {
+            /* The edge to the next block, if either, falls through */
+            int invert = block->term.targets[0] == index + 1;
+            int taken = block->term.targets[invert ? 1 : 0];
+            int other = block->term.targets[invert ? 0 : 1];
+            int same = taken == other;
+            print_indent(out, 1);
+            output_sink_append(out, invert ? "if (!" : "if (");
+            emit_ir_value(out, block->term.value);
+            output_sink_append(out, ") {\n");
+            emit_ir_edge(out, index, taken, same && invert, 0, 2);
+            print_indent(out, 1);
+            output_sink_append(out, "}\n");
+            emit_ir_edge(out, index, other, same && !invert, 1, 1);
             break;
         }
-        
-        case STMT_DBG: {
-            ASTDbgStmt* dbg = &stmt->as.dbg_stmt;
-            
-            /* Store temporary variable names for each argument */
-            char** tmp_names = xmalloc(dbg->argument_count * sizeof(char*));
-            
-            /* First, check if any arguments are function calls */
-            /* If so, we need to store their values in temp variables */
-            for (int i = 0; i < dbg->argument_count; i++) {
-                if (is_function_call(&dbg->arguments[i])) {
-                    /* Create unique temporary variable name */
-                    char tmp_name_buf[64];
-                    snprintf(tmp_name_buf, sizeof(tmp_name_buf), "__dbg_tmp_%d", g_dbg_tmp_counter++);
-                    tmp_names[i] = xstrdup(tmp_name_buf);
-                    
-                    /* Emit temporary variable assignment for this function call */
-                    print_indent(out, indent);
-                    fprintf(out, "%s %s = ",
-                            casm_type_to_c_type(dbg->arguments[i].resolved_type),
-                            tmp_names[i]);
-                    emit_expression(out, &dbg->arguments[i]);
-                    fprintf(out, ";\n");
-                } else {
-                    tmp_names[i] = NULL;
-                }
-            }
-            
-            print_indent(out, indent);
-            fprintf(out, "printf(\"");
-            
-            /* Location info only once */
-            fprintf(out, "%s:%d:%d: ", g_source_filename, dbg->location.line, dbg->location.column);
-            
-             /* Build the format string with all arguments */
-             for (int i = 0; i < dbg->argument_count; i++) {
-                 if (i > 0) fprintf(out, ", ");  /* Comma between arguments */
-                 
-                 if (dbg->arg_names[i] && strlen(dbg->arg_names[i]) > 0) {
-                     /* Escape % characters in arg_names for the C printf format string
-                        We need double-escaping because fprintf will turn %% into %,
-                        and then the C compiler will see that % in the source code */
-                     const char* name = dbg->arg_names[i];
-                     for (int j = 0; name[j]; j++) {
-                         if (name[j] == '%') {
-                             fprintf(out, "%%%%");  /* %%%% -> %% (in source) -> % (at runtime) */
-                         } else {
-                             fprintf(out, "%c", name[j]);
-                         }
-                     }
-                     fprintf(out, " = ");
-                 } else {
-                     fprintf(out, "arg%d = ", i);
-                 }
-                 
-                 /* Add format specifier based on type */
-                 CasmType arg_type = dbg->arguments[i].resolved_type;
-                 switch (arg_type) {
-                     case TYPE_I8:
-                     case TYPE_I16:
-                     case TYPE_I32: fprintf(out, "%%d"); break;
-                     case TYPE_I64: fprintf(out, "%%lld"); break;
-                     case TYPE_U8:
-                     case TYPE_U16:
-                     case TYPE_U32: fprintf(out, "%%u"); break;
-                     case TYPE_U64: fprintf(out, "%%llu"); break;
-                     case TYPE_BOOL: fprintf(out, "%%s"); break;
-                     default: fprintf(out, "%%d"); break;
-                 }
-             }
-            fprintf(out, "\\n\"");
-            
-            /* Add arguments to printf */
-            for (int i = 0; i < dbg->argument_count; i++) {
-                fprintf(out, ", ");
-                CasmType arg_type = dbg->arguments[i].resolved_type;
-                
-                /* Use temp variable if this was a function call, otherwise emit expression */
-                if (tmp_names[i] != NULL) {
-                    if (arg_type == TYPE_BOOL) {
-                        fprintf(out, "%s ? \"true\" : \"false\"", tmp_names[i]);
-                    } else if (arg_type == TYPE_I64 || arg_type == TYPE_U64) {
-                        fprintf(out, "(long long)%s", tmp_names[i]);
-                    } else if (arg_type == TYPE_U32 || arg_type == TYPE_U8 || arg_type == TYPE_U16) {
-                        fprintf(out, "(unsigned int)%s", tmp_names[i]);
-                    } else {
-                        fprintf(out, "%s", tmp_names[i]);
-                    }
-                } else {
-                    /* For non-function-call expressions, emit them directly as before */
-                    if (arg_type == TYPE_BOOL) {
-                        fprintf(out, "(");
-                        emit_expression(out, &dbg->arguments[i]);
-                        fprintf(out, ") ? \"true\" : \"false\"");
-                    } else if (arg_type == TYPE_I64 || arg_type == TYPE_U64) {
-                        fprintf(out, "(long long)(");
-                        emit_expression(out, &dbg->arguments[i]);
-                        fprintf(out, ")");
-                    } else if (arg_type == TYPE_U32 || arg_type == TYPE_U8 || arg_type == TYPE_U16) {
-                        fprintf(out, "(unsigned int)(");
-                        emit_expression(out, &dbg->arguments[i]);
-                        fprintf(out, ")");
-                    } else {
-                        emit_expression(out, &dbg->arguments[i]);
-                    }
-                }
-            }
-            fprintf(out, ");\n");
-            
-            /* Free temporary names */
-            for (int i = 0; i < dbg->argument_count; i++) {
-                if (tmp_names[i] != NULL) {
-                    xfree(tmp_names[i]);
-                }
+        case IR_TERM_RETURN:
+            print_indent(out, 1);
+            output_sink_append(out, "return");
+            if (block->term.value >= 0) {
+                output_sink_append_char(out, ' ');
+                emit_ir_value(out, block->term.value);
             }
-            xfree(tmp_names);
+            output_sink_append(out, ";\n");
+            break;
+        default:
+            print_indent(out, 1);
+            output_sink_append(out, "__builtin_trap();\n");
             break;
-        }
     }
 }
 
-/* Emit function forward declarations */
-static void emit_function_declarations(FILE* out, ASTProgram* program) {
-    for (int i = 0; i < program->function_count; i++) {
-        ASTFunctionDef* func = &program->functions[i];
-        if (program->import_count > 0 && !func->allocated_name) {
+/* Helper: Emit "<return type> <name>(<params>)" for an IR function */
+static void emit_ir_signature(OutputSink* out, const IrFunction* func) {
+    char* mangled_name = mangle_function_name(func->name);
+    emit_typed_name(out, func->return_type, mangled_name);
+    xfree(mangled_name);
+    output_sink_append_char(out, '(');
+    if (func->param_count == 0) {
+        output_sink_append(out, "void");
+    }
+    for (int i = 0; i < func->param_count; i++) {
+        const IrParamOrigin* origin = &func->param_origins[i];
+        if (origin->struct_index >= 0) {
+            /* A struct parameter is passed by reference, read-only */
+            if (origin->field > 0) continue;
+            if (i > 0) output_sink_append(out, ", ");
+            output_sink_append(out, "const struct ");
+            output_sink_append(out, struct_c_name(&g_ir_module->structs[origin->struct_index]));
+            output_sink_append(out, "* __s");
+            output_sink_append_int(out, i);
             continue;
         }
-        /* Use allocated name if available (for dead code elimination in multi-module),
-         * otherwise use the function's original name (for single-file programs) */
-        const char* func_name = func->allocated_name ? func->allocated_name : func->name;
-        char* mangled_name = mangle_function_name(func_name);
-        
-        fprintf(out, "%s %s(",
-                casm_type_to_c_type(func->return_type.type),
-                mangled_name);
-        
-        if (func->parameter_count == 0) {
-            fprintf(out, "void");
-        } else {
-            for (int j = 0; j < func->parameter_count; j++) {
-                if (j > 0) fprintf(out, ", ");
-                fprintf(out, "%s %s",
-                        casm_type_to_c_type(func->parameters[j].type.type),
-                        func->parameters[j].name);
-            }
-        }
-        
-        fprintf(out, ");\n");
-        xfree(mangled_name);
+        if (i > 0) output_sink_append(out, ", ");
+        output_sink_append(out, casm_type_to_c_type(func->param_types[i]));
+        output_sink_append(out, " __p");
+        output_sink_append_int(out, i);
     }
-    fprintf(out, "\n");
+    output_sink_append_char(out, ')');
 }
 
-/* Emit function definitions */
-static void emit_function_definitions(FILE* out, ASTProgram* program) {
-    int emit_total = 0;
-    for (int i = 0; i < program->function_count; i++) {
-        if (program->import_count > 0 && !program->functions[i].allocated_name) {
-            continue;
+/* Helper: Emit "[N] = {a, b, ...}" for an IR array */
+static void emit_ir_array_suffix(OutputSink* out, const IrArray* array) {
+    output_sink_append_char(out, '[');
+    output_sink_append_int(out, array->length);
+    output_sink_append(out, "] = {");
+    if (array->init_count == 0) {
+        output_sink_append_char(out, '0');
+    }
+    for (int i = 0; i < array->init_count; i++) {
+        if (i > 0) output_sink_append(out, ", ");
+        emit_int_literal(out, array->init[i]);
+    }
+    output_sink_append_char(out, '}');
+}
+
+/* Emit one IR function: declarations of its values, phi copies and
+ * arrays, then its blocks in order */
+static void emit_ir_function(OutputSink* out, const IrFunction* func) {
+    g_ir_func = func;
+    g_ir_uses = xmalloc((func->value_count + 1) * sizeof(int));
+    memset(g_ir_uses, 0, (func->value_count + 1) * sizeof(int));
+    for (int b = 0; b < func->block_count; b++) {
+        const IrBlock* block = &func->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            const IrInstr* instr = &func->values[block->instrs[i]];
+            for (int a = 0; a < instr->arg_count; a++) {
+                g_ir_uses[instr->args[a]]++;
+            }
+        }
+        if ((block->term.kind == IR_TERM_BRANCH || block->term.kind == IR_TERM_RETURN) &&
+            block->term.value >= 0) {
+            g_ir_uses[block->term.value]++;
         }
-        emit_total++;
     }
 
-    int emit_count = 0;
-    for (int i = 0; i < program->function_count; i++) {
-        ASTFunctionDef* func = &program->functions[i];
-        if (program->import_count > 0 && !func->allocated_name) {
-            continue;
+    emit_ir_signature(out, func);
+    output_sink_append(out, " {\n");
+
+    /* Blocks something jumps to get a label */
+    int* labeled = xmalloc(func->block_count * sizeof(int));
+    memset(labeled, 0, func->block_count * sizeof(int));
+    for (int b = 0; b < func->block_count; b++) {
+        const IrBlock* block = &func->blocks[b];
+        if (block->term.kind == IR_TERM_BRANCH) {
+            /* As emit_ir_block lays the branch out */
+            int invert = block->term.targets[0] == b + 1;
+            labeled[block->term.targets[invert ? 1 : 0]] = 1;
+            int other = block->term.targets[invert ? 0 : 1];
+            if (other != b + 1) labeled[other] = 1;
+        } else if (block->term.kind == IR_TERM_JUMP && block->term.targets[0] != b + 1) {
+            labeled[block->term.targets[0]] = 1;
         }
-         
-         /* Use allocated name if available (for dead code elimination in multi-module),
-          * otherwise use the function's original name (for single-file programs) */
-         const char* func_name = func->allocated_name ? func->allocated_name : func->name;
-         
-         /* Set context for call resolution */
-         g_current_function = func;
-         
-         /* Use allocated/original name for code generation */
-         char* mangled_name = mangle_function_name(func_name);
-        
-        fprintf(out, "%s %s(",
-                casm_type_to_c_type(func->return_type.type),
-                mangled_name);
-        
-        if (func->parameter_count == 0) {
-            fprintf(out, "void");
-        } else {
-            for (int j = 0; j < func->parameter_count; j++) {
-                if (j > 0) fprintf(out, ", ");
-                fprintf(out, "%s %s",
-                        casm_type_to_c_type(func->parameters[j].type.type),
-                        func->parameters[j].name);
+    }
+    for (int b = 0; b < func->block_count; b++) {
+        const IrBlock* block = &func->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            int value = block->instrs[i];
+            const IrInstr* instr = &func->values[value];
+            if (instr->type == TYPE_VOID || g_ir_uses[value] == 0 || ir_is_struct_param(instr)) continue;
+            print_indent(out, 1);
+            emit_typed_name(out, instr->type, "__v");
+            output_sink_append_int(out, value);
+            output_sink_append(out, ";\n");
+            if (instr->op == IR_PHI) {
+                print_indent(out, 1);
+                emit_typed_name(out, instr->type, "__phi");
+                output_sink_append_int(out, value);
+                output_sink_append(out, ";\n");
             }
         }
-        
-        fprintf(out, ") {\n");
-        emit_block(out, &func->body, 1);
-        fprintf(out, "}\n");
+    }
+    for (int i = 0; i < func->array_count; i++) {
+        const IrArray* array = &func->arrays[i];
+        print_indent(out, 1);
+        emit_typed_name(out, array->elem_type, "__a");
+        output_sink_append_int(out, i);
+        output_sink_append_char(out, '[');
+        output_sink_append_int(out, array->length);
+        output_sink_append(out, "];\n");
+        if (array->init_count > 0) {
+            print_indent(out, 1);
+            output_sink_append(out, "static const ");
+            emit_typed_name(out, array->elem_type, "__a");
+            output_sink_append_int(out, i);
+            output_sink_append(out, "_init");
+            emit_ir_array_suffix(out, array);
+            output_sink_append(out, ";\n");
+        }
+    }
+
+    /* Buffered dbg() output is written out when the program exits */
+    if (g_program_has_dbg && strcmp(func->name, "main") == 0) {
+        print_indent(out, 1);
+        output_sink_append(out, "atexit(casm_dbg_flush);\n");
+    }
+
+    for (int b = 0; b < func->block_count; b++) {
+        emit_ir_block(out, b, labeled);
+    }
+    xfree(labeled);
+
+    output_sink_append(out, "}\n");
+    xfree(g_ir_uses);
+    g_ir_uses = NULL;
+    g_ir_func = NULL;
+}
 
-        emit_count++;
-        if (emit_count < emit_total) {
-            fprintf(out, "\n");
+/* Helper: Check if any instruction of a module refers to an array operand */
+static int ir_module_uses_array(const IrModule* module, long long imm) {
+    for (int f = 0; f < module->function_count; f++) {
+        const IrFunction* func = module->functions[f];
+        for (int b = 0; b < func->block_count; b++) {
+            const IrBlock* block = &func->blocks[b];
+            for (int i = 0; i < block->instr_count; i++) {
+                const IrInstr* instr = &func->values[block->instrs[i]];
+                if ((instr->op == IR_LOAD || instr->op == IR_STORE) && instr->imm == imm) return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Helper: Note which runtimes the instructions of a module need */
+static void scan_ir_module(const IrModule* module) {
+    g_program_has_dbg = 0;
+    g_program_has_arrays = 0;
+    g_program_has_bit_intrinsics = 0;
+    g_program_has_division = 0;
+    for (int f = 0; f < module->function_count; f++) {
+        const IrFunction* func = module->functions[f];
+        for (int b = 0; b < func->block_count; b++) {
+            const IrBlock* block = &func->blocks[b];
+            for (int i = 0; i < block->instr_count; i++) {
+                const IrInstr* instr = &func->values[block->instrs[i]];
+                switch (instr->op) {
+                    case IR_DBG:
+                        g_program_has_dbg = 1;
+                        break;
+                    case IR_BOUNDS_CHECK:
+                    case IR_ARRAY_INIT:
+                        g_program_has_arrays = 1;
+                        break;
+                    case IR_ROTL:
+                    case IR_ROTR:
+                    case IR_POPCOUNT:
+                    case IR_CLZ:
+                    case IR_CTZ:
+                        g_program_has_bit_intrinsics = 1;
+                        break;
+                    case IR_DIV:
+                    case IR_MOD:
+                        if (ir_division_may_trap(func, instr) ||
+                            (instr->op == IR_DIV && ir_division_may_overflow(func, instr))) {
+                            g_program_has_division = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
         }
-        
-        xfree(mangled_name);
-        
-        /* Clear context */
-        g_current_function = NULL;
     }
 }
 
-/* Main code generation function */
-CodegenResult codegen_program(ASTProgram* program, FILE* output, const char* source_filename) {
+CodegenResult codegen_ir_program_to_sink(ASTProgram* program, OutputSink* output,
+                                         const char* source_filename,
+                                         const CodegenOptions* options) {
+    CodegenResult result;
+    result.success = 0;
     if (!program || !output) {
-        CodegenResult result;
-        result.success = 0;
-        result.error_msg = "Invalid input to codegen_program";
+        result.error_msg = "Invalid input to codegen_ir_program_to_sink";
         return result;
     }
-    
-    /* Store references for use in code emission */
+
+    if (options) {
+        g_options = *options;
+    } else {
+        g_options.tail_calls = 0;
+    }
+    IrModule* module = ir_lower_program(program);
+    if (g_options.tail_calls) {
+        ir_eliminate_self_tail_calls(module);
+    }
+    char* ir_error = NULL;
+    if (!ir_verify_module(module, &ir_error)) {
+        xfree(ir_error);
+        ir_module_free(module);
+        result.error_msg = "invalid IR";
+        return result;
+    }
+
     g_source_filename = source_filename ? source_filename : "unknown.csm";
-    g_current_program = program;
-    
-    /* Emit includes */
-    fprintf(output, "#include <stdint.h>\n");
-    fprintf(output, "#include <stdbool.h>\n");
-    fprintf(output, "#include <stdio.h>\n");
-    fprintf(output, "\n");
-    
-    /* Emit function declarations */
-    emit_function_declarations(output, program);
-    
-    /* Emit function definitions */
-    emit_function_definitions(output, program);
-    
-    /* Clear global reference */
-    g_current_program = NULL;
-    
-    CodegenResult result;
+    g_ir_module = module;
+    scan_ir_module(module);
+
+    output_sink_append(output, "#include <stdint.h>\n");
+    output_sink_append(output, "#include <stdbool.h>\n");
+    output_sink_append(output, "#include <stdio.h>\n");
+    if (g_program_has_dbg || g_program_has_arrays || g_program_has_division) {
+        output_sink_append(output, "#include <stdlib.h>\n");
+        output_sink_append(output, "#include <string.h>\n");
+    }
+    output_sink_append(output, "\n");
+
+    if (g_program_has_dbg) {
+        output_sink_append(output, g_dbg_runtime);
+    }
+    if (g_program_has_arrays) {
+        emit_array_runtime(output);
+    }
+    if (g_program_has_division) {
+        emit_fail_runtime(output, g_div_fail_head, g_div_runtime);
+    }
+    if (g_program_has_bit_intrinsics) {
+        output_sink_append(output, g_bits_runtime);
+    }
+    emit_structs(output, module->structs, module->struct_count);
+
+    /* Scalar globals are one-element arrays in the IR; folded read-only
+     * ones have no uses left and are skipped */
+    int emitted = 0;
+    for (int i = 0; i < module->global_count; i++) {
+        const IrArray* global = &module->globals[i];
+        if (!ir_module_uses_array(module, IR_GLOBAL_ARRAY(i))) continue;
+        emitted++;
+        output_sink_append(output, "static ");
+        emit_typed_name(output, global->elem_type, global->name);
+        emit_ir_array_suffix(output, global);
+        output_sink_append(output, ";\n");
+    }
+    if (emitted > 0) {
+        output_sink_append(output, "\n");
+    }
+
+    for (int i = 0; i < module->function_count; i++) {
+        emit_ir_signature(output, module->functions[i]);
+        output_sink_append(output, ";\n");
+    }
+    output_sink_append(output, "\n");
+
+    for (int i = 0; i < module->function_count; i++) {
+        if (i > 0) output_sink_append(output, "\n");
+        emit_ir_function(output, module->functions[i]);
+    }
+
+    g_ir_module = NULL;
+    ir_module_free(module);
     result.success = 1;
     result.error_msg = NULL;
     return result;
@@ -1,9 +1,9 @@
 #ifndef CODEGEN_H
 #define CODEGEN_H
 
-#include <stdio.h>
 #include "ast.h"
 #include "types.h"
+#include "output_sink.h"
 
 /* Result of code generation */
 typedef struct {
@@ -11,7 +11,15 @@ typedef struct {
     char* error_msg;    /* Error message if failed (NULL if success) */
 } CodegenResult;
 
-/* Generate C code from AST and write to file */
-CodegenResult codegen_program(ASTProgram* program, FILE* output, const char* source_filename);
+/* Options for C code generation */
+typedef struct {
+    int tail_calls;     /* Turn self tail calls into jumps (-O1 and up) */
+} CodegenOptions;
+
+/* Generate C for an analyzed, name-allocated program via the SSA IR.
+ * Appends to the sink's contents. */
+CodegenResult codegen_ir_program_to_sink(ASTProgram* program, OutputSink* output,
+                                         const char* source_filename,
+                                         const CodegenOptions* options);
 
 #endif /* CODEGEN_H */
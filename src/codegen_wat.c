@@ -2,24 +2,38 @@
 #include <stdlib.h>
 #include <string.h>
 #include "codegen_wat.h"
+#include "ir.h"
+#include "types.h"
 #include "utils.h"
+#include "wat_instr.h"
+#include "wat_strength.h"
 
-/* Global reference to the program being compiled (for function call resolution) */
-static ASTProgram* g_current_program = NULL;
+/* WebAssembly text from the SSA IR.
+ *
+ * Every IR value that is used becomes a local $vN set once where its
+ * instruction is, except constants and parameters, which are pushed where
+ * they are used, and pure single-use values, which are computed right at
+ * their use inside the same block. Narrow values are kept in canonical
+ * form in i32: sign-extended for signed types, zero-extended for unsigned
+ * ones, 0 or 1 for bool.
+ *
+ * Control flow is rebuilt from the dominator tree (Ramsey, "Beyond
+ * Relooper", ICFP 2022): a block with several forward predecessors gets a
+ * `block $bN` ending right before it, so jumps to it are `br $bN`, and a
+ * loop header is wrapped in `loop $lN`, so back edges are `br $lN`. Other
+ * blocks are placed inline at their only forward edge. Phi arguments are
+ * pushed on the stack on each edge and popped into the phis' locals,
+ * which makes the copies for an edge parallel. */
 
-/* Global reference to the source filename (for debug output) */
+/* Program being compiled (scalar globals) and source filename (debug output) */
+static ASTProgram* g_current_program = NULL;
 static const char* g_source_filename = NULL;
 
-/* Global reference to the current function being compiled (for module context in calls) */
-static ASTFunctionDef* g_current_function = NULL;
-
 /* Debug format string storage for WAT data section */
 typedef struct {
     char* format_string;  /* The format string with % placeholders */
     int offset;           /* Offset in data section */
     int length;           /* Length of format string */
-    CasmType* arg_types;  /* Array of types for each % placeholder */
-    int arg_count;        /* Number of arguments */
 } DebugFormatString;
 
 /* Global array to collect debug format strings during code generation */
@@ -30,39 +44,91 @@ static int g_debug_format_capacity = 0;
 /* Track current data offset for packing format strings */
 static int g_data_offset = 0;
 
-/* Helper: Map CASM type to WAT type string */
-static const char* casm_type_to_wat_type(CasmType type) {
+/* Options for the module being generated */
+static CodegenWatOptions g_options;
+
+/* Size of the linear-memory dbg record buffer (buffered debug ABI) */
+#define DEBUG_BUFFER_SIZE 4096
+
+/* Size of the shadow stack that holds local arrays and struct arguments */
+#define ARRAY_STACK_SIZE (1 << 20)
+
+/* Linear-memory layout of arrays: module-level arrays from offset 0, then
+ * the shadow stack for function frames, which grows down from
+ * g_stack_top. Both are 0 when no function needs a frame. */
+static int* g_global_offsets = NULL;
+static int g_stack_base = 0;
+static int g_stack_top = 0;
+
+/* Set when a local array is zero-filled through $__casm_zero */
+static int g_uses_zero_fill = 0;
+
+/* Set when a bounds check traps through $__casm_bounds_fail */
+static int g_uses_bounds_fail = 0;
+
+/* State for the function being lowered */
+static const IrModule* g_ir_module = NULL;
+static const IrFunction* g_ir_func = NULL;
+static int* g_uses = NULL;              /* Per value: operands and terminators reading it */
+static int* g_inlined = NULL;           /* Per value: computed at its use, not in a local */
+static IrRanges* g_ranges = NULL;       /* Value ranges (NULL = nothing proven) */
+
+/* Frame of the function being lowered, at $__fp: its local arrays, then
+ * the area struct arguments of a call are built in */
+static int* g_array_offsets = NULL;
+static int g_struct_area = 0;
+static int g_frame_size = 0;
+
+/* Control flow of the function being lowered */
+static int* g_rpo_index = NULL;         /* Block -> index in reverse postorder */
+static int* g_idom = NULL;              /* Block -> immediate dominator */
+static int* g_merge = NULL;             /* Block has several forward predecessors */
+static int* g_loop_header = NULL;       /* Block is the target of a back edge */
+static int* g_rpo = NULL;
+static int g_rpo_count = 0;
+
+/* Helper: Map CASM type to its WebAssembly value type */
+static WatValType casm_type_to_wat_type(CasmType type) {
     switch (type) {
-        case TYPE_I8:
-        case TYPE_I16:
-        case TYPE_I32:   return "i32";
-        case TYPE_I64:   return "i64";
-        case TYPE_U8:
-        case TYPE_U16:
-        case TYPE_U32:   return "i32";  /* WAT uses signed i32/i64, unsigned are same operations */
-        case TYPE_U64:   return "i64";
-        case TYPE_BOOL:  return "i32";  /* bool is i32 in WAT (0 or 1) */
-        case TYPE_VOID:  return "void";
-        default:         return "void";
+        case TYPE_I64:
+        case TYPE_U64:   return WAT_TYPE_I64;
+        default:         return WAT_TYPE_I32;  /* i8..u32 and bool are all i32 in WAT */
     }
 }
 
+/* Helper: Check whether a CASM type is a signed integer */
+static int is_signed_type(CasmType type) {
+    return type == TYPE_I8 || type == TYPE_I16 || type == TYPE_I32 || type == TYPE_I64;
+}
+
 /* Helper: Get the debug value function name for a type */
 static const char* get_debug_value_func_name(CasmType type) {
     switch (type) {
         case TYPE_I8:
         case TYPE_I16:
-        case TYPE_I32:   return "$debug_value_i32";
-        case TYPE_I64:   return "$debug_value_i64";
+        case TYPE_I32:   return "debug_value_i32";
+        case TYPE_I64:   return "debug_value_i64";
         case TYPE_U8:
         case TYPE_U16:
-        case TYPE_U32:   return "$debug_value_u32";
-        case TYPE_U64:   return "$debug_value_u64";
-        case TYPE_BOOL:  return "$debug_value_bool";
+        case TYPE_U32:   return "debug_value_u32";
+        case TYPE_U64:   return "debug_value_u64";
+        case TYPE_BOOL:  return "debug_value_bool";
         default:         return NULL;  /* Unsupported type */
     }
 }
 
+/* Helper: Get the typed placeholder letter used by the buffered debug ABI */
+static char get_debug_placeholder_kind(CasmType type) {
+    switch (type) {
+        case TYPE_BOOL:  return 'b';
+        case TYPE_U8:
+        case TYPE_U16:
+        case TYPE_U32:
+        case TYPE_U64:   return 'u';
+        default:         return 'd';
+    }
+}
+
 /* Helper: Convert qualified name to mangled name (module:name -> module_name) */
 static char* mangle_function_name(const char* qualified_name) {
     char* mangled = xstrdup(qualified_name);
@@ -74,812 +140,1504 @@ static char* mangle_function_name(const char* qualified_name) {
     return mangled;
 }
 
-/* Helper: Look up the allocated name for a function call */
-static const char* get_call_target_name(const char* call_name) {
-    if (!g_current_program || !call_name) {
-        return call_name;
-    }
-    
-    /* If we have module context, prefer functions from the same module */
-    if (g_current_function && g_current_function->module_path) {
-        for (int i = 0; i < g_current_program->function_count; i++) {
-            ASTFunctionDef* func = &g_current_program->functions[i];
-            if (func->allocated_name && 
-                strcmp(func->name, call_name) == 0 &&
-                strcmp(func->module_path, g_current_function->module_path) == 0) {
-                return func->allocated_name;
-            }
+/* Helper: Find a module function by name */
+static const IrFunction* find_ir_function(const char* name) {
+    for (int i = 0; i < g_ir_module->function_count; i++) {
+        if (strcmp(g_ir_module->functions[i]->name, name) == 0) {
+            return g_ir_module->functions[i];
         }
     }
-    
-    /* Fallback: Try to find any function with this name that has an allocated_name */
-    for (int i = 0; i < g_current_program->function_count; i++) {
-        ASTFunctionDef* func = &g_current_program->functions[i];
-        if (func->allocated_name && strcmp(func->name, call_name) == 0) {
-            return func->allocated_name;
+    return NULL;
+}
+
+/* Helper: Check if a function takes a struct, which is passed by address */
+static int has_struct_param(const IrFunction* func) {
+    for (int i = 0; i < func->param_count; i++) {
+        if (func->param_origins[i].struct_index >= 0) return 1;
+    }
+    return 0;
+}
+
+/* Helper: Check if a call's arguments args[first..] are the fields of one
+ * of the current function's own struct parameters, in order; returns
+ * that parameter's index or -1 */
+static int ir_forwarded_struct(const IrInstr* call, int first, int struct_index, int field_count) {
+    const IrInstr* head = &g_ir_func->values[call->args[first]];
+    if (head->op != IR_PARAM) return -1;
+    int base = (int)head->imm;
+    for (int f = 0; f < field_count; f++) {
+        const IrInstr* arg = &g_ir_func->values[call->args[first + f]];
+        if (arg->op != IR_PARAM || arg->imm != base + f) return -1;
+        const IrParamOrigin* origin = &g_ir_func->param_origins[arg->imm];
+        if (origin->struct_index != struct_index || origin->field != f) return -1;
+    }
+    return base;
+}
+
+/* Helper: Bytes per element of an array of the given type */
+static int array_element_size(CasmType type) {
+    switch (type) {
+        case TYPE_I8:
+        case TYPE_U8:
+        case TYPE_BOOL:  return 1;
+        case TYPE_I16:
+        case TYPE_U16:   return 2;
+        case TYPE_I64:
+        case TYPE_U64:   return 8;
+        default:         return 4;
+    }
+}
+
+/* Helper: Bytes an array occupies, rounded up to a multiple of 8 */
+static int array_size_bytes(const IrArray* array) {
+    return (array->length * array_element_size(array->elem_type) + 7) & ~7;
+}
+
+/* Helper: Check if global `index` is a scalar, which lives in a wasm global */
+static int is_scalar_global(int index) {
+    return g_current_program->globals[index].decl.array_length == 0;
+}
+
+/* Helper: Load instruction reading an element of the given type in canonical form */
+static WatOpcode element_load_op(CasmType type) {
+    switch (type) {
+        case TYPE_I8:    return WAT_OP_LOAD8_S;
+        case TYPE_U8:
+        case TYPE_BOOL:  return WAT_OP_LOAD8_U;
+        case TYPE_I16:   return WAT_OP_LOAD16_S;
+        case TYPE_U16:   return WAT_OP_LOAD16_U;
+        default:         return WAT_OP_LOAD;
+    }
+}
+
+/* Helper: Store instruction writing an element of the given type */
+static WatOpcode element_store_op(CasmType type) {
+    switch (array_element_size(type)) {
+        case 1:  return WAT_OP_STORE8;
+        case 2:  return WAT_OP_STORE16;
+        default: return WAT_OP_STORE;
+    }
+}
+
+/* Helper: Bytes of frame the struct arguments of one call are built in */
+static int call_struct_bytes(const IrFunction* func, const IrInstr* call) {
+    const IrFunction* callee = find_ir_function(call->callee);
+    if (!callee) return 0;
+    const IrFunction* saved = g_ir_func;
+    int bytes = 0;
+    g_ir_func = func;
+    for (int i = 0; i < call->arg_count && i < callee->param_count; i++) {
+        const IrParamOrigin* origin = &callee->param_origins[i];
+        if (origin->struct_index < 0 || origin->field > 0) continue;
+        const ASTStructDef* def = &g_ir_module->structs[origin->struct_index];
+        if (ir_forwarded_struct(call, i, origin->struct_index, def->field_count) < 0) {
+            bytes += (def->size + 7) & ~7;
         }
     }
-    
-    /* Not found - use the original name */
-    return call_name;
+    g_ir_func = saved;
+    return bytes;
 }
 
-/* Helper: Print indent (2 spaces per level) */
-static void print_indent(FILE* out, int indent) {
-    for (int i = 0; i < indent * 2; i++) {
-        fprintf(out, " ");
+/* Helper: Lay out a function's frame: each local array at its own offset,
+ * then room for the largest set of struct arguments one call builds (a
+ * call's arguments are dead once it returns). Fills g_array_offsets and
+ * g_struct_area; returns the frame size. */
+static int layout_frame(const IrFunction* func) {
+    int size = 0;
+    g_array_offsets = xrealloc(g_array_offsets, (func->array_count + 1) * sizeof(int));
+    for (int i = 0; i < func->array_count; i++) {
+        g_array_offsets[i] = size;
+        size += array_size_bytes(&func->arrays[i]);
+    }
+
+    int struct_bytes = 0;
+    for (int b = 0; b < func->block_count; b++) {
+        const IrBlock* block = &func->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            const IrInstr* instr = &func->values[block->instrs[i]];
+            if (instr->op != IR_CALL) continue;
+            int bytes = call_struct_bytes(func, instr);
+            if (bytes > struct_bytes) struct_bytes = bytes;
+        }
     }
+    g_struct_area = size;
+    return size + struct_bytes;
 }
 
-/* Helper: Emit binary operator as WAT instruction */
-static void emit_binop_instruction(FILE* out, BinaryOpType op, CasmType type) {
-    const char* type_prefix = (type == TYPE_I64 || type == TYPE_U64) ? "i64" : "i32";
-    
-    switch (op) {
-        case BINOP_ADD:   fprintf(out, "%s.add", type_prefix); break;
-        case BINOP_SUB:   fprintf(out, "%s.sub", type_prefix); break;
-        case BINOP_MUL:   fprintf(out, "%s.mul", type_prefix); break;
-        case BINOP_DIV:
-            if (type == TYPE_I8 || type == TYPE_I16 || type == TYPE_I32 || type == TYPE_I64) {
-                fprintf(out, "%s.div_s", type_prefix);
-            } else {
-                fprintf(out, "%s.div_u", type_prefix);
-            }
-            break;
-        case BINOP_MOD:
-            if (type == TYPE_I8 || type == TYPE_I16 || type == TYPE_I32 || type == TYPE_I64) {
-                fprintf(out, "%s.rem_s", type_prefix);
-            } else {
-                fprintf(out, "%s.rem_u", type_prefix);
-            }
-            break;
-        case BINOP_EQ:    fprintf(out, "%s.eq", type_prefix); break;
-        case BINOP_NE:    fprintf(out, "%s.ne", type_prefix); break;
-        case BINOP_LT:
-            if (type == TYPE_I8 || type == TYPE_I16 || type == TYPE_I32 || type == TYPE_I64) {
-                fprintf(out, "%s.lt_s", type_prefix);
-            } else {
-                fprintf(out, "%s.lt_u", type_prefix);
-            }
-            break;
-        case BINOP_GT:
-            if (type == TYPE_I8 || type == TYPE_I16 || type == TYPE_I32 || type == TYPE_I64) {
-                fprintf(out, "%s.gt_s", type_prefix);
-            } else {
-                fprintf(out, "%s.gt_u", type_prefix);
-            }
-            break;
-        case BINOP_LE:
-            if (type == TYPE_I8 || type == TYPE_I16 || type == TYPE_I32 || type == TYPE_I64) {
-                fprintf(out, "%s.le_s", type_prefix);
-            } else {
-                fprintf(out, "%s.le_u", type_prefix);
-            }
-            break;
-        case BINOP_GE:
-            if (type == TYPE_I8 || type == TYPE_I16 || type == TYPE_I32 || type == TYPE_I64) {
-                fprintf(out, "%s.ge_s", type_prefix);
-            } else {
-                fprintf(out, "%s.ge_u", type_prefix);
-            }
-            break;
-        case BINOP_AND:   fprintf(out, "i32.and"); break;
-        case BINOP_OR:    fprintf(out, "i32.or"); break;
-        case BINOP_ASSIGN: break;  /* Should not reach here */
+/* Helper: Pop the current frame off the shadow stack (before leaving the function) */
+static void emit_frame_release(WatFunction* fn) {
+    if (g_frame_size == 0) return;
+    wat_emit_named(fn, WAT_OP_LOCAL_GET, "__fp");
+    wat_emit_const(fn, WAT_TYPE_I32, g_frame_size);
+    wat_emit(fn, WAT_OP_ADD, WAT_TYPE_I32);
+    wat_emit_named(fn, WAT_OP_GLOBAL_SET, "__sp");
+}
+
+/* Helper: Push the function's frame, trapping if the shadow stack is exhausted */
+static void emit_frame_reserve(WatFunction* fn) {
+    if (g_frame_size == 0) return;
+    wat_function_add_local(fn, "__fp", WAT_TYPE_I32);
+    wat_emit_named(fn, WAT_OP_GLOBAL_GET, "__sp");
+    wat_emit_const(fn, WAT_TYPE_I32, g_frame_size);
+    wat_emit(fn, WAT_OP_SUB, WAT_TYPE_I32);
+    wat_emit_named(fn, WAT_OP_LOCAL_TEE, "__fp");
+    wat_emit_named(fn, WAT_OP_GLOBAL_SET, "__sp");
+    wat_emit_named(fn, WAT_OP_LOCAL_GET, "__fp");
+    wat_emit_const(fn, WAT_TYPE_I32, g_stack_base);
+    wat_emit(fn, WAT_OP_LT_S, WAT_TYPE_I32);
+    wat_emit(fn, WAT_OP_IF, WAT_TYPE_I32);
+    wat_emit(fn, WAT_OP_UNREACHABLE, WAT_TYPE_I32);
+    wat_emit(fn, WAT_OP_END, WAT_TYPE_I32);
+}
+
+/* Helper: Zero `bytes` (a multiple of 8) of the frame from `offset` */
+static void emit_frame_zero(WatFunction* fn, int offset, int bytes) {
+    if (bytes > 64) {
+        wat_emit_named(fn, WAT_OP_LOCAL_GET, "__fp");
+        wat_emit_const(fn, WAT_TYPE_I32, offset);
+        wat_emit(fn, WAT_OP_ADD, WAT_TYPE_I32);
+        wat_emit_const(fn, WAT_TYPE_I32, bytes);
+        wat_emit_named(fn, WAT_OP_CALL, "__casm_zero");
+        g_uses_zero_fill = 1;
+        return;
+    }
+    for (int at = 0; at < bytes; at += 8) {
+        wat_emit_named(fn, WAT_OP_LOCAL_GET, "__fp");
+        wat_emit_const(fn, WAT_TYPE_I64, 0);
+        wat_emit_store(fn, WAT_TYPE_I64, offset + at);
+    }
+}
+
+/* Helper: Reset a local array to its initializer followed by zeros. The
+ * zero fill skips the 8-byte words the initializer covers, so every
+ * initializer element below the fill is stored even if it is zero. */
+static void emit_array_init(WatFunction* fn, int index) {
+    const IrArray* array = &g_ir_func->arrays[index];
+    CasmType type = array->elem_type;
+    int size = array_element_size(type);
+    int bytes = array_size_bytes(array);
+    int fill_start = (array->init_count * size) & ~7;
+    int offset = g_array_offsets[index];
+
+    emit_frame_zero(fn, offset + fill_start, bytes - fill_start);
+
+    for (int i = 0; i < array->init_count; i++) {
+        long long value = array->init[i];
+        if (i * size >= fill_start && value == 0) continue;
+        wat_emit_named(fn, WAT_OP_LOCAL_GET, "__fp");
+        wat_emit_const(fn, casm_type_to_wat_type(type), value);
+        wat_emit_memory(fn, element_store_op(type), casm_type_to_wat_type(type),
+                        offset + (long long)i * size);
     }
 }
 
-/* Forward declarations */
-static void emit_expression(FILE* out, ASTExpression* expr, int indent);
-static void emit_statement(FILE* out, ASTStatement* stmt, int indent);
+/* Helper: Register a dbg statement's format string and return its offset */
+static int register_debug_format(const IrInstr* instr) {
+    const ASTDbgStmt* dbg = instr->dbg;
 
-/* Helper: Register a debug format string and return its offset */
-static int register_debug_format(ASTDbgStmt* dbg) {
     /* Ensure we have capacity */
     if (g_debug_format_count >= g_debug_format_capacity) {
         g_debug_format_capacity = g_debug_format_capacity == 0 ? 10 : g_debug_format_capacity * 2;
         g_debug_formats = xrealloc(g_debug_formats, g_debug_format_capacity * sizeof(DebugFormatString));
     }
-    
-     /* Build format string: "file:line:col: arg1 = %, arg2 = %, ..." */
-     char format_buf[1024];
-     int len = snprintf(format_buf, sizeof(format_buf), "%s:%d:%d: ",
-                        g_source_filename ? g_source_filename : "unknown",
-                        dbg->location.line, dbg->location.column);
-    
-     /* Add argument names with % placeholders
-         Note: We need to escape any % in arg_name by doubling it (%% in WAT format string)
-         to distinguish them from the % placeholder */
-      for (int i = 0; i < dbg->argument_count; i++) {
-          if (i > 0) len += snprintf(format_buf + len, sizeof(format_buf) - len, ", ");
-          
-          const char* arg_name = dbg->arg_names[i] && strlen(dbg->arg_names[i]) > 0 
-                               ? dbg->arg_names[i] 
-                               : "arg";
-          
-          /* Copy arg_name to format_buf, escaping any % characters */
-          for (const char* p = arg_name; *p; p++) {
-              if (*p == '%') {
-                  format_buf[len++] = '%';
-                  format_buf[len++] = '%';
-              } else {
-                  format_buf[len++] = *p;
-              }
-          }
-          
-          /* Add the " = %%" suffix (where %% is the placeholder) */
-          len += snprintf(format_buf + len, sizeof(format_buf) - len, " = %%");
-      }
-     
-     /* Calculate actual string length (snprintf with %% counts as 2 but produces 1 in output) */
-     len = strlen(format_buf);
-
-    
-    /* Store the format string */
+
+    /* Build format string: "file:line:col: arg1 = %, arg2 = %, ..." */
+    char format_buf[1024];
+    int len = snprintf(format_buf, sizeof(format_buf), "%s:%d:%d: ",
+                       g_source_filename ? g_source_filename : "unknown",
+                       dbg->location.line, dbg->location.column);
+
+    /* Add argument names with % placeholders. A % in an argument name is
+     * doubled (%% in the WAT format string) to tell it from a placeholder. */
+    for (int i = 0; i < instr->arg_count; i++) {
+        if (i > 0) len += snprintf(format_buf + len, sizeof(format_buf) - len, ", ");
+
+        const char* arg_name = dbg->arg_names[i] && strlen(dbg->arg_names[i]) > 0
+                             ? dbg->arg_names[i]
+                             : "arg";
+
+        for (const char* p = arg_name; *p; p++) {
+            if (*p == '%') {
+                format_buf[len++] = '%';
+                format_buf[len++] = '%';
+            } else {
+                format_buf[len++] = *p;
+            }
+        }
+
+        len += snprintf(format_buf + len, sizeof(format_buf) - len, " = %%");
+
+        /* The buffered ABI carries no per-value host call, so the
+         * placeholder itself says how to print the value */
+        if (g_options.debug_abi == WAT_DEBUG_ABI_BUFFERED) {
+            len += snprintf(format_buf + len, sizeof(format_buf) - len, "%c",
+                            get_debug_placeholder_kind(g_ir_func->values[instr->args[i]].type));
+        }
+    }
+    len = strlen(format_buf);
+
     DebugFormatString* fmt = &g_debug_formats[g_debug_format_count];
     fmt->format_string = xstrdup(format_buf);
     fmt->length = len;
     fmt->offset = g_data_offset;
-    fmt->arg_types = xmalloc(dbg->argument_count * sizeof(CasmType));
-    fmt->arg_count = dbg->argument_count;
-    
-    /* Copy argument types */
-    for (int i = 0; i < dbg->argument_count; i++) {
-        fmt->arg_types[i] = dbg->arguments[i].resolved_type;
-    }
-    
+
     int result_offset = g_data_offset;
     g_data_offset += len;
     g_debug_format_count++;
-    
+
     return result_offset;
 }
 
-/* Emit expression to stack - this should always result in value(s) on stack */
-static void emit_expression(FILE* out, ASTExpression* expr, int indent) {
-    if (!expr) return;
-    
-    switch (expr->type) {
-        case EXPR_LITERAL:
-            print_indent(out, indent);
-            if (expr->as.literal.type == LITERAL_INT) {
-                fprintf(out, "i32.const %ld", expr->as.literal.value.int_value);
-            } else {
-                fprintf(out, "i32.const %d", expr->as.literal.value.bool_value ? 1 : 0);
-            }
-            break;
-            
-        case EXPR_VARIABLE:
-            print_indent(out, indent);
-            fprintf(out, "local.get $%s", expr->as.variable.name);
-            break;
-            
-        case EXPR_BINARY_OP: {
-            ASTBinaryOp* binop = &expr->as.binary_op;
-            
-            if (binop->op == BINOP_ASSIGN) {
-                /* Assignment: evaluate RHS, store to LHS, and leave value on stack
-                   Use local.tee instead of local.set so the assigned value remains
-                   on the stack for use in expressions like dbg(x = 5) */
-                emit_expression(out, binop->right, indent);
-                fprintf(out, "\n");
-                print_indent(out, indent);
-                fprintf(out, "local.tee $%s", binop->left->as.variable.name);
-            } else {
-                /* Regular binary operation */
-                emit_expression(out, binop->left, indent);
-                fprintf(out, "\n");
-                emit_expression(out, binop->right, indent);
-                fprintf(out, "\n");
-                print_indent(out, indent);
-                emit_binop_instruction(out, binop->op, TYPE_I32);
+/* Helper: Convert the value on top of the stack from one CASM type to
+ * another's wasm type */
+static void emit_conversion(WatFunction* fn, CasmType from, CasmType to) {
+    WatValType from_wat = casm_type_to_wat_type(from);
+    WatValType to_wat = casm_type_to_wat_type(to);
+
+    if (from_wat == to_wat) return;
+
+    if (to_wat == WAT_TYPE_I64) {
+        wat_emit(fn, is_signed_type(from) ? WAT_OP_I64_EXTEND_I32_S : WAT_OP_I64_EXTEND_I32_U,
+                 WAT_TYPE_I64);
+    } else {
+        wat_emit(fn, WAT_OP_I32_WRAP_I64, WAT_TYPE_I32);
+    }
+}
+
+/* Helper: Check if every value of one type is also a value of another */
+static int type_fits_type(CasmType from, CasmType to) {
+    if (from == to) return 1;
+    if (from == TYPE_BOOL || to == TYPE_BOOL) return 0;
+    int from_bits = get_type_size_bits(from);
+    int to_bits = get_type_size_bits(to);
+    if (is_signed_type(from)) return is_signed_type(to) && from_bits <= to_bits;
+    return is_signed_type(to) ? from_bits < to_bits : from_bits <= to_bits;
+}
+
+/* Helper: Wrap the i32 on top of the stack to a sub-32-bit type, the
+ * conversion C applies when storing to i8/i16/u8/u16 */
+static void emit_narrow_wrap(WatFunction* fn, CasmType type) {
+    int bits = get_type_size_bits(type);
+    if (is_signed_type(type)) {
+        wat_emit_const(fn, WAT_TYPE_I32, 32 - bits);
+        wat_emit(fn, WAT_OP_SHL, WAT_TYPE_I32);
+        wat_emit_const(fn, WAT_TYPE_I32, 32 - bits);
+        wat_emit(fn, WAT_OP_SHR_S, WAT_TYPE_I32);
+    } else {
+        wat_emit_const(fn, WAT_TYPE_I32, (1L << bits) - 1);
+        wat_emit(fn, WAT_OP_AND, WAT_TYPE_I32);
+    }
+}
+
+/* Helper: Zero-extend a canonical sub-32-bit value on top of the stack */
+static void emit_zero_extend(WatFunction* fn, CasmType type) {
+    int bits = get_type_size_bits(type);
+    if (bits < 32 && is_signed_type(type)) {
+        wat_emit_const(fn, WAT_TYPE_I32, (1L << bits) - 1);
+        wat_emit(fn, WAT_OP_AND, WAT_TYPE_I32);
+    }
+}
+
+/* Helper: Name of the local holding value `value` */
+static void value_local_name(char* buf, size_t size, int value) {
+    snprintf(buf, size, "v%d", value);
+}
+
+/* Forward declaration */
+static void emit_operation(WatFunction* fn, int value);
+
+/* Push a value: a constant or parameter directly, an inlined value by
+ * computing it, anything else from its local. A struct field parameter
+ * is read through its struct's address. */
+static void emit_value(WatFunction* fn, int value) {
+    const IrInstr* instr = &g_ir_func->values[value];
+    char name[32];
+    switch (instr->op) {
+        case IR_CONST:
+            wat_emit_const(fn, casm_type_to_wat_type(instr->type), instr->imm);
+            return;
+        case IR_UNDEF:
+            wat_emit_const(fn, casm_type_to_wat_type(instr->type), 0);
+            return;
+        case IR_PARAM: {
+            const IrParamOrigin* origin = &g_ir_func->param_origins[instr->imm];
+            if (origin->struct_index < 0) {
+                snprintf(name, sizeof(name), "p%lld", instr->imm);
+                wat_emit_named(fn, WAT_OP_LOCAL_GET, name);
+                return;
             }
-            break;
+            const ASTStructDef* def = &g_ir_module->structs[origin->struct_index];
+            snprintf(name, sizeof(name), "s%lld", instr->imm - origin->field);
+            wat_emit_named(fn, WAT_OP_LOCAL_GET, name);
+            wat_emit_memory(fn, element_load_op(instr->type), casm_type_to_wat_type(instr->type),
+                            def->fields[origin->field].offset);
+            return;
         }
-        
-        case EXPR_UNARY_OP: {
-            ASTUnaryOp* unop = &expr->as.unary_op;
-            
-            if (unop->op == UNOP_NEG) {
-                /* Negation: compute 0 - operand
-                   Push 0 first, then operand, then subtract */
-                print_indent(out, indent);
-                fprintf(out, "i32.const 0\n");
-                emit_expression(out, unop->operand, indent);
-                fprintf(out, "\n");
-                print_indent(out, indent);
-                fprintf(out, "i32.sub");
-            } else if (unop->op == UNOP_NOT) {
-                /* Logical NOT */
-                emit_expression(out, unop->operand, indent);
-                fprintf(out, "\n");
-                print_indent(out, indent);
-                fprintf(out, "i32.eqz");
-            }
+        default:
             break;
+    }
+    if (g_inlined[value]) {
+        emit_operation(fn, value);
+        return;
+    }
+    value_local_name(name, sizeof(name), value);
+    wat_emit_named(fn, WAT_OP_LOCAL_GET, name);
+}
+
+/* Helper: Emit the dynamic part of an element's address and return the
+ * static part, to be used as the offset of the load or store. Constant
+ * indexes go entirely into the offset. */
+static long long emit_element_address(WatFunction* fn, long long array_ref, int index) {
+    int slot = IR_ARRAY_INDEX(array_ref);
+    const IrArray* array = ir_array_ref(g_ir_module, g_ir_func, array_ref);
+    int size = array_element_size(array->elem_type);
+    long long base = IR_IS_GLOBAL_ARRAY(array_ref) ? g_global_offsets[slot] : g_array_offsets[slot];
+    const IrInstr* index_instr = &g_ir_func->values[index];
+
+    if (index_instr->op == IR_CONST) {
+        if (IR_IS_GLOBAL_ARRAY(array_ref)) {
+            wat_emit_const(fn, WAT_TYPE_I32, 0);
+        } else {
+            wat_emit_named(fn, WAT_OP_LOCAL_GET, "__fp");
+        }
+        return base + index_instr->imm * size;
+    }
+
+    emit_value(fn, index);
+    wat_emit(fn, WAT_OP_I32_WRAP_I64, WAT_TYPE_I32);
+    if (size > 1) {
+        wat_emit_const(fn, WAT_TYPE_I32, size);
+        wat_emit(fn, WAT_OP_MUL, WAT_TYPE_I32);
+    }
+    if (!IR_IS_GLOBAL_ARRAY(array_ref)) {
+        wat_emit_named(fn, WAT_OP_LOCAL_GET, "__fp");
+        wat_emit(fn, WAT_OP_ADD, WAT_TYPE_I32);
+    }
+    return base;
+}
+
+/* Helper: Emit call arguments in order. The fields passed for a struct
+ * parameter are stored into the frame's struct area and its address is
+ * passed instead, or the caller's own address when it forwards a struct
+ * parameter unchanged. */
+static void emit_call_arguments(WatFunction* fn, const IrInstr* call) {
+    const IrFunction* callee = find_ir_function(call->callee);
+    int area = g_struct_area;
+    char name[32];
+    for (int i = 0; i < call->arg_count; i++) {
+        const IrParamOrigin* origin = callee && i < callee->param_count ? &callee->param_origins[i] : NULL;
+        if (!origin || origin->struct_index < 0) {
+            emit_value(fn, call->args[i]);
+            continue;
         }
-        
-        case EXPR_FUNCTION_CALL: {
-            ASTFunctionCall* call = &expr->as.function_call;
-            
-            /* Emit arguments in order */
-            for (int i = 0; i < call->argument_count; i++) {
-                if (i > 0) fprintf(out, "\n");
-                emit_expression(out, &call->arguments[i], indent);
+        const ASTStructDef* def = &g_ir_module->structs[origin->struct_index];
+        int forwarded = ir_forwarded_struct(call, i, origin->struct_index, def->field_count);
+        if (forwarded >= 0) {
+            snprintf(name, sizeof(name), "s%d", forwarded);
+            wat_emit_named(fn, WAT_OP_LOCAL_GET, name);
+        } else {
+            for (int f = 0; f < def->field_count; f++) {
+                CasmType type = def->fields[f].type.type;
+                wat_emit_named(fn, WAT_OP_LOCAL_GET, "__fp");
+                emit_value(fn, call->args[i + f]);
+                wat_emit_memory(fn, element_store_op(type), casm_type_to_wat_type(type),
+                                area + def->fields[f].offset);
             }
-            if (call->argument_count > 0) {
-                fprintf(out, "\n");
+            wat_emit_named(fn, WAT_OP_LOCAL_GET, "__fp");
+            if (area > 0) {
+                wat_emit_const(fn, WAT_TYPE_I32, area);
+                wat_emit(fn, WAT_OP_ADD, WAT_TYPE_I32);
             }
-            print_indent(out, indent);
-            /* Look up the actual function name (handles allocated names with mangling) */
-            const char* call_target = get_call_target_name(call->function_name);
-            char* mangled_name = mangle_function_name(call_target);
-            fprintf(out, "call $%s", mangled_name);
-            xfree(mangled_name);
-            break;
+            area += (def->size + 7) & ~7;
         }
+        i += def->field_count - 1;
     }
 }
 
-/* Forward declaration for collecting locals */
-static void collect_locals(ASTBlock* block, char** local_names, int* local_count);
+/* Helper: Emit call/return_call to the function a call instruction names */
+static void emit_call_instruction(WatFunction* fn, WatOpcode op, const IrInstr* call) {
+    char* mangled_name = mangle_function_name(call->callee);
+    wat_emit_named(fn, op, mangled_name);
+    xfree(mangled_name);
+}
 
-/* Helper to collect local variables from a block */
-static void collect_locals_from_stmt(ASTStatement* stmt, char** local_names, int* local_count) {
-    if (!stmt) return;
-    
-    switch (stmt->type) {
-        case STMT_VAR_DECL: {
-            ASTVarDecl* var = &stmt->as.var_decl_stmt.var_decl;
-            /* Check if already added */
-            int found = 0;
-            for (int i = 0; i < *local_count; i++) {
-                if (strcmp(local_names[i], var->name) == 0) {
-                    found = 1;
-                    break;
-                }
-            }
-            if (!found && *local_count < 100) {  /* Reasonable limit */
-                local_names[*local_count] = var->name;
-                (*local_count)++;
-            }
-            break;
-        }
-        
-        case STMT_IF: {
-            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
-            collect_locals(&if_stmt->then_body, local_names, local_count);
-            for (ASTElseIfClause* elif = if_stmt->else_if_chain; elif; elif = elif->next) {
-                collect_locals(&elif->body, local_names, local_count);
-            }
-            if (if_stmt->else_body) {
-                collect_locals(if_stmt->else_body, local_names, local_count);
-            }
-            break;
+/* Emit `conv`: one wrap or extend between i32 and i64, then a mask or
+ * sign-extension only when a sub-32-bit target may not already hold the
+ * value, and a test against zero for bool */
+static void emit_conv(WatFunction* fn, const IrInstr* instr) {
+    int operand = instr->args[0];
+    CasmType from = g_ir_func->values[operand].type;
+    CasmType to = instr->type;
+
+    emit_value(fn, operand);
+    if (to == TYPE_BOOL && from != TYPE_BOOL) {
+        WatValType wat_type = casm_type_to_wat_type(from);
+        wat_emit_const(fn, wat_type, 0);
+        wat_emit(fn, WAT_OP_NE, wat_type);
+        return;
+    }
+    emit_conversion(fn, from, to);
+    int bits = get_type_size_bits(to);
+    if (bits < 32 && from != TYPE_BOOL && !type_fits_type(from, to) &&
+        !ir_range_fits(g_ranges, operand, instr->block, to)) {
+        emit_narrow_wrap(fn, to);
+    }
+}
+
+/* Emit a rotate. A narrow rotate first repeats the value across the i32,
+ * so the 32-bit rotate leaves the narrow result in the low bits. */
+static void emit_rotate(WatFunction* fn, const IrInstr* instr) {
+    CasmType type = instr->type;
+    int bits = get_type_size_bits(type);
+    int narrow = bits < 32;
+
+    emit_value(fn, instr->args[0]);
+    if (narrow) {
+        emit_zero_extend(fn, type);
+        wat_emit_const(fn, WAT_TYPE_I32, bits == 8 ? 0x01010101 : 0x00010001);
+        wat_emit(fn, WAT_OP_MUL, WAT_TYPE_I32);
+    }
+    emit_value(fn, instr->args[1]);
+    wat_emit(fn, instr->op == IR_ROTL ? WAT_OP_ROTL : WAT_OP_ROTR, casm_type_to_wat_type(type));
+    if (narrow) {
+        emit_narrow_wrap(fn, type);
+    }
+}
+
+/* Emit popcount, clz or ctz. Narrow operands are counted as i32 and
+ * corrected for the bits above their width. */
+static void emit_bit_count(WatFunction* fn, const IrInstr* instr) {
+    CasmType type = instr->type;
+    int bits = get_type_size_bits(type);
+
+    emit_value(fn, instr->args[0]);
+    if (bits < 32) {
+        emit_zero_extend(fn, type);
+        if (instr->op == IR_CTZ) {
+            /* A sentinel bit just above the width makes ctz(0) the width */
+            wat_emit_const(fn, WAT_TYPE_I32, 1L << bits);
+            wat_emit(fn, WAT_OP_OR, WAT_TYPE_I32);
         }
-        
-        case STMT_WHILE: {
-            ASTWhileStmt* while_stmt = &stmt->as.while_stmt;
-            collect_locals(&while_stmt->body, local_names, local_count);
-            break;
+    }
+    WatOpcode op = instr->op == IR_POPCOUNT ? WAT_OP_POPCNT :
+                   instr->op == IR_CLZ ? WAT_OP_CLZ : WAT_OP_CTZ;
+    wat_emit(fn, op, casm_type_to_wat_type(type));
+    if (bits < 32 && instr->op == IR_CLZ) {
+        wat_emit_const(fn, WAT_TYPE_I32, 32 - bits);
+        wat_emit(fn, WAT_OP_SUB, WAT_TYPE_I32);
+    }
+}
+
+/* Helper: Map a binary IR instruction to its WAT opcode for the operand type */
+static WatOpcode binary_opcode(IrOpcode op, CasmType type) {
+    int is_signed = is_signed_type(type);
+
+    switch (op) {
+        case IR_ADD: return WAT_OP_ADD;
+        case IR_SUB: return WAT_OP_SUB;
+        case IR_MUL: return WAT_OP_MUL;
+        case IR_DIV: return is_signed ? WAT_OP_DIV_S : WAT_OP_DIV_U;
+        case IR_MOD: return is_signed ? WAT_OP_REM_S : WAT_OP_REM_U;
+        case IR_AND: return WAT_OP_AND;
+        case IR_OR:  return WAT_OP_OR;
+        case IR_XOR: return WAT_OP_XOR;
+        case IR_SHL: return WAT_OP_SHL;
+        case IR_SHR: return is_signed ? WAT_OP_SHR_S : WAT_OP_SHR_U;
+        case IR_EQ:  return WAT_OP_EQ;
+        case IR_NE:  return WAT_OP_NE;
+        case IR_LT:  return is_signed ? WAT_OP_LT_S : WAT_OP_LT_U;
+        case IR_GT:  return is_signed ? WAT_OP_GT_S : WAT_OP_GT_U;
+        case IR_LE:  return is_signed ? WAT_OP_LE_S : WAT_OP_LE_U;
+        case IR_GE:  return is_signed ? WAT_OP_GE_S : WAT_OP_GE_U;
+        default:     return WAT_OP_UNREACHABLE;
+    }
+}
+
+/* Push the result of a value-producing instruction (nothing for a void
+ * call). Division and remainder trap in wasm exactly where the IR does:
+ * on a zero divisor, and for division on the minimum divided by -1. */
+static void emit_operation(WatFunction* fn, int value) {
+    const IrInstr* instr = &g_ir_func->values[value];
+    WatValType wat_type = casm_type_to_wat_type(instr->type);
+
+    switch (instr->op) {
+        case IR_CONV:
+            emit_conv(fn, instr);
+            return;
+        case IR_ROTL:
+        case IR_ROTR:
+            emit_rotate(fn, instr);
+            return;
+        case IR_POPCOUNT:
+        case IR_CLZ:
+        case IR_CTZ:
+            emit_bit_count(fn, instr);
+            return;
+        case IR_NEG:
+            wat_emit_const(fn, wat_type, 0);
+            emit_value(fn, instr->args[0]);
+            wat_emit(fn, WAT_OP_SUB, wat_type);
+            return;
+        case IR_NOT:
+            emit_value(fn, instr->args[0]);
+            wat_emit(fn, WAT_OP_EQZ, WAT_TYPE_I32);
+            return;
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_GT:
+        case IR_LE:
+        case IR_GE: {
+            /* Evaluated in the operands' type */
+            CasmType operand_type = g_ir_func->values[instr->args[0]].type;
+            emit_value(fn, instr->args[0]);
+            emit_value(fn, instr->args[1]);
+            wat_emit(fn, binary_opcode(instr->op, operand_type), casm_type_to_wat_type(operand_type));
+            return;
         }
-        
-        case STMT_FOR: {
-            ASTForStmt* for_stmt = &stmt->as.for_stmt;
-            if (for_stmt->init && for_stmt->init->type == STMT_VAR_DECL) {
-                ASTVarDecl* var = &for_stmt->init->as.var_decl_stmt.var_decl;
-                int found = 0;
-                for (int i = 0; i < *local_count; i++) {
-                    if (strcmp(local_names[i], var->name) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found && *local_count < 100) {
-                    local_names[*local_count] = var->name;
-                    (*local_count)++;
-                }
+        case IR_CALL:
+            emit_call_arguments(fn, instr);
+            emit_call_instruction(fn, WAT_OP_CALL, instr);
+            return;
+        case IR_LOAD: {
+            if (IR_IS_GLOBAL_ARRAY(instr->imm) && is_scalar_global(IR_ARRAY_INDEX(instr->imm))) {
+                wat_emit_named(fn, WAT_OP_GLOBAL_GET, g_ir_module->globals[IR_ARRAY_INDEX(instr->imm)].name);
+                return;
             }
-            collect_locals(&for_stmt->body, local_names, local_count);
-            break;
-        }
-        
-        case STMT_BLOCK: {
-            collect_locals(&stmt->as.block_stmt.block, local_names, local_count);
-            break;
+            long long offset = emit_element_address(fn, instr->imm, instr->args[0]);
+            wat_emit_memory(fn, element_load_op(instr->type), wat_type, offset);
+            return;
         }
-        
         default:
-            break;
+            /* Binary arithmetic, bitwise and shift instructions; a shift
+             * count has the shifted type and is masked by the instruction */
+            emit_value(fn, instr->args[0]);
+            emit_value(fn, instr->args[1]);
+            wat_emit(fn, binary_opcode(instr->op, instr->type), wat_type);
+            return;
+    }
+}
+
+/* Helper: Emit a dbg argument widened to the i64 slot of a buffered record */
+static void emit_dbg_slot_value(WatFunction* fn, int value) {
+    CasmType type = g_ir_func->values[value].type;
+    emit_value(fn, value);
+    if (casm_type_to_wat_type(type) == WAT_TYPE_I32) {
+        wat_emit(fn, is_signed_type(type) ? WAT_OP_I64_EXTEND_I32_S : WAT_OP_I64_EXTEND_I32_U,
+                 WAT_TYPE_I64);
+    }
+}
+
+/* Append a dbg record to the linear-memory buffer (buffered debug ABI).
+ * The arguments are IR values computed before the dbg instruction, so no
+ * call can append a record of its own while this one is written. */
+static void emit_dbg_record(WatFunction* fn, const IrInstr* instr, int format_offset, int format_len) {
+    int record_size = 8 + 8 * instr->arg_count;
+
+    /* Flush first if the record does not fit */
+    wat_emit_named(fn, WAT_OP_GLOBAL_GET, "__dbg_pos");
+    wat_emit_const(fn, WAT_TYPE_I32, record_size);
+    wat_emit(fn, WAT_OP_ADD, WAT_TYPE_I32);
+    wat_emit_named(fn, WAT_OP_GLOBAL_GET, "__dbg_limit");
+    wat_emit(fn, WAT_OP_GT_U, WAT_TYPE_I32);
+    wat_emit(fn, WAT_OP_IF, WAT_TYPE_I32);
+    wat_emit_named(fn, WAT_OP_CALL, "__dbg_flush");
+    wat_emit(fn, WAT_OP_END, WAT_TYPE_I32);
+
+    /* Header: format offset and length */
+    wat_emit_named(fn, WAT_OP_GLOBAL_GET, "__dbg_pos");
+    wat_emit_const(fn, WAT_TYPE_I32, format_offset);
+    wat_emit_store(fn, WAT_TYPE_I32, 0);
+    wat_emit_named(fn, WAT_OP_GLOBAL_GET, "__dbg_pos");
+    wat_emit_const(fn, WAT_TYPE_I32, format_len);
+    wat_emit_store(fn, WAT_TYPE_I32, 4);
+
+    /* One i64 slot per argument */
+    for (int i = 0; i < instr->arg_count; i++) {
+        wat_emit_named(fn, WAT_OP_GLOBAL_GET, "__dbg_pos");
+        emit_dbg_slot_value(fn, instr->args[i]);
+        wat_emit_store(fn, WAT_TYPE_I64, 8 + 8 * i);
     }
+
+    /* Advance the write position */
+    wat_emit_named(fn, WAT_OP_GLOBAL_GET, "__dbg_pos");
+    wat_emit_const(fn, WAT_TYPE_I32, record_size);
+    wat_emit(fn, WAT_OP_ADD, WAT_TYPE_I32);
+    wat_emit_named(fn, WAT_OP_GLOBAL_SET, "__dbg_pos");
 }
 
-/* Collect locals from a block */
-static void collect_locals(ASTBlock* block, char** local_names, int* local_count) {
-    for (int i = 0; i < block->statement_count; i++) {
-        collect_locals_from_stmt(&block->statements[i], local_names, local_count);
+/* Emit a dbg statement: a buffered record, or debug_begin, one
+ * debug_value_<type> call per argument and debug_end */
+static void emit_dbg(WatFunction* fn, const IrInstr* instr) {
+    int format_offset = register_debug_format(instr);
+    int format_len = g_debug_formats[g_debug_format_count - 1].length;
+
+    if (g_options.debug_abi == WAT_DEBUG_ABI_BUFFERED) {
+        emit_dbg_record(fn, instr, format_offset, format_len);
+        return;
+    }
+
+    wat_emit_const(fn, WAT_TYPE_I32, format_offset);
+    wat_emit_const(fn, WAT_TYPE_I32, format_len);
+    wat_emit_named(fn, WAT_OP_CALL, "debug_begin");
+    for (int i = 0; i < instr->arg_count; i++) {
+        emit_value(fn, instr->args[i]);
+        wat_emit_named(fn, WAT_OP_CALL, get_debug_value_func_name(g_ir_func->values[instr->args[i]].type));
     }
+    wat_emit_named(fn, WAT_OP_CALL, "debug_end");
 }
 
-/* Emit a statement */
-static void emit_statement(FILE* out, ASTStatement* stmt, int indent) {
-    if (!stmt) return;
-    
-    switch (stmt->type) {
-        case STMT_VAR_DECL: {
-            ASTVarDecl* var = &stmt->as.var_decl_stmt.var_decl;
-            /* Local declarations are handled in function header */
-            /* But if there's an initializer, emit the assignment */
-            if (var->initializer) {
-                emit_expression(out, var->initializer, indent);
-                fprintf(out, "\n");
-                print_indent(out, indent);
-                fprintf(out, "local.set $%s\n", var->name);
+/* Emit one instruction in its place in the block. Values with a use are
+ * kept in their local; unused ones are left out, except for calls and
+ * divisions, which may have effects or trap. */
+static void emit_instr(WatFunction* fn, int value) {
+    const IrInstr* instr = &g_ir_func->values[value];
+    char name[32];
+    if (g_inlined[value]) return;
+
+    switch (instr->op) {
+        case IR_CONST:
+        case IR_UNDEF:
+        case IR_PARAM:
+        case IR_PHI:
+            /* Pushed where used; phis are set on the incoming edges */
+            return;
+        case IR_DBG:
+            emit_dbg(fn, instr);
+            return;
+        case IR_STORE: {
+            CasmType type = g_ir_func->values[instr->args[1]].type;
+            if (IR_IS_GLOBAL_ARRAY(instr->imm) && is_scalar_global(IR_ARRAY_INDEX(instr->imm))) {
+                emit_value(fn, instr->args[1]);
+                wat_emit_named(fn, WAT_OP_GLOBAL_SET, g_ir_module->globals[IR_ARRAY_INDEX(instr->imm)].name);
+                return;
             }
-            break;
+            long long offset = emit_element_address(fn, instr->imm, instr->args[0]);
+            emit_value(fn, instr->args[1]);
+            wat_emit_memory(fn, element_store_op(type), casm_type_to_wat_type(type), offset);
+            return;
         }
-        
-        case STMT_EXPR: {
-            emit_expression(out, stmt->as.expr_stmt.expr, indent);
-            fprintf(out, "\n");
+        case IR_BOUNDS_CHECK:
+            /* A failed check traps in $__casm_bounds_fail, which names
+             * the error in the trap's backtrace */
+            emit_value(fn, instr->args[0]);
+            wat_emit_const(fn, WAT_TYPE_I64, ir_array_ref(g_ir_module, g_ir_func, instr->imm)->length);
+            wat_emit(fn, WAT_OP_GE_U, WAT_TYPE_I64);
+            wat_emit(fn, WAT_OP_IF, WAT_TYPE_I32);
+            wat_emit_named(fn, WAT_OP_CALL, "__casm_bounds_fail");
+            wat_emit(fn, WAT_OP_END, WAT_TYPE_I32);
+            g_uses_bounds_fail = 1;
+            return;
+        case IR_ARRAY_INIT:
+            emit_array_init(fn, (int)instr->imm);
+            return;
+        default:
             break;
+    }
+
+    int used = instr->type != TYPE_VOID && g_uses[value] > 0;
+    if (!used && instr->op != IR_CALL && instr->op != IR_DIV && instr->op != IR_MOD) return;
+
+    emit_operation(fn, value);
+    if (used) {
+        value_local_name(name, sizeof(name), value);
+        wat_function_add_local(fn, name, casm_type_to_wat_type(instr->type));
+        wat_emit_named(fn, WAT_OP_LOCAL_SET, name);
+    } else if (instr->type != TYPE_VOID) {
+        wat_emit(fn, WAT_OP_DROP, casm_type_to_wat_type(instr->type));
+    }
+}
+
+/* Helper: Which predecessor slot of `to` the edge from `from` is. Both
+ * edges of a branch may go to the same block; `second` picks the later one. */
+static int ir_pred_slot(const IrBlock* to, int from, int second) {
+    int first = -1;
+    for (int i = 0; i < to->pred_count; i++) {
+        if (to->preds[i] != from) continue;
+        if (!second || first >= 0) return i;
+        first = i;
+    }
+    return first;
+}
+
+/* Helper: Check if the edge from `from` to `to` passes a phi a value
+ * other than its own */
+static int edge_has_copies(int from, int to, int second) {
+    const IrBlock* target = &g_ir_func->blocks[to];
+    int slot = ir_pred_slot(target, from, second);
+    for (int i = 0; i < target->instr_count; i++) {
+        int phi = target->instrs[i];
+        if (g_ir_func->values[phi].op != IR_PHI) break;
+        if (g_uses[phi] > 0 && g_ir_func->values[phi].args[slot] != phi) return 1;
+    }
+    return 0;
+}
+
+/* Helper: Emit the phi copies of an edge: every argument is pushed before
+ * any phi is set, so the copies are parallel */
+static void emit_phi_copies(WatFunction* fn, int from, int to, int second) {
+    const IrBlock* target = &g_ir_func->blocks[to];
+    int slot = ir_pred_slot(target, from, second);
+    int count = 0;
+    char name[32];
+    for (int i = 0; i < target->instr_count; i++) {
+        int phi = target->instrs[i];
+        if (g_ir_func->values[phi].op != IR_PHI) break;
+        if (g_uses[phi] == 0 || g_ir_func->values[phi].args[slot] == phi) continue;
+        emit_value(fn, g_ir_func->values[phi].args[slot]);
+        count++;
+    }
+    for (int i = count > 0 ? target->instr_count - 1 : -1; i >= 0; i--) {
+        int phi = target->instrs[i];
+        const IrInstr* instr = &g_ir_func->values[phi];
+        if (instr->op != IR_PHI || g_uses[phi] == 0 || instr->args[slot] == phi) continue;
+        value_local_name(name, sizeof(name), phi);
+        wat_function_add_local(fn, name, casm_type_to_wat_type(instr->type));
+        wat_emit_named(fn, WAT_OP_LOCAL_SET, name);
+    }
+}
+
+/* Helper: Label of a loop header's `loop` or of a merge block's `block` */
+static void block_label(char* buf, size_t size, int block, int loop) {
+    snprintf(buf, size, loop ? "l%d" : "b%d", block);
+}
+
+/* Helper: Check if the edge from `from` to `to` is a plain branch: no phi
+ * copies and a label to branch to. `follow` is the block that runs when
+ * the current code falls off its end (-1 for none). Returns 1 and sets
+ * `label` (NULL when falling through does it). */
+static int edge_is_branch(int from, int to, int second, int follow, char* label, size_t size, int* falls) {
+    if (edge_has_copies(from, to, second)) return 0;
+    int backward = g_rpo_index[to] <= g_rpo_index[from];
+    if (!backward && !g_merge[to]) return 0;
+    *falls = !backward && to == follow;
+    block_label(label, size, to, backward);
+    return 1;
+}
+
+/* Forward declaration */
+static void emit_tree(WatFunction* fn, int block, int follow);
+
+/* Emit the edge from `from` to `to`: phi copies, then a branch back to a
+ * loop header, a branch forward to a merge block (left out when it is
+ * the block that follows anyway), or the target's own code in place */
+static void emit_edge(WatFunction* fn, int from, int to, int second, int follow) {
+    char label[32];
+    emit_phi_copies(fn, from, to, second);
+    if (g_rpo_index[to] <= g_rpo_index[from]) {
+        block_label(label, sizeof(label), to, 1);
+        wat_emit_named(fn, WAT_OP_BR, label);
+    } else if (g_merge[to]) {
+        if (to != follow) {
+            block_label(label, sizeof(label), to, 0);
+            wat_emit_named(fn, WAT_OP_BR, label);
         }
-        
-        case STMT_RETURN: {
-            if (stmt->as.return_stmt.value) {
-                emit_expression(out, stmt->as.return_stmt.value, indent);
-                fprintf(out, "\n");
-            }
-            print_indent(out, indent);
-            fprintf(out, "return\n");
+    } else {
+        emit_tree(fn, to, follow);
+    }
+}
+
+/* Emit a conditional branch. When one side is a plain branch it becomes
+ * br_if (or nothing if it falls through); otherwise an if/else. */
+static void emit_branch(WatFunction* fn, int block, int follow) {
+    const IrTerminator* term = &g_ir_func->blocks[block].term;
+    int if_true = term->targets[0];
+    int if_false = term->targets[1];
+    int same = if_true == if_false;
+    char true_label[32];
+    char false_label[32];
+    int true_falls = 0;
+    int false_falls = 0;
+    int true_plain = edge_is_branch(block, if_true, 0, follow, true_label, sizeof(true_label), &true_falls);
+    int false_plain = edge_is_branch(block, if_false, same, follow, false_label, sizeof(false_label), &false_falls);
+
+    emit_value(fn, term->value);
+    if (true_plain && !true_falls && (false_falls || false_plain)) {
+        wat_emit_named(fn, WAT_OP_BR_IF, true_label);
+        emit_edge(fn, block, if_false, same, follow);
+        return;
+    }
+    if (false_plain && !false_falls && true_plain) {
+        wat_emit(fn, WAT_OP_EQZ, WAT_TYPE_I32);
+        wat_emit_named(fn, WAT_OP_BR_IF, false_label);
+        emit_edge(fn, block, if_true, 0, follow);
+        return;
+    }
+    if (true_falls) {
+        /* Only the false side has work to do */
+        wat_emit(fn, WAT_OP_EQZ, WAT_TYPE_I32);
+        wat_emit(fn, WAT_OP_IF, WAT_TYPE_I32);
+        emit_edge(fn, block, if_false, same, follow);
+        wat_emit(fn, WAT_OP_END, WAT_TYPE_I32);
+        return;
+    }
+    wat_emit(fn, WAT_OP_IF, WAT_TYPE_I32);
+    emit_edge(fn, block, if_true, 0, follow);
+    if (!false_falls) {
+        wat_emit(fn, WAT_OP_ELSE, WAT_TYPE_I32);
+        emit_edge(fn, block, if_false, same, follow);
+    }
+    wat_emit(fn, WAT_OP_END, WAT_TYPE_I32);
+}
+
+/* Helper: Check if a block returns the result of a call it ends with,
+ * which return_call can make in place of call and return. The frame is
+ * gone by then, so the callee may not take struct addresses into it. */
+static int is_returnable_tail_call(const IrBlock* block) {
+    if (!g_options.return_call || block->term.kind != IR_TERM_RETURN || block->instr_count == 0) return 0;
+    int last = block->instrs[block->instr_count - 1];
+    const IrInstr* call = &g_ir_func->values[last];
+    if (call->op != IR_CALL) return 0;
+    if (block->term.value != last && !(block->term.value < 0 && call->type == TYPE_VOID)) return 0;
+    const IrFunction* callee = find_ir_function(call->callee);
+    return callee && callee->return_type == g_ir_func->return_type && !has_struct_param(callee);
+}
+
+/* Emit a block's instructions and terminator */
+static void emit_block_code(WatFunction* fn, int index, int follow) {
+    const IrBlock* block = &g_ir_func->blocks[index];
+    int tail_call = is_returnable_tail_call(block);
+    int count = tail_call ? block->instr_count - 1 : block->instr_count;
+
+    for (int i = 0; i < count; i++) {
+        emit_instr(fn, block->instrs[i]);
+    }
+
+    if (tail_call) {
+        const IrInstr* call = &g_ir_func->values[block->instrs[count]];
+        emit_call_arguments(fn, call);
+        emit_frame_release(fn);
+        emit_call_instruction(fn, WAT_OP_RETURN_CALL, call);
+        return;
+    }
+
+    switch (block->term.kind) {
+        case IR_TERM_JUMP:
+            emit_edge(fn, index, block->term.targets[0], 0, follow);
             break;
-        }
-        
-        case STMT_IF: {
-            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
-            
-            emit_expression(out, if_stmt->condition, indent);
-            fprintf(out, "\n");
-            print_indent(out, indent);
-            fprintf(out, "if\n");
-            
-            /* Then body */
-            for (int i = 0; i < if_stmt->then_body.statement_count; i++) {
-                emit_statement(out, &if_stmt->then_body.statements[i], indent + 1);
-            }
-            
-            /* Else-if chain */
-            for (ASTElseIfClause* elif = if_stmt->else_if_chain; elif; elif = elif->next) {
-                print_indent(out, indent);
-                fprintf(out, "else\n");
-                emit_expression(out, elif->condition, indent + 1);
-                fprintf(out, "\n");
-                print_indent(out, indent + 1);
-                fprintf(out, "if\n");
-                
-                for (int i = 0; i < elif->body.statement_count; i++) {
-                    emit_statement(out, &elif->body.statements[i], indent + 2);
-                }
-            }
-            
-            /* Else block */
-            if (if_stmt->else_body) {
-                print_indent(out, indent);
-                fprintf(out, "else\n");
-                
-                for (int i = 0; i < if_stmt->else_body->statement_count; i++) {
-                    emit_statement(out, &if_stmt->else_body->statements[i], indent + 1);
-                }
-            }
-            
-            print_indent(out, indent);
-            fprintf(out, "end\n");
+        case IR_TERM_BRANCH:
+            emit_branch(fn, index, follow);
             break;
-        }
-        
-        case STMT_WHILE: {
-            ASTWhileStmt* while_stmt = &stmt->as.while_stmt;
-            
-            print_indent(out, indent);
-            fprintf(out, "block $break\n");
-            print_indent(out, indent);
-            fprintf(out, "loop $continue\n");
-            
-            /* Condition check */
-            emit_expression(out, while_stmt->condition, indent + 1);
-            fprintf(out, "\n");
-            print_indent(out, indent + 1);
-            fprintf(out, "i32.eqz\n");
-            print_indent(out, indent + 1);
-            fprintf(out, "br_if $break\n");
-            
-            /* Body */
-            for (int i = 0; i < while_stmt->body.statement_count; i++) {
-                emit_statement(out, &while_stmt->body.statements[i], indent + 1);
+        case IR_TERM_RETURN:
+            if (block->term.value >= 0) {
+                emit_value(fn, block->term.value);
             }
-            
-            /* Jump back to loop */
-            print_indent(out, indent + 1);
-            fprintf(out, "br $continue\n");
-            
-            print_indent(out, indent);
-            fprintf(out, "end\n");
-            print_indent(out, indent);
-            fprintf(out, "end\n");
+            emit_frame_release(fn);
+            wat_emit(fn, WAT_OP_RETURN, WAT_TYPE_I32);
             break;
+        default:
+            wat_emit(fn, WAT_OP_UNREACHABLE, WAT_TYPE_I32);
+            break;
+    }
+}
+
+/* Emit a block followed by the merge blocks it immediately dominates
+ * (merges[0..count), latest in reverse postorder first): each merge block
+ * is wrapped around everything before it, so branching to it leaves that
+ * `block` and runs into its code */
+static void emit_within(WatFunction* fn, int index, const int* merges, int count, int follow) {
+    if (count == 0) {
+        emit_block_code(fn, index, follow);
+        return;
+    }
+    char label[32];
+    block_label(label, sizeof(label), merges[0], 0);
+    wat_emit_named(fn, WAT_OP_BLOCK, label);
+    emit_within(fn, index, merges + 1, count - 1, merges[0]);
+    wat_emit(fn, WAT_OP_END, WAT_TYPE_I32);
+    emit_tree(fn, merges[0], follow);
+}
+
+/* Emit the subtree of the dominator tree rooted at a block, inside a
+ * `loop` if the block is a loop header */
+static void emit_tree(WatFunction* fn, int index, int follow) {
+    int* merges = xmalloc((g_rpo_count + 1) * sizeof(int));
+    int count = 0;
+    for (int i = g_rpo_count - 1; i > 0; i--) {
+        int child = g_rpo[i];
+        if (g_idom[child] == index && g_merge[child]) {
+            merges[count++] = child;
         }
-        
-        case STMT_FOR: {
-            ASTForStmt* for_stmt = &stmt->as.for_stmt;
-            
-            /* Emit init */
-            if (for_stmt->init) {
-                if (for_stmt->init->type == STMT_VAR_DECL) {
-                    ASTVarDecl* var = &for_stmt->init->as.var_decl_stmt.var_decl;
-                    if (var->initializer) {
-                        emit_expression(out, var->initializer, indent);
-                        fprintf(out, "\n");
-                        print_indent(out, indent);
-                        fprintf(out, "local.set $%s\n", var->name);
-                    }
-                } else if (for_stmt->init->type == STMT_EXPR) {
-                    emit_expression(out, for_stmt->init->as.expr_stmt.expr, indent);
-                    fprintf(out, "\n");
-                }
-            }
-            
-            print_indent(out, indent);
-            fprintf(out, "block $break\n");
-            print_indent(out, indent);
-            fprintf(out, "loop $continue\n");
-            
-            /* Condition check */
-            if (for_stmt->condition) {
-                emit_expression(out, for_stmt->condition, indent + 1);
-                fprintf(out, "\n");
-                print_indent(out, indent + 1);
-                fprintf(out, "i32.eqz\n");
-                print_indent(out, indent + 1);
-                fprintf(out, "br_if $break\n");
-            }
-            
-            /* Body */
-            for (int i = 0; i < for_stmt->body.statement_count; i++) {
-                emit_statement(out, &for_stmt->body.statements[i], indent + 1);
-            }
-            
-            /* Update */
-            if (for_stmt->update) {
-                emit_expression(out, for_stmt->update, indent + 1);
-                fprintf(out, "\n");
+    }
+
+    if (g_loop_header[index]) {
+        char label[32];
+        block_label(label, sizeof(label), index, 1);
+        wat_emit_named(fn, WAT_OP_LOOP, label);
+        emit_within(fn, index, merges, count, follow);
+        wat_emit(fn, WAT_OP_END, WAT_TYPE_I32);
+    } else {
+        emit_within(fn, index, merges, count, follow);
+    }
+    xfree(merges);
+}
+
+/* Helper: Check if an instruction only computes a value from its operands */
+static int is_pure_op(IrOpcode op) {
+    switch (op) {
+        case IR_CONV:
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_AND:
+        case IR_OR:
+        case IR_XOR:
+        case IR_SHL:
+        case IR_SHR:
+        case IR_ROTL:
+        case IR_ROTR:
+        case IR_NEG:
+        case IR_NOT:
+        case IR_POPCOUNT:
+        case IR_CLZ:
+        case IR_CTZ:
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_GT:
+        case IR_LE:
+        case IR_GE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Count the uses of every value and pick the values computed
+ * right at their only use instead of in a local: pure values used later
+ * in their own block or by a phi on one of its outgoing edges (whose
+ * arguments are all pushed before any phi is set), and the last
+ * instruction with an effect in a block when only inlined values and
+ * the terminator come after it */
+static void count_uses(const IrFunction* func) {
+    int size = (func->value_count + 1) * sizeof(int);
+    int* local_uses = xmalloc(size);
+    g_uses = xmalloc(size);
+    g_inlined = xmalloc(size);
+    memset(g_uses, 0, size);
+    memset(g_inlined, 0, size);
+    memset(local_uses, 0, size);
+
+    for (int b = 0; b < func->block_count; b++) {
+        const IrBlock* block = &func->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            const IrInstr* instr = &func->values[block->instrs[i]];
+            for (int a = 0; a < instr->arg_count; a++) {
+                int arg = instr->args[a];
+                int from = instr->op == IR_PHI ? block->preds[a] : b;
+                g_uses[arg]++;
+                if (func->values[arg].block == from) local_uses[arg]++;
             }
-            
-            /* Jump back to loop */
-            print_indent(out, indent + 1);
-            fprintf(out, "br $continue\n");
-            
-            print_indent(out, indent);
-            fprintf(out, "end\n");
-            print_indent(out, indent);
-            fprintf(out, "end\n");
-            break;
         }
-        
-        case STMT_BLOCK: {
-            for (int i = 0; i < stmt->as.block_stmt.block.statement_count; i++) {
-                emit_statement(out, &stmt->as.block_stmt.block.statements[i], indent);
+        if ((block->term.kind == IR_TERM_BRANCH || block->term.kind == IR_TERM_RETURN) &&
+            block->term.value >= 0) {
+            g_uses[block->term.value]++;
+            if (func->values[block->term.value].block == b) local_uses[block->term.value]++;
+        }
+    }
+
+    for (int v = 0; v < func->value_count; v++) {
+        if (is_pure_op(func->values[v].op)) {
+            g_inlined[v] = g_uses[v] == 1 && local_uses[v] == 1;
+        }
+    }
+
+    for (int b = 0; b < func->block_count; b++) {
+        const IrBlock* block = &func->blocks[b];
+        for (int i = block->instr_count - 1; i >= 0; i--) {
+            int value = block->instrs[i];
+            IrOpcode op = func->values[value].op;
+            if (g_inlined[value] || op == IR_CONST || op == IR_UNDEF || op == IR_PARAM) continue;
+            if (op == IR_CALL || op == IR_LOAD || op == IR_DIV || op == IR_MOD) {
+                g_inlined[value] = func->values[value].type != TYPE_VOID &&
+                                   g_uses[value] == 1 && local_uses[value] == 1;
             }
             break;
         }
-        
-        case STMT_DBG: {
-            /* WAT dbg support - emit begin/value/end pattern with format strings */
-            ASTDbgStmt* dbg = &stmt->as.dbg_stmt;
-            
-            /* Validate all argument types are supported */
-            for (int i = 0; i < dbg->argument_count; i++) {
-                if (!get_debug_value_func_name(dbg->arguments[i].resolved_type)) {
-                    /* Type not supported - codegen will fail */
-                    fprintf(stderr, "Error: unsupported type in dbg() statement\n");
-                    exit(1);
-                }
-            }
-            
-            /* Register format string and get its offset */
-            int format_offset = register_debug_format(dbg);
-            
-            /* Get format string length */
-            int format_len = g_debug_formats[g_debug_format_count - 1].length;
-            
-            /* Emit: debug_begin(format_ptr, format_len) */
-            print_indent(out, indent);
-            fprintf(out, "i32.const %d\n", format_offset);
-            print_indent(out, indent);
-            fprintf(out, "i32.const %d\n", format_len);
-            print_indent(out, indent);
-            fprintf(out, "call $debug_begin\n");
-            
-            /* Emit each argument with type-specific function */
-            for (int i = 0; i < dbg->argument_count; i++) {
-                CasmType arg_type = dbg->arguments[i].resolved_type;
-                const char* func_name = get_debug_value_func_name(arg_type);
-                
-                /* Emit the expression value */
-                emit_expression(out, &dbg->arguments[i], indent);
-                fprintf(out, "\n");
-                
-                /* Call the type-specific debug_value function */
-                print_indent(out, indent);
-                fprintf(out, "call %s\n", func_name);
+    }
+    xfree(local_uses);
+}
+
+/* Helper: Find the blocks with several forward predecessors and the
+ * targets of back edges */
+static void analyze_control_flow(const IrFunction* func) {
+    int n = func->block_count;
+    g_rpo = xmalloc(n * sizeof(int));
+    g_rpo_index = xmalloc(n * sizeof(int));
+    g_idom = xmalloc(n * sizeof(int));
+    g_merge = xmalloc(n * sizeof(int));
+    g_loop_header = xmalloc(n * sizeof(int));
+    g_rpo_count = ir_compute_dominators(func, g_rpo, g_rpo_index, g_idom);
+
+    for (int b = 0; b < n; b++) {
+        const IrBlock* block = &func->blocks[b];
+        int forward = 0;
+        g_loop_header[b] = 0;
+        for (int p = 0; p < block->pred_count; p++) {
+            int pred = block->preds[p];
+            if (g_rpo_index[pred] < 0) continue;
+            if (g_rpo_index[pred] < g_rpo_index[b]) {
+                forward++;
+            } else {
+                g_loop_header[b] = 1;
             }
-            
-            /* Emit: debug_end() */
-            print_indent(out, indent);
-            fprintf(out, "call $debug_end\n");
-            break;
         }
+        g_merge[b] = forward > 1;
     }
 }
 
-/* Emit function definitions */
-static void emit_function_definitions(FILE* out, ASTProgram* program) {
-    int emit_total = 0;
-    for (int i = 0; i < program->function_count; i++) {
-        if (program->import_count > 0 && !program->functions[i].allocated_name) {
+/* Helper: Free the per-function state */
+static void clear_function_state(void) {
+    xfree(g_uses);
+    xfree(g_inlined);
+    xfree(g_rpo);
+    xfree(g_rpo_index);
+    xfree(g_idom);
+    xfree(g_merge);
+    xfree(g_loop_header);
+    ir_ranges_free(g_ranges);
+    g_uses = NULL;
+    g_inlined = NULL;
+    g_rpo = NULL;
+    g_rpo_index = NULL;
+    g_idom = NULL;
+    g_merge = NULL;
+    g_loop_header = NULL;
+    g_ranges = NULL;
+    g_ir_func = NULL;
+}
+
+/* Lower an IR function to an instruction list */
+static WatFunction* lower_function(const IrFunction* func) {
+    char* mangled_name = mangle_function_name(func->name);
+    WatFunction* fn = wat_function_create(mangled_name);
+    xfree(mangled_name);
+    char name[32];
+
+    g_ir_func = func;
+    for (int i = 0; i < func->param_count; i++) {
+        const IrParamOrigin* origin = &func->param_origins[i];
+        if (origin->struct_index >= 0) {
+            /* A struct parameter is the address of its fields */
+            if (origin->field > 0) continue;
+            snprintf(name, sizeof(name), "s%d", i);
+            wat_function_add_param(fn, name, WAT_TYPE_I32);
             continue;
         }
-        emit_total++;
+        snprintf(name, sizeof(name), "p%d", i);
+        wat_function_add_param(fn, name, casm_type_to_wat_type(func->param_types[i]));
+    }
+    if (func->return_type != TYPE_VOID) {
+        wat_function_set_result(fn, casm_type_to_wat_type(func->return_type));
     }
 
-    int emit_count = 0;
-    for (int i = 0; i < program->function_count; i++) {
-        ASTFunctionDef* func = &program->functions[i];
-        if (program->import_count > 0 && !func->allocated_name) {
-            continue;
+    count_uses(func);
+    analyze_control_flow(func);
+    if (g_options.range_analysis) {
+        g_ranges = ir_analyze_ranges(func);
+    }
+    g_frame_size = layout_frame(func);
+    emit_frame_reserve(fn);
+
+    emit_tree(fn, 0, -1);
+
+    /* Every path ends in a return or a branch, but after a `loop` or an
+     * `if` the validator still expects the result on the stack */
+    WatOpcode last = fn->instr_count > 0 ? fn->instrs[fn->instr_count - 1].op : WAT_OP_END;
+    if (fn->has_result && last != WAT_OP_RETURN && last != WAT_OP_RETURN_CALL &&
+        last != WAT_OP_BR && last != WAT_OP_UNREACHABLE) {
+        wat_emit(fn, WAT_OP_UNREACHABLE, WAT_TYPE_I32);
+    }
+
+    clear_function_state();
+    if (g_options.strength_reduce) {
+        wat_strength_reduce(fn);
+    }
+    return fn;
+}
+
+/* Emit function definitions */
+static void emit_function_definitions(OutputSink* out, const IrModule* module) {
+    for (int i = 0; i < module->function_count; i++) {
+        WatFunction* fn = lower_function(module->functions[i]);
+        wat_function_serialize(fn, out, 1);
+        wat_function_free(fn);
+        if (i + 1 < module->function_count) {
+            output_sink_append(out, "\n");
         }
-         
-         /* Use allocated name if available (for dead code elimination in multi-module),
-          * otherwise use the function's original name (for single-file programs) */
-         const char* func_name = func->allocated_name ? func->allocated_name : func->name;
-         
-         /* Set context for call resolution */
-         g_current_function = func;
-         
-         /* Use allocated/original name for code generation */
-         char* mangled_name = mangle_function_name(func_name);
-        
-        print_indent(out, 1);
-        fprintf(out, "(func $%s", mangled_name);
-        
-        /* Emit parameters */
-        for (int j = 0; j < func->parameter_count; j++) {
-            fprintf(out, " (param $%s %s)",
-                    func->parameters[j].name,
-                    casm_type_to_wat_type(func->parameters[j].type.type));
-        }
-        
-        /* Emit return type */
-        if (func->return_type.type != TYPE_VOID) {
-            fprintf(out, " (result %s)", casm_type_to_wat_type(func->return_type.type));
-        }
-        
-        /* Collect local variables */
-        char* local_names[100];
-        int local_count = 0;
-        collect_locals(&func->body, local_names, &local_count);
-        
-        /* Emit local variables declarations */
-        for (int j = 0; j < local_count; j++) {
-            fprintf(out, " (local $%s i32)", local_names[j]);  /* Assume i32 for now */
-        }
-        
-        fprintf(out, "\n");
-        
-        /* Emit function body */
-        for (int j = 0; j < func->body.statement_count; j++) {
-            emit_statement(out, &func->body.statements[j], 2);
-        }
-        
-        print_indent(out, 1);
-        fprintf(out, ")\n");
-
-        emit_count++;
-        if (emit_count < emit_total) {
-            fprintf(out, "\n");
-        }
-        
-        xfree(mangled_name);
-        
-        /* Clear context */
-        g_current_function = NULL;
     }
 }
 
-/* Recursively check if a statement or any nested statement contains a dbg() call */
-static int statement_contains_dbg(ASTStatement* stmt) {
-    if (!stmt) return 0;
-    
-    switch (stmt->type) {
-        case STMT_DBG:
-            return 1;
-        
-        case STMT_IF: {
-            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
-            
-            /* Check then body */
-            for (int i = 0; i < if_stmt->then_body.statement_count; i++) {
-                if (statement_contains_dbg(&if_stmt->then_body.statements[i])) {
-                    return 1;
-                }
+/* Helper: Check if any instruction of a module has the given opcode */
+static int ir_module_uses_op(const IrModule* module, IrOpcode op) {
+    for (int f = 0; f < module->function_count; f++) {
+        const IrFunction* func = module->functions[f];
+        for (int b = 0; b < func->block_count; b++) {
+            const IrBlock* block = &func->blocks[b];
+            for (int i = 0; i < block->instr_count; i++) {
+                if (func->values[block->instrs[i]].op == op) return 1;
             }
-            
-            /* Check else-if chain */
-            for (ASTElseIfClause* elif = if_stmt->else_if_chain; elif; elif = elif->next) {
-                for (int i = 0; i < elif->body.statement_count; i++) {
-                    if (statement_contains_dbg(&elif->body.statements[i])) {
-                        return 1;
-                    }
-                }
-            }
-            
-            /* Check else body */
-            if (if_stmt->else_body) {
-                for (int i = 0; i < if_stmt->else_body->statement_count; i++) {
-                    if (statement_contains_dbg(&if_stmt->else_body->statements[i])) {
-                        return 1;
-                    }
-                }
-            }
-            break;
         }
-        
-        case STMT_WHILE: {
-            ASTWhileStmt* while_stmt = &stmt->as.while_stmt;
-            for (int i = 0; i < while_stmt->body.statement_count; i++) {
-                if (statement_contains_dbg(&while_stmt->body.statements[i])) {
-                    return 1;
-                }
+    }
+    return 0;
+}
+
+/* Helper: Check if any instruction of a module refers to an array operand */
+static int ir_module_uses_array(const IrModule* module, long long imm) {
+    for (int f = 0; f < module->function_count; f++) {
+        const IrFunction* func = module->functions[f];
+        for (int b = 0; b < func->block_count; b++) {
+            const IrBlock* block = &func->blocks[b];
+            for (int i = 0; i < block->instr_count; i++) {
+                const IrInstr* instr = &func->values[block->instrs[i]];
+                if ((instr->op == IR_LOAD || instr->op == IR_STORE) && instr->imm == imm) return 1;
             }
-            break;
         }
-        
-        case STMT_FOR: {
-            ASTForStmt* for_stmt = &stmt->as.for_stmt;
-            
-            /* Check init statement */
-            if (for_stmt->init && statement_contains_dbg(for_stmt->init)) {
-                return 1;
-            }
-            
-            /* Check loop body */
-            for (int i = 0; i < for_stmt->body.statement_count; i++) {
-                if (statement_contains_dbg(&for_stmt->body.statements[i])) {
-                    return 1;
-                }
-            }
+    }
+    return 0;
+}
+
+/* Emit the buffered debug ABI runtime: buffer globals, memory sized to hold
+ * the format strings plus the record buffer, and the $__dbg_flush helper */
+static void emit_debug_buffer_runtime(OutputSink* out) {
+    int base = (g_data_offset + 7) & ~7;
+    int limit = base + DEBUG_BUFFER_SIZE;
+    int pages = (limit + 65535) / 65536;
+
+    output_sink_append(out, "  (memory ");
+    output_sink_append_int(out, pages);
+    output_sink_append(out, ")\n");
+    output_sink_append(out, "  (global $__dbg_base i32 (i32.const ");
+    output_sink_append_int(out, base);
+    output_sink_append(out, "))\n");
+    output_sink_append(out, "  (global $__dbg_limit i32 (i32.const ");
+    output_sink_append_int(out, limit);
+    output_sink_append(out, "))\n");
+    output_sink_append(out, "  (global $__dbg_pos (mut i32) (i32.const ");
+    output_sink_append_int(out, base);
+    output_sink_append(out, "))\n");
+
+    /* Hand [base, pos) to the host and rewind */
+    WatFunction* flush = wat_function_create("__dbg_flush");
+    wat_emit_named(flush, WAT_OP_GLOBAL_GET, "__dbg_pos");
+    wat_emit_named(flush, WAT_OP_GLOBAL_GET, "__dbg_base");
+    wat_emit(flush, WAT_OP_NE, WAT_TYPE_I32);
+    wat_emit(flush, WAT_OP_IF, WAT_TYPE_I32);
+    wat_emit_named(flush, WAT_OP_GLOBAL_GET, "__dbg_base");
+    wat_emit_named(flush, WAT_OP_GLOBAL_GET, "__dbg_pos");
+    wat_emit_named(flush, WAT_OP_GLOBAL_GET, "__dbg_base");
+    wat_emit(flush, WAT_OP_SUB, WAT_TYPE_I32);
+    wat_emit_named(flush, WAT_OP_CALL, "debug_flush");
+    wat_emit_named(flush, WAT_OP_GLOBAL_GET, "__dbg_base");
+    wat_emit_named(flush, WAT_OP_GLOBAL_SET, "__dbg_pos");
+    wat_emit(flush, WAT_OP_END, WAT_TYPE_I32);
+    wat_function_serialize(flush, out, 1);
+    wat_function_free(flush);
+}
+
+/* Lay out module-level arrays from offset 0, followed by the shadow stack
+ * if any function needs a frame. Returns the first free offset. */
+static int layout_arrays(const IrModule* module) {
+    int offset = 0;
+    g_global_offsets = xmalloc((module->global_count + 1) * sizeof(int));
+    for (int i = 0; i < module->global_count; i++) {
+        g_global_offsets[i] = offset;
+        if (!is_scalar_global(i)) {
+            offset += array_size_bytes(&module->globals[i]);
+        }
+    }
+
+    g_stack_base = offset;
+    g_stack_top = offset;
+    for (int i = 0; i < module->function_count; i++) {
+        if (layout_frame(module->functions[i]) > 0) {
+            g_stack_top = offset + ARRAY_STACK_SIZE;
             break;
         }
-        
-        case STMT_BLOCK: {
-            ASTBlockStmt* block_stmt = &stmt->as.block_stmt;
-            for (int i = 0; i < block_stmt->block.statement_count; i++) {
-                if (statement_contains_dbg(&block_stmt->block.statements[i])) {
-                    return 1;
-                }
+    }
+    return g_stack_top;
+}
+
+/* Emit the initial contents of module-level arrays as data segments, and
+ * the shadow stack pointer */
+static void emit_array_memory(OutputSink* out, const IrModule* module) {
+    char byte[8];
+    for (int i = 0; i < module->global_count; i++) {
+        const IrArray* array = &module->globals[i];
+        if (is_scalar_global(i)) continue;
+        int size = array_element_size(array->elem_type);
+        int last = array->init_count - 1;
+        while (last >= 0 && array->init[last] == 0) last--;
+        if (last < 0) continue;
+
+        output_sink_append(out, "  (data (i32.const ");
+        output_sink_append_int(out, g_global_offsets[i]);
+        output_sink_append(out, ") \"");
+        for (int j = 0; j <= last; j++) {
+            unsigned long long value = (unsigned long long)array->init[j];
+            for (int k = 0; k < size; k++) {
+                snprintf(byte, sizeof(byte), "\\%02x", (unsigned)((value >> (8 * k)) & 0xff));
+                output_sink_append(out, byte);
             }
-            break;
         }
-        
-        case STMT_RETURN:
-        case STMT_EXPR:
-        case STMT_VAR_DECL:
-            /* These statements don't contain nested statements */
-            break;
+        output_sink_append(out, "\")\n");
     }
-    
-    return 0;
+
+    if (g_stack_top > g_stack_base) {
+        output_sink_append(out, "  (global $__sp (mut i32) (i32.const ");
+        output_sink_append_int(out, g_stack_top);
+        output_sink_append(out, "))\n");
+    }
+}
+
+/* Emit module-level scalars as mutable wasm globals; folded read-only
+ * scalars have no uses left and are skipped */
+static void emit_scalar_globals(OutputSink* out, const IrModule* module) {
+    for (int i = 0; i < module->global_count; i++) {
+        const IrArray* global = &module->globals[i];
+        if (!is_scalar_global(i) || !ir_module_uses_array(module, IR_GLOBAL_ARRAY(i))) continue;
+        const char* type = casm_type_to_wat_type(global->elem_type) == WAT_TYPE_I64 ? "i64" : "i32";
+        output_sink_append(out, "  (global $");
+        output_sink_append(out, global->name);
+        output_sink_append(out, " (mut ");
+        output_sink_append(out, type);
+        output_sink_append(out, ") (");
+        output_sink_append(out, type);
+        output_sink_append(out, ".const ");
+        output_sink_append_int(out, global->init_count > 0 ? global->init[0] : 0);
+        output_sink_append(out, "))\n");
+    }
+}
+
+/* Emit $__casm_zero(addr, len), which zeroes len bytes (a multiple of 8) */
+static void emit_zero_fill_helper(OutputSink* out) {
+    WatFunction* zero = wat_function_create("__casm_zero");
+    wat_function_add_param(zero, "addr", WAT_TYPE_I32);
+    wat_function_add_param(zero, "len", WAT_TYPE_I32);
+    wat_emit_named(zero, WAT_OP_BLOCK, "done");
+    wat_emit_named(zero, WAT_OP_LOOP, "fill");
+    wat_emit_named(zero, WAT_OP_LOCAL_GET, "len");
+    wat_emit(zero, WAT_OP_EQZ, WAT_TYPE_I32);
+    wat_emit_named(zero, WAT_OP_BR_IF, "done");
+    wat_emit_named(zero, WAT_OP_LOCAL_GET, "addr");
+    wat_emit_const(zero, WAT_TYPE_I64, 0);
+    wat_emit_store(zero, WAT_TYPE_I64, 0);
+    wat_emit_named(zero, WAT_OP_LOCAL_GET, "addr");
+    wat_emit_const(zero, WAT_TYPE_I32, 8);
+    wat_emit(zero, WAT_OP_ADD, WAT_TYPE_I32);
+    wat_emit_named(zero, WAT_OP_LOCAL_SET, "addr");
+    wat_emit_named(zero, WAT_OP_LOCAL_GET, "len");
+    wat_emit_const(zero, WAT_TYPE_I32, 8);
+    wat_emit(zero, WAT_OP_SUB, WAT_TYPE_I32);
+    wat_emit_named(zero, WAT_OP_LOCAL_SET, "len");
+    wat_emit_named(zero, WAT_OP_BR, "fill");
+    wat_emit(zero, WAT_OP_END, WAT_TYPE_I32);
+    wat_emit(zero, WAT_OP_END, WAT_TYPE_I32);
+    wat_function_serialize(zero, out, 1);
+    wat_function_free(zero);
+}
+
+/* Emit $__casm_bounds_fail, the trap taken by a failed bounds check */
+static void emit_bounds_fail_helper(OutputSink* out) {
+    WatFunction* fail = wat_function_create("__casm_bounds_fail");
+    wat_emit(fail, WAT_OP_UNREACHABLE, WAT_TYPE_I32);
+    wat_function_serialize(fail, out, 1);
+    wat_function_free(fail);
+}
+
+/* Emit $__casm_main, which runs main and then flushes buffered dbg records */
+static void emit_debug_buffer_entry(OutputSink* out, const IrFunction* main_func, const char* main_name) {
+    WatFunction* entry = wat_function_create("__casm_main");
+    if (main_func->return_type != TYPE_VOID) {
+        wat_function_set_result(entry, casm_type_to_wat_type(main_func->return_type));
+    }
+    wat_emit_named(entry, WAT_OP_CALL, main_name);
+    wat_emit_named(entry, WAT_OP_CALL, "__dbg_flush");
+    wat_function_serialize(entry, out, 1);
+    wat_function_free(entry);
+}
+
+/* Helper: The IR function of the program's main, or NULL */
+static const IrFunction* find_main_function(ASTProgram* program) {
+    for (int i = 0; i < program->function_count; i++) {
+        ASTFunctionDef* func = &program->functions[i];
+        if (program->import_count > 0 && !func->allocated_name) continue;
+        if (strcmp(func->name, "main") == 0) {
+            return find_ir_function(func->allocated_name ? func->allocated_name : func->name);
+        }
+    }
+    return NULL;
 }
 
 /* Main WAT code generation function */
 CodegenWatResult codegen_wat_program(ASTProgram* program, FILE* output, const char* source_filename) {
-    if (!program || !output) {
+    return codegen_wat_program_with_options(program, output, source_filename, NULL);
+}
+
+CodegenWatResult codegen_wat_program_with_options(ASTProgram* program, FILE* output,
+                                                  const char* source_filename,
+                                                  const CodegenWatOptions* options) {
+    if (!output) {
         CodegenWatResult result;
         result.success = 0;
         result.error_msg = "Invalid input to codegen_wat_program";
         return result;
     }
-    
-    /* Store program and source filename references for use in code emission */
+
+    OutputSink sink;
+    output_sink_init(&sink);
+    CodegenWatResult result = codegen_wat_program_to_sink(program, &sink, source_filename, options);
+    if (result.success && !output_sink_write_file(&sink, output)) {
+        result.success = 0;
+        result.error_msg = "Failed to write generated WAT code";
+    }
+    output_sink_free(&sink);
+    return result;
+}
+
+CodegenWatResult codegen_wat_program_to_sink(ASTProgram* program, OutputSink* out,
+                                             const char* source_filename,
+                                             const CodegenWatOptions* options) {
+    CodegenWatResult result;
+    result.success = 0;
+    if (!program || !out) {
+        result.error_msg = "Invalid input to codegen_wat_program";
+        return result;
+    }
+
+    if (options) {
+        g_options = *options;
+    } else {
+        g_options.debug_abi = WAT_DEBUG_ABI_CALLS;
+        g_options.strength_reduce = 0;
+        g_options.tail_calls = 0;
+        g_options.return_call = 0;
+        g_options.range_analysis = 0;
+    }
+    int buffered_dbg = g_options.debug_abi == WAT_DEBUG_ABI_BUFFERED;
+
+    /* With return_call, self tail calls stay calls like any other tail call */
+    IrModule* module = ir_lower_program(program);
+    if (g_options.tail_calls && !g_options.return_call) {
+        ir_eliminate_self_tail_calls(module);
+    }
+    char* ir_error = NULL;
+    if (!ir_verify_module(module, &ir_error)) {
+        xfree(ir_error);
+        ir_module_free(module);
+        result.error_msg = "invalid IR";
+        return result;
+    }
+
     g_current_program = program;
     g_source_filename = source_filename;
-    
-    /* Initialize debug format collection */
-    g_data_offset = 0;
+    g_ir_module = module;
+
+    /* Initialize debug format collection; format strings follow the arrays */
+    g_data_offset = layout_arrays(module);
     g_debug_format_count = 0;
-    
+    g_uses_zero_fill = 0;
+    g_uses_bounds_fail = 0;
+    int format_base = g_data_offset;
+    int has_arrays = g_data_offset > 0;
+    int has_dbg = ir_module_uses_op(module, IR_DBG);
+
     /* Emit module header */
-    fprintf(output, "(module\n");
-    
-    /* Check if there are any dbg statements that need debug support */
-    int has_dbg = 0;
-    for (int i = 0; i < program->function_count; i++) {
-        if (program->import_count > 0 && !program->functions[i].allocated_name) {
-            continue;
-        }
-        /* Check all statements in function body, including nested ones */
-        for (int j = 0; j < program->functions[i].body.statement_count; j++) {
-            if (statement_contains_dbg(&program->functions[i].body.statements[j])) {
-                has_dbg = 1;
-                break;
-            }
+    output_sink_append(out, "(module\n");
+
+    /* If there are dbg statements, emit host imports and memory */
+    if (has_dbg && buffered_dbg) {
+        output_sink_append(out, "  (import \"host\" \"debug_flush\" (func $debug_flush (param i32 i32)))\n");
+    } else if (has_dbg) {
+        output_sink_append(out, "  (import \"host\" \"debug_begin\" (func $debug_begin (param i32 i32)))\n");
+        output_sink_append(out, "  (import \"host\" \"debug_value_i32\" (func $debug_value_i32 (param i32)))\n");
+        output_sink_append(out, "  (import \"host\" \"debug_value_i64\" (func $debug_value_i64 (param i64)))\n");
+        output_sink_append(out, "  (import \"host\" \"debug_value_u32\" (func $debug_value_u32 (param i32)))\n");
+        output_sink_append(out, "  (import \"host\" \"debug_value_u64\" (func $debug_value_u64 (param i64)))\n");
+        output_sink_append(out, "  (import \"host\" \"debug_value_bool\" (func $debug_value_bool (param i32)))\n");
+        output_sink_append(out, "  (import \"host\" \"debug_end\" (func $debug_end))\n");
+
+        if (!has_arrays) {
+            output_sink_append(out, "  (memory 1)\n");
         }
-        if (has_dbg) break;
     }
-    
-    /* If there are dbg statements, emit host imports and memory */
-    if (has_dbg) {
-        fprintf(output, "  (import \"host\" \"debug_begin\" (func $debug_begin (param i32 i32)))\n");
-        fprintf(output, "  (import \"host\" \"debug_value_i32\" (func $debug_value_i32 (param i32)))\n");
-        fprintf(output, "  (import \"host\" \"debug_value_i64\" (func $debug_value_i64 (param i64)))\n");
-        fprintf(output, "  (import \"host\" \"debug_value_u32\" (func $debug_value_u32 (param i32)))\n");
-        fprintf(output, "  (import \"host\" \"debug_value_u64\" (func $debug_value_u64 (param i64)))\n");
-        fprintf(output, "  (import \"host\" \"debug_value_bool\" (func $debug_value_bool (param i32)))\n");
-        fprintf(output, "  (import \"host\" \"debug_end\" (func $debug_end))\n");
-        
-        fprintf(output, "  (memory 1)\n");
-    }
-    
+
     /* Emit function definitions (this will register debug formats as they're encountered) */
-    emit_function_definitions(output, program);
-    
-     /* Now emit data section with all collected format strings */
-     if (has_dbg && g_debug_format_count > 0) {
-         fprintf(output, "  (data (i32.const 0)");
-         for (int i = 0; i < g_debug_format_count; i++) {
-             /* Use fputs for the string literal to avoid fprintf interpreting % chars */
-             fprintf(output, " \"");
-             fputs(g_debug_formats[i].format_string, output);
-             fprintf(output, "\"");
-         }
-         fprintf(output, ")\n");
-        
+    emit_function_definitions(out, module);
+
+    /* The record buffer goes after the format strings, so it is laid out last */
+    if (has_dbg && buffered_dbg) {
+        emit_debug_buffer_runtime(out);
+    } else if (has_arrays) {
+        output_sink_append(out, "  (memory ");
+        output_sink_append_int(out, (g_data_offset + 65535) / 65536);
+        output_sink_append(out, ")\n");
+    }
+    if (has_arrays) {
+        emit_array_memory(out, module);
+    }
+    emit_scalar_globals(out, module);
+    if (g_uses_zero_fill) {
+        emit_zero_fill_helper(out);
+    }
+    if (g_uses_bounds_fail) {
+        emit_bounds_fail_helper(out);
+    }
+
+    /* Now emit data section with all collected format strings */
+    if (has_dbg && g_debug_format_count > 0) {
+        output_sink_append(out, "  (data (i32.const ");
+        output_sink_append_int(out, format_base);
+        output_sink_append(out, ")");
+        for (int i = 0; i < g_debug_format_count; i++) {
+            output_sink_append(out, " \"");
+            output_sink_append(out, g_debug_formats[i].format_string);
+            output_sink_append(out, "\"");
+        }
+        output_sink_append(out, ")\n");
+
         /* Export memory so host can access debug strings */
-        fprintf(output, "  (export \"memory\" (memory 0))\n");
+        output_sink_append(out, "  (export \"memory\" (memory 0))\n");
     }
-    
+
     /* Export the main function if it exists */
-    for (int i = 0; i < program->function_count; i++) {
-        if (program->import_count > 0 && !program->functions[i].allocated_name) {
-            continue;
-        }
-        if (strcmp(program->functions[i].name, "main") == 0) {
-            const char* func_name = program->functions[i].allocated_name ? 
-                                   program->functions[i].allocated_name : 
-                                   program->functions[i].name;
-            char* mangled_name = mangle_function_name(func_name);
-            fprintf(output, "  (export \"main\" (func $%s))\n", mangled_name);
-            xfree(mangled_name);
-            break;
+    const IrFunction* main_func = find_main_function(program);
+    if (main_func) {
+        char* mangled_name = mangle_function_name(main_func->name);
+        if (has_dbg && buffered_dbg) {
+            /* The host flushes the records left behind by a trap */
+            emit_debug_buffer_entry(out, main_func, mangled_name);
+            output_sink_append(out, "  (export \"main\" (func $__casm_main))\n");
+            output_sink_append(out, "  (export \"__dbg_flush\" (func $__dbg_flush))\n");
+        } else {
+            output_sink_append(out, "  (export \"main\" (func $");
+            output_sink_append(out, mangled_name);
+            output_sink_append(out, "))\n");
         }
+        xfree(mangled_name);
     }
-    
+
     /* Close module */
-    fprintf(output, ")\n");
-    
+    output_sink_append(out, ")\n");
+
+    xfree(g_global_offsets);
+    g_global_offsets = NULL;
+    xfree(g_array_offsets);
+    g_array_offsets = NULL;
+
     /* Clean up debug format strings */
     for (int i = 0; i < g_debug_format_count; i++) {
         xfree(g_debug_formats[i].format_string);
-        xfree(g_debug_formats[i].arg_types);
     }
     xfree(g_debug_formats);
     g_debug_formats = NULL;
     g_debug_format_count = 0;
     g_debug_format_capacity = 0;
-    
-    /* Clear global reference */
+
     g_current_program = NULL;
-    
-    CodegenWatResult result;
+    g_ir_module = NULL;
+    ir_module_free(module);
+
     result.success = 1;
     result.error_msg = NULL;
     return result;
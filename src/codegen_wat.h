@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include "ast.h"
 #include "types.h"
+#include "output_sink.h"
 
 /* Result of WAT code generation */
 typedef struct {
@@ -11,8 +12,46 @@ typedef struct {
     char* error_msg;    /* Error message if failed (NULL if success) */
 } CodegenWatResult;
 
-/* Generate WebAssembly text format from AST and write to file.
+/* How dbg() values are handed to the host */
+typedef enum {
+    /* debug_begin(fmt, len), one debug_value_<type>(v) per argument, debug_end()
+     * for every dbg statement. Format placeholders are "%" ("%%" escapes). */
+    WAT_DEBUG_ABI_CALLS,
+
+    /* Each dbg statement appends a record to a buffer in linear memory:
+     *   i32 format offset, i32 format length, then one i64 per argument
+     * (i32 values sign- or zero-extended). Placeholders are typed: "%d"
+     * signed, "%u" unsigned, "%b" bool ("%%" escapes). The buffer is passed
+     * to debug_flush(ptr, len) when it is full and when main returns. The
+     * module exports "__dbg_flush", which a host calls after a trap to get
+     * the records not yet flushed. */
+    WAT_DEBUG_ABI_BUFFERED
+} WatDebugAbi;
+
+/* Options for WAT code generation */
+typedef struct {
+    WatDebugAbi debug_abi;
+    int strength_reduce;    /* Rewrite constant multiply/divide/remainder (-O1 and up) */
+    int tail_calls;         /* Turn self tail calls into loops (-O1 and up) */
+    int return_call;        /* Use return_call for calls in tail position instead
+                             * (needs the wasm tail-call feature) */
+    int range_analysis;     /* Skip i8/i16/u8/u16 wraps on conversions proven
+                             * in range (-O1 and up) */
+} CodegenWatOptions;
+
+/* Lower an analyzed program to the IR, generate WebAssembly text format
+ * from it and write to file.
  * source_filename is used in debug output (typically the .csm filename). */
 CodegenWatResult codegen_wat_program(ASTProgram* program, FILE* output, const char* source_filename);
 
+/* Same as codegen_wat_program with explicit options (NULL = defaults) */
+CodegenWatResult codegen_wat_program_with_options(ASTProgram* program, FILE* output,
+                                                  const char* source_filename,
+                                                  const CodegenWatOptions* options);
+
+/* Generate WAT into an in-memory sink (appends to its contents) */
+CodegenWatResult codegen_wat_program_to_sink(ASTProgram* program, OutputSink* output,
+                                             const char* source_filename,
+                                             const CodegenWatOptions* options);
+
 #endif /* CODEGEN_WAT_H */
@@ -0,0 +1,1188 @@
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "codegen_x86.h"
+#include "ir.h"
+#include "types.h"
+#include "x86_regalloc.h"
+#include "utils.h"
+
+/* Lowering from the SSA IR to x86-64 assembly.
+ *
+ * Every value is kept as a full 64-bit register (or stack slot) in a
+ * canonical form: signed types sign-extended, unsigned types
+ * zero-extended, bools 0 or 1. That makes one 64-bit compare correct for
+ * every type and means arithmetic only has to re-wrap its 32-bit results.
+ * rax, rcx and rdx are scratch; everything else comes from
+ * x86_regalloc. */
+
+/* Global variable to track source filename for dbg output */
+static const char* g_source_filename = "unknown.csm";
+
+/* dbg text pieces, emitted into .rodata after all functions */
+static OutputSink g_rodata;
+static int g_string_count = 0;
+
+/* State for the function being generated */
+static const IrFunction* g_func = NULL;
+static const X86Allocation* g_alloc = NULL;
+static int g_func_index = 0;
+static int g_saved_count = 0;           /* Callee-saved registers in the frame */
+static X86Reg g_saved_regs[X86_REG_COUNT];
+static int* g_use_counts = NULL;
+static const IrModule* g_module = NULL;
+static int* g_array_offsets = NULL;     /* rbp offset of each local array */
+
+/* SysV integer argument registers */
+static const X86Reg g_arg_regs[6] = { X86_RDI, X86_RSI, X86_RDX, X86_RCX, X86_R8, X86_R9 };
+
+/* Longest piece of dbg text handed to the runtime at once (its buffer is 64 KiB) */
+#define DBG_TEXT_CHUNK 4096
+
+/* dbg() output runtime. Lines are formatted straight into a static buffer
+ * that is written to stdout when it fills and when main returns; all
+ * routines only touch the registers a SysV callee may clobber. */
+static const char* const g_runtime =
+    "\n"
+    "    .bss\n"
+    "    .p2align 4\n"
+    "__casm_dbg_buf:\n"
+    "    .skip 65536\n"
+    "__casm_dbg_len:\n"
+    "    .skip 8\n"
+    "\n"
+    "    .section .rodata\n"
+    "__casm_true:\n"
+    "    .ascii \"true\"\n"
+    "__casm_false:\n"
+    "    .ascii \"false\"\n"
+    "\n"
+    "    .text\n"
+    "# Write the buffered dbg output to stdout\n"
+    "__casm_dbg_flush:\n"
+    "    movq __casm_dbg_len(%rip), %rdx\n"
+    "    leaq __casm_dbg_buf(%rip), %rsi\n"
+    "1:\n"
+    "    testq %rdx, %rdx\n"
+    "    jz 2f\n"
+    "    movl $1, %edi\n"
+    "    movl $1, %eax\n"
+    "    syscall\n"
+    "    testq %rax, %rax\n"
+    "    jle 2f\n"
+    "    addq %rax, %rsi\n"
+    "    subq %rax, %rdx\n"
+    "    jmp 1b\n"
+    "2:\n"
+    "    movq $0, __casm_dbg_len(%rip)\n"
+    "    ret\n"
+    "\n"
+    "# Append rsi bytes at rdi (at most the buffer size)\n"
+    "__casm_dbg_str:\n"
+    "    movq __casm_dbg_len(%rip), %rax\n"
+    "    leaq (%rax,%rsi), %rdx\n"
+    "    cmpq $65536, %rdx\n"
+    "    jbe 1f\n"
+    "    pushq %rdi\n"
+    "    pushq %rsi\n"
+    "    call __casm_dbg_flush\n"
+    "    popq %rsi\n"
+    "    popq %rdi\n"
+    "    xorl %eax, %eax\n"
+    "1:\n"
+    "    leaq __casm_dbg_buf(%rip), %rdx\n"
+    "    addq %rax, %rdx\n"
+    "    addq %rsi, %rax\n"
+    "    movq %rax, __casm_dbg_len(%rip)\n"
+    "    movq %rsi, %rcx\n"
+    "    movq %rdi, %rsi\n"
+    "    movq %rdx, %rdi\n"
+    "    rep movsb\n"
+    "    ret\n"
+    "\n"
+    "# Append rdi in decimal, as a signed or unsigned 64-bit value\n"
+    "__casm_dbg_i64:\n"
+    "    xorl %r8d, %r8d\n"
+    "    testq %rdi, %rdi\n"
+    "    jns 1f\n"
+    "    negq %rdi\n"
+    "    movl $1, %r8d\n"
+    "    jmp 1f\n"
+    "__casm_dbg_u64:\n"
+    "    xorl %r8d, %r8d\n"
+    "1:\n"
+    "    subq $40, %rsp\n"
+    "    leaq 32(%rsp), %rsi\n"
+    "    movq %rdi, %rax\n"
+    "    movl $10, %ecx\n"
+    "2:\n"
+    "    xorl %edx, %edx\n"
+    "    divq %rcx\n"
+    "    addb $48, %dl\n"
+    "    decq %rsi\n"
+    "    movb %dl, (%rsi)\n"
+    "    testq %rax, %rax\n"
+    "    jnz 2b\n"
+    "    testl %r8d, %r8d\n"
+    "    jz 3f\n"
+    "    decq %rsi\n"
+    "    movb $45, (%rsi)\n"
+    "3:\n"
+    "    movq %rsi, %rdi\n"
+    "    leaq 32(%rsp), %rsi\n"
+    "    subq %rdi, %rsi\n"
+    "    call __casm_dbg_str\n"
+    "    addq $40, %rsp\n"
+    "    ret\n"
+    "\n"
+    "# Append \"true\" or \"false\"\n"
+    "__casm_dbg_bool:\n"
+    "    testq %rdi, %rdi\n"
+    "    jz 1f\n"
+    "    leaq __casm_true(%rip), %rdi\n"
+    "    movl $4, %esi\n"
+    "    jmp __casm_dbg_str\n"
+    "1:\n"
+    "    leaq __casm_false(%rip), %rdi\n"
+    "    movl $5, %esi\n"
+    "    jmp __casm_dbg_str\n"
+    "\n"
+    "# Runtime traps: flush dbg output, report on stderr, exit(1)\n"
+    "__casm_bounds_fail:\n"
+    "    leaq __casm_bounds_msg(%rip), %rsi\n"
+    "    movl $33, %edx\n"
+    "    jmp __casm_trap\n"
+    "__casm_div_zero_fail:\n"
+    "    leaq __casm_div_zero_msg(%rip), %rsi\n"
+    "    movl $32, %edx\n"
+    "    jmp __casm_trap\n"
+    "__casm_overflow_fail:\n"
+    "    leaq __casm_overflow_msg(%rip), %rsi\n"
+    "    movl $24, %edx\n"
+    "__casm_trap:\n"
+    "    pushq %rsi\n"
+    "    pushq %rdx\n"
+    "    call __casm_dbg_flush\n"
+    "    popq %rdx\n"
+    "    popq %rsi\n"
+    "    movl $2, %edi\n"
+    "    movl $1, %eax\n"
+    "    syscall\n"
+    "    movl $1, %edi\n"
+    "    movl $60, %eax\n"
+    "    syscall\n"
+    "\n"
+    "    .section .rodata\n"
+    "__casm_bounds_msg:\n"
+    "    .ascii \"Error: array index out of bounds\\n\"\n"
+    "__casm_div_zero_msg:\n"
+    "    .ascii \"Error: integer division by zero\\n\"\n"
+    "__casm_overflow_msg:\n"
+    "    .ascii \"Error: integer overflow\\n\"\n"
+    "    .text\n";
+
+/* Helper: Append one formatted instruction line */
+static void emit(OutputSink* out, const char* format, ...) {
+    char buf[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    output_sink_append(out, "    ");
+    output_sink_append(out, buf);
+    output_sink_append_char(out, '\n');
+}
+
+/* Helper: Check if a type is a signed integer */
+static int is_signed_type(CasmType type) {
+    return type == TYPE_I8 || type == TYPE_I16 || type == TYPE_I32 || type == TYPE_I64;
+}
+
+/* Helper: Location of a value */
+static const X86Location* location_of(int value) {
+    return &g_alloc->locations[value];
+}
+
+/* Helper: Whether a location is the given register */
+static int is_reg(const X86Location* loc, X86Reg reg) {
+    return loc->kind == X86_LOC_REG && loc->reg == reg;
+}
+
+/* Helper: Whether two locations are the same register or slot */
+static int same_location(const X86Location* a, const X86Location* b) {
+    if (a->kind != b->kind) return 0;
+    if (a->kind == X86_LOC_REG) return a->reg == b->reg;
+    if (a->kind == X86_LOC_STACK) return a->slot == b->slot;
+    return 0;
+}
+
+/* Helper: Format a location as an AT&T operand */
+static const char* operand(const X86Location* loc, char* buf, size_t size) {
+    switch (loc->kind) {
+        case X86_LOC_REG:
+            snprintf(buf, size, "%%%s", x86_reg_name(loc->reg, 64));
+            break;
+        case X86_LOC_STACK:
+            snprintf(buf, size, "%d(%%rbp)", -8 * (g_saved_count + loc->slot + 1));
+            break;
+        case X86_LOC_IMM:
+            snprintf(buf, size, "$%lld", loc->imm);
+            break;
+        default:
+            snprintf(buf, size, "$0");
+            break;
+    }
+    return buf;
+}
+
+/* Helper: Load a location into a register */
+static void emit_load(OutputSink* out, X86Reg reg, const X86Location* src) {
+    char buf[32];
+    if (is_reg(src, reg)) return;
+    if (src->kind == X86_LOC_IMM && src->imm == 0) {
+        emit(out, "xorl %%%s, %%%s", x86_reg_name(reg, 32), x86_reg_name(reg, 32));
+        return;
+    }
+    emit(out, "movq %s, %%%s", operand(src, buf, sizeof(buf)), x86_reg_name(reg, 64));
+}
+
+/* Helper: Store a register into a location */
+static void emit_store(OutputSink* out, const X86Location* dst, X86Reg reg) {
+    char buf[32];
+    if (dst->kind != X86_LOC_REG && dst->kind != X86_LOC_STACK) return;
+    if (is_reg(dst, reg)) return;
+    emit(out, "movq %%%s, %s", x86_reg_name(reg, 64), operand(dst, buf, sizeof(buf)));
+}
+
+/* Helper: Copy between locations */
+static void emit_move(OutputSink* out, const X86Location* dst, const X86Location* src) {
+    char a[32], b[32];
+    if (same_location(dst, src)) return;
+    if (dst->kind == X86_LOC_REG) {
+        emit_load(out, dst->reg, src);
+    } else if (src->kind == X86_LOC_STACK) {
+        emit_load(out, X86_RAX, src);
+        emit_store(out, dst, X86_RAX);
+    } else {
+        emit(out, "movq %s, %s", operand(src, a, sizeof(a)), operand(dst, b, sizeof(b)));
+    }
+}
+
+/* Helper: Re-establish the canonical 64-bit form of a register after an
+ * operation whose result has the given type */
+static void emit_normalize(OutputSink* out, X86Reg reg, CasmType type) {
+    const char* r64 = x86_reg_name(reg, 64);
+    const char* r32 = x86_reg_name(reg, 32);
+    switch (type) {
+        case TYPE_I8:  emit(out, "movsbq %%%s, %%%s", x86_reg_name(reg, 8), r64); break;
+        case TYPE_I16: emit(out, "movswq %%%s, %%%s", x86_reg_name(reg, 16), r64); break;
+        case TYPE_I32: emit(out, "movslq %%%s, %%%s", r32, r64); break;
+        case TYPE_U8:  emit(out, "movzbl %%%s, %%%s", x86_reg_name(reg, 8), r32); break;
+        case TYPE_U16: emit(out, "movzwl %%%s, %%%s", x86_reg_name(reg, 16), r32); break;
+        case TYPE_U32: emit(out, "movl %%%s, %%%s", r32, r32); break;
+        case TYPE_BOOL:
+            emit(out, "testq %%%s, %%%s", r64, r64);
+            emit(out, "setne %%%s", x86_reg_name(reg, 8));
+            emit(out, "movzbl %%%s, %%%s", x86_reg_name(reg, 8), r32);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Helper: Zero-extend a canonical value of a signed type from its width */
+static void emit_zero_extend(OutputSink* out, X86Reg reg, CasmType type) {
+    switch (type) {
+        case TYPE_I8:  emit_normalize(out, reg, TYPE_U8); break;
+        case TYPE_I16: emit_normalize(out, reg, TYPE_U16); break;
+        case TYPE_I32: emit_normalize(out, reg, TYPE_U32); break;
+        default:       break;
+    }
+}
+
+/* Helper: Operand-size suffix for a width in bits */
+static const char* size_suffix(int bits) {
+    return bits == 8 ? "b" : bits == 16 ? "w" : bits == 32 ? "l" : "q";
+}
+
+/* Helper: 64-bit mnemonic of a two-operand ALU instruction */
+static const char* alu_mnemonic(IrOpcode op) {
+    switch (op) {
+        case IR_ADD: return "addq";
+        case IR_SUB: return "subq";
+        case IR_MUL: return "imulq";
+        case IR_AND: return "andq";
+        case IR_OR:  return "orq";
+        default:     return "xorq";
+    }
+}
+
+/* Helper: Mnemonic (without size suffix) of a shift or rotate */
+static const char* shift_mnemonic(IrOpcode op, CasmType type) {
+    switch (op) {
+        case IR_SHL:  return "shl";
+        case IR_ROTL: return "rol";
+        case IR_ROTR: return "ror";
+        default:      return is_signed_type(type) ? "sar" : "shr";
+    }
+}
+
+/* Helper: Register to compute a result in: the destination register when
+ * it is not also the right operand, else rax */
+static X86Reg work_register(const X86Location* dst, const X86Location* rhs) {
+    if (dst->kind == X86_LOC_REG && !(rhs && is_reg(rhs, dst->reg))) return dst->reg;
+    return X86_RAX;
+}
+
+/* A copy into a location, one of a set performed simultaneously */
+typedef struct {
+    X86Location dst;
+    X86Location src;
+} X86Move;
+
+/* Helper: Perform copies as if all sources were read before any
+ * destination is written. Without overlaps they are plain moves;
+ * otherwise every source goes through the stack. */
+static void emit_parallel_moves(OutputSink* out, const X86Move* moves, int count) {
+    char buf[32];
+    int overlap = 0;
+    for (int i = 0; i < count && !overlap; i++) {
+        for (int j = 0; j < count; j++) {
+            if (i != j && same_location(&moves[i].dst, &moves[j].src)) {
+                overlap = 1;
+                break;
+            }
+        }
+    }
+
+    if (!overlap) {
+        for (int i = 0; i < count; i++) {
+            emit_move(out, &moves[i].dst, &moves[i].src);
+        }
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        emit(out, "pushq %s", operand(&moves[i].src, buf, sizeof(buf)));
+    }
+    for (int i = count - 1; i >= 0; i--) {
+        emit(out, "popq %s", operand(&moves[i].dst, buf, sizeof(buf)));
+    }
+}
+
+/* Helper: Collect the phi copies for the edge from `from` to `to`.
+ * `nth` picks the edge when both branch targets are the same block. */
+static int collect_edge_moves(int from, int to, int nth, X86Move** out_moves) {
+    const IrBlock* target = &g_func->blocks[to];
+    int pred = -1;
+    for (int i = 0; i < target->pred_count; i++) {
+        if (target->preds[i] == from && nth-- == 0) {
+            pred = i;
+            break;
+        }
+    }
+
+    X86Move* moves = xmalloc((target->instr_count + 1) * sizeof(X86Move));
+    int count = 0;
+    for (int i = 0; i < target->instr_count && pred >= 0; i++) {
+        const IrInstr* phi = &g_func->values[target->instrs[i]];
+        if (phi->op != IR_PHI) break;
+        if (pred >= phi->arg_count) continue;
+        const X86Location* dst = location_of(target->instrs[i]);
+        const X86Location* src = location_of(phi->args[pred]);
+        if (dst->kind == X86_LOC_NONE || dst->kind == X86_LOC_IMM || same_location(dst, src)) continue;
+        moves[count].dst = *dst;
+        moves[count].src = *src;
+        count++;
+    }
+    *out_moves = moves;
+    return count;
+}
+
+/* Helper: Condition code suffix for a comparison */
+static const char* condition_code(IrOpcode op, int is_signed, int negate) {
+    if (negate) {
+        switch (op) {
+            case IR_EQ: op = IR_NE; break;
+            case IR_NE: op = IR_EQ; break;
+            case IR_LT: op = IR_GE; break;
+            case IR_GE: op = IR_LT; break;
+            case IR_GT: op = IR_LE; break;
+            case IR_LE: op = IR_GT; break;
+            default: break;
+        }
+    }
+    switch (op) {
+        case IR_EQ: return "e";
+        case IR_NE: return "ne";
+        case IR_LT: return is_signed ? "l" : "b";
+        case IR_GT: return is_signed ? "g" : "a";
+        case IR_LE: return is_signed ? "le" : "be";
+        case IR_GE: return is_signed ? "ge" : "ae";
+        default:    return "ne";
+    }
+}
+
+/* Helper: Set flags for `lhs ? rhs` */
+static void emit_compare(OutputSink* out, const X86Location* lhs, const X86Location* rhs) {
+    char a[32], b[32];
+    if (lhs->kind == X86_LOC_REG ||
+        (lhs->kind == X86_LOC_STACK && rhs->kind != X86_LOC_STACK)) {
+        emit(out, "cmpq %s, %s", operand(rhs, b, sizeof(b)), operand(lhs, a, sizeof(a)));
+    } else {
+        emit_load(out, X86_RAX, lhs);
+        emit(out, "cmpq %s, %%rax", operand(rhs, b, sizeof(b)));
+    }
+}
+
+/* Helper: Whether a comparison is only used by its block's branch, right
+ * after it, so it can set the flags for the jump directly */
+static int is_fused_compare(int value) {
+    const IrInstr* instr = &g_func->values[value];
+    if (instr->op < IR_EQ || instr->op > IR_GE) return 0;
+    const IrBlock* block = &g_func->blocks[instr->block];
+    return block->term.kind == IR_TERM_BRANCH && block->term.value == value &&
+           block->instrs[block->instr_count - 1] == value && g_use_counts[value] == 1;
+}
+
+/* Helper: Write a piece of dbg text into .rodata and return its label number */
+static int add_string(const char* text, size_t len) {
+    int id = g_string_count++;
+    char label[32];
+    snprintf(label, sizeof(label), ".Lstr%d:\n", id);
+    output_sink_append(&g_rodata, label);
+    output_sink_append(&g_rodata, "    .ascii \"");
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '"' || c == '\\') {
+            output_sink_append_char(&g_rodata, '\\');
+            output_sink_append_char(&g_rodata, (char)c);
+        } else if (c == '\n') {
+            output_sink_append(&g_rodata, "\\n");
+        } else if (c < 32 || c >= 127) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\%03o", c);
+            output_sink_append(&g_rodata, esc);
+        } else {
+            output_sink_append_char(&g_rodata, (char)c);
+        }
+    }
+    output_sink_append(&g_rodata, "\"\n");
+    return id;
+}
+
+/* Helper: Emit calls appending a piece of literal dbg text */
+static void emit_dbg_text(OutputSink* out, const char* text, size_t len) {
+    for (size_t done = 0; done < len; done += DBG_TEXT_CHUNK) {
+        size_t n = len - done < DBG_TEXT_CHUNK ? len - done : DBG_TEXT_CHUNK;
+        int id = add_string(text + done, n);
+        emit(out, "leaq .Lstr%d(%%rip), %%rdi", id);
+        emit(out, "movl $%d, %%esi", (int)n);
+        emit(out, "call __casm_dbg_str");
+    }
+}
+
+/* Emit a dbg statement: "file:line:col: name = value, ...\n", with the
+ * same labels as the C backend. The values are parked on the stack first
+ * since the runtime calls clobber the caller-saved registers. */
+static void emit_dbg(OutputSink* out, const IrInstr* instr) {
+    const ASTDbgStmt* dbg = instr->dbg;
+    int count = instr->arg_count;
+    int slots = (count + 1) & ~1;
+    char buf[32];
+
+    if (slots > 0) {
+        emit(out, "subq $%d, %%rsp", 8 * slots);
+        for (int i = 0; i < count; i++) {
+            const X86Location* src = location_of(instr->args[i]);
+            if (src->kind == X86_LOC_STACK) {
+                emit_load(out, X86_RAX, src);
+                emit(out, "movq %%rax, %d(%%rsp)", 8 * i);
+            } else {
+                emit(out, "movq %s, %d(%%rsp)", operand(src, buf, sizeof(buf)), 8 * i);
+            }
+        }
+    }
+
+    char prefix[512];
+    snprintf(prefix, sizeof(prefix), "%s:%d:%d: ",
+             g_source_filename, dbg->location.line, dbg->location.column);
+    for (int i = 0; i < count; i++) {
+        const char* name = NULL;
+        char fallback[32];
+        if (dbg->arg_names[i] && strlen(dbg->arg_names[i]) > 0) {
+            name = dbg->arg_names[i];
+        } else {
+            snprintf(fallback, sizeof(fallback), "arg%d", i);
+            name = fallback;
+        }
+
+        size_t len = strlen(prefix) + strlen(name) + 3;
+        char* piece = xmalloc(len + 1);
+        snprintf(piece, len + 1, "%s%s = ", prefix, name);
+        emit_dbg_text(out, piece, len);
+        xfree(piece);
+        snprintf(prefix, sizeof(prefix), ", ");
+
+        CasmType type = g_func->values[instr->args[i]].type;
+        emit(out, "movq %d(%%rsp), %%rdi", 8 * i);
+        emit(out, "call %s", type == TYPE_BOOL ? "__casm_dbg_bool" :
+                             is_signed_type(type) ? "__casm_dbg_i64" : "__casm_dbg_u64");
+    }
+
+    if (count == 0) {
+        char line[520];
+        snprintf(line, sizeof(line), "%s\n", prefix);
+        emit_dbg_text(out, line, strlen(line));
+    } else {
+        emit_dbg_text(out, "\n", 1);
+    }
+
+    if (slots > 0) {
+        emit(out, "addq $%d, %%rsp", 8 * slots);
+    }
+}
+
+/* Emit a call: SysV argument registers, the rest on the stack (keeping
+ * rsp 16-byte aligned), result in rax */
+static void emit_call(OutputSink* out, int value, const IrInstr* instr) {
+    char buf[32];
+    int count = instr->arg_count;
+    int stack_args = count > 6 ? count - 6 : 0;
+    int padding = stack_args % 2;
+
+    if (padding) {
+        emit(out, "subq $8, %%rsp");
+    }
+    for (int i = count - 1; i >= 6; i--) {
+        emit(out, "pushq %s", operand(location_of(instr->args[i]), buf, sizeof(buf)));
+    }
+
+    X86Move moves[6];
+    int move_count = 0;
+    for (int i = 0; i < count && i < 6; i++) {
+        moves[move_count].dst.kind = X86_LOC_REG;
+        moves[move_count].dst.reg = g_arg_regs[i];
+        moves[move_count].dst.slot = -1;
+        moves[move_count].dst.imm = 0;
+        moves[move_count].src = *location_of(instr->args[i]);
+        if (!same_location(&moves[move_count].dst, &moves[move_count].src)) move_count++;
+    }
+    emit_parallel_moves(out, moves, move_count);
+
+    emit(out, "call %s", instr->callee);
+    if (stack_args + padding > 0) {
+        emit(out, "addq $%d, %%rsp", 8 * (stack_args + padding));
+    }
+    if (instr->type != TYPE_VOID) {
+        emit_store(out, location_of(value), X86_RAX);
+    }
+}
+
+/* Helper: Size in bytes of an array element */
+static int element_size(CasmType type) {
+    switch (type) {
+        case TYPE_I8:
+        case TYPE_U8:
+        case TYPE_BOOL: return 1;
+        case TYPE_I16:
+        case TYPE_U16:  return 2;
+        case TYPE_I32:
+        case TYPE_U32:  return 4;
+        default:        return 8;
+    }
+}
+
+/* Helper: Directive emitting one element of the given type */
+static const char* element_directive(CasmType type) {
+    switch (element_size(type)) {
+        case 1:  return ".byte";
+        case 2:  return ".short";
+        case 4:  return ".long";
+        default: return ".quad";
+    }
+}
+
+/* Helper: Append an array's initial contents as data directives */
+static void emit_array_data(OutputSink* out, const IrArray* array) {
+    for (int i = 0; i < array->init_count; i++) {
+        emit(out, "%s %lld", element_directive(array->elem_type), array->init[i]);
+    }
+    int rest = array->length - array->init_count;
+    if (rest > 0) {
+        emit(out, ".zero %d", rest * element_size(array->elem_type));
+    }
+}
+
+/* Helper: Put the index operand of an array access in rcx and return the
+ * memory operand of the element; global arrays are addressed through rax */
+static const char* element_operand(OutputSink* out, long long array_ref, int index,
+                                   char* buf, size_t size) {
+    const IrArray* array = ir_array_ref(g_module, g_func, array_ref);
+    emit_load(out, X86_RCX, location_of(index));
+    int scale = element_size(array->elem_type);
+    if (IR_IS_GLOBAL_ARRAY(array_ref)) {
+        emit(out, "leaq .Lglobal%d(%%rip), %%rax", IR_ARRAY_INDEX(array_ref));
+        snprintf(buf, size, "(%%rax,%%rcx,%d)", scale);
+    } else {
+        snprintf(buf, size, "%d(%%rbp,%%rcx,%d)", g_array_offsets[array_ref], scale);
+    }
+    return buf;
+}
+
+/* Emit one instruction */
+static void emit_instruction(OutputSink* out, int value) {
+    const IrInstr* instr = &g_func->values[value];
+    const X86Location* dst = location_of(value);
+    char buf[32];
+
+    switch (instr->op) {
+        case IR_CONST:
+            if (dst->kind == X86_LOC_REG) {
+                emit(out, "movabsq $%lld, %%%s", instr->imm, x86_reg_name(dst->reg, 64));
+            } else if (dst->kind == X86_LOC_STACK) {
+                emit(out, "movabsq $%lld, %%rax", instr->imm);
+                emit_store(out, dst, X86_RAX);
+            }
+            break;
+
+        case IR_PARAM:      /* Moved into place by the prologue */
+        case IR_UNDEF:
+        case IR_PHI:        /* Written by the predecessors' edge copies */
+            break;
+
+        case IR_CONV: {
+            X86Reg work = work_register(dst, NULL);
+            emit_load(out, work, location_of(instr->args[0]));
+            emit_normalize(out, work, instr->type);
+            emit_store(out, dst, work);
+            break;
+        }
+
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_AND:
+        case IR_OR:
+        case IR_XOR: {
+            const X86Location* lhs = location_of(instr->args[0]);
+            const X86Location* rhs = location_of(instr->args[1]);
+            /* Commutative: let the destination register take the left side */
+            if (instr->op != IR_SUB && dst->kind == X86_LOC_REG && is_reg(rhs, dst->reg)) {
+                const X86Location* tmp = lhs;
+                lhs = rhs;
+                rhs = tmp;
+            }
+            X86Reg work = work_register(dst, rhs);
+            emit_load(out, work, lhs);
+            emit(out, "%s %s, %%%s", alu_mnemonic(instr->op), operand(rhs, buf, sizeof(buf)),
+                 x86_reg_name(work, 64));
+            /* Bitwise results of canonical operands are already canonical */
+            if (instr->op == IR_ADD || instr->op == IR_SUB || instr->op == IR_MUL) {
+                emit_normalize(out, work, instr->type);
+            }
+            emit_store(out, dst, work);
+            break;
+        }
+
+        case IR_SHL:
+        case IR_SHR:
+        case IR_ROTL:
+        case IR_ROTR: {
+            /* Shifts run at 32 or 64 bits and rotates at the type's own
+             * width; the hardware masks a %cl count like the IR does */
+            const X86Location* count = location_of(instr->args[1]);
+            int bits = get_type_size_bits(instr->type);
+            int rotate = instr->op == IR_ROTL || instr->op == IR_ROTR;
+            int width = rotate ? bits : (bits == 64 ? 64 : 32);
+            char mnemonic[8];
+            snprintf(mnemonic, sizeof(mnemonic), "%s%s", shift_mnemonic(instr->op, instr->type),
+                     size_suffix(width));
+            X86Reg work = work_register(dst, NULL);
+            if (count->kind == X86_LOC_IMM) {
+                emit_load(out, work, location_of(instr->args[0]));
+                emit(out, "%s $%lld, %%%s", mnemonic, count->imm & (width == 64 ? 63 : 31),
+                     x86_reg_name(work, width));
+            } else {
+                emit_load(out, X86_RCX, count);
+                emit_load(out, work, location_of(instr->args[0]));
+                emit(out, "%s %%cl, %%%s", mnemonic, x86_reg_name(work, width));
+            }
+            /* 32-bit operations already zero-extend */
+            if (instr->type != TYPE_U32) {
+                emit_normalize(out, work, instr->type);
+            }
+            emit_store(out, dst, work);
+            break;
+        }
+
+        case IR_POPCOUNT:
+        case IR_CLZ:
+        case IR_CTZ: {
+            X86Reg work = work_register(dst, NULL);
+            const char* r64 = x86_reg_name(work, 64);
+            int bits = get_type_size_bits(instr->type);
+            emit_load(out, work, location_of(instr->args[0]));
+            if (instr->op == IR_POPCOUNT) {
+                emit_zero_extend(out, work, instr->type);
+                emit(out, "popcntq %%%s, %%%s", r64, r64);
+            } else if (instr->op == IR_CLZ) {
+                /* clz = width - 1 - index of the top bit, with index -1 for 0 */
+                emit_zero_extend(out, work, instr->type);
+                emit(out, "movq $-1, %%rcx");
+                emit(out, "bsrq %%%s, %%%s", r64, r64);
+                emit(out, "cmovzq %%rcx, %%%s", r64);
+                emit(out, "negq %%%s", r64);
+                emit(out, "addq $%d, %%%s", bits - 1, r64);
+            } else {
+                /* The low bits of a sign-extended value are its own */
+                emit(out, "movl $%d, %%ecx", bits);
+                emit(out, "bsfq %%%s, %%%s", r64, r64);
+                emit(out, "cmovzq %%rcx, %%%s", r64);
+            }
+            emit_store(out, dst, work);
+            break;
+        }
+
+        case IR_DIV:
+        case IR_MOD: {
+            /* Unlike the hardware, division by zero and signed overflow
+             * trap with a message, and x % -1 is 0 */
+            const X86Location* rhs = location_of(instr->args[1]);
+            int is_signed = is_signed_type(instr->type);
+            emit_load(out, X86_RAX, location_of(instr->args[0]));
+            const char* divisor = operand(rhs, buf, sizeof(buf));
+            if (rhs->kind == X86_LOC_IMM) {
+                if (rhs->imm == 0) {
+                    emit(out, "jmp __casm_div_zero_fail");
+                    break;
+                }
+                emit_load(out, X86_RCX, rhs);
+                divisor = "%rcx";
+            } else {
+                emit(out, "cmpq $0, %s", divisor);
+                emit(out, "je __casm_div_zero_fail");
+            }
+            /* A divisor of -1 negates instead; only the minimum i32 or
+             * i64 overflows, a narrower result wraps when normalized */
+            int check_minus_one = is_signed && (rhs->kind != X86_LOC_IMM || rhs->imm == -1);
+            if (check_minus_one) {
+                emit(out, "cmpq $-1, %s", divisor);
+                emit(out, "jne 1f");
+                if (instr->op == IR_MOD) {
+                    emit(out, "xorl %%edx, %%edx");
+                } else {
+                    if (instr->type == TYPE_I64) {
+                        emit(out, "movabsq $%lld, %%rdx", LLONG_MIN);
+                        emit(out, "cmpq %%rdx, %%rax");
+                        emit(out, "je __casm_overflow_fail");
+                    } else if (instr->type == TYPE_I32) {
+                        emit(out, "cmpq $%d, %%rax", INT_MIN);
+                        emit(out, "je __casm_overflow_fail");
+                    }
+                    emit(out, "negq %%rax");
+                }
+                emit(out, "jmp 2f");
+                output_sink_append(out, "1:\n");
+            }
+            if (is_signed) {
+                emit(out, "cqto");
+                emit(out, "idivq %s", divisor);
+            } else {
+                emit(out, "xorl %%edx, %%edx");
+                emit(out, "divq %s", divisor);
+            }
+            if (check_minus_one) {
+                output_sink_append(out, "2:\n");
+            }
+            X86Reg result = instr->op == IR_DIV ? X86_RAX : X86_RDX;
+            emit_normalize(out, result, instr->type);
+            emit_store(out, dst, result);
+            break;
+        }
+
+        case IR_NEG:
+        case IR_NOT: {
+            X86Reg work = work_register(dst, NULL);
+            emit_load(out, work, location_of(instr->args[0]));
+            if (instr->op == IR_NEG) {
+                emit(out, "negq %%%s", x86_reg_name(work, 64));
+                emit_normalize(out, work, instr->type);
+            } else {
+                emit(out, "xorq $1, %%%s", x86_reg_name(work, 64));
+            }
+            emit_store(out, dst, work);
+            break;
+        }
+
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_GT:
+        case IR_LE:
+        case IR_GE: {
+            if (is_fused_compare(value)) break;
+            int is_signed = is_signed_type(g_func->values[instr->args[0]].type);
+            emit_compare(out, location_of(instr->args[0]), location_of(instr->args[1]));
+            X86Reg work = dst->kind == X86_LOC_REG ? dst->reg : X86_RAX;
+            emit(out, "set%s %%%s", condition_code(instr->op, is_signed, 0), x86_reg_name(work, 8));
+            emit(out, "movzbl %%%s, %%%s", x86_reg_name(work, 8), x86_reg_name(work, 32));
+            emit_store(out, dst, work);
+            break;
+        }
+
+        case IR_CALL:
+            emit_call(out, value, instr);
+            break;
+
+        case IR_DBG:
+            emit_dbg(out, instr);
+            break;
+
+        case IR_LOAD: {
+            char mem[48];
+            element_operand(out, instr->imm, instr->args[0], mem, sizeof(mem));
+            X86Reg work = work_register(dst, NULL);
+            const char* r64 = x86_reg_name(work, 64);
+            const char* r32 = x86_reg_name(work, 32);
+            switch (instr->type) {
+                case TYPE_I8:  emit(out, "movsbq %s, %%%s", mem, r64); break;
+                case TYPE_I16: emit(out, "movswq %s, %%%s", mem, r64); break;
+                case TYPE_I32: emit(out, "movslq %s, %%%s", mem, r64); break;
+                case TYPE_U8:
+                case TYPE_BOOL: emit(out, "movzbl %s, %%%s", mem, r32); break;
+                case TYPE_U16: emit(out, "movzwl %s, %%%s", mem, r32); break;
+                case TYPE_U32: emit(out, "movl %s, %%%s", mem, r32); break;
+                default:       emit(out, "movq %s, %%%s", mem, r64); break;
+            }
+            emit_store(out, dst, work);
+            break;
+        }
+
+        case IR_STORE: {
+            char mem[48];
+            emit_load(out, X86_RDX, location_of(instr->args[1]));
+            element_operand(out, instr->imm, instr->args[0], mem, sizeof(mem));
+            int size = element_size(g_func->values[instr->args[1]].type);
+            int bits = size * 8;
+            const char* suffix = size == 1 ? "b" : size == 2 ? "w" : size == 4 ? "l" : "q";
+            emit(out, "mov%s %%%s, %s", suffix, x86_reg_name(X86_RDX, bits), mem);
+            break;
+        }
+
+        case IR_BOUNDS_CHECK: {
+            const IrArray* array = ir_array_ref(g_module, g_func, instr->imm);
+            emit_load(out, X86_RCX, location_of(instr->args[0]));
+            emit(out, "cmpq $%d, %%rcx", array->length);
+            emit(out, "jae __casm_bounds_fail");
+            break;
+        }
+
+        case IR_ARRAY_INIT: {
+            /* rep movsb from the initial image (rep stosb when all zero);
+             * rdi and rsi may hold values, so they are preserved */
+            const IrArray* array = &g_func->arrays[instr->imm];
+            int bytes = array->length * element_size(array->elem_type);
+            emit(out, "pushq %%rdi");
+            emit(out, "pushq %%rsi");
+            emit(out, "leaq %d(%%rbp), %%rdi", g_array_offsets[instr->imm]);
+            emit(out, "movl $%d, %%ecx", bytes);
+            if (array->init_count > 0) {
+                int id = g_string_count++;
+                char label[32];
+                snprintf(label, sizeof(label), ".Lstr%d:\n", id);
+                output_sink_append(&g_rodata, label);
+                emit_array_data(&g_rodata, array);
+                emit(out, "leaq .Lstr%d(%%rip), %%rsi", id);
+                emit(out, "rep movsb");
+            } else {
+                emit(out, "xorl %%eax, %%eax");
+                emit(out, "rep stosb");
+            }
+            emit(out, "popq %%rsi");
+            emit(out, "popq %%rdi");
+            break;
+        }
+    }
+}
+
+/* Helper: Emit restoring the frame and returning */
+static void emit_epilogue(OutputSink* out) {
+    for (int i = 0; i < g_saved_count; i++) {
+        emit(out, "movq %d(%%rbp), %%%s", -8 * (i + 1), x86_reg_name(g_saved_regs[i], 64));
+    }
+    emit(out, "leave");
+    emit(out, "ret");
+}
+
+/* Helper: Emit the edge copies for a jump and the jump itself (omitted
+ * when the target is the next block) */
+static void emit_edge(OutputSink* out, int from, int to, int nth) {
+    X86Move* moves = NULL;
+    int count = collect_edge_moves(from, to, nth, &moves);
+    emit_parallel_moves(out, moves, count);
+    xfree(moves);
+    if (to != from + 1) {
+        emit(out, "jmp .L%d_%d", g_func_index, to);
+    }
+}
+
+/* Emit a block's terminator */
+static void emit_terminator(OutputSink* out, int b) {
+    const IrTerminator* term = &g_func->blocks[b].term;
+
+    switch (term->kind) {
+        case IR_TERM_JUMP:
+            emit_edge(out, b, term->targets[0], 0);
+            break;
+
+        case IR_TERM_BRANCH: {
+            int if_true = term->targets[0];
+            int if_false = term->targets[1];
+            int false_nth = if_true == if_false ? 1 : 0;
+            const X86Location* cond = location_of(term->value);
+            const IrInstr* cond_instr = &g_func->values[term->value];
+
+            if (cond->kind == X86_LOC_IMM) {
+                if (cond->imm) {
+                    emit_edge(out, b, if_true, 0);
+                } else {
+                    emit_edge(out, b, if_false, false_nth);
+                }
+                break;
+            }
+
+            /* Flags: compare fused into the branch, or the bool against 0 */
+            IrOpcode op = IR_NE;
+            int is_signed = 0;
+            if (is_fused_compare(term->value)) {
+                op = cond_instr->op;
+                is_signed = is_signed_type(g_func->values[cond_instr->args[0]].type);
+                emit_compare(out, location_of(cond_instr->args[0]), location_of(cond_instr->args[1]));
+            } else {
+                char buf[32];
+                emit(out, "cmpq $0, %s", operand(cond, buf, sizeof(buf)));
+            }
+
+            X86Move* true_moves = NULL;
+            X86Move* false_moves = NULL;
+            int true_count = collect_edge_moves(b, if_true, 0, &true_moves);
+            int false_count = collect_edge_moves(b, if_false, false_nth, &false_moves);
+
+            if (false_count == 0) {
+                emit(out, "j%s .L%d_%d", condition_code(op, is_signed, 1), g_func_index, if_false);
+                emit_parallel_moves(out, true_moves, true_count);
+                if (if_true != b + 1) emit(out, "jmp .L%d_%d", g_func_index, if_true);
+            } else if (true_count == 0) {
+                emit(out, "j%s .L%d_%d", condition_code(op, is_signed, 0), g_func_index, if_true);
+                emit_parallel_moves(out, false_moves, false_count);
+                if (if_false != b + 1) emit(out, "jmp .L%d_%d", g_func_index, if_false);
+            } else {
+                emit(out, "j%s .L%d_%d_f", condition_code(op, is_signed, 1), g_func_index, b);
+                emit_parallel_moves(out, true_moves, true_count);
+                emit(out, "jmp .L%d_%d", g_func_index, if_true);
+                output_sink_append(out, ".L");
+                output_sink_append_int(out, g_func_index);
+                output_sink_append_char(out, '_');
+                output_sink_append_int(out, b);
+                output_sink_append(out, "_f:\n");
+                emit_parallel_moves(out, false_moves, false_count);
+                if (if_false != b + 1) emit(out, "jmp .L%d_%d", g_func_index, if_false);
+            }
+            xfree(true_moves);
+            xfree(false_moves);
+            break;
+        }
+
+        case IR_TERM_RETURN:
+            if (term->value >= 0) {
+                emit_load(out, X86_RAX, location_of(term->value));
+            }
+            emit_epilogue(out);
+            break;
+
+        case IR_TERM_UNREACHABLE:
+        case IR_TERM_NONE:
+            emit(out, "ud2");
+            break;
+    }
+}
+
+/* Emit one function: prologue (frame, callee-saved registers, parameters
+ * moved out of the argument registers), blocks in IR order */
+static void emit_function(OutputSink* out, const IrFunction* func, int index) {
+    X86Allocation* alloc = x86_allocate_registers(func);
+    g_func = func;
+    g_alloc = alloc;
+    g_func_index = index;
+
+    g_use_counts = xmalloc((func->value_count + 1) * sizeof(int));
+    memset(g_use_counts, 0, (func->value_count + 1) * sizeof(int));
+    for (int v = 0; v < func->value_count; v++) {
+        for (int a = 0; a < func->values[v].arg_count; a++) {
+            g_use_counts[func->values[v].args[a]]++;
+        }
+    }
+    for (int b = 0; b < func->block_count; b++) {
+        const IrTerminator* term = &func->blocks[b].term;
+        if (term->value >= 0 && (term->kind == IR_TERM_BRANCH || term->kind == IR_TERM_RETURN)) {
+            g_use_counts[term->value]++;
+        }
+    }
+
+    g_saved_count = 0;
+    for (int r = 0; r < X86_REG_COUNT; r++) {
+        if ((alloc->used_regs & (1u << r)) && !x86_reg_is_caller_saved((X86Reg)r)) {
+            g_saved_regs[g_saved_count++] = (X86Reg)r;
+        }
+    }
+    int frame = 8 * (g_saved_count + alloc->slot_count);
+    /* Local arrays sit below the spill slots, each 8-byte aligned */
+    g_array_offsets = xmalloc((func->array_count + 1) * sizeof(int));
+    for (int i = 0; i < func->array_count; i++) {
+        int bytes = func->arrays[i].length * element_size(func->arrays[i].elem_type);
+        frame += (bytes + 7) & ~7;
+        g_array_offsets[i] = -frame;
+    }
+    frame = (frame + 15) & ~15;
+
+    output_sink_append(out, "\n    .p2align 4\n");
+    output_sink_append(out, func->name);
+    output_sink_append(out, ":\n");
+    emit(out, "pushq %%rbp");
+    emit(out, "movq %%rsp, %%rbp");
+    if (frame > 0) {
+        emit(out, "subq $%d, %%rsp", frame);
+    }
+    for (int i = 0; i < g_saved_count; i++) {
+        emit(out, "movq %%%s, %d(%%rbp)", x86_reg_name(g_saved_regs[i], 64), -8 * (i + 1));
+    }
+
+    /* Parameters: register arguments as one parallel copy, then the ones
+     * the caller pushed */
+    X86Move moves[6];
+    int move_count = 0;
+    const IrBlock* entry = &func->blocks[0];
+    for (int i = 0; i < entry->instr_count; i++) {
+        int v = entry->instrs[i];
+        const IrInstr* instr = &func->values[v];
+        if (instr->op != IR_PARAM || instr->imm >= 6) continue;
+        moves[move_count].dst = *location_of(v);
+        moves[move_count].src.kind = X86_LOC_REG;
+        moves[move_count].src.reg = g_arg_regs[instr->imm];
+        moves[move_count].src.slot = -1;
+        moves[move_count].src.imm = 0;
+        if (!same_location(&moves[move_count].dst, &moves[move_count].src)) move_count++;
+    }
+    emit_parallel_moves(out, moves, move_count);
+    for (int i = 0; i < entry->instr_count; i++) {
+        int v = entry->instrs[i];
+        const IrInstr* instr = &func->values[v];
+        if (instr->op != IR_PARAM || instr->imm < 6) continue;
+        emit(out, "movq %d(%%rbp), %%rax", 16 + 8 * (int)(instr->imm - 6));
+        emit_store(out, location_of(v), X86_RAX);
+    }
+
+    for (int b = 0; b < func->block_count; b++) {
+        const IrBlock* block = &func->blocks[b];
+        output_sink_append(out, ".L");
+        output_sink_append_int(out, index);
+        output_sink_append_char(out, '_');
+        output_sink_append_int(out, b);
+        output_sink_append(out, ":\n");
+        for (int i = 0; i < block->instr_count; i++) {
+            emit_instruction(out, block->instrs[i]);
+        }
+        emit_terminator(out, b);
+    }
+
+    xfree(g_use_counts);
+    g_use_counts = NULL;
+    xfree(g_array_offsets);
+    g_array_offsets = NULL;
+    x86_allocation_free(alloc);
+    g_alloc = NULL;
+    g_func = NULL;
+}
+
+/* Emit _start: call main, flush dbg output, exit with main's result */
+static void emit_entry(OutputSink* out, const IrFunction* main_func) {
+    output_sink_append(out, "\n    .globl _start\n_start:\n");
+    emit(out, "xorl %%ebp, %%ebp");
+    emit(out, "call %s", main_func->name);
+    if (main_func->return_type == TYPE_VOID) {
+        emit(out, "xorl %%ebx, %%ebx");
+    } else {
+        emit(out, "movl %%eax, %%ebx");
+    }
+    emit(out, "call __casm_dbg_flush");
+    emit(out, "movl %%ebx, %%edi");
+    emit(out, "movl $60, %%eax");
+    emit(out, "syscall");
+}
+
+CodegenX86Result codegen_x86_program_to_sink(ASTProgram* program, OutputSink* output,
+                                             const char* source_filename,
+                                             const CodegenX86Options* options) {
+    CodegenX86Result result = {1, NULL};
+    g_source_filename = source_filename ? source_filename : "unknown.csm";
+
+    IrModule* module = ir_lower_program(program);
+    if (options && options->tail_calls) {
+        ir_eliminate_self_tail_calls(module);
+    }
+    char* ir_error = NULL;
+    if (!ir_verify_module(module, &ir_error)) {
+        size_t len = strlen(ir_error) + 32;
+        result.success = 0;
+        result.error_msg = xmalloc(len);
+        snprintf(result.error_msg, len, "invalid IR: %s", ir_error);
+        xfree(ir_error);
+        ir_module_free(module);
+        return result;
+    }
+
+    output_sink_init(&g_rodata);
+    g_string_count = 0;
+    g_module = module;
+
+    output_sink_append(output, "# Generated by casm from ");
+    output_sink_append(output, g_source_filename);
+    output_sink_append(output, "\n    .text\n");
+
+    const IrFunction* main_func = NULL;
+    for (int i = 0; i < module->function_count; i++) {
+        emit_function(output, module->functions[i], i);
+        if (strcmp(module->functions[i]->name, "main") == 0) {
+            main_func = module->functions[i];
+        }
+    }
+    if (main_func) {
+        emit_entry(output, main_func);
+    }
+    output_sink_append(output, g_runtime);
+
+    for (int i = 0; i < module->global_count; i++) {
+        const IrArray* array = &module->globals[i];
+        int initialized = array->init_count > 0;
+        output_sink_append(output, initialized ? "\n    .data\n" : "\n    .bss\n");
+        output_sink_append(output, "    .p2align 3\n.Lglobal");
+        output_sink_append_int(output, i);
+        output_sink_append(output, ":  # ");
+        output_sink_append(output, array->name);
+        output_sink_append_char(output, '\n');
+        emit_array_data(output, array);
+    }
+
+    if (g_string_count > 0) {
+        output_sink_append(output, "\n    .section .rodata\n");
+        output_sink_append(output, g_rodata.data);
+    }
+    output_sink_append(output, "\n    .section .note.GNU-stack,\"\",@progbits\n");
+
+    output_sink_free(&g_rodata);
+    g_module = NULL;
+    ir_module_free(module);
+    return result;
+}
@@ -0,0 +1,31 @@
+#ifndef CODEGEN_X86_H
+#define CODEGEN_X86_H
+
+#include "ast.h"
+#include "output_sink.h"
+
+/* Result of x86-64 code generation */
+typedef struct {
+    int success;        /* 1 if generation succeeded, 0 if failed */
+    char* error_msg;    /* Error message if failed (NULL if success) */
+} CodegenX86Result;
+
+/* Options for x86-64 code generation */
+typedef struct {
+    int tail_calls;     /* Turn self tail calls into loops (-O1 and up) */
+} CodegenX86Options;
+
+/* Generate x86-64 GNU assembler (AT&T syntax) for Linux from an analyzed,
+ * name-allocated program, via the SSA IR. The output is self-contained:
+ * it defines _start (which calls main and exits with its result through
+ * the exit syscall) and a small dbg runtime that buffers output and
+ * writes it with the write syscall, so it only needs
+ *     as out.s -o out.o && ld out.o -o out
+ * Functions follow the SysV calling convention. source_filename is used
+ * in dbg output; options may be NULL for the defaults. Appends to the
+ * sink's contents. */
+CodegenX86Result codegen_x86_program_to_sink(ASTProgram* program, OutputSink* output,
+                                             const char* source_filename,
+                                             const CodegenX86Options* options);
+
+#endif /* CODEGEN_X86_H */
@@ -0,0 +1,641 @@
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include "constexpr.h"
+#include "call_graph.h"
+#include "optimizer.h"
+#include "types.h"
+#include "utils.h"
+
+/* A tree-walking evaluator over the analyzed AST. Values are kept in the
+ * same canonical 64-bit form as the backends (signed types sign-extended,
+ * unsigned zero-extended, bools 0 or 1) and every expression is evaluated
+ * in the type ir_lower.c would compute it in, so a folded call yields
+ * exactly what running it would. Anything the evaluator cannot decide
+ * (traps, uninitialized reads, budget or depth exhausted) aborts the
+ * whole evaluation and leaves the call to run at runtime. */
+
+/* Steps (statements, expressions and loop iterations) one folded call may take */
+#define CALL_STEP_BUDGET 1000000
+
+/* Steps for all folded calls together, bounding compile time */
+#define PROGRAM_STEP_BUDGET 10000000
+
+/* Nested calls within one evaluation */
+#define MAX_EVAL_DEPTH 200
+
+typedef struct {
+    const char* name;
+    CasmType type;
+    long long value;
+    int initialized;
+} Binding;
+
+typedef enum {
+    FLOW_NORMAL,
+    FLOW_RETURN,
+    FLOW_BREAK,
+    FLOW_CONTINUE,
+    FLOW_ABORT
+} Flow;
+
+typedef struct {
+    ASTProgram* program;
+    int* pure;                  /* Per function: no dbg() or global array access here or below */
+
+    Binding* bindings;          /* Variables of all active calls, innermost last */
+    int binding_count;
+    int binding_capacity;
+    int frame_base;             /* First binding of the current call */
+    CasmType return_type;       /* Of the current call */
+    long long return_value;
+    int depth;
+
+    long steps;                 /* Left for the current fold */
+    long program_steps;         /* Left for the whole program */
+    int folded;
+} Evaluator;
+
+/* Forward declarations */
+static int eval_expression(Evaluator* e, const ASTExpression* expr, long long* value, CasmType* type);
+static Flow exec_block(Evaluator* e, const ASTBlock* block);
+static void fold_block(Evaluator* e, ASTBlock* block);
+
+/* Helper: Type arithmetic on a value of this type is performed in */
+static CasmType promote_type(CasmType type) {
+    switch (type) {
+        case TYPE_I8:
+        case TYPE_I16:
+        case TYPE_I32: return TYPE_I32;
+        case TYPE_U8:
+        case TYPE_U16:
+        case TYPE_U32: return TYPE_U32;
+        default:       return type;
+    }
+}
+
+/* Helper: Check if a type is a signed integer type */
+static int is_signed_type(CasmType type) {
+    return type == TYPE_I8 || type == TYPE_I16 || type == TYPE_I32 || type == TYPE_I64;
+}
+
+/* Helper: Check if u8/u16 arithmetic gave a value every backend agrees
+ * on. The IR computes it in u32 but C promotes the operands to int, so
+ * results outside [0, INT32_MAX] (a negation, a difference below zero, a
+ * large product) differ and the call is left to run. */
+static int is_portable_narrow_result(BinaryOpType op, long long left, long long right, CasmType type) {
+    if (type != TYPE_U8 && type != TYPE_U16) return 1;
+    if (left < 0 || left > INT_MAX || right < 0 || right > INT_MAX) return 0;
+    long long exact;
+    switch (op) {
+        case BINOP_ADD: exact = left + right; break;
+        case BINOP_SUB: exact = left - right; break;
+        case BINOP_MUL: exact = left * right; break;
+        default:        return 1;
+    }
+    return exact >= 0 && exact <= INT_MAX;
+}
+
+/* Helper: Convert a canonical value to a type (wrapping integers) */
+static long long convert(long long value, CasmType type) {
+    unsigned long long bits = (unsigned long long)value;
+    switch (type) {
+        case TYPE_I8:   return (int8_t)(uint8_t)bits;
+        case TYPE_I16:  return (int16_t)(uint16_t)bits;
+        case TYPE_I32:  return (int32_t)(uint32_t)bits;
+        case TYPE_U8:   return (uint8_t)bits;
+        case TYPE_U16:  return (uint16_t)bits;
+        case TYPE_U32:  return (uint32_t)bits;
+        case TYPE_BOOL: return value != 0;
+        default:        return value;
+    }
+}
+
+/* Helper: Spend one step; 0 when a budget is exhausted */
+static int tick(Evaluator* e) {
+    e->steps--;
+    e->program_steps--;
+    return e->steps > 0 && e->program_steps > 0;
+}
+
+/* Helper: The function a call refers to, if exactly one has that name.
+ * Sets *index to its position in program->functions. */
+static ASTFunctionDef* find_function(Evaluator* e, const char* name, int* index) {
+    ASTFunctionDef* found = NULL;
+    for (int i = 0; i < e->program->function_count; i++) {
+        if (strcmp(e->program->functions[i].name, name) != 0) continue;
+        if (found) return NULL;
+        found = &e->program->functions[i];
+        *index = i;
+    }
+    return found;
+}
+
+/* Helper: Innermost variable of the current call with this name */
+static Binding* lookup(Evaluator* e, const char* name) {
+    for (int i = e->binding_count - 1; i >= e->frame_base; i--) {
+        if (strcmp(e->bindings[i].name, name) == 0) return &e->bindings[i];
+    }
+    return NULL;
+}
+
+static void bind(Evaluator* e, const char* name, CasmType type, long long value, int initialized) {
+    if (e->binding_count >= e->binding_capacity) {
+        e->binding_capacity = e->binding_capacity == 0 ? 32 : e->binding_capacity * 2;
+        e->bindings = xrealloc(e->bindings, e->binding_capacity * sizeof(Binding));
+    }
+    Binding* b = &e->bindings[e->binding_count++];
+    b->name = name;
+    b->type = type;
+    b->value = value;
+    b->initialized = initialized;
+}
+
+/* Helper: Evaluate an expression converted to `type`. Integer literals
+ * are taken directly in the target type, as ir_lower.c does. */
+static int eval_as(Evaluator* e, const ASTExpression* expr, CasmType type, long long* value) {
+    if (expr->type == EXPR_LITERAL && expr->as.literal.type == LITERAL_INT && is_numeric_type(type)) {
+        *value = convert(expr->as.literal.value.int_value, type);
+        return tick(e);
+    }
+    CasmType actual;
+    if (!eval_expression(e, expr, value, &actual)) return 0;
+    *value = convert(*value, type);
+    return 1;
+}
+
+/* Helper: Arithmetic on two values of a promoted type. Returns 0 where
+ * the program would trap. */
+static int eval_arithmetic(BinaryOpType op, long long left, long long right, CasmType type,
+                           long long* value) {
+    unsigned long long a = (unsigned long long)left;
+    unsigned long long b = (unsigned long long)right;
+    switch (op) {
+        case BINOP_ADD: *value = convert((long long)(a + b), type); return 1;
+        case BINOP_SUB: *value = convert((long long)(a - b), type); return 1;
+        case BINOP_MUL: *value = convert((long long)(a * b), type); return 1;
+        case BINOP_DIV:
+        case BINOP_MOD:
+            if (right == 0) return 0;
+            if (is_signed_type(type)) {
+                if (right == -1 && left == (type == TYPE_I64 ? LLONG_MIN : INT_MIN)) return 0;
+                *value = convert(op == BINOP_DIV ? left / right : left % right, type);
+            } else {
+                *value = convert((long long)(op == BINOP_DIV ? a / b : a % b), type);
+            }
+            return 1;
+        case BINOP_BIT_AND:
+        case BINOP_BIT_OR:
+        case BINOP_BIT_XOR:
+        case BINOP_SHL:
+        case BINOP_SHR:
+        case BINOP_ROTL:
+        case BINOP_ROTR:
+            *value = eval_bit_op(op, left, right, type);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Compare two values of the same type */
+static int eval_comparison(BinaryOpType op, long long left, long long right, CasmType type) {
+    int is_signed = is_signed_type(type);
+    unsigned long long a = (unsigned long long)left;
+    unsigned long long b = (unsigned long long)right;
+    switch (op) {
+        case BINOP_EQ: return left == right;
+        case BINOP_NE: return left != right;
+        case BINOP_LT: return is_signed ? left < right : a < b;
+        case BINOP_GT: return is_signed ? left > right : a > b;
+        case BINOP_LE: return is_signed ? left <= right : a <= b;
+        case BINOP_GE: return is_signed ? left >= right : a >= b;
+        default:       return 0;
+    }
+}
+
+/* Evaluate a call: arguments in the caller, then the body in a new frame */
+static int eval_call(Evaluator* e, const ASTFunctionCall* call, long long* value, CasmType* type) {
+    int index = -1;
+    ASTFunctionDef* func = find_function(e, call->function_name, &index);
+    if (!func || !e->pure[index] || e->depth >= MAX_EVAL_DEPTH ||
+        call->argument_count != func->parameter_count) {
+        return 0;
+    }
+
+    long long* args = xmalloc((call->argument_count + 1) * sizeof(long long));
+    for (int i = 0; i < call->argument_count; i++) {
+        if (!eval_as(e, &call->arguments[i], func->parameters[i].type.type, &args[i])) {
+            xfree(args);
+            return 0;
+        }
+    }
+
+    int saved_base = e->frame_base;
+    int saved_count = e->binding_count;
+    CasmType saved_return_type = e->return_type;
+    e->frame_base = e->binding_count;
+    e->return_type = func->return_type.type;
+    for (int i = 0; i < func->parameter_count; i++) {
+        bind(e, func->parameters[i].name, func->parameters[i].type.type, args[i], 1);
+    }
+    xfree(args);
+
+    e->depth++;
+    Flow flow = exec_block(e, &func->body);
+    e->depth--;
+    e->frame_base = saved_base;
+    e->binding_count = saved_count;
+    e->return_type = saved_return_type;
+
+    if (flow == FLOW_ABORT) return 0;
+    *type = func->return_type.type;
+    if (flow == FLOW_NORMAL) {
+        /* Falling off the end only returns normally from void functions */
+        *value = 0;
+        return *type == TYPE_VOID;
+    }
+    *value = e->return_value;
+    return 1;
+}
+
+static int eval_expression(Evaluator* e, const ASTExpression* expr, long long* value, CasmType* type) {
+    if (!tick(e)) return 0;
+
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            if (expr->as.literal.type == LITERAL_BOOL) {
+                *type = TYPE_BOOL;
+                *value = expr->as.literal.value.bool_value ? 1 : 0;
+            } else {
+                *type = promote_type(expr->resolved_type);
+                *value = convert(expr->as.literal.value.int_value, *type);
+            }
+            return 1;
+
+        case EXPR_VARIABLE: {
+            Binding* b = lookup(e, expr->as.variable.name);
+            if (!b || !b->initialized) return 0;
+            *type = b->type;
+            *value = b->value;
+            return 1;
+        }
+
+        case EXPR_UNARY_OP: {
+            const ASTUnaryOp* unop = &expr->as.unary_op;
+            long long operand;
+            if (unop->op == UNOP_NOT) {
+                if (!eval_as(e, unop->operand, TYPE_BOOL, &operand)) return 0;
+                *type = TYPE_BOOL;
+                *value = !operand;
+                return 1;
+            }
+            if (unop->op == UNOP_CAST) {
+                *type = expr->resolved_type;
+                return eval_as(e, unop->operand, *type, value);
+            }
+            if (unop->op == UNOP_POPCOUNT || unop->op == UNOP_CLZ || unop->op == UNOP_CTZ) {
+                *type = expr->resolved_type;
+                if (!eval_as(e, unop->operand, *type, &operand)) return 0;
+                *value = eval_bit_count(unop->op, operand, *type);
+                return 1;
+            }
+            *type = promote_type(expr->resolved_type);
+            if (!eval_as(e, unop->operand, *type, &operand)) return 0;
+            if (unop->op == UNOP_BIT_NOT) {
+                *value = convert(~operand, *type);
+            } else {
+                if (!is_portable_narrow_result(BINOP_SUB, 0, operand, expr->resolved_type)) return 0;
+                *value = convert((long long)(0ULL - (unsigned long long)operand), *type);
+            }
+            return 1;
+        }
+
+        case EXPR_BINARY_OP: {
+            const ASTBinaryOp* binop = &expr->as.binary_op;
+            long long left, right;
+
+            if (binop->op == BINOP_ASSIGN) {
+                if (binop->left->type != EXPR_VARIABLE) return 0;
+                Binding* b = lookup(e, binop->left->as.variable.name);
+                if (!b || !eval_as(e, binop->right, b->type, &right)) return 0;
+                /* The right side may have grown the bindings */
+                b = lookup(e, binop->left->as.variable.name);
+                b->value = right;
+                b->initialized = 1;
+                *type = b->type;
+                *value = right;
+                return 1;
+            }
+
+            if (binop->op == BINOP_AND || binop->op == BINOP_OR) {
+                if (!eval_as(e, binop->left, TYPE_BOOL, &left)) return 0;
+                *type = TYPE_BOOL;
+                if (left == (binop->op == BINOP_OR)) {
+                    *value = left;
+                    return 1;
+                }
+                return eval_as(e, binop->right, TYPE_BOOL, value);
+            }
+
+            if (binop->op >= BINOP_EQ && binop->op <= BINOP_GE) {
+                CasmType lt = binop->left->resolved_type;
+                CasmType rt = binop->right->resolved_type;
+                CasmType operand_type = (lt == TYPE_BOOL && rt == TYPE_BOOL)
+                    ? TYPE_BOOL
+                    : promote_type(get_binary_op_result_type(lt, BINOP_ADD, rt));
+                if (!eval_as(e, binop->left, operand_type, &left) ||
+                    !eval_as(e, binop->right, operand_type, &right)) {
+                    return 0;
+                }
+                *type = TYPE_BOOL;
+                *value = eval_comparison(binop->op, left, right, operand_type);
+                return 1;
+            }
+
+            /* Rotates work on the operand's own width */
+            *type = (binop->op == BINOP_ROTL || binop->op == BINOP_ROTR)
+                ? expr->resolved_type
+                : promote_type(expr->resolved_type);
+            if (!eval_as(e, binop->left, *type, &left) || !eval_as(e, binop->right, *type, &right) ||
+                !is_portable_narrow_result(binop->op, left, right, expr->resolved_type)) {
+                return 0;
+            }
+            return eval_arithmetic(binop->op, left, right, *type, value);
+        }
+
+        case EXPR_FUNCTION_CALL:
+            return eval_call(e, &expr->as.function_call, value, type);
+
+        case EXPR_INDEX:
+        case EXPR_FIELD:
+            /* Arrays and structs are not modelled */
+            return 0;
+    }
+    return 0;
+}
+
+/* Helper: Evaluate a condition */
+static Flow eval_condition(Evaluator* e, const ASTExpression* cond, int* taken) {
+    long long value;
+    if (!eval_as(e, cond, TYPE_BOOL, &value)) return FLOW_ABORT;
+    *taken = value != 0;
+    return FLOW_NORMAL;
+}
+
+static Flow exec_statement(Evaluator* e, const ASTStatement* stmt) {
+    long long value;
+    CasmType type;
+    int taken;
+
+    if (!tick(e)) return FLOW_ABORT;
+
+    switch (stmt->type) {
+        case STMT_RETURN:
+            if (stmt->as.return_stmt.value) {
+                if (!eval_as(e, stmt->as.return_stmt.value, e->return_type, &value)) return FLOW_ABORT;
+                e->return_value = value;
+            } else {
+                e->return_value = 0;
+            }
+            return FLOW_RETURN;
+
+        case STMT_EXPR:
+            return eval_expression(e, stmt->as.expr_stmt.expr, &value, &type) ? FLOW_NORMAL : FLOW_ABORT;
+
+        case STMT_VAR_DECL: {
+            const ASTVarDecl* decl = &stmt->as.var_decl_stmt.var_decl;
+            value = 0;
+            if (decl->initializer && !eval_as(e, decl->initializer, decl->type.type, &value)) {
+                return FLOW_ABORT;
+            }
+            bind(e, decl->name, decl->type.type, value, decl->initializer != NULL);
+            return FLOW_NORMAL;
+        }
+
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            if (eval_condition(e, if_stmt->condition, &taken) == FLOW_ABORT) return FLOW_ABORT;
+            if (taken) return exec_block(e, &if_stmt->then_body);
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                if (eval_condition(e, clause->condition, &taken) == FLOW_ABORT) return FLOW_ABORT;
+                if (taken) return exec_block(e, &clause->body);
+            }
+            return if_stmt->else_body ? exec_block(e, if_stmt->else_body) : FLOW_NORMAL;
+        }
+
+        case STMT_WHILE:
+            for (;;) {
+                if (!tick(e)) return FLOW_ABORT;
+                if (eval_condition(e, stmt->as.while_stmt.condition, &taken) == FLOW_ABORT) return FLOW_ABORT;
+                if (!taken) return FLOW_NORMAL;
+                Flow flow = exec_block(e, &stmt->as.while_stmt.body);
+                if (flow == FLOW_BREAK) return FLOW_NORMAL;
+                if (flow != FLOW_NORMAL && flow != FLOW_CONTINUE) return flow;
+            }
+
+        case STMT_FOR: {
+            const ASTForStmt* for_stmt = &stmt->as.for_stmt;
+            int saved_count = e->binding_count;
+            Flow flow = FLOW_NORMAL;
+            if (for_stmt->init) {
+                flow = exec_statement(e, for_stmt->init);
+            }
+            while (flow == FLOW_NORMAL) {
+                if (!tick(e)) {
+                    flow = FLOW_ABORT;
+                    break;
+                }
+                if (for_stmt->condition) {
+                    flow = eval_condition(e, for_stmt->condition, &taken);
+                    if (flow != FLOW_NORMAL || !taken) break;
+                }
+                flow = exec_block(e, &for_stmt->body);
+                if (flow == FLOW_BREAK) {
+                    flow = FLOW_NORMAL;
+                    break;
+                }
+                if (flow == FLOW_CONTINUE) flow = FLOW_NORMAL;
+                if (flow == FLOW_NORMAL && for_stmt->update &&
+                    !eval_expression(e, for_stmt->update, &value, &type)) {
+                    flow = FLOW_ABORT;
+                }
+            }
+            e->binding_count = saved_count;
+            return flow;
+        }
+
+        case STMT_BLOCK:
+            return exec_block(e, &stmt->as.block_stmt.block);
+
+        case STMT_DBG:
+            return FLOW_ABORT;
+
+        case STMT_BREAK:
+            return FLOW_BREAK;
+
+        case STMT_CONTINUE:
+            return FLOW_CONTINUE;
+    }
+    return FLOW_ABORT;
+}
+
+static Flow exec_block(Evaluator* e, const ASTBlock* block) {
+    int saved_count = e->binding_count;
+    Flow flow = FLOW_NORMAL;
+    for (int i = 0; i < block->statement_count && flow == FLOW_NORMAL; i++) {
+        flow = exec_statement(e, &block->statements[i]);
+    }
+    e->binding_count = saved_count;
+    return flow;
+}
+
+/* ========================================================================
+ * Folding
+ * ======================================================================== */
+
+/* Helper: Check if every argument of a call is a literal */
+static int has_literal_arguments(const ASTFunctionCall* call) {
+    for (int i = 0; i < call->argument_count; i++) {
+        if (call->arguments[i].type != EXPR_LITERAL) return 0;
+    }
+    return 1;
+}
+
+/* Helper: Replace a call with the literal it evaluates to, if it can be
+ * evaluated */
+static void try_fold_call(Evaluator* e, ASTExpression* expr) {
+    if (expr->resolved_type == TYPE_VOID || e->program_steps <= 0) return;
+
+    long long value;
+    CasmType type;
+    e->binding_count = 0;
+    e->frame_base = 0;
+    e->depth = 0;
+    e->steps = CALL_STEP_BUDGET;
+    if (!eval_call(e, &expr->as.function_call, &value, &type) || type == TYPE_VOID) return;
+
+    ast_expression_free_contents(expr);
+    expr->type = EXPR_LITERAL;
+    expr->as.literal.location = expr->location;
+    expr->resolved_type = type;
+    if (type == TYPE_BOOL) {
+        expr->as.literal.type = LITERAL_BOOL;
+        expr->as.literal.value.bool_value = value ? 1 : 0;
+    } else {
+        expr->as.literal.type = LITERAL_INT;
+        expr->as.literal.value.int_value = value;
+    }
+    e->folded++;
+}
+
+/* Fold calls innermost first, so a folded call can make its caller's
+ * arguments literal */
+static void fold_expression(Evaluator* e, ASTExpression* expr) {
+    if (!expr) return;
+
+    switch (expr->type) {
+        case EXPR_LITERAL:
+        case EXPR_VARIABLE:
+        case EXPR_FIELD:
+            break;
+        case EXPR_UNARY_OP:
+            fold_expression(e, expr->as.unary_op.operand);
+            break;
+        case EXPR_BINARY_OP:
+            fold_expression(e, expr->as.binary_op.left);
+            fold_expression(e, expr->as.binary_op.right);
+            break;
+        case EXPR_FUNCTION_CALL: {
+            ASTFunctionCall* call = &expr->as.function_call;
+            for (int i = 0; i < call->argument_count; i++) {
+                fold_expression(e, &call->arguments[i]);
+                optimize_fold_expression(&call->arguments[i]);
+            }
+            if (has_literal_arguments(call)) {
+                try_fold_call(e, expr);
+            }
+            break;
+        }
+        case EXPR_INDEX:
+            fold_expression(e, expr->as.index.index);
+            break;
+    }
+}
+
+static void fold_statement(Evaluator* e, ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            fold_expression(e, stmt->as.return_stmt.value);
+            break;
+        case STMT_EXPR:
+            fold_expression(e, stmt->as.expr_stmt.expr);
+            break;
+        case STMT_VAR_DECL:
+            fold_expression(e, stmt->as.var_decl_stmt.var_decl.initializer);
+            break;
+        case STMT_IF:
+            fold_expression(e, stmt->as.if_stmt.condition);
+            fold_block(e, &stmt->as.if_stmt.then_body);
+            for (ASTElseIfClause* clause = stmt->as.if_stmt.else_if_chain; clause; clause = clause->next) {
+                fold_expression(e, clause->condition);
+                fold_block(e, &clause->body);
+            }
+            if (stmt->as.if_stmt.else_body) {
+                fold_block(e, stmt->as.if_stmt.else_body);
+            }
+            break;
+        case STMT_WHILE:
+            fold_expression(e, stmt->as.while_stmt.condition);
+            fold_block(e, &stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            if (stmt->as.for_stmt.init) {
+                fold_statement(e, stmt->as.for_stmt.init);
+            }
+            fold_expression(e, stmt->as.for_stmt.condition);
+            fold_expression(e, stmt->as.for_stmt.update);
+            fold_block(e, &stmt->as.for_stmt.body);
+            break;
+        case STMT_BLOCK:
+            fold_block(e, &stmt->as.block_stmt.block);
+            break;
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                fold_expression(e, &stmt->as.dbg_stmt.arguments[i]);
+            }
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+}
+
+static void fold_block(Evaluator* e, ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        fold_statement(e, &block->statements[i]);
+    }
+}
+
+int fold_constant_calls(ASTProgram* program) {
+    if (!program || program->function_count == 0) return 0;
+
+    CallGraph* graph = call_graph_create(program);
+    if (!graph) return 0;
+
+    Evaluator e;
+    memset(&e, 0, sizeof(e));
+    e.program = program;
+    e.pure = call_graph_find_pure_functions(graph, program);
+    e.program_steps = PROGRAM_STEP_BUDGET;
+    if (e.pure) {
+        for (int i = 0; i < program->function_count; i++) {
+            fold_block(&e, &program->functions[i].body);
+        }
+    }
+
+    xfree(e.bindings);
+    xfree(e.pure);
+    call_graph_free(graph);
+    return e.folded;
+}
@@ -0,0 +1,18 @@
+#ifndef CONSTEXPR_H
+#define CONSTEXPR_H
+
+#include "ast.h"
+
+/* Evaluate calls to pure functions (no dbg() in them or anything they
+ * call, per the call graph) whose arguments are all literals, and replace
+ * each call with the literal it returns. Evaluation follows the IR's
+ * semantics exactly: arithmetic in i32/u32/i64/u64 with two's complement
+ * wraparound, conversions to the declared type of every variable,
+ * parameter and return value. A call is left alone if its evaluation
+ * would trap (division by zero, signed overflow), reads an uninitialized
+ * variable, falls off the end of a non-void function, recurses too
+ * deeply or runs past a step budget. Must run before name allocation.
+ * Returns the number of calls replaced. */
+int fold_constant_calls(ASTProgram* program);
+
+#endif /* CONSTEXPR_H */
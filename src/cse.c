@@ -0,0 +1,646 @@
+#include <stdio.h>
+#include <string.h>
+#include "cse.h"
+#include "call_graph.h"
+#include "optimizer.h"
+#include "utils.h"
+
+/* A region is a run of declarations, expression statements, returns and
+ * dbg() statements in one block, optionally ended by the condition of an
+ * if. Within a region every statement runs exactly once, in order, so an
+ * expression's value stays available until a statement assigns or
+ * declares one of its variables (matched by name). Calls cannot write the
+ * caller's locals, so they never kill a value; calls to impure functions
+ * are simply never candidates.
+ *
+ * A candidate is computed at the start of the first statement that
+ * evaluates it unconditionally (not on the right of && or ||). Moving it
+ * ahead of the rest of that statement is only unobservable if nothing in
+ * the statement has an effect, so when the statement calls an impure
+ * function the candidate must also be free of traps and calls.
+ *
+ * Regions are rescanned after each new local, so the largest repeated
+ * expression is shared first and its repeated parts follow:
+ * `(a + b) * (a + b)` twice becomes `cse2 = a + b; cse1 = cse2 * cse2`. */
+
+#define MAX_ROUNDS 64
+
+typedef struct {
+    const char** names;
+    int count;
+    int capacity;
+} NameList;
+
+typedef struct {
+    ASTProgram* program;
+    int* pure;              /* Per function: no dbg() or global array access here or below */
+
+    NameList taken;         /* Names a new local must avoid */
+    NameList killed;        /* Names assigned or declared by one statement */
+    char** owned;           /* Generated names (owned copies) */
+    int owned_count;
+    int next_temp;
+
+    int replaced_total;
+} Cse;
+
+/* Helper: Add a name to a list (no duplicates) */
+static void name_list_add(NameList* list, const char* name) {
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->names[i], name) == 0) return;
+    }
+    if (list->count >= list->capacity) {
+        list->capacity = (list->capacity == 0) ? 32 : list->capacity * 2;
+        list->names = xrealloc(list->names, list->capacity * sizeof(const char*));
+    }
+    list->names[list->count++] = name;
+}
+
+static int name_list_contains(const NameList* list, const char* name) {
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->names[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+/* ========================================================================
+ * Expression properties
+ * ======================================================================== */
+
+/* Helper: Check that every function a call may resolve to is pure */
+static int call_is_pure(const Cse* c, const char* name) {
+    int found = 0;
+    for (int i = 0; i < c->program->function_count; i++) {
+        if (strcmp(c->program->functions[i].name, name) == 0) {
+            if (!c->pure[i]) return 0;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+/* Helper: Check if an expression assigns nothing and calls only pure
+ * functions, so evaluating it twice gives the same value */
+static int is_pure(const Cse* c, const ASTExpression* expr) {
+    switch (expr->type) {
+        case EXPR_LITERAL:
+        case EXPR_VARIABLE:
+        case EXPR_FIELD:
+            return 1;
+        case EXPR_UNARY_OP:
+            return is_pure(c, expr->as.unary_op.operand);
+        case EXPR_BINARY_OP:
+            return expr->as.binary_op.op != BINOP_ASSIGN &&
+                   is_pure(c, expr->as.binary_op.left) &&
+                   is_pure(c, expr->as.binary_op.right);
+        case EXPR_FUNCTION_CALL:
+            if (!call_is_pure(c, expr->as.function_call.function_name)) return 0;
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                if (!is_pure(c, &expr->as.function_call.arguments[i])) return 0;
+            }
+            return 1;
+        case EXPR_INDEX:
+            /* Element stores are not tracked */
+            return 0;
+    }
+    return 0;
+}
+
+/* Helper: Check if an expression calls a function that is not pure */
+static int has_impure_call(const Cse* c, const ASTExpression* expr) {
+    if (!expr) return 0;
+
+    switch (expr->type) {
+        case EXPR_UNARY_OP:
+            return has_impure_call(c, expr->as.unary_op.operand);
+        case EXPR_INDEX:
+            return has_impure_call(c, expr->as.index.index);
+        case EXPR_BINARY_OP:
+            return has_impure_call(c, expr->as.binary_op.left) ||
+                   has_impure_call(c, expr->as.binary_op.right);
+        case EXPR_FUNCTION_CALL:
+            if (!call_is_pure(c, expr->as.function_call.function_name)) return 1;
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                if (has_impure_call(c, &expr->as.function_call.arguments[i])) return 1;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Check if an expression does enough work to be worth a local.
+ * Narrow types are skipped: the backends promote them differently. */
+static int worth_a_local(const ASTExpression* expr) {
+    switch (expr->resolved_type) {
+        case TYPE_I32:
+        case TYPE_I64:
+        case TYPE_U32:
+        case TYPE_U64:
+        case TYPE_BOOL:
+            break;
+        default:
+            return 0;
+    }
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+        case EXPR_FUNCTION_CALL:
+            return 1;
+        case EXPR_UNARY_OP:
+            return worth_a_local(expr->as.unary_op.operand);
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Structural equality, the value number of an expression */
+static int expressions_equal(const ASTExpression* a, const ASTExpression* b) {
+    if (a->type != b->type || a->resolved_type != b->resolved_type) return 0;
+
+    switch (a->type) {
+        case EXPR_LITERAL:
+            if (a->as.literal.type != b->as.literal.type) return 0;
+            if (a->as.literal.type == LITERAL_BOOL) {
+                return a->as.literal.value.bool_value == b->as.literal.value.bool_value;
+            }
+            return a->as.literal.value.int_value == b->as.literal.value.int_value;
+        case EXPR_VARIABLE:
+            return strcmp(a->as.variable.name, b->as.variable.name) == 0;
+        case EXPR_UNARY_OP:
+            return a->as.unary_op.op == b->as.unary_op.op &&
+                   expressions_equal(a->as.unary_op.operand, b->as.unary_op.operand);
+        case EXPR_BINARY_OP:
+            return a->as.binary_op.op == b->as.binary_op.op &&
+                   expressions_equal(a->as.binary_op.left, b->as.binary_op.left) &&
+                   expressions_equal(a->as.binary_op.right, b->as.binary_op.right);
+        case EXPR_FUNCTION_CALL:
+            if (strcmp(a->as.function_call.function_name, b->as.function_call.function_name) != 0 ||
+                a->as.function_call.argument_count != b->as.function_call.argument_count) {
+                return 0;
+            }
+            for (int i = 0; i < a->as.function_call.argument_count; i++) {
+                if (!expressions_equal(&a->as.function_call.arguments[i],
+                                       &b->as.function_call.arguments[i])) {
+                    return 0;
+                }
+            }
+            return 1;
+        case EXPR_INDEX:
+            return a->as.index.global_index == b->as.index.global_index &&
+                   strcmp(a->as.index.array_name, b->as.index.array_name) == 0 &&
+                   expressions_equal(a->as.index.index, b->as.index.index);
+        case EXPR_FIELD:
+            return strcmp(a->as.field.object_name, b->as.field.object_name) == 0 &&
+                   a->as.field.field_index == b->as.field.field_index;
+    }
+    return 0;
+}
+
+/* Helper: Check if an expression reads any of the given names */
+static int mentions_any(const ASTExpression* expr, const NameList* names) {
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            return 0;
+        case EXPR_VARIABLE:
+            return name_list_contains(names, expr->as.variable.name);
+        case EXPR_FIELD:
+            return name_list_contains(names, expr->as.field.object_name);
+        case EXPR_UNARY_OP:
+            return mentions_any(expr->as.unary_op.operand, names);
+        case EXPR_INDEX:
+            return mentions_any(expr->as.index.index, names);
+        case EXPR_BINARY_OP:
+            return mentions_any(expr->as.binary_op.left, names) ||
+                   mentions_any(expr->as.binary_op.right, names);
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                if (mentions_any(&expr->as.function_call.arguments[i], names)) return 1;
+            }
+            return 0;
+    }
+    return 0;
+}
+
+/* Helper: Add every name an expression assigns to a list */
+static void collect_assigned(const ASTExpression* expr, NameList* names) {
+    if (!expr) return;
+
+    switch (expr->type) {
+        case EXPR_UNARY_OP:
+            collect_assigned(expr->as.unary_op.operand, names);
+            break;
+        case EXPR_INDEX:
+            collect_assigned(expr->as.index.index, names);
+            break;
+        case EXPR_BINARY_OP:
+            if (expr->as.binary_op.op == BINOP_ASSIGN &&
+                expr->as.binary_op.left->type == EXPR_VARIABLE) {
+                name_list_add(names, expr->as.binary_op.left->as.variable.name);
+            }
+            /* A field store kills everything reading the struct */
+            if (expr->as.binary_op.op == BINOP_ASSIGN &&
+                expr->as.binary_op.left->type == EXPR_FIELD) {
+                name_list_add(names, expr->as.binary_op.left->as.field.object_name);
+            }
+            collect_assigned(expr->as.binary_op.left, names);
+            collect_assigned(expr->as.binary_op.right, names);
+            break;
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                collect_assigned(&expr->as.function_call.arguments[i], names);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* ========================================================================
+ * Regions
+ * ======================================================================== */
+
+/* Helper: Check if a statement runs its expressions once and falls through */
+static int is_region_statement(const ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+        case STMT_EXPR:
+        case STMT_RETURN:
+        case STMT_DBG:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Helper: The index-th expression a region statement evaluates, or NULL.
+ * For an if that ends a region, that is just its condition. */
+static ASTExpression* statement_slot(ASTStatement* stmt, int index) {
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            return index == 0 ? stmt->as.var_decl_stmt.var_decl.initializer : NULL;
+        case STMT_EXPR:
+            return index == 0 ? stmt->as.expr_stmt.expr : NULL;
+        case STMT_RETURN:
+            return index == 0 ? stmt->as.return_stmt.value : NULL;
+        case STMT_IF:
+            return index == 0 ? stmt->as.if_stmt.condition : NULL;
+        case STMT_DBG:
+            return index < stmt->as.dbg_stmt.argument_count ?
+                &stmt->as.dbg_stmt.arguments[index] : NULL;
+        default:
+            return NULL;
+    }
+}
+
+/* Helper: Fill c->killed with the names a statement assigns or declares */
+static void collect_killed(Cse* c, ASTStatement* stmt) {
+    c->killed.count = 0;
+    if (stmt->type == STMT_VAR_DECL) {
+        name_list_add(&c->killed, stmt->as.var_decl_stmt.var_decl.name);
+    }
+    ASTExpression* slot;
+    for (int s = 0; (slot = statement_slot(stmt, s)); s++) {
+        collect_assigned(slot, &c->killed);
+    }
+}
+
+/* Helper: Count copies of `target` in an expression (not inside a copy) */
+static int count_matches(const ASTExpression* expr, const ASTExpression* target) {
+    if (expressions_equal(expr, target)) return 1;
+
+    switch (expr->type) {
+        case EXPR_UNARY_OP:
+            return count_matches(expr->as.unary_op.operand, target);
+        case EXPR_INDEX:
+            return count_matches(expr->as.index.index, target);
+        case EXPR_BINARY_OP:
+            return count_matches(expr->as.binary_op.left, target) +
+                   count_matches(expr->as.binary_op.right, target);
+        case EXPR_FUNCTION_CALL: {
+            int count = 0;
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                count += count_matches(&expr->as.function_call.arguments[i], target);
+            }
+            return count;
+        }
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Replace copies of `target` with a reference to `name` */
+static int replace_matches(ASTExpression* expr, const ASTExpression* target, const char* name) {
+    if (expressions_equal(expr, target)) {
+        ast_expression_free_contents(expr);
+        expr->type = EXPR_VARIABLE;
+        expr->as.variable.name = xstrdup(name);
+        expr->as.variable.location = expr->location;
+        return 1;
+    }
+
+    switch (expr->type) {
+        case EXPR_UNARY_OP:
+            return replace_matches(expr->as.unary_op.operand, target, name);
+        case EXPR_INDEX:
+            return replace_matches(expr->as.index.index, target, name);
+        case EXPR_BINARY_OP:
+            return replace_matches(expr->as.binary_op.left, target, name) +
+                   replace_matches(expr->as.binary_op.right, target, name);
+        case EXPR_FUNCTION_CALL: {
+            int count = 0;
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                count += replace_matches(&expr->as.function_call.arguments[i], target, name);
+            }
+            return count;
+        }
+        default:
+            return 0;
+    }
+}
+
+/* Helper: How many copies of `expr` a local computed before statement k
+ * could replace, up to (not including) statement *stop */
+static int count_available(Cse* c, ASTBlock* block, int k, int end,
+                           const ASTExpression* expr, int* stop) {
+    ASTStatement* first = &block->statements[k];
+    collect_killed(c, first);
+    if (mentions_any(expr, &c->killed)) return 0;
+
+    ASTExpression* slot;
+    int impure = 0;
+    for (int s = 0; (slot = statement_slot(first, s)); s++) {
+        if (has_impure_call(c, slot)) impure = 1;
+    }
+    if (impure && optimize_has_side_effects(expr)) return 0;
+
+    int total = 0;
+    int m = k;
+    for (; m < end; m++) {
+        ASTStatement* stmt = &block->statements[m];
+        if (m > k) {
+            collect_killed(c, stmt);
+            if (mentions_any(expr, &c->killed)) break;
+        }
+        for (int s = 0; (slot = statement_slot(stmt, s)); s++) {
+            total += count_matches(slot, expr);
+        }
+    }
+
+    if (stop) *stop = m;
+    return total;
+}
+
+/* Helper: The first expression evaluated unconditionally in statement k
+ * that is worth sharing, in evaluation order, largest first */
+static ASTExpression* find_anchor(Cse* c, ASTExpression* expr, int unconditional,
+                                  ASTBlock* block, int k, int end) {
+    if (!expr) return NULL;
+
+    if (unconditional && worth_a_local(expr) && is_pure(c, expr) &&
+        count_available(c, block, k, end, expr, NULL) >= 2) {
+        return expr;
+    }
+
+    ASTExpression* found = NULL;
+    switch (expr->type) {
+        case EXPR_BINARY_OP: {
+            ASTBinaryOp* bin = &expr->as.binary_op;
+            if (bin->op == BINOP_ASSIGN) {
+                if (bin->left->type == EXPR_INDEX) {
+                    found = find_anchor(c, bin->left->as.index.index, unconditional, block, k, end);
+                }
+                if (!found) found = find_anchor(c, bin->right, unconditional, block, k, end);
+            } else if (bin->op == BINOP_AND || bin->op == BINOP_OR) {
+                found = find_anchor(c, bin->left, unconditional, block, k, end);
+                if (!found) found = find_anchor(c, bin->right, 0, block, k, end);
+            } else {
+                found = find_anchor(c, bin->left, unconditional, block, k, end);
+                if (!found) found = find_anchor(c, bin->right, unconditional, block, k, end);
+            }
+            break;
+        }
+        case EXPR_UNARY_OP:
+            found = find_anchor(c, expr->as.unary_op.operand, unconditional, block, k, end);
+            break;
+        case EXPR_INDEX:
+            found = find_anchor(c, expr->as.index.index, unconditional, block, k, end);
+            break;
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count && !found; i++) {
+                found = find_anchor(c, &expr->as.function_call.arguments[i], unconditional,
+                                    block, k, end);
+            }
+            break;
+        default:
+            break;
+    }
+    return found;
+}
+
+/* Helper: Pick an unused name for a new local */
+static const char* fresh_name(Cse* c) {
+    char buffer[32];
+    do {
+        snprintf(buffer, sizeof(buffer), "cse%d", ++c->next_temp);
+    } while (name_list_contains(&c->taken, buffer));
+
+    c->owned = xrealloc(c->owned, (c->owned_count + 1) * sizeof(char*));
+    c->owned[c->owned_count] = xstrdup(buffer);
+    name_list_add(&c->taken, c->owned[c->owned_count]);
+    return c->owned[c->owned_count++];
+}
+
+/* Helper: Move `anchor` into a new local declared before statement k and
+ * point every available copy at it */
+static void share(Cse* c, ASTBlock* block, int k, int end, ASTExpression* anchor) {
+    int stop = k;
+    count_available(c, block, k, end, anchor, &stop);
+    const char* name = fresh_name(c);
+
+    ASTStatement decl_stmt;
+    memset(&decl_stmt, 0, sizeof(ASTStatement));
+    decl_stmt.type = STMT_VAR_DECL;
+    decl_stmt.location = anchor->location;
+    ASTVarDecl* decl = &decl_stmt.as.var_decl_stmt.var_decl;
+    decl->name = xstrdup(name);
+    decl->type.type = anchor->resolved_type;
+    decl->type.location = anchor->location;
+    decl->location = anchor->location;
+    decl->initializer = xmalloc(sizeof(ASTExpression));
+    *decl->initializer = *anchor;
+
+    anchor->type = EXPR_VARIABLE;
+    anchor->as.variable.name = xstrdup(name);
+    anchor->as.variable.location = anchor->location;
+
+    int replaced = 1;
+    for (int m = k; m < stop; m++) {
+        ASTExpression* slot;
+        for (int s = 0; (slot = statement_slot(&block->statements[m], s)); s++) {
+            replaced += replace_matches(slot, decl->initializer, name);
+        }
+    }
+    c->replaced_total += replaced;
+
+    block->statements = xrealloc(block->statements,
+                                 (block->statement_count + 1) * sizeof(ASTStatement));
+    memmove(&block->statements[k + 1], &block->statements[k],
+            (block->statement_count - k) * sizeof(ASTStatement));
+    block->statements[k] = decl_stmt;
+    block->statement_count++;
+}
+
+/* Helper: Share repeated expressions in statements [start, end) of a
+ * block. Returns the number of declarations added. */
+static int cse_region(Cse* c, ASTBlock* block, int start, int end) {
+    int added = 0;
+    for (int round = 0; round < MAX_ROUNDS; round++) {
+        ASTExpression* anchor = NULL;
+        int k = start;
+        for (; k < end + added && !anchor; k++) {
+            ASTExpression* slot;
+            for (int s = 0; !anchor && (slot = statement_slot(&block->statements[k], s)); s++) {
+                anchor = find_anchor(c, slot, 1, block, k, end + added);
+            }
+            if (anchor) break;
+        }
+        if (!anchor) break;
+
+        share(c, block, k, end + added, anchor);
+        added++;
+    }
+    return added;
+}
+
+static void cse_block(Cse* c, ASTBlock* block);
+
+/* Helper: Process the blocks nested in a statement */
+static void cse_nested(Cse* c, ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_IF: {
+            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            cse_block(c, &if_stmt->then_body);
+            for (ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                cse_block(c, &clause->body);
+            }
+            if (if_stmt->else_body) cse_block(c, if_stmt->else_body);
+            break;
+        }
+        case STMT_WHILE:
+            cse_block(c, &stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            cse_block(c, &stmt->as.for_stmt.body);
+            break;
+        case STMT_BLOCK:
+            cse_block(c, &stmt->as.block_stmt.block);
+            break;
+        default:
+            break;
+    }
+}
+
+static void cse_block(Cse* c, ASTBlock* block) {
+    int start = 0;
+    for (int i = 0; i <= block->statement_count; i++) {
+        if (i < block->statement_count && is_region_statement(&block->statements[i])) {
+            continue;
+        }
+
+        /* An if's condition runs right after the region, so it joins it */
+        int ends_with_if = i < block->statement_count && block->statements[i].type == STMT_IF;
+        i += cse_region(c, block, start, ends_with_if ? i + 1 : i);
+
+        if (i < block->statement_count) {
+            cse_nested(c, &block->statements[i]);
+        }
+        start = i + 1;
+    }
+}
+
+/* Helper: Every name a function declares, so new locals cannot collide */
+static void collect_declared_block(Cse* c, const ASTBlock* block);
+
+static void collect_declared_statement(Cse* c, const ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            name_list_add(&c->taken, stmt->as.var_decl_stmt.var_decl.name);
+            break;
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            collect_declared_block(c, &if_stmt->then_body);
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                collect_declared_block(c, &clause->body);
+            }
+            if (if_stmt->else_body) collect_declared_block(c, if_stmt->else_body);
+            break;
+        }
+        case STMT_WHILE:
+            collect_declared_block(c, &stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            if (stmt->as.for_stmt.init) collect_declared_statement(c, stmt->as.for_stmt.init);
+            collect_declared_block(c, &stmt->as.for_stmt.body);
+            break;
+        case STMT_BLOCK:
+            collect_declared_block(c, &stmt->as.block_stmt.block);
+            break;
+        default:
+            break;
+    }
+}
+
+static void collect_declared_block(Cse* c, const ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        collect_declared_statement(c, &block->statements[i]);
+    }
+}
+
+int eliminate_common_subexpressions(ASTProgram* program) {
+    int n = program ? program->function_count : 0;
+    if (n == 0) return 0;
+
+    /* The call graph identifies functions by symbol_id; programs that did
+     * not go through the module loader have none yet */
+    for (int i = 0; i < n; i++) {
+        if (program->functions[i].symbol_id == 0) {
+            for (int j = 0; j < n; j++) {
+                program->functions[j].symbol_id = (uint32_t)(j + 1);
+            }
+            break;
+        }
+    }
+
+    CallGraph* graph = call_graph_create(program);
+    Cse c;
+    memset(&c, 0, sizeof(Cse));
+    c.program = program;
+    c.pure = call_graph_find_pure_functions(graph, program);
+
+    for (int i = 0; i < n; i++) {
+        ASTFunctionDef* func = &program->functions[i];
+        c.taken.count = 0;
+        for (int j = 0; j < n; j++) {
+            name_list_add(&c.taken, program->functions[j].name);
+        }
+        for (int j = 0; j < program->global_count; j++) {
+            name_list_add(&c.taken, program->globals[j].decl.name);
+        }
+        for (int j = 0; j < func->parameter_count; j++) {
+            name_list_add(&c.taken, func->parameters[j].name);
+        }
+        collect_declared_block(&c, &func->body);
+        c.next_temp = 0;
+        cse_block(&c, &func->body);
+    }
+
+    for (int i = 0; i < c.owned_count; i++) {
+        xfree(c.owned[i]);
+    }
+    xfree(c.owned);
+    xfree(c.taken.names);
+    xfree(c.killed.names);
+    xfree(c.pure);
+    call_graph_free(graph);
+    return c.replaced_total;
+}
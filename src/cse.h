@@ -0,0 +1,13 @@
+#ifndef CSE_H
+#define CSE_H
+
+#include "ast.h"
+
+/* Local value numbering over straight-line runs of statements. A pure
+ * expression that is computed more than once, with no assignment to its
+ * variables in between, is computed once into a fresh `T cseN` local
+ * declared before the statement that first needs it. Returns the number
+ * of expressions replaced by such a local. */
+int eliminate_common_subexpressions(ASTProgram* program);
+
+#endif /* CSE_H */
@@ -0,0 +1,851 @@
+#include <stdint.h>
+#include <string.h>
+#include "dead_stores.h"
+#include "optimizer.h"
+#include "utils.h"
+
+/* Variables are numbered per function: parameters first, then locals in
+ * declaration order. Every variable reference and every local declaration
+ * is mapped to its number through a pointer-keyed table, so shadowed names
+ * stay apart. The mapping is rebuilt after each round of removals.
+ *
+ * Two analyses run in turn until neither removes anything:
+ *   - faint variables (flow-insensitive): a variable is needed if it is read
+ *     anywhere other than the pure right-hand side of a store to a variable
+ *     that is not needed itself. Unneeded variables lose all their stores
+ *     and their declaration.
+ *   - liveness (backward over the structured statements, loops iterated to
+ *     a fixpoint): a store is dead if no path reads the variable before it
+ *     is overwritten or the function returns. */
+
+#define MAX_ROUNDS 16
+
+/* Pointer -> variable id (open addressing, linear probing) */
+typedef struct {
+    const void** keys;
+    int* values;
+    int capacity;
+    int count;
+} NodeMap;
+
+typedef struct {
+    NodeMap ids;
+    int var_count;
+
+    /* Resolution scope stack */
+    const char** scope_names;
+    int* scope_ids;
+    int scope_count;
+    int scope_capacity;
+
+    /* Faint analysis: needed flags and "target needs source" edges */
+    unsigned char* needed;
+    int* edge_targets;
+    int* edge_sources;
+    int edge_count;
+    int edge_capacity;
+
+    /* Liveness: the sets `break` and `continue` jump to in the innermost loop */
+    const unsigned char* break_live;
+    const unsigned char* continue_live;
+
+    DeadStoreStats counts;
+} DseState;
+
+/* ========================================================================
+ * Variable resolution
+ * ======================================================================== */
+
+/* Helper: Hash a node pointer */
+static unsigned int hash_pointer(const void* ptr, int capacity) {
+    uintptr_t value = (uintptr_t)ptr;
+    value ^= value >> 17;
+    value *= 0x9E3779B1u;
+    return (unsigned int)(value ^ (value >> 15)) & (unsigned int)(capacity - 1);
+}
+
+static void node_map_put(NodeMap* map, const void* key, int value);
+
+/* Helper: Double the table when it gets half full */
+static void node_map_grow(NodeMap* map) {
+    NodeMap old = *map;
+    map->capacity = old.capacity ? old.capacity * 2 : 64;
+    map->keys = xmalloc((size_t)map->capacity * sizeof(const void*));
+    memset(map->keys, 0, (size_t)map->capacity * sizeof(const void*));
+    map->values = xmalloc((size_t)map->capacity * sizeof(int));
+    map->count = 0;
+    for (int i = 0; i < old.capacity; i++) {
+        if (old.keys[i]) {
+            node_map_put(map, old.keys[i], old.values[i]);
+        }
+    }
+    xfree(old.keys);
+    xfree(old.values);
+}
+
+static void node_map_put(NodeMap* map, const void* key, int value) {
+    if ((map->count + 1) * 2 > map->capacity) {
+        node_map_grow(map);
+    }
+    unsigned int slot = hash_pointer(key, map->capacity);
+    while (map->keys[slot] && map->keys[slot] != key) {
+        slot = (slot + 1) & (unsigned int)(map->capacity - 1);
+    }
+    if (!map->keys[slot]) {
+        map->keys[slot] = key;
+        map->count++;
+    }
+    map->values[slot] = value;
+}
+
+/* Helper: Look up a node, -1 if it was not resolved */
+static int node_map_get(const NodeMap* map, const void* key) {
+    if (map->capacity == 0) return -1;
+    unsigned int slot = hash_pointer(key, map->capacity);
+    while (map->keys[slot]) {
+        if (map->keys[slot] == key) {
+            return map->values[slot];
+        }
+        slot = (slot + 1) & (unsigned int)(map->capacity - 1);
+    }
+    return -1;
+}
+
+/* Helper: Declare a name in the innermost scope and return its id */
+static int declare_variable(DseState* s, const char* name) {
+    if (s->scope_count == s->scope_capacity) {
+        s->scope_capacity = s->scope_capacity ? s->scope_capacity * 2 : 16;
+        s->scope_names = xrealloc(s->scope_names, (size_t)s->scope_capacity * sizeof(const char*));
+        s->scope_ids = xrealloc(s->scope_ids, (size_t)s->scope_capacity * sizeof(int));
+    }
+    s->scope_names[s->scope_count] = name;
+    s->scope_ids[s->scope_count] = s->var_count;
+    s->scope_count++;
+    return s->var_count++;
+}
+
+static int lookup_variable(const DseState* s, const char* name) {
+    for (int i = s->scope_count - 1; i >= 0; i--) {
+        if (strcmp(s->scope_names[i], name) == 0) {
+            return s->scope_ids[i];
+        }
+    }
+    return -1;
+}
+
+static void resolve_expression(DseState* s, const ASTExpression* expr) {
+    if (!expr) return;
+
+    switch (expr->type) {
+        case EXPR_VARIABLE: {
+            int id = lookup_variable(s, expr->as.variable.name);
+            if (id >= 0) {
+                node_map_put(&s->ids, expr, id);
+            }
+            break;
+        }
+        case EXPR_BINARY_OP:
+            resolve_expression(s, expr->as.binary_op.left);
+            resolve_expression(s, expr->as.binary_op.right);
+            break;
+        case EXPR_UNARY_OP:
+            resolve_expression(s, expr->as.unary_op.operand);
+            break;
+        case EXPR_INDEX:
+            resolve_expression(s, expr->as.index.index);
+            break;
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                resolve_expression(s, &expr->as.function_call.arguments[i]);
+            }
+            break;
+        case EXPR_FIELD:
+        case EXPR_LITERAL:
+            break;
+    }
+}
+
+static void resolve_block(DseState* s, const ASTBlock* block);
+
+static void resolve_statement(DseState* s, const ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            resolve_expression(s, stmt->as.return_stmt.value);
+            break;
+        case STMT_EXPR:
+            resolve_expression(s, stmt->as.expr_stmt.expr);
+            break;
+        case STMT_VAR_DECL: {
+            const ASTVarDecl* var = &stmt->as.var_decl_stmt.var_decl;
+            resolve_expression(s, var->initializer);
+            node_map_put(&s->ids, var, declare_variable(s, var->name));
+            break;
+        }
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            resolve_expression(s, if_stmt->condition);
+            resolve_block(s, &if_stmt->then_body);
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                resolve_expression(s, clause->condition);
+                resolve_block(s, &clause->body);
+            }
+            if (if_stmt->else_body) {
+                resolve_block(s, if_stmt->else_body);
+            }
+            break;
+        }
+        case STMT_WHILE:
+            resolve_expression(s, stmt->as.while_stmt.condition);
+            resolve_block(s, &stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR: {
+            const ASTForStmt* for_stmt = &stmt->as.for_stmt;
+            int mark = s->scope_count;
+            if (for_stmt->init) {
+                resolve_statement(s, for_stmt->init);
+            }
+            resolve_expression(s, for_stmt->condition);
+            resolve_expression(s, for_stmt->update);
+            resolve_block(s, &for_stmt->body);
+            s->scope_count = mark;
+            break;
+        }
+        case STMT_BLOCK:
+            resolve_block(s, &stmt->as.block_stmt.block);
+            break;
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                resolve_expression(s, &stmt->as.dbg_stmt.arguments[i]);
+            }
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+}
+
+static void resolve_block(DseState* s, const ASTBlock* block) {
+    int mark = s->scope_count;
+    for (int i = 0; i < block->statement_count; i++) {
+        resolve_statement(s, &block->statements[i]);
+    }
+    s->scope_count = mark;
+}
+
+/* Helper: Reset the state and number the function's variables */
+static void resolve_function(DseState* s, const ASTFunctionDef* func) {
+    if (s->ids.capacity) {
+        memset(s->ids.keys, 0, (size_t)s->ids.capacity * sizeof(const void*));
+    }
+    s->ids.count = 0;
+    s->var_count = 0;
+    s->scope_count = 0;
+    s->edge_count = 0;
+
+    for (int i = 0; i < func->parameter_count; i++) {
+        declare_variable(s, func->parameters[i].name);
+    }
+    resolve_block(s, &func->body);
+}
+
+/* Helper: The variable stored to by `x = ...`, or -1 */
+static int store_target(const DseState* s, const ASTExpression* expr) {
+    if (!expr || expr->type != EXPR_BINARY_OP || expr->as.binary_op.op != BINOP_ASSIGN ||
+        expr->as.binary_op.left->type != EXPR_VARIABLE) {
+        return -1;
+    }
+    return node_map_get(&s->ids, expr->as.binary_op.left);
+}
+
+/* Helper: Check if a store whose target is dead can go. A pure value is
+ * dropped and a direct call is kept for its effects; anything else (a
+ * division that may trap, a nested assignment) keeps the whole store. */
+static int is_removable_value(const ASTExpression* value) {
+    return value->type == EXPR_FUNCTION_CALL || !optimize_has_side_effects(value);
+}
+
+/* Helper: Replace the store in `*slot` by its call, or free it and return 0
+ * if nothing is left */
+static int strip_store(ASTExpression** slot) {
+    ASTExpression* value = (*slot)->as.binary_op.right;
+    if (value->type != EXPR_FUNCTION_CALL) {
+        ast_expression_free(*slot);
+        *slot = NULL;
+        return 0;
+    }
+    (*slot)->as.binary_op.right = NULL;
+    ast_expression_free(*slot);
+    *slot = value;
+    return 1;
+}
+
+/* ========================================================================
+ * Faint variables
+ * ======================================================================== */
+
+/* Helper: Mark every variable mentioned in an expression as needed */
+static void mark_needed(DseState* s, const ASTExpression* expr) {
+    if (!expr) return;
+
+    switch (expr->type) {
+        case EXPR_VARIABLE: {
+            int id = node_map_get(&s->ids, expr);
+            if (id >= 0) {
+                s->needed[id] = 1;
+            }
+            break;
+        }
+        case EXPR_BINARY_OP:
+            mark_needed(s, expr->as.binary_op.left);
+            mark_needed(s, expr->as.binary_op.right);
+            break;
+        case EXPR_UNARY_OP:
+            mark_needed(s, expr->as.unary_op.operand);
+            break;
+        case EXPR_INDEX:
+            mark_needed(s, expr->as.index.index);
+            break;
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                mark_needed(s, &expr->as.function_call.arguments[i]);
+            }
+            break;
+        case EXPR_FIELD:
+        case EXPR_LITERAL:
+            break;
+    }
+}
+
+/* Helper: Record that `target` needs every variable read by a pure value */
+static void add_edges(DseState* s, int target, const ASTExpression* value) {
+    if (!value) return;
+
+    switch (value->type) {
+        case EXPR_VARIABLE: {
+            int id = node_map_get(&s->ids, value);
+            if (id < 0) break;
+            if (s->edge_count == s->edge_capacity) {
+                s->edge_capacity = s->edge_capacity ? s->edge_capacity * 2 : 32;
+                s->edge_targets = xrealloc(s->edge_targets, (size_t)s->edge_capacity * sizeof(int));
+                s->edge_sources = xrealloc(s->edge_sources, (size_t)s->edge_capacity * sizeof(int));
+            }
+            s->edge_targets[s->edge_count] = target;
+            s->edge_sources[s->edge_count] = id;
+            s->edge_count++;
+            break;
+        }
+        case EXPR_BINARY_OP:
+            add_edges(s, target, value->as.binary_op.left);
+            add_edges(s, target, value->as.binary_op.right);
+            break;
+        case EXPR_UNARY_OP:
+            add_edges(s, target, value->as.unary_op.operand);
+            break;
+        case EXPR_INDEX:
+            add_edges(s, target, value->as.index.index);
+            break;
+        case EXPR_FUNCTION_CALL:
+        case EXPR_FIELD:
+        case EXPR_LITERAL:
+            break;
+    }
+}
+
+/* Helper: Account for a store of `value` into `target` */
+static void note_store(DseState* s, int target, const ASTExpression* value) {
+    if (!optimize_has_side_effects(value)) {
+        add_edges(s, target, value);
+        return;
+    }
+    if (!is_removable_value(value)) {
+        s->needed[target] = 1;
+    }
+    mark_needed(s, value);
+}
+
+/* Helper: Account for an expression evaluated as a statement */
+static void note_expression_statement(DseState* s, const ASTExpression* expr) {
+    int target = store_target(s, expr);
+    if (target >= 0) {
+        note_store(s, target, expr->as.binary_op.right);
+    } else {
+        mark_needed(s, expr);
+    }
+}
+
+static void note_block(DseState* s, const ASTBlock* block);
+
+static void note_statement(DseState* s, const ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            mark_needed(s, stmt->as.return_stmt.value);
+            break;
+        case STMT_EXPR:
+            note_expression_statement(s, stmt->as.expr_stmt.expr);
+            break;
+        case STMT_VAR_DECL: {
+            const ASTVarDecl* var = &stmt->as.var_decl_stmt.var_decl;
+            if (var->array_length > 0 || var->type.type == TYPE_STRUCT) {
+                /* Element and field stores are not tracked, so arrays and structs always stay */
+                s->needed[node_map_get(&s->ids, var)] = 1;
+            } else if (var->initializer) {
+                note_store(s, node_map_get(&s->ids, var), var->initializer);
+            }
+            break;
+        }
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            mark_needed(s, if_stmt->condition);
+            note_block(s, &if_stmt->then_body);
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                mark_needed(s, clause->condition);
+                note_block(s, &clause->body);
+            }
+            if (if_stmt->else_body) {
+                note_block(s, if_stmt->else_body);
+            }
+            break;
+        }
+        case STMT_WHILE:
+            mark_needed(s, stmt->as.while_stmt.condition);
+            note_block(s, &stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR: {
+            const ASTForStmt* for_stmt = &stmt->as.for_stmt;
+            if (for_stmt->init) {
+                note_statement(s, for_stmt->init);
+            }
+            mark_needed(s, for_stmt->condition);
+            if (for_stmt->update) {
+                note_expression_statement(s, for_stmt->update);
+            }
+            note_block(s, &for_stmt->body);
+            break;
+        }
+        case STMT_BLOCK:
+            note_block(s, &stmt->as.block_stmt.block);
+            break;
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                mark_needed(s, &stmt->as.dbg_stmt.arguments[i]);
+            }
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+}
+
+static void note_block(DseState* s, const ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        note_statement(s, &block->statements[i]);
+    }
+}
+
+/* Helper: Propagate neededness along the store edges to a fixpoint */
+static void propagate_needed(DseState* s) {
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < s->edge_count; i++) {
+            if (s->needed[s->edge_targets[i]] && !s->needed[s->edge_sources[i]]) {
+                s->needed[s->edge_sources[i]] = 1;
+                changed = 1;
+            }
+        }
+    }
+}
+
+/* Helper: Check if a store into this variable goes */
+static int is_faint(const DseState* s, int id) {
+    return id >= 0 && !s->needed[id];
+}
+
+static void strip_faint_block(DseState* s, ASTBlock* block);
+
+/* Helper: Drop a faint local's declaration, keeping a call initializer.
+ * Returns 0 if the statement should be removed. */
+static int strip_faint_decl(DseState* s, ASTStatement* stmt) {
+    ASTExpression* init = stmt->as.var_decl_stmt.var_decl.initializer;
+    s->counts.locals_removed++;
+    if (!init || init->type != EXPR_FUNCTION_CALL) {
+        return 0;
+    }
+    stmt->as.var_decl_stmt.var_decl.initializer = NULL;
+    ast_statement_free_contents(stmt);
+    stmt->type = STMT_EXPR;
+    stmt->as.expr_stmt.expr = init;
+    stmt->as.expr_stmt.location = stmt->location;
+    return 1;
+}
+
+/* Remove stores to faint variables. Returns 0 if the statement should be
+ * removed. */
+static int strip_faint_statement(DseState* s, ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_EXPR:
+            if (is_faint(s, store_target(s, stmt->as.expr_stmt.expr))) {
+                s->counts.stores_removed++;
+                return strip_store(&stmt->as.expr_stmt.expr);
+            }
+            return 1;
+        case STMT_VAR_DECL:
+            if (is_faint(s, node_map_get(&s->ids, &stmt->as.var_decl_stmt.var_decl))) {
+                return strip_faint_decl(s, stmt);
+            }
+            return 1;
+        case STMT_IF: {
+            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            strip_faint_block(s, &if_stmt->then_body);
+            for (ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                strip_faint_block(s, &clause->body);
+            }
+            if (if_stmt->else_body) {
+                strip_faint_block(s, if_stmt->else_body);
+            }
+            return 1;
+        }
+        case STMT_WHILE:
+            strip_faint_block(s, &stmt->as.while_stmt.body);
+            return 1;
+        case STMT_FOR: {
+            ASTForStmt* for_stmt = &stmt->as.for_stmt;
+            if (for_stmt->init && !strip_faint_statement(s, for_stmt->init)) {
+                ast_statement_free(for_stmt->init);
+                for_stmt->init = NULL;
+            }
+            if (is_faint(s, store_target(s, for_stmt->update))) {
+                s->counts.stores_removed++;
+                strip_store(&for_stmt->update);
+            }
+            strip_faint_block(s, &for_stmt->body);
+            return 1;
+        }
+        case STMT_BLOCK:
+            strip_faint_block(s, &stmt->as.block_stmt.block);
+            return 1;
+        case STMT_RETURN:
+        case STMT_DBG:
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            return 1;
+    }
+    return 1;
+}
+
+static void strip_faint_block(DseState* s, ASTBlock* block) {
+    int kept = 0;
+    for (int i = 0; i < block->statement_count; i++) {
+        if (strip_faint_statement(s, &block->statements[i])) {
+            block->statements[kept++] = block->statements[i];
+        } else {
+            ast_statement_free_contents(&block->statements[i]);
+        }
+    }
+    block->statement_count = kept;
+}
+
+/* ========================================================================
+ * Liveness
+ * ======================================================================== */
+
+/* Live sets are one byte per variable */
+static unsigned char* live_copy(const DseState* s, const unsigned char* live) {
+    unsigned char* copy = xmalloc((size_t)s->var_count + 1);
+    memcpy(copy, live, (size_t)s->var_count);
+    return copy;
+}
+
+static void live_union(const DseState* s, unsigned char* live, const unsigned char* other) {
+    for (int i = 0; i < s->var_count; i++) {
+        live[i] |= other[i];
+    }
+}
+
+/* Helper: Transfer a live set backwards over an expression */
+static void live_expression(DseState* s, const ASTExpression* expr, unsigned char* live) {
+    if (!expr) return;
+
+    switch (expr->type) {
+        case EXPR_VARIABLE: {
+            int id = node_map_get(&s->ids, expr);
+            if (id >= 0) {
+                live[id] = 1;
+            }
+            break;
+        }
+        case EXPR_BINARY_OP: {
+            const ASTBinaryOp* bin = &expr->as.binary_op;
+            if (bin->op == BINOP_ASSIGN) {
+                int target = store_target(s, expr);
+                if (target >= 0) {
+                    live[target] = 0;
+                }
+                live_expression(s, bin->right, live);
+                if (bin->left->type == EXPR_INDEX) {
+                    live_expression(s, bin->left->as.index.index, live);
+                }
+            } else if (bin->op == BINOP_AND || bin->op == BINOP_OR) {
+                /* The right operand may be skipped */
+                unsigned char* taken = live_copy(s, live);
+                live_expression(s, bin->right, taken);
+                live_union(s, live, taken);
+                xfree(taken);
+                live_expression(s, bin->left, live);
+            } else {
+                live_expression(s, bin->right, live);
+                live_expression(s, bin->left, live);
+            }
+            break;
+        }
+        case EXPR_UNARY_OP:
+            live_expression(s, expr->as.unary_op.operand, live);
+            break;
+        case EXPR_INDEX:
+            live_expression(s, expr->as.index.index, live);
+            break;
+        case EXPR_FUNCTION_CALL:
+            for (int i = expr->as.function_call.argument_count - 1; i >= 0; i--) {
+                live_expression(s, &expr->as.function_call.arguments[i], live);
+            }
+            break;
+        case EXPR_FIELD:
+        case EXPR_LITERAL:
+            break;
+    }
+}
+
+/* Helper: Transfer over an expression evaluated for its effects, removing
+ * it when `apply` is set and it is a store nobody reads. Returns 0 if the
+ * expression was removed (`*slot` is then NULL). */
+static int live_effect(DseState* s, ASTExpression** slot, unsigned char* live, int apply) {
+    int target = store_target(s, *slot);
+    if (apply && target >= 0 && !live[target] &&
+        is_removable_value((*slot)->as.binary_op.right)) {
+        s->counts.stores_removed++;
+        if (!strip_store(slot)) {
+            return 0;
+        }
+    }
+    live_expression(s, *slot, live);
+    return 1;
+}
+
+static void live_block(DseState* s, ASTBlock* block, unsigned char* live, int apply);
+static int live_statement(DseState* s, ASTStatement* stmt, unsigned char* live, int apply);
+
+/* Helper: Transfer over the rest of an if chain starting at a condition */
+static void live_if_chain(DseState* s, const ASTExpression* condition, ASTBlock* then_body,
+                          ASTElseIfClause* next, ASTBlock* else_body,
+                          unsigned char* live, int apply) {
+    unsigned char* taken = live_copy(s, live);
+    live_block(s, then_body, taken, apply);
+    if (next) {
+        live_if_chain(s, next->condition, &next->body, next->next, else_body, live, apply);
+    } else if (else_body) {
+        live_block(s, else_body, live, apply);
+    }
+    live_union(s, live, taken);
+    xfree(taken);
+    live_expression(s, condition, live);
+}
+
+/* Helper: Check if a loop condition never fails, so only `break` leaves */
+static int is_always_true(const ASTExpression* condition) {
+    return !condition || (condition->type == EXPR_LITERAL && condition->as.literal.type == LITERAL_BOOL &&
+                          condition->as.literal.value.bool_value);
+}
+
+/* Helper: Transfer over a loop. `live` holds the set after the loop on
+ * entry and the set at the loop head on exit. `break` continues from the
+ * set after the loop and `continue` from the set before the update. */
+static void live_loop(DseState* s, const ASTExpression* condition, ASTBlock* body,
+                      ASTExpression** update, unsigned char* live, int apply) {
+    const unsigned char* saved_break = s->break_live;
+    const unsigned char* saved_continue = s->continue_live;
+    int endless = is_always_true(condition);
+    unsigned char* exit = live_copy(s, live);
+    unsigned char* head = live_copy(s, live);
+    if (endless) {
+        memset(head, 0, (size_t)s->var_count);
+    }
+    live_expression(s, condition, head);
+    s->break_live = exit;
+
+    for (;;) {
+        unsigned char* next = live_copy(s, head);
+        if (*update) {
+            live_expression(s, *update, next);
+        }
+        s->continue_live = next;
+        unsigned char* body_live = live_copy(s, next);
+        live_block(s, body, body_live, 0);
+        memcpy(next, body_live, (size_t)s->var_count);
+        xfree(body_live);
+        if (!endless) {
+            live_union(s, next, exit);
+        }
+        live_expression(s, condition, next);
+        int stable = memcmp(next, head, (size_t)s->var_count) == 0;
+        xfree(head);
+        head = next;
+        if (stable) break;
+    }
+
+    if (apply) {
+        unsigned char* tail = live_copy(s, head);
+        if (*update) {
+            live_effect(s, update, tail, 1);
+        }
+        unsigned char* cont = live_copy(s, tail);
+        s->continue_live = cont;
+        live_block(s, body, tail, 1);
+        xfree(cont);
+        xfree(tail);
+    }
+
+    s->break_live = saved_break;
+    s->continue_live = saved_continue;
+    memcpy(live, head, (size_t)s->var_count);
+    xfree(head);
+    xfree(exit);
+}
+
+/* Transfer a live set backwards over a statement. Returns 0 if the
+ * statement should be removed. */
+static int live_statement(DseState* s, ASTStatement* stmt, unsigned char* live, int apply) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            memset(live, 0, (size_t)s->var_count);
+            live_expression(s, stmt->as.return_stmt.value, live);
+            return 1;
+        case STMT_EXPR:
+            return live_effect(s, &stmt->as.expr_stmt.expr, live, apply);
+        case STMT_VAR_DECL: {
+            ASTVarDecl* var = &stmt->as.var_decl_stmt.var_decl;
+            int id = node_map_get(&s->ids, var);
+            if (id < 0) return 1;
+            /* Keep the local (it is read later) but not its first value */
+            if (apply && !live[id] && var->initializer &&
+                !optimize_has_side_effects(var->initializer)) {
+                s->counts.stores_removed++;
+                ast_expression_free(var->initializer);
+                var->initializer = NULL;
+            }
+            live[id] = 0;
+            live_expression(s, var->initializer, live);
+            return 1;
+        }
+        case STMT_IF: {
+            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            live_if_chain(s, if_stmt->condition, &if_stmt->then_body,
+                          if_stmt->else_if_chain, if_stmt->else_body, live, apply);
+            return 1;
+        }
+        case STMT_WHILE: {
+            ASTExpression* no_update = NULL;
+            live_loop(s, stmt->as.while_stmt.condition, &stmt->as.while_stmt.body,
+                      &no_update, live, apply);
+            return 1;
+        }
+        case STMT_FOR: {
+            ASTForStmt* for_stmt = &stmt->as.for_stmt;
+            live_loop(s, for_stmt->condition, &for_stmt->body, &for_stmt->update, live, apply);
+            if (for_stmt->init && !live_statement(s, for_stmt->init, live, apply)) {
+                ast_statement_free(for_stmt->init);
+                for_stmt->init = NULL;
+            }
+            return 1;
+        }
+        case STMT_BLOCK:
+            live_block(s, &stmt->as.block_stmt.block, live, apply);
+            return 1;
+        case STMT_DBG:
+            for (int i = stmt->as.dbg_stmt.argument_count - 1; i >= 0; i--) {
+                live_expression(s, &stmt->as.dbg_stmt.arguments[i], live);
+            }
+            return 1;
+        case STMT_BREAK:
+            memcpy(live, s->break_live, (size_t)s->var_count);
+            return 1;
+        case STMT_CONTINUE:
+            memcpy(live, s->continue_live, (size_t)s->var_count);
+            return 1;
+    }
+    return 1;
+}
+
+static void live_block(DseState* s, ASTBlock* block, unsigned char* live, int apply) {
+    if (block->statement_count == 0) return;
+
+    unsigned char* keep = xmalloc((size_t)block->statement_count);
+    for (int i = block->statement_count - 1; i >= 0; i--) {
+        keep[i] = (unsigned char)live_statement(s, &block->statements[i], live, apply);
+    }
+
+    int kept = 0;
+    for (int i = 0; i < block->statement_count; i++) {
+        if (keep[i]) {
+            block->statements[kept++] = block->statements[i];
+        } else {
+            ast_statement_free_contents(&block->statements[i]);
+        }
+    }
+    block->statement_count = kept;
+    xfree(keep);
+}
+
+/* ========================================================================
+ * Driver
+ * ======================================================================== */
+
+/* Helper: One round of both analyses. Returns the number of removals. */
+static int eliminate_round(DseState* s, ASTFunctionDef* func) {
+    int before = s->counts.stores_removed + s->counts.locals_removed;
+
+    resolve_function(s, func);
+    s->needed = xrealloc(s->needed, (size_t)s->var_count + 1);
+    memset(s->needed, 0, (size_t)s->var_count + 1);
+    note_block(s, &func->body);
+    propagate_needed(s);
+    strip_faint_block(s, &func->body);
+
+    if (s->counts.stores_removed + s->counts.locals_removed != before) {
+        return s->counts.stores_removed + s->counts.locals_removed - before;
+    }
+
+    /* Nothing at the end of the body is live (returns read their values) */
+    unsigned char* live = xmalloc((size_t)s->var_count + 1);
+    memset(live, 0, (size_t)s->var_count + 1);
+    live_block(s, &func->body, live, 1);
+    xfree(live);
+
+    return s->counts.stores_removed + s->counts.locals_removed - before;
+}
+
+int eliminate_dead_stores(ASTProgram* program, DeadStoreStats* stats) {
+    if (!program) return 0;
+
+    DseState s;
+    memset(&s, 0, sizeof(s));
+
+    for (int i = 0; i < program->function_count; i++) {
+        for (int round = 0; round < MAX_ROUNDS; round++) {
+            if (eliminate_round(&s, &program->functions[i]) == 0) break;
+        }
+    }
+
+    xfree(s.ids.keys);
+    xfree(s.ids.values);
+    xfree(s.scope_names);
+    xfree(s.scope_ids);
+    xfree(s.needed);
+    xfree(s.edge_targets);
+    xfree(s.edge_sources);
+
+    if (stats) {
+        stats->stores_removed += s.counts.stores_removed;
+        stats->locals_removed += s.counts.locals_removed;
+    }
+    return s.counts.stores_removed + s.counts.locals_removed;
+}
@@ -0,0 +1,18 @@
+#ifndef DEAD_STORES_H
+#define DEAD_STORES_H
+
+#include "ast.h"
+
+typedef struct {
+    int stores_removed;     /* Assignments and initializers dropped */
+    int locals_removed;     /* Local declarations dropped */
+} DeadStoreStats;
+
+/* Remove stores whose value is never read and locals that are never used
+ * (including variables that only feed their own updates, such as an
+ * unused `for` counter). Calls on the right-hand side of a removed store
+ * are kept as expression statements. Returns the total number of stores
+ * and locals removed; `stats` may be NULL. */
+int eliminate_dead_stores(ASTProgram* program, DeadStoreStats* stats);
+
+#endif /* DEAD_STORES_H */
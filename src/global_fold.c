@@ -0,0 +1,171 @@
+#include <limits.h>
+#include "global_fold.h"
+#include "utils.h"
+
+/* Scalar globals are read and written as element 0 of a one-element
+ * array (ASTIndexExpr.scalar), so the first walk looks for assignments to
+ * such accesses and the second turns the reads of the untouched ones into
+ * literals of the global's type. */
+
+typedef struct {
+    ASTProgram* program;
+    int* written;       /* Per global: assigned somewhere */
+    int* foldable;      /* Per global: reads are replaced by the initializer */
+    int replacing;      /* 0 while looking for assignments, 1 while replacing */
+} GlobalFolder;
+
+/* Helper: Replace a read of a folded global with its initial value */
+static void replace_read(GlobalFolder* f, ASTExpression* expr) {
+    ASTVarDecl* decl = &f->program->globals[expr->as.index.global_index].decl;
+    long value = decl->element_count > 0 ? decl->elements[0] : 0;
+    ast_expression_free_contents(expr);
+    expr->type = EXPR_LITERAL;
+    if (decl->type.type == TYPE_BOOL) {
+        expr->as.literal.type = LITERAL_BOOL;
+        expr->as.literal.value.bool_value = value != 0;
+    } else {
+        expr->as.literal.type = LITERAL_INT;
+        expr->as.literal.value.int_value = value;
+    }
+    expr->as.literal.location = expr->location;
+    expr->resolved_type = decl->type.type;
+}
+
+static void visit_block(GlobalFolder* f, ASTBlock* block);
+
+static void visit_expression(GlobalFolder* f, ASTExpression* expr) {
+    if (!expr) return;
+    switch (expr->type) {
+        case EXPR_BINARY_OP: {
+            ASTBinaryOp* binop = &expr->as.binary_op;
+            if (!f->replacing && binop->op == BINOP_ASSIGN &&
+                binop->left->type == EXPR_INDEX && binop->left->as.index.scalar) {
+                f->written[binop->left->as.index.global_index] = 1;
+            }
+            visit_expression(f, binop->left);
+            visit_expression(f, binop->right);
+            break;
+        }
+        case EXPR_UNARY_OP:
+            visit_expression(f, expr->as.unary_op.operand);
+            break;
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                visit_expression(f, &expr->as.function_call.arguments[i]);
+            }
+            break;
+        case EXPR_INDEX:
+            if (f->replacing && expr->as.index.scalar && f->foldable[expr->as.index.global_index]) {
+                replace_read(f, expr);
+                break;
+            }
+            visit_expression(f, expr->as.index.index);
+            break;
+        default:
+            break;
+    }
+}
+
+static void visit_statement(GlobalFolder* f, ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            visit_expression(f, stmt->as.return_stmt.value);
+            break;
+        case STMT_EXPR:
+            visit_expression(f, stmt->as.expr_stmt.expr);
+            break;
+        case STMT_VAR_DECL:
+            visit_expression(f, stmt->as.var_decl_stmt.var_decl.initializer);
+            break;
+        case STMT_IF: {
+            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            visit_expression(f, if_stmt->condition);
+            visit_block(f, &if_stmt->then_body);
+            for (ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                visit_expression(f, clause->condition);
+                visit_block(f, &clause->body);
+            }
+            if (if_stmt->else_body) {
+                visit_block(f, if_stmt->else_body);
+            }
+            break;
+        }
+        case STMT_WHILE:
+            visit_expression(f, stmt->as.while_stmt.condition);
+            visit_block(f, &stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            if (stmt->as.for_stmt.init) {
+                visit_statement(f, stmt->as.for_stmt.init);
+            }
+            visit_expression(f, stmt->as.for_stmt.condition);
+            visit_expression(f, stmt->as.for_stmt.update);
+            visit_block(f, &stmt->as.for_stmt.body);
+            break;
+        case STMT_BLOCK:
+            visit_block(f, &stmt->as.block_stmt.block);
+            break;
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                visit_expression(f, &stmt->as.dbg_stmt.arguments[i]);
+            }
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+}
+
+static void visit_block(GlobalFolder* f, ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        visit_statement(f, &block->statements[i]);
+    }
+}
+
+/* Helper: Check if a value reads the same as a C integer literal of the
+ * global's type. A literal is an int, long or long long, so u32 values
+ * past INT32_MAX and u64 values past INT64_MAX would change the type of
+ * the arithmetic around them. */
+static int literal_keeps_type(long value, CasmType type) {
+    if (type == TYPE_U32) return value <= INT32_MAX;
+    if (type == TYPE_U64) return value >= 0;
+    return 1;
+}
+
+int fold_read_only_globals(ASTProgram* program) {
+    if (!program || program->global_count == 0) return 0;
+
+    GlobalFolder f;
+    f.program = program;
+    f.written = xmalloc(program->global_count * sizeof(int));
+    f.foldable = xmalloc(program->global_count * sizeof(int));
+    f.replacing = 0;
+    for (int i = 0; i < program->global_count; i++) {
+        f.written[i] = 0;
+    }
+    for (int i = 0; i < program->function_count; i++) {
+        visit_block(&f, &program->functions[i].body);
+    }
+
+    int folded = 0;
+    for (int i = 0; i < program->global_count; i++) {
+        ASTGlobalVar* global = &program->globals[i];
+        long value = global->decl.element_count > 0 ? global->decl.elements[0] : 0;
+        f.foldable[i] = global->decl.array_length == 0 && !global->folded && !f.written[i] &&
+                        literal_keeps_type(value, global->decl.type.type);
+        if (f.foldable[i]) {
+            global->folded = 1;
+            folded++;
+        }
+    }
+    if (folded > 0) {
+        f.replacing = 1;
+        for (int i = 0; i < program->function_count; i++) {
+            visit_block(&f, &program->functions[i].body);
+        }
+    }
+
+    xfree(f.written);
+    xfree(f.foldable);
+    return folded;
+}
@@ -0,0 +1,12 @@
+#ifndef GLOBAL_FOLD_H
+#define GLOBAL_FOLD_H
+
+#include "ast.h"
+
+/* Replace every read of a scalar global that no function assigns with
+ * its constant initializer, and mark the global folded so the backends
+ * leave it out. Globals are module-private, so the whole program shows
+ * every assignment. Returns the number of globals folded. */
+int fold_read_only_globals(ASTProgram* program);
+
+#endif /* GLOBAL_FOLD_H */
@@ -0,0 +1,1355 @@
+#include <stdio.h>
+#include <string.h>
+#include "inliner.h"
+#include "call_graph.h"
+#include "optimizer.h"
+#include "types.h"
+#include "utils.h"
+
+/* Function inlining (-O2).
+ *
+ * Functions are rewritten callees-first (post-order over the call graph),
+ * so a caller inlines bodies whose own calls have already been inlined.
+ * Two shapes are handled:
+ *
+ *  - A callee whose body is a single `return <expr>;` is substituted into
+ *    the calling expression, with each parameter replaced by its argument
+ *    (only when arguments are trivial or side-effect free, so nothing is
+ *    reordered or duplicated).
+ *  - A call that is a whole statement (`f(...);`, `x = f(...);`,
+ *    `T x = f(...);`, `return f(...);`) is replaced by a block that binds
+ *    the arguments to renamed copies of the parameters and runs a copy of
+ *    the callee body with its locals renamed. Returns become assignments
+ *    to the target, so they must be in tail position (except when the
+ *    call was itself returned).
+ *
+ * Calls inside an inlined body are resolved from the callee's module; a
+ * body is only moved to another module if every such call resolves to the
+ * same function from the caller's module. */
+
+#define INLINE_CALLEE_SIZE_LIMIT 40     /* AST nodes in a callee body */
+#define INLINE_CALLER_SIZE_LIMIT 4000   /* Stop growing a caller past this */
+
+typedef enum {
+    INLINE_RETURN,      /* return f(...);  - returns stay returns */
+    INLINE_ASSIGN,      /* x = f(...);     - returns assign the target */
+    INLINE_DISCARD      /* f(...);         - returned values are dropped */
+} InlineMode;
+
+typedef struct {
+    ASTProgram* program;
+    int* recursive;         /* Per function: can call itself (directly or not) */
+    int* sizes;             /* Per function: body size in AST nodes */
+    int* counts;            /* Per function: call sites inlined */
+    int current;            /* Function being rewritten */
+    int current_size;
+    char** taken;           /* Names that must not be used for renamed locals */
+    int taken_count;
+    int taken_capacity;
+    int next_suffix;
+    int inlined;
+} Inliner;
+
+/* Forward declarations */
+static void inline_block(Inliner* in, ASTBlock* block);
+
+/* ===== Size and name helpers ===== */
+
+static int expression_size(const ASTExpression* expr) {
+    if (!expr) return 0;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            return 1 + expression_size(expr->as.binary_op.left) + expression_size(expr->as.binary_op.right);
+        case EXPR_UNARY_OP:
+            return 1 + expression_size(expr->as.unary_op.operand);
+        case EXPR_INDEX:
+            return 1 + expression_size(expr->as.index.index);
+        case EXPR_FUNCTION_CALL: {
+            int size = 1;
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                size += expression_size(&expr->as.function_call.arguments[i]);
+            }
+            return size;
+        }
+        default:
+            return 1;
+    }
+}
+
+static int block_size(const ASTBlock* block);
+
+static int statement_size(const ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            return 1 + expression_size(stmt->as.return_stmt.value);
+        case STMT_EXPR:
+            return 1 + expression_size(stmt->as.expr_stmt.expr);
+        case STMT_VAR_DECL:
+            return 1 + expression_size(stmt->as.var_decl_stmt.var_decl.initializer);
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            int size = 1 + expression_size(if_stmt->condition) + block_size(&if_stmt->then_body);
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                size += expression_size(clause->condition) + block_size(&clause->body);
+            }
+            if (if_stmt->else_body) size += block_size(if_stmt->else_body);
+            return size;
+        }
+        case STMT_WHILE:
+            return 1 + expression_size(stmt->as.while_stmt.condition) + block_size(&stmt->as.while_stmt.body);
+        case STMT_FOR: {
+            const ASTForStmt* for_stmt = &stmt->as.for_stmt;
+            return 1 + (for_stmt->init ? statement_size(for_stmt->init) : 0) +
+                   expression_size(for_stmt->condition) + expression_size(for_stmt->update) +
+                   block_size(&for_stmt->body);
+        }
+        case STMT_BLOCK:
+            return block_size(&stmt->as.block_stmt.block);
+        case STMT_DBG: {
+            int size = 1;
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                size += expression_size(&stmt->as.dbg_stmt.arguments[i]);
+            }
+            return size;
+        }
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            return 1;
+    }
+    return 1;
+}
+
+static int block_size(const ASTBlock* block) {
+    int size = 0;
+    for (int i = 0; i < block->statement_count; i++) {
+        size += statement_size(&block->statements[i]);
+    }
+    return size;
+}
+
+static int is_taken(const Inliner* in, const char* name) {
+    for (int i = 0; i < in->taken_count; i++) {
+        if (strcmp(in->taken[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+static void add_taken(Inliner* in, const char* name) {
+    if (is_taken(in, name)) return;
+    if (in->taken_count >= in->taken_capacity) {
+        in->taken_capacity = (in->taken_capacity == 0) ? 32 : in->taken_capacity * 2;
+        in->taken = xrealloc(in->taken, in->taken_capacity * sizeof(char*));
+    }
+    in->taken[in->taken_count++] = xstrdup(name);
+}
+
+static void clear_taken(Inliner* in) {
+    for (int i = 0; i < in->taken_count; i++) {
+        xfree(in->taken[i]);
+    }
+    in->taken_count = 0;
+}
+
+static void collect_names_block(Inliner* in, const ASTBlock* block);
+
+static void collect_names_expression(Inliner* in, const ASTExpression* expr) {
+    if (!expr) return;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            collect_names_expression(in, expr->as.binary_op.left);
+            collect_names_expression(in, expr->as.binary_op.right);
+            break;
+        case EXPR_UNARY_OP:
+            collect_names_expression(in, expr->as.unary_op.operand);
+            break;
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                collect_names_expression(in, &expr->as.function_call.arguments[i]);
+            }
+            break;
+        case EXPR_INDEX:
+            add_taken(in, expr->as.index.array_name);
+            collect_names_expression(in, expr->as.index.index);
+            break;
+        case EXPR_VARIABLE:
+            add_taken(in, expr->as.variable.name);
+            break;
+        case EXPR_FIELD:
+            add_taken(in, expr->as.field.object_name);
+            break;
+        case EXPR_LITERAL:
+            break;
+    }
+}
+
+static void collect_names_statement(Inliner* in, const ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            collect_names_expression(in, stmt->as.return_stmt.value);
+            break;
+        case STMT_EXPR:
+            collect_names_expression(in, stmt->as.expr_stmt.expr);
+            break;
+        case STMT_VAR_DECL:
+            add_taken(in, stmt->as.var_decl_stmt.var_decl.name);
+            collect_names_expression(in, stmt->as.var_decl_stmt.var_decl.initializer);
+            break;
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            collect_names_expression(in, if_stmt->condition);
+            collect_names_block(in, &if_stmt->then_body);
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                collect_names_expression(in, clause->condition);
+                collect_names_block(in, &clause->body);
+            }
+            if (if_stmt->else_body) collect_names_block(in, if_stmt->else_body);
+            break;
+        }
+        case STMT_WHILE:
+            collect_names_expression(in, stmt->as.while_stmt.condition);
+            collect_names_block(in, &stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            if (stmt->as.for_stmt.init) collect_names_statement(in, stmt->as.for_stmt.init);
+            collect_names_expression(in, stmt->as.for_stmt.condition);
+            collect_names_expression(in, stmt->as.for_stmt.update);
+            collect_names_block(in, &stmt->as.for_stmt.body);
+            break;
+        case STMT_BLOCK:
+            collect_names_block(in, &stmt->as.block_stmt.block);
+            break;
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                collect_names_expression(in, &stmt->as.dbg_stmt.arguments[i]);
+            }
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+}
+
+static void collect_names_block(Inliner* in, const ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        collect_names_statement(in, &block->statements[i]);
+    }
+}
+
+/* ===== Call resolution ===== */
+
+static int same_module(const char* a, const char* b) {
+    if (!a || !b) return a == b;
+    return strcmp(a, b) == 0;
+}
+
+/* Helper: Find the function a call made from `module_path` refers to:
+ * the same module's definition, else the only definition with that name.
+ * Returns -1 if the call is ambiguous or unknown. */
+static int resolve_call(const Inliner* in, const char* name, const char* module_path) {
+    int match = -1;
+    int match_count = 0;
+    for (int i = 0; i < in->program->function_count; i++) {
+        ASTFunctionDef* func = &in->program->functions[i];
+        if (strcmp(func->name, name) != 0) continue;
+        if (same_module(func->module_path, module_path)) return i;
+        match = i;
+        match_count++;
+    }
+    return match_count == 1 ? match : -1;
+}
+
+static int calls_resolve_same_block(const Inliner* in, const ASTBlock* block, const char* from, const char* to);
+
+static int calls_resolve_same(const Inliner* in, const ASTExpression* expr, const char* from, const char* to) {
+    if (!expr) return 1;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            return calls_resolve_same(in, expr->as.binary_op.left, from, to) &&
+                   calls_resolve_same(in, expr->as.binary_op.right, from, to);
+        case EXPR_UNARY_OP:
+            return calls_resolve_same(in, expr->as.unary_op.operand, from, to);
+        case EXPR_INDEX:
+            return calls_resolve_same(in, expr->as.index.index, from, to);
+        case EXPR_FUNCTION_CALL: {
+            const ASTFunctionCall* call = &expr->as.function_call;
+            int target = resolve_call(in, call->function_name, from);
+            if (target < 0 || target != resolve_call(in, call->function_name, to)) return 0;
+            for (int i = 0; i < call->argument_count; i++) {
+                if (!calls_resolve_same(in, &call->arguments[i], from, to)) return 0;
+            }
+            return 1;
+        }
+        default:
+            return 1;
+    }
+}
+
+static int calls_resolve_same_statement(const Inliner* in, const ASTStatement* stmt, const char* from, const char* to) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            return calls_resolve_same(in, stmt->as.return_stmt.value, from, to);
+        case STMT_EXPR:
+            return calls_resolve_same(in, stmt->as.expr_stmt.expr, from, to);
+        case STMT_VAR_DECL:
+            return calls_resolve_same(in, stmt->as.var_decl_stmt.var_decl.initializer, from, to);
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            if (!calls_resolve_same(in, if_stmt->condition, from, to) ||
+                !calls_resolve_same_block(in, &if_stmt->then_body, from, to)) {
+                return 0;
+            }
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                if (!calls_resolve_same(in, clause->condition, from, to) ||
+                    !calls_resolve_same_block(in, &clause->body, from, to)) {
+                    return 0;
+                }
+            }
+            return !if_stmt->else_body || calls_resolve_same_block(in, if_stmt->else_body, from, to);
+        }
+        case STMT_WHILE:
+            return calls_resolve_same(in, stmt->as.while_stmt.condition, from, to) &&
+                   calls_resolve_same_block(in, &stmt->as.while_stmt.body, from, to);
+        case STMT_FOR:
+            return (!stmt->as.for_stmt.init || calls_resolve_same_statement(in, stmt->as.for_stmt.init, from, to)) &&
+                   calls_resolve_same(in, stmt->as.for_stmt.condition, from, to) &&
+                   calls_resolve_same(in, stmt->as.for_stmt.update, from, to) &&
+                   calls_resolve_same_block(in, &stmt->as.for_stmt.body, from, to);
+        case STMT_BLOCK:
+            return calls_resolve_same_block(in, &stmt->as.block_stmt.block, from, to);
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                if (!calls_resolve_same(in, &stmt->as.dbg_stmt.arguments[i], from, to)) return 0;
+            }
+            return 1;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            return 1;
+    }
+    return 0;
+}
+
+static int calls_resolve_same_block(const Inliner* in, const ASTBlock* block, const char* from, const char* to) {
+    for (int i = 0; i < block->statement_count; i++) {
+        if (!calls_resolve_same_statement(in, &block->statements[i], from, to)) return 0;
+    }
+    return 1;
+}
+
+/* Helper: Common checks for inlining function `callee` into the current function */
+static int can_inline_callee(const Inliner* in, int callee) {
+    if (callee < 0 || callee == in->current || in->recursive[callee]) return 0;
+    if (in->sizes[callee] > INLINE_CALLEE_SIZE_LIMIT) return 0;
+    if (in->current_size + in->sizes[callee] > INLINE_CALLER_SIZE_LIMIT) return 0;
+
+    const ASTFunctionDef* caller = &in->program->functions[in->current];
+    const ASTFunctionDef* target = &in->program->functions[callee];
+    /* Struct parameters are references, not values a local could hold */
+    for (int i = 0; i < target->parameter_count; i++) {
+        if (target->parameters[i].type.type == TYPE_STRUCT) return 0;
+    }
+    if (same_module(caller->module_path, target->module_path)) return 1;
+    return calls_resolve_same_block(in, &target->body, target->module_path, caller->module_path);
+}
+
+static int param_index(const ASTFunctionDef* func, const char* name) {
+    for (int i = 0; i < func->parameter_count; i++) {
+        if (strcmp(func->parameters[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+/* Helper: Check if a block declares a local named `name` at any depth */
+static int block_declares(const ASTBlock* block, const char* name) {
+    for (int i = 0; i < block->statement_count; i++) {
+        const ASTStatement* stmt = &block->statements[i];
+        switch (stmt->type) {
+            case STMT_VAR_DECL:
+                if (strcmp(stmt->as.var_decl_stmt.var_decl.name, name) == 0) return 1;
+                break;
+            case STMT_IF: {
+                const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+                if (block_declares(&if_stmt->then_body, name)) return 1;
+                for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                    if (block_declares(&clause->body, name)) return 1;
+                }
+                if (if_stmt->else_body && block_declares(if_stmt->else_body, name)) return 1;
+                break;
+            }
+            case STMT_WHILE:
+                if (block_declares(&stmt->as.while_stmt.body, name)) return 1;
+                break;
+            case STMT_FOR:
+                if (stmt->as.for_stmt.init && stmt->as.for_stmt.init->type == STMT_VAR_DECL &&
+                    strcmp(stmt->as.for_stmt.init->as.var_decl_stmt.var_decl.name, name) == 0) {
+                    return 1;
+                }
+                if (block_declares(&stmt->as.for_stmt.body, name)) return 1;
+                break;
+            case STMT_BLOCK:
+                if (block_declares(&stmt->as.block_stmt.block, name)) return 1;
+                break;
+            default:
+                break;
+        }
+    }
+    return 0;
+}
+
+/* Helper: Check if an expression accesses a module-level array that a
+ * local of the current function hides. The C backend refers to globals by
+ * name, so such an access can't be moved into the caller. */
+static int uses_hidden_global(const Inliner* in, const ASTExpression* expr) {
+    if (!expr) return 0;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            return uses_hidden_global(in, expr->as.binary_op.left) ||
+                   uses_hidden_global(in, expr->as.binary_op.right);
+        case EXPR_UNARY_OP:
+            return uses_hidden_global(in, expr->as.unary_op.operand);
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                if (uses_hidden_global(in, &expr->as.function_call.arguments[i])) return 1;
+            }
+            return 0;
+        case EXPR_INDEX: {
+            const ASTIndexExpr* index = &expr->as.index;
+            if (index->global_index >= 0) {
+                const ASTGlobalVar* global = &in->program->globals[index->global_index];
+                const char* name = global->allocated_name ? global->allocated_name : global->decl.name;
+                const ASTFunctionDef* caller = &in->program->functions[in->current];
+                if (param_index(caller, name) >= 0 || block_declares(&caller->body, name)) return 1;
+            }
+            return uses_hidden_global(in, index->index);
+        }
+        default:
+            return 0;
+    }
+}
+
+static int block_uses_hidden_global(const Inliner* in, const ASTBlock* block);
+
+static int statement_uses_hidden_global(const Inliner* in, const ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            return uses_hidden_global(in, stmt->as.return_stmt.value);
+        case STMT_EXPR:
+            return uses_hidden_global(in, stmt->as.expr_stmt.expr);
+        case STMT_VAR_DECL:
+            return uses_hidden_global(in, stmt->as.var_decl_stmt.var_decl.initializer);
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            if (uses_hidden_global(in, if_stmt->condition) ||
+                block_uses_hidden_global(in, &if_stmt->then_body)) {
+                return 1;
+            }
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                if (uses_hidden_global(in, clause->condition) ||
+                    block_uses_hidden_global(in, &clause->body)) {
+                    return 1;
+                }
+            }
+            return if_stmt->else_body && block_uses_hidden_global(in, if_stmt->else_body);
+        }
+        case STMT_WHILE:
+            return uses_hidden_global(in, stmt->as.while_stmt.condition) ||
+                   block_uses_hidden_global(in, &stmt->as.while_stmt.body);
+        case STMT_FOR:
+            return (stmt->as.for_stmt.init && statement_uses_hidden_global(in, stmt->as.for_stmt.init)) ||
+                   uses_hidden_global(in, stmt->as.for_stmt.condition) ||
+                   uses_hidden_global(in, stmt->as.for_stmt.update) ||
+                   block_uses_hidden_global(in, &stmt->as.for_stmt.body);
+        case STMT_BLOCK:
+            return block_uses_hidden_global(in, &stmt->as.block_stmt.block);
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                if (uses_hidden_global(in, &stmt->as.dbg_stmt.arguments[i])) return 1;
+            }
+            return 0;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            return 0;
+    }
+    return 0;
+}
+
+static int block_uses_hidden_global(const Inliner* in, const ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        if (statement_uses_hidden_global(in, &block->statements[i])) return 1;
+    }
+    return 0;
+}
+
+/* Helper: Check if an expression reads a module-level array */
+static int reads_global(const ASTExpression* expr) {
+    if (!expr) return 0;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            return reads_global(expr->as.binary_op.left) || reads_global(expr->as.binary_op.right);
+        case EXPR_UNARY_OP:
+            return reads_global(expr->as.unary_op.operand);
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                if (reads_global(&expr->as.function_call.arguments[i])) return 1;
+            }
+            return 0;
+        case EXPR_INDEX:
+            return expr->as.index.global_index >= 0 || reads_global(expr->as.index.index);
+        default:
+            return 0;
+    }
+}
+
+static int contains_call(const ASTExpression* expr) {
+    if (!expr) return 0;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            return contains_call(expr->as.binary_op.left) || contains_call(expr->as.binary_op.right);
+        case EXPR_UNARY_OP:
+            return contains_call(expr->as.unary_op.operand);
+        case EXPR_INDEX:
+            return contains_call(expr->as.index.index);
+        case EXPR_FUNCTION_CALL:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void record_inline(Inliner* in, int callee) {
+    in->counts[callee]++;
+    in->inlined++;
+    in->current_size += in->sizes[callee];
+}
+
+/* Helper: Narrow results are wrapped by the return; substitution would lose that */
+static int is_narrow_type(CasmType type) {
+    return type == TYPE_I8 || type == TYPE_I16 || type == TYPE_U8 || type == TYPE_U16;
+}
+
+static int contains_assignment(const ASTExpression* expr) {
+    if (!expr) return 0;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            return expr->as.binary_op.op == BINOP_ASSIGN ||
+                   contains_assignment(expr->as.binary_op.left) ||
+                   contains_assignment(expr->as.binary_op.right);
+        case EXPR_UNARY_OP:
+            return contains_assignment(expr->as.unary_op.operand);
+        case EXPR_INDEX:
+            return contains_assignment(expr->as.index.index);
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                if (contains_assignment(&expr->as.function_call.arguments[i])) return 1;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+static int count_uses(const ASTExpression* expr, const char* name) {
+    if (!expr) return 0;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            return count_uses(expr->as.binary_op.left, name) + count_uses(expr->as.binary_op.right, name);
+        case EXPR_UNARY_OP:
+            return count_uses(expr->as.unary_op.operand, name);
+        case EXPR_INDEX:
+            return count_uses(expr->as.index.index, name);
+        case EXPR_FUNCTION_CALL: {
+            int uses = 0;
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                uses += count_uses(&expr->as.function_call.arguments[i], name);
+            }
+            return uses;
+        }
+        case EXPR_VARIABLE:
+            return strcmp(expr->as.variable.name, name) == 0;
+        default:
+            return 0;
+    }
+}
+
+/* ===== Expression inlining ===== */
+
+/* Helper: Replace parameter references in a cloned expression with copies
+ * of the call's arguments (replacements are not revisited) */
+static void substitute_parameters(ASTExpression* expr, const ASTFunctionDef* callee, const ASTExpression* args) {
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            substitute_parameters(expr->as.binary_op.left, callee, args);
+            substitute_parameters(expr->as.binary_op.right, callee, args);
+            break;
+        case EXPR_UNARY_OP:
+            substitute_parameters(expr->as.unary_op.operand, callee, args);
+            break;
+        case EXPR_INDEX:
+            substitute_parameters(expr->as.index.index, callee, args);
+            break;
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                substitute_parameters(&expr->as.function_call.arguments[i], callee, args);
+            }
+            break;
+        case EXPR_VARIABLE: {
+            int index = param_index(callee, expr->as.variable.name);
+            if (index >= 0) {
+                ast_expression_free_contents(expr);
+                ast_expression_clone_into(expr, &args[index]);
+            }
+            break;
+        }
+        case EXPR_FIELD:
+        case EXPR_LITERAL:
+            break;
+    }
+}
+
+/* Helper: Inline a call to a single-expression function in place */
+static int try_inline_expression(Inliner* in, ASTExpression* expr) {
+    ASTFunctionCall* call = &expr->as.function_call;
+    const ASTFunctionDef* caller = &in->program->functions[in->current];
+    int index = resolve_call(in, call->function_name, caller->module_path);
+    if (!can_inline_callee(in, index)) return 0;
+
+    const ASTFunctionDef* callee = &in->program->functions[index];
+    if (callee->body.statement_count != 1 ||
+        callee->body.statements[0].type != STMT_RETURN ||
+        !callee->body.statements[0].as.return_stmt.value) {
+        return 0;
+    }
+    const ASTExpression* value = callee->body.statements[0].as.return_stmt.value;
+    if (is_narrow_type(callee->return_type.type) ||
+        value->resolved_type != callee->return_type.type ||
+        contains_assignment(value) ||
+        call->argument_count != callee->parameter_count) {
+        return 0;
+    }
+
+    if (uses_hidden_global(in, value)) return 0;
+
+    for (int i = 0; i < call->argument_count; i++) {
+        const ASTExpression* arg = &call->arguments[i];
+        if (arg->resolved_type != callee->parameters[i].type.type) return 0;
+        if (arg->type == EXPR_LITERAL || arg->type == EXPR_VARIABLE) continue;
+        /* Anything else is moved to its (single) use, so it must not
+         * have effects that could be reordered or dropped */
+        if (optimize_has_side_effects(arg) || count_uses(value, callee->parameters[i].name) > 1) {
+            return 0;
+        }
+        /* ...nor read an array a call in the body could write first */
+        if (reads_global(arg) && contains_call(value)) return 0;
+    }
+
+    ASTExpression* replacement = ast_expression_clone(value);
+    substitute_parameters(replacement, callee, call->arguments);
+    replacement->location = expr->location;
+    ast_expression_free_contents(expr);
+    *expr = *replacement;
+    xfree(replacement);
+
+    record_inline(in, index);
+    return 1;
+}
+
+static void inline_expression(Inliner* in, ASTExpression* expr) {
+    if (!expr) return;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            inline_expression(in, expr->as.binary_op.left);
+            inline_expression(in, expr->as.binary_op.right);
+            break;
+        case EXPR_UNARY_OP:
+            inline_expression(in, expr->as.unary_op.operand);
+            break;
+        case EXPR_INDEX:
+            inline_expression(in, expr->as.index.index);
+            break;
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                inline_expression(in, &expr->as.function_call.arguments[i]);
+            }
+            try_inline_expression(in, expr);
+            break;
+        default:
+            break;
+    }
+}
+
+/* ===== Statement inlining ===== */
+
+static int block_contains_return(const ASTBlock* block);
+
+static int statement_contains_return(const ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            return 1;
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            if (block_contains_return(&if_stmt->then_body)) return 1;
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                if (block_contains_return(&clause->body)) return 1;
+            }
+            return if_stmt->else_body && block_contains_return(if_stmt->else_body);
+        }
+        case STMT_WHILE:
+            return block_contains_return(&stmt->as.while_stmt.body);
+        case STMT_FOR:
+            return block_contains_return(&stmt->as.for_stmt.body);
+        case STMT_BLOCK:
+            return block_contains_return(&stmt->as.block_stmt.block);
+        default:
+            return 0;
+    }
+}
+
+static int block_contains_return(const ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        if (statement_contains_return(&block->statements[i])) return 1;
+    }
+    return 0;
+}
+
+/* Helper: Free the statements after the first `keep` */
+static void truncate_block(ASTBlock* block, int keep) {
+    for (int i = keep; i < block->statement_count; i++) {
+        ast_statement_free_contents(&block->statements[i]);
+    }
+    block->statement_count = keep;
+}
+
+/* Helper: Restructure a block so every return is the last statement on its
+ * path (`if (c) { ...; return a; } rest` becomes an if/else). Returns 0 if
+ * some return can't be moved there (e.g. inside a loop). */
+static int normalize_tail_returns(ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        ASTStatement* stmt = &block->statements[i];
+
+        if (stmt->type == STMT_RETURN) {
+            truncate_block(block, i + 1);  /* Anything after is dead */
+            return 1;
+        }
+
+        int last = (i == block->statement_count - 1);
+        if (!last && stmt->type == STMT_IF &&
+            !stmt->as.if_stmt.else_if_chain && !stmt->as.if_stmt.else_body) {
+            ASTBlock* then_body = &stmt->as.if_stmt.then_body;
+            if (then_body->statement_count > 0 &&
+                then_body->statements[then_body->statement_count - 1].type == STMT_RETURN) {
+                int rest = block->statement_count - i - 1;
+                ASTBlock* else_body = xmalloc(sizeof(ASTBlock));
+                else_body->statements = xmalloc(rest * sizeof(ASTStatement));
+                else_body->statement_count = rest;
+                else_body->location = block->statements[i + 1].location;
+                memcpy(else_body->statements, &block->statements[i + 1], rest * sizeof(ASTStatement));
+                stmt->as.if_stmt.else_body = else_body;
+                block->statement_count = i + 1;
+                last = 1;
+            }
+        }
+
+        if (!last) {
+            if (statement_contains_return(stmt)) return 0;
+            continue;
+        }
+
+        switch (stmt->type) {
+            case STMT_IF: {
+                ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+                if (!normalize_tail_returns(&if_stmt->then_body)) return 0;
+                for (ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                    if (!normalize_tail_returns(&clause->body)) return 0;
+                }
+                return !if_stmt->else_body || normalize_tail_returns(if_stmt->else_body);
+            }
+            case STMT_BLOCK:
+                return normalize_tail_returns(&stmt->as.block_stmt.block);
+            default:
+                return !statement_contains_return(stmt);
+        }
+    }
+    return 1;
+}
+
+/* Renaming of a callee's parameters and locals */
+typedef struct {
+    char** from;
+    char** to;
+    int count;
+} RenameMap;
+
+static const char* rename_lookup(const RenameMap* map, const char* name) {
+    for (int i = 0; i < map->count; i++) {
+        if (strcmp(map->from[i], name) == 0) return map->to[i];
+    }
+    return NULL;
+}
+
+static void rename_add(RenameMap* map, const char* name) {
+    if (rename_lookup(map, name)) return;
+    map->from = xrealloc(map->from, (map->count + 1) * sizeof(char*));
+    map->to = xrealloc(map->to, (map->count + 1) * sizeof(char*));
+    map->from[map->count] = xstrdup(name);
+    map->to[map->count] = NULL;
+    map->count++;
+}
+
+static void rename_free(RenameMap* map) {
+    for (int i = 0; i < map->count; i++) {
+        xfree(map->from[i]);
+        xfree(map->to[i]);
+    }
+    xfree(map->from);
+    xfree(map->to);
+}
+
+static void collect_declared_names(RenameMap* map, const ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        const ASTStatement* stmt = &block->statements[i];
+        switch (stmt->type) {
+            case STMT_VAR_DECL:
+                rename_add(map, stmt->as.var_decl_stmt.var_decl.name);
+                break;
+            case STMT_IF: {
+                const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+                collect_declared_names(map, &if_stmt->then_body);
+                for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                    collect_declared_names(map, &clause->body);
+                }
+                if (if_stmt->else_body) collect_declared_names(map, if_stmt->else_body);
+                break;
+            }
+            case STMT_WHILE:
+                collect_declared_names(map, &stmt->as.while_stmt.body);
+                break;
+            case STMT_FOR:
+                if (stmt->as.for_stmt.init && stmt->as.for_stmt.init->type == STMT_VAR_DECL) {
+                    rename_add(map, stmt->as.for_stmt.init->as.var_decl_stmt.var_decl.name);
+                }
+                collect_declared_names(map, &stmt->as.for_stmt.body);
+                break;
+            case STMT_BLOCK:
+                collect_declared_names(map, &stmt->as.block_stmt.block);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/* Helper: Pick a suffix that makes every renamed name unused in the caller */
+static void assign_fresh_names(Inliner* in, RenameMap* map) {
+    char buffer[256];
+    for (;;) {
+        int suffix = ++in->next_suffix;
+        int clash = 0;
+        for (int i = 0; i < map->count && !clash; i++) {
+            snprintf(buffer, sizeof(buffer), "%s_inl%d", map->from[i], suffix);
+            clash = is_taken(in, buffer);
+        }
+        if (clash) continue;
+
+        for (int i = 0; i < map->count; i++) {
+            snprintf(buffer, sizeof(buffer), "%s_inl%d", map->from[i], suffix);
+            map->to[i] = xstrdup(buffer);
+            add_taken(in, buffer);
+        }
+        return;
+    }
+}
+
+static void rename_block(const RenameMap* map, ASTBlock* block);
+
+static void rename_expression(const RenameMap* map, ASTExpression* expr) {
+    if (!expr) return;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            rename_expression(map, expr->as.binary_op.left);
+            rename_expression(map, expr->as.binary_op.right);
+            break;
+        case EXPR_UNARY_OP:
+            rename_expression(map, expr->as.unary_op.operand);
+            break;
+        case EXPR_INDEX: {
+            const char* renamed = expr->as.index.global_index < 0 ?
+                rename_lookup(map, expr->as.index.array_name) : NULL;
+            if (renamed) {
+                xfree(expr->as.index.array_name);
+                expr->as.index.array_name = xstrdup(renamed);
+            }
+            rename_expression(map, expr->as.index.index);
+            break;
+        }
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                rename_expression(map, &expr->as.function_call.arguments[i]);
+            }
+            break;
+        case EXPR_VARIABLE: {
+            const char* renamed = rename_lookup(map, expr->as.variable.name);
+            if (renamed) {
+                xfree(expr->as.variable.name);
+                expr->as.variable.name = xstrdup(renamed);
+            }
+            break;
+        }
+        case EXPR_FIELD: {
+            const char* renamed = rename_lookup(map, expr->as.field.object_name);
+            if (renamed) {
+                xfree(expr->as.field.object_name);
+                expr->as.field.object_name = xstrdup(renamed);
+            }
+            break;
+        }
+        case EXPR_LITERAL:
+            break;
+    }
+}
+
+static void rename_statement(const RenameMap* map, ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            rename_expression(map, stmt->as.return_stmt.value);
+            break;
+        case STMT_EXPR:
+            rename_expression(map, stmt->as.expr_stmt.expr);
+            break;
+        case STMT_VAR_DECL: {
+            ASTVarDecl* decl = &stmt->as.var_decl_stmt.var_decl;
+            const char* renamed = rename_lookup(map, decl->name);
+            if (renamed) {
+                xfree(decl->name);
+                decl->name = xstrdup(renamed);
+            }
+            rename_expression(map, decl->initializer);
+            break;
+        }
+        case STMT_IF: {
+            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            rename_expression(map, if_stmt->condition);
+            rename_block(map, &if_stmt->then_body);
+            for (ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                rename_expression(map, clause->condition);
+                rename_block(map, &clause->body);
+            }
+            if (if_stmt->else_body) rename_block(map, if_stmt->else_body);
+            break;
+        }
+        case STMT_WHILE:
+            rename_expression(map, stmt->as.while_stmt.condition);
+            rename_block(map, &stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            if (stmt->as.for_stmt.init) rename_statement(map, stmt->as.for_stmt.init);
+            rename_expression(map, stmt->as.for_stmt.condition);
+            rename_expression(map, stmt->as.for_stmt.update);
+            rename_block(map, &stmt->as.for_stmt.body);
+            break;
+        case STMT_BLOCK:
+            rename_block(map, &stmt->as.block_stmt.block);
+            break;
+        case STMT_DBG:
+            /* arg_names keep the source text, so output is unchanged */
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                rename_expression(map, &stmt->as.dbg_stmt.arguments[i]);
+            }
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+}
+
+static void rename_block(const RenameMap* map, ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        rename_statement(map, &block->statements[i]);
+    }
+}
+
+/* Helper: Make a variable reference expression */
+static ASTExpression* make_variable(const char* name, CasmType type, SourceLocation location) {
+    ASTExpression* expr = ast_expression_create(EXPR_VARIABLE, location);
+    expr->as.variable.name = xstrdup(name);
+    expr->as.variable.location = location;
+    expr->resolved_type = type;
+    return expr;
+}
+
+/* Helper: Rewrite the (tail) returns of an inlined body for `mode` */
+static void rewrite_returns(ASTBlock* block, InlineMode mode, const char* target, CasmType target_type) {
+    int kept = 0;
+    for (int i = 0; i < block->statement_count; i++) {
+        ASTStatement* stmt = &block->statements[i];
+        switch (stmt->type) {
+            case STMT_RETURN: {
+                ASTExpression* value = stmt->as.return_stmt.value;
+                if (mode == INLINE_ASSIGN) {
+                    ASTExpression* assign = ast_expression_create(EXPR_BINARY_OP, stmt->location);
+                    assign->as.binary_op.op = BINOP_ASSIGN;
+                    assign->as.binary_op.left = make_variable(target, target_type, stmt->location);
+                    assign->as.binary_op.right = value;
+                    assign->as.binary_op.location = stmt->location;
+                    assign->resolved_type = target_type;
+                    stmt->type = STMT_EXPR;
+                    stmt->as.expr_stmt.expr = assign;
+                    stmt->as.expr_stmt.location = stmt->location;
+                } else if (value && optimize_has_side_effects(value)) {
+                    stmt->type = STMT_EXPR;
+                    stmt->as.expr_stmt.expr = value;
+                    stmt->as.expr_stmt.location = stmt->location;
+                } else {
+                    ast_expression_free(value);
+                    continue;   /* Drop the statement */
+                }
+                break;
+            }
+            case STMT_IF: {
+                ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+                rewrite_returns(&if_stmt->then_body, mode, target, target_type);
+                for (ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                    rewrite_returns(&clause->body, mode, target, target_type);
+                }
+                if (if_stmt->else_body) rewrite_returns(if_stmt->else_body, mode, target, target_type);
+                break;
+            }
+            case STMT_BLOCK:
+                rewrite_returns(&stmt->as.block_stmt.block, mode, target, target_type);
+                break;
+            default:
+                /* Returns are only in tail position after normalization */
+                break;
+        }
+        block->statements[kept++] = *stmt;
+    }
+    block->statement_count = kept;
+}
+
+/* Helper: Find the call a statement consists of, and how its result is used */
+static ASTExpression* statement_call(ASTStatement* stmt, InlineMode* mode, const char** target, CasmType* target_type) {
+    ASTExpression* expr = NULL;
+    switch (stmt->type) {
+        case STMT_EXPR:
+            expr = stmt->as.expr_stmt.expr;
+            if (expr && expr->type == EXPR_BINARY_OP && expr->as.binary_op.op == BINOP_ASSIGN &&
+                expr->as.binary_op.left->type == EXPR_VARIABLE) {
+                *mode = INLINE_ASSIGN;
+                *target = expr->as.binary_op.left->as.variable.name;
+                *target_type = expr->as.binary_op.left->resolved_type;
+                expr = expr->as.binary_op.right;
+            } else {
+                *mode = INLINE_DISCARD;
+            }
+            break;
+        case STMT_VAR_DECL:
+            *mode = INLINE_ASSIGN;
+            *target = stmt->as.var_decl_stmt.var_decl.name;
+            *target_type = stmt->as.var_decl_stmt.var_decl.type.type;
+            expr = stmt->as.var_decl_stmt.var_decl.initializer;
+            break;
+        case STMT_RETURN:
+            *mode = INLINE_RETURN;
+            expr = stmt->as.return_stmt.value;
+            break;
+        default:
+            break;
+    }
+    return (expr && expr->type == EXPR_FUNCTION_CALL) ? expr : NULL;
+}
+
+/* Helper: Inline a call that forms a whole statement. Writes the
+ * replacement statements to `out` (at most 2) and returns their count,
+ * or 0 if the call can't be inlined. */
+static int try_inline_statement(Inliner* in, ASTStatement* stmt, ASTStatement* out) {
+    InlineMode mode = INLINE_DISCARD;
+    const char* target = NULL;
+    CasmType target_type = TYPE_VOID;
+    ASTExpression* call_expr = statement_call(stmt, &mode, &target, &target_type);
+    if (!call_expr) return 0;
+
+    ASTFunctionCall* call = &call_expr->as.function_call;
+    ASTFunctionDef* caller = &in->program->functions[in->current];
+    int index = resolve_call(in, call->function_name, caller->module_path);
+    if (!can_inline_callee(in, index)) return 0;
+
+    const ASTFunctionDef* callee = &in->program->functions[index];
+    CasmType return_type = callee->return_type.type;
+    if (call->argument_count != callee->parameter_count) return 0;
+    if (mode == INLINE_RETURN && (return_type == TYPE_VOID || return_type != caller->return_type.type)) return 0;
+    if (mode == INLINE_ASSIGN && return_type != target_type) return 0;
+
+    for (int i = 0; i < call->argument_count; i++) {
+        const ASTExpression* arg = &call->arguments[i];
+        if (arg->resolved_type != callee->parameters[i].type.type && arg->type != EXPR_LITERAL) return 0;
+        /* `T x = f(x)` would read the new, uninitialized x */
+        if (stmt->type == STMT_VAR_DECL && count_uses(arg, target) > 0) return 0;
+    }
+
+    if (block_uses_hidden_global(in, &callee->body)) return 0;
+
+    ASTBlock body = ast_block_clone(&callee->body);
+    if (mode != INLINE_RETURN && !normalize_tail_returns(&body)) {
+        ast_block_free(&body);
+        return 0;
+    }
+
+    RenameMap map = {NULL, NULL, 0};
+    for (int i = 0; i < callee->parameter_count; i++) {
+        rename_add(&map, callee->parameters[i].name);
+    }
+    collect_declared_names(&map, &body);
+    assign_fresh_names(in, &map);
+    rename_block(&map, &body);
+    if (mode != INLINE_RETURN) {
+        rewrite_returns(&body, mode, target, target_type);
+    }
+
+    /* { P p_inlN = arg; ...; body } */
+    ASTStatement block_stmt;
+    memset(&block_stmt, 0, sizeof(ASTStatement));
+    block_stmt.type = STMT_BLOCK;
+    block_stmt.location = stmt->location;
+    block_stmt.as.block_stmt.location = stmt->location;
+    ASTBlock* block = &block_stmt.as.block_stmt.block;
+    block->location = stmt->location;
+    block->statement_count = callee->parameter_count + body.statement_count;
+    block->statements = xmalloc((block->statement_count + 1) * sizeof(ASTStatement));
+
+    for (int i = 0; i < callee->parameter_count; i++) {
+        ASTStatement* decl_stmt = &block->statements[i];
+        memset(decl_stmt, 0, sizeof(ASTStatement));
+        decl_stmt->type = STMT_VAR_DECL;
+        decl_stmt->location = call->arguments[i].location;
+        ASTVarDecl* decl = &decl_stmt->as.var_decl_stmt.var_decl;
+        decl->name = xstrdup(rename_lookup(&map, callee->parameters[i].name));
+        decl->type = callee->parameters[i].type;
+        decl->location = call->arguments[i].location;
+        /* Move the argument out of the call */
+        decl->initializer = xmalloc(sizeof(ASTExpression));
+        *decl->initializer = call->arguments[i];
+    }
+    if (body.statement_count > 0) {
+        memcpy(&block->statements[callee->parameter_count], body.statements,
+               body.statement_count * sizeof(ASTStatement));
+    }
+    xfree(body.statements);
+    rename_free(&map);
+
+    /* The arguments were moved out; free what is left of the statement */
+    call->argument_count = 0;
+    int count = 0;
+    if (stmt->type == STMT_VAR_DECL) {
+        /* Keep the declaration (now uninitialized) in the caller's scope */
+        ast_expression_free(call_expr);
+        out[count] = *stmt;
+        out[count].as.var_decl_stmt.var_decl.initializer = NULL;
+        count++;
+    } else {
+        ast_statement_free_contents(stmt);
+    }
+    out[count++] = block_stmt;
+
+    record_inline(in, index);
+    return count;
+}
+
+/* Helper: Inline calls in the expressions a statement owns directly
+ * (nested blocks are handled by inline_block) */
+static void inline_statement_parts(Inliner* in, ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            inline_expression(in, stmt->as.return_stmt.value);
+            break;
+        case STMT_EXPR:
+            inline_expression(in, stmt->as.expr_stmt.expr);
+            break;
+        case STMT_VAR_DECL:
+            inline_expression(in, stmt->as.var_decl_stmt.var_decl.initializer);
+            break;
+        case STMT_IF: {
+            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            inline_expression(in, if_stmt->condition);
+            inline_block(in, &if_stmt->then_body);
+            for (ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                inline_expression(in, clause->condition);
+                inline_block(in, &clause->body);
+            }
+            if (if_stmt->else_body) inline_block(in, if_stmt->else_body);
+            break;
+        }
+        case STMT_WHILE:
+            inline_expression(in, stmt->as.while_stmt.condition);
+            inline_block(in, &stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            if (stmt->as.for_stmt.init) inline_statement_parts(in, stmt->as.for_stmt.init);
+            inline_expression(in, stmt->as.for_stmt.condition);
+            inline_expression(in, stmt->as.for_stmt.update);
+            inline_block(in, &stmt->as.for_stmt.body);
+            break;
+        case STMT_BLOCK:
+            inline_block(in, &stmt->as.block_stmt.block);
+            break;
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                inline_expression(in, &stmt->as.dbg_stmt.arguments[i]);
+            }
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+}
+
+static void inline_block(Inliner* in, ASTBlock* block) {
+    if (block->statement_count == 0) return;
+
+    /* Each statement becomes at most two */
+    ASTStatement* result = xmalloc(2 * block->statement_count * sizeof(ASTStatement));
+    int count = 0;
+    for (int i = 0; i < block->statement_count; i++) {
+        ASTStatement* stmt = &block->statements[i];
+        inline_statement_parts(in, stmt);
+        int written = try_inline_statement(in, stmt, &result[count]);
+        if (written == 0) {
+            result[count++] = *stmt;
+        } else {
+            count += written;
+        }
+    }
+    xfree(block->statements);
+    block->statements = result;
+    block->statement_count = count;
+}
+
+/* ===== Driver ===== */
+
+static int node_index(const CallGraph* graph, uint32_t symbol_id) {
+    for (int i = 0; i < graph->node_count; i++) {
+        if (graph->nodes[i].symbol_id == symbol_id) return i;
+    }
+    return -1;
+}
+
+/* Helper: Can `from` reach `target` through calls? */
+static int reaches(const CallGraph* graph, int from, int target, int* visited) {
+    if (visited[from]) return 0;
+    visited[from] = 1;
+    for (int i = 0; i < graph->nodes[from].callee_count; i++) {
+        int callee = node_index(graph, graph->nodes[from].callees[i].callee_id);
+        if (callee < 0) continue;
+        if (callee == target || reaches(graph, callee, target, visited)) return 1;
+    }
+    return 0;
+}
+
+/* Helper: Post-order over the call graph (callees before callers) */
+static void post_order(const CallGraph* graph, int node, int* visited, int* order, int* count) {
+    visited[node] = 1;
+    for (int i = 0; i < graph->nodes[node].callee_count; i++) {
+        int callee = node_index(graph, graph->nodes[node].callees[i].callee_id);
+        if (callee >= 0 && !visited[callee]) {
+            post_order(graph, callee, visited, order, count);
+        }
+    }
+    order[(*count)++] = node;
+}
+
+void inline_stats_init(InlineStats* stats) {
+    stats->inlined_calls = 0;
+    stats->callees = NULL;
+    stats->callee_count = 0;
+}
+
+void inline_stats_free(InlineStats* stats) {
+    if (!stats) return;
+    for (int i = 0; i < stats->callee_count; i++) {
+        xfree(stats->callees[i].callee);
+        xfree(stats->callees[i].module_path);
+    }
+    xfree(stats->callees);
+    inline_stats_init(stats);
+}
+
+int inline_functions(ASTProgram* program, InlineStats* stats) {
+    int n = program ? program->function_count : 0;
+    if (n == 0) return 0;
+
+    /* The call graph identifies functions by symbol_id; programs that did
+     * not go through the module loader have none yet */
+    for (int i = 0; i < n; i++) {
+        if (program->functions[i].symbol_id == 0) {
+            for (int j = 0; j < n; j++) {
+                program->functions[j].symbol_id = (uint32_t)(j + 1);
+            }
+            break;
+        }
+    }
+
+    CallGraph* graph = call_graph_create(program);
+    Inliner in;
+    memset(&in, 0, sizeof(Inliner));
+    in.program = program;
+    in.recursive = xmalloc(n * sizeof(int));
+    in.sizes = xmalloc(n * sizeof(int));
+    in.counts = xmalloc(n * sizeof(int));
+
+    int* visited = xmalloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        memset(visited, 0, n * sizeof(int));
+        in.recursive[i] = reaches(graph, i, i, visited);
+        in.sizes[i] = block_size(&program->functions[i].body);
+        in.counts[i] = 0;
+    }
+
+    int* order = xmalloc(n * sizeof(int));
+    int order_count = 0;
+    memset(visited, 0, n * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        if (!visited[i]) post_order(graph, i, visited, order, &order_count);
+    }
+
+    for (int k = 0; k < order_count; k++) {
+        int index = order[k];
+        ASTFunctionDef* func = &program->functions[index];
+        in.current = index;
+        in.current_size = in.sizes[index];
+
+        clear_taken(&in);
+        for (int i = 0; i < n; i++) {
+            add_taken(&in, program->functions[i].name);
+        }
+        for (int i = 0; i < program->global_count; i++) {
+            add_taken(&in, program->globals[i].decl.name);
+            if (program->globals[i].allocated_name) add_taken(&in, program->globals[i].allocated_name);
+        }
+        for (int i = 0; i < func->parameter_count; i++) {
+            add_taken(&in, func->parameters[i].name);
+        }
+        collect_names_block(&in, &func->body);
+
+        inline_block(&in, &func->body);
+        in.sizes[index] = block_size(&func->body);
+    }
+
+    if (stats) {
+        stats->inlined_calls += in.inlined;
+        for (int i = 0; i < n; i++) {
+            if (in.counts[i] == 0) continue;
+            stats->callees = xrealloc(stats->callees, (stats->callee_count + 1) * sizeof(InlineCount));
+            InlineCount* entry = &stats->callees[stats->callee_count++];
+            entry->callee = xstrdup(program->functions[i].name);
+            entry->module_path = program->functions[i].module_path ? xstrdup(program->functions[i].module_path) : NULL;
+            entry->count = in.counts[i];
+        }
+    }
+
+    clear_taken(&in);
+    xfree(in.taken);
+    xfree(order);
+    xfree(visited);
+    xfree(in.counts);
+    xfree(in.sizes);
+    xfree(in.recursive);
+    call_graph_free(graph);
+    return in.inlined;
+}
@@ -0,0 +1,28 @@
+#ifndef INLINER_H
+#define INLINER_H
+
+#include "ast.h"
+
+/* Number of call sites inlined for one callee */
+typedef struct {
+    char* callee;           /* Function name as written in source */
+    char* module_path;      /* Defining module (NULL for single-file programs) */
+    int count;
+} InlineCount;
+
+typedef struct {
+    int inlined_calls;      /* Total call sites replaced */
+    InlineCount* callees;   /* Per callee, in program order */
+    int callee_count;
+} InlineStats;
+
+/* Inline small non-recursive functions into their callers (uses the call
+ * graph for recursion and processes callees before callers). Must run
+ * before name allocation. Returns the number of call sites inlined and,
+ * if `stats` is non-NULL, records per-callee counts in it. */
+int inline_functions(ASTProgram* program, InlineStats* stats);
+
+void inline_stats_init(InlineStats* stats);
+void inline_stats_free(InlineStats* stats);
+
+#endif /* INLINER_H */
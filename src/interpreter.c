@@ -0,0 +1,382 @@
+#include <stdint.h>
+#include <string.h>
+#include "interpreter.h"
+#include "types.h"
+#include "utils.h"
+
+/* Bytecode interpreter.
+ *
+ * With GCC-compatible compilers the code is direct-threaded: before
+ * running, every instruction's handler field is set to the address of
+ * its handler label, and each handler ends by jumping straight to the
+ * next instruction's handler (computed goto). Other compilers get a
+ * switch in a loop. Registers of all active frames live in one growable
+ * array; a frame's registers start at its base. Local array slots are
+ * stacked the same way in a second array. */
+
+#if defined(__GNUC__)
+#define BC_THREADED 1
+#endif
+
+/* Deepest call nesting before the program is stopped */
+#define MAX_CALL_DEPTH 1000000
+
+/* dbg output buffer size */
+#define OUT_BUF_SIZE 65536
+
+typedef struct {
+    const BcFunction* func;
+    const BcInstr* return_ip;
+    size_t base;
+    size_t mem_base;
+    int dst;
+} Frame;
+
+typedef struct {
+    FILE* file;
+    char buf[OUT_BUF_SIZE];
+    size_t len;
+} OutBuffer;
+
+/* Helper: Write out buffered dbg text */
+static void out_flush(OutBuffer* out) {
+    if (out->len > 0) {
+        fwrite(out->buf, 1, out->len, out->file);
+        out->len = 0;
+    }
+}
+
+/* Helper: Append bytes to the dbg buffer */
+static void out_write(OutBuffer* out, const char* text, size_t len) {
+    if (out->len + len > OUT_BUF_SIZE) {
+        out_flush(out);
+        if (len > OUT_BUF_SIZE) {
+            fwrite(text, 1, len, out->file);
+            return;
+        }
+    }
+    memcpy(out->buf + out->len, text, len);
+    out->len += len;
+}
+
+/* Helper: Append a 64-bit value in decimal */
+static void out_number(OutBuffer* out, uint64_t magnitude, int negative) {
+    char tmp[24];
+    int i = sizeof(tmp);
+    do {
+        tmp[--i] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (negative) tmp[--i] = '-';
+    out_write(out, tmp + i, sizeof(tmp) - i);
+}
+
+/* Helper: Print one dbg line */
+static void print_dbg_line(OutBuffer* out, const BcDbgLine* line, const long long* regs,
+                           const int* operands) {
+    for (int i = 0; i < line->value_count; i++) {
+        out_write(out, line->text[i], line->text_lengths[i]);
+        long long value = regs[operands[i]];
+        switch (line->kinds[i]) {
+            case BC_DBG_BOOL:
+                if (value) out_write(out, "true", 4);
+                else out_write(out, "false", 5);
+                break;
+            case BC_DBG_SIGNED:
+                if (value < 0) out_number(out, 0u - (uint64_t)value, 1);
+                else out_number(out, (uint64_t)value, 0);
+                break;
+            case BC_DBG_UNSIGNED:
+                out_number(out, (uint64_t)value, 0);
+                break;
+        }
+    }
+    out_write(out, line->text[line->value_count], line->text_lengths[line->value_count]);
+}
+
+/* Helper: Wrapping 64-bit arithmetic without signed overflow */
+#define WRAP64(expr) ((long long)(uint64_t)(expr))
+#define U(x) ((uint64_t)(x))
+
+InterpretResult bc_run_main(BcProgram* program, FILE* out_file) {
+    InterpretResult result = {1, NULL, 0};
+    if (program->main_index < 0) {
+        result.success = 0;
+        result.error_msg = xstrdup("no main function");
+        return result;
+    }
+
+#ifdef BC_THREADED
+    __extension__ static const void* const handlers[BC_OP_COUNT] = {
+        &&L_BC_LOADK, &&L_BC_MOV,
+        &&L_BC_ADD, &&L_BC_ADD_I32, &&L_BC_ADD_U32,
+        &&L_BC_SUB, &&L_BC_SUB_I32, &&L_BC_SUB_U32,
+        &&L_BC_MUL, &&L_BC_MUL_I32, &&L_BC_MUL_U32,
+        &&L_BC_DIV_S, &&L_BC_DIV_U, &&L_BC_MOD_S, &&L_BC_MOD_U,
+        &&L_BC_AND, &&L_BC_OR, &&L_BC_XOR,
+        &&L_BC_SHL, &&L_BC_SHL_I32, &&L_BC_SHL_U32, &&L_BC_SHR_S, &&L_BC_SHR_U,
+        &&L_BC_ROTL, &&L_BC_ROTR, &&L_BC_POPCOUNT, &&L_BC_CLZ, &&L_BC_CTZ,
+        &&L_BC_NEG, &&L_BC_NEG_I32, &&L_BC_NEG_U32, &&L_BC_NOT,
+        &&L_BC_WRAP_I8, &&L_BC_WRAP_I16, &&L_BC_WRAP_I32,
+        &&L_BC_WRAP_U8, &&L_BC_WRAP_U16, &&L_BC_WRAP_U32, &&L_BC_TO_BOOL,
+        &&L_BC_EQ, &&L_BC_NE, &&L_BC_LT_S, &&L_BC_LT_U, &&L_BC_LE_S, &&L_BC_LE_U,
+        &&L_BC_JMP, &&L_BC_JNZ, &&L_BC_JZ,
+        &&L_BC_JEQ, &&L_BC_JNE, &&L_BC_JLT_S, &&L_BC_JLT_U, &&L_BC_JLE_S, &&L_BC_JLE_U,
+        &&L_BC_CALL, &&L_BC_RET, &&L_BC_RET_VOID, &&L_BC_DBG, &&L_BC_TRAP,
+        &&L_BC_LOAD, &&L_BC_LOAD_G, &&L_BC_STORE, &&L_BC_STORE_G, &&L_BC_CHECK, &&L_BC_ARRAY_INIT
+    };
+    for (int f = 0; f < program->function_count; f++) {
+        BcFunction* func = program->functions[f];
+        for (int i = 0; i < func->code_count; i++) {
+            func->code[i].handler = handlers[func->code[i].op];
+        }
+    }
+#define TARGET(op) L_##op:
+#define NEXT() __extension__ ({ goto *ip->handler; })
+#else
+#define TARGET(op) case op:
+#define NEXT() goto dispatch
+#endif
+
+    OutBuffer* out = xmalloc(sizeof(OutBuffer));
+    out->file = out_file;
+    out->len = 0;
+
+    size_t reg_capacity = 1024;
+    long long* regs = xmalloc(reg_capacity * sizeof(long long));
+    size_t frame_capacity = 64;
+    Frame* frames = xmalloc(frame_capacity * sizeof(Frame));
+    int depth = 0;
+
+    const BcFunction* func = program->functions[program->main_index];
+    size_t base = 0;
+    while ((size_t)func->register_count > reg_capacity) reg_capacity *= 2;
+    regs = xrealloc(regs, reg_capacity * sizeof(long long));
+    memset(regs, 0, func->register_count * sizeof(long long));
+    long long* r = regs;
+
+    size_t mem_capacity = 1024;
+    while ((size_t)func->array_slots > mem_capacity) mem_capacity *= 2;
+    long long* mem = xmalloc(mem_capacity * sizeof(long long));
+    size_t mem_base = 0;
+    long long* m = mem;
+    long long* g = xmalloc((program->global_slots + 1) * sizeof(long long));
+    if (program->global_slots > 0) {
+        memcpy(g, program->global_image, program->global_slots * sizeof(long long));
+    }
+
+    const BcInstr* code = func->code;
+    const BcInstr* ip = code;
+    const char* error = NULL;
+
+#ifdef BC_THREADED
+    NEXT();
+#else
+dispatch:
+    switch (ip->op) {
+#endif
+
+    TARGET(BC_LOADK) r[ip->dst] = ip->imm; ip++; NEXT();
+    TARGET(BC_MOV) r[ip->dst] = r[ip->a]; ip++; NEXT();
+
+    TARGET(BC_ADD) r[ip->dst] = WRAP64(U(r[ip->a]) + U(r[ip->b])); ip++; NEXT();
+    TARGET(BC_ADD_I32) r[ip->dst] = (int32_t)(uint32_t)(U(r[ip->a]) + U(r[ip->b])); ip++; NEXT();
+    TARGET(BC_ADD_U32) r[ip->dst] = (uint32_t)(U(r[ip->a]) + U(r[ip->b])); ip++; NEXT();
+    TARGET(BC_SUB) r[ip->dst] = WRAP64(U(r[ip->a]) - U(r[ip->b])); ip++; NEXT();
+    TARGET(BC_SUB_I32) r[ip->dst] = (int32_t)(uint32_t)(U(r[ip->a]) - U(r[ip->b])); ip++; NEXT();
+    TARGET(BC_SUB_U32) r[ip->dst] = (uint32_t)(U(r[ip->a]) - U(r[ip->b])); ip++; NEXT();
+    TARGET(BC_MUL) r[ip->dst] = WRAP64(U(r[ip->a]) * U(r[ip->b])); ip++; NEXT();
+    TARGET(BC_MUL_I32) r[ip->dst] = (int32_t)(uint32_t)(U(r[ip->a]) * U(r[ip->b])); ip++; NEXT();
+    TARGET(BC_MUL_U32) r[ip->dst] = (uint32_t)(U(r[ip->a]) * U(r[ip->b])); ip++; NEXT();
+
+    TARGET(BC_DIV_S) {
+        long long x = r[ip->a], y = r[ip->b];
+        if (y == 0) { error = "integer division by zero"; goto fail; }
+        if (y == -1 && x == ip->imm) { error = "integer overflow"; goto fail; }
+        r[ip->dst] = x / y;
+        ip++;
+        NEXT();
+    }
+    TARGET(BC_DIV_U) {
+        if (r[ip->b] == 0) { error = "integer division by zero"; goto fail; }
+        r[ip->dst] = WRAP64(U(r[ip->a]) / U(r[ip->b]));
+        ip++;
+        NEXT();
+    }
+    TARGET(BC_MOD_S) {
+        long long x = r[ip->a], y = r[ip->b];
+        if (y == 0) { error = "integer division by zero"; goto fail; }
+        r[ip->dst] = y == -1 ? 0 : x % y;
+        ip++;
+        NEXT();
+    }
+    TARGET(BC_MOD_U) {
+        if (r[ip->b] == 0) { error = "integer division by zero"; goto fail; }
+        r[ip->dst] = WRAP64(U(r[ip->a]) % U(r[ip->b]));
+        ip++;
+        NEXT();
+    }
+
+    /* Canonical operands give canonical results for and, or and xor */
+    TARGET(BC_AND) r[ip->dst] = r[ip->a] & r[ip->b]; ip++; NEXT();
+    TARGET(BC_OR) r[ip->dst] = r[ip->a] | r[ip->b]; ip++; NEXT();
+    TARGET(BC_XOR) r[ip->dst] = r[ip->a] ^ r[ip->b]; ip++; NEXT();
+    TARGET(BC_SHL) r[ip->dst] = WRAP64(U(r[ip->a]) << (r[ip->b] & 63)); ip++; NEXT();
+    TARGET(BC_SHL_I32) r[ip->dst] = (int32_t)(uint32_t)(U(r[ip->a]) << (r[ip->b] & 31)); ip++; NEXT();
+    TARGET(BC_SHL_U32) r[ip->dst] = (uint32_t)(U(r[ip->a]) << (r[ip->b] & 31)); ip++; NEXT();
+    TARGET(BC_SHR_S) r[ip->dst] = r[ip->a] >> (r[ip->b] & ip->imm); ip++; NEXT();
+    TARGET(BC_SHR_U) r[ip->dst] = WRAP64(U(r[ip->a]) >> (r[ip->b] & ip->imm)); ip++; NEXT();
+    TARGET(BC_ROTL) r[ip->dst] = eval_bit_op(BINOP_ROTL, r[ip->a], r[ip->b], (CasmType)ip->imm); ip++; NEXT();
+    TARGET(BC_ROTR) r[ip->dst] = eval_bit_op(BINOP_ROTR, r[ip->a], r[ip->b], (CasmType)ip->imm); ip++; NEXT();
+    TARGET(BC_POPCOUNT) r[ip->dst] = eval_bit_count(UNOP_POPCOUNT, r[ip->a], (CasmType)ip->imm); ip++; NEXT();
+    TARGET(BC_CLZ) r[ip->dst] = eval_bit_count(UNOP_CLZ, r[ip->a], (CasmType)ip->imm); ip++; NEXT();
+    TARGET(BC_CTZ) r[ip->dst] = eval_bit_count(UNOP_CTZ, r[ip->a], (CasmType)ip->imm); ip++; NEXT();
+
+    TARGET(BC_NEG) r[ip->dst] = WRAP64(0u - U(r[ip->a])); ip++; NEXT();
+    TARGET(BC_NEG_I32) r[ip->dst] = (int32_t)(uint32_t)(0u - U(r[ip->a])); ip++; NEXT();
+    TARGET(BC_NEG_U32) r[ip->dst] = (uint32_t)(0u - U(r[ip->a])); ip++; NEXT();
+    TARGET(BC_NOT) r[ip->dst] = r[ip->a] ^ 1; ip++; NEXT();
+
+    TARGET(BC_WRAP_I8) r[ip->dst] = (int8_t)(uint8_t)r[ip->a]; ip++; NEXT();
+    TARGET(BC_WRAP_I16) r[ip->dst] = (int16_t)(uint16_t)r[ip->a]; ip++; NEXT();
+    TARGET(BC_WRAP_I32) r[ip->dst] = (int32_t)(uint32_t)r[ip->a]; ip++; NEXT();
+    TARGET(BC_WRAP_U8) r[ip->dst] = (uint8_t)r[ip->a]; ip++; NEXT();
+    TARGET(BC_WRAP_U16) r[ip->dst] = (uint16_t)r[ip->a]; ip++; NEXT();
+    TARGET(BC_WRAP_U32) r[ip->dst] = (uint32_t)r[ip->a]; ip++; NEXT();
+    TARGET(BC_TO_BOOL) r[ip->dst] = r[ip->a] != 0; ip++; NEXT();
+
+    TARGET(BC_EQ) r[ip->dst] = r[ip->a] == r[ip->b]; ip++; NEXT();
+    TARGET(BC_NE) r[ip->dst] = r[ip->a] != r[ip->b]; ip++; NEXT();
+    TARGET(BC_LT_S) r[ip->dst] = r[ip->a] < r[ip->b]; ip++; NEXT();
+    TARGET(BC_LT_U) r[ip->dst] = U(r[ip->a]) < U(r[ip->b]); ip++; NEXT();
+    TARGET(BC_LE_S) r[ip->dst] = r[ip->a] <= r[ip->b]; ip++; NEXT();
+    TARGET(BC_LE_U) r[ip->dst] = U(r[ip->a]) <= U(r[ip->b]); ip++; NEXT();
+
+    TARGET(BC_JMP) ip = code + ip->imm; NEXT();
+    TARGET(BC_JNZ) ip = r[ip->a] ? code + ip->imm : ip + 1; NEXT();
+    TARGET(BC_JZ) ip = r[ip->a] ? ip + 1 : code + ip->imm; NEXT();
+    TARGET(BC_JEQ) ip = r[ip->a] == r[ip->b] ? code + ip->imm : ip + 1; NEXT();
+    TARGET(BC_JNE) ip = r[ip->a] != r[ip->b] ? code + ip->imm : ip + 1; NEXT();
+    TARGET(BC_JLT_S) ip = r[ip->a] < r[ip->b] ? code + ip->imm : ip + 1; NEXT();
+    TARGET(BC_JLT_U) ip = U(r[ip->a]) < U(r[ip->b]) ? code + ip->imm : ip + 1; NEXT();
+    TARGET(BC_JLE_S) ip = r[ip->a] <= r[ip->b] ? code + ip->imm : ip + 1; NEXT();
+    TARGET(BC_JLE_U) ip = U(r[ip->a]) <= U(r[ip->b]) ? code + ip->imm : ip + 1; NEXT();
+
+    TARGET(BC_CALL) {
+        const BcFunction* callee = program->functions[ip->imm];
+        size_t callee_base = base + func->register_count;
+        if (depth >= MAX_CALL_DEPTH) { error = "call stack exhausted"; goto fail; }
+        if (callee_base + callee->register_count > reg_capacity) {
+            while (callee_base + callee->register_count > reg_capacity) reg_capacity *= 2;
+            regs = xrealloc(regs, reg_capacity * sizeof(long long));
+            r = regs + base;
+        }
+        size_t callee_mem_base = mem_base + func->array_slots;
+        if (callee_mem_base + callee->array_slots > mem_capacity) {
+            while (callee_mem_base + callee->array_slots > mem_capacity) mem_capacity *= 2;
+            mem = xrealloc(mem, mem_capacity * sizeof(long long));
+        }
+        if (depth >= (int)frame_capacity) {
+            frame_capacity *= 2;
+            frames = xrealloc(frames, frame_capacity * sizeof(Frame));
+        }
+        const int* operands = func->call_args + ip->a;
+        for (int i = 0; i < ip->b; i++) {
+            int param = callee->param_registers[i];
+            if (param >= 0) regs[callee_base + param] = r[operands[i]];
+        }
+        frames[depth].func = func;
+        frames[depth].return_ip = ip + 1;
+        frames[depth].base = base;
+        frames[depth].mem_base = mem_base;
+        frames[depth].dst = ip->dst;
+        depth++;
+
+        func = callee;
+        base = callee_base;
+        r = regs + base;
+        mem_base = callee_mem_base;
+        m = mem + mem_base;
+        code = func->code;
+        ip = code;
+        NEXT();
+    }
+
+    TARGET(BC_RET) {
+        long long value = r[ip->a];
+        if (depth == 0) {
+            result.result = value;
+            goto done;
+        }
+        depth--;
+        func = frames[depth].func;
+        base = frames[depth].base;
+        r = regs + base;
+        mem_base = frames[depth].mem_base;
+        m = mem + mem_base;
+        code = func->code;
+        ip = frames[depth].return_ip;
+        if (frames[depth].dst >= 0) r[frames[depth].dst] = value;
+        NEXT();
+    }
+
+    TARGET(BC_RET_VOID) {
+        if (depth == 0) goto done;
+        depth--;
+        func = frames[depth].func;
+        base = frames[depth].base;
+        r = regs + base;
+        mem_base = frames[depth].mem_base;
+        m = mem + mem_base;
+        code = func->code;
+        ip = frames[depth].return_ip;
+        NEXT();
+    }
+
+    TARGET(BC_DBG) {
+        print_dbg_line(out, &program->dbg_lines[ip->imm], r, func->call_args + ip->a);
+        ip++;
+        NEXT();
+    }
+
+    TARGET(BC_TRAP) {
+        error = "unreachable code reached";
+        goto fail;
+    }
+
+    TARGET(BC_LOAD) r[ip->dst] = m[ip->imm + r[ip->a]]; ip++; NEXT();
+    TARGET(BC_LOAD_G) r[ip->dst] = g[ip->imm + r[ip->a]]; ip++; NEXT();
+    TARGET(BC_STORE) m[ip->imm + r[ip->a]] = r[ip->b]; ip++; NEXT();
+    TARGET(BC_STORE_G) g[ip->imm + r[ip->a]] = r[ip->b]; ip++; NEXT();
+    TARGET(BC_CHECK) {
+        if (U(r[ip->a]) >= U(ip->imm)) { error = "array index out of bounds"; goto fail; }
+        ip++;
+        NEXT();
+    }
+    TARGET(BC_ARRAY_INIT) {
+        memcpy(m + ip->imm, func->array_image + ip->imm, ip->b * sizeof(long long));
+        ip++;
+        NEXT();
+    }
+
+#ifndef BC_THREADED
+        default:
+            error = "invalid bytecode";
+            goto fail;
+    }
+#endif
+
+fail:
+    result.success = 0;
+    result.error_msg = xstrdup(error);
+
+done:
+    out_flush(out);
+    fflush(out->file);
+    xfree(out);
+    xfree(regs);
+    xfree(mem);
+    xfree(g);
+    xfree(frames);
+    return result;
+}
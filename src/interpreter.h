@@ -0,0 +1,20 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <stdio.h>
+#include "bytecode.h"
+
+/* Result of running a program */
+typedef struct {
+    int success;        /* 1 if main returned, 0 on a runtime error */
+    char* error_msg;    /* Runtime error message if failed (NULL if success) */
+    long long result;   /* main's return value (0 for void) */
+} InterpretResult;
+
+/* Run `main` of a compiled program. dbg output is buffered and written to
+ * `out` (also when a runtime error stops the program). Division by zero,
+ * signed division overflow, array indices out of bounds and reaching
+ * unreachable code are runtime errors, as in the WebAssembly backend. */
+InterpretResult bc_run_main(BcProgram* program, FILE* out);
+
+#endif /* INTERPRETER_H */
@@ -0,0 +1,535 @@
+#include <string.h>
+#include "ir.h"
+#include "utils.h"
+
+/* Helper: Append an int to a growable array */
+static void int_array_push(int** items, int* count, int* capacity, int value) {
+    if (*count >= *capacity) {
+        *capacity = (*capacity == 0) ? 4 : *capacity * 2;
+        *items = xrealloc(*items, *capacity * sizeof(int));
+    }
+    (*items)[(*count)++] = value;
+}
+
+IrFunction* ir_function_create(const char* name, CasmType return_type) {
+    IrFunction* func = xmalloc(sizeof(IrFunction));
+    memset(func, 0, sizeof(IrFunction));
+    func->name = xstrdup(name);
+    func->return_type = return_type;
+    return func;
+}
+
+void ir_function_free(IrFunction* func) {
+    if (!func) return;
+
+    for (int i = 0; i < func->value_count; i++) {
+        xfree(func->values[i].args);
+        xfree(func->values[i].callee);
+    }
+    xfree(func->values);
+
+    for (int i = 0; i < func->block_count; i++) {
+        xfree(func->blocks[i].instrs);
+        xfree(func->blocks[i].preds);
+    }
+    xfree(func->blocks);
+
+    for (int i = 0; i < func->array_count; i++) {
+        xfree(func->arrays[i].name);
+        xfree(func->arrays[i].init);
+    }
+    xfree(func->arrays);
+
+    xfree(func->param_types);
+    xfree(func->param_origins);
+    xfree(func->name);
+    xfree(func);
+}
+
+void ir_function_add_param(IrFunction* func, CasmType type) {
+    func->param_types = xrealloc(func->param_types, (func->param_count + 1) * sizeof(CasmType));
+    func->param_origins = xrealloc(func->param_origins, (func->param_count + 1) * sizeof(IrParamOrigin));
+    func->param_origins[func->param_count].struct_index = -1;
+    func->param_origins[func->param_count].field = 0;
+    func->param_types[func->param_count++] = type;
+}
+
+/* Helper: Append a deep copy of an array description */
+static int array_list_add(IrArray** arrays, int* count, const IrArray* array) {
+    *arrays = xrealloc(*arrays, (*count + 1) * sizeof(IrArray));
+    IrArray* copy = &(*arrays)[*count];
+    *copy = *array;
+    copy->name = xstrdup(array->name);
+    copy->init = NULL;
+    if (array->init_count > 0) {
+        copy->init = xmalloc(array->init_count * sizeof(long long));
+        memcpy(copy->init, array->init, array->init_count * sizeof(long long));
+    }
+    return (*count)++;
+}
+
+int ir_function_add_array(IrFunction* func, const IrArray* array) {
+    return array_list_add(&func->arrays, &func->array_count, array);
+}
+
+const IrArray* ir_array_ref(const IrModule* module, const IrFunction* func, long long imm) {
+    if (IR_IS_GLOBAL_ARRAY(imm)) {
+        return &module->globals[IR_ARRAY_INDEX(imm)];
+    }
+    return &func->arrays[imm];
+}
+
+int ir_add_block(IrFunction* func) {
+    if (func->block_count >= func->block_capacity) {
+        func->block_capacity = (func->block_capacity == 0) ? 8 : func->block_capacity * 2;
+        func->blocks = xrealloc(func->blocks, func->block_capacity * sizeof(IrBlock));
+    }
+    IrBlock* block = &func->blocks[func->block_count];
+    memset(block, 0, sizeof(IrBlock));
+    block->term.kind = IR_TERM_NONE;
+    block->term.value = -1;
+    block->term.targets[0] = -1;
+    block->term.targets[1] = -1;
+    return func->block_count++;
+}
+
+/* Helper: Create an instruction that is not yet placed in a block */
+static int new_value(IrFunction* func, int block, IrOpcode op, CasmType type) {
+    if (func->value_count >= func->value_capacity) {
+        func->value_capacity = (func->value_capacity == 0) ? 32 : func->value_capacity * 2;
+        func->values = xrealloc(func->values, func->value_capacity * sizeof(IrInstr));
+    }
+    IrInstr* instr = &func->values[func->value_count];
+    memset(instr, 0, sizeof(IrInstr));
+    instr->op = op;
+    instr->type = type;
+    instr->block = block;
+    instr->replaced_by = -1;
+    return func->value_count++;
+}
+
+int ir_emit(IrFunction* func, int block, IrOpcode op, CasmType type) {
+    int id = new_value(func, block, op, type);
+    IrBlock* b = &func->blocks[block];
+    int_array_push(&b->instrs, &b->instr_count, &b->instr_capacity, id);
+    return id;
+}
+
+int ir_emit_const(IrFunction* func, int block, CasmType type, long long value) {
+    int id = ir_emit(func, block, IR_CONST, type);
+    func->values[id].imm = value;
+    return id;
+}
+
+void ir_add_arg(IrFunction* func, int value, int arg) {
+    IrInstr* instr = &func->values[value];
+    int_array_push(&instr->args, &instr->arg_count, &instr->arg_capacity, arg);
+}
+
+int ir_insert_phi(IrFunction* func, int block, CasmType type) {
+    int id = new_value(func, block, IR_PHI, type);
+    IrBlock* b = &func->blocks[block];
+
+    int pos = 0;
+    while (pos < b->instr_count && func->values[b->instrs[pos]].op == IR_PHI) {
+        pos++;
+    }
+    int_array_push(&b->instrs, &b->instr_count, &b->instr_capacity, id);
+    memmove(&b->instrs[pos + 1], &b->instrs[pos], (b->instr_count - 1 - pos) * sizeof(int));
+    b->instrs[pos] = id;
+    return id;
+}
+
+/* Helper: Record `from` as a predecessor of `to` */
+static void add_pred(IrFunction* func, int to, int from) {
+    IrBlock* b = &func->blocks[to];
+    int_array_push(&b->preds, &b->pred_count, &b->pred_capacity, from);
+}
+
+void ir_set_jump(IrFunction* func, int block, int target) {
+    IrTerminator* term = &func->blocks[block].term;
+    term->kind = IR_TERM_JUMP;
+    term->targets[0] = target;
+    add_pred(func, target, block);
+}
+
+void ir_set_branch(IrFunction* func, int block, int cond, int if_true, int if_false) {
+    IrTerminator* term = &func->blocks[block].term;
+    term->kind = IR_TERM_BRANCH;
+    term->value = cond;
+    term->targets[0] = if_true;
+    term->targets[1] = if_false;
+    add_pred(func, if_true, block);
+    add_pred(func, if_false, block);
+}
+
+void ir_set_return(IrFunction* func, int block, int value) {
+    IrTerminator* term = &func->blocks[block].term;
+    term->kind = IR_TERM_RETURN;
+    term->value = value;
+}
+
+void ir_set_unreachable(IrFunction* func, int block) {
+    func->blocks[block].term.kind = IR_TERM_UNREACHABLE;
+}
+
+int ir_block_successors(const IrBlock* block, int out[2]) {
+    switch (block->term.kind) {
+        case IR_TERM_JUMP:
+            out[0] = block->term.targets[0];
+            return 1;
+        case IR_TERM_BRANCH:
+            out[0] = block->term.targets[0];
+            out[1] = block->term.targets[1];
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+int ir_compute_dominators(const IrFunction* func, int* rpo, int* rpo_index, int* idom) {
+    int n = func->block_count;
+    int* stack = xmalloc((n + 1) * sizeof(int));
+    int* post = xmalloc((n + 1) * sizeof(int));
+    int* visited = xmalloc((n + 1) * sizeof(int));
+    int post_count = 0;
+    memset(visited, 0, (n + 1) * sizeof(int));
+
+    /* Depth-first, taking the first successor last so it comes first in
+     * reverse postorder */
+    int depth = 0;
+    stack[depth++] = 0;
+    visited[0] = 1;
+    while (depth > 0) {
+        int block = stack[depth - 1];
+        int succ[2];
+        int count = ir_block_successors(&func->blocks[block], succ);
+        int pushed = 0;
+        for (int i = count - 1; i >= 0; i--) {
+            if (!visited[succ[i]]) {
+                visited[succ[i]] = 1;
+                stack[depth++] = succ[i];
+                pushed = 1;
+                break;
+            }
+        }
+        if (!pushed) {
+            post[post_count++] = block;
+            depth--;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        rpo_index[i] = -1;
+        idom[i] = -1;
+    }
+    for (int i = 0; i < post_count; i++) {
+        rpo[i] = post[post_count - 1 - i];
+        rpo_index[rpo[i]] = i;
+    }
+
+    idom[0] = 0;
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 1; i < post_count; i++) {
+            int block = rpo[i];
+            const IrBlock* b = &func->blocks[block];
+            int new_idom = -1;
+            for (int p = 0; p < b->pred_count; p++) {
+                int pred = b->preds[p];
+                if (rpo_index[pred] < 0 || idom[pred] < 0) continue;
+                if (new_idom < 0) {
+                    new_idom = pred;
+                    continue;
+                }
+                /* Intersect */
+                int x = pred;
+                int y = new_idom;
+                while (x != y) {
+                    while (rpo_index[x] > rpo_index[y]) x = idom[x];
+                    while (rpo_index[y] > rpo_index[x]) y = idom[y];
+                }
+                new_idom = x;
+            }
+            if (new_idom >= 0 && idom[block] != new_idom) {
+                idom[block] = new_idom;
+                changed = 1;
+            }
+        }
+    }
+
+    xfree(visited);
+    xfree(post);
+    xfree(stack);
+    return post_count;
+}
+
+IrModule* ir_module_create(void) {
+    IrModule* module = xmalloc(sizeof(IrModule));
+    module->functions = NULL;
+    module->function_count = 0;
+    module->globals = NULL;
+    module->global_count = 0;
+    return module;
+}
+
+void ir_module_free(IrModule* module) {
+    if (!module) return;
+    for (int i = 0; i < module->function_count; i++) {
+        ir_function_free(module->functions[i]);
+    }
+    xfree(module->functions);
+    for (int i = 0; i < module->global_count; i++) {
+        xfree(module->globals[i].name);
+        xfree(module->globals[i].init);
+    }
+    xfree(module->globals);
+    xfree(module);
+}
+
+void ir_module_add_function(IrModule* module, IrFunction* func) {
+    module->functions = xrealloc(module->functions, (module->function_count + 1) * sizeof(IrFunction*));
+    module->functions[module->function_count++] = func;
+}
+
+void ir_module_add_global(IrModule* module, const IrArray* array) {
+    array_list_add(&module->globals, &module->global_count, array);
+}
+
+const char* ir_opcode_name(IrOpcode op) {
+    switch (op) {
+        case IR_CONST: return "const";
+        case IR_PARAM: return "param";
+        case IR_UNDEF: return "undef";
+        case IR_PHI:   return "phi";
+        case IR_CONV:  return "conv";
+        case IR_ADD:   return "add";
+        case IR_SUB:   return "sub";
+        case IR_MUL:   return "mul";
+        case IR_DIV:   return "div";
+        case IR_MOD:   return "mod";
+        case IR_AND:   return "and";
+        case IR_OR:    return "or";
+        case IR_XOR:   return "xor";
+        case IR_SHL:   return "shl";
+        case IR_SHR:   return "shr";
+        case IR_ROTL:  return "rotl";
+        case IR_ROTR:  return "rotr";
+        case IR_NEG:   return "neg";
+        case IR_NOT:   return "not";
+        case IR_POPCOUNT: return "popcount";
+        case IR_CLZ:   return "clz";
+        case IR_CTZ:   return "ctz";
+        case IR_EQ:    return "eq";
+        case IR_NE:    return "ne";
+        case IR_LT:    return "lt";
+        case IR_GT:    return "gt";
+        case IR_LE:    return "le";
+        case IR_GE:    return "ge";
+        case IR_CALL:  return "call";
+        case IR_DBG:   return "dbg";
+        case IR_LOAD:  return "load";
+        case IR_STORE: return "store";
+        case IR_BOUNDS_CHECK: return "boundscheck";
+        case IR_ARRAY_INIT:   return "arrayinit";
+    }
+    return "?";
+}
+
+/* Helper: Append "%N" */
+static void dump_value(OutputSink* out, int id) {
+    output_sink_append_char(out, '%');
+    output_sink_append_int(out, id);
+}
+
+/* Helper: Append an array operand ("$N" local, "$gN" global) */
+static void dump_array_ref(OutputSink* out, long long imm) {
+    output_sink_append(out, IR_IS_GLOBAL_ARRAY(imm) ? "$g" : "$");
+    output_sink_append_int(out, IR_ARRAY_INDEX(imm));
+}
+
+/* Helper: Append "bbN" */
+static void dump_block_ref(OutputSink* out, int id) {
+    output_sink_append(out, "bb");
+    output_sink_append_int(out, id);
+}
+
+/* Helper: Dump one instruction line */
+static void dump_instr(const IrFunction* func, int id, OutputSink* out) {
+    const IrInstr* instr = &func->values[id];
+    const IrBlock* block = &func->blocks[instr->block];
+
+    output_sink_append(out, "  ");
+    if (instr->type != TYPE_VOID) {
+        dump_value(out, id);
+        output_sink_append(out, " = ");
+    }
+    output_sink_append(out, ir_opcode_name(instr->op));
+    output_sink_append_char(out, ' ');
+    output_sink_append(out, type_to_string(instr->type));
+
+    switch (instr->op) {
+        case IR_CONST:
+        case IR_PARAM:
+            output_sink_append_char(out, ' ');
+            output_sink_append_int(out, instr->imm);
+            break;
+        case IR_PHI:
+            for (int i = 0; i < instr->arg_count; i++) {
+                output_sink_append(out, i > 0 ? ", [" : " [");
+                if (i < block->pred_count) {
+                    dump_block_ref(out, block->preds[i]);
+                } else {
+                    output_sink_append(out, "?");
+                }
+                output_sink_append(out, ": ");
+                dump_value(out, instr->args[i]);
+                output_sink_append_char(out, ']');
+            }
+            break;
+        case IR_CALL:
+            output_sink_append(out, " @");
+            output_sink_append(out, instr->callee);
+            output_sink_append_char(out, '(');
+            for (int i = 0; i < instr->arg_count; i++) {
+                if (i > 0) output_sink_append(out, ", ");
+                dump_value(out, instr->args[i]);
+            }
+            output_sink_append_char(out, ')');
+            break;
+        case IR_LOAD:
+        case IR_STORE:
+        case IR_BOUNDS_CHECK:
+        case IR_ARRAY_INIT:
+            output_sink_append_char(out, ' ');
+            dump_array_ref(out, instr->imm);
+            for (int i = 0; i < instr->arg_count; i++) {
+                output_sink_append(out, ", ");
+                dump_value(out, instr->args[i]);
+            }
+            break;
+        default:
+            for (int i = 0; i < instr->arg_count; i++) {
+                output_sink_append(out, i > 0 ? ", " : " ");
+                dump_value(out, instr->args[i]);
+            }
+            break;
+    }
+
+    if (instr->op == IR_DBG && instr->dbg) {
+        output_sink_append(out, "  ; ");
+        output_sink_append_int(out, instr->dbg->location.line);
+        output_sink_append_char(out, ':');
+        output_sink_append_int(out, instr->dbg->location.column);
+        for (int i = 0; i < instr->dbg->argument_count; i++) {
+            output_sink_append(out, i > 0 ? ", " : " ");
+            output_sink_append(out, instr->dbg->arg_names[i]);
+        }
+    }
+    output_sink_append_char(out, '\n');
+}
+
+/* Helper: Dump an array declaration line */
+static void dump_array(const IrArray* array, int global, int index, OutputSink* out) {
+    output_sink_append(out, global ? "global " : "  array ");
+    dump_array_ref(out, global ? IR_GLOBAL_ARRAY(index) : index);
+    output_sink_append_char(out, ' ');
+    output_sink_append(out, array->name);
+    output_sink_append(out, ": ");
+    output_sink_append(out, type_to_string(array->elem_type));
+    output_sink_append_char(out, '[');
+    output_sink_append_int(out, array->length);
+    output_sink_append_char(out, ']');
+    if (array->init_count > 0) {
+        output_sink_append(out, " = {");
+        for (int i = 0; i < array->init_count; i++) {
+            if (i > 0) output_sink_append(out, ", ");
+            output_sink_append_int(out, array->init[i]);
+        }
+        output_sink_append_char(out, '}');
+    }
+    output_sink_append_char(out, '\n');
+}
+
+/* Helper: Dump a block's terminator line */
+static void dump_terminator(const IrTerminator* term, OutputSink* out) {
+    output_sink_append(out, "  ");
+    switch (term->kind) {
+        case IR_TERM_NONE:
+            output_sink_append(out, "<no terminator>");
+            break;
+        case IR_TERM_JUMP:
+            output_sink_append(out, "jmp ");
+            dump_block_ref(out, term->targets[0]);
+            break;
+        case IR_TERM_BRANCH:
+            output_sink_append(out, "br ");
+            dump_value(out, term->value);
+            output_sink_append(out, ", ");
+            dump_block_ref(out, term->targets[0]);
+            output_sink_append(out, ", ");
+            dump_block_ref(out, term->targets[1]);
+            break;
+        case IR_TERM_RETURN:
+            output_sink_append(out, "ret");
+            if (term->value >= 0) {
+                output_sink_append_char(out, ' ');
+                dump_value(out, term->value);
+            }
+            break;
+        case IR_TERM_UNREACHABLE:
+            output_sink_append(out, "unreachable");
+            break;
+    }
+    output_sink_append_char(out, '\n');
+}
+
+void ir_dump_function(const IrFunction* func, OutputSink* out) {
+    output_sink_append(out, "func @");
+    output_sink_append(out, func->name);
+    output_sink_append_char(out, '(');
+    for (int i = 0; i < func->param_count; i++) {
+        if (i > 0) output_sink_append(out, ", ");
+        output_sink_append(out, type_to_string(func->param_types[i]));
+    }
+    output_sink_append(out, ") -> ");
+    output_sink_append(out, type_to_string(func->return_type));
+    output_sink_append(out, " {\n");
+    for (int i = 0; i < func->array_count; i++) {
+        dump_array(&func->arrays[i], 0, i, out);
+    }
+
+    for (int b = 0; b < func->block_count; b++) {
+        const IrBlock* block = &func->blocks[b];
+        dump_block_ref(out, b);
+        output_sink_append_char(out, ':');
+        if (block->pred_count > 0) {
+            output_sink_append(out, "  ; preds");
+            for (int i = 0; i < block->pred_count; i++) {
+                output_sink_append(out, i > 0 ? ", " : " ");
+                dump_block_ref(out, block->preds[i]);
+            }
+        }
+        output_sink_append_char(out, '\n');
+
+        for (int i = 0; i < block->instr_count; i++) {
+            dump_instr(func, block->instrs[i], out);
+        }
+        dump_terminator(&block->term, out);
+    }
+    output_sink_append(out, "}\n");
+}
+
+void ir_dump_module(const IrModule* module, OutputSink* out) {
+    for (int i = 0; i < module->global_count; i++) {
+        dump_array(&module->globals[i], 1, i, out);
+    }
+    if (module->global_count > 0 && module->function_count > 0) {
+        output_sink_append_char(out, '\n');
+    }
+    for (int i = 0; i < module->function_count; i++) {
+        if (i > 0) output_sink_append_char(out, '\n');
+        ir_dump_function(module->functions[i], out);
+    }
+}
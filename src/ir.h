@@ -0,0 +1,210 @@
+#ifndef IR_H
+#define IR_H
+
+#include "ast.h"
+#include "output_sink.h"
+
+/* Typed mid-level IR in SSA form.
+ *
+ * Each function is a list of basic blocks. A block holds instructions
+ * (phis first) and ends in exactly one terminator. Every instruction
+ * defines at most one value, identified by its index in the function's
+ * value table (%N in dumps), and has a CasmType.
+ *
+ * Arithmetic is only done in i32, u32, i64 and u64 (narrow operands are
+ * promoted like C does); narrow types appear as conversion results and
+ * as the types of parameters, returns and call results. Rotates and bit
+ * counts are the exception: they work on the bits of their own type. */
+
+typedef enum {
+    IR_CONST,       /* imm = value */
+    IR_PARAM,       /* imm = parameter index */
+    IR_UNDEF,       /* Value of a variable read before any assignment */
+    IR_PHI,         /* One argument per predecessor, in predecessor order */
+    IR_CONV,        /* Wrap/extend args[0] to `type` */
+    IR_ADD,
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,         /* Signedness follows the operand type */
+    IR_MOD,
+    IR_AND,
+    IR_OR,
+    IR_XOR,
+    IR_SHL,         /* Count (args[1], same type) masked to 31 or 63 */
+    IR_SHR,         /* Arithmetic for signed types, logical for unsigned */
+    IR_ROTL,        /* In `type`, which may be narrow; count taken mod width */
+    IR_ROTR,
+    IR_NEG,
+    IR_NOT,         /* bool */
+    IR_POPCOUNT,    /* Bit counts in `type`, which may be narrow */
+    IR_CLZ,         /* The width of `type` for 0 */
+    IR_CTZ,
+    IR_EQ,          /* Comparisons produce bool */
+    IR_NE,
+    IR_LT,
+    IR_GT,
+    IR_LE,
+    IR_GE,
+    IR_CALL,        /* callee, args; type is the return type (may be void) */
+    IR_DBG,         /* dbg statement; args are the printed values */
+    IR_LOAD,        /* Element args[0] (i64 index) of array imm */
+    IR_STORE,       /* Store args[1] to element args[0] of array imm */
+    IR_BOUNDS_CHECK,/* Trap unless 0 <= args[0] < length of array imm */
+    IR_ARRAY_INIT   /* Reset local array imm to its initializer */
+} IrOpcode;
+
+/* Array operands: imm >= 0 names a local array of the function,
+ * IR_GLOBAL_ARRAY(i) names global i of the module */
+#define IR_GLOBAL_ARRAY(i) (-(long long)(i) - 1)
+#define IR_IS_GLOBAL_ARRAY(imm) ((imm) < 0)
+#define IR_ARRAY_INDEX(imm) ((imm) < 0 ? (int)(-(imm) - 1) : (int)(imm))
+
+typedef struct {
+    IrOpcode op;
+    CasmType type;          /* Result type (TYPE_VOID if no value) */
+    int block;              /* Owning block */
+    int* args;              /* Operand value ids */
+    int arg_count;
+    int arg_capacity;
+    long long imm;          /* IR_CONST value, IR_PARAM index, array operand */
+    char* callee;           /* IR_CALL target name (owned) */
+    const ASTDbgStmt* dbg;  /* IR_DBG source statement (names, location) */
+    int replaced_by;        /* Used while building: forwarding id or -1 */
+} IrInstr;
+
+typedef enum {
+    IR_TERM_NONE,           /* Block still open (only while building) */
+    IR_TERM_JUMP,           /* targets[0] */
+    IR_TERM_BRANCH,         /* value ? targets[0] : targets[1] */
+    IR_TERM_RETURN,         /* value, or -1 for void */
+    IR_TERM_UNREACHABLE
+} IrTermKind;
+
+typedef struct {
+    IrTermKind kind;
+    int value;
+    int targets[2];
+} IrTerminator;
+
+typedef struct {
+    int* instrs;            /* Value ids in execution order, phis first */
+    int instr_count;
+    int instr_capacity;
+    int* preds;             /* Predecessor block ids */
+    int pred_count;
+    int pred_capacity;
+    IrTerminator term;
+} IrBlock;
+
+/* A fixed-size array of integers; elements past the initializer are 0 */
+typedef struct {
+    char* name;             /* Source name (globals: allocated name) */
+    CasmType elem_type;
+    int length;
+    long long* init;        /* Initializer values (owned, may be NULL) */
+    int init_count;
+} IrArray;
+
+/* Source of an IR parameter: a scalar parameter (struct_index -1), or
+ * field `field` of a struct parameter, whose fields are consecutive
+ * parameters in declaration order */
+typedef struct {
+    int struct_index;       /* Index into the module's structs, or -1 */
+    int field;
+} IrParamOrigin;
+
+typedef struct {
+    char* name;             /* Final (allocated) function name */
+    CasmType return_type;
+    CasmType* param_types;
+    IrParamOrigin* param_origins;   /* One per parameter */
+    int param_count;
+    IrInstr* values;
+    int value_count;
+    int value_capacity;
+    IrBlock* blocks;        /* Block 0 is the entry */
+    int block_count;
+    int block_capacity;
+    IrArray* arrays;        /* Local arrays, one per declaration */
+    int array_count;
+} IrFunction;
+
+typedef struct {
+    IrFunction** functions;
+    int function_count;
+    IrArray* globals;       /* Global arrays */
+    int global_count;
+    const ASTStructDef* structs;    /* The program's struct types (borrowed) */
+    int struct_count;
+} IrModule;
+
+/* Construction */
+IrFunction* ir_function_create(const char* name, CasmType return_type);
+void ir_function_free(IrFunction* func);
+void ir_function_add_param(IrFunction* func, CasmType type);
+int ir_function_add_array(IrFunction* func, const IrArray* array);
+int ir_add_block(IrFunction* func);
+
+/* Append an instruction to a block and return its value id */
+int ir_emit(IrFunction* func, int block, IrOpcode op, CasmType type);
+int ir_emit_const(IrFunction* func, int block, CasmType type, long long value);
+void ir_add_arg(IrFunction* func, int value, int arg);
+
+/* Insert a phi at the start of a block (after existing phis) */
+int ir_insert_phi(IrFunction* func, int block, CasmType type);
+
+/* Terminators (record the block as a predecessor of its targets) */
+void ir_set_jump(IrFunction* func, int block, int target);
+void ir_set_branch(IrFunction* func, int block, int cond, int if_true, int if_false);
+void ir_set_return(IrFunction* func, int block, int value);
+void ir_set_unreachable(IrFunction* func, int block);
+
+/* Successors of a block's terminator. Returns the count (0-2). */
+int ir_block_successors(const IrBlock* block, int out[2]);
+
+/* Reverse postorder of the reachable blocks and their immediate dominators
+ * (Cooper, Harvey & Kennedy, "A Simple, Fast Dominance Algorithm"). Each
+ * array holds one entry per block; rpo_index and idom are -1 for
+ * unreachable blocks, and idom[0] is 0. Returns the number of reachable
+ * blocks. */
+int ir_compute_dominators(const IrFunction* func, int* rpo, int* rpo_index, int* idom);
+
+/* Array operand of a load/store/bounds check/init */
+const IrArray* ir_array_ref(const IrModule* module, const IrFunction* func, long long imm);
+
+/* Modules */
+IrModule* ir_module_create(void);
+void ir_module_free(IrModule* module);
+void ir_module_add_function(IrModule* module, IrFunction* func);
+void ir_module_add_global(IrModule* module, const IrArray* array);
+
+/* Lower an analyzed (and name-allocated) program. Functions that were
+ * dropped as dead code are skipped. */
+IrModule* ir_lower_program(ASTProgram* program);
+
+/* Check structural and SSA invariants. Returns 1 if valid; otherwise 0
+ * and sets *out_error to a message (caller frees with xfree). */
+int ir_verify_function(const IrFunction* func, char** out_error);
+int ir_verify_module(const IrModule* module, char** out_error);
+
+/* Turn self tail calls into jumps to a loop header whose phis take the
+ * call's arguments in place of the parameters (-O1 and up) */
+void ir_eliminate_self_tail_calls(IrModule* module);
+
+/* Interval analysis of a function's values, narrowed at each use by the
+ * branch conditions guarding it (see ir_ranges.c) */
+typedef struct IrRanges IrRanges;
+
+IrRanges* ir_analyze_ranges(const IrFunction* func);
+void ir_ranges_free(IrRanges* ranges);
+
+/* Check if every value `value` can hold where `block` uses it was proven
+ * to fit `type`, so converting it needs no wrap */
+int ir_range_fits(const IrRanges* ranges, int value, int block, CasmType type);
+
+/* Textual dump */
+const char* ir_opcode_name(IrOpcode op);
+void ir_dump_function(const IrFunction* func, OutputSink* out);
+void ir_dump_module(const IrModule* module, OutputSink* out);
+
+#endif /* IR_H */
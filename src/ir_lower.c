@@ -0,0 +1,1052 @@
+#include <string.h>
+#include "ir.h"
+#include "types.h"
+#include "utils.h"
+
+/* Lowering from the analyzed AST to SSA IR.
+ *
+ * SSA form is built on the fly while walking the AST (Braun et al.,
+ * "Simple and Efficient Construction of Static Single Assignment Form"):
+ * each block remembers the current value of every variable written in
+ * it, reads look through predecessors, and blocks whose predecessors are
+ * not all known yet (loop headers) get placeholder phis that are filled
+ * in once the block is sealed. Trivial phis and unreachable blocks are
+ * removed afterwards and the function is renumbered in reverse postorder. */
+
+/* A source variable (one per declaration, so shadowing gets new ids).
+ * Structs are replaced by their fields: the fields of a struct variable
+ * are the variables right after it, in declaration order, and are not
+ * visible by name. */
+typedef struct {
+    const char* name;
+    CasmType type;
+    int array;                  /* Local array index, or -1 for a scalar */
+} LowerVar;
+
+/* Phi created in an unsealed block, completed when the block is sealed */
+typedef struct {
+    int block;
+    int var;
+    int phi;
+} IncompletePhi;
+
+typedef struct {
+    ASTProgram* program;
+    ASTFunctionDef* ast_func;
+    IrFunction* func;
+    int current;                /* Block receiving new instructions */
+
+    LowerVar* vars;
+    int var_count;
+    int var_capacity;
+
+    int* scope_vars;            /* Visible variable ids, innermost last */
+    int scope_var_count;
+    int scope_var_capacity;
+
+    int** defs;                 /* defs[block][var]: current value or -1 */
+    int* def_lengths;
+    int* sealed;
+    int block_state_capacity;
+
+    IncompletePhi* incomplete;
+    int incomplete_count;
+    int incomplete_capacity;
+
+    int break_target;           /* Block `break` jumps to in the innermost loop, or -1 */
+    int continue_target;        /* Block `continue` jumps to in the innermost loop, or -1 */
+} Lowerer;
+
+/* Forward declarations */
+static int lower_expression(Lowerer* l, ASTExpression* expr);
+static void lower_block(Lowerer* l, ASTBlock* block);
+
+/* Helper: Type arithmetic on a value of this type is performed in */
+static CasmType promote_type(CasmType type) {
+    switch (type) {
+        case TYPE_I8:
+        case TYPE_I16:
+        case TYPE_I32: return TYPE_I32;
+        case TYPE_U8:
+        case TYPE_U16:
+        case TYPE_U32: return TYPE_U32;
+        default:       return type;
+    }
+}
+
+/* Helper: Wrap a constant to the width of a type */
+static long long wrap_constant(long long value, CasmType type) {
+    switch (type) {
+        case TYPE_I8:  return (int8_t)(uint8_t)value;
+        case TYPE_I16: return (int16_t)(uint16_t)value;
+        case TYPE_I32: return (int32_t)(uint32_t)value;
+        case TYPE_U8:  return (uint8_t)value;
+        case TYPE_U16: return (uint16_t)value;
+        case TYPE_U32: return (uint32_t)value;
+        case TYPE_BOOL: return value != 0;
+        default:       return value;
+    }
+}
+
+/* Helper: Make sure per-block SSA state exists for every block */
+static void ensure_block_state(Lowerer* l) {
+    int needed = l->func->block_count;
+    if (needed <= l->block_state_capacity) return;
+
+    int capacity = l->block_state_capacity == 0 ? 16 : l->block_state_capacity;
+    while (capacity < needed) capacity *= 2;
+    l->defs = xrealloc(l->defs, capacity * sizeof(int*));
+    l->def_lengths = xrealloc(l->def_lengths, capacity * sizeof(int));
+    l->sealed = xrealloc(l->sealed, capacity * sizeof(int));
+    for (int i = l->block_state_capacity; i < capacity; i++) {
+        l->defs[i] = NULL;
+        l->def_lengths[i] = 0;
+        l->sealed[i] = 0;
+    }
+    l->block_state_capacity = capacity;
+}
+
+/* Helper: Create a block */
+static int new_block(Lowerer* l) {
+    int block = ir_add_block(l->func);
+    ensure_block_state(l);
+    return block;
+}
+
+/* Helper: Add a variable without making it visible by name */
+static int add_variable(Lowerer* l, const char* name, CasmType type) {
+    if (l->var_count >= l->var_capacity) {
+        l->var_capacity = (l->var_capacity == 0) ? 16 : l->var_capacity * 2;
+        l->vars = xrealloc(l->vars, l->var_capacity * sizeof(LowerVar));
+    }
+    l->vars[l->var_count].name = name;
+    l->vars[l->var_count].type = type;
+    l->vars[l->var_count].array = -1;
+    return l->var_count++;
+}
+
+/* Helper: Declare a variable in the innermost scope */
+static int declare_variable(Lowerer* l, const char* name, CasmType type) {
+    int var = add_variable(l, name, type);
+
+    if (l->scope_var_count >= l->scope_var_capacity) {
+        l->scope_var_capacity = (l->scope_var_capacity == 0) ? 16 : l->scope_var_capacity * 2;
+        l->scope_vars = xrealloc(l->scope_vars, l->scope_var_capacity * sizeof(int));
+    }
+    l->scope_vars[l->scope_var_count++] = var;
+    return var;
+}
+
+/* Helper: Declare a struct variable followed by its field variables;
+ * returns the struct's variable */
+static int declare_struct(Lowerer* l, const char* name, int struct_index) {
+    ASTStructDef* def = &l->program->structs[struct_index];
+    int var = declare_variable(l, name, TYPE_STRUCT);
+    for (int i = 0; i < def->field_count; i++) {
+        add_variable(l, def->fields[i].name, def->fields[i].type.type);
+    }
+    return var;
+}
+
+/* Helper: Find the innermost visible variable with this name */
+static int lookup_variable(Lowerer* l, const char* name) {
+    for (int i = l->scope_var_count - 1; i >= 0; i--) {
+        int var = l->scope_vars[i];
+        if (strcmp(l->vars[var].name, name) == 0) {
+            return var;
+        }
+    }
+    return -1;
+}
+
+static void write_variable(Lowerer* l, int var, int block, int value) {
+    if (var >= l->def_lengths[block]) {
+        int length = l->def_lengths[block] == 0 ? 8 : l->def_lengths[block];
+        while (length <= var) length *= 2;
+        l->defs[block] = xrealloc(l->defs[block], length * sizeof(int));
+        for (int i = l->def_lengths[block]; i < length; i++) {
+            l->defs[block][i] = -1;
+        }
+        l->def_lengths[block] = length;
+    }
+    l->defs[block][var] = value;
+}
+
+static int read_variable(Lowerer* l, int var, int block);
+
+/* Helper: Fill in a phi's arguments from each predecessor */
+static void add_phi_operands(Lowerer* l, int var, int phi) {
+    int block = l->func->values[phi].block;
+    for (int i = 0; i < l->func->blocks[block].pred_count; i++) {
+        int value = read_variable(l, var, l->func->blocks[block].preds[i]);
+        ir_add_arg(l->func, phi, value);
+    }
+}
+
+/* Helper: Look up a variable's value through the predecessors of a block */
+static int read_variable_recursive(Lowerer* l, int var, int block) {
+    int value;
+    IrBlock* b = &l->func->blocks[block];
+
+    if (!l->sealed[block]) {
+        value = ir_insert_phi(l->func, block, l->vars[var].type);
+        if (l->incomplete_count >= l->incomplete_capacity) {
+            l->incomplete_capacity = (l->incomplete_capacity == 0) ? 16 : l->incomplete_capacity * 2;
+            l->incomplete = xrealloc(l->incomplete, l->incomplete_capacity * sizeof(IncompletePhi));
+        }
+        l->incomplete[l->incomplete_count].block = block;
+        l->incomplete[l->incomplete_count].var = var;
+        l->incomplete[l->incomplete_count].phi = value;
+        l->incomplete_count++;
+    } else if (b->pred_count == 1) {
+        value = read_variable(l, var, b->preds[0]);
+    } else if (b->pred_count == 0) {
+        /* Entry or unreachable block: nothing was assigned on this path */
+        value = ir_emit(l->func, 0, IR_UNDEF, l->vars[var].type);
+    } else {
+        /* Write the phi first so loops through this block terminate */
+        value = ir_insert_phi(l->func, block, l->vars[var].type);
+        write_variable(l, var, block, value);
+        add_phi_operands(l, var, value);
+    }
+
+    write_variable(l, var, block, value);
+    return value;
+}
+
+static int read_variable(Lowerer* l, int var, int block) {
+    if (var < l->def_lengths[block] && l->defs[block][var] >= 0) {
+        return l->defs[block][var];
+    }
+    return read_variable_recursive(l, var, block);
+}
+
+/* Helper: Mark a block's predecessor list as final */
+static void seal_block(Lowerer* l, int block) {
+    for (int i = 0; i < l->incomplete_count; i++) {
+        if (l->incomplete[i].block == block) {
+            add_phi_operands(l, l->incomplete[i].var, l->incomplete[i].phi);
+            l->incomplete[i] = l->incomplete[--l->incomplete_count];
+            i--;
+        }
+    }
+    l->sealed[block] = 1;
+}
+
+/* Helper: Start emitting into a fresh block with no predecessors
+ * (code after a return); it is removed later if nothing reaches it */
+static void start_unreachable_block(Lowerer* l) {
+    l->current = new_block(l);
+    seal_block(l, l->current);
+}
+
+/* Helper: Convert a value to `type` (no-op if it already has it) */
+static int convert_value(Lowerer* l, int value, CasmType type) {
+    if (l->func->values[value].type == type) {
+        return value;
+    }
+    int conv = ir_emit(l->func, l->current, IR_CONV, type);
+    ir_add_arg(l->func, conv, value);
+    return conv;
+}
+
+/* Helper: Lower an expression and convert the result to `type`.
+ * Integer literals are materialized directly in the target type. */
+static int lower_expression_as(Lowerer* l, ASTExpression* expr, CasmType type) {
+    if (expr->type == EXPR_LITERAL && expr->as.literal.type == LITERAL_INT && is_numeric_type(type)) {
+        return ir_emit_const(l->func, l->current, type,
+                             wrap_constant(expr->as.literal.value.int_value, type));
+    }
+    return convert_value(l, lower_expression(l, expr), type);
+}
+
+/* Helper: Find the function a call resolves to, preferring the caller's module */
+static ASTFunctionDef* find_call_target(Lowerer* l, const char* name) {
+    ASTProgram* program = l->program;
+    ASTFunctionDef* fallback = NULL;
+    for (int i = 0; i < program->function_count; i++) {
+        ASTFunctionDef* func = &program->functions[i];
+        if (strcmp(func->name, name) != 0) continue;
+        if (program->import_count > 0 && !func->allocated_name) continue;
+        if (l->ast_func->module_path && func->module_path &&
+            strcmp(func->module_path, l->ast_func->module_path) == 0) {
+            return func;
+        }
+        if (!fallback) fallback = func;
+    }
+    return fallback;
+}
+
+/* Helper: Map an arithmetic/comparison operator to its opcode */
+static IrOpcode binop_to_opcode(BinaryOpType op) {
+    switch (op) {
+        case BINOP_ADD: return IR_ADD;
+        case BINOP_SUB: return IR_SUB;
+        case BINOP_MUL: return IR_MUL;
+        case BINOP_DIV: return IR_DIV;
+        case BINOP_MOD: return IR_MOD;
+        case BINOP_BIT_AND: return IR_AND;
+        case BINOP_BIT_OR:  return IR_OR;
+        case BINOP_BIT_XOR: return IR_XOR;
+        case BINOP_SHL: return IR_SHL;
+        case BINOP_SHR: return IR_SHR;
+        case BINOP_ROTL: return IR_ROTL;
+        case BINOP_ROTR: return IR_ROTR;
+        case BINOP_EQ:  return IR_EQ;
+        case BINOP_NE:  return IR_NE;
+        case BINOP_LT:  return IR_LT;
+        case BINOP_GT:  return IR_GT;
+        case BINOP_LE:  return IR_LE;
+        default:        return IR_GE;
+    }
+}
+
+/* Helper: Lower && / || with short-circuit control flow */
+static int lower_logical(Lowerer* l, ASTBinaryOp* binop) {
+    int left = convert_value(l, lower_expression(l, binop->left), TYPE_BOOL);
+    int rhs = new_block(l);
+    int merge = new_block(l);
+
+    /* The left value is the result on the short-circuit edge */
+    if (binop->op == BINOP_AND) {
+        ir_set_branch(l->func, l->current, left, rhs, merge);
+    } else {
+        ir_set_branch(l->func, l->current, left, merge, rhs);
+    }
+    seal_block(l, rhs);
+
+    l->current = rhs;
+    int right = convert_value(l, lower_expression(l, binop->right), TYPE_BOOL);
+    ir_set_jump(l->func, l->current, merge);
+    seal_block(l, merge);
+
+    l->current = merge;
+    int phi = ir_insert_phi(l->func, merge, TYPE_BOOL);
+    ir_add_arg(l->func, phi, left);
+    ir_add_arg(l->func, phi, right);
+    return phi;
+}
+
+/* Helper: Lower the array operand and index of `a[i]`, checking the
+ * bounds if the analysis could not prove them. Returns the index (i64)
+ * and sets *array_ref to the IR array operand. */
+static int lower_index(Lowerer* l, ASTIndexExpr* index, long long* array_ref) {
+    if (index->global_index >= 0) {
+        *array_ref = IR_GLOBAL_ARRAY(index->global_index);
+    } else {
+        int var = lookup_variable(l, index->array_name);
+        *array_ref = var >= 0 ? l->vars[var].array : 0;
+    }
+    int value = lower_expression_as(l, index->index, TYPE_I64);
+    if (index->bounds_checked) {
+        int check = ir_emit(l->func, l->current, IR_BOUNDS_CHECK, TYPE_VOID);
+        l->func->values[check].imm = *array_ref;
+        ir_add_arg(l->func, check, value);
+    }
+    return value;
+}
+
+/* Helper: Element type of an array operand */
+static CasmType array_element_type(Lowerer* l, long long array_ref) {
+    if (IR_IS_GLOBAL_ARRAY(array_ref)) {
+        return l->program->globals[IR_ARRAY_INDEX(array_ref)].decl.type.type;
+    }
+    return l->func->arrays[array_ref].elem_type;
+}
+
+/* Helper: The variable holding field `p.f`, or -1 */
+static int field_variable(Lowerer* l, ASTFieldExpr* field) {
+    int var = lookup_variable(l, field->object_name);
+    return var >= 0 ? var + 1 + field->field_index : -1;
+}
+
+static int lower_expression(Lowerer* l, ASTExpression* expr) {
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            if (expr->as.literal.type == LITERAL_BOOL) {
+                return ir_emit_const(l->func, l->current, TYPE_BOOL, expr->as.literal.value.bool_value ? 1 : 0);
+            }
+            return lower_expression_as(l, expr, promote_type(expr->resolved_type));
+
+        case EXPR_VARIABLE: {
+            int var = lookup_variable(l, expr->as.variable.name);
+            if (var < 0) {
+                return ir_emit(l->func, l->current, IR_UNDEF, expr->resolved_type);
+            }
+            return read_variable(l, var, l->current);
+        }
+
+        case EXPR_UNARY_OP: {
+            ASTUnaryOp* unop = &expr->as.unary_op;
+            if (unop->op == UNOP_NOT) {
+                int operand = convert_value(l, lower_expression(l, unop->operand), TYPE_BOOL);
+                int value = ir_emit(l->func, l->current, IR_NOT, TYPE_BOOL);
+                ir_add_arg(l->func, value, operand);
+                return value;
+            }
+            if (unop->op == UNOP_CAST) {
+                /* A single conv; constants are wrapped in place */
+                return lower_expression_as(l, unop->operand, expr->resolved_type);
+            }
+            if (unop->op == UNOP_POPCOUNT || unop->op == UNOP_CLZ || unop->op == UNOP_CTZ) {
+                /* Bit counts work on the operand's own width */
+                int operand = lower_expression_as(l, unop->operand, expr->resolved_type);
+                IrOpcode op = unop->op == UNOP_POPCOUNT ? IR_POPCOUNT :
+                              unop->op == UNOP_CLZ ? IR_CLZ : IR_CTZ;
+                int value = ir_emit(l->func, l->current, op, expr->resolved_type);
+                ir_add_arg(l->func, value, operand);
+                return value;
+            }
+            CasmType type = promote_type(expr->resolved_type);
+            int operand = lower_expression_as(l, unop->operand, type);
+            if (unop->op == UNOP_BIT_NOT) {
+                /* ~x is x ^ -1 */
+                int ones = ir_emit_const(l->func, l->current, type, wrap_constant(-1, type));
+                int value = ir_emit(l->func, l->current, IR_XOR, type);
+                ir_add_arg(l->func, value, operand);
+                ir_add_arg(l->func, value, ones);
+                return value;
+            }
+            int value = ir_emit(l->func, l->current, IR_NEG, type);
+            ir_add_arg(l->func, value, operand);
+            return value;
+        }
+
+        case EXPR_BINARY_OP: {
+            ASTBinaryOp* binop = &expr->as.binary_op;
+
+            if (binop->op == BINOP_ASSIGN && binop->left->type == EXPR_INDEX) {
+                long long array_ref;
+                int index = lower_index(l, &binop->left->as.index, &array_ref);
+                int value = lower_expression_as(l, binop->right, array_element_type(l, array_ref));
+                int store = ir_emit(l->func, l->current, IR_STORE, TYPE_VOID);
+                l->func->values[store].imm = array_ref;
+                ir_add_arg(l->func, store, index);
+                ir_add_arg(l->func, store, value);
+                return value;
+            }
+
+            if (binop->op == BINOP_ASSIGN && binop->left->type == EXPR_FIELD) {
+                int var = field_variable(l, &binop->left->as.field);
+                CasmType type = var >= 0 ? l->vars[var].type : binop->left->resolved_type;
+                int value = lower_expression_as(l, binop->right, type);
+                if (var >= 0) {
+                    write_variable(l, var, l->current, value);
+                }
+                return value;
+            }
+
+            if (binop->op == BINOP_ASSIGN) {
+                int var = lookup_variable(l, binop->left->as.variable.name);
+                CasmType type = var >= 0 ? l->vars[var].type : binop->left->resolved_type;
+                int value = lower_expression_as(l, binop->right, type);
+                if (var >= 0) {
+                    write_variable(l, var, l->current, value);
+                }
+                return value;
+            }
+
+            if (binop->op == BINOP_AND || binop->op == BINOP_OR) {
+                return lower_logical(l, binop);
+            }
+
+            CasmType operand_type;
+            CasmType result_type;
+            if (binop->op >= BINOP_EQ && binop->op <= BINOP_GE) {
+                CasmType lt = binop->left->resolved_type;
+                CasmType rt = binop->right->resolved_type;
+                operand_type = (lt == TYPE_BOOL && rt == TYPE_BOOL)
+                    ? TYPE_BOOL
+                    : promote_type(get_binary_op_result_type(lt, BINOP_ADD, rt));
+                result_type = TYPE_BOOL;
+            } else if (binop->op == BINOP_ROTL || binop->op == BINOP_ROTR) {
+                /* Rotates work on the operand's own width */
+                operand_type = expr->resolved_type;
+                result_type = operand_type;
+            } else {
+                operand_type = promote_type(expr->resolved_type);
+                result_type = operand_type;
+            }
+
+            int left = lower_expression_as(l, binop->left, operand_type);
+            int right = lower_expression_as(l, binop->right, operand_type);
+            int value = ir_emit(l->func, l->current, binop_to_opcode(binop->op), result_type);
+            ir_add_arg(l->func, value, left);
+            ir_add_arg(l->func, value, right);
+            return value;
+        }
+
+        case EXPR_FUNCTION_CALL: {
+            ASTFunctionCall* call = &expr->as.function_call;
+            ASTFunctionDef* target = find_call_target(l, call->function_name);
+
+            /* A struct argument is passed as its fields, which is safe
+             * because struct parameters are read-only */
+            int arg_count = 0;
+            for (int i = 0; i < call->argument_count; i++) {
+                ASTExpression* arg = &call->arguments[i];
+                arg_count += arg->resolved_type == TYPE_STRUCT
+                    ? l->program->structs[arg->as.variable.struct_index].field_count : 1;
+            }
+            int* args = xmalloc((arg_count + 1) * sizeof(int));
+            int next = 0;
+            for (int i = 0; i < call->argument_count; i++) {
+                ASTExpression* arg = &call->arguments[i];
+                if (arg->resolved_type == TYPE_STRUCT) {
+                    int var = lookup_variable(l, arg->as.variable.name);
+                    ASTStructDef* def = &l->program->structs[arg->as.variable.struct_index];
+                    for (int f = 0; f < def->field_count; f++) {
+                        args[next++] = var >= 0
+                            ? read_variable(l, var + 1 + f, l->current)
+                            : ir_emit(l->func, l->current, IR_UNDEF, def->fields[f].type.type);
+                    }
+                    continue;
+                }
+                CasmType param_type = (target && i < target->parameter_count)
+                    ? target->parameters[i].type.type
+                    : arg->resolved_type;
+                args[next++] = lower_expression_as(l, arg, param_type);
+            }
+
+            CasmType return_type = target ? target->return_type.type : expr->resolved_type;
+            int value = ir_emit(l->func, l->current, IR_CALL, return_type);
+            const char* callee = (target && target->allocated_name) ? target->allocated_name : call->function_name;
+            l->func->values[value].callee = xstrdup(callee);
+            for (int i = 0; i < arg_count; i++) {
+                ir_add_arg(l->func, value, args[i]);
+            }
+            xfree(args);
+            return value;
+        }
+
+        case EXPR_INDEX: {
+            long long array_ref;
+            int index = lower_index(l, &expr->as.index, &array_ref);
+            int value = ir_emit(l->func, l->current, IR_LOAD, array_element_type(l, array_ref));
+            l->func->values[value].imm = array_ref;
+            ir_add_arg(l->func, value, index);
+            return value;
+        }
+
+        case EXPR_FIELD: {
+            int var = field_variable(l, &expr->as.field);
+            if (var < 0) {
+                return ir_emit(l->func, l->current, IR_UNDEF, expr->resolved_type);
+            }
+            return read_variable(l, var, l->current);
+        }
+    }
+    return ir_emit(l->func, l->current, IR_UNDEF, TYPE_I32);
+}
+
+/* Helper: Describe an array declaration as an IrArray named `name` */
+static IrArray describe_array(const ASTVarDecl* decl, char* name) {
+    IrArray array;
+    array.name = name;
+    array.elem_type = decl->type.type;
+    array.length = decl->array_length;
+    array.init_count = decl->element_count;
+    array.init = xmalloc((decl->element_count + 1) * sizeof(long long));
+    for (int i = 0; i < decl->element_count; i++) {
+        array.init[i] = wrap_constant(decl->elements[i], decl->type.type);
+    }
+    return array;
+}
+
+/* Helper: Add a local array to the function being lowered */
+static int add_local_array(IrFunction* func, ASTVarDecl* decl) {
+    IrArray array = describe_array(decl, decl->name);
+    int index = ir_function_add_array(func, &array);
+    xfree(array.init);
+    return index;
+}
+
+/* Helper: Lower an if/else-if/else chain starting at (cond, then_body) */
+static void lower_if_chain(Lowerer* l, ASTExpression* cond, ASTBlock* then_body,
+                           ASTElseIfClause* else_if, ASTBlock* else_body, int merge) {
+    int value = convert_value(l, lower_expression(l, cond), TYPE_BOOL);
+    int then_block = new_block(l);
+    int else_block = (else_if || else_body) ? new_block(l) : merge;
+    ir_set_branch(l->func, l->current, value, then_block, else_block);
+    seal_block(l, then_block);
+
+    l->current = then_block;
+    lower_block(l, then_body);
+    if (l->func->blocks[l->current].term.kind == IR_TERM_NONE) {
+        ir_set_jump(l->func, l->current, merge);
+    }
+
+    if (else_block == merge) return;
+    seal_block(l, else_block);
+    l->current = else_block;
+    if (else_if) {
+        lower_if_chain(l, else_if->condition, &else_if->body, else_if->next, else_body, merge);
+    } else {
+        lower_block(l, else_body);
+        if (l->func->blocks[l->current].term.kind == IR_TERM_NONE) {
+            ir_set_jump(l->func, l->current, merge);
+        }
+    }
+}
+
+/* Helper: Lower a loop: header evaluates `cond`, body runs then `update` */
+static void lower_loop(Lowerer* l, ASTExpression* cond, ASTBlock* body, ASTExpression* update) {
+    int header = new_block(l);
+    ir_set_jump(l->func, l->current, header);
+    l->current = header;
+
+    int body_block = new_block(l);
+    int exit_block = new_block(l);
+    if (cond) {
+        int value = convert_value(l, lower_expression(l, cond), TYPE_BOOL);
+        ir_set_branch(l->func, l->current, value, body_block, exit_block);
+    } else {
+        ir_set_jump(l->func, l->current, body_block);
+    }
+    seal_block(l, body_block);
+
+    /* `continue` in a for loop still runs the update, so it gets a block
+     * of its own when the body continues */
+    int latch = update && ast_block_exits_loop(body, STMT_CONTINUE) ? new_block(l) : -1;
+    int saved_break = l->break_target;
+    int saved_continue = l->continue_target;
+    l->break_target = exit_block;
+    l->continue_target = latch >= 0 ? latch : header;
+
+    l->current = body_block;
+    lower_block(l, body);
+    l->break_target = saved_break;
+    l->continue_target = saved_continue;
+    if (latch >= 0) {
+        if (l->func->blocks[l->current].term.kind == IR_TERM_NONE) {
+            ir_set_jump(l->func, l->current, latch);
+        }
+        seal_block(l, latch);
+        l->current = latch;
+    }
+    if (l->func->blocks[l->current].term.kind == IR_TERM_NONE) {
+        if (update) {
+            lower_expression(l, update);
+        }
+        ir_set_jump(l->func, l->current, header);
+    }
+    seal_block(l, header);
+    seal_block(l, exit_block);
+    l->current = exit_block;
+}
+
+static void lower_statement(Lowerer* l, ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN: {
+            int value = -1;
+            if (stmt->as.return_stmt.value) {
+                value = lower_expression_as(l, stmt->as.return_stmt.value, l->func->return_type);
+            }
+            ir_set_return(l->func, l->current, value);
+            start_unreachable_block(l);
+            break;
+        }
+
+        case STMT_EXPR:
+            lower_expression(l, stmt->as.expr_stmt.expr);
+            break;
+
+        case STMT_VAR_DECL: {
+            ASTVarDecl* decl = &stmt->as.var_decl_stmt.var_decl;
+            if (decl->array_length > 0) {
+                /* Arrays live in memory; the declaration (re)initializes
+                 * it each time it is reached */
+                int var = declare_variable(l, decl->name, decl->type.type);
+                l->vars[var].array = add_local_array(l->func, decl);
+                int init = ir_emit(l->func, l->current, IR_ARRAY_INIT, TYPE_VOID);
+                l->func->values[init].imm = l->vars[var].array;
+                break;
+            }
+            if (decl->type.type == TYPE_STRUCT) {
+                /* Each declaration resets every field */
+                ASTStructDef* def = &l->program->structs[decl->struct_index];
+                int var = declare_struct(l, decl->name, decl->struct_index);
+                for (int i = 0; i < def->field_count; i++) {
+                    CasmType type = def->fields[i].type.type;
+                    long long init = i < decl->element_count ? wrap_constant(decl->elements[i], type) : 0;
+                    write_variable(l, var + 1 + i, l->current, ir_emit_const(l->func, l->current, type, init));
+                }
+                break;
+            }
+            int value = -1;
+            if (decl->initializer) {
+                value = lower_expression_as(l, decl->initializer, decl->type.type);
+            }
+            int var = declare_variable(l, decl->name, decl->type.type);
+            if (value >= 0) {
+                write_variable(l, var, l->current, value);
+            }
+            break;
+        }
+
+        case STMT_IF: {
+            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            int merge = new_block(l);
+            lower_if_chain(l, if_stmt->condition, &if_stmt->then_body,
+                           if_stmt->else_if_chain, if_stmt->else_body, merge);
+            seal_block(l, merge);
+            l->current = merge;
+            break;
+        }
+
+        case STMT_WHILE:
+            lower_loop(l, stmt->as.while_stmt.condition, &stmt->as.while_stmt.body, NULL);
+            break;
+
+        case STMT_FOR: {
+            int saved_scope = l->scope_var_count;
+            if (stmt->as.for_stmt.init) {
+                lower_statement(l, stmt->as.for_stmt.init);
+            }
+            lower_loop(l, stmt->as.for_stmt.condition, &stmt->as.for_stmt.body,
+                       stmt->as.for_stmt.update);
+            l->scope_var_count = saved_scope;
+            break;
+        }
+
+        case STMT_BLOCK:
+            lower_block(l, &stmt->as.block_stmt.block);
+            break;
+
+        case STMT_DBG: {
+            ASTDbgStmt* dbg = &stmt->as.dbg_stmt;
+            int* args = xmalloc((dbg->argument_count + 1) * sizeof(int));
+            for (int i = 0; i < dbg->argument_count; i++) {
+                args[i] = lower_expression(l, &dbg->arguments[i]);
+            }
+            int value = ir_emit(l->func, l->current, IR_DBG, TYPE_VOID);
+            l->func->values[value].dbg = dbg;
+            for (int i = 0; i < dbg->argument_count; i++) {
+                ir_add_arg(l->func, value, args[i]);
+            }
+            xfree(args);
+            break;
+        }
+
+        case STMT_BREAK:
+            ir_set_jump(l->func, l->current, l->break_target);
+            start_unreachable_block(l);
+            break;
+
+        case STMT_CONTINUE:
+            ir_set_jump(l->func, l->current, l->continue_target);
+            start_unreachable_block(l);
+            break;
+    }
+}
+
+static void lower_block(Lowerer* l, ASTBlock* block) {
+    int saved_scope = l->scope_var_count;
+    for (int i = 0; i < block->statement_count; i++) {
+        lower_statement(l, &block->statements[i]);
+    }
+    l->scope_var_count = saved_scope;
+}
+
+/* Helper: Follow phi replacements to the final value */
+static int resolve_value(const IrFunction* func, int value) {
+    while (func->values[value].replaced_by >= 0) {
+        value = func->values[value].replaced_by;
+    }
+    return value;
+}
+
+/* Helper: Compute reverse postorder of reachable blocks. Returns the count. */
+static int compute_rpo(const IrFunction* func, int* order) {
+    int* state = xmalloc(func->block_count * sizeof(int));   /* 0 new, 1 open, 2 done */
+    int* stack = xmalloc((func->block_count + 1) * sizeof(int));
+    int* post = xmalloc(func->block_count * sizeof(int));
+    int post_count = 0;
+    memset(state, 0, func->block_count * sizeof(int));
+
+    int depth = 0;
+    stack[depth++] = 0;
+    state[0] = 1;
+    while (depth > 0) {
+        int block = stack[depth - 1];
+        int succ[2];
+        int count = ir_block_successors(&func->blocks[block], succ);
+        int pushed = 0;
+        /* Visit the false/second successor first so the true arm comes
+         * first in reverse postorder */
+        for (int i = count - 1; i >= 0; i--) {
+            if (state[succ[i]] == 0) {
+                state[succ[i]] = 1;
+                stack[depth++] = succ[i];
+                pushed = 1;
+                break;
+            }
+        }
+        if (!pushed) {
+            state[block] = 2;
+            post[post_count++] = block;
+            depth--;
+        }
+    }
+
+    for (int i = 0; i < post_count; i++) {
+        order[i] = post[post_count - 1 - i];
+    }
+    xfree(post);
+    xfree(stack);
+    xfree(state);
+    return post_count;
+}
+
+/* Helper: Remove unreachable blocks, fold trivial phis and renumber
+ * blocks (reverse postorder) and values (block order) */
+static IrFunction* finalize_function(IrFunction* func) {
+    int* order = xmalloc(func->block_count * sizeof(int));
+    int reachable_count = compute_rpo(func, order);
+    int* block_map = xmalloc(func->block_count * sizeof(int));
+    for (int i = 0; i < func->block_count; i++) block_map[i] = -1;
+    for (int i = 0; i < reachable_count; i++) block_map[order[i]] = i;
+
+    /* Drop edges from unreachable predecessors (and the matching phi args) */
+    for (int i = 0; i < reachable_count; i++) {
+        IrBlock* block = &func->blocks[order[i]];
+        int kept = 0;
+        for (int p = 0; p < block->pred_count; p++) {
+            if (block_map[block->preds[p]] < 0) continue;
+            for (int k = 0; k < block->instr_count; k++) {
+                IrInstr* instr = &func->values[block->instrs[k]];
+                if (instr->op != IR_PHI) break;
+                instr->args[kept] = instr->args[p];
+            }
+            block->preds[kept++] = block->preds[p];
+        }
+        block->pred_count = kept;
+        for (int k = 0; k < block->instr_count; k++) {
+            IrInstr* instr = &func->values[block->instrs[k]];
+            if (instr->op != IR_PHI) break;
+            instr->arg_count = kept;
+        }
+    }
+
+    /* Replace phis whose arguments are all the same value (or the phi itself) */
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < reachable_count; i++) {
+            IrBlock* block = &func->blocks[order[i]];
+            for (int k = 0; k < block->instr_count; k++) {
+                int id = block->instrs[k];
+                IrInstr* instr = &func->values[id];
+                if (instr->op != IR_PHI) break;
+                if (instr->replaced_by >= 0) continue;
+
+                int same = -1;
+                int trivial = 1;
+                for (int a = 0; a < instr->arg_count; a++) {
+                    int arg = resolve_value(func, instr->args[a]);
+                    if (arg == id || arg == same) continue;
+                    if (same >= 0) {
+                        trivial = 0;
+                        break;
+                    }
+                    same = arg;
+                }
+                if (trivial && same >= 0) {
+                    func->values[id].replaced_by = same;
+                    changed = 1;
+                }
+            }
+        }
+    }
+
+    /* Undefs are only created for reads on paths that turned out to be
+     * unreachable or were folded away; drop the ones nothing uses */
+    int* uses = xmalloc((func->value_count + 1) * sizeof(int));
+    memset(uses, 0, (func->value_count + 1) * sizeof(int));
+    for (int i = 0; i < reachable_count; i++) {
+        IrBlock* block = &func->blocks[order[i]];
+        for (int k = 0; k < block->instr_count; k++) {
+            IrInstr* instr = &func->values[block->instrs[k]];
+            if (instr->replaced_by >= 0) continue;
+            for (int a = 0; a < instr->arg_count; a++) {
+                uses[resolve_value(func, instr->args[a])]++;
+            }
+        }
+        if (block->term.value >= 0) {
+            uses[resolve_value(func, block->term.value)]++;
+        }
+    }
+
+    /* Build the renumbered function */
+    IrFunction* result = ir_function_create(func->name, func->return_type);
+    for (int i = 0; i < func->param_count; i++) {
+        ir_function_add_param(result, func->param_types[i]);
+        result->param_origins[i] = func->param_origins[i];
+    }
+    for (int i = 0; i < func->array_count; i++) {
+        ir_function_add_array(result, &func->arrays[i]);
+    }
+    for (int i = 0; i < reachable_count; i++) {
+        ir_add_block(result);
+    }
+
+    int* value_map = xmalloc((func->value_count + 1) * sizeof(int));
+    for (int i = 0; i < func->value_count; i++) value_map[i] = -1;
+
+    /* First pass: assign new ids in block order */
+    for (int i = 0; i < reachable_count; i++) {
+        IrBlock* block = &func->blocks[order[i]];
+        for (int k = 0; k < block->instr_count; k++) {
+            int id = block->instrs[k];
+            if (func->values[id].replaced_by >= 0) continue;
+            if (func->values[id].op == IR_UNDEF && uses[id] == 0) continue;
+            IrInstr* src = &func->values[id];
+            int new_id = src->op == IR_PHI ? ir_insert_phi(result, i, src->type)
+                                           : ir_emit(result, i, src->op, src->type);
+            value_map[id] = new_id;
+        }
+    }
+
+    /* Second pass: copy operands, terminators and predecessor lists */
+    for (int i = 0; i < reachable_count; i++) {
+        IrBlock* src_block = &func->blocks[order[i]];
+        IrBlock* dst_block = &result->blocks[i];
+
+        for (int k = 0; k < src_block->instr_count; k++) {
+            int id = src_block->instrs[k];
+            if (value_map[id] < 0) continue;
+            IrInstr* src = &func->values[id];
+            IrInstr* dst = &result->values[value_map[id]];
+            dst->imm = src->imm;
+            dst->dbg = src->dbg;
+            dst->callee = src->callee ? xstrdup(src->callee) : NULL;
+            for (int a = 0; a < src->arg_count; a++) {
+                ir_add_arg(result, value_map[id], value_map[resolve_value(func, src->args[a])]);
+            }
+        }
+
+        for (int p = 0; p < src_block->pred_count; p++) {
+            int pred = block_map[src_block->preds[p]];
+            if (dst_block->pred_count >= dst_block->pred_capacity) {
+                dst_block->pred_capacity = dst_block->pred_capacity == 0 ? 4 : dst_block->pred_capacity * 2;
+                dst_block->preds = xrealloc(dst_block->preds, dst_block->pred_capacity * sizeof(int));
+            }
+            dst_block->preds[dst_block->pred_count++] = pred;
+        }
+
+        dst_block->term = src_block->term;
+        if (dst_block->term.value >= 0) {
+            dst_block->term.value = value_map[resolve_value(func, dst_block->term.value)];
+        }
+        for (int t = 0; t < 2; t++) {
+            if (dst_block->term.targets[t] >= 0) {
+                dst_block->term.targets[t] = block_map[dst_block->term.targets[t]];
+            }
+        }
+    }
+
+    xfree(value_map);
+    xfree(uses);
+    xfree(block_map);
+    xfree(order);
+    ir_function_free(func);
+    return result;
+}
+
+/* Helper: Lower one function definition */
+static IrFunction* lower_function(ASTProgram* program, ASTFunctionDef* ast_func) {
+    Lowerer l;
+    memset(&l, 0, sizeof(Lowerer));
+    l.program = program;
+    l.ast_func = ast_func;
+    l.break_target = -1;
+    l.continue_target = -1;
+
+    const char* name = ast_func->allocated_name ? ast_func->allocated_name : ast_func->name;
+    l.func = ir_function_create(name, ast_func->return_type.type);
+
+    l.current = new_block(&l);
+    seal_block(&l, l.current);
+
+    for (int i = 0; i < ast_func->parameter_count; i++) {
+        ASTParameter* param = &ast_func->parameters[i];
+        if (param->type.type == TYPE_STRUCT) {
+            /* One IR parameter per field; the origins let a backend pass
+             * the struct by address instead */
+            ASTStructDef* def = &program->structs[param->struct_index];
+            int var = declare_struct(&l, param->name, param->struct_index);
+            for (int f = 0; f < def->field_count; f++) {
+                CasmType type = def->fields[f].type.type;
+                int value = ir_emit(l.func, l.current, IR_PARAM, type);
+                l.func->values[value].imm = l.func->param_count;
+                ir_function_add_param(l.func, type);
+                l.func->param_origins[l.func->param_count - 1].struct_index = param->struct_index;
+                l.func->param_origins[l.func->param_count - 1].field = f;
+                write_variable(&l, var + 1 + f, l.current, value);
+            }
+            continue;
+        }
+        CasmType type = param->type.type;
+        int value = ir_emit(l.func, l.current, IR_PARAM, type);
+        l.func->values[value].imm = l.func->param_count;
+        ir_function_add_param(l.func, type);
+        int var = declare_variable(&l, param->name, type);
+        write_variable(&l, var, l.current, value);
+    }
+
+    lower_block(&l, &ast_func->body);
+
+    /* Falling off the end returns from a void function; anything else
+     * is unreachable by construction */
+    if (l.func->blocks[l.current].term.kind == IR_TERM_NONE) {
+        if (l.func->return_type == TYPE_VOID) {
+            ir_set_return(l.func, l.current, -1);
+        } else {
+            ir_set_unreachable(l.func, l.current);
+        }
+    }
+
+    /* Blocks are only left open when unreachable; close them too */
+    for (int i = 0; i < l.func->block_count; i++) {
+        if (l.func->blocks[i].term.kind == IR_TERM_NONE) {
+            ir_set_unreachable(l.func, i);
+        }
+    }
+
+    for (int i = 0; i < l.block_state_capacity; i++) {
+        xfree(l.defs[i]);
+    }
+    xfree(l.defs);
+    xfree(l.def_lengths);
+    xfree(l.sealed);
+    xfree(l.incomplete);
+    xfree(l.scope_vars);
+    xfree(l.vars);
+
+    return finalize_function(l.func);
+}
+
+IrModule* ir_lower_program(ASTProgram* program) {
+    IrModule* module = ir_module_create();
+    module->structs = program->structs;
+    module->struct_count = program->struct_count;
+    for (int i = 0; i < program->global_count; i++) {
+        ASTGlobalVar* global = &program->globals[i];
+        IrArray array = describe_array(&global->decl,
+                                       global->allocated_name ? global->allocated_name : global->decl.name);
+        if (array.length == 0) {
+            /* A scalar global is the one-element array its uses index */
+            array.length = 1;
+        }
+        ir_module_add_global(module, &array);
+        xfree(array.init);
+    }
+    for (int i = 0; i < program->function_count; i++) {
+        ASTFunctionDef* func = &program->functions[i];
+        if (program->import_count > 0 && !func->allocated_name) {
+            continue;
+        }
+        ir_module_add_function(module, lower_function(program, func));
+    }
+    return module;
+}
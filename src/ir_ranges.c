@@ -0,0 +1,393 @@
+#include <limits.h>
+#include <string.h>
+#include "ir.h"
+#include "types.h"
+#include "utils.h"
+
+/* Interval analysis over the SSA values of a function.
+ *
+ * Every value gets one [min, max] range of the values it can hold. Where
+ * a value is used, the range is narrowed by the branch conditions on the
+ * way from its definition: a use in a block entered only through the true
+ * edge of `i < n` sees i below n's maximum. Conversions that widen without
+ * changing a value are looked through, so `conv u32 %i < ...` bounds %i.
+ *
+ * Blocks are visited in reverse postorder until nothing changes. A phi
+ * still growing after a few rounds is widened to its type's range, then a
+ * couple of narrowing rounds recompute every value from its operands to
+ * win back bounds the conditions imply.
+ *
+ * Ranges are kept in signed 64-bit bounds, so u64 values above INT64_MAX
+ * are never tracked; results that cannot be bounded become unknown. */
+
+#define WIDEN_AFTER 3
+#define NARROW_ROUNDS 2
+
+typedef struct {
+    long long min;
+    long long max;
+} Range;
+
+/* Range of a 64-bit value nothing is known about */
+static const Range FULL = { LLONG_MIN, LLONG_MAX };
+
+struct IrRanges {
+    const IrFunction* func;
+    Range* ranges;          /* Per value */
+    int* reached;           /* Per value: 0 until its range was computed */
+    int* changes;           /* Per value: times a phi's range grew */
+    int* rpo;
+    int* rpo_index;
+    int* idom;
+    int rpo_count;
+};
+
+static int is_full(Range r) {
+    return r.min == LLONG_MIN || r.max == LLONG_MAX;
+}
+
+static Range make_range(long long min, long long max) {
+    Range r;
+    r.min = min;
+    r.max = max;
+    return r;
+}
+
+static int range_within(Range inner, Range outer) {
+    return inner.min >= outer.min && inner.max <= outer.max;
+}
+
+static Range range_union(Range a, Range b) {
+    return make_range(a.min < b.min ? a.min : b.min, a.max > b.max ? a.max : b.max);
+}
+
+/* Helper: Every value a type can hold (unknown for 64-bit types) */
+static Range type_range(CasmType type) {
+    if (type == TYPE_BOOL) return make_range(0, 1);
+    int bits = get_type_size_bits(type);
+    if (bits < 0 || bits >= 64) return FULL;
+    if (type >= TYPE_I8 && type <= TYPE_I64) {
+        return make_range(-(1LL << (bits - 1)), (1LL << (bits - 1)) - 1);
+    }
+    return make_range(0, (1LL << bits) - 1);
+}
+
+/* Helper: Bounds a computed value of a type must stay within to be known
+ * not to have wrapped; u64 is limited to what the bounds can express */
+static Range value_domain(CasmType type) {
+    if (type == TYPE_U64) return make_range(0, LLONG_MAX);
+    return type_range(type);
+}
+
+/* Helper: A computed range, or the whole type if it may have wrapped */
+static Range clamp_to_type(Range r, CasmType type) {
+    return !is_full(r) && range_within(r, value_domain(type)) ? r : type_range(type);
+}
+
+/* Helper: Bounds small enough that sums cannot overflow */
+static int is_small(Range r) {
+    return r.min >= -(1LL << 32) && r.max <= (1LL << 32);
+}
+
+/* Helper: Bounds small enough that products cannot overflow */
+static int is_tiny(Range r) {
+    return r.min >= -(1LL << 31) && r.max <= (1LL << 31);
+}
+
+/* Helper: Check if `side` is `value`, or a conversion of it that keeps
+ * every value it can hold */
+static int is_value_or_widening(const IrFunction* func, int side, int value) {
+    if (side == value) return 1;
+    const IrInstr* conv = &func->values[side];
+    if (conv->op != IR_CONV || conv->args[0] != value) return 0;
+    Range from = type_range(func->values[value].type);
+    return !is_full(from) && range_within(from, value_domain(conv->type));
+}
+
+static IrOpcode negate_comparison(IrOpcode op) {
+    switch (op) {
+        case IR_LT: return IR_GE;
+        case IR_LE: return IR_GT;
+        case IR_GT: return IR_LE;
+        case IR_GE: return IR_LT;
+        case IR_EQ: return IR_NE;
+        default:    return IR_EQ;
+    }
+}
+
+static IrOpcode mirror_comparison(IrOpcode op) {
+    switch (op) {
+        case IR_LT: return IR_GT;
+        case IR_LE: return IR_GE;
+        case IR_GT: return IR_LT;
+        case IR_GE: return IR_LE;
+        default:    return op;
+    }
+}
+
+/* Helper: Narrow `r` by `x op bound` holding. A condition no value in
+ * `r` satisfies (only possible in dead code) leaves it alone. */
+static Range restrict_range(Range r, IrOpcode op, Range bound) {
+    Range out = r;
+    switch (op) {
+        case IR_LT:
+            if (bound.max != LLONG_MIN && bound.max - 1 < out.max) out.max = bound.max - 1;
+            break;
+        case IR_LE:
+            if (bound.max < out.max) out.max = bound.max;
+            break;
+        case IR_GT:
+            if (bound.min != LLONG_MAX && bound.min + 1 > out.min) out.min = bound.min + 1;
+            break;
+        case IR_GE:
+            if (bound.min > out.min) out.min = bound.min;
+            break;
+        case IR_EQ:
+            if (bound.min > out.min) out.min = bound.min;
+            if (bound.max < out.max) out.max = bound.max;
+            break;
+        case IR_NE:
+            if (bound.min == bound.max && bound.min == out.min && out.min != LLONG_MAX) out.min++;
+            else if (bound.min == bound.max && bound.max == out.max && out.max != LLONG_MIN) out.max--;
+            break;
+        default:
+            break;
+    }
+    return out.min <= out.max ? out : r;
+}
+
+/* Helper: Narrow the range of `value` by branch condition `cond` having
+ * the given truth */
+static Range apply_condition(const IrRanges* f, Range r, int value, int cond, int truth) {
+    const IrFunction* func = f->func;
+    const IrInstr* c = &func->values[cond];
+    while (c->op == IR_NOT) {
+        truth = !truth;
+        c = &func->values[c->args[0]];
+    }
+    if (c->op < IR_EQ || c->op > IR_GE) return r;
+
+    IrOpcode op = truth ? c->op : negate_comparison(c->op);
+    int left = c->args[0];
+    int right = c->args[1];
+    if (is_value_or_widening(func, left, value) && f->reached[right]) {
+        return restrict_range(r, op, f->ranges[right]);
+    }
+    if (is_value_or_widening(func, right, value) && f->reached[left]) {
+        return restrict_range(r, mirror_comparison(op), f->ranges[left]);
+    }
+    return r;
+}
+
+/* Helper: Narrow the range of `value` by the edge from `pred` to `block`,
+ * if `pred` branches */
+static Range apply_edge(const IrRanges* f, Range r, int value, int pred, int block) {
+    const IrTerminator* term = &f->func->blocks[pred].term;
+    if (term->kind != IR_TERM_BRANCH || term->targets[0] == term->targets[1]) return r;
+    return apply_condition(f, r, value, term->value, term->targets[0] == block);
+}
+
+/* Helper: Range of `value` where `block` uses it: its own range narrowed
+ * by the conditions guarding the blocks between its definition and
+ * `block` in the dominator tree */
+static Range range_at(const IrRanges* f, int value, int block) {
+    const IrFunction* func = f->func;
+    Range r = f->ranges[value];
+    int def_block = func->values[value].block;
+    for (int b = block; b != def_block && b > 0; b = f->idom[b]) {
+        const IrBlock* entered = &func->blocks[b];
+        if (entered->pred_count == 1) {
+            r = apply_edge(f, r, value, entered->preds[0], b);
+        }
+    }
+    return r;
+}
+
+/* Helper: Range of a binary arithmetic instruction */
+static Range eval_arithmetic(IrOpcode op, Range a, Range b, CasmType type) {
+    Range unknown = type_range(type);
+    if (is_full(a) || is_full(b) || !is_small(a) || !is_small(b)) return unknown;
+
+    switch (op) {
+        case IR_ADD:
+            return clamp_to_type(make_range(a.min + b.min, a.max + b.max), type);
+        case IR_SUB:
+            return clamp_to_type(make_range(a.min - b.max, a.max - b.min), type);
+        case IR_MUL: {
+            if (!is_tiny(a) || !is_tiny(b)) return unknown;
+            long long corners[4] = { a.min * b.min, a.min * b.max, a.max * b.min, a.max * b.max };
+            Range r = make_range(corners[0], corners[0]);
+            for (int i = 1; i < 4; i++) r = range_union(r, make_range(corners[i], corners[i]));
+            return clamp_to_type(r, type);
+        }
+        case IR_DIV: {
+            /* Quotients are extreme at the corners when 0 is not a divisor */
+            if (b.min <= 0 && b.max >= 0) return unknown;
+            long long corners[4] = { a.min / b.min, a.min / b.max, a.max / b.min, a.max / b.max };
+            Range r = make_range(corners[0], corners[0]);
+            for (int i = 1; i < 4; i++) r = range_union(r, make_range(corners[i], corners[i]));
+            return clamp_to_type(r, type);
+        }
+        case IR_MOD: {
+            /* |a % b| < |b|, with the sign of a */
+            long long limit = b.max > -b.min ? b.max : -b.min;
+            if (limit == 0) return unknown;
+            Range r = make_range(a.min < 0 ? -(limit - 1) : 0, a.max > 0 ? limit - 1 : 0);
+            if (a.min >= 0 && a.max < limit) r = a;
+            return clamp_to_type(r, type);
+        }
+        default:
+            return unknown;
+    }
+}
+
+/* Helper: Compute the range of a non-phi instruction from its operands
+ * as seen in its block. Returns 0 while an operand has no range yet. */
+static int eval_instr(const IrRanges* f, int value, Range* out) {
+    const IrInstr* instr = &f->func->values[value];
+    Range args[2] = { FULL, FULL };
+    for (int i = 0; i < instr->arg_count && i < 2; i++) {
+        if (!f->reached[instr->args[i]]) return 0;
+        args[i] = range_at(f, instr->args[i], instr->block);
+    }
+    Range a = args[0];
+    Range b = args[1];
+    CasmType type = instr->type;
+
+    switch (instr->op) {
+        case IR_CONST:
+            *out = type == TYPE_U64 && instr->imm < 0 ? FULL : make_range(instr->imm, instr->imm);
+            return 1;
+        case IR_CONV:
+            if (type == TYPE_BOOL) {
+                if (a.min > 0 || a.max < 0) *out = make_range(1, 1);
+                else if (a.min == 0 && a.max == 0) *out = make_range(0, 0);
+                else *out = make_range(0, 1);
+                return 1;
+            }
+            *out = !is_full(a) && range_within(a, type_range(type)) && range_within(a, value_domain(type)) ?
+                a : type_range(type);
+            return 1;
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_DIV:
+        case IR_MOD:
+            *out = eval_arithmetic(instr->op, a, b, type);
+            return 1;
+        case IR_AND:
+            /* Masking with a non-negative value bounds the result by it */
+            if (!is_full(a) && !is_full(b) && a.min >= 0 && b.min >= 0) {
+                *out = make_range(0, a.max < b.max ? a.max : b.max);
+            } else if (!is_full(a) && a.min >= 0) {
+                *out = make_range(0, a.max);
+            } else if (!is_full(b) && b.min >= 0) {
+                *out = make_range(0, b.max);
+            } else {
+                *out = type_range(type);
+            }
+            return 1;
+        case IR_SHR:
+            *out = !is_full(a) && a.min >= 0 ? make_range(0, a.max) : type_range(type);
+            return 1;
+        case IR_NEG:
+            *out = is_full(a) ? type_range(type) : clamp_to_type(make_range(-a.max, -a.min), type);
+            return 1;
+        case IR_POPCOUNT:
+        case IR_CLZ:
+        case IR_CTZ:
+            *out = make_range(0, get_type_size_bits(type));
+            return 1;
+        default:
+            *out = type_range(type);
+            return 1;
+    }
+}
+
+/* Helper: Compute the range of a phi from its operands on each incoming
+ * edge. Returns 0 while no operand has a range yet. */
+static int eval_phi(const IrRanges* f, int value, Range* out) {
+    const IrInstr* phi = &f->func->values[value];
+    const IrBlock* block = &f->func->blocks[phi->block];
+    int any = 0;
+    for (int i = 0; i < phi->arg_count; i++) {
+        int arg = phi->args[i];
+        if (!f->reached[arg]) continue;
+        Range r = apply_edge(f, range_at(f, arg, block->preds[i]), arg, block->preds[i], phi->block);
+        *out = any ? range_union(*out, r) : r;
+        any = 1;
+    }
+    return any;
+}
+
+/* Helper: One round over every value. While `ascending`, ranges only grow
+ * and phis that keep growing are widened; otherwise every range is
+ * recomputed from its operands. Returns 1 if anything changed. */
+static int analyze_round(IrRanges* f, int ascending) {
+    const IrFunction* func = f->func;
+    int changed = 0;
+    for (int i = 0; i < f->rpo_count; i++) {
+        const IrBlock* block = &func->blocks[f->rpo[i]];
+        for (int k = 0; k < block->instr_count; k++) {
+            int value = block->instrs[k];
+            const IrInstr* instr = &func->values[value];
+            if (instr->type == TYPE_VOID) continue;
+
+            Range r;
+            int is_phi = instr->op == IR_PHI;
+            if (!(is_phi ? eval_phi(f, value, &r) : eval_instr(f, value, &r))) continue;
+            if (ascending && f->reached[value]) {
+                r = range_union(r, f->ranges[value]);
+                if (is_phi && !range_within(r, f->ranges[value]) && ++f->changes[value] > WIDEN_AFTER) {
+                    r = type_range(instr->type);
+                }
+            }
+            if (!f->reached[value] || r.min != f->ranges[value].min || r.max != f->ranges[value].max) {
+                f->ranges[value] = r;
+                f->reached[value] = 1;
+                changed = 1;
+            }
+        }
+    }
+    return changed;
+}
+
+IrRanges* ir_analyze_ranges(const IrFunction* func) {
+    IrRanges* f = xmalloc(sizeof(IrRanges));
+    int n = func->block_count > 0 ? func->block_count : 1;
+    int values = func->value_count + 1;
+    f->func = func;
+    f->ranges = xmalloc(values * sizeof(Range));
+    f->reached = xmalloc(values * sizeof(int));
+    f->changes = xmalloc(values * sizeof(int));
+    memset(f->reached, 0, values * sizeof(int));
+    memset(f->changes, 0, values * sizeof(int));
+    f->rpo = xmalloc(n * sizeof(int));
+    f->rpo_index = xmalloc(n * sizeof(int));
+    f->idom = xmalloc(n * sizeof(int));
+    f->rpo_count = func->block_count > 0 ? ir_compute_dominators(func, f->rpo, f->rpo_index, f->idom) : 0;
+
+    while (analyze_round(f, 1)) {
+    }
+    for (int i = 0; i < NARROW_ROUNDS; i++) {
+        if (!analyze_round(f, 0)) break;
+    }
+    return f;
+}
+
+void ir_ranges_free(IrRanges* ranges) {
+    if (!ranges) return;
+    xfree(ranges->ranges);
+    xfree(ranges->reached);
+    xfree(ranges->changes);
+    xfree(ranges->rpo);
+    xfree(ranges->rpo_index);
+    xfree(ranges->idom);
+    xfree(ranges);
+}
+
+int ir_range_fits(const IrRanges* ranges, int value, int block, CasmType type) {
+    if (!ranges || !ranges->reached[value] || ranges->rpo_index[block] < 0) return 0;
+    Range r = range_at(ranges, value, block);
+    return !is_full(r) && range_within(r, type_range(type));
+}
@@ -0,0 +1,123 @@
+#include <string.h>
+#include "ir.h"
+#include "utils.h"
+
+/* Self tail call elimination: `return f(args)` inside f becomes a jump
+ * back to a loop header whose phis take the call's arguments in place of
+ * the parameters, so tail recursion runs in constant stack on every
+ * backend that consumes the IR.
+ *
+ * The entry block keeps only the IR_PARAM instructions and jumps to a new
+ * header block that takes over the rest of its instructions and its
+ * terminator. Each tail-calling block then jumps to the header too, and
+ * the call it ended with is dropped. */
+
+/* Helper: Check if a block ends by returning the result of a call to its
+ * own function */
+static int is_self_tail_call(const IrFunction* func, const IrBlock* block) {
+    if (block->term.kind != IR_TERM_RETURN || block->instr_count == 0) return 0;
+    int last = block->instrs[block->instr_count - 1];
+    const IrInstr* instr = &func->values[last];
+    if (instr->op != IR_CALL || strcmp(instr->callee, func->name) != 0) return 0;
+    return block->term.value == last || (block->term.value < 0 && instr->type == TYPE_VOID);
+}
+
+/* Helper: Redirect the operands that `map` replaces (-1 keeps one) */
+static void replace_uses(int* args, int count, const int* map) {
+    for (int i = 0; i < count; i++) {
+        if (map[args[i]] >= 0) args[i] = map[args[i]];
+    }
+}
+
+static void eliminate_in_function(IrFunction* func) {
+    int has_tail_call = 0;
+    for (int b = 0; b < func->block_count; b++) {
+        if (is_self_tail_call(func, &func->blocks[b])) has_tail_call = 1;
+    }
+    /* Lowering never jumps back to the entry block, which keeps it free of phis */
+    if (!has_tail_call || func->blocks[0].pred_count > 0) return;
+
+    int header = ir_add_block(func);
+    IrBlock* entry = &func->blocks[0];
+    IrBlock* body = &func->blocks[header];
+
+    /* Move everything but the parameters into the header */
+    int* params = xmalloc((func->param_count + 1) * sizeof(int));
+    for (int i = 0; i < func->param_count; i++) params[i] = -1;
+    body->instrs = xmalloc((entry->instr_count + 1) * sizeof(int));
+    body->instr_capacity = entry->instr_count + 1;
+    int kept = 0;
+    for (int i = 0; i < entry->instr_count; i++) {
+        int id = entry->instrs[i];
+        if (func->values[id].op == IR_PARAM) {
+            params[func->values[id].imm] = id;
+            entry->instrs[kept++] = id;
+        } else {
+            func->values[id].block = header;
+            body->instrs[body->instr_count++] = id;
+        }
+    }
+    entry->instr_count = kept;
+
+    /* The header's successors now come from it instead of the entry */
+    body->term = entry->term;
+    int succ[2];
+    int succ_count = ir_block_successors(body, succ);
+    for (int s = 0; s < succ_count; s++) {
+        IrBlock* target = &func->blocks[succ[s]];
+        for (int p = 0; p < target->pred_count; p++) {
+            if (target->preds[p] == 0) target->preds[p] = header;
+        }
+    }
+    entry->term.value = -1;
+    ir_set_jump(func, 0, header);
+
+    /* One phi per parameter; every other use reads the phi instead */
+    for (int i = 0; i < func->param_count; i++) {
+        if (params[i] < 0) {
+            params[i] = ir_emit(func, 0, IR_PARAM, func->param_types[i]);
+            func->values[params[i]].imm = i;
+        }
+    }
+    int* map = xmalloc((func->value_count + func->param_count + 1) * sizeof(int));
+    for (int v = 0; v < func->value_count + func->param_count; v++) map[v] = -1;
+    int* phis = xmalloc((func->param_count + 1) * sizeof(int));
+    for (int i = 0; i < func->param_count; i++) {
+        phis[i] = ir_insert_phi(func, header, func->param_types[i]);
+        map[params[i]] = phis[i];
+    }
+    for (int v = 0; v < func->value_count; v++) {
+        replace_uses(func->values[v].args, func->values[v].arg_count, map);
+    }
+    for (int b = 0; b < func->block_count; b++) {
+        IrTerminator* term = &func->blocks[b].term;
+        if (term->value >= 0 && map[term->value] >= 0) term->value = map[term->value];
+    }
+    for (int i = 0; i < func->param_count; i++) {
+        ir_add_arg(func, phis[i], params[i]);
+    }
+
+    /* Each tail call passes its arguments to the phis and jumps */
+    for (int b = 1; b < func->block_count; b++) {
+        IrBlock* block = &func->blocks[b];
+        if (!is_self_tail_call(func, block)) continue;
+        int call = block->instrs[--block->instr_count];
+        for (int i = 0; i < func->param_count; i++) {
+            ir_add_arg(func, phis[i], func->values[call].args[i]);
+        }
+        func->values[call].arg_count = 0;
+        func->values[call].type = TYPE_VOID;
+        block->term.value = -1;
+        ir_set_jump(func, b, header);
+    }
+
+    xfree(phis);
+    xfree(map);
+    xfree(params);
+}
+
+void ir_eliminate_self_tail_calls(IrModule* module) {
+    for (int f = 0; f < module->function_count; f++) {
+        eliminate_in_function(module->functions[f]);
+    }
+}
@@ -0,0 +1,364 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "ir.h"
+#include "types.h"
+#include "utils.h"
+
+/* IR verifier: checks that every block is terminated, CFG edges agree
+ * with predecessor lists, phis are well formed, operand types match the
+ * opcode, and every use is dominated by its definition. */
+
+typedef struct {
+    const IrFunction* func;
+    char** out_error;
+    int* position;      /* Index of each value within its block, -1 if unplaced */
+    int* rpo;           /* Reachable blocks in reverse postorder */
+    int* rpo_index;     /* Block -> index in rpo, -1 if unreachable */
+    int* idom;          /* Block -> immediate dominator */
+} Verifier;
+
+/* Helper: Record a formatted error (prefixed with the function name) */
+static int fail(Verifier* v, const char* fmt, ...) {
+    char message[512];
+    int prefix = snprintf(message, sizeof(message), "@%s: ", v->func->name);
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(message + prefix, sizeof(message) - prefix, fmt, args);
+    va_end(args);
+    if (v->out_error) {
+        *v->out_error = xstrdup(message);
+    }
+    return 0;
+}
+
+static int is_arith_type(CasmType type) {
+    return type == TYPE_I32 || type == TYPE_U32 || type == TYPE_I64 || type == TYPE_U64;
+}
+
+/* Helper: Is `a` a dominator of `b` (both reachable)? */
+static int dominates(const Verifier* v, int a, int b) {
+    while (b != a) {
+        if (b == 0) return 0;
+        b = v->idom[b];
+    }
+    return 1;
+}
+
+/* Helper: Check that value `arg` is a valid operand for a use in `block`
+ * at `pos` (pos = instr_count for terminator uses) */
+static int check_use(Verifier* v, int user, int arg, int block, int pos) {
+    const IrFunction* func = v->func;
+    if (arg < 0 || arg >= func->value_count || v->position[arg] < 0) {
+        return fail(v, "%%%d uses undefined value %%%d", user, arg);
+    }
+    if (func->values[arg].type == TYPE_VOID) {
+        return fail(v, "%%%d uses %%%d, which has no value", user, arg);
+    }
+    int def_block = func->values[arg].block;
+    if (def_block == block) {
+        if (v->position[arg] >= pos) {
+            return fail(v, "%%%d is used before its definition in bb%d", arg, block);
+        }
+    } else if (!dominates(v, def_block, block)) {
+        return fail(v, "definition of %%%d in bb%d does not dominate its use in bb%d",
+                    arg, def_block, block);
+    }
+    return 1;
+}
+
+/* Helper: Opcode-specific operand count and type rules */
+static int check_types(Verifier* v, int id) {
+    const IrFunction* func = v->func;
+    const IrInstr* instr = &func->values[id];
+    const char* name = ir_opcode_name(instr->op);
+
+    switch (instr->op) {
+        case IR_CONST:
+        case IR_UNDEF:
+            if (instr->arg_count != 0) return fail(v, "%%%d: %s takes no operands", id, name);
+            if (instr->type == TYPE_VOID) return fail(v, "%%%d: %s must have a type", id, name);
+            return 1;
+
+        case IR_PARAM:
+            if (instr->block != 0) return fail(v, "%%%d: param outside the entry block", id);
+            if (instr->imm < 0 || instr->imm >= func->param_count) {
+                return fail(v, "%%%d: parameter index %lld out of range", id, instr->imm);
+            }
+            if (func->param_types[instr->imm] != instr->type) {
+                return fail(v, "%%%d: param type does not match the signature", id);
+            }
+            return 1;
+
+        case IR_PHI:
+            for (int i = 0; i < instr->arg_count; i++) {
+                if (func->values[instr->args[i]].type != instr->type) {
+                    return fail(v, "%%%d: phi operand %%%d has a different type", id, instr->args[i]);
+                }
+            }
+            return 1;
+
+        case IR_CONV:
+            if (instr->arg_count != 1) return fail(v, "%%%d: conv takes one operand", id);
+            if (!is_numeric_type(instr->type) && instr->type != TYPE_BOOL) {
+                return fail(v, "%%%d: conv to non-value type", id);
+            }
+            return 1;
+
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_DIV:
+        case IR_MOD:
+        case IR_AND:
+        case IR_OR:
+        case IR_XOR:
+        case IR_SHL:
+        case IR_SHR:
+        case IR_ROTL:
+        case IR_ROTR:
+        case IR_NEG:
+        case IR_POPCOUNT:
+        case IR_CLZ:
+        case IR_CTZ: {
+            int bit_count = instr->op == IR_POPCOUNT || instr->op == IR_CLZ || instr->op == IR_CTZ;
+            int expected = (instr->op == IR_NEG || bit_count) ? 1 : 2;
+            if (instr->arg_count != expected) {
+                return fail(v, "%%%d: %s takes %d operand(s)", id, name, expected);
+            }
+            /* Rotates and bit counts also work on narrow types */
+            int narrow_ok = instr->op == IR_ROTL || instr->op == IR_ROTR || bit_count;
+            if (!is_arith_type(instr->type) && !(narrow_ok && is_numeric_type(instr->type))) {
+                return fail(v, "%%%d: %s on %s", id, name, type_to_string(instr->type));
+            }
+            for (int i = 0; i < instr->arg_count; i++) {
+                if (func->values[instr->args[i]].type != instr->type) {
+                    return fail(v, "%%%d: operand %%%d of %s has type %s, expected %s", id,
+                                instr->args[i], name,
+                                type_to_string(func->values[instr->args[i]].type),
+                                type_to_string(instr->type));
+                }
+            }
+            return 1;
+        }
+
+        case IR_NOT:
+            if (instr->arg_count != 1 || instr->type != TYPE_BOOL ||
+                func->values[instr->args[0]].type != TYPE_BOOL) {
+                return fail(v, "%%%d: not takes and produces bool", id);
+            }
+            return 1;
+
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_GT:
+        case IR_LE:
+        case IR_GE: {
+            if (instr->arg_count != 2) return fail(v, "%%%d: %s takes two operands", id, name);
+            if (instr->type != TYPE_BOOL) return fail(v, "%%%d: %s must produce bool", id, name);
+            CasmType lt = func->values[instr->args[0]].type;
+            CasmType rt = func->values[instr->args[1]].type;
+            int bool_ok = (instr->op == IR_EQ || instr->op == IR_NE) && lt == TYPE_BOOL;
+            if (lt != rt || (!is_arith_type(lt) && !bool_ok)) {
+                return fail(v, "%%%d: %s compares %s with %s", id, name,
+                            type_to_string(lt), type_to_string(rt));
+            }
+            return 1;
+        }
+
+        case IR_CALL:
+            if (!instr->callee) return fail(v, "%%%d: call without a callee", id);
+            return 1;
+
+        case IR_DBG:
+            if (instr->type != TYPE_VOID) return fail(v, "%%%d: dbg has no result", id);
+            return 1;
+
+        case IR_LOAD:
+        case IR_STORE:
+        case IR_BOUNDS_CHECK:
+        case IR_ARRAY_INIT: {
+            int expected = instr->op == IR_STORE ? 2 : instr->op == IR_ARRAY_INIT ? 0 : 1;
+            if (instr->arg_count != expected) {
+                return fail(v, "%%%d: %s takes %d operand(s)", id, name, expected);
+            }
+            if (!IR_IS_GLOBAL_ARRAY(instr->imm) && instr->imm >= func->array_count) {
+                return fail(v, "%%%d: %s of missing array $%lld", id, name, instr->imm);
+            }
+            if ((instr->op == IR_LOAD) != (instr->type != TYPE_VOID)) {
+                return fail(v, "%%%d: %s has the wrong result type", id, name);
+            }
+            if (expected > 0 && func->values[instr->args[0]].type != TYPE_I64) {
+                return fail(v, "%%%d: %s index must be i64", id, name);
+            }
+            return 1;
+        }
+    }
+    return fail(v, "%%%d: unknown opcode", id);
+}
+
+/* Helper: Check one block's successor edges against predecessor lists */
+static int check_edges(Verifier* v, int block) {
+    const IrFunction* func = v->func;
+    int succ[2];
+    int count = ir_block_successors(&func->blocks[block], succ);
+
+    for (int i = 0; i < count; i++) {
+        if (succ[i] < 0 || succ[i] >= func->block_count) {
+            return fail(v, "bb%d jumps to missing block bb%d", block, succ[i]);
+        }
+        if (succ[i] == 0) {
+            return fail(v, "bb%d jumps to the entry block", block);
+        }
+        /* Edges and predecessor entries must match one for one */
+        int edges = 0;
+        int entries = 0;
+        for (int j = 0; j < count; j++) edges += succ[j] == succ[i];
+        const IrBlock* target = &func->blocks[succ[i]];
+        for (int p = 0; p < target->pred_count; p++) entries += target->preds[p] == block;
+        if (edges != entries) {
+            return fail(v, "bb%d is missing from the predecessors of bb%d", block, succ[i]);
+        }
+    }
+
+    const IrBlock* b = &func->blocks[block];
+    for (int p = 0; p < b->pred_count; p++) {
+        int pred = b->preds[p];
+        if (pred < 0 || pred >= func->block_count) {
+            return fail(v, "bb%d lists missing predecessor bb%d", block, pred);
+        }
+        int pred_succ[2];
+        int pred_count = ir_block_successors(&func->blocks[pred], pred_succ);
+        int found = 0;
+        for (int i = 0; i < pred_count; i++) found |= pred_succ[i] == block;
+        if (!found) {
+            return fail(v, "bb%d lists bb%d as a predecessor, but it does not branch there", block, pred);
+        }
+    }
+    return 1;
+}
+
+static int verify(Verifier* v) {
+    const IrFunction* func = v->func;
+
+    if (func->block_count == 0) {
+        return fail(v, "function has no blocks");
+    }
+    if (func->blocks[0].pred_count != 0) {
+        return fail(v, "entry block has predecessors");
+    }
+
+    /* Placement: every value is in exactly the block it claims */
+    for (int i = 0; i < func->value_count; i++) v->position[i] = -1;
+    for (int b = 0; b < func->block_count; b++) {
+        const IrBlock* block = &func->blocks[b];
+        for (int k = 0; k < block->instr_count; k++) {
+            int id = block->instrs[k];
+            if (id < 0 || id >= func->value_count) {
+                return fail(v, "bb%d contains missing value %%%d", b, id);
+            }
+            if (v->position[id] >= 0 || func->values[id].block != b) {
+                return fail(v, "%%%d is placed in more than one block", id);
+            }
+            v->position[id] = k;
+        }
+    }
+
+    for (int b = 0; b < func->block_count; b++) {
+        const IrTerminator* term = &func->blocks[b].term;
+        if (term->kind == IR_TERM_NONE) {
+            return fail(v, "bb%d has no terminator", b);
+        }
+        if (!check_edges(v, b)) return 0;
+    }
+
+    int rpo_count = ir_compute_dominators(func, v->rpo, v->rpo_index, v->idom);
+    if (rpo_count != func->block_count) {
+        for (int b = 0; b < func->block_count; b++) {
+            if (v->rpo_index[b] < 0) return fail(v, "bb%d is unreachable", b);
+        }
+    }
+
+    for (int b = 0; b < func->block_count; b++) {
+        const IrBlock* block = &func->blocks[b];
+        int in_phis = 1;
+
+        for (int k = 0; k < block->instr_count; k++) {
+            int id = block->instrs[k];
+            const IrInstr* instr = &func->values[id];
+
+            if (instr->op == IR_PHI) {
+                if (!in_phis) {
+                    return fail(v, "phi %%%d in bb%d follows a non-phi instruction", id, b);
+                }
+                if (instr->arg_count != block->pred_count) {
+                    return fail(v, "phi %%%d has %d operands but bb%d has %d predecessors",
+                                id, instr->arg_count, b, block->pred_count);
+                }
+                /* A phi operand is used at the end of its predecessor */
+                for (int a = 0; a < instr->arg_count; a++) {
+                    int pred = block->preds[a];
+                    if (!check_use(v, id, instr->args[a], pred, func->blocks[pred].instr_count)) return 0;
+                }
+            } else {
+                in_phis = 0;
+                for (int a = 0; a < instr->arg_count; a++) {
+                    if (!check_use(v, id, instr->args[a], b, k)) return 0;
+                }
+            }
+
+            if (!check_types(v, id)) return 0;
+        }
+
+        const IrTerminator* term = &block->term;
+        if (term->kind == IR_TERM_BRANCH) {
+            if (!check_use(v, -1, term->value, b, block->instr_count)) return 0;
+            if (func->values[term->value].type != TYPE_BOOL) {
+                return fail(v, "branch condition %%%d in bb%d is not bool", term->value, b);
+            }
+        } else if (term->kind == IR_TERM_RETURN) {
+            if (func->return_type == TYPE_VOID) {
+                if (term->value >= 0) return fail(v, "bb%d returns a value from a void function", b);
+            } else {
+                if (term->value < 0) return fail(v, "bb%d returns without a value", b);
+                if (!check_use(v, -1, term->value, b, block->instr_count)) return 0;
+                if (func->values[term->value].type != func->return_type) {
+                    return fail(v, "bb%d returns %s from a function returning %s", b,
+                                type_to_string(func->values[term->value].type),
+                                type_to_string(func->return_type));
+                }
+            }
+        }
+    }
+
+    return 1;
+}
+
+int ir_verify_function(const IrFunction* func, char** out_error) {
+    Verifier v;
+    int n = func->block_count > 0 ? func->block_count : 1;
+    v.func = func;
+    v.out_error = out_error;
+    v.position = xmalloc((func->value_count + 1) * sizeof(int));
+    v.rpo = xmalloc(n * sizeof(int));
+    v.rpo_index = xmalloc(n * sizeof(int));
+    v.idom = xmalloc(n * sizeof(int));
+
+    int ok = verify(&v);
+
+    xfree(v.idom);
+    xfree(v.rpo_index);
+    xfree(v.rpo);
+    xfree(v.position);
+    return ok;
+}
+
+int ir_verify_module(const IrModule* module, char** out_error) {
+    for (int i = 0; i < module->function_count; i++) {
+        if (!ir_verify_function(module->functions[i], out_error)) {
+            return 0;
+        }
+    }
+    return 1;
+}
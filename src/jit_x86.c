@@ -0,0 +1,1561 @@
+#define _DEFAULT_SOURCE
+#include <limits.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <string.h>
+#include "jit_x86.h"
+#include "types.h"
+#include "x86_regalloc.h"
+#include "utils.h"
+
+/* In-process JIT from the SSA IR to x86-64 machine code.
+ *
+ * Instruction selection follows codegen_x86.c (same register allocation,
+ * same canonical 64-bit value form, same frame layout), but instructions
+ * are encoded straight into a byte buffer that is copied into mmap'd
+ * executable memory, one mapping per function. Calls between functions go
+ * through a table holding each function's current entry point; until a
+ * function is first called its entry is a stub that compiles it. dbg
+ * statements and traps call back into C helpers here; traps longjmp out
+ * of the native code. */
+
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+#define JIT_SUPPORTED 1
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#ifdef JIT_SUPPORTED
+
+/* Runtime errors, in the same words as the interpreter */
+typedef enum {
+    JIT_TRAP_DIV_ZERO,
+    JIT_TRAP_OVERFLOW,
+    JIT_TRAP_UNREACHABLE,
+    JIT_TRAP_STACK,
+    JIT_TRAP_MEMORY,
+    JIT_TRAP_BOUNDS,
+    JIT_TRAP_COUNT
+} JitTrap;
+
+static const char* const g_trap_messages[JIT_TRAP_COUNT] = {
+    "integer division by zero",
+    "integer overflow",
+    "unreachable code reached",
+    "call stack exhausted",
+    "out of executable memory",
+    "array index out of bounds"
+};
+
+/* x86 condition codes (the low nibble of jcc/setcc); cc ^ 1 negates */
+typedef enum {
+    CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_BE = 0x6, CC_A = 0x7,
+    CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF
+} ConditionCode;
+
+/* Group-1 ALU operations, by their ModRM reg digit */
+typedef enum {
+    ALU_ADD = 0, ALU_OR = 1, ALU_AND = 4, ALU_SUB = 5, ALU_XOR = 6, ALU_CMP = 7
+} AluOp;
+
+/* An instruction operand: a register, [base + disp] or an immediate */
+typedef enum { OPND_REG, OPND_MEM, OPND_IMM } OperandKind;
+
+typedef struct {
+    OperandKind kind;
+    X86Reg reg;         /* The register, or the base of a memory operand */
+    int disp;
+    long long imm;
+} Operand;
+
+/* A rel32 to fill in once its target is placed: a block (target >= 0)
+ * or the trap stub of kind -(target + 1) */
+typedef struct {
+    size_t pos;
+    int target;
+} JitFixup;
+
+/* A copy into a location, one of a set performed simultaneously */
+typedef struct {
+    X86Location dst;
+    X86Location src;
+} X86Move;
+
+/* State for the running program */
+static const IrModule* g_module = NULL;
+static const char* g_source_filename = "unknown.csm";
+static void** g_entries = NULL;             /* Current entry point of each function */
+static unsigned char** g_mappings = NULL;   /* Executable memory of each function, NULL until compiled */
+static size_t* g_mapping_sizes = NULL;
+static unsigned char* g_stubs = NULL;       /* Lazy-compile stubs of all functions */
+static size_t g_stubs_size = 0;
+static char** g_texts = NULL;               /* dbg text and array images referenced by generated code */
+static int g_text_count = 0;
+static int g_text_capacity = 0;
+static uintptr_t g_stack_limit = 0;         /* Lowest rsp native code may reach */
+static unsigned char* g_globals = NULL;     /* Global array memory */
+static size_t* g_global_offsets = NULL;
+static jmp_buf g_trap_jump;
+static JitTrap g_trap = JIT_TRAP_UNREACHABLE;
+
+/* dbg output buffer */
+#define OUT_BUF_SIZE 65536
+static FILE* g_out = NULL;
+static char g_out_buf[OUT_BUF_SIZE];
+static size_t g_out_len = 0;
+
+/* Code being generated */
+static unsigned char* g_code = NULL;
+static size_t g_code_len = 0;
+static size_t g_code_capacity = 0;
+static JitFixup* g_fixups = NULL;
+static int g_fixup_count = 0;
+static int g_fixup_capacity = 0;
+static int g_trap_used[JIT_TRAP_COUNT];
+
+/* State for the function being compiled */
+static const IrFunction* g_func = NULL;
+static const X86Allocation* g_alloc = NULL;
+static int g_saved_count = 0;
+static X86Reg g_saved_regs[X86_REG_COUNT];
+static int* g_use_counts = NULL;
+static int* g_array_offsets = NULL;         /* rbp offset of each local array */
+
+/* SysV integer argument registers */
+static const X86Reg g_arg_regs[6] = { X86_RDI, X86_RSI, X86_RDX, X86_RCX, X86_R8, X86_R9 };
+
+/* Stack kept free below the limit for the C helpers native code calls */
+#define STACK_MARGIN (256 * 1024)
+#define STACK_BUDGET_MAX (64L * 1024 * 1024)
+
+/* ---- Runtime helpers called from generated code ---- */
+
+/* Helper: Write out buffered dbg text */
+static void out_flush(void) {
+    if (g_out_len > 0) {
+        fwrite(g_out_buf, 1, g_out_len, g_out);
+        g_out_len = 0;
+    }
+}
+
+/* Helper: Append bytes to the dbg buffer */
+static void out_write(const char* text, size_t len) {
+    if (g_out_len + len > OUT_BUF_SIZE) {
+        out_flush();
+        if (len > OUT_BUF_SIZE) {
+            fwrite(text, 1, len, g_out);
+            return;
+        }
+    }
+    memcpy(g_out_buf + g_out_len, text, len);
+    g_out_len += len;
+}
+
+/* Helper: Append a 64-bit value in decimal */
+static void out_number(uint64_t magnitude, int negative) {
+    char tmp[24];
+    int i = sizeof(tmp);
+    do {
+        tmp[--i] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (negative) tmp[--i] = '-';
+    out_write(tmp + i, sizeof(tmp) - i);
+}
+
+static void jit_dbg_text(const char* text, long long len) {
+    out_write(text, (size_t)len);
+}
+
+static void jit_dbg_signed(long long value) {
+    if (value < 0) out_number(0u - (uint64_t)value, 1);
+    else out_number((uint64_t)value, 0);
+}
+
+static void jit_dbg_unsigned(long long value) {
+    out_number((uint64_t)value, 0);
+}
+
+static void jit_dbg_bool(long long value) {
+    if (value) out_write("true", 4);
+    else out_write("false", 5);
+}
+
+/* Leave native code through the setjmp in run_entry() */
+static void jit_trap(long long kind) {
+    g_trap = (JitTrap)kind;
+    longjmp(g_trap_jump, 1);
+}
+
+typedef void (*JitHelper)(void);
+
+/* Helper: Address of a C function, for movabs */
+static uint64_t helper_address(JitHelper fn) {
+    uint64_t address;
+    memcpy(&address, &fn, sizeof(address));
+    return address;
+}
+
+/* ---- Machine code encoding ---- */
+
+static void put_byte(int b) {
+    if (g_code_len == g_code_capacity) {
+        g_code_capacity = g_code_capacity ? g_code_capacity * 2 : 4096;
+        g_code = xrealloc(g_code, g_code_capacity);
+    }
+    g_code[g_code_len++] = (unsigned char)b;
+}
+
+static void put_u32(uint32_t v) {
+    for (int i = 0; i < 4; i++) put_byte((int)((v >> (8 * i)) & 0xFF));
+}
+
+static void put_u64(uint64_t v) {
+    for (int i = 0; i < 8; i++) put_byte((int)((v >> (8 * i)) & 0xFF));
+}
+
+/* Helper: Point the rel32 at `pos` to `target` */
+static void patch_rel32(size_t pos, size_t target) {
+    uint32_t rel = (uint32_t)((long long)target - (long long)(pos + 4));
+    for (int i = 0; i < 4; i++) g_code[pos + i] = (unsigned char)((rel >> (8 * i)) & 0xFF);
+}
+
+static Operand reg_operand(X86Reg reg) {
+    Operand op = {OPND_REG, reg, 0, 0};
+    return op;
+}
+
+static Operand mem_operand(X86Reg base, int disp) {
+    Operand op = {OPND_MEM, base, disp, 0};
+    return op;
+}
+
+static Operand imm_operand(long long imm) {
+    Operand op = {OPND_IMM, X86_RAX, 0, imm};
+    return op;
+}
+
+/* Helper: Operand for a value's location */
+static Operand operand(const X86Location* loc) {
+    switch (loc->kind) {
+        case X86_LOC_REG:   return reg_operand(loc->reg);
+        case X86_LOC_STACK: return mem_operand(X86_RBP, -8 * (g_saved_count + loc->slot + 1));
+        case X86_LOC_IMM:   return imm_operand(loc->imm);
+        default:            return imm_operand(0);
+    }
+}
+
+/* Helper: Emit [REX] opcode ModRM [SIB] [disp]. Opcodes above 0xFF are
+ * two-byte 0F xx opcodes. `reg_field` is a register or an opcode digit;
+ * `byte_regs` forces a REX prefix so registers 4-7 mean spl..dil. */
+static void emit_rm(int wide, int opcode, int reg_field, const Operand* rm, int byte_regs) {
+    int rex = 0x40 | (wide ? 8 : 0) | ((reg_field & 8) ? 4 : 0) | ((rm->reg & 8) ? 1 : 0);
+    if (rex != 0x40 || byte_regs) put_byte(rex);
+    if (opcode > 0xFF) put_byte(0x0F);
+    put_byte(opcode & 0xFF);
+
+    if (rm->kind == OPND_REG) {
+        put_byte(0xC0 | ((reg_field & 7) << 3) | (rm->reg & 7));
+        return;
+    }
+    int short_disp = rm->disp >= -128 && rm->disp <= 127;
+    put_byte((short_disp ? 0x40 : 0x80) | ((reg_field & 7) << 3) | (rm->reg & 7));
+    if ((rm->reg & 7) == X86_RSP) put_byte(0x24);
+    if (short_disp) put_byte(rm->disp & 0xFF);
+    else put_u32((uint32_t)rm->disp);
+}
+
+/* Helper: reg (or memory) op= src. At most one side is memory. */
+static void emit_alu(AluOp op, const Operand* dst, const Operand* src) {
+    if (src->kind == OPND_IMM) {
+        if (src->imm >= -128 && src->imm <= 127) {
+            emit_rm(1, 0x83, op, dst, 0);
+            put_byte((int)(src->imm & 0xFF));
+        } else {
+            emit_rm(1, 0x81, op, dst, 0);
+            put_u32((uint32_t)src->imm);
+        }
+    } else if (dst->kind == OPND_REG) {
+        emit_rm(1, op * 8 + 3, dst->reg, src, 0);
+    } else {
+        emit_rm(1, op * 8 + 1, src->reg, dst, 0);
+    }
+}
+
+/* Helper: Load a 64-bit constant into a register, in the shortest form */
+static void emit_mov_imm(X86Reg reg, long long imm) {
+    Operand r = reg_operand(reg);
+    if (imm == 0) {
+        emit_rm(0, 0x31, reg, &r, 0);
+    } else if (imm > 0 && imm <= (long long)UINT32_MAX) {
+        if (reg & 8) put_byte(0x41);
+        put_byte(0xB8 + (reg & 7));
+        put_u32((uint32_t)imm);
+    } else if (imm >= INT32_MIN && imm <= INT32_MAX) {
+        emit_rm(1, 0xC7, 0, &r, 0);
+        put_u32((uint32_t)imm);
+    } else {
+        put_byte(0x48 | ((reg & 8) ? 1 : 0));
+        put_byte(0xB8 + (reg & 7));
+        put_u64((uint64_t)imm);
+    }
+}
+
+/* Helper: Call a C helper (clobbers rax) */
+static void emit_call_helper(JitHelper fn) {
+    put_byte(0x48);
+    put_byte(0xB8);
+    put_u64(helper_address(fn));
+    put_byte(0xFF);
+    put_byte(0xD0);
+}
+
+static void emit_push(const Operand* src) {
+    if (src->kind == OPND_REG) {
+        if (src->reg & 8) put_byte(0x41);
+        put_byte(0x50 + (src->reg & 7));
+    } else if (src->kind == OPND_MEM) {
+        emit_rm(0, 0xFF, 6, src, 0);
+    } else {
+        put_byte(0x68);
+        put_u32((uint32_t)src->imm);
+    }
+}
+
+static void emit_pop(const Operand* dst) {
+    if (dst->kind == OPND_REG) {
+        if (dst->reg & 8) put_byte(0x41);
+        put_byte(0x58 + (dst->reg & 7));
+    } else {
+        emit_rm(0, 0x8F, 0, dst, 0);
+    }
+}
+
+/* Helper: jcc with a rel32 to be patched; returns the rel32's position */
+static size_t emit_jcc_forward(ConditionCode cc) {
+    put_byte(0x0F);
+    put_byte(0x80 + cc);
+    size_t pos = g_code_len;
+    put_u32(0);
+    return pos;
+}
+
+static size_t emit_jmp_forward(void) {
+    put_byte(0xE9);
+    size_t pos = g_code_len;
+    put_u32(0);
+    return pos;
+}
+
+static void add_fixup(size_t pos, int target) {
+    if (g_fixup_count == g_fixup_capacity) {
+        g_fixup_capacity = g_fixup_capacity ? g_fixup_capacity * 2 : 64;
+        g_fixups = xrealloc(g_fixups, g_fixup_capacity * sizeof(JitFixup));
+    }
+    g_fixups[g_fixup_count].pos = pos;
+    g_fixups[g_fixup_count].target = target;
+    g_fixup_count++;
+}
+
+/* Helper: Jump to a block of the current function */
+static void emit_jmp_block(int block) {
+    add_fixup(emit_jmp_forward(), block);
+}
+
+static void emit_jcc_block(ConditionCode cc, int block) {
+    add_fixup(emit_jcc_forward(cc), block);
+}
+
+/* Helper: Jump to the function's trap stub; cc < 0 jumps unconditionally */
+static void emit_trap_jump(int cc, JitTrap trap) {
+    size_t pos = cc < 0 ? emit_jmp_forward() : emit_jcc_forward((ConditionCode)cc);
+    add_fixup(pos, -(int)trap - 1);
+    g_trap_used[trap] = 1;
+}
+
+/* ---- Instruction selection (mirrors codegen_x86.c) ---- */
+
+/* Helper: Check if a type is a signed integer */
+static int is_signed_type(CasmType type) {
+    return type == TYPE_I8 || type == TYPE_I16 || type == TYPE_I32 || type == TYPE_I64;
+}
+
+/* Helper: Location of a value */
+static const X86Location* location_of(int value) {
+    return &g_alloc->locations[value];
+}
+
+/* Helper: Whether a location is the given register */
+static int is_reg(const X86Location* loc, X86Reg reg) {
+    return loc->kind == X86_LOC_REG && loc->reg == reg;
+}
+
+/* Helper: Whether two locations are the same register or slot */
+static int same_location(const X86Location* a, const X86Location* b) {
+    if (a->kind != b->kind) return 0;
+    if (a->kind == X86_LOC_REG) return a->reg == b->reg;
+    if (a->kind == X86_LOC_STACK) return a->slot == b->slot;
+    return 0;
+}
+
+/* Helper: Load a location into a register */
+static void emit_load(X86Reg reg, const X86Location* src) {
+    if (is_reg(src, reg)) return;
+    Operand from = operand(src);
+    if (from.kind == OPND_IMM) {
+        emit_mov_imm(reg, from.imm);
+        return;
+    }
+    emit_rm(1, 0x8B, reg, &from, 0);
+}
+
+/* Helper: Store a register into a location */
+static void emit_store(const X86Location* dst, X86Reg reg) {
+    if (dst->kind != X86_LOC_REG && dst->kind != X86_LOC_STACK) return;
+    if (is_reg(dst, reg)) return;
+    Operand to = operand(dst);
+    emit_rm(1, 0x89, reg, &to, 0);
+}
+
+/* Helper: Copy between locations */
+static void emit_move(const X86Location* dst, const X86Location* src) {
+    if (same_location(dst, src)) return;
+    if (dst->kind == X86_LOC_REG) {
+        emit_load(dst->reg, src);
+    } else if (src->kind == X86_LOC_STACK) {
+        emit_load(X86_RAX, src);
+        emit_store(dst, X86_RAX);
+    } else if (src->kind == X86_LOC_REG) {
+        emit_store(dst, src->reg);
+    } else {
+        Operand to = operand(dst);
+        emit_rm(1, 0xC7, 0, &to, 0);
+        put_u32((uint32_t)operand(src).imm);
+    }
+}
+
+/* Helper: Re-establish the canonical 64-bit form of a register after an
+ * operation whose result has the given type */
+static void emit_normalize(X86Reg reg, CasmType type) {
+    Operand r = reg_operand(reg);
+    switch (type) {
+        case TYPE_I8:  emit_rm(1, 0x0FBE, reg, &r, 1); break;   /* movsbq */
+        case TYPE_I16: emit_rm(1, 0x0FBF, reg, &r, 0); break;   /* movswq */
+        case TYPE_I32: emit_rm(1, 0x63, reg, &r, 0); break;     /* movslq */
+        case TYPE_U8:  emit_rm(0, 0x0FB6, reg, &r, 1); break;   /* movzbl */
+        case TYPE_U16: emit_rm(0, 0x0FB7, reg, &r, 0); break;   /* movzwl */
+        case TYPE_U32: emit_rm(0, 0x89, reg, &r, 0); break;     /* movl */
+        case TYPE_BOOL:
+            emit_rm(1, 0x85, reg, &r, 0);                       /* testq */
+            emit_rm(0, 0x0F90 + CC_NE, 0, &r, 1);               /* setne */
+            emit_rm(0, 0x0FB6, reg, &r, 1);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Helper: Register to compute a result in: the destination register when
+ * it is not also the right operand, else rax */
+static X86Reg work_register(const X86Location* dst, const X86Location* rhs) {
+    if (dst->kind == X86_LOC_REG && !(rhs && is_reg(rhs, dst->reg))) return dst->reg;
+    return X86_RAX;
+}
+
+/* Helper: Perform copies as if all sources were read before any
+ * destination is written. Without overlaps they are plain moves;
+ * otherwise every source goes through the stack. */
+static void emit_parallel_moves(const X86Move* moves, int count) {
+    int overlap = 0;
+    for (int i = 0; i < count && !overlap; i++) {
+        for (int j = 0; j < count; j++) {
+            if (i != j && same_location(&moves[i].dst, &moves[j].src)) {
+                overlap = 1;
+                break;
+            }
+        }
+    }
+
+    if (!overlap) {
+        for (int i = 0; i < count; i++) {
+            emit_move(&moves[i].dst, &moves[i].src);
+        }
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        Operand src = operand(&moves[i].src);
+        emit_push(&src);
+    }
+    for (int i = count - 1; i >= 0; i--) {
+        Operand dst = operand(&moves[i].dst);
+        emit_pop(&dst);
+    }
+}
+
+/* Helper: Collect the phi copies for the edge from `from` to `to`.
+ * `nth` picks the edge when both branch targets are the same block. */
+static int collect_edge_moves(int from, int to, int nth, X86Move** out_moves) {
+    const IrBlock* target = &g_func->blocks[to];
+    int pred = -1;
+    for (int i = 0; i < target->pred_count; i++) {
+        if (target->preds[i] == from && nth-- == 0) {
+            pred = i;
+            break;
+        }
+    }
+
+    X86Move* moves = xmalloc((target->instr_count + 1) * sizeof(X86Move));
+    int count = 0;
+    for (int i = 0; i < target->instr_count && pred >= 0; i++) {
+        const IrInstr* phi = &g_func->values[target->instrs[i]];
+        if (phi->op != IR_PHI) break;
+        if (pred >= phi->arg_count) continue;
+        const X86Location* dst = location_of(target->instrs[i]);
+        const X86Location* src = location_of(phi->args[pred]);
+        if (dst->kind == X86_LOC_NONE || dst->kind == X86_LOC_IMM || same_location(dst, src)) continue;
+        moves[count].dst = *dst;
+        moves[count].src = *src;
+        count++;
+    }
+    *out_moves = moves;
+    return count;
+}
+
+/* Helper: Condition code for a comparison */
+static ConditionCode condition_code(IrOpcode op, int is_signed, int negate) {
+    ConditionCode cc;
+    switch (op) {
+        case IR_EQ: cc = CC_E; break;
+        case IR_LT: cc = is_signed ? CC_L : CC_B; break;
+        case IR_GT: cc = is_signed ? CC_G : CC_A; break;
+        case IR_LE: cc = is_signed ? CC_LE : CC_BE; break;
+        case IR_GE: cc = is_signed ? CC_GE : CC_AE; break;
+        default:    cc = CC_NE; break;
+    }
+    return negate ? (ConditionCode)(cc ^ 1) : cc;
+}
+
+/* Helper: Set flags for `lhs ? rhs` */
+static void emit_compare(const X86Location* lhs, const X86Location* rhs) {
+    Operand a = operand(lhs);
+    Operand b = operand(rhs);
+    if (lhs->kind == X86_LOC_REG ||
+        (lhs->kind == X86_LOC_STACK && rhs->kind != X86_LOC_STACK)) {
+        emit_alu(ALU_CMP, &a, &b);
+    } else {
+        Operand rax = reg_operand(X86_RAX);
+        emit_load(X86_RAX, lhs);
+        emit_alu(ALU_CMP, &rax, &b);
+    }
+}
+
+/* Helper: Whether a comparison is only used by its block's branch, right
+ * after it, so it can set the flags for the jump directly */
+static int is_fused_compare(int value) {
+    const IrInstr* instr = &g_func->values[value];
+    if (instr->op < IR_EQ || instr->op > IR_GE) return 0;
+    const IrBlock* block = &g_func->blocks[instr->block];
+    return block->term.kind == IR_TERM_BRANCH && block->term.value == value &&
+           block->instrs[block->instr_count - 1] == value && g_use_counts[value] == 1;
+}
+
+/* Helper: Keep a copy of some bytes alive for the generated code */
+static char* keep_bytes(const void* data, size_t len) {
+    if (g_text_count == g_text_capacity) {
+        g_text_capacity = g_text_capacity ? g_text_capacity * 2 : 64;
+        g_texts = xrealloc(g_texts, g_text_capacity * sizeof(char*));
+    }
+    char* copy = xmalloc(len + 1);
+    memcpy(copy, data, len);
+    copy[len] = '\0';
+    g_texts[g_text_count++] = copy;
+    return copy;
+}
+
+/* Helper: Keep a piece of dbg text alive for the generated code and
+ * emit a call printing it */
+static void emit_dbg_text(const char* text, size_t len) {
+    char* copy = keep_bytes(text, len);
+
+    uint64_t address;
+    memcpy(&address, &copy, sizeof(address));
+    put_byte(0x48);
+    put_byte(0xB8 + X86_RDI);
+    put_u64(address);
+    emit_mov_imm(X86_RSI, (long long)len);
+    emit_call_helper((JitHelper)jit_dbg_text);
+}
+
+/* Emit a dbg statement with the same labels as the C backend. The values
+ * are parked on the stack first since the helper calls clobber the
+ * caller-saved registers. */
+static void emit_dbg(const IrInstr* instr) {
+    const ASTDbgStmt* dbg = instr->dbg;
+    int count = instr->arg_count;
+    int slots = (count + 1) & ~1;
+    Operand rsp = reg_operand(X86_RSP);
+
+    if (slots > 0) {
+        Operand size = imm_operand(8 * slots);
+        emit_alu(ALU_SUB, &rsp, &size);
+        for (int i = 0; i < count; i++) {
+            const X86Location* src = location_of(instr->args[i]);
+            Operand slot = mem_operand(X86_RSP, 8 * i);
+            if (src->kind == X86_LOC_REG) {
+                emit_rm(1, 0x89, src->reg, &slot, 0);
+            } else {
+                emit_load(X86_RAX, src);
+                emit_rm(1, 0x89, X86_RAX, &slot, 0);
+            }
+        }
+    }
+
+    char prefix[512];
+    snprintf(prefix, sizeof(prefix), "%s:%d:%d: ",
+             g_source_filename, dbg->location.line, dbg->location.column);
+    for (int i = 0; i < count; i++) {
+        const char* name = NULL;
+        char fallback[32];
+        if (dbg->arg_names[i] && strlen(dbg->arg_names[i]) > 0) {
+            name = dbg->arg_names[i];
+        } else {
+            snprintf(fallback, sizeof(fallback), "arg%d", i);
+            name = fallback;
+        }
+
+        size_t len = strlen(prefix) + strlen(name) + 3;
+        char* piece = xmalloc(len + 1);
+        snprintf(piece, len + 1, "%s%s = ", prefix, name);
+        emit_dbg_text(piece, len);
+        xfree(piece);
+        snprintf(prefix, sizeof(prefix), ", ");
+
+        CasmType type = g_func->values[instr->args[i]].type;
+        Operand slot = mem_operand(X86_RSP, 8 * i);
+        emit_rm(1, 0x8B, X86_RDI, &slot, 0);
+        emit_call_helper(type == TYPE_BOOL ? (JitHelper)jit_dbg_bool :
+                         is_signed_type(type) ? (JitHelper)jit_dbg_signed : (JitHelper)jit_dbg_unsigned);
+    }
+
+    if (count == 0) {
+        char line[520];
+        snprintf(line, sizeof(line), "%s\n", prefix);
+        emit_dbg_text(line, strlen(line));
+    } else {
+        emit_dbg_text("\n", 1);
+    }
+
+    if (slots > 0) {
+        Operand size = imm_operand(8 * slots);
+        emit_alu(ALU_ADD, &rsp, &size);
+    }
+}
+
+/* Helper: Index of a function in the module */
+static int function_index(const char* name) {
+    for (int i = 0; i < g_module->function_count; i++) {
+        if (strcmp(g_module->functions[i]->name, name) == 0) return i;
+    }
+    return -1;
+}
+
+/* Emit a call through the entry table: SysV argument registers, the rest
+ * on the stack (keeping rsp 16-byte aligned), result in rax */
+static void emit_call(int value, const IrInstr* instr) {
+    int count = instr->arg_count;
+    int stack_args = count > 6 ? count - 6 : 0;
+    int padding = stack_args % 2;
+    Operand rsp = reg_operand(X86_RSP);
+
+    if (padding) {
+        Operand eight = imm_operand(8);
+        emit_alu(ALU_SUB, &rsp, &eight);
+    }
+    for (int i = count - 1; i >= 6; i--) {
+        Operand arg = operand(location_of(instr->args[i]));
+        emit_push(&arg);
+    }
+
+    X86Move moves[6];
+    int move_count = 0;
+    for (int i = 0; i < count && i < 6; i++) {
+        moves[move_count].dst.kind = X86_LOC_REG;
+        moves[move_count].dst.reg = g_arg_regs[i];
+        moves[move_count].dst.slot = -1;
+        moves[move_count].dst.imm = 0;
+        moves[move_count].src = *location_of(instr->args[i]);
+        if (!same_location(&moves[move_count].dst, &moves[move_count].src)) move_count++;
+    }
+    emit_parallel_moves(moves, move_count);
+
+    /* movabs &g_entries[callee], %rax; call *(%rax) */
+    void** entry = &g_entries[function_index(instr->callee)];
+    uint64_t address;
+    memcpy(&address, &entry, sizeof(address));
+    put_byte(0x48);
+    put_byte(0xB8);
+    put_u64(address);
+    put_byte(0xFF);
+    put_byte(0x10);
+
+    if (stack_args + padding > 0) {
+        Operand size = imm_operand(8 * (stack_args + padding));
+        emit_alu(ALU_ADD, &rsp, &size);
+    }
+    if (instr->type != TYPE_VOID) {
+        emit_store(location_of(value), X86_RAX);
+    }
+}
+
+/* Emit a division or remainder. Unlike the hardware, division by zero
+ * and signed overflow trap with a message, and x % -1 is 0. */
+static void emit_division(int value, const IrInstr* instr) {
+    const X86Location* dst = location_of(value);
+    const X86Location* rhs = location_of(instr->args[1]);
+    int is_signed = is_signed_type(instr->type);
+    Operand rax = reg_operand(X86_RAX);
+    Operand rdx = reg_operand(X86_RDX);
+    Operand divisor = operand(rhs);
+
+    emit_load(X86_RAX, location_of(instr->args[0]));
+    if (rhs->kind == X86_LOC_IMM) {
+        if (rhs->imm == 0) {
+            emit_trap_jump(-1, JIT_TRAP_DIV_ZERO);
+            return;
+        }
+        emit_load(X86_RCX, rhs);
+        divisor = reg_operand(X86_RCX);
+    } else {
+        Operand zero = imm_operand(0);
+        emit_alu(ALU_CMP, &divisor, &zero);
+        emit_trap_jump(CC_E, JIT_TRAP_DIV_ZERO);
+    }
+
+    size_t done = 0;
+    int has_done = 0;
+    if (is_signed) {
+        Operand minus_one = imm_operand(-1);
+        emit_alu(ALU_CMP, &divisor, &minus_one);
+        size_t not_minus_one = emit_jcc_forward(CC_NE);
+        if (instr->op == IR_DIV) {
+            if (instr->type == TYPE_I64) {
+                emit_mov_imm(X86_RDX, LLONG_MIN);
+                emit_alu(ALU_CMP, &rax, &rdx);
+            } else {
+                Operand min = imm_operand(INT_MIN);
+                emit_alu(ALU_CMP, &rax, &min);
+            }
+            emit_trap_jump(CC_E, JIT_TRAP_OVERFLOW);
+            emit_rm(1, 0xF7, 3, &rax, 0);               /* negq */
+        } else {
+            emit_rm(0, 0x31, X86_RDX, &rdx, 0);         /* xorl %edx, %edx */
+        }
+        done = emit_jmp_forward();
+        has_done = 1;
+        patch_rel32(not_minus_one, g_code_len);
+        put_byte(0x48);                                 /* cqto */
+        put_byte(0x99);
+        emit_rm(1, 0xF7, 7, &divisor, 0);               /* idivq */
+    } else {
+        emit_rm(0, 0x31, X86_RDX, &rdx, 0);
+        emit_rm(1, 0xF7, 6, &divisor, 0);               /* divq */
+    }
+    if (has_done) patch_rel32(done, g_code_len);
+
+    X86Reg result = instr->op == IR_DIV ? X86_RAX : X86_RDX;
+    emit_normalize(result, instr->type);
+    emit_store(dst, result);
+}
+
+/* Helper: Size in bytes of an array element */
+static int element_size(CasmType type) {
+    switch (type) {
+        case TYPE_I8:
+        case TYPE_U8:
+        case TYPE_BOOL: return 1;
+        case TYPE_I16:
+        case TYPE_U16:  return 2;
+        case TYPE_I32:
+        case TYPE_U32:  return 4;
+        default:        return 8;
+    }
+}
+
+/* Helper: Write an array's initial contents (elements at their natural size) */
+static void fill_array_image(unsigned char* image, const IrArray* array) {
+    int size = element_size(array->elem_type);
+    memset(image, 0, (size_t)array->length * size);
+    for (int i = 0; i < array->init_count; i++) {
+        uint64_t value = (uint64_t)array->init[i];
+        for (int b = 0; b < size; b++) {
+            image[(size_t)i * size + b] = (unsigned char)((value >> (8 * b)) & 0xFF);
+        }
+    }
+}
+
+/* Helper: movabs of a host address into a register */
+static void emit_mov_address(X86Reg reg, const void* pointer) {
+    uint64_t address;
+    memcpy(&address, &pointer, sizeof(address));
+    put_byte(0x48 | ((reg & 8) ? 1 : 0));
+    put_byte(0xB8 + (reg & 7));
+    put_u64(address);
+}
+
+/* Helper: Emit an instruction on the element [base + rcx * scale + disp]
+ * (SIB addressing with a 32-bit displacement) */
+static void emit_rm_indexed(int wide, int opcode, int reg_field, X86Reg base, int scale,
+                            int disp, int byte_regs) {
+    int rex = 0x40 | (wide ? 8 : 0) | ((reg_field & 8) ? 4 : 0) | ((base & 8) ? 1 : 0);
+    if (rex != 0x40 || byte_regs) put_byte(rex);
+    if (opcode > 0xFF) put_byte(0x0F);
+    put_byte(opcode & 0xFF);
+    put_byte(0x80 | ((reg_field & 7) << 3) | 0x04);
+    int scale_bits = scale == 8 ? 3 : scale == 4 ? 2 : scale == 2 ? 1 : 0;
+    put_byte((scale_bits << 6) | (X86_RCX << 3) | (base & 7));
+    put_u32((uint32_t)disp);
+}
+
+/* Helper: Put the index of an array access in rcx and return the base
+ * register of the element address: rbp for locals, rax (loaded with the
+ * array's address) for globals. Sets *disp and *scale. */
+static X86Reg element_address(long long array_ref, int index, int* disp, int* scale) {
+    const IrArray* array = ir_array_ref(g_module, g_func, array_ref);
+    emit_load(X86_RCX, location_of(index));
+    *scale = element_size(array->elem_type);
+    if (IR_IS_GLOBAL_ARRAY(array_ref)) {
+        emit_mov_address(X86_RAX, g_globals + g_global_offsets[IR_ARRAY_INDEX(array_ref)]);
+        *disp = 0;
+        return X86_RAX;
+    }
+    *disp = g_array_offsets[array_ref];
+    return X86_RBP;
+}
+
+/* Emit an array element load, extended to the canonical form */
+static void emit_array_load(int value, const IrInstr* instr) {
+    const X86Location* dst = location_of(value);
+    int disp = 0;
+    int scale = 1;
+    X86Reg base = element_address(instr->imm, instr->args[0], &disp, &scale);
+    X86Reg work = work_register(dst, NULL);
+    switch (instr->type) {
+        case TYPE_I8:  emit_rm_indexed(1, 0x0FBE, work, base, scale, disp, 0); break;  /* movsbq */
+        case TYPE_I16: emit_rm_indexed(1, 0x0FBF, work, base, scale, disp, 0); break;  /* movswq */
+        case TYPE_I32: emit_rm_indexed(1, 0x63, work, base, scale, disp, 0); break;    /* movslq */
+        case TYPE_U8:
+        case TYPE_BOOL: emit_rm_indexed(0, 0x0FB6, work, base, scale, disp, 0); break; /* movzbl */
+        case TYPE_U16: emit_rm_indexed(0, 0x0FB7, work, base, scale, disp, 0); break;  /* movzwl */
+        case TYPE_U32: emit_rm_indexed(0, 0x8B, work, base, scale, disp, 0); break;    /* movl */
+        default:       emit_rm_indexed(1, 0x8B, work, base, scale, disp, 0); break;    /* movq */
+    }
+    emit_store(dst, work);
+}
+
+/* Emit an array element store of the value's low bytes */
+static void emit_array_store(const IrInstr* instr) {
+    int disp = 0;
+    int scale = 1;
+    emit_load(X86_RDX, location_of(instr->args[1]));
+    X86Reg base = element_address(instr->imm, instr->args[0], &disp, &scale);
+    switch (scale) {
+        case 1: emit_rm_indexed(0, 0x88, X86_RDX, base, scale, disp, 0); break;  /* movb */
+        case 2:
+            put_byte(0x66);                                                    /* movw */
+            emit_rm_indexed(0, 0x89, X86_RDX, base, scale, disp, 0);
+            break;
+        case 4: emit_rm_indexed(0, 0x89, X86_RDX, base, scale, disp, 0); break;  /* movl */
+        default: emit_rm_indexed(1, 0x89, X86_RDX, base, scale, disp, 0); break; /* movq */
+    }
+}
+
+/* Emit resetting a local array: rep movsb from its initial image (rep
+ * stosb when it is all zero). rdi and rsi may hold values, so they are
+ * preserved. */
+static void emit_array_init(const IrInstr* instr) {
+    const IrArray* array = &g_func->arrays[instr->imm];
+    int bytes = array->length * element_size(array->elem_type);
+    Operand rdi = reg_operand(X86_RDI);
+    Operand rsi = reg_operand(X86_RSI);
+    Operand dst = mem_operand(X86_RBP, g_array_offsets[instr->imm]);
+
+    emit_push(&rdi);
+    emit_push(&rsi);
+    emit_rm(1, 0x8D, X86_RDI, &dst, 0);                 /* leaq */
+    emit_mov_imm(X86_RCX, bytes);
+    if (array->init_count > 0) {
+        unsigned char* image = xmalloc((size_t)bytes + 1);
+        fill_array_image(image, array);
+        emit_mov_address(X86_RSI, keep_bytes(image, (size_t)bytes));
+        xfree(image);
+        put_byte(0xF3);                                 /* rep movsb */
+        put_byte(0xA4);
+    } else {
+        emit_mov_imm(X86_RAX, 0);
+        put_byte(0xF3);                                 /* rep stosb */
+        put_byte(0xAA);
+    }
+    emit_pop(&rsi);
+    emit_pop(&rdi);
+}
+
+/* Helper: ALU operation of a two-operand IR opcode */
+static AluOp alu_op(IrOpcode op) {
+    switch (op) {
+        case IR_ADD: return ALU_ADD;
+        case IR_SUB: return ALU_SUB;
+        case IR_AND: return ALU_AND;
+        case IR_OR:  return ALU_OR;
+        default:     return ALU_XOR;
+    }
+}
+
+/* Helper: Zero-extend a canonical value of a signed type from its width */
+static void emit_zero_extend(X86Reg reg, CasmType type) {
+    switch (type) {
+        case TYPE_I8:  emit_normalize(reg, TYPE_U8); break;
+        case TYPE_I16: emit_normalize(reg, TYPE_U16); break;
+        case TYPE_I32: emit_normalize(reg, TYPE_U32); break;
+        default:       break;
+    }
+}
+
+/* Shifts run at 32 or 64 bits and rotates at the type's own width; the
+ * hardware masks a %cl count like the IR does */
+static void emit_shift(int value, const IrInstr* instr) {
+    const X86Location* dst = location_of(value);
+    const X86Location* count = location_of(instr->args[1]);
+    int bits = get_type_size_bits(instr->type);
+    int rotate = instr->op == IR_ROTL || instr->op == IR_ROTR;
+    int width = rotate ? bits : (bits == 64 ? 64 : 32);
+    int ext;                                            /* /digit of the D3 group */
+    switch (instr->op) {
+        case IR_SHL:  ext = 4; break;
+        case IR_ROTL: ext = 0; break;
+        case IR_ROTR: ext = 1; break;
+        default:      ext = is_signed_type(instr->type) ? 7 : 5; break;
+    }
+
+    X86Reg work = work_register(dst, NULL);
+    Operand w = reg_operand(work);
+    int immediate = count->kind == X86_LOC_IMM;
+    if (!immediate) emit_load(X86_RCX, count);
+    emit_load(work, location_of(instr->args[0]));
+    if (width == 16) put_byte(0x66);
+    int opcode = (width == 8 ? 0xD2 : 0xD3) - (immediate ? 0x12 : 0);  /* C0/C1 take an imm8 */
+    emit_rm(width == 64, opcode, ext, &w, width == 8);
+    if (immediate) put_byte((int)(count->imm & (width == 64 ? 63 : 31)));
+
+    /* 32-bit operations already zero-extend */
+    if (instr->type != TYPE_U32) emit_normalize(work, instr->type);
+    emit_store(dst, work);
+}
+
+/* popcnt, and bsr/bsf with a cmov for the zero input */
+static void emit_bit_count(int value, const IrInstr* instr) {
+    const X86Location* dst = location_of(value);
+    int bits = get_type_size_bits(instr->type);
+    X86Reg work = work_register(dst, NULL);
+    Operand w = reg_operand(work);
+    Operand rcx = reg_operand(X86_RCX);
+    emit_load(work, location_of(instr->args[0]));
+    if (instr->op == IR_POPCOUNT) {
+        emit_zero_extend(work, instr->type);
+        put_byte(0xF3);
+        emit_rm(1, 0x0FB8, work, &w, 0);                /* popcntq */
+    } else if (instr->op == IR_CLZ) {
+        /* clz = width - 1 - index of the top bit, with index -1 for 0 */
+        Operand top = imm_operand(bits - 1);
+        emit_zero_extend(work, instr->type);
+        emit_mov_imm(X86_RCX, -1);
+        emit_rm(1, 0x0FBD, work, &w, 0);                /* bsrq */
+        emit_rm(1, 0x0F44, work, &rcx, 0);              /* cmovzq */
+        emit_rm(1, 0xF7, 3, &w, 0);                     /* negq */
+        emit_alu(ALU_ADD, &w, &top);
+    } else {
+        /* The low bits of a sign-extended value are its own */
+        emit_mov_imm(X86_RCX, bits);
+        emit_rm(1, 0x0FBC, work, &w, 0);                /* bsfq */
+        emit_rm(1, 0x0F44, work, &rcx, 0);              /* cmovzq */
+    }
+    emit_store(dst, work);
+}
+
+/* Emit one instruction */
+static void emit_instruction(int value) {
+    const IrInstr* instr = &g_func->values[value];
+    const X86Location* dst = location_of(value);
+
+    switch (instr->op) {
+        case IR_CONST:
+            if (dst->kind == X86_LOC_REG) {
+                emit_mov_imm(dst->reg, instr->imm);
+            } else if (dst->kind == X86_LOC_STACK) {
+                emit_mov_imm(X86_RAX, instr->imm);
+                emit_store(dst, X86_RAX);
+            }
+            break;
+
+        case IR_PARAM:      /* Moved into place by the prologue */
+        case IR_UNDEF:
+        case IR_PHI:        /* Written by the predecessors' edge copies */
+            break;
+
+        case IR_CONV: {
+            X86Reg work = work_register(dst, NULL);
+            emit_load(work, location_of(instr->args[0]));
+            emit_normalize(work, instr->type);
+            emit_store(dst, work);
+            break;
+        }
+
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_AND:
+        case IR_OR:
+        case IR_XOR: {
+            const X86Location* lhs = location_of(instr->args[0]);
+            const X86Location* rhs = location_of(instr->args[1]);
+            /* Commutative: let the destination register take the left side */
+            if (instr->op != IR_SUB && dst->kind == X86_LOC_REG && is_reg(rhs, dst->reg)) {
+                const X86Location* tmp = lhs;
+                lhs = rhs;
+                rhs = tmp;
+            }
+            X86Reg work = work_register(dst, rhs);
+            Operand w = reg_operand(work);
+            Operand src = operand(rhs);
+            emit_load(work, lhs);
+            if (instr->op != IR_MUL) {
+                emit_alu(alu_op(instr->op), &w, &src);
+            } else if (src.kind == OPND_IMM) {
+                emit_rm(1, 0x69, work, &w, 0);          /* imulq $imm, %reg */
+                put_u32((uint32_t)src.imm);
+            } else {
+                emit_rm(1, 0x0FAF, work, &src, 0);      /* imulq */
+            }
+            /* Bitwise results of canonical operands are already canonical */
+            if (instr->op == IR_ADD || instr->op == IR_SUB || instr->op == IR_MUL) {
+                emit_normalize(work, instr->type);
+            }
+            emit_store(dst, work);
+            break;
+        }
+
+        case IR_SHL:
+        case IR_SHR:
+        case IR_ROTL:
+        case IR_ROTR:
+            emit_shift(value, instr);
+            break;
+
+        case IR_POPCOUNT:
+        case IR_CLZ:
+        case IR_CTZ:
+            emit_bit_count(value, instr);
+            break;
+
+        case IR_DIV:
+        case IR_MOD:
+            emit_division(value, instr);
+            break;
+
+        case IR_NEG:
+        case IR_NOT: {
+            X86Reg work = work_register(dst, NULL);
+            Operand w = reg_operand(work);
+            emit_load(work, location_of(instr->args[0]));
+            if (instr->op == IR_NEG) {
+                emit_rm(1, 0xF7, 3, &w, 0);
+                emit_normalize(work, instr->type);
+            } else {
+                Operand one = imm_operand(1);
+                emit_alu(ALU_XOR, &w, &one);
+            }
+            emit_store(dst, work);
+            break;
+        }
+
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_GT:
+        case IR_LE:
+        case IR_GE: {
+            if (is_fused_compare(value)) break;
+            int is_signed = is_signed_type(g_func->values[instr->args[0]].type);
+            emit_compare(location_of(instr->args[0]), location_of(instr->args[1]));
+            X86Reg work = dst->kind == X86_LOC_REG ? dst->reg : X86_RAX;
+            Operand w = reg_operand(work);
+            emit_rm(0, 0x0F90 + condition_code(instr->op, is_signed, 0), 0, &w, 1);
+            emit_rm(0, 0x0FB6, work, &w, 1);
+            emit_store(dst, work);
+            break;
+        }
+
+        case IR_CALL:
+            emit_call(value, instr);
+            break;
+
+        case IR_DBG:
+            emit_dbg(instr);
+            break;
+
+        case IR_LOAD:
+            emit_array_load(value, instr);
+            break;
+
+        case IR_STORE:
+            emit_array_store(instr);
+            break;
+
+        case IR_BOUNDS_CHECK: {
+            Operand rcx = reg_operand(X86_RCX);
+            Operand length = imm_operand(ir_array_ref(g_module, g_func, instr->imm)->length);
+            emit_load(X86_RCX, location_of(instr->args[0]));
+            emit_alu(ALU_CMP, &rcx, &length);
+            emit_trap_jump(CC_AE, JIT_TRAP_BOUNDS);
+            break;
+        }
+
+        case IR_ARRAY_INIT:
+            emit_array_init(instr);
+            break;
+    }
+}
+
+/* Helper: Emit restoring the frame and returning */
+static void emit_epilogue(void) {
+    for (int i = 0; i < g_saved_count; i++) {
+        Operand slot = mem_operand(X86_RBP, -8 * (i + 1));
+        emit_rm(1, 0x8B, g_saved_regs[i], &slot, 0);
+    }
+    put_byte(0xC9);     /* leave */
+    put_byte(0xC3);     /* ret */
+}
+
+/* Helper: Emit the edge copies for a jump and the jump itself (omitted
+ * when the target is the next block) */
+static void emit_edge(int from, int to, int nth) {
+    X86Move* moves = NULL;
+    int count = collect_edge_moves(from, to, nth, &moves);
+    emit_parallel_moves(moves, count);
+    xfree(moves);
+    if (to != from + 1) {
+        emit_jmp_block(to);
+    }
+}
+
+/* Emit a block's terminator */
+static void emit_terminator(int b) {
+    const IrTerminator* term = &g_func->blocks[b].term;
+
+    switch (term->kind) {
+        case IR_TERM_JUMP:
+            emit_edge(b, term->targets[0], 0);
+            break;
+
+        case IR_TERM_BRANCH: {
+            int if_true = term->targets[0];
+            int if_false = term->targets[1];
+            int false_nth = if_true == if_false ? 1 : 0;
+            const X86Location* cond = location_of(term->value);
+            const IrInstr* cond_instr = &g_func->values[term->value];
+
+            if (cond->kind == X86_LOC_IMM) {
+                if (cond->imm) {
+                    emit_edge(b, if_true, 0);
+                } else {
+                    emit_edge(b, if_false, false_nth);
+                }
+                break;
+            }
+
+            /* Flags: compare fused into the branch, or the bool against 0 */
+            IrOpcode op = IR_NE;
+            int is_signed = 0;
+            if (is_fused_compare(term->value)) {
+                op = cond_instr->op;
+                is_signed = is_signed_type(g_func->values[cond_instr->args[0]].type);
+                emit_compare(location_of(cond_instr->args[0]), location_of(cond_instr->args[1]));
+            } else {
+                Operand value = operand(cond);
+                Operand zero = imm_operand(0);
+                emit_alu(ALU_CMP, &value, &zero);
+            }
+
+            X86Move* true_moves = NULL;
+            X86Move* false_moves = NULL;
+            int true_count = collect_edge_moves(b, if_true, 0, &true_moves);
+            int false_count = collect_edge_moves(b, if_false, false_nth, &false_moves);
+
+            if (false_count == 0) {
+                emit_jcc_block(condition_code(op, is_signed, 1), if_false);
+                emit_parallel_moves(true_moves, true_count);
+                if (if_true != b + 1) emit_jmp_block(if_true);
+            } else if (true_count == 0) {
+                emit_jcc_block(condition_code(op, is_signed, 0), if_true);
+                emit_parallel_moves(false_moves, false_count);
+                if (if_false != b + 1) emit_jmp_block(if_false);
+            } else {
+                size_t to_false = emit_jcc_forward(condition_code(op, is_signed, 1));
+                emit_parallel_moves(true_moves, true_count);
+                emit_jmp_block(if_true);
+                patch_rel32(to_false, g_code_len);
+                emit_parallel_moves(false_moves, false_count);
+                if (if_false != b + 1) emit_jmp_block(if_false);
+            }
+            xfree(true_moves);
+            xfree(false_moves);
+            break;
+        }
+
+        case IR_TERM_RETURN:
+            if (term->value >= 0) {
+                emit_load(X86_RAX, location_of(term->value));
+            }
+            emit_epilogue();
+            break;
+
+        case IR_TERM_UNREACHABLE:
+        case IR_TERM_NONE:
+            emit_trap_jump(-1, JIT_TRAP_UNREACHABLE);
+            break;
+    }
+}
+
+/* Generate one function into g_code: prologue (frame, stack check,
+ * callee-saved registers, parameters), blocks in IR order, then a stub
+ * for each trap the function can raise */
+static void generate_function(const IrFunction* func) {
+    X86Allocation* alloc = x86_allocate_registers(func);
+    g_func = func;
+    g_alloc = alloc;
+    g_code_len = 0;
+    g_fixup_count = 0;
+    memset(g_trap_used, 0, sizeof(g_trap_used));
+
+    g_use_counts = xmalloc((func->value_count + 1) * sizeof(int));
+    memset(g_use_counts, 0, (func->value_count + 1) * sizeof(int));
+    for (int v = 0; v < func->value_count; v++) {
+        for (int a = 0; a < func->values[v].arg_count; a++) {
+            g_use_counts[func->values[v].args[a]]++;
+        }
+    }
+    for (int b = 0; b < func->block_count; b++) {
+        const IrTerminator* term = &func->blocks[b].term;
+        if (term->value >= 0 && (term->kind == IR_TERM_BRANCH || term->kind == IR_TERM_RETURN)) {
+            g_use_counts[term->value]++;
+        }
+    }
+
+    g_saved_count = 0;
+    for (int r = 0; r < X86_REG_COUNT; r++) {
+        if ((alloc->used_regs & (1u << r)) && !x86_reg_is_caller_saved((X86Reg)r)) {
+            g_saved_regs[g_saved_count++] = (X86Reg)r;
+        }
+    }
+    int frame = 8 * (g_saved_count + alloc->slot_count);
+    /* Local arrays sit below the spill slots, each 8-byte aligned */
+    g_array_offsets = xmalloc((func->array_count + 1) * sizeof(int));
+    for (int i = 0; i < func->array_count; i++) {
+        int bytes = func->arrays[i].length * element_size(func->arrays[i].elem_type);
+        frame += (bytes + 7) & ~7;
+        g_array_offsets[i] = -frame;
+    }
+    frame = (frame + 15) & ~15;
+
+    Operand rsp = reg_operand(X86_RSP);
+    Operand rbp = reg_operand(X86_RBP);
+    emit_push(&rbp);
+    emit_rm(1, 0x89, X86_RSP, &rbp, 0);                 /* movq %rsp, %rbp */
+
+    /* movabs &g_stack_limit, %rax; cmpq (%rax), %rsp; jb trap. Frames
+     * with arrays can be large, so those check where rsp will end up
+     * (computed in r11, which holds no argument). */
+    emit_mov_address(X86_RAX, &g_stack_limit);
+    Operand limit_operand = mem_operand(X86_RAX, 0);
+    if (func->array_count > 0) {
+        Operand r11 = reg_operand(X86_R11);
+        Operand below = mem_operand(X86_RSP, -frame);
+        emit_rm(1, 0x8D, X86_R11, &below, 0);           /* leaq -frame(%rsp), %r11 */
+        emit_alu(ALU_CMP, &r11, &limit_operand);
+    } else {
+        emit_alu(ALU_CMP, &rsp, &limit_operand);
+    }
+    emit_trap_jump(CC_B, JIT_TRAP_STACK);
+
+    if (frame > 0) {
+        Operand size = imm_operand(frame);
+        emit_alu(ALU_SUB, &rsp, &size);
+    }
+    for (int i = 0; i < g_saved_count; i++) {
+        Operand slot = mem_operand(X86_RBP, -8 * (i + 1));
+        emit_rm(1, 0x89, g_saved_regs[i], &slot, 0);
+    }
+
+    /* Parameters: register arguments as one parallel copy, then the ones
+     * the caller pushed */
+    X86Move moves[6];
+    int move_count = 0;
+    const IrBlock* entry = &func->blocks[0];
+    for (int i = 0; i < entry->instr_count; i++) {
+        int v = entry->instrs[i];
+        const IrInstr* instr = &func->values[v];
+        if (instr->op != IR_PARAM || instr->imm >= 6) continue;
+        moves[move_count].dst = *location_of(v);
+        moves[move_count].src.kind = X86_LOC_REG;
+        moves[move_count].src.reg = g_arg_regs[instr->imm];
+        moves[move_count].src.slot = -1;
+        moves[move_count].src.imm = 0;
+        if (!same_location(&moves[move_count].dst, &moves[move_count].src)) move_count++;
+    }
+    emit_parallel_moves(moves, move_count);
+    for (int i = 0; i < entry->instr_count; i++) {
+        int v = entry->instrs[i];
+        const IrInstr* instr = &func->values[v];
+        if (instr->op != IR_PARAM || instr->imm < 6) continue;
+        Operand slot = mem_operand(X86_RBP, 16 + 8 * (int)(instr->imm - 6));
+        emit_rm(1, 0x8B, X86_RAX, &slot, 0);
+        emit_store(location_of(v), X86_RAX);
+    }
+
+    size_t* block_offsets = xmalloc((func->block_count + 1) * sizeof(size_t));
+    for (int b = 0; b < func->block_count; b++) {
+        const IrBlock* block = &func->blocks[b];
+        block_offsets[b] = g_code_len;
+        for (int i = 0; i < block->instr_count; i++) {
+            emit_instruction(block->instrs[i]);
+        }
+        emit_terminator(b);
+    }
+
+    /* Trap stubs: realign the stack and call jit_trap(kind), which does
+     * not return */
+    size_t trap_offsets[JIT_TRAP_COUNT] = {0};
+    for (int t = 0; t < JIT_TRAP_COUNT; t++) {
+        if (!g_trap_used[t]) continue;
+        trap_offsets[t] = g_code_len;
+        Operand align = imm_operand(-16);
+        emit_alu(ALU_AND, &rsp, &align);
+        emit_mov_imm(X86_RDI, t);
+        emit_call_helper((JitHelper)jit_trap);
+    }
+
+    for (int i = 0; i < g_fixup_count; i++) {
+        int target = g_fixups[i].target;
+        patch_rel32(g_fixups[i].pos, target >= 0 ? block_offsets[target] : trap_offsets[-target - 1]);
+    }
+
+    xfree(block_offsets);
+    xfree(g_use_counts);
+    g_use_counts = NULL;
+    xfree(g_array_offsets);
+    g_array_offsets = NULL;
+    x86_allocation_free(alloc);
+    g_alloc = NULL;
+    g_func = NULL;
+}
+
+/* Helper: Copy g_code into fresh executable memory */
+static unsigned char* make_executable(size_t* out_size) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t size = (g_code_len + (size_t)page - 1) / (size_t)page * (size_t)page;
+    void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return NULL;
+    memcpy(mem, g_code, g_code_len);
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, size);
+        return NULL;
+    }
+    *out_size = size;
+    return mem;
+}
+
+/* Called by a function's stub on its first call: compile it, point its
+ * table entry at the native code and return that for the stub to jump to */
+static unsigned char* jit_compile_lazy(long long index) {
+    generate_function(g_module->functions[index]);
+    unsigned char* code = make_executable(&g_mapping_sizes[index]);
+    if (!code) {
+        jit_trap(JIT_TRAP_MEMORY);
+    }
+    g_mappings[index] = code;
+    g_entries[index] = code;
+    return code;
+}
+
+/* Build the stubs: save the argument registers, call
+ * jit_compile_lazy(index) with an aligned stack, restore them and jump to
+ * the compiled code, so the arguments (including any on the stack) reach
+ * it untouched */
+static int build_stubs(void) {
+    static const X86Reg saved[6] = { X86_RDI, X86_RSI, X86_RDX, X86_RCX, X86_R8, X86_R9 };
+    int count = g_module->function_count;
+    size_t* offsets = xmalloc((count + 1) * sizeof(size_t));
+    Operand rsp = reg_operand(X86_RSP);
+    Operand eight = imm_operand(8);
+
+    g_code_len = 0;
+    for (int f = 0; f < count; f++) {
+        offsets[f] = g_code_len;
+        for (int i = 0; i < 6; i++) {
+            Operand r = reg_operand(saved[i]);
+            emit_push(&r);
+        }
+        emit_alu(ALU_SUB, &rsp, &eight);
+        emit_mov_imm(X86_RDI, f);
+        emit_call_helper((JitHelper)jit_compile_lazy);
+        emit_alu(ALU_ADD, &rsp, &eight);
+        for (int i = 5; i >= 0; i--) {
+            Operand r = reg_operand(saved[i]);
+            emit_pop(&r);
+        }
+        put_byte(0xFF);     /* jmp *%rax */
+        put_byte(0xE0);
+    }
+
+    g_stubs = make_executable(&g_stubs_size);
+    if (g_stubs) {
+        for (int f = 0; f < count; f++) {
+            g_entries[f] = g_stubs + offsets[f];
+        }
+    }
+    xfree(offsets);
+    return g_stubs != NULL;
+}
+
+/* Helper: Allow native code the stack below here, within the rlimit */
+static void set_stack_limit(void) {
+    uintptr_t here = (uintptr_t)__builtin_frame_address(0);
+    struct rlimit limit;
+    long budget = STACK_BUDGET_MAX;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY &&
+        limit.rlim_cur < (rlim_t)STACK_BUDGET_MAX) {
+        budget = (long)limit.rlim_cur;
+    }
+    budget = budget > 2 * STACK_MARGIN ? budget - STACK_MARGIN : budget / 2;
+    g_stack_limit = here - (uintptr_t)budget;
+}
+
+/* Helper: Call main; returns 0 if a trap ended the program */
+static int run_entry(int main_index, long long* value) {
+    if (setjmp(g_trap_jump) != 0) return 0;
+    long long (*entry)(void);
+    memcpy(&entry, &g_entries[main_index], sizeof(entry));
+    *value = entry();
+    return 1;
+}
+
+int jit_x86_supported(void) {
+    return 1;
+}
+
+InterpretResult jit_x86_run_main(const IrModule* module, const char* source_filename, FILE* out) {
+    InterpretResult result = {1, NULL, 0};
+    int count = module->function_count;
+    int main_index = -1;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(module->functions[i]->name, "main") == 0) main_index = i;
+    }
+    if (main_index < 0) {
+        result.success = 0;
+        result.error_msg = xstrdup("no main function");
+        return result;
+    }
+
+    g_module = module;
+    g_source_filename = source_filename ? source_filename : "unknown.csm";
+    g_out = out;
+    g_out_len = 0;
+    g_entries = xmalloc(count * sizeof(void*));
+    g_mappings = xmalloc(count * sizeof(unsigned char*));
+    g_mapping_sizes = xmalloc(count * sizeof(size_t));
+    for (int i = 0; i < count; i++) {
+        g_mappings[i] = NULL;
+        g_mapping_sizes[i] = 0;
+    }
+
+    size_t global_bytes = 0;
+    g_global_offsets = xmalloc((module->global_count + 1) * sizeof(size_t));
+    for (int i = 0; i < module->global_count; i++) {
+        g_global_offsets[i] = global_bytes;
+        size_t bytes = (size_t)module->globals[i].length * element_size(module->globals[i].elem_type);
+        global_bytes += (bytes + 7) & ~(size_t)7;
+    }
+    g_globals = xmalloc(global_bytes + 1);
+    for (int i = 0; i < module->global_count; i++) {
+        fill_array_image(g_globals + g_global_offsets[i], &module->globals[i]);
+    }
+
+    if (!build_stubs()) {
+        result.success = 0;
+        result.error_msg = xstrdup(g_trap_messages[JIT_TRAP_MEMORY]);
+    } else {
+        long long value = 0;
+        set_stack_limit();
+        if (run_entry(main_index, &value)) {
+            result.result = module->functions[main_index]->return_type == TYPE_VOID ? 0 : value;
+        } else {
+            result.success = 0;
+            result.error_msg = xstrdup(g_trap_messages[g_trap]);
+        }
+    }
+
+    out_flush();
+    fflush(out);
+
+    for (int i = 0; i < count; i++) {
+        if (g_mappings[i]) munmap(g_mappings[i], g_mapping_sizes[i]);
+    }
+    if (g_stubs) munmap(g_stubs, g_stubs_size);
+    for (int i = 0; i < g_text_count; i++) {
+        xfree(g_texts[i]);
+    }
+    xfree(g_texts);
+    xfree(g_entries);
+    xfree(g_mappings);
+    xfree(g_mapping_sizes);
+    xfree(g_code);
+    xfree(g_fixups);
+    xfree(g_globals);
+    xfree(g_global_offsets);
+    g_globals = NULL;
+    g_global_offsets = NULL;
+    g_texts = NULL;
+    g_text_count = 0;
+    g_text_capacity = 0;
+    g_entries = NULL;
+    g_mappings = NULL;
+    g_mapping_sizes = NULL;
+    g_stubs = NULL;
+    g_code = NULL;
+    g_code_len = 0;
+    g_code_capacity = 0;
+    g_fixups = NULL;
+    g_fixup_count = 0;
+    g_fixup_capacity = 0;
+    g_module = NULL;
+    g_out = NULL;
+    return result;
+}
+
+#else /* !JIT_SUPPORTED */
+
+int jit_x86_supported(void) {
+    return 0;
+}
+
+InterpretResult jit_x86_run_main(const IrModule* module, const char* source_filename, FILE* out) {
+    InterpretResult result = {0, NULL, 0};
+    (void)module;
+    (void)source_filename;
+    (void)out;
+    result.error_msg = xstrdup("the JIT needs x86-64 Linux");
+    return result;
+}
+
+#endif /* JIT_SUPPORTED */
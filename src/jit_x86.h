@@ -0,0 +1,27 @@
+#ifndef JIT_X86_H
+#define JIT_X86_H
+
+#include <stdio.h>
+#include "ir.h"
+#include "interpreter.h"
+
+/* Whether this build can generate and run native code (x86-64 Linux) */
+int jit_x86_supported(void);
+
+/* Run `main` of a verified IR module as native x86-64 code.
+ *
+ * Functions are compiled on their first call: each starts out as a small
+ * stub that compiles the function into its own mmap'd executable memory
+ * and patches the function's entry in the call table, so later calls go
+ * straight to native code and functions that never run are never
+ * compiled. Code generation uses the same IR and register allocation as
+ * the x86-64 assembly backend.
+ *
+ * Behaves like bc_run_main(): dbg output is buffered and written to
+ * `out`, and division by zero, signed division overflow, unreachable
+ * code and running out of stack stop the program with an error. The
+ * module (and the AST its dbg statements point into) must stay alive
+ * until this returns. */
+InterpretResult jit_x86_run_main(const IrModule* module, const char* source_filename, FILE* out);
+
+#endif /* JIT_X86_H */
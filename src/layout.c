@@ -0,0 +1,47 @@
+#include "layout.h"
+#include "types.h"
+
+int layout_type_size(CasmType type) {
+    int bits = get_type_size_bits(type);
+    return bits > 0 ? bits / 8 : 1;
+}
+
+void layout_fields_by_offset(const ASTStructDef* def, int* order) {
+    /* Insertion sort: stable, and structs are small */
+    for (int i = 0; i < def->field_count; i++) {
+        int j = i;
+        while (j > 0 && def->fields[order[j - 1]].offset > def->fields[i].offset) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+}
+
+void layout_struct(ASTStructDef* def) {
+    int offset = 0;
+    int align = 1;
+    
+    if (def->packed) {
+        for (int i = 0; i < def->field_count; i++) {
+            def->fields[i].offset = offset;
+            offset += layout_type_size(def->fields[i].type.type);
+        }
+        def->size = offset;
+        def->align = 1;
+        return;
+    }
+    
+    /* Largest alignment first: every field then starts aligned */
+    for (int size = 8; size >= 1; size /= 2) {
+        for (int i = 0; i < def->field_count; i++) {
+            if (layout_type_size(def->fields[i].type.type) == size) {
+                def->fields[i].offset = offset;
+                offset += size;
+                if (size > align) align = size;
+            }
+        }
+    }
+    def->size = (offset + align - 1) / align * align;
+    def->align = align;
+}
@@ -0,0 +1,20 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "ast.h"
+
+/* Struct layout. Fields of a normal struct are placed in decreasing order
+ * of alignment (declaration order breaks ties), which leaves no padding
+ * between fields and only rounds the total size up to the largest
+ * alignment. A `packed` struct keeps declaration order with no padding at
+ * all and an alignment of 1. Every backend reads the offsets chosen here,
+ * so the C backend emits the fields in offset order. */
+void layout_struct(ASTStructDef* def);
+
+/* Byte size (= natural alignment) of an integer field type */
+int layout_type_size(CasmType type);
+
+/* Fill `order` (field_count entries) with field indices sorted by offset */
+void layout_fields_by_offset(const ASTStructDef* def, int* order);
+
+#endif /* LAYOUT_H */
@@ -142,6 +142,7 @@ static Token scan_identifier(Lexer* lexer) {
             if (strncmp(text, "i8", 2) == 0) type = TOK_I8;
             else if (strncmp(text, "u8", 2) == 0) type = TOK_U8;
             else if (strncmp(text, "if", 2) == 0) type = TOK_IF;
+            else if (strncmp(text, "as", 2) == 0) type = TOK_AS;
             break;
         case 3:
             if (strncmp(text, "i32", 3) == 0) type = TOK_I32;
@@ -165,10 +166,16 @@ static Token scan_identifier(Lexer* lexer) {
         case 5:
             if (strncmp(text, "while", 5) == 0) type = TOK_WHILE;
             else if (strncmp(text, "false", 5) == 0) type = TOK_FALSE;
+            else if (strncmp(text, "break", 5) == 0) type = TOK_BREAK;
             break;
         case 6:
             if (strncmp(text, "return", 6) == 0) type = TOK_RETURN;
             else if (strncmp(text, "import", 6) == 0) type = TOK_IMPORT;
+            else if (strncmp(text, "struct", 6) == 0) type = TOK_STRUCT;
+            else if (strncmp(text, "packed", 6) == 0) type = TOK_PACKED;
+            break;
+        case 8:
+            if (strncmp(text, "continue", 8) == 0) type = TOK_CONTINUE;
             break;
     }
     
@@ -234,13 +241,18 @@ static Token next_token_impl(Lexer* lexer) {
         case ')': return make_token(lexer, TOK_RPAREN, start, 1);
         case '{': return make_token(lexer, TOK_LBRACE, start, 1);
         case '}': return make_token(lexer, TOK_RBRACE, start, 1);
+        case '[': return make_token(lexer, TOK_LBRACKET, start, 1);
+        case ']': return make_token(lexer, TOK_RBRACKET, start, 1);
         case ';': return make_token(lexer, TOK_SEMICOLON, start, 1);
         case ',': return make_token(lexer, TOK_COMMA, start, 1);
+        case '.': return make_token(lexer, TOK_DOT, start, 1);
         case '+': return make_token(lexer, TOK_PLUS, start, 1);
         case '-': return make_token(lexer, TOK_MINUS, start, 1);
         case '*': return make_token(lexer, TOK_STAR, start, 1);
         case '/': return make_token(lexer, TOK_SLASH, start, 1);
         case '%': return make_token(lexer, TOK_PERCENT, start, 1);
+        case '^': return make_token(lexer, TOK_CARET, start, 1);
+        case '~': return make_token(lexer, TOK_TILDE, start, 1);
         case '#': return make_token(lexer, TOK_HASH, start, 1);
         case ':': return make_token(lexer, TOK_COLON, start, 1);
         case '"': return scan_string(lexer);
@@ -264,6 +276,10 @@ static Token next_token_impl(Lexer* lexer) {
     }
     
     if (c == '<') {
+        if (peek(lexer) == '<') {
+            advance(lexer);
+            return make_token(lexer, TOK_SHL, start, 2);
+        }
         if (peek(lexer) == '=') {
             advance(lexer);
             return make_token(lexer, TOK_LE, start, 2);
@@ -272,6 +288,10 @@ static Token next_token_impl(Lexer* lexer) {
     }
     
     if (c == '>') {
+        if (peek(lexer) == '>') {
+            advance(lexer);
+            return make_token(lexer, TOK_SHR, start, 2);
+        }
         if (peek(lexer) == '=') {
             advance(lexer);
             return make_token(lexer, TOK_GE, start, 2);
@@ -287,7 +307,7 @@ static Token next_token_impl(Lexer* lexer) {
             token.location.column = start_col;
             return token;
         }
-        Token token = make_token(lexer, TOK_ERROR, start, 1);
+        Token token = make_token(lexer, TOK_AMP, start, 1);
         token.location.line = line;
         token.location.column = start_col;
         return token;
@@ -301,7 +321,7 @@ static Token next_token_impl(Lexer* lexer) {
             token.location.column = start_col;
             return token;
         }
-        Token token = make_token(lexer, TOK_ERROR, start, 1);
+        Token token = make_token(lexer, TOK_PIPE, start, 1);
         token.location.line = line;
         token.location.column = start_col;
         return token;
@@ -370,11 +390,16 @@ const char* token_type_name(TokenType type) {
         case TOK_WHILE: return "WHILE";
         case TOK_FOR: return "FOR";
         case TOK_RETURN: return "RETURN";
+        case TOK_BREAK: return "BREAK";
+        case TOK_CONTINUE: return "CONTINUE";
         case TOK_DBG: return "DBG";
         case TOK_TRUE: return "TRUE";
         case TOK_FALSE: return "FALSE";
          case TOK_IMPORT: return "IMPORT";
         case TOK_FROM: return "FROM";
+        case TOK_STRUCT: return "STRUCT";
+        case TOK_PACKED: return "PACKED";
+        case TOK_AS: return "AS";
         case TOK_HASH: return "HASH";
         case TOK_COLON: return "COLON";
         case TOK_STRING: return "STRING";
@@ -393,12 +418,21 @@ const char* token_type_name(TokenType type) {
         case TOK_AND: return "AND";
         case TOK_OR: return "OR";
         case TOK_NOT: return "NOT";
+        case TOK_AMP: return "AMP";
+        case TOK_PIPE: return "PIPE";
+        case TOK_CARET: return "CARET";
+        case TOK_TILDE: return "TILDE";
+        case TOK_SHL: return "SHL";
+        case TOK_SHR: return "SHR";
         case TOK_LPAREN: return "LPAREN";
         case TOK_RPAREN: return "RPAREN";
         case TOK_LBRACE: return "LBRACE";
         case TOK_RBRACE: return "RBRACE";
+        case TOK_LBRACKET: return "LBRACKET";
+        case TOK_RBRACKET: return "RBRACKET";
         case TOK_SEMICOLON: return "SEMICOLON";
         case TOK_COMMA: return "COMMA";
+        case TOK_DOT: return "DOT";
         case TOK_EOF: return "EOF";
         case TOK_ERROR: return "ERROR";
     }
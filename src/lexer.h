@@ -27,6 +27,8 @@ typedef enum {
     TOK_WHILE,
     TOK_FOR,
     TOK_RETURN,
+    TOK_BREAK,
+    TOK_CONTINUE,
     
     /* Keywords - Debug */
     TOK_DBG,
@@ -39,6 +41,13 @@ typedef enum {
     TOK_IMPORT,
     TOK_FROM,
     
+    /* Keywords - Structs */
+    TOK_STRUCT,
+    TOK_PACKED,
+    
+    /* Keywords - Casts */
+    TOK_AS,
+    
     /* Operators */
     TOK_HASH,        /* # */
     TOK_COLON,       /* : */
@@ -58,14 +67,23 @@ typedef enum {
     TOK_AND,         /* && */
     TOK_OR,          /* || */
     TOK_NOT,         /* ! */
+    TOK_AMP,         /* & */
+    TOK_PIPE,        /* | */
+    TOK_CARET,       /* ^ */
+    TOK_TILDE,       /* ~ */
+    TOK_SHL,         /* << */
+    TOK_SHR,         /* >> */
     
     /* Delimiters */
     TOK_LPAREN,      /* ( */
     TOK_RPAREN,      /* ) */
     TOK_LBRACE,      /* { */
     TOK_RBRACE,      /* } */
+    TOK_LBRACKET,    /* [ */
+    TOK_RBRACKET,    /* ] */
     TOK_SEMICOLON,   /* ; */
     TOK_COMMA,       /* , */
+    TOK_DOT,         /* . */
     
     /* Special */
     TOK_EOF,
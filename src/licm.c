@@ -0,0 +1,712 @@
+#include <stdio.h>
+#include <string.h>
+#include "licm.h"
+#include "call_graph.h"
+#include "optimizer.h"
+#include "utils.h"
+
+/* A loop's hoisted expressions become `T invN = expr;` declarations in a
+ * bare block wrapped around the loop. Loops are handled outside-in, so an
+ * expression invariant in both an outer and an inner loop leaves both.
+ *
+ * An expression is invariant if it mentions no variable that the loop
+ * assigns or declares (matched by name, which is conservative under
+ * shadowing) and calls only pure functions. The loop condition is
+ * evaluated on every entry, so its unconditional parts may be hoisted as
+ * they are; everything else runs zero or more times and must also be safe
+ * to evaluate speculatively. */
+
+typedef struct {
+    const char** names;
+    int count;
+    int capacity;
+} NameList;
+
+typedef struct {
+    ASTProgram* program;
+    int* pure;              /* Per function: no dbg() or global array access here or below */
+    int* speculative;       /* Per function: pure and always returns normally */
+
+    NameList variant;       /* Names assigned or declared in the current loop */
+    NameList taken;         /* Names a new local must avoid */
+    char** owned;           /* Generated names (owned copies) */
+    int owned_count;
+    int next_temp;
+
+    ASTStatement* hoisted;  /* Declarations for the current loop */
+    int hoisted_count;
+    int hoisted_total;
+} Licm;
+
+/* Helper: Add a name to a list (no duplicates) */
+static void name_list_add(NameList* list, const char* name) {
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->names[i], name) == 0) return;
+    }
+    if (list->count >= list->capacity) {
+        list->capacity = (list->capacity == 0) ? 32 : list->capacity * 2;
+        list->names = xrealloc(list->names, list->capacity * sizeof(const char*));
+    }
+    list->names[list->count++] = name;
+}
+
+static int name_list_contains(const NameList* list, const char* name) {
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->names[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+/* ========================================================================
+ * Function summaries
+ * ======================================================================== */
+
+/* Helper: Check if a divisor is a constant that cannot trap */
+static int is_safe_divisor(const ASTExpression* expr) {
+    if (expr->type != EXPR_LITERAL || expr->as.literal.type != LITERAL_INT) return 0;
+    long value = expr->as.literal.value.int_value;
+    return value != 0 && value != -1;
+}
+
+/* Helper: Check if evaluating an expression can trap, apart from calls */
+static int expression_may_trap(const ASTExpression* expr) {
+    if (!expr) return 0;
+
+    switch (expr->type) {
+        case EXPR_BINARY_OP: {
+            const ASTBinaryOp* bin = &expr->as.binary_op;
+            if ((bin->op == BINOP_DIV || bin->op == BINOP_MOD) && !is_safe_divisor(bin->right)) {
+                return 1;
+            }
+            return expression_may_trap(bin->left) || expression_may_trap(bin->right);
+        }
+        case EXPR_UNARY_OP:
+            return expression_may_trap(expr->as.unary_op.operand);
+        case EXPR_INDEX:
+            return expr->as.index.bounds_checked || expression_may_trap(expr->as.index.index);
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                if (expression_may_trap(&expr->as.function_call.arguments[i])) return 1;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Check if a body is loop-free and cannot trap by itself */
+static int block_is_straight_line(const ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        const ASTStatement* stmt = &block->statements[i];
+        switch (stmt->type) {
+            case STMT_WHILE:
+            case STMT_FOR:
+                return 0;
+            case STMT_RETURN:
+                if (expression_may_trap(stmt->as.return_stmt.value)) return 0;
+                break;
+            case STMT_EXPR:
+                if (expression_may_trap(stmt->as.expr_stmt.expr)) return 0;
+                break;
+            case STMT_VAR_DECL:
+                if (expression_may_trap(stmt->as.var_decl_stmt.var_decl.initializer)) return 0;
+                break;
+            case STMT_IF: {
+                const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+                if (expression_may_trap(if_stmt->condition) ||
+                    !block_is_straight_line(&if_stmt->then_body)) {
+                    return 0;
+                }
+                for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                    if (expression_may_trap(clause->condition) ||
+                        !block_is_straight_line(&clause->body)) {
+                        return 0;
+                    }
+                }
+                if (if_stmt->else_body && !block_is_straight_line(if_stmt->else_body)) return 0;
+                break;
+            }
+            case STMT_BLOCK:
+                if (!block_is_straight_line(&stmt->as.block_stmt.block)) return 0;
+                break;
+            case STMT_DBG:
+            case STMT_BREAK:
+            case STMT_CONTINUE:
+                break;
+        }
+    }
+    return 1;
+}
+
+/* Helper: Find which functions are pure and which can also be called
+ * speculatively (straight-line, non-recursive, speculative callees) */
+static void summarize_functions(Licm* l, CallGraph* graph) {
+    int n = l->program->function_count;
+    l->pure = call_graph_find_pure_functions(graph, l->program);
+    l->speculative = xmalloc(n * sizeof(int));
+    memset(l->speculative, 0, n * sizeof(int));
+
+    /* Built bottom-up, so functions on a call cycle never qualify */
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < n; i++) {
+            if (l->speculative[i] || !l->pure[i] ||
+                !block_is_straight_line(&l->program->functions[i].body)) {
+                continue;
+            }
+            int ok = 1;
+            for (int j = 0; j < graph->nodes[i].callee_count && ok; j++) {
+                for (int k = 0; k < n; k++) {
+                    if (graph->nodes[k].symbol_id == graph->nodes[i].callees[j].callee_id &&
+                        !l->speculative[k]) {
+                        ok = 0;
+                        break;
+                    }
+                }
+            }
+            if (ok) {
+                l->speculative[i] = 1;
+                changed = 1;
+            }
+        }
+    }
+}
+
+/* Helper: Check a property for every function a call may resolve to */
+static int call_has(const Licm* l, const int* property, const char* name) {
+    int found = 0;
+    for (int i = 0; i < l->program->function_count; i++) {
+        if (strcmp(l->program->functions[i].name, name) == 0) {
+            if (!property[i]) return 0;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+/* ========================================================================
+ * Loop analysis
+ * ======================================================================== */
+
+static void collect_variant_block(Licm* l, const ASTBlock* block);
+
+static void collect_variant_expression(Licm* l, const ASTExpression* expr) {
+    if (!expr) return;
+
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            if (expr->as.binary_op.op == BINOP_ASSIGN &&
+                expr->as.binary_op.left->type == EXPR_VARIABLE) {
+                name_list_add(&l->variant, expr->as.binary_op.left->as.variable.name);
+            }
+            /* A field store changes the whole struct (as a call argument) */
+            if (expr->as.binary_op.op == BINOP_ASSIGN &&
+                expr->as.binary_op.left->type == EXPR_FIELD) {
+                name_list_add(&l->variant, expr->as.binary_op.left->as.field.object_name);
+            }
+            collect_variant_expression(l, expr->as.binary_op.left);
+            collect_variant_expression(l, expr->as.binary_op.right);
+            break;
+        case EXPR_UNARY_OP:
+            collect_variant_expression(l, expr->as.unary_op.operand);
+            break;
+        case EXPR_INDEX:
+            collect_variant_expression(l, expr->as.index.index);
+            break;
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                collect_variant_expression(l, &expr->as.function_call.arguments[i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void collect_variant_statement(Licm* l, const ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            collect_variant_expression(l, stmt->as.return_stmt.value);
+            break;
+        case STMT_EXPR:
+            collect_variant_expression(l, stmt->as.expr_stmt.expr);
+            break;
+        case STMT_VAR_DECL:
+            name_list_add(&l->variant, stmt->as.var_decl_stmt.var_decl.name);
+            collect_variant_expression(l, stmt->as.var_decl_stmt.var_decl.initializer);
+            break;
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            collect_variant_expression(l, if_stmt->condition);
+            collect_variant_block(l, &if_stmt->then_body);
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                collect_variant_expression(l, clause->condition);
+                collect_variant_block(l, &clause->body);
+            }
+            if (if_stmt->else_body) collect_variant_block(l, if_stmt->else_body);
+            break;
+        }
+        case STMT_WHILE:
+            collect_variant_expression(l, stmt->as.while_stmt.condition);
+            collect_variant_block(l, &stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            if (stmt->as.for_stmt.init) collect_variant_statement(l, stmt->as.for_stmt.init);
+            collect_variant_expression(l, stmt->as.for_stmt.condition);
+            collect_variant_expression(l, stmt->as.for_stmt.update);
+            collect_variant_block(l, &stmt->as.for_stmt.body);
+            break;
+        case STMT_BLOCK:
+            collect_variant_block(l, &stmt->as.block_stmt.block);
+            break;
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                collect_variant_expression(l, &stmt->as.dbg_stmt.arguments[i]);
+            }
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+}
+
+static void collect_variant_block(Licm* l, const ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        collect_variant_statement(l, &block->statements[i]);
+    }
+}
+
+/* Helper: Check if an expression has the same value on every iteration */
+static int is_invariant(const Licm* l, const ASTExpression* expr) {
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            return 1;
+        case EXPR_VARIABLE:
+            return !name_list_contains(&l->variant, expr->as.variable.name);
+        case EXPR_UNARY_OP:
+            return is_invariant(l, expr->as.unary_op.operand);
+        case EXPR_BINARY_OP:
+            return expr->as.binary_op.op != BINOP_ASSIGN &&
+                   is_invariant(l, expr->as.binary_op.left) &&
+                   is_invariant(l, expr->as.binary_op.right);
+        case EXPR_FUNCTION_CALL:
+            if (!call_has(l, l->pure, expr->as.function_call.function_name)) return 0;
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                if (!is_invariant(l, &expr->as.function_call.arguments[i])) return 0;
+            }
+            return 1;
+        case EXPR_INDEX:
+            /* Element stores are not tracked */
+            return 0;
+        case EXPR_FIELD:
+            return !name_list_contains(&l->variant, expr->as.field.object_name);
+    }
+    return 0;
+}
+
+/* Helper: Check if an (invariant) expression may be evaluated even when
+ * the original code would not have reached it */
+static int is_speculative(const Licm* l, const ASTExpression* expr) {
+    switch (expr->type) {
+        case EXPR_LITERAL:
+        case EXPR_VARIABLE:
+        case EXPR_FIELD:
+            return 1;
+        case EXPR_UNARY_OP:
+            return is_speculative(l, expr->as.unary_op.operand);
+        case EXPR_BINARY_OP: {
+            const ASTBinaryOp* bin = &expr->as.binary_op;
+            if ((bin->op == BINOP_DIV || bin->op == BINOP_MOD) && !is_safe_divisor(bin->right)) {
+                return 0;
+            }
+            return is_speculative(l, bin->left) && is_speculative(l, bin->right);
+        }
+        case EXPR_FUNCTION_CALL:
+            if (!call_has(l, l->speculative, expr->as.function_call.function_name)) return 0;
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                if (!is_speculative(l, &expr->as.function_call.arguments[i])) return 0;
+            }
+            return 1;
+        case EXPR_INDEX:
+            return 0;
+    }
+    return 0;
+}
+
+/* Helper: Check if an expression does enough work to be worth a local.
+ * Narrow types are skipped: the backends promote them differently. */
+static int worth_hoisting(const ASTExpression* expr) {
+    switch (expr->resolved_type) {
+        case TYPE_I32:
+        case TYPE_I64:
+        case TYPE_U32:
+        case TYPE_U64:
+        case TYPE_BOOL:
+            break;
+        default:
+            return 0;
+    }
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+        case EXPR_FUNCTION_CALL:
+            return 1;
+        case EXPR_UNARY_OP:
+            return worth_hoisting(expr->as.unary_op.operand);
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Structural equality, used to share one local between copies */
+static int expressions_equal(const ASTExpression* a, const ASTExpression* b) {
+    if (a->type != b->type || a->resolved_type != b->resolved_type) return 0;
+
+    switch (a->type) {
+        case EXPR_LITERAL:
+            if (a->as.literal.type != b->as.literal.type) return 0;
+            if (a->as.literal.type == LITERAL_BOOL) {
+                return a->as.literal.value.bool_value == b->as.literal.value.bool_value;
+            }
+            return a->as.literal.value.int_value == b->as.literal.value.int_value;
+        case EXPR_VARIABLE:
+            return strcmp(a->as.variable.name, b->as.variable.name) == 0;
+        case EXPR_UNARY_OP:
+            return a->as.unary_op.op == b->as.unary_op.op &&
+                   expressions_equal(a->as.unary_op.operand, b->as.unary_op.operand);
+        case EXPR_BINARY_OP:
+            return a->as.binary_op.op == b->as.binary_op.op &&
+                   expressions_equal(a->as.binary_op.left, b->as.binary_op.left) &&
+                   expressions_equal(a->as.binary_op.right, b->as.binary_op.right);
+        case EXPR_FUNCTION_CALL:
+            if (strcmp(a->as.function_call.function_name, b->as.function_call.function_name) != 0 ||
+                a->as.function_call.argument_count != b->as.function_call.argument_count) {
+                return 0;
+            }
+            for (int i = 0; i < a->as.function_call.argument_count; i++) {
+                if (!expressions_equal(&a->as.function_call.arguments[i],
+                                       &b->as.function_call.arguments[i])) {
+                    return 0;
+                }
+            }
+            return 1;
+        case EXPR_INDEX:
+            return a->as.index.global_index == b->as.index.global_index &&
+                   strcmp(a->as.index.array_name, b->as.index.array_name) == 0 &&
+                   expressions_equal(a->as.index.index, b->as.index.index);
+        case EXPR_FIELD:
+            return strcmp(a->as.field.object_name, b->as.field.object_name) == 0 &&
+                   a->as.field.field_index == b->as.field.field_index;
+    }
+    return 0;
+}
+
+/* ========================================================================
+ * Hoisting
+ * ======================================================================== */
+
+/* Helper: Pick an unused name for a new local */
+static const char* fresh_name(Licm* l) {
+    char buffer[32];
+    do {
+        snprintf(buffer, sizeof(buffer), "inv%d", ++l->next_temp);
+    } while (name_list_contains(&l->taken, buffer));
+
+    l->owned = xrealloc(l->owned, (l->owned_count + 1) * sizeof(char*));
+    l->owned[l->owned_count] = xstrdup(buffer);
+    name_list_add(&l->taken, l->owned[l->owned_count]);
+    return l->owned[l->owned_count++];
+}
+
+/* Helper: Move an expression into a declaration before the loop and
+ * leave a reference to it in its place */
+static void hoist(Licm* l, ASTExpression* expr) {
+    const char* name = NULL;
+    for (int i = 0; i < l->hoisted_count && !name; i++) {
+        ASTVarDecl* decl = &l->hoisted[i].as.var_decl_stmt.var_decl;
+        if (expressions_equal(decl->initializer, expr)) {
+            name = decl->name;
+        }
+    }
+
+    if (!name) {
+        name = fresh_name(l);
+        l->hoisted = xrealloc(l->hoisted, (l->hoisted_count + 1) * sizeof(ASTStatement));
+        ASTStatement* decl_stmt = &l->hoisted[l->hoisted_count++];
+        memset(decl_stmt, 0, sizeof(ASTStatement));
+        decl_stmt->type = STMT_VAR_DECL;
+        decl_stmt->location = expr->location;
+        ASTVarDecl* decl = &decl_stmt->as.var_decl_stmt.var_decl;
+        decl->name = xstrdup(name);
+        decl->type.type = expr->resolved_type;
+        decl->type.location = expr->location;
+        decl->location = expr->location;
+        decl->initializer = xmalloc(sizeof(ASTExpression));
+        *decl->initializer = *expr;
+    } else {
+        ast_expression_free_contents(expr);
+    }
+
+    expr->type = EXPR_VARIABLE;
+    expr->as.variable.name = xstrdup(name);
+    expr->as.variable.location = expr->location;
+    l->hoisted_total++;
+}
+
+/* Helper: Hoist the largest invariant subexpressions. `always` is set
+ * where the expression runs on every entry to the loop. */
+static void hoist_expression(Licm* l, ASTExpression* expr, int always) {
+    if (!expr) return;
+
+    if (worth_hoisting(expr) && is_invariant(l, expr) && (always || is_speculative(l, expr))) {
+        hoist(l, expr);
+        return;
+    }
+
+    switch (expr->type) {
+        case EXPR_BINARY_OP: {
+            ASTBinaryOp* bin = &expr->as.binary_op;
+            if (bin->op == BINOP_ASSIGN) {
+                if (bin->left->type == EXPR_INDEX) {
+                    hoist_expression(l, bin->left->as.index.index, always);
+                }
+                hoist_expression(l, bin->right, always);
+            } else if (bin->op == BINOP_AND || bin->op == BINOP_OR) {
+                hoist_expression(l, bin->left, always);
+                hoist_expression(l, bin->right, 0);
+            } else {
+                hoist_expression(l, bin->left, always);
+                hoist_expression(l, bin->right, always);
+            }
+            break;
+        }
+        case EXPR_UNARY_OP:
+            hoist_expression(l, expr->as.unary_op.operand, always);
+            break;
+        case EXPR_INDEX:
+            hoist_expression(l, expr->as.index.index, always);
+            break;
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                hoist_expression(l, &expr->as.function_call.arguments[i], always);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void hoist_block(Licm* l, ASTBlock* block);
+
+static void hoist_statement(Licm* l, ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            hoist_expression(l, stmt->as.return_stmt.value, 0);
+            break;
+        case STMT_EXPR:
+            hoist_expression(l, stmt->as.expr_stmt.expr, 0);
+            break;
+        case STMT_VAR_DECL:
+            hoist_expression(l, stmt->as.var_decl_stmt.var_decl.initializer, 0);
+            break;
+        case STMT_IF: {
+            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            hoist_expression(l, if_stmt->condition, 0);
+            hoist_block(l, &if_stmt->then_body);
+            for (ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                hoist_expression(l, clause->condition, 0);
+                hoist_block(l, &clause->body);
+            }
+            if (if_stmt->else_body) hoist_block(l, if_stmt->else_body);
+            break;
+        }
+        case STMT_WHILE:
+            hoist_expression(l, stmt->as.while_stmt.condition, 0);
+            hoist_block(l, &stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            if (stmt->as.for_stmt.init) hoist_statement(l, stmt->as.for_stmt.init);
+            hoist_expression(l, stmt->as.for_stmt.condition, 0);
+            hoist_expression(l, stmt->as.for_stmt.update, 0);
+            hoist_block(l, &stmt->as.for_stmt.body);
+            break;
+        case STMT_BLOCK:
+            hoist_block(l, &stmt->as.block_stmt.block);
+            break;
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                hoist_expression(l, &stmt->as.dbg_stmt.arguments[i], 0);
+            }
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+}
+
+static void hoist_block(Licm* l, ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        hoist_statement(l, &block->statements[i]);
+    }
+}
+
+/* Helper: Check if an expression only calls pure functions and assigns
+ * nothing, so reordering it with hoisted code is unobservable */
+static int is_quiet(const Licm* l, const ASTExpression* expr) {
+    if (!expr) return 1;
+
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            return expr->as.binary_op.op != BINOP_ASSIGN &&
+                   is_quiet(l, expr->as.binary_op.left) && is_quiet(l, expr->as.binary_op.right);
+        case EXPR_UNARY_OP:
+            return is_quiet(l, expr->as.unary_op.operand);
+        case EXPR_FUNCTION_CALL:
+            if (!call_has(l, l->pure, expr->as.function_call.function_name)) return 0;
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                if (!is_quiet(l, &expr->as.function_call.arguments[i])) return 0;
+            }
+            return 1;
+        default:
+            return 1;
+    }
+}
+
+static void licm_block(Licm* l, ASTBlock* block);
+
+/* Helper: Hoist out of one loop, then look at the loops inside it */
+static void licm_loop(Licm* l, ASTStatement* stmt) {
+    ASTBlock* body;
+    l->variant.count = 0;
+    l->hoisted_count = 0;
+    collect_variant_statement(l, stmt);
+
+    if (stmt->type == STMT_WHILE) {
+        ASTExpression* condition = stmt->as.while_stmt.condition;
+        hoist_expression(l, condition, is_quiet(l, condition));
+        hoist_block(l, &stmt->as.while_stmt.body);
+    } else {
+        ASTForStmt* for_stmt = &stmt->as.for_stmt;
+        /* The initializer runs before the condition */
+        int quiet_init = 1;
+        if (for_stmt->init && for_stmt->init->type == STMT_EXPR) {
+            quiet_init = is_quiet(l, for_stmt->init->as.expr_stmt.expr);
+        } else if (for_stmt->init && for_stmt->init->type == STMT_VAR_DECL) {
+            quiet_init = is_quiet(l, for_stmt->init->as.var_decl_stmt.var_decl.initializer);
+        }
+        hoist_expression(l, for_stmt->condition, quiet_init && is_quiet(l, for_stmt->condition));
+        hoist_expression(l, for_stmt->update, 0);
+        hoist_block(l, &for_stmt->body);
+    }
+
+    if (l->hoisted_count > 0) {
+        ASTBlock wrapper;
+        wrapper.statements = NULL;
+        wrapper.statement_count = 0;
+        wrapper.location = stmt->location;
+        for (int i = 0; i < l->hoisted_count; i++) {
+            ast_block_add_statement(&wrapper, l->hoisted[i]);
+        }
+        ast_block_add_statement(&wrapper, *stmt);
+        stmt->type = STMT_BLOCK;
+        stmt->as.block_stmt.block = wrapper;
+        stmt->as.block_stmt.location = stmt->location;
+        stmt = &wrapper.statements[wrapper.statement_count - 1];
+        l->hoisted_count = 0;
+    }
+
+    body = (stmt->type == STMT_WHILE) ? &stmt->as.while_stmt.body : &stmt->as.for_stmt.body;
+    licm_block(l, body);
+}
+
+static void licm_statement(Licm* l, ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_WHILE:
+        case STMT_FOR:
+            licm_loop(l, stmt);
+            break;
+        case STMT_IF: {
+            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            licm_block(l, &if_stmt->then_body);
+            for (ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                licm_block(l, &clause->body);
+            }
+            if (if_stmt->else_body) licm_block(l, if_stmt->else_body);
+            break;
+        }
+        case STMT_BLOCK:
+            licm_block(l, &stmt->as.block_stmt.block);
+            break;
+        default:
+            break;
+    }
+}
+
+static void licm_block(Licm* l, ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        licm_statement(l, &block->statements[i]);
+    }
+}
+
+/* Helper: Every name a function uses, so new locals cannot collide */
+static void collect_taken_names(Licm* l, const ASTFunctionDef* func) {
+    l->taken.count = 0;
+    for (int i = 0; i < l->program->function_count; i++) {
+        name_list_add(&l->taken, l->program->functions[i].name);
+    }
+    for (int i = 0; i < l->program->global_count; i++) {
+        name_list_add(&l->taken, l->program->globals[i].decl.name);
+    }
+    for (int i = 0; i < func->parameter_count; i++) {
+        name_list_add(&l->taken, func->parameters[i].name);
+    }
+    /* Declared and assigned names come from the variant collector; other
+     * names read are parameters, declared locals or globals, all covered */
+    l->variant.count = 0;
+    collect_variant_block(l, &func->body);
+    for (int i = 0; i < l->variant.count; i++) {
+        name_list_add(&l->taken, l->variant.names[i]);
+    }
+    l->variant.count = 0;
+}
+
+int hoist_loop_invariants(ASTProgram* program) {
+    int n = program ? program->function_count : 0;
+    if (n == 0) return 0;
+
+    /* The call graph identifies functions by symbol_id; programs that did
+     * not go through the module loader have none yet */
+    for (int i = 0; i < n; i++) {
+        if (program->functions[i].symbol_id == 0) {
+            for (int j = 0; j < n; j++) {
+                program->functions[j].symbol_id = (uint32_t)(j + 1);
+            }
+            break;
+        }
+    }
+
+    CallGraph* graph = call_graph_create(program);
+    Licm l;
+    memset(&l, 0, sizeof(Licm));
+    l.program = program;
+    summarize_functions(&l, graph);
+
+    for (int i = 0; i < n; i++) {
+        ASTFunctionDef* func = &program->functions[i];
+        collect_taken_names(&l, func);
+        l.next_temp = 0;
+        licm_block(&l, &func->body);
+    }
+
+    for (int i = 0; i < l.owned_count; i++) {
+        xfree(l.owned[i]);
+    }
+    xfree(l.owned);
+    xfree(l.hoisted);
+    xfree(l.taken.names);
+    xfree(l.variant.names);
+    xfree(l.speculative);
+    xfree(l.pure);
+    call_graph_free(graph);
+    return l.hoisted_total;
+}
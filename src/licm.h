@@ -0,0 +1,14 @@
+#ifndef LICM_H
+#define LICM_H
+
+#include "ast.h"
+
+/* Hoist loop-invariant expressions out of while/for loops into fresh
+ * locals declared just before the loop. Only expressions without effects
+ * are moved: calls must be to pure functions (see the call graph), and
+ * anything that is not evaluated on every entry to the loop must also be
+ * unable to trap or run forever. Returns the number of expressions
+ * hoisted. */
+int hoist_loop_invariants(ASTProgram* program);
+
+#endif /* LICM_H */
@@ -6,8 +6,14 @@
 #include "semantics.h"
 #include "codegen.h"
 #include "codegen_wat.h"
+#include "codegen_x86.h"
+#include "bytecode.h"
+#include "interpreter.h"
+#include "jit_x86.h"
 #include "module_loader.h"
 #include "name_allocator.h"
+#include "optimizer.h"
+#include "ir.h"
 #include "utils.h"
 
 static char* read_file(const char* filename) {
@@ -33,10 +39,48 @@ static char* read_file(const char* filename) {
     return content;
 }
 
+/* Outputs at least this large are written through mmap instead of write() */
+#define MMAP_OUTPUT_THRESHOLD (1 << 20)
+
+static int write_output(const OutputSink* out, const char* filename) {
+    int use_mmap = out->length >= MMAP_OUTPUT_THRESHOLD;
+    if (!output_sink_write_path(out, filename, use_mmap)) {
+        fprintf(stderr, "Error: Could not write output file '%s'\n", filename);
+        return 0;
+    }
+    return 1;
+}
+
+static void print_optimizer_report(const OptimizerStats* stats) {
+    const InlineStats* inlining = &stats->inlining;
+    fprintf(stderr, "Folded %d read-only global(s)\n", stats->folded_globals);
+    fprintf(stderr, "Inlined %d call(s)\n", inlining->inlined_calls);
+    for (int i = 0; i < inlining->callee_count; i++) {
+        const InlineCount* entry = &inlining->callees[i];
+        const char* module = entry->module_path ? strrchr(entry->module_path, '/') : NULL;
+        if (module) {
+            fprintf(stderr, "  %s (%s): %d\n", entry->callee, module + 1, entry->count);
+        } else {
+            fprintf(stderr, "  %s: %d\n", entry->callee, entry->count);
+        }
+    }
+    fprintf(stderr, "Evaluated %d call(s) at compile time\n", stats->constant_calls);
+    fprintf(stderr, "Specialized %d call(s) into %d clone(s)\n",
+            stats->specialization.specialized_calls, stats->specialization.clones);
+    fprintf(stderr, "Folded %d comparison(s) using value ranges\n", stats->range_folded_conditions);
+    fprintf(stderr, "Hoisted %d loop-invariant expression(s)\n", stats->hoisted_invariants);
+    fprintf(stderr, "Unrolled %d loop(s) fully and %d partially\n",
+            stats->unrolling.fully_unrolled, stats->unrolling.partially_unrolled);
+    fprintf(stderr, "Removed %d array bounds check(s)\n", stats->bounds_checks_removed);
+    fprintf(stderr, "Replaced %d common subexpression(s) with locals\n", stats->common_subexpressions);
+    fprintf(stderr, "Removed %d dead store(s) and %d unused local(s)\n",
+            stats->dead_stores.stores_removed, stats->dead_stores.locals_removed);
+}
+
 int main(int argc, char** argv) {
     if (argc < 2) {
-        fprintf(stderr, "Usage: %s [--target=c|wat] <source.csm>\n", argv[0]);
-        fprintf(stderr, "Default target: wat\n");
+        fprintf(stderr, "Usage: %s [--target=c|wat|x86_64] [--dbg-abi=calls|buffered] [-O0|-O1|-O2] [--wat-return-call] [--opt-report] [--dump-ir] [--run [--jit]] <source.csm>\n", argv[0]);
+        fprintf(stderr, "Default target: wat; --run interprets main directly, --jit compiles it to native code\n");
         return 1;
     }
     
@@ -44,12 +88,34 @@ int main(int argc, char** argv) {
     const char* source_file = NULL;
     const char* target = "wat";  /* Default target */
     const char* output_file = NULL;
+    const char* dbg_abi = "calls";  /* WAT dbg() host ABI */
+    const char* opt_flag = NULL;    /* -O<level>, default -O0 */
+    int dump_ir = 0;                /* Print the SSA IR instead of generating code */
+    int opt_report = 0;             /* Print what the optimizer did to stderr */
+    int wat_return_call = 0;        /* Emit return_call (wasm tail-call feature) */
+    int run = 0;                    /* Interpret main instead of generating code */
+    int jit = 0;                    /* Run main as native code (implies --run) */
     
     for (int i = 1; i < argc; i++) {
         if (strncmp(argv[i], "--target=", 9) == 0) {
             target = argv[i] + 9;
         } else if (strncmp(argv[i], "--output=", 9) == 0) {
             output_file = argv[i] + 9;
+        } else if (strncmp(argv[i], "--dbg-abi=", 10) == 0) {
+            dbg_abi = argv[i] + 10;
+        } else if (strcmp(argv[i], "--opt-report") == 0) {
+            opt_report = 1;
+        } else if (strcmp(argv[i], "--wat-return-call") == 0) {
+            wat_return_call = 1;
+        } else if (strcmp(argv[i], "--dump-ir") == 0) {
+            dump_ir = 1;
+        } else if (strcmp(argv[i], "--run") == 0) {
+            run = 1;
+        } else if (strcmp(argv[i], "--jit") == 0) {
+            run = 1;
+            jit = 1;
+        } else if (strncmp(argv[i], "-O", 2) == 0) {
+            opt_flag = argv[i];
         } else if (argv[i][0] != '-') {
             source_file = argv[i];
         }
@@ -61,11 +127,34 @@ int main(int argc, char** argv) {
     }
     
     /* Validate target */
-    if (strcmp(target, "c") != 0 && strcmp(target, "wat") != 0) {
-        fprintf(stderr, "Error: Invalid target '%s'. Use 'c' or 'wat'.\n", target);
+    if (strcmp(target, "c") != 0 && strcmp(target, "wat") != 0 && strcmp(target, "x86_64") != 0) {
+        fprintf(stderr, "Error: Invalid target '%s'. Use 'c', 'wat' or 'x86_64'.\n", target);
         return 1;
     }
     
+    if (jit && !jit_x86_supported()) {
+        fprintf(stderr, "Error: --jit is only available on x86-64 Linux; use --run.\n");
+        return 1;
+    }
+    
+    /* Validate dbg ABI */
+    if (strcmp(dbg_abi, "calls") != 0 && strcmp(dbg_abi, "buffered") != 0) {
+        fprintf(stderr, "Error: Invalid dbg ABI '%s'. Use 'calls' or 'buffered'.\n", dbg_abi);
+        return 1;
+    }
+    
+    /* Validate optimization level */
+    int opt_level = 0;
+    if (opt_flag) {
+        const char* level = opt_flag + 2;
+        if (level[0] < '0' || level[0] > '0' + OPT_LEVEL_MAX || level[1] != '\0') {
+            fprintf(stderr, "Error: Invalid optimization level '%s'. Use -O0 to -O%d.\n",
+                    opt_flag, OPT_LEVEL_MAX);
+            return 1;
+        }
+        opt_level = level[0] - '0';
+    }
+    
     char* source = read_file(source_file);
     
     /* Try to load with module system first (handles imports) */
@@ -110,6 +199,15 @@ int main(int argc, char** argv) {
         return 1;
     }
     
+    /* AST optimizations (rely on resolved types from semantic analysis) */
+    OptimizerStats opt_stats;
+    optimizer_stats_init(&opt_stats);
+    optimize_program(program, opt_level, &opt_stats);
+    if (opt_report) {
+        print_optimizer_report(&opt_stats);
+    }
+    optimizer_stats_free(&opt_stats);
+    
     /* Allocate names to handle symbol deduplication (Phase 5) */
     NameAllocator* allocator = name_allocator_create(program);
     if (allocator) {
@@ -117,7 +215,65 @@ int main(int argc, char** argv) {
     }
     
     /* Code generation */
-    if (strcmp(target, "c") == 0) {
+    int exit_code = 0;
+    if (dump_ir) {
+        IrModule* module = ir_lower_program(program);
+        if (opt_level >= 1) {
+            ir_eliminate_self_tail_calls(module);
+        }
+        char* ir_error = NULL;
+        if (!ir_verify_module(module, &ir_error)) {
+            fprintf(stderr, "Error: IR verification failed: %s\n", ir_error);
+            xfree(ir_error);
+            ir_module_free(module);
+            semantic_error_list_free(sem_errors);
+            symbol_table_free(table);
+            ast_program_free_merged(program);
+            xfree(source);
+            return 1;
+        }
+        
+        OutputSink out;
+        output_sink_init(&out);
+        ir_dump_module(module, &out);
+        output_sink_write_file(&out, stdout);
+        output_sink_free(&out);
+        ir_module_free(module);
+    } else if (run) {
+        IrModule* module = ir_lower_program(program);
+        if (opt_level >= 1) {
+            ir_eliminate_self_tail_calls(module);
+        }
+        char* ir_error = NULL;
+        if (!ir_verify_module(module, &ir_error)) {
+            fprintf(stderr, "Error: IR verification failed: %s\n", ir_error);
+            xfree(ir_error);
+            ir_module_free(module);
+            semantic_error_list_free(sem_errors);
+            symbol_table_free(table);
+            ast_program_free_merged(program);
+            xfree(source);
+            return 1;
+        }
+        
+        InterpretResult result;
+        if (jit) {
+            result = jit_x86_run_main(module, source_file, stdout);
+        } else {
+            BcProgram* bytecode = bc_compile_module(module, source_file);
+            result = bc_run_main(bytecode, stdout);
+            bc_program_free(bytecode);
+        }
+        ir_module_free(module);
+        
+        if (!result.success) {
+            fprintf(stderr, "Error: %s\n", result.error_msg);
+            xfree(result.error_msg);
+            exit_code = 1;
+        } else {
+            exit_code = (int)(result.result & 0xff);
+        }
+    } else if (strcmp(target, "c") == 0) {
         /* Generate output filename if not specified */
         char output_buffer[512];
         if (!output_file) {
@@ -126,9 +282,16 @@ int main(int argc, char** argv) {
             output_file = output_buffer;
         }
         
-        FILE* out = fopen(output_file, "w");
-        if (!out) {
-            fprintf(stderr, "Error: Could not open output file '%s' for writing\n", output_file);
+        OutputSink out;
+        output_sink_init(&out);
+        CodegenOptions c_options;
+        c_options.tail_calls = opt_level >= 1;
+        
+        CodegenResult result = codegen_ir_program_to_sink(program, &out, source_file, &c_options);
+        
+        if (!result.success) {
+            fprintf(stderr, "Error: Code generation failed: %s\n", result.error_msg);
+            output_sink_free(&out);
             semantic_error_list_free(sem_errors);
             symbol_table_free(table);
             ast_program_free_merged(program);
@@ -136,17 +299,15 @@ int main(int argc, char** argv) {
             return 1;
         }
         
-        CodegenResult result = codegen_program(program, out, source_file);
-        fclose(out);
-        
-        if (!result.success) {
-            fprintf(stderr, "Error: Code generation failed: %s\n", result.error_msg);
+        if (!write_output(&out, output_file)) {
+            output_sink_free(&out);
             semantic_error_list_free(sem_errors);
             symbol_table_free(table);
             ast_program_free_merged(program);
             xfree(source);
             return 1;
         }
+        output_sink_free(&out);
     } else if (strcmp(target, "wat") == 0) {
         /* Generate output filename if not specified */
         char output_buffer[512];
@@ -156,21 +317,58 @@ int main(int argc, char** argv) {
             output_file = output_buffer;
         }
         
-        FILE* out = fopen(output_file, "w");
-        if (!out) {
-            fprintf(stderr, "Error: Could not open output file '%s' for writing\n", output_file);
+        CodegenWatOptions wat_options;
+        wat_options.debug_abi = strcmp(dbg_abi, "buffered") == 0 ?
+            WAT_DEBUG_ABI_BUFFERED : WAT_DEBUG_ABI_CALLS;
+        wat_options.strength_reduce = opt_level >= 1;
+        wat_options.tail_calls = opt_level >= 1;
+        wat_options.return_call = wat_return_call;
+        wat_options.range_analysis = opt_level >= 1;
+        
+        OutputSink out;
+        output_sink_init(&out);
+        CodegenWatResult result = codegen_wat_program_to_sink(program, &out, source_file, &wat_options);
+        
+        if (!result.success) {
+            fprintf(stderr, "Error: WAT code generation failed: %s\n", result.error_msg);
+            output_sink_free(&out);
+            semantic_error_list_free(sem_errors);
+            symbol_table_free(table);
+            ast_program_free_merged(program);
+            xfree(source);
+            return 1;
+        }
+        
+        if (!write_output(&out, output_file)) {
+            output_sink_free(&out);
             semantic_error_list_free(sem_errors);
             symbol_table_free(table);
             ast_program_free_merged(program);
             xfree(source);
             return 1;
         }
+        output_sink_free(&out);
         
-        CodegenWatResult result = codegen_wat_program(program, out, source_file);
-        fclose(out);
+        printf("Generated WAT code: %s\n", output_file);
+    } else if (strcmp(target, "x86_64") == 0) {
+        /* Generate output filename if not specified */
+        char output_buffer[512];
+        if (!output_file) {
+            /* Always output to out.s */
+            snprintf(output_buffer, sizeof(output_buffer), "out.s");
+            output_file = output_buffer;
+        }
+        
+        OutputSink out;
+        output_sink_init(&out);
+        CodegenX86Options x86_options;
+        x86_options.tail_calls = opt_level >= 1;
+        CodegenX86Result result = codegen_x86_program_to_sink(program, &out, source_file, &x86_options);
         
         if (!result.success) {
-            fprintf(stderr, "Error: WAT code generation failed: %s\n", result.error_msg);
+            fprintf(stderr, "Error: x86-64 code generation failed: %s\n", result.error_msg);
+            xfree(result.error_msg);
+            output_sink_free(&out);
             semantic_error_list_free(sem_errors);
             symbol_table_free(table);
             ast_program_free_merged(program);
@@ -178,7 +376,15 @@ int main(int argc, char** argv) {
             return 1;
         }
         
-        printf("Generated WAT code: %s\n", output_file);
+        if (!write_output(&out, output_file)) {
+            output_sink_free(&out);
+            semantic_error_list_free(sem_errors);
+            symbol_table_free(table);
+            ast_program_free_merged(program);
+            xfree(source);
+            return 1;
+        }
+        output_sink_free(&out);
     }
     
     semantic_error_list_free(sem_errors);
@@ -188,5 +394,5 @@ int main(int argc, char** argv) {
     }
     ast_program_free_merged(program);
     xfree(source);
-    return 0;
+    return exit_code;
 }
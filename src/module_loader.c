@@ -357,17 +357,19 @@ ASTProgram* build_complete_ast(const char* main_file, char** out_error) {
                     for (int k = 0; k < src_func->parameter_count; k++) {
                         dst_func->parameters[k].name = xstrdup(src_func->parameters[k].name);
                         dst_func->parameters[k].type = src_func->parameters[k].type;
+                        dst_func->parameters[k].struct_name = xstrdup(src_func->parameters[k].struct_name);
+                        dst_func->parameters[k].struct_index = -1;
                         dst_func->parameters[k].location = src_func->parameters[k].location;
                     }
                 } else {
                     dst_func->parameters = NULL;
                 }
                 
-                /* Copy body */
+                /* Move body: the merged program owns it from here on, so later
+                 * passes can rewrite it without touching the module AST */
                 dst_func->body = src_func->body;
-                /* Note: we're sharing the statements array from the module AST
-                 * The module ASTs remain allocated to keep bodies alive until program end
-                 * They are NOT freed here - only the cache structure is freed */
+                src_func->body.statements = NULL;
+                src_func->body.statement_count = 0;
                 
                 /* Assign symbol deduplication metadata */
                 dst_func->symbol_id = g_next_symbol_id++;
@@ -378,13 +380,42 @@ ASTProgram* build_complete_ast(const char* main_file, char** out_error) {
         }
     }
     
+    /* Copy module-level variables, remembering which module each belongs to */
+    for (int i = 0; i < cache->count; i++) {
+        ASTProgram* module_ast = cache->modules[i].ast;
+        if (!module_ast || module_ast->global_count == 0) continue;
+        complete->globals = xrealloc(complete->globals,
+                                     (complete->global_count + module_ast->global_count) * sizeof(ASTGlobalVar));
+        for (int j = 0; j < module_ast->global_count; j++) {
+            ASTGlobalVar* dst_global = &complete->globals[complete->global_count++];
+            ast_var_decl_clone_into(&dst_global->decl, &module_ast->globals[j].decl);
+            dst_global->module_path = xstrdup(cache->modules[i].absolute_path);
+            dst_global->allocated_name = NULL;
+            dst_global->folded = 0;
+        }
+    }
+    
+    /* Copy struct types; like arrays, they stay private to their module */
+    for (int i = 0; i < cache->count; i++) {
+        ASTProgram* module_ast = cache->modules[i].ast;
+        if (!module_ast || module_ast->struct_count == 0) continue;
+        complete->structs = xrealloc(complete->structs,
+                                     (complete->struct_count + module_ast->struct_count) * sizeof(ASTStructDef));
+        for (int j = 0; j < module_ast->struct_count; j++) {
+            ASTStructDef* dst_struct = &complete->structs[complete->struct_count++];
+            ast_struct_clone_into(dst_struct, &module_ast->structs[j]);
+            xfree(dst_struct->module_path);
+            dst_struct->module_path = xstrdup(cache->modules[i].absolute_path);
+        }
+    }
+    
     /* Store the cache in the complete program so it stays alive as long as the program does */
     complete->source_cache = cache;
     xfree(abs_main_file);
     return complete;
 }
 
-/* Free a merged AST (doesn't double-free shared statement bodies) */
+/* Free a merged AST */
 void ast_program_free_merged(ASTProgram* program) {
     if (!program) return;
     
@@ -394,7 +425,7 @@ void ast_program_free_merged(ASTProgram* program) {
     }
     xfree(program->imports);
     
-    /* Free functions but NOT their bodies (those are shared from module ASTs) */
+    /* Free functions, including the bodies moved out of the module ASTs */
     for (int i = 0; i < program->function_count; i++) {
         ASTFunctionDef* func = &program->functions[i];
         xfree(func->name);
@@ -405,10 +436,20 @@ void ast_program_free_merged(ASTProgram* program) {
             ast_parameter_free(&func->parameters[j]);
         }
         xfree(func->parameters);
-        /* Don't free the body statements - they're shared from module ASTs */
+        ast_block_free(&func->body);
     }
     xfree(program->functions);
     
+    for (int i = 0; i < program->global_count; i++) {
+        ast_global_free_contents(&program->globals[i]);
+    }
+    xfree(program->globals);
+    
+    for (int i = 0; i < program->struct_count; i++) {
+        ast_struct_free_contents(&program->structs[i]);
+    }
+    xfree(program->structs);
+    
     /* Free the source module cache if this is a merged program */
     if (program->source_cache) {
         module_cache_free(program->source_cache);
@@ -43,7 +43,7 @@ LoadedModule* module_cache_load(ModuleCache* cache,
  */
 ASTProgram* build_complete_ast(const char* main_file, char** out_error);
 
-/* Free a merged AST (doesn't double-free shared statement bodies)
+/* Free a merged AST along with its source module cache
  * This should be used instead of ast_program_free for ASTs returned by build_complete_ast
  */
 void ast_program_free_merged(ASTProgram* program);
@@ -19,6 +19,10 @@ struct NameAllocator {
     int allocation_count;
     int allocation_capacity;
     HashSet* used_names;  /* Track which names we've already allocated */
+    char** global_names;  /* Allocated names of module-level variables, by index */
+    int global_count;
+    char** struct_names;  /* Allocated struct tags, by index */
+    int struct_count;
 };
 
 /* Helper: Extract basename from path (e.g., "/path/to/module_a.csm" -> "module_a") */
@@ -156,6 +160,59 @@ static void allocate_names(NameAllocator* allocator, ASTProgram* program, uint32
     }
 }
 
+/* Name module-level variables after the functions: the original name when
+ * it is still free, else basename_name(_N) like functions */
+static void allocate_global_names(NameAllocator* allocator, ASTProgram* program) {
+    allocator->global_count = program->global_count;
+    if (program->global_count == 0) return;
+    allocator->global_names = xmalloc(program->global_count * sizeof(char*));
+
+    for (int i = 0; i < program->global_count; i++) {
+        ASTGlobalVar* global = &program->globals[i];
+        const char* name = global->decl.name;
+        char combined[512];
+        if (hashset_contains(allocator->used_names, name)) {
+            char* basename = extract_basename(global->module_path);
+            snprintf(combined, sizeof(combined), "%s_%s", basename, name);
+            for (int counter = 2; hashset_contains(allocator->used_names, combined) && counter <= 100; counter++) {
+                snprintf(combined, sizeof(combined), "%s_%s_%d", basename, name, counter);
+            }
+            xfree(basename);
+            name = combined;
+        }
+        allocator->global_names[i] = xstrdup(name);
+        hashset_add(allocator->used_names, name);
+    }
+}
+
+/* Name struct types. C keeps struct tags apart from other identifiers,
+ * so tags only have to differ from each other; duplicates (the same name
+ * in two modules) get the basename_name(_N) scheme. */
+static void allocate_struct_names(NameAllocator* allocator, ASTProgram* program) {
+    allocator->struct_count = program->struct_count;
+    if (program->struct_count == 0) return;
+    allocator->struct_names = xmalloc(program->struct_count * sizeof(char*));
+
+    HashSet* tags = hashset_create();
+    for (int i = 0; i < program->struct_count; i++) {
+        ASTStructDef* def = &program->structs[i];
+        const char* name = def->name;
+        char combined[512];
+        if (hashset_contains(tags, name)) {
+            char* basename = extract_basename(def->module_path);
+            snprintf(combined, sizeof(combined), "%s_%s", basename, name);
+            for (int counter = 2; hashset_contains(tags, combined) && counter <= 100; counter++) {
+                snprintf(combined, sizeof(combined), "%s_%s_%d", basename, name, counter);
+            }
+            xfree(basename);
+            name = combined;
+        }
+        allocator->struct_names[i] = xstrdup(name);
+        hashset_add(tags, name);
+    }
+    hashset_free(tags);
+}
+
 /* Create name allocator */
 NameAllocator* name_allocator_create(ASTProgram* program) {
     if (!program) return NULL;
@@ -165,6 +222,10 @@ NameAllocator* name_allocator_create(ASTProgram* program) {
     allocator->allocation_count = 0;
     allocator->allocation_capacity = 0;
     allocator->used_names = hashset_create();
+    allocator->global_names = NULL;
+    allocator->global_count = 0;
+    allocator->struct_names = NULL;
+    allocator->struct_count = 0;
 
     /* Step 1: Build call graph to determine reachability */
     CallGraph* graph = call_graph_create(program);
@@ -210,6 +271,10 @@ NameAllocator* name_allocator_create(ASTProgram* program) {
         xfree(reachable_ids);
     }
 
+    /* Step 5: Allocate names to module-level variables */
+    allocate_global_names(allocator, program);
+    allocate_struct_names(allocator, program);
+
     call_graph_free(graph);
     return allocator;
 }
@@ -224,6 +289,14 @@ void name_allocator_free(NameAllocator* allocator) {
         xfree(allocator->allocations[i].module_path);
     }
     xfree(allocator->allocations);
+    for (int i = 0; i < allocator->global_count; i++) {
+        xfree(allocator->global_names[i]);
+    }
+    xfree(allocator->global_names);
+    for (int i = 0; i < allocator->struct_count; i++) {
+        xfree(allocator->struct_names[i]);
+    }
+    xfree(allocator->struct_names);
     hashset_free(allocator->used_names);
     xfree(allocator);
 }
@@ -245,6 +318,16 @@ void name_allocator_apply(NameAllocator* allocator, ASTProgram* program) {
             }
         }
     }
+
+    for (int i = 0; i < program->global_count && i < allocator->global_count; i++) {
+        xfree(program->globals[i].allocated_name);
+        program->globals[i].allocated_name = xstrdup(allocator->global_names[i]);
+    }
+
+    for (int i = 0; i < program->struct_count && i < allocator->struct_count; i++) {
+        xfree(program->structs[i].allocated_name);
+        program->structs[i].allocated_name = xstrdup(allocator->struct_names[i]);
+    }
 }
 
 /* Get allocated name for a symbol_id */
@@ -0,0 +1,662 @@
+#include <stdint.h>
+#include <string.h>
+#include "optimizer.h"
+#include "types.h"
+#include "utils.h"
+
+/* Forward declarations */
+static void optimize_block(ASTBlock* block);
+static int optimize_statement(ASTStatement* stmt);
+
+/* Helper: Check if a type is a signed integer type */
+static int is_signed_int_type(CasmType type) {
+    return type == TYPE_I8 || type == TYPE_I16 || type == TYPE_I32 || type == TYPE_I64;
+}
+
+/* Helper: Check if arithmetic in this type is folded.
+ * Narrow types are left alone: the backends promote them differently. */
+static int is_foldable_int_type(CasmType type) {
+    return type == TYPE_I32 || type == TYPE_I64 || type == TYPE_U32 || type == TYPE_U64;
+}
+
+/* Helper: Check if two types have the same runtime representation
+ * (same signedness and both 64-bit or both narrower), so one expression
+ * can stand in for the other */
+static int same_value_class(CasmType a, CasmType b) {
+    if (a == TYPE_BOOL || b == TYPE_BOOL) {
+        return a == b;
+    }
+    if (!is_numeric_type(a) || !is_numeric_type(b)) {
+        return 0;
+    }
+    return is_signed_int_type(a) == is_signed_int_type(b) &&
+           (get_type_size_bits(a) == 64) == (get_type_size_bits(b) == 64);
+}
+
+/* Helper: Truncate a value to the width of a type (two's complement wraparound) */
+static long long wrap_to_type(unsigned long long bits, CasmType type) {
+    switch (type) {
+        case TYPE_I8:  return (int8_t)(uint8_t)bits;
+        case TYPE_I16: return (int16_t)(uint16_t)bits;
+        case TYPE_I32: return (int32_t)(uint32_t)bits;
+        case TYPE_U8:  return (uint8_t)bits;
+        case TYPE_U16: return (uint16_t)bits;
+        case TYPE_U32: return (uint32_t)bits;
+        default:       return (long long)bits;
+    }
+}
+
+/* Helper: Get the value of an integer literal that fits its resolved type */
+static int get_int_constant(const ASTExpression* expr, long long* out_value) {
+    if (!expr || expr->type != EXPR_LITERAL || expr->as.literal.type != LITERAL_INT) {
+        return 0;
+    }
+    long long value = expr->as.literal.value.int_value;
+    if (!is_numeric_type(expr->resolved_type) ||
+        wrap_to_type((unsigned long long)value, expr->resolved_type) != value) {
+        return 0;
+    }
+    *out_value = value;
+    return 1;
+}
+
+/* Helper: Get the value of a boolean literal */
+static int get_bool_constant(const ASTExpression* expr, int* out_value) {
+    if (!expr || expr->type != EXPR_LITERAL || expr->as.literal.type != LITERAL_BOOL) {
+        return 0;
+    }
+    *out_value = expr->as.literal.value.bool_value;
+    return 1;
+}
+
+/* Helper: Check if an expression is the integer constant `value` */
+static int is_int_value(const ASTExpression* expr, long long value) {
+    long long actual;
+    return get_int_constant(expr, &actual) && actual == value;
+}
+
+/* Helper: Check if an expression is the boolean constant `value` */
+static int is_bool_value(const ASTExpression* expr, int value) {
+    int actual;
+    return get_bool_constant(expr, &actual) && actual == value;
+}
+
+int optimize_has_side_effects(const ASTExpression* expr) {
+    if (!expr) return 0;
+
+    switch (expr->type) {
+        case EXPR_LITERAL:
+        case EXPR_VARIABLE:
+        case EXPR_FIELD:
+            return 0;
+        case EXPR_FUNCTION_CALL:
+            return 1;
+        case EXPR_UNARY_OP:
+            return optimize_has_side_effects(expr->as.unary_op.operand);
+        case EXPR_INDEX:
+            /* A checked access can trap */
+            return expr->as.index.bounds_checked ||
+                   optimize_has_side_effects(expr->as.index.index);
+        case EXPR_BINARY_OP: {
+            BinaryOpType op = expr->as.binary_op.op;
+            if (op == BINOP_ASSIGN || op == BINOP_DIV || op == BINOP_MOD) {
+                return 1;
+            }
+            return optimize_has_side_effects(expr->as.binary_op.left) ||
+                   optimize_has_side_effects(expr->as.binary_op.right);
+        }
+    }
+    return 1;
+}
+
+/* Helper: Replace an expression with an integer literal of the given type */
+static void make_int_literal(ASTExpression* expr, long long value, CasmType type) {
+    ast_expression_free_contents(expr);
+    expr->type = EXPR_LITERAL;
+    expr->as.literal.type = LITERAL_INT;
+    expr->as.literal.value.int_value = value;
+    expr->as.literal.location = expr->location;
+    expr->resolved_type = type;
+}
+
+/* Helper: Replace an expression with a boolean literal */
+static void make_bool_literal(ASTExpression* expr, int value) {
+    ast_expression_free_contents(expr);
+    expr->type = EXPR_LITERAL;
+    expr->as.literal.type = LITERAL_BOOL;
+    expr->as.literal.value.bool_value = value ? 1 : 0;
+    expr->as.literal.location = expr->location;
+    expr->resolved_type = TYPE_BOOL;
+}
+
+/* Helper: Replace an expression with one of its subexpressions.
+ * `slot` points at the child pointer (anywhere below expr) to keep. */
+static void replace_with_subexpression(ASTExpression* expr, ASTExpression** slot) {
+    ASTExpression* keep = *slot;
+    *slot = NULL;
+    ast_expression_free_contents(expr);
+    *expr = *keep;
+    xfree(keep);
+}
+
+/* Helper: Replace a binary op with one operand if the types allow it */
+static int try_replace_with_operand(ASTExpression* expr, ASTExpression** slot) {
+    if (!same_value_class((*slot)->resolved_type, expr->resolved_type)) {
+        return 0;
+    }
+    replace_with_subexpression(expr, slot);
+    return 1;
+}
+
+/* Helper: Fold a binary op on two integer constants. Returns 1 if folded. */
+static int fold_int_binary(ASTExpression* expr, long long left, long long right) {
+    ASTBinaryOp* binop = &expr->as.binary_op;
+    CasmType operand_type = get_binary_op_result_type(binop->left->resolved_type, BINOP_ADD,
+                                                      binop->right->resolved_type);
+    if (binop->op >= BINOP_SHL && binop->op <= BINOP_ROTR) {
+        /* The count does not take part in the type */
+        operand_type = binop->left->resolved_type;
+    }
+    if (!is_foldable_int_type(operand_type)) {
+        return 0;
+    }
+
+    int is_signed = is_signed_int_type(operand_type);
+    unsigned long long a = (unsigned long long)left;
+    unsigned long long b = (unsigned long long)right;
+
+    switch (binop->op) {
+        case BINOP_ADD:
+            make_int_literal(expr, wrap_to_type(a + b, operand_type), operand_type);
+            return 1;
+        case BINOP_SUB:
+            make_int_literal(expr, wrap_to_type(a - b, operand_type), operand_type);
+            return 1;
+        case BINOP_MUL:
+            make_int_literal(expr, wrap_to_type(a * b, operand_type), operand_type);
+            return 1;
+        case BINOP_DIV:
+        case BINOP_MOD: {
+            /* Division by zero and signed overflow trap at runtime; keep them */
+            if (right == 0) return 0;
+            if (is_signed && right == -1 &&
+                left == (operand_type == TYPE_I64 ? INT64_MIN : INT32_MIN)) {
+                return 0;
+            }
+            unsigned long long result;
+            if (is_signed) {
+                result = (unsigned long long)(binop->op == BINOP_DIV ? left / right : left % right);
+            } else {
+                result = binop->op == BINOP_DIV ? a / b : a % b;
+            }
+            make_int_literal(expr, wrap_to_type(result, operand_type), operand_type);
+            return 1;
+        }
+        case BINOP_BIT_AND:
+        case BINOP_BIT_OR:
+        case BINOP_BIT_XOR:
+        case BINOP_SHL:
+        case BINOP_SHR:
+        case BINOP_ROTL:
+        case BINOP_ROTR:
+            make_int_literal(expr, eval_bit_op(binop->op, wrap_to_type(a, operand_type), right,
+                                               operand_type), operand_type);
+            return 1;
+        case BINOP_EQ: make_bool_literal(expr, a == b); return 1;
+        case BINOP_NE: make_bool_literal(expr, a != b); return 1;
+        case BINOP_LT: make_bool_literal(expr, is_signed ? left < right : a < b); return 1;
+        case BINOP_GT: make_bool_literal(expr, is_signed ? left > right : a > b); return 1;
+        case BINOP_LE: make_bool_literal(expr, is_signed ? left <= right : a <= b); return 1;
+        case BINOP_GE: make_bool_literal(expr, is_signed ? left >= right : a >= b); return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Fold a binary op on two boolean constants. Returns 1 if folded. */
+static int fold_bool_binary(ASTExpression* expr, int left, int right) {
+    switch (expr->as.binary_op.op) {
+        case BINOP_AND: make_bool_literal(expr, left && right); return 1;
+        case BINOP_OR:  make_bool_literal(expr, left || right); return 1;
+        case BINOP_EQ:  make_bool_literal(expr, left == right); return 1;
+        case BINOP_NE:  make_bool_literal(expr, left != right); return 1;
+        default:        return 0;
+    }
+}
+
+/* Helper: Apply algebraic identities to a binary op with one constant side */
+static void simplify_binary(ASTExpression* expr) {
+    ASTBinaryOp* binop = &expr->as.binary_op;
+
+    switch (binop->op) {
+        case BINOP_ADD:
+            /* x + 0, 0 + x */
+            if (is_int_value(binop->right, 0) && try_replace_with_operand(expr, &binop->left)) return;
+            if (is_int_value(binop->left, 0) && try_replace_with_operand(expr, &binop->right)) return;
+            break;
+        case BINOP_SUB:
+            /* x - 0 */
+            if (is_int_value(binop->right, 0) && try_replace_with_operand(expr, &binop->left)) return;
+            break;
+        case BINOP_MUL:
+            /* x * 1, 1 * x */
+            if (is_int_value(binop->right, 1) && try_replace_with_operand(expr, &binop->left)) return;
+            if (is_int_value(binop->left, 1) && try_replace_with_operand(expr, &binop->right)) return;
+            /* x * 0, 0 * x when x can be dropped */
+            if ((is_int_value(binop->right, 0) && !optimize_has_side_effects(binop->left)) ||
+                (is_int_value(binop->left, 0) && !optimize_has_side_effects(binop->right))) {
+                make_int_literal(expr, 0, expr->resolved_type);
+                return;
+            }
+            break;
+        case BINOP_DIV:
+            /* x / 1 */
+            if (is_int_value(binop->right, 1) && try_replace_with_operand(expr, &binop->left)) return;
+            break;
+        case BINOP_BIT_OR:
+        case BINOP_BIT_XOR:
+            /* x | 0, 0 | x, x ^ 0, 0 ^ x */
+            if (is_int_value(binop->right, 0) && try_replace_with_operand(expr, &binop->left)) return;
+            if (is_int_value(binop->left, 0) && try_replace_with_operand(expr, &binop->right)) return;
+            break;
+        case BINOP_SHL:
+        case BINOP_SHR:
+            /* x << 0, x >> 0. C shifts u8 and u16 in uint32_t, as the other
+             * backends do, while the bare operand would promote to int */
+            if (expr->resolved_type == TYPE_U8 || expr->resolved_type == TYPE_U16) break;
+            if (is_int_value(binop->right, 0) && try_replace_with_operand(expr, &binop->left)) return;
+            break;
+        case BINOP_AND:
+            /* true && x, x && true */
+            if (is_bool_value(binop->left, 1)) { replace_with_subexpression(expr, &binop->right); return; }
+            if (is_bool_value(binop->right, 1)) { replace_with_subexpression(expr, &binop->left); return; }
+            /* false && x never evaluates x; x && false only if x can be dropped */
+            if (is_bool_value(binop->left, 0) ||
+                (is_bool_value(binop->right, 0) && !optimize_has_side_effects(binop->left))) {
+                make_bool_literal(expr, 0);
+                return;
+            }
+            break;
+        case BINOP_OR:
+            /* false || x, x || false */
+            if (is_bool_value(binop->left, 0)) { replace_with_subexpression(expr, &binop->right); return; }
+            if (is_bool_value(binop->right, 0)) { replace_with_subexpression(expr, &binop->left); return; }
+            /* true || x never evaluates x; x || true only if x can be dropped */
+            if (is_bool_value(binop->left, 1) ||
+                (is_bool_value(binop->right, 1) && !optimize_has_side_effects(binop->left))) {
+                make_bool_literal(expr, 1);
+                return;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* Helper: Fold a unary op */
+static void fold_unary(ASTExpression* expr) {
+    ASTUnaryOp* unop = &expr->as.unary_op;
+    long long int_value;
+    int bool_value;
+
+    if (unop->op == UNOP_NEG) {
+        if (get_int_constant(unop->operand, &int_value) && is_foldable_int_type(expr->resolved_type)) {
+            make_int_literal(expr, wrap_to_type(0ULL - (unsigned long long)int_value, expr->resolved_type),
+                             expr->resolved_type);
+        }
+    } else if (unop->op == UNOP_BIT_NOT) {
+        if (get_int_constant(unop->operand, &int_value) && is_foldable_int_type(expr->resolved_type)) {
+            make_int_literal(expr, wrap_to_type(~(unsigned long long)int_value, expr->resolved_type),
+                             expr->resolved_type);
+        }
+    } else if (unop->op == UNOP_POPCOUNT || unop->op == UNOP_CLZ || unop->op == UNOP_CTZ) {
+        if (get_int_constant(unop->operand, &int_value) && is_foldable_int_type(expr->resolved_type)) {
+            make_int_literal(expr, eval_bit_count(unop->op, int_value, expr->resolved_type),
+                             expr->resolved_type);
+        }
+    } else if (unop->op == UNOP_CAST) {
+        /* A cast's result is exact at every width, so narrow types fold too */
+        if (get_int_constant(unop->operand, &int_value)) {
+            make_int_literal(expr, wrap_to_type((unsigned long long)int_value, expr->resolved_type),
+                             expr->resolved_type);
+        } else if (get_bool_constant(unop->operand, &bool_value)) {
+            make_int_literal(expr, bool_value, expr->resolved_type);
+        } else if (unop->operand->resolved_type == expr->resolved_type) {
+            replace_with_subexpression(expr, &unop->operand);
+        }
+    } else if (unop->op == UNOP_NOT) {
+        if (get_bool_constant(unop->operand, &bool_value)) {
+            make_bool_literal(expr, !bool_value);
+        } else if (unop->operand->type == EXPR_UNARY_OP && unop->operand->as.unary_op.op == UNOP_NOT) {
+            /* !!b */
+            replace_with_subexpression(expr, &unop->operand->as.unary_op.operand);
+        }
+    }
+}
+
+void optimize_fold_expression(ASTExpression* expr) {
+    if (!expr) return;
+
+    switch (expr->type) {
+        case EXPR_LITERAL:
+        case EXPR_VARIABLE:
+        case EXPR_FIELD:
+            break;
+
+        case EXPR_UNARY_OP:
+            optimize_fold_expression(expr->as.unary_op.operand);
+            fold_unary(expr);
+            break;
+
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                optimize_fold_expression(&expr->as.function_call.arguments[i]);
+            }
+            break;
+
+        case EXPR_INDEX:
+            optimize_fold_expression(expr->as.index.index);
+            break;
+
+        case EXPR_BINARY_OP: {
+            ASTBinaryOp* binop = &expr->as.binary_op;
+            if (binop->op == BINOP_ASSIGN) {
+                if (binop->left->type == EXPR_INDEX) {
+                    optimize_fold_expression(binop->left);
+                }
+                optimize_fold_expression(binop->right);
+                break;
+            }
+            optimize_fold_expression(binop->left);
+            optimize_fold_expression(binop->right);
+
+            long long left_int, right_int;
+            int left_bool, right_bool;
+            if (get_int_constant(binop->left, &left_int) && get_int_constant(binop->right, &right_int)) {
+                if (fold_int_binary(expr, left_int, right_int)) break;
+            }
+            if (get_bool_constant(binop->left, &left_bool) && get_bool_constant(binop->right, &right_bool)) {
+                if (fold_bool_binary(expr, left_bool, right_bool)) break;
+            }
+            simplify_binary(expr);
+            break;
+        }
+    }
+}
+
+/* Helper: Check for `x = x`, which does nothing as a statement */
+static int is_self_assignment(const ASTExpression* expr) {
+    if (!expr || expr->type != EXPR_BINARY_OP || expr->as.binary_op.op != BINOP_ASSIGN) return 0;
+    const ASTExpression* left = expr->as.binary_op.left;
+    const ASTExpression* right = expr->as.binary_op.right;
+    return left->type == EXPR_VARIABLE && right->type == EXPR_VARIABLE &&
+           strcmp(left->as.variable.name, right->as.variable.name) == 0;
+}
+
+/* Helper: Turn a statement into a bare block statement owning `body`.
+ * The statement's previous contents must already be released. */
+static void make_block_statement(ASTStatement* stmt, ASTBlock body) {
+    stmt->type = STMT_BLOCK;
+    stmt->as.block_stmt.block = body;
+    stmt->as.block_stmt.location = stmt->location;
+}
+
+/* Helper: Take a block's statements, leaving it empty */
+static ASTBlock take_block(ASTBlock* block) {
+    ASTBlock taken = *block;
+    block->statements = NULL;
+    block->statement_count = 0;
+    return taken;
+}
+
+/* Helper: Simplify an if/else-if/else chain with constant conditions.
+ * Returns 0 if the statement should be removed. */
+static int optimize_if(ASTStatement* stmt) {
+    ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+    int value;
+
+    optimize_fold_expression(if_stmt->condition);
+    optimize_block(&if_stmt->then_body);
+    for (ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+        optimize_fold_expression(clause->condition);
+        optimize_block(&clause->body);
+    }
+    if (if_stmt->else_body) {
+        optimize_block(if_stmt->else_body);
+    }
+
+    /* Drop else-if arms that can never be taken; a constant-true arm
+     * becomes the else and cuts off everything after it */
+    ASTElseIfClause** link = &if_stmt->else_if_chain;
+    while (*link) {
+        ASTElseIfClause* clause = *link;
+        if (!get_bool_constant(clause->condition, &value)) {
+            link = &clause->next;
+            continue;
+        }
+        if (!value) {
+            *link = clause->next;
+            clause->next = NULL;
+            ast_else_if_free(clause);
+            continue;
+        }
+        ast_else_if_free(clause->next);
+        if (if_stmt->else_body) {
+            ast_block_free(if_stmt->else_body);
+            xfree(if_stmt->else_body);
+        }
+        if_stmt->else_body = xmalloc(sizeof(ASTBlock));
+        *if_stmt->else_body = clause->body;
+        ast_expression_free(clause->condition);
+        xfree(clause);
+        *link = NULL;
+        break;
+    }
+
+    if (!get_bool_constant(if_stmt->condition, &value)) {
+        return 1;
+    }
+
+    if (value) {
+        ASTBlock body = take_block(&if_stmt->then_body);
+        ast_statement_free_contents(stmt);
+        make_block_statement(stmt, body);
+        return 1;
+    }
+
+    if (if_stmt->else_if_chain) {
+        /* Promote the first else-if arm (its condition is not constant) */
+        ASTElseIfClause* first = if_stmt->else_if_chain;
+        ast_expression_free(if_stmt->condition);
+        ast_block_free(&if_stmt->then_body);
+        if_stmt->condition = first->condition;
+        if_stmt->then_body = first->body;
+        if_stmt->else_if_chain = first->next;
+        xfree(first);
+        return 1;
+    }
+
+    if (if_stmt->else_body) {
+        ASTBlock body = take_block(if_stmt->else_body);
+        ast_statement_free_contents(stmt);
+        make_block_statement(stmt, body);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Helper: Optimize a for loop. Returns 0 if the statement should be removed. */
+static int optimize_for(ASTStatement* stmt) {
+    ASTForStmt* for_stmt = &stmt->as.for_stmt;
+    int value;
+
+    if (for_stmt->init) {
+        optimize_statement(for_stmt->init);
+    }
+    optimize_fold_expression(for_stmt->condition);
+    optimize_fold_expression(for_stmt->update);
+    optimize_block(&for_stmt->body);
+
+    if (!get_bool_constant(for_stmt->condition, &value) || value) {
+        return 1;
+    }
+
+    /* The loop never runs, but its initializer still does */
+    if (!for_stmt->init) {
+        return 0;
+    }
+    ASTBlock body;
+    body.statements = NULL;
+    body.statement_count = 0;
+    body.location = stmt->location;
+    ast_block_add_statement(&body, *for_stmt->init);
+    xfree(for_stmt->init);
+    for_stmt->init = NULL;
+    ast_statement_free_contents(stmt);
+    make_block_statement(stmt, body);
+    return 1;
+}
+
+/* Optimize a statement in place. Returns 0 if it should be removed. */
+static int optimize_statement(ASTStatement* stmt) {
+    int value;
+
+    switch (stmt->type) {
+        case STMT_RETURN:
+            optimize_fold_expression(stmt->as.return_stmt.value);
+            return 1;
+        case STMT_EXPR:
+            optimize_fold_expression(stmt->as.expr_stmt.expr);
+            return !is_self_assignment(stmt->as.expr_stmt.expr);
+        case STMT_VAR_DECL:
+            optimize_fold_expression(stmt->as.var_decl_stmt.var_decl.initializer);
+            return 1;
+        case STMT_IF:
+            return optimize_if(stmt);
+        case STMT_WHILE:
+            optimize_fold_expression(stmt->as.while_stmt.condition);
+            optimize_block(&stmt->as.while_stmt.body);
+            return !(get_bool_constant(stmt->as.while_stmt.condition, &value) && !value);
+        case STMT_FOR:
+            return optimize_for(stmt);
+        case STMT_BLOCK:
+            optimize_block(&stmt->as.block_stmt.block);
+            return 1;
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                optimize_fold_expression(&stmt->as.dbg_stmt.arguments[i]);
+            }
+            return 1;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            return 1;
+    }
+    return 1;
+}
+
+/* Helper: Optimize every statement of a block, dropping removed ones */
+static void optimize_block(ASTBlock* block) {
+    int kept = 0;
+    for (int i = 0; i < block->statement_count; i++) {
+        if (optimize_statement(&block->statements[i])) {
+            block->statements[kept++] = block->statements[i];
+        } else {
+            ast_statement_free_contents(&block->statements[i]);
+        }
+    }
+    block->statement_count = kept;
+}
+
+void optimizer_stats_init(OptimizerStats* stats) {
+    stats->folded_globals = 0;
+    inline_stats_init(&stats->inlining);
+    stats->constant_calls = 0;
+    stats->specialization.specialized_calls = 0;
+    stats->specialization.clones = 0;
+    stats->range_folded_conditions = 0;
+    stats->hoisted_invariants = 0;
+    stats->bounds_checks_removed = 0;
+    stats->unrolling.fully_unrolled = 0;
+    stats->unrolling.partially_unrolled = 0;
+    stats->common_subexpressions = 0;
+    stats->dead_stores.stores_removed = 0;
+    stats->dead_stores.locals_removed = 0;
+}
+
+void optimizer_stats_free(OptimizerStats* stats) {
+    inline_stats_free(&stats->inlining);
+}
+
+void optimize_program(ASTProgram* program, int level, OptimizerStats* stats) {
+    if (!program || level < 1) return;
+
+    /* Read-only globals become literals everything after can fold */
+    int globals = fold_read_only_globals(program);
+    if (stats) {
+        stats->folded_globals += globals;
+    }
+
+    /* Inline first so folding sees through the substituted arguments */
+    if (level >= 2) {
+        inline_functions(program, stats ? &stats->inlining : NULL);
+    }
+
+    for (int i = 0; i < program->function_count; i++) {
+        optimize_block(&program->functions[i].body);
+    }
+
+    if (level >= 2) {
+        /* Calls made constant by folding become literals; folding again
+         * then propagates them */
+        int evaluated = fold_constant_calls(program);
+        if (evaluated > 0) {
+            for (int i = 0; i < program->function_count; i++) {
+                optimize_block(&program->functions[i].body);
+            }
+        }
+        if (stats) {
+            stats->constant_calls += evaluated;
+        }
+        /* Clones start out with literals where their parameters were;
+         * folding specializes them */
+        if (specialize_functions(program, stats ? &stats->specialization : NULL) > 0) {
+            for (int i = 0; i < program->function_count; i++) {
+                optimize_block(&program->functions[i].body);
+            }
+        }
+        /* Comparisons proven constant become literals; folding again then
+         * drops the branches and loops they decided */
+        int folded = fold_conditions_by_range(program);
+        if (folded > 0) {
+            for (int i = 0; i < program->function_count; i++) {
+                optimize_block(&program->functions[i].body);
+            }
+        }
+        if (stats) {
+            stats->range_folded_conditions += folded;
+        }
+        int hoisted = hoist_loop_invariants(program);
+        if (stats) {
+            stats->hoisted_invariants += hoisted;
+        }
+        /* After hoisting, so invariants are not copied; folding again
+         * simplifies the copies where the counter became a literal */
+        if (unroll_loops(program, stats ? &stats->unrolling : NULL) > 0) {
+            for (int i = 0; i < program->function_count; i++) {
+                optimize_block(&program->functions[i].body);
+            }
+        }
+        /* After unrolling, whose copies index with literals */
+        int unchecked = remove_bounds_checks_by_range(program);
+        if (stats) {
+            stats->bounds_checks_removed += unchecked;
+        }
+        int shared = eliminate_common_subexpressions(program);
+        if (stats) {
+            stats->common_subexpressions += shared;
+        }
+        /* Last, so stores orphaned by the other passes go too */
+        eliminate_dead_stores(program, stats ? &stats->dead_stores : NULL);
+    }
+}
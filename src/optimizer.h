@@ -0,0 +1,62 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "ast.h"
+#include "inliner.h"
+#include "dead_stores.h"
+#include "licm.h"
+#include "cse.h"
+#include "ranges.h"
+#include "unroll.h"
+#include "constexpr.h"
+#include "specialize.h"
+#include "global_fold.h"
+
+/* AST-level optimizations, run between semantic analysis and codegen.
+ * Passes rewrite the program in place and rely on resolved_type being set.
+ *
+ * Level 0: no changes
+ * Level 1: constant folding, algebraic simplification, folding of
+ *          constant if/while/for conditions and of read-only globals
+ *          (the WAT backend also strength-reduces constant
+ *          multiply/divide/remainder, and both backends turn self tail
+ *          calls into loops)
+ * Level 2: level 1 plus inlining of small non-recursive functions,
+ *          evaluation of pure calls with constant arguments, cloning of
+ *          functions for the constant arguments they are called with,
+ *          folding of comparisons decided by value ranges, loop-invariant
+ *          code motion, unrolling of counted for loops, removal of
+ *          array bounds checks proven by value ranges, common
+ *          subexpression elimination and removal of dead stores and
+ *          unused locals */
+#define OPT_LEVEL_MAX 2
+
+/* What the passes did, for --opt-report */
+typedef struct {
+    int folded_globals;
+    InlineStats inlining;
+    int constant_calls;
+    SpecializeStats specialization;
+    int range_folded_conditions;
+    int hoisted_invariants;
+    int bounds_checks_removed;
+    UnrollStats unrolling;
+    int common_subexpressions;
+    DeadStoreStats dead_stores;
+} OptimizerStats;
+
+void optimizer_stats_init(OptimizerStats* stats);
+void optimizer_stats_free(OptimizerStats* stats);
+
+/* Optimize the program at the given level (0..OPT_LEVEL_MAX).
+ * `stats` may be NULL. */
+void optimize_program(ASTProgram* program, int level, OptimizerStats* stats);
+
+/* Check if evaluating an expression can do anything besides producing a
+ * value (calls, assignments, division traps) */
+int optimize_has_side_effects(const ASTExpression* expr);
+
+/* Fold constants and simplify a single expression in place */
+void optimize_fold_expression(ASTExpression* expr);
+
+#endif /* OPTIMIZER_H */
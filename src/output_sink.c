@@ -0,0 +1,132 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "output_sink.h"
+#include "utils.h"
+
+void output_sink_init(OutputSink* sink) {
+    sink->data = NULL;
+    sink->length = 0;
+    sink->capacity = 0;
+}
+
+void output_sink_free(OutputSink* sink) {
+    xfree(sink->data);
+    output_sink_init(sink);
+}
+
+void output_sink_reserve(OutputSink* sink, size_t extra) {
+    size_t needed = sink->length + extra + 1;  /* +1 for the terminator */
+    if (needed <= sink->capacity) {
+        return;
+    }
+    size_t new_capacity = sink->capacity == 0 ? 16384 : sink->capacity;
+    while (new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    sink->data = xrealloc(sink->data, new_capacity);
+    sink->capacity = new_capacity;
+}
+
+void output_sink_append_n(OutputSink* sink, const char* str, size_t n) {
+    output_sink_reserve(sink, n);
+    memcpy(sink->data + sink->length, str, n);
+    sink->length += n;
+    sink->data[sink->length] = '\0';
+}
+
+void output_sink_append(OutputSink* sink, const char* str) {
+    output_sink_append_n(sink, str, strlen(str));
+}
+
+void output_sink_append_char(OutputSink* sink, char c) {
+    output_sink_reserve(sink, 1);
+    sink->data[sink->length++] = c;
+    sink->data[sink->length] = '\0';
+}
+
+void output_sink_append_int(OutputSink* sink, long long value) {
+    char tmp[24];
+    int i = sizeof(tmp);
+    /* Work on the magnitude as unsigned so LLONG_MIN is handled */
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value
+                                             : (unsigned long long)value;
+    do {
+        tmp[--i] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+    if (value < 0) {
+        tmp[--i] = '-';
+    }
+    output_sink_append_n(sink, tmp + i, sizeof(tmp) - i);
+}
+
+void output_sink_append_spaces(OutputSink* sink, int count) {
+    if (count <= 0) return;
+    output_sink_reserve(sink, (size_t)count);
+    memset(sink->data + sink->length, ' ', (size_t)count);
+    sink->length += (size_t)count;
+    sink->data[sink->length] = '\0';
+}
+
+char* output_sink_detach(OutputSink* sink, size_t* out_length) {
+    char* data = sink->data;
+    if (!data) {
+        data = xstrdup("");
+    }
+    if (out_length) {
+        *out_length = sink->length;
+    }
+    output_sink_init(sink);
+    return data;
+}
+
+/* Helper: write() all bytes, retrying on short writes */
+static int write_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            return 0;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return 1;
+}
+
+int output_sink_write_file(const OutputSink* sink, FILE* file) {
+    if (!file) return 0;
+    if (fflush(file) != 0) return 0;
+    if (sink->length == 0) return 1;
+    return write_all(fileno(file), sink->data, sink->length);
+}
+
+int output_sink_write_path(const OutputSink* sink, const char* path, int use_mmap) {
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return 0;
+    }
+
+    int ok;
+    if (use_mmap && sink->length > 0) {
+        ok = 0;
+        if (ftruncate(fd, (off_t)sink->length) == 0) {
+            void* map = mmap(NULL, sink->length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (map != MAP_FAILED) {
+                memcpy(map, sink->data, sink->length);
+                ok = munmap(map, sink->length) == 0;
+            }
+        }
+    } else {
+        ok = write_all(fd, sink->data, sink->length);
+    }
+
+    if (close(fd) != 0) {
+        ok = 0;
+    }
+    return ok;
+}
@@ -0,0 +1,44 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/* In-memory output buffer shared by the code generators.
+ *
+ * Generated code is appended to a growable buffer and written out in one
+ * large block, or handed to the caller for in-process use. */
+typedef struct {
+    char* data;         /* NUL-terminated contents (NULL while empty) */
+    size_t length;      /* Bytes used, excluding the terminator */
+    size_t capacity;    /* Bytes allocated */
+} OutputSink;
+
+/* Lifetime */
+void output_sink_init(OutputSink* sink);
+void output_sink_free(OutputSink* sink);
+
+/* Make room for at least `extra` more bytes */
+void output_sink_reserve(OutputSink* sink, size_t extra);
+
+/* Appending */
+void output_sink_append(OutputSink* sink, const char* str);
+void output_sink_append_n(OutputSink* sink, const char* str, size_t n);
+void output_sink_append_char(OutputSink* sink, char c);
+void output_sink_append_int(OutputSink* sink, long long value);
+void output_sink_append_spaces(OutputSink* sink, int count);
+
+/* Take ownership of the contents (NUL-terminated, free with xfree).
+ * Sets *out_length if non-NULL and leaves the sink empty. Never NULL. */
+char* output_sink_detach(OutputSink* sink, size_t* out_length);
+
+/* Write the contents to an open stream with a single write() after
+ * flushing anything already buffered in it. Returns 1 on success. */
+int output_sink_write_file(const OutputSink* sink, FILE* file);
+
+/* Write the contents to a file, replacing it. With use_mmap the file is
+ * sized up front and filled through a shared mapping instead of write().
+ * Returns 1 on success. */
+int output_sink_write_path(const OutputSink* sink, const char* path, int use_mmap);
+
+#endif /* OUTPUT_SINK_H */
@@ -124,6 +124,64 @@ static ASTExpression* parse_expression(Parser* parser);
 static ASTStatement* parse_statement(Parser* parser);
 static void parse_block(Parser* parser, ASTBlock* out_block);
 
+/* Bit intrinsics, called like functions but parsed as operators */
+typedef struct {
+    const char* name;
+    int is_binary;
+    int op;             /* UnaryOpType or BinaryOpType */
+} BitIntrinsic;
+
+static const BitIntrinsic BIT_INTRINSICS[] = {
+    {"popcount", 0, UNOP_POPCOUNT},
+    {"clz", 0, UNOP_CLZ},
+    {"ctz", 0, UNOP_CTZ},
+    {"rotl", 1, BINOP_ROTL},
+    {"rotr", 1, BINOP_ROTR},
+};
+
+/* Helper: Turn a call to a bit intrinsic into the operator it names.
+ * Other calls are returned unchanged. */
+static ASTExpression* parse_intrinsic_call(Parser* parser, ASTExpression* call) {
+    ASTFunctionCall* fc = &call->as.function_call;
+    const BitIntrinsic* intrinsic = NULL;
+    for (size_t i = 0; i < sizeof(BIT_INTRINSICS) / sizeof(BIT_INTRINSICS[0]); i++) {
+        if (strcmp(fc->function_name, BIT_INTRINSICS[i].name) == 0) {
+            intrinsic = &BIT_INTRINSICS[i];
+            break;
+        }
+    }
+    if (!intrinsic) return call;
+    
+    int expected = intrinsic->is_binary ? 2 : 1;
+    if (fc->argument_count != expected) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "'%s' takes %d argument%s", intrinsic->name,
+                 expected, expected == 1 ? "" : "s");
+        error_list_add(parser->errors, msg, call->location);
+        return call;
+    }
+    
+    ASTExpression* operands[2];
+    for (int i = 0; i < expected; i++) {
+        operands[i] = xmalloc(sizeof(ASTExpression));
+        *operands[i] = fc->arguments[i];
+    }
+    xfree(fc->arguments);
+    xfree(fc->function_name);
+    
+    if (intrinsic->is_binary) {
+        call->type = EXPR_BINARY_OP;
+        call->as.binary_op.op = (BinaryOpType)intrinsic->op;
+        call->as.binary_op.left = operands[0];
+        call->as.binary_op.right = operands[1];
+    } else {
+        call->type = EXPR_UNARY_OP;
+        call->as.unary_op.op = (UnaryOpType)intrinsic->op;
+        call->as.unary_op.operand = operands[0];
+    }
+    return call;
+}
+
 /* Parse primary expression: literals, variables, parenthesized expressions, function calls */
 static ASTExpression* parse_primary(Parser* parser) {
     Token token = current_token(parser);
@@ -224,11 +282,52 @@ static ASTExpression* parse_primary(Parser* parser) {
                 parser_error(parser, "Expected ')' after function arguments");
             }
             
+            return parse_intrinsic_call(parser, expr);
+        } else if (check(parser, TOK_LBRACKET)) {
+            advance(parser);  /* consume '[' */
+            
+            ASTExpression* expr = ast_expression_create(EXPR_INDEX, location);
+            expr->as.index.array_name = name;
+            expr->as.index.global_index = -1;
+            expr->as.index.array_length = 0;
+            expr->as.index.bounds_checked = 1;
+            expr->as.index.location = location;
+            expr->as.index.index = parse_expression(parser);
+            if (!expr->as.index.index) {
+                parser_error(parser, "Expected index expression");
+                ast_expression_free(expr);
+                return NULL;
+            }
+            
+            if (!match(parser, TOK_RBRACKET)) {
+                parser_error(parser, "Expected ']' after array index");
+            }
+            
+            return expr;
+        } else if (check(parser, TOK_DOT)) {
+            advance(parser);  /* consume '.' */
+            
+            if (!check(parser, TOK_IDENTIFIER)) {
+                parser_error(parser, "Expected field name after '.'");
+                xfree(name);
+                return NULL;
+            }
+            
+            ASTExpression* expr = ast_expression_create(EXPR_FIELD, location);
+            expr->as.field.object_name = name;
+            expr->as.field.field_name = xstrndup(current_token(parser).lexeme, current_token(parser).lexeme_len);
+            expr->as.field.struct_index = -1;
+            expr->as.field.field_index = -1;
+            expr->as.field.by_reference = 0;
+            expr->as.field.location = location;
+            advance(parser);
             return expr;
         } else {
             /* Just a variable reference */
             ASTExpression* expr = ast_expression_create(EXPR_VARIABLE, location);
             expr->as.variable.name = name;
+            expr->as.variable.struct_index = -1;
+            expr->as.variable.by_reference = 0;
             return expr;
         }
     }
@@ -247,10 +346,19 @@ static ASTExpression* parse_primary(Parser* parser) {
     return NULL;
 }
 
-/* Parse unary expressions: -x, !x */
+/* Parse unary expressions: -x, !x, ~x */
 static ASTExpression* parse_unary(Parser* parser) {
     Token token = current_token(parser);
     
+    if (token.type == TOK_TILDE) {
+        SourceLocation location = token.location;
+        advance(parser);
+        ASTExpression* expr = ast_expression_create(EXPR_UNARY_OP, location);
+        expr->as.unary_op.op = UNOP_BIT_NOT;
+        expr->as.unary_op.operand = parse_unary(parser);
+        return expr;
+    }
+    
     if (token.type == TOK_MINUS) {
         SourceLocation location = token.location;
         advance(parser);
@@ -272,9 +380,35 @@ static ASTExpression* parse_unary(Parser* parser) {
     return parse_primary(parser);
 }
 
+/* Parse casts: x as T. Binds tighter than any binary operator, so
+ * `-x as u8` is `(-x) as u8` and `a + b as i64` widens only b. */
+static ASTExpression* parse_cast(Parser* parser) {
+    ASTExpression* expr = parse_unary(parser);
+    
+    while (expr && check(parser, TOK_AS)) {
+        SourceLocation location = current_token(parser).location;
+        advance(parser);
+        
+        Token type_token = current_token(parser);
+        if (!(type_token.type >= TOK_I8 && type_token.type <= TOK_BOOL)) {
+            parser_error(parser, "Expected type after 'as'");
+            return expr;
+        }
+        advance(parser);
+        
+        ASTExpression* cast = ast_expression_create(EXPR_UNARY_OP, location);
+        cast->as.unary_op.op = UNOP_CAST;
+        cast->as.unary_op.target_type = token_type_to_casm_type(type_token.type);
+        cast->as.unary_op.operand = expr;
+        expr = cast;
+    }
+    
+    return expr;
+}
+
 /* Parse multiplicative expressions: *, /, % */
 static ASTExpression* parse_multiplicative(Parser* parser) {
-    ASTExpression* expr = parse_unary(parser);
+    ASTExpression* expr = parse_cast(parser);
     
     while (1) {
         Token token = current_token(parser);
@@ -293,7 +427,7 @@ static ASTExpression* parse_multiplicative(Parser* parser) {
         SourceLocation location = token.location;
         advance(parser);
         
-        ASTExpression* right = parse_unary(parser);
+        ASTExpression* right = parse_cast(parser);
         if (!right) {
             parser_error(parser, "Expected expression after operator");
             return expr;
@@ -346,9 +480,45 @@ static ASTExpression* parse_additive(Parser* parser) {
     return expr;
 }
 
+/* Parse shift expressions: <<, >> */
+static ASTExpression* parse_shift(Parser* parser) {
+    ASTExpression* expr = parse_additive(parser);
+    
+    while (1) {
+        Token token = current_token(parser);
+        BinaryOpType op;
+        
+        if (token.type == TOK_SHL) {
+            op = BINOP_SHL;
+        } else if (token.type == TOK_SHR) {
+            op = BINOP_SHR;
+        } else {
+            break;
+        }
+        
+        SourceLocation location = token.location;
+        advance(parser);
+        
+        ASTExpression* right = parse_additive(parser);
+        if (!right) {
+            parser_error(parser, "Expected expression after operator");
+            return expr;
+        }
+        
+        ASTExpression* new_expr = ast_expression_create(EXPR_BINARY_OP, location);
+        new_expr->as.binary_op.left = expr;
+        new_expr->as.binary_op.right = right;
+        new_expr->as.binary_op.op = op;
+        
+        expr = new_expr;
+    }
+    
+    return expr;
+}
+
 /* Parse relational expressions: <, >, <=, >= */
 static ASTExpression* parse_relational(Parser* parser) {
-    ASTExpression* expr = parse_additive(parser);
+    ASTExpression* expr = parse_shift(parser);
     
     while (1) {
         Token token = current_token(parser);
@@ -369,7 +539,7 @@ static ASTExpression* parse_relational(Parser* parser) {
         SourceLocation location = token.location;
         advance(parser);
         
-        ASTExpression* right = parse_additive(parser);
+        ASTExpression* right = parse_shift(parser);
         if (!right) {
             parser_error(parser, "Expected expression after operator");
             return expr;
@@ -422,15 +592,90 @@ static ASTExpression* parse_equality(Parser* parser) {
     return expr;
 }
 
+/* Parse bitwise AND: & */
+static ASTExpression* parse_bitwise_and(Parser* parser) {
+    ASTExpression* expr = parse_equality(parser);
+    
+    while (check(parser, TOK_AMP)) {
+        SourceLocation location = current_token(parser).location;
+        advance(parser);
+        
+        ASTExpression* right = parse_equality(parser);
+        if (!right) {
+            parser_error(parser, "Expected expression after &");
+            return expr;
+        }
+        
+        ASTExpression* new_expr = ast_expression_create(EXPR_BINARY_OP, location);
+        new_expr->as.binary_op.left = expr;
+        new_expr->as.binary_op.right = right;
+        new_expr->as.binary_op.op = BINOP_BIT_AND;
+        
+        expr = new_expr;
+    }
+    
+    return expr;
+}
+
+/* Parse bitwise XOR: ^ */
+static ASTExpression* parse_bitwise_xor(Parser* parser) {
+    ASTExpression* expr = parse_bitwise_and(parser);
+    
+    while (check(parser, TOK_CARET)) {
+        SourceLocation location = current_token(parser).location;
+        advance(parser);
+        
+        ASTExpression* right = parse_bitwise_and(parser);
+        if (!right) {
+            parser_error(parser, "Expected expression after ^");
+            return expr;
+        }
+        
+        ASTExpression* new_expr = ast_expression_create(EXPR_BINARY_OP, location);
+        new_expr->as.binary_op.left = expr;
+        new_expr->as.binary_op.right = right;
+        new_expr->as.binary_op.op = BINOP_BIT_XOR;
+        
+        expr = new_expr;
+    }
+    
+    return expr;
+}
+
+/* Parse bitwise OR: | */
+static ASTExpression* parse_bitwise_or(Parser* parser) {
+    ASTExpression* expr = parse_bitwise_xor(parser);
+    
+    while (check(parser, TOK_PIPE)) {
+        SourceLocation location = current_token(parser).location;
+        advance(parser);
+        
+        ASTExpression* right = parse_bitwise_xor(parser);
+        if (!right) {
+            parser_error(parser, "Expected expression after |");
+            return expr;
+        }
+        
+        ASTExpression* new_expr = ast_expression_create(EXPR_BINARY_OP, location);
+        new_expr->as.binary_op.left = expr;
+        new_expr->as.binary_op.right = right;
+        new_expr->as.binary_op.op = BINOP_BIT_OR;
+        
+        expr = new_expr;
+    }
+    
+    return expr;
+}
+
 /* Parse logical AND: && */
 static ASTExpression* parse_logical_and(Parser* parser) {
-    ASTExpression* expr = parse_equality(parser);
+    ASTExpression* expr = parse_bitwise_or(parser);
     
     while (check(parser, TOK_AND)) {
         SourceLocation location = current_token(parser).location;
         advance(parser);
         
-        ASTExpression* right = parse_equality(parser);
+        ASTExpression* right = parse_bitwise_or(parser);
         if (!right) {
             parser_error(parser, "Expected expression after &&");
             return expr;
@@ -480,9 +725,8 @@ static ASTExpression* parse_assignment(Parser* parser) {
         SourceLocation location = current_token(parser).location;
         advance(parser);
         
-        /* For now, only support variable assignment */
-        if (expr->type != EXPR_VARIABLE) {
-            parser_error(parser, "Can only assign to variables");
+        if (expr->type != EXPR_VARIABLE && expr->type != EXPR_INDEX && expr->type != EXPR_FIELD) {
+            parser_error(parser, "Can only assign to variables, array elements and struct fields");
             return expr;
         }
         
@@ -608,7 +852,9 @@ static ASTStatement* parse_if_statement(Parser* parser) {
                 return NULL;
             }
             
-            ASTBlock elif_body = *parse_block_stmt(parser);
+            ASTBlock* elif_block = parse_block_stmt(parser);
+            ASTBlock elif_body = *elif_block;
+            xfree(elif_block);
             
             ASTElseIfClause* elif_clause = ast_else_if_create(elif_cond, elif_body, location);
             *else_if_tail = elif_clause;
@@ -697,6 +943,9 @@ static ASTStatement* parse_for_statement(Parser* parser) {
             /* Variable declaration in for init */
             init = parse_statement(parser);
             /* Don't consume semicolon here - parse_statement for var decl already did */
+            if (init && init->type == STMT_VAR_DECL && init->as.var_decl_stmt.var_decl.array_length > 0) {
+                parser_error(parser, "Arrays cannot be declared in a for loop header");
+            }
         } else {
             /* Expression statement */
             ASTExpression* expr = parse_expression(parser);
@@ -801,6 +1050,13 @@ static char* extract_expression_name(const ASTExpression* expr) {
                 case BINOP_MUL: op_str = "*"; break;
                 case BINOP_DIV: op_str = "/"; break;
                 case BINOP_MOD: op_str = "%"; break;
+                case BINOP_BIT_AND: op_str = "&"; break;
+                case BINOP_BIT_OR: op_str = "|"; break;
+                case BINOP_BIT_XOR: op_str = "^"; break;
+                case BINOP_SHL: op_str = "<<"; break;
+                case BINOP_SHR: op_str = ">>"; break;
+                case BINOP_ROTL: return xstrdup("rotl()");
+                case BINOP_ROTR: return xstrdup("rotr()");
                 case BINOP_EQ: op_str = "=="; break;
                 case BINOP_NE: op_str = "!="; break;
                 case BINOP_LT: op_str = "<"; break;
@@ -824,6 +1080,17 @@ static char* extract_expression_name(const ASTExpression* expr) {
             switch (unop->op) {
                 case UNOP_NEG: op_str = "-"; break;
                 case UNOP_NOT: op_str = "!"; break;
+                case UNOP_BIT_NOT: op_str = "~"; break;
+                case UNOP_POPCOUNT: return xstrdup("popcount()");
+                case UNOP_CLZ: return xstrdup("clz()");
+                case UNOP_CTZ: return xstrdup("ctz()");
+                case UNOP_CAST: {
+                    char* operand_name = extract_expression_name(unop->operand);
+                    snprintf(buffer, sizeof(buffer), "%s as %s", operand_name,
+                             type_to_string(unop->target_type));
+                    xfree(operand_name);
+                    return xstrdup(buffer);
+                }
                 default: op_str = "?"; break;
             }
             
@@ -836,6 +1103,18 @@ static char* extract_expression_name(const ASTExpression* expr) {
             return xstrdup(buffer);
         }
         
+        case EXPR_INDEX: {
+            char* index_name = extract_expression_name(expr->as.index.index);
+            snprintf(buffer, sizeof(buffer), "%s[%s]", expr->as.index.array_name, index_name);
+            xfree(index_name);
+            return xstrdup(buffer);
+        }
+        
+        case EXPR_FIELD: {
+            snprintf(buffer, sizeof(buffer), "%s.%s", expr->as.field.object_name, expr->as.field.field_name);
+            return xstrdup(buffer);
+        }
+        
         default:
             return xstrdup("expr");
     }
@@ -907,6 +1186,73 @@ static ASTStatement* parse_dbg_statement(Parser* parser) {
     return stmt;
 }
 
+/* Helper: Parse an array or struct initializer list of integer
+ * constants: {1, -2, 3} */
+static void parse_array_initializer(Parser* parser, ASTVarDecl* decl) {
+    if (!match(parser, TOK_LBRACE)) {
+        parser_error(parser, decl->type.type == TYPE_STRUCT ? "Expected '{' to initialize struct"
+                                                            : "Expected '{' to initialize array");
+        return;
+    }
+    
+    int capacity = 8;
+    decl->elements = xmalloc(capacity * sizeof(long));
+    while (!check(parser, TOK_RBRACE)) {
+        int negative = match(parser, TOK_MINUS);
+        if (!check(parser, TOK_INT_LITERAL)) {
+            parser_error(parser, "Initializer elements must be integer constants");
+            return;
+        }
+        if (decl->element_count >= capacity) {
+            capacity *= 2;
+            decl->elements = xrealloc(decl->elements, capacity * sizeof(long));
+        }
+        long value = advance(parser).int_value;
+        decl->elements[decl->element_count++] = negative ? -value : value;
+        
+        if (!match(parser, TOK_COMMA)) {
+            break;
+        }
+    }
+    
+    if (!match(parser, TOK_RBRACE)) {
+        parser_error(parser, "Expected '}' after initializer list");
+    }
+}
+
+/* Helper: Parse what follows the name in a variable declaration: an
+ * optional array length, an optional initializer and the ';' */
+static void parse_var_decl_rest(Parser* parser, ASTVarDecl* decl) {
+    if (match(parser, TOK_LBRACKET)) {
+        if (!check(parser, TOK_INT_LITERAL) || current_token(parser).int_value <= 0) {
+            parser_error(parser, "Array length must be a positive integer literal");
+        } else {
+            /* Oversized lengths are reported by semantic analysis */
+            long length = advance(parser).int_value;
+            decl->array_length = length > MAX_ARRAY_LENGTH ? MAX_ARRAY_LENGTH + 1 : (int)length;
+        }
+        if (!match(parser, TOK_RBRACKET)) {
+            parser_error(parser, "Expected ']' after array length");
+        }
+    }
+    
+    /* Check for initializer */
+    if (match(parser, TOK_ASSIGN)) {
+        if (decl->array_length > 0 || decl->type.type == TYPE_STRUCT) {
+            parse_array_initializer(parser, decl);
+        } else {
+            decl->initializer = parse_expression(parser);
+            if (!decl->initializer) {
+                parser_error(parser, "Expected expression after =");
+            }
+        }
+    }
+    
+    if (!match(parser, TOK_SEMICOLON)) {
+        parser_error(parser, "Expected ';' after variable declaration");
+    }
+}
+
 /* Parse a statement - caller must free returned statement */
 static ASTStatement* parse_statement(Parser* parser) {
     Token token = current_token(parser);
@@ -932,6 +1278,18 @@ static ASTStatement* parse_statement(Parser* parser) {
         return stmt;
     }
     
+    /* Loop exits; semantic analysis checks they are inside a loop */
+    if (token.type == TOK_BREAK || token.type == TOK_CONTINUE) {
+        advance(parser);
+        ASTStatement* stmt = ast_statement_create(token.type == TOK_BREAK ? STMT_BREAK : STMT_CONTINUE,
+                                                  token.location);
+        if (!match(parser, TOK_SEMICOLON)) {
+            parser_error(parser, token.type == TOK_BREAK ? "Expected ';' after 'break'"
+                                                         : "Expected ';' after 'continue'");
+        }
+        return stmt;
+    }
+    
     /* Control flow statements */
     if (token.type == TOK_IF) {
         return parse_if_statement(parser);
@@ -983,23 +1341,30 @@ static ASTStatement* parse_statement(Parser* parser) {
         advance(parser);
         
         ASTStatement* stmt = ast_statement_create(STMT_VAR_DECL, location);
+        memset(&stmt->as.var_decl_stmt.var_decl, 0, sizeof(ASTVarDecl));
         stmt->as.var_decl_stmt.var_decl.name = name;
         stmt->as.var_decl_stmt.var_decl.type = type;
         stmt->as.var_decl_stmt.var_decl.location = location;
-        stmt->as.var_decl_stmt.var_decl.initializer = NULL;
-        
-        /* Check for initializer */
-        if (match(parser, TOK_ASSIGN)) {
-            stmt->as.var_decl_stmt.var_decl.initializer = parse_expression(parser);
-            if (!stmt->as.var_decl_stmt.var_decl.initializer) {
-                parser_error(parser, "Expected expression after =");
-            }
-        }
-        
-        if (!match(parser, TOK_SEMICOLON)) {
-            parser_error(parser, "Expected ';' after variable declaration");
-        }
-        
+        parse_var_decl_rest(parser, &stmt->as.var_decl_stmt.var_decl);
+        return stmt;
+    }
+    
+    /* Struct variable declaration: `Name var` */
+    if (token.type == TOK_IDENTIFIER && parser->current + 1 < parser->token_count &&
+        parser->tokens[parser->current + 1].type == TOK_IDENTIFIER) {
+        SourceLocation location = token.location;
+        ASTStatement* stmt = ast_statement_create(STMT_VAR_DECL, location);
+        ASTVarDecl* decl = &stmt->as.var_decl_stmt.var_decl;
+        memset(decl, 0, sizeof(ASTVarDecl));
+        decl->type.type = TYPE_STRUCT;
+        decl->type.location = location;
+        decl->struct_name = xstrndup(token.lexeme, token.lexeme_len);
+        decl->struct_index = -1;
+        advance(parser);
+        decl->name = xstrndup(current_token(parser).lexeme, current_token(parser).lexeme_len);
+        decl->location = location;
+        advance(parser);
+        parse_var_decl_rest(parser, decl);
         return stmt;
     }
     
@@ -1228,7 +1593,10 @@ static int parse_function(Parser* parser, ASTFunctionDef* out_func) {
         
         while (1) {
             Token param_token = current_token(parser);
-            if (!(param_token.type == TOK_I8 || param_token.type == TOK_I16 ||
+            char* struct_name = NULL;
+            if (param_token.type == TOK_IDENTIFIER) {
+                struct_name = xstrndup(param_token.lexeme, param_token.lexeme_len);
+            } else if (!(param_token.type == TOK_I8 || param_token.type == TOK_I16 ||
                   param_token.type == TOK_I32 || param_token.type == TOK_I64 ||
                   param_token.type == TOK_U8 || param_token.type == TOK_U16 ||
                   param_token.type == TOK_U32 || param_token.type == TOK_U64 ||
@@ -1247,12 +1615,13 @@ static int parse_function(Parser* parser, ASTFunctionDef* out_func) {
             }
             
             TypeNode param_type;
-            param_type.type = token_type_to_casm_type(param_token.type);
+            param_type.type = struct_name ? TYPE_STRUCT : token_type_to_casm_type(param_token.type);
             param_type.location = param_token.location;
             advance(parser);
             
             if (!check(parser, TOK_IDENTIFIER)) {
                 parser_error(parser, "Expected parameter name");
+                xfree(struct_name);
                 break;
             }
             
@@ -1267,6 +1636,8 @@ static int parse_function(Parser* parser, ASTFunctionDef* out_func) {
             
             out_func->parameters[out_func->parameter_count].name = param_name;
             out_func->parameters[out_func->parameter_count].type = param_type;
+            out_func->parameters[out_func->parameter_count].struct_name = struct_name;
+            out_func->parameters[out_func->parameter_count].struct_index = -1;
             out_func->parameters[out_func->parameter_count].location = param_location;
             out_func->parameter_count++;
             
@@ -1287,6 +1658,90 @@ static int parse_function(Parser* parser, ASTFunctionDef* out_func) {
     return parser->errors->error_count == error_count_before;
 }
 
+/* Parse a module-level declaration: `T name;`, `T name = constant;`,
+ * `T name[N];` or `T name[N] = {...};`, where T may name a struct */
+static int parse_global(Parser* parser, ASTGlobalVar* out_global) {
+    int error_count_before = parser->errors->error_count;
+    Token token = advance(parser);  /* type */
+    ASTVarDecl* decl = &out_global->decl;
+    if (token.type == TOK_IDENTIFIER) {
+        decl->type.type = TYPE_STRUCT;
+        decl->struct_name = xstrndup(token.lexeme, token.lexeme_len);
+        decl->struct_index = -1;
+    } else {
+        decl->type.type = token_type_to_casm_type(token.type);
+    }
+    decl->type.location = token.location;
+    decl->location = token.location;
+    decl->name = xstrndup(current_token(parser).lexeme, current_token(parser).lexeme_len);
+    advance(parser);  /* name */
+    
+    parse_var_decl_rest(parser, decl);
+    return parser->errors->error_count == error_count_before;
+}
+
+/* Parse a struct type: `struct Name { T field; ... }`, optionally
+ * preceded by `packed` */
+static int parse_struct(Parser* parser, ASTStructDef* out_struct) {
+    int error_count_before = parser->errors->error_count;
+    out_struct->location = current_token(parser).location;
+    out_struct->packed = match(parser, TOK_PACKED);
+    if (!match(parser, TOK_STRUCT)) {
+        parser_error(parser, "Expected 'struct' after 'packed'");
+        return 0;
+    }
+    
+    if (!check(parser, TOK_IDENTIFIER)) {
+        parser_error(parser, "Expected struct name");
+        return 0;
+    }
+    out_struct->name = xstrndup(current_token(parser).lexeme, current_token(parser).lexeme_len);
+    advance(parser);
+    
+    if (!match(parser, TOK_LBRACE)) {
+        parser_error(parser, "Expected '{' after struct name");
+        return 0;
+    }
+    
+    int field_capacity = 4;
+    out_struct->fields = xmalloc(field_capacity * sizeof(ASTStructField));
+    while (!check(parser, TOK_RBRACE) && !check(parser, TOK_EOF)) {
+        Token type_token = current_token(parser);
+        if (!(type_token.type >= TOK_I8 && type_token.type <= TOK_VOID)) {
+            parser_error(parser, "Expected field type in struct");
+            return 0;
+        }
+        advance(parser);
+        
+        if (!check(parser, TOK_IDENTIFIER)) {
+            parser_error(parser, "Expected field name");
+            return 0;
+        }
+        
+        if (out_struct->field_count >= field_capacity) {
+            field_capacity *= 2;
+            out_struct->fields = xrealloc(out_struct->fields, field_capacity * sizeof(ASTStructField));
+        }
+        ASTStructField* field = &out_struct->fields[out_struct->field_count++];
+        field->type.type = token_type_to_casm_type(type_token.type);
+        field->type.location = type_token.location;
+        field->name = xstrndup(current_token(parser).lexeme, current_token(parser).lexeme_len);
+        field->location = current_token(parser).location;
+        field->offset = 0;
+        advance(parser);
+        
+        if (!match(parser, TOK_SEMICOLON)) {
+            parser_error(parser, "Expected ';' after struct field");
+            return 0;
+        }
+    }
+    
+    if (!match(parser, TOK_RBRACE)) {
+        parser_error(parser, "Expected '}' after struct fields");
+    }
+    return parser->errors->error_count == error_count_before;
+}
+
 /* Main parsing function */
 ASTProgram* parser_parse(Parser* parser) {
     ASTProgram* program = ast_program_create();
@@ -1327,6 +1782,40 @@ ASTProgram* parser_parse(Parser* parser) {
             program->functions = xrealloc(program->functions, func_capacity * sizeof(ASTFunctionDef));
         }
         
+        if (check(parser, TOK_STRUCT) || check(parser, TOK_PACKED)) {
+            ASTStructDef temp_struct;
+            memset(&temp_struct, 0, sizeof(ASTStructDef));
+            if (parse_struct(parser, &temp_struct)) {
+                program->structs = xrealloc(program->structs, (program->struct_count + 1) * sizeof(ASTStructDef));
+                program->structs[program->struct_count++] = temp_struct;
+            } else {
+                ast_struct_free_contents(&temp_struct);
+                /* Skip to the end of the definition */
+                while (!check(parser, TOK_RBRACE) && !check(parser, TOK_EOF)) {
+                    advance(parser);
+                }
+                match(parser, TOK_RBRACE);
+            }
+            continue;
+        }
+        
+        /* `type name` not followed by `(` starts a module-level variable */
+        TokenType type_token = current_token(parser).type;
+        if (((type_token >= TOK_I8 && type_token <= TOK_BOOL) || type_token == TOK_IDENTIFIER) &&
+            parser->current + 2 < parser->token_count &&
+            parser->tokens[parser->current + 1].type == TOK_IDENTIFIER &&
+            parser->tokens[parser->current + 2].type != TOK_LPAREN) {
+            ASTGlobalVar temp_global;
+            memset(&temp_global, 0, sizeof(ASTGlobalVar));
+            if (parse_global(parser, &temp_global)) {
+                program->globals = xrealloc(program->globals, (program->global_count + 1) * sizeof(ASTGlobalVar));
+                program->globals[program->global_count++] = temp_global;
+            } else {
+                ast_global_free_contents(&temp_global);
+            }
+            continue;
+        }
+        
         ASTFunctionDef temp_func = {0};
         if (parse_function(parser, &temp_func)) {
             program->functions[program->function_count] = temp_func;
@@ -0,0 +1,1059 @@
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include "ranges.h"
+#include "optimizer.h"
+#include "types.h"
+#include "utils.h"
+
+/* Abstract interpretation with one range per variable. Variables get a
+ * slot per declaration; names are resolved through a scope stack, so
+ * shadowing is exact. If branches are analyzed separately and joined.
+ * Loops iterate to a fixpoint with nothing recorded: bounds still growing
+ * after a few rounds are widened to the type's range, then a couple of
+ * narrowing rounds win back bounds the loop condition implies. A final
+ * round with the stable loop-entry state records what each expression
+ * can produce.
+ *
+ * Ranges are kept in signed 64-bit bounds, so u64 values are never
+ * tracked; wider results that cannot be bounded become unknown. */
+
+#define WIDEN_AFTER 3
+#define NARROW_ROUNDS 2
+
+typedef struct {
+    long long min;
+    long long max;
+} Range;
+
+/* Range of a 64-bit value nothing is known about */
+static const Range FULL = { LLONG_MIN, LLONG_MAX };
+
+/* Pointer-keyed map to an int, open addressing */
+typedef struct {
+    const void** keys;
+    int* values;
+    int capacity;
+    int count;
+} PtrMap;
+
+typedef struct {
+    Range* ranges;      /* One per slot */
+    int live;           /* 0 once control cannot reach this point */
+} Env;
+
+typedef struct {
+    const char* name;
+    int slot;
+} Binding;
+
+struct RangeFacts {
+    int slot_count;
+    CasmType* slot_types;
+    PtrMap slots;           /* ASTVarDecl* -> slot */
+
+    Binding* scope;         /* Names visible at the current point */
+    int scope_count;
+    int scope_capacity;
+
+    PtrMap recorded;        /* ASTExpression* -> index into seen */
+    Range* seen;
+    int seen_count;
+    int seen_capacity;
+    int recording;          /* Off while loops iterate */
+
+    Env* break_env;         /* States reaching `break` in the innermost loop */
+    Env* continue_env;      /* States reaching `continue` in the innermost loop */
+};
+
+/* ========================================================================
+ * Helpers
+ * ======================================================================== */
+
+static unsigned long hash_pointer(const void* key) {
+    uintptr_t value = (uintptr_t)key;
+    value ^= value >> 17;
+    value *= 0xed5ad4bbUL;
+    value ^= value >> 11;
+    return (unsigned long)value;
+}
+
+static void ptr_map_put(PtrMap* map, const void* key, int value);
+
+/* Helper: Double a map's capacity and reinsert its entries */
+static void ptr_map_grow(PtrMap* map) {
+    const void** old_keys = map->keys;
+    int* old_values = map->values;
+    int old_capacity = map->capacity;
+
+    map->capacity = (old_capacity == 0) ? 64 : old_capacity * 2;
+    map->keys = xmalloc(map->capacity * sizeof(const void*));
+    memset(map->keys, 0, map->capacity * sizeof(const void*));
+    map->values = xmalloc(map->capacity * sizeof(int));
+    map->count = 0;
+
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_keys[i]) ptr_map_put(map, old_keys[i], old_values[i]);
+    }
+    xfree(old_keys);
+    xfree(old_values);
+}
+
+static void ptr_map_put(PtrMap* map, const void* key, int value) {
+    if ((map->count + 1) * 2 > map->capacity) ptr_map_grow(map);
+    unsigned long mask = (unsigned long)map->capacity - 1;
+    unsigned long i = hash_pointer(key) & mask;
+    while (map->keys[i] && map->keys[i] != key) i = (i + 1) & mask;
+    if (!map->keys[i]) {
+        map->keys[i] = key;
+        map->count++;
+    }
+    map->values[i] = value;
+}
+
+/* Returns -1 when the key is absent */
+static int ptr_map_get(const PtrMap* map, const void* key) {
+    if (map->capacity == 0) return -1;
+    unsigned long mask = (unsigned long)map->capacity - 1;
+    unsigned long i = hash_pointer(key) & mask;
+    while (map->keys[i]) {
+        if (map->keys[i] == key) return map->values[i];
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+static void ptr_map_free(PtrMap* map) {
+    xfree(map->keys);
+    xfree(map->values);
+}
+
+static int is_full(Range r) {
+    return r.min == LLONG_MIN || r.max == LLONG_MAX;
+}
+
+/* Helper: Every value a type can hold */
+static Range type_range(CasmType type) {
+    Range r = FULL;
+    if (type == TYPE_BOOL) {
+        r.min = 0;
+        r.max = 1;
+        return r;
+    }
+    int bits = get_type_size_bits(type);
+    if (bits < 0 || bits >= 64) return r;
+    if (type >= TYPE_I8 && type <= TYPE_I64) {
+        r.min = -(1LL << (bits - 1));
+        r.max = (1LL << (bits - 1)) - 1;
+    } else {
+        r.min = 0;
+        r.max = (1LL << bits) - 1;
+    }
+    return r;
+}
+
+/* Helper: Values an operation of this type is computed in. Sub-32-bit
+ * types are promoted to (signed) int, as in C. */
+static Range domain_range(CasmType type) {
+    int bits = get_type_size_bits(type);
+    if (bits > 0 && bits < 32) return type_range(TYPE_I32);
+    return type_range(type);
+}
+
+/* Helper: The range of a sub-32-bit arithmetic result, if every backend
+ * agrees on it. C promotes the operands to int while WAT, the IR and x86
+ * compute in u32, so only results in [0, INT32_MAX] mean the same value
+ * everywhere; anything else is unknown. */
+static Range narrow_result(CasmType type, Range r) {
+    int bits = get_type_size_bits(type);
+    if (bits <= 0 || bits >= 32) return r;
+    return r.min >= 0 && r.max <= INT_MAX ? r : FULL;
+}
+
+/* Helper: Range of a bitwise result, computed in the promoted type */
+static Range bits_domain(CasmType type) {
+    int bits = get_type_size_bits(type);
+    if (bits > 0 && bits < 32) return type_range(type >= TYPE_U8 ? TYPE_U32 : TYPE_I32);
+    return type_range(type);
+}
+
+static int range_within(Range inner, Range outer) {
+    return inner.min >= outer.min && inner.max <= outer.max;
+}
+
+/* Helper: A computed range, or the whole domain if it may have wrapped */
+static Range clamp_to(Range r, Range domain) {
+    return range_within(r, domain) ? r : domain;
+}
+
+static Range range_union(Range a, Range b) {
+    Range r;
+    r.min = a.min < b.min ? a.min : b.min;
+    r.max = a.max > b.max ? a.max : b.max;
+    return r;
+}
+
+static Range make_range(long long min, long long max) {
+    Range r;
+    r.min = min;
+    r.max = max;
+    return r;
+}
+
+/* Helper: Bounds small enough that sums cannot overflow */
+static int is_small(Range r) {
+    return r.min >= -(1LL << 32) && r.max <= (1LL << 32);
+}
+
+/* Helper: Bounds small enough that products cannot overflow */
+static int is_tiny(Range r) {
+    return r.min >= -(1LL << 31) && r.max <= (1LL << 31);
+}
+
+/* ========================================================================
+ * Environments
+ * ======================================================================== */
+
+static Env env_create(const RangeFacts* f) {
+    Env env;
+    env.ranges = xmalloc((f->slot_count + 1) * sizeof(Range));
+    for (int i = 0; i < f->slot_count; i++) {
+        env.ranges[i] = type_range(f->slot_types[i]);
+    }
+    env.live = 1;
+    return env;
+}
+
+static Env env_copy(const RangeFacts* f, const Env* src) {
+    Env env;
+    env.ranges = xmalloc((f->slot_count + 1) * sizeof(Range));
+    memcpy(env.ranges, src->ranges, f->slot_count * sizeof(Range));
+    env.live = src->live;
+    return env;
+}
+
+static void env_assign(const RangeFacts* f, Env* dst, const Env* src) {
+    memcpy(dst->ranges, src->ranges, f->slot_count * sizeof(Range));
+    dst->live = src->live;
+}
+
+/* Helper: dst = dst joined with src */
+static void env_join(const RangeFacts* f, Env* dst, const Env* src) {
+    if (!src->live) return;
+    if (!dst->live) {
+        env_assign(f, dst, src);
+        return;
+    }
+    for (int i = 0; i < f->slot_count; i++) {
+        dst->ranges[i] = range_union(dst->ranges[i], src->ranges[i]);
+    }
+}
+
+static int env_equal(const RangeFacts* f, const Env* a, const Env* b) {
+    if (a->live != b->live) return 0;
+    if (!a->live) return 1;
+    for (int i = 0; i < f->slot_count; i++) {
+        if (a->ranges[i].min != b->ranges[i].min || a->ranges[i].max != b->ranges[i].max) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Helper: Send bounds that moved since `prev` to the edge of the type */
+static void env_widen(const RangeFacts* f, Env* next, const Env* prev) {
+    if (!prev->live) return;
+    for (int i = 0; i < f->slot_count; i++) {
+        Range limit = type_range(f->slot_types[i]);
+        if (next->ranges[i].min < prev->ranges[i].min) next->ranges[i].min = limit.min;
+        if (next->ranges[i].max > prev->ranges[i].max) next->ranges[i].max = limit.max;
+    }
+}
+
+static void env_free(Env* env) {
+    xfree(env->ranges);
+}
+
+/* ========================================================================
+ * Scopes
+ * ======================================================================== */
+
+static void scope_bind(RangeFacts* f, const char* name, int slot) {
+    if (f->scope_count >= f->scope_capacity) {
+        f->scope_capacity = (f->scope_capacity == 0) ? 32 : f->scope_capacity * 2;
+        f->scope = xrealloc(f->scope, f->scope_capacity * sizeof(Binding));
+    }
+    f->scope[f->scope_count].name = name;
+    f->scope[f->scope_count].slot = slot;
+    f->scope_count++;
+}
+
+static int scope_lookup(const RangeFacts* f, const char* name) {
+    for (int i = f->scope_count - 1; i >= 0; i--) {
+        if (strcmp(f->scope[i].name, name) == 0) return f->scope[i].slot;
+    }
+    return -1;
+}
+
+/* Helper: Give every declaration in a block its own slot */
+static void assign_slots_block(RangeFacts* f, const ASTBlock* block);
+
+static int add_slot(RangeFacts* f, CasmType type) {
+    f->slot_types = xrealloc(f->slot_types, (f->slot_count + 1) * sizeof(CasmType));
+    f->slot_types[f->slot_count] = type;
+    return f->slot_count++;
+}
+
+static void assign_slots_statement(RangeFacts* f, const ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_VAR_DECL: {
+            const ASTVarDecl* decl = &stmt->as.var_decl_stmt.var_decl;
+            ptr_map_put(&f->slots, decl, add_slot(f, decl->type.type));
+            break;
+        }
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            assign_slots_block(f, &if_stmt->then_body);
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                assign_slots_block(f, &clause->body);
+            }
+            if (if_stmt->else_body) assign_slots_block(f, if_stmt->else_body);
+            break;
+        }
+        case STMT_WHILE:
+            assign_slots_block(f, &stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            if (stmt->as.for_stmt.init) assign_slots_statement(f, stmt->as.for_stmt.init);
+            assign_slots_block(f, &stmt->as.for_stmt.body);
+            break;
+        case STMT_BLOCK:
+            assign_slots_block(f, &stmt->as.block_stmt.block);
+            break;
+        default:
+            break;
+    }
+}
+
+static void assign_slots_block(RangeFacts* f, const ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        assign_slots_statement(f, &block->statements[i]);
+    }
+}
+
+/* ========================================================================
+ * Expressions
+ * ======================================================================== */
+
+static void record(RangeFacts* f, const ASTExpression* expr, Range r) {
+    if (!f->recording) return;
+    int index = ptr_map_get(&f->recorded, expr);
+    if (index >= 0) {
+        f->seen[index] = range_union(f->seen[index], r);
+        return;
+    }
+    if (f->seen_count >= f->seen_capacity) {
+        f->seen_capacity = (f->seen_capacity == 0) ? 64 : f->seen_capacity * 2;
+        f->seen = xrealloc(f->seen, f->seen_capacity * sizeof(Range));
+    }
+    f->seen[f->seen_count] = r;
+    ptr_map_put(&f->recorded, expr, f->seen_count++);
+}
+
+static Range eval(RangeFacts* f, Env* env, const ASTExpression* expr);
+static void refine(RangeFacts* f, Env* env, const ASTExpression* cond, int truth);
+static void restrict_slot(Env* env, int slot, long long min, long long max);
+
+/* Helper: Range of `a op b` for the arithmetic operators */
+static Range eval_arithmetic(BinaryOpType op, Range a, Range b, Range domain) {
+    if (is_full(a) || is_full(b) || !is_small(a) || !is_small(b)) return domain;
+
+    switch (op) {
+        case BINOP_ADD:
+            return clamp_to(make_range(a.min + b.min, a.max + b.max), domain);
+        case BINOP_SUB:
+            return clamp_to(make_range(a.min - b.max, a.max - b.min), domain);
+        case BINOP_MUL: {
+            if (!is_tiny(a) || !is_tiny(b)) return domain;
+            long long corners[4] = { a.min * b.min, a.min * b.max, a.max * b.min, a.max * b.max };
+            Range r = make_range(corners[0], corners[0]);
+            for (int i = 1; i < 4; i++) r = range_union(r, make_range(corners[i], corners[i]));
+            return clamp_to(r, domain);
+        }
+        case BINOP_DIV: {
+            /* Quotients are extreme at the corners when 0 is not a divisor */
+            if (b.min <= 0 && b.max >= 0) return domain;
+            long long corners[4] = { a.min / b.min, a.min / b.max, a.max / b.min, a.max / b.max };
+            Range r = make_range(corners[0], corners[0]);
+            for (int i = 1; i < 4; i++) r = range_union(r, make_range(corners[i], corners[i]));
+            return clamp_to(r, domain);
+        }
+        case BINOP_MOD: {
+            /* |a % b| < |b|, with the sign of a */
+            long long limit = b.max > -b.min ? b.max : -b.min;
+            if (limit == 0) return domain;
+            Range r = make_range(a.min < 0 ? -(limit - 1) : 0, a.max > 0 ? limit - 1 : 0);
+            if (a.min >= 0 && a.max < limit) r = a;
+            return clamp_to(r, domain);
+        }
+        default:
+            return domain;
+    }
+}
+
+/* Helper: Range of a bitwise, shift or rotate operator */
+static Range eval_bitwise(BinaryOpType op, Range a, Range b, CasmType type) {
+    switch (op) {
+        case BINOP_BIT_AND:
+            /* Masking with a non-negative value bounds the result by it */
+            if (a.min >= 0 && b.min >= 0) return make_range(0, a.max < b.max ? a.max : b.max);
+            if (a.min >= 0) return make_range(0, a.max);
+            if (b.min >= 0) return make_range(0, b.max);
+            return bits_domain(type);
+        case BINOP_SHR:
+            if (a.min >= 0 && b.min >= 0 && !is_full(a)) return make_range(0, a.max);
+            return bits_domain(type);
+        case BINOP_ROTL:
+        case BINOP_ROTR:
+            return type_range(type);
+        default:
+            return bits_domain(type);
+    }
+}
+
+/* Helper: Range of a comparison: [1,1] or [0,0] when decided */
+static Range eval_comparison(BinaryOpType op, Range a, Range b) {
+    Range unknown = make_range(0, 1);
+    if (is_full(a) || is_full(b)) return unknown;
+
+    int always = 0, never = 0;
+    switch (op) {
+        case BINOP_LT: always = a.max < b.min; never = a.min >= b.max; break;
+        case BINOP_LE: always = a.max <= b.min; never = a.min > b.max; break;
+        case BINOP_GT: always = a.min > b.max; never = a.max <= b.min; break;
+        case BINOP_GE: always = a.min >= b.max; never = a.max < b.min; break;
+        case BINOP_EQ:
+            always = a.min == a.max && b.min == b.max && a.min == b.min;
+            never = a.max < b.min || b.max < a.min;
+            break;
+        case BINOP_NE:
+            always = a.max < b.min || b.max < a.min;
+            never = a.min == a.max && b.min == b.max && a.min == b.min;
+            break;
+        default:
+            return unknown;
+    }
+    if (always) return make_range(1, 1);
+    if (never) return make_range(0, 0);
+    return unknown;
+}
+
+static Range eval_binary(RangeFacts* f, Env* env, const ASTExpression* expr) {
+    const ASTBinaryOp* bin = &expr->as.binary_op;
+
+    if (bin->op == BINOP_ASSIGN) {
+        /* The element index is evaluated before the value */
+        if (bin->left->type == EXPR_INDEX) eval(f, env, bin->left);
+        Range value = eval(f, env, bin->right);
+        Range stored = clamp_to(value, type_range(bin->left->resolved_type));
+        int slot = bin->left->type == EXPR_VARIABLE ?
+            scope_lookup(f, bin->left->as.variable.name) : -1;
+        if (slot >= 0 && env->live) env->ranges[slot] = stored;
+        return stored;
+    }
+
+    if (bin->op == BINOP_AND || bin->op == BINOP_OR) {
+        Range left = eval(f, env, bin->left);
+        int is_and = bin->op == BINOP_AND;
+
+        /* The right side only runs when the left did not decide */
+        Env right_env = env_copy(f, env);
+        refine(f, &right_env, bin->left, is_and);
+        Range right = right_env.live ? eval(f, &right_env, bin->right) : make_range(0, 1);
+        if (!right_env.live) right = make_range(is_and ? 0 : 1, is_and ? 0 : 1);
+        env_join(f, env, &right_env);
+        env_free(&right_env);
+
+        if (is_and) {
+            if (left.max == 0 || right.max == 0) return make_range(0, 0);
+            if (left.min == 1 && right.min == 1) return make_range(1, 1);
+        } else {
+            if (left.min == 1 || right.min == 1) return make_range(1, 1);
+            if (left.max == 0 && right.max == 0) return make_range(0, 0);
+        }
+        return make_range(0, 1);
+    }
+
+    Range left = eval(f, env, bin->left);
+    Range right = eval(f, env, bin->right);
+    if (bin->op >= BINOP_EQ && bin->op <= BINOP_GE) {
+        return eval_comparison(bin->op, left, right);
+    }
+    if (bin->op >= BINOP_BIT_AND && bin->op <= BINOP_ROTR) {
+        return eval_bitwise(bin->op, left, right, expr->resolved_type);
+    }
+    return narrow_result(expr->resolved_type,
+                         eval_arithmetic(bin->op, left, right, domain_range(expr->resolved_type)));
+}
+
+static Range eval_uncached(RangeFacts* f, Env* env, const ASTExpression* expr) {
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            if (expr->as.literal.type == LITERAL_BOOL) {
+                return make_range(expr->as.literal.value.bool_value, expr->as.literal.value.bool_value);
+            }
+            return make_range(expr->as.literal.value.int_value, expr->as.literal.value.int_value);
+
+        case EXPR_VARIABLE: {
+            int slot = scope_lookup(f, expr->as.variable.name);
+            return slot >= 0 ? env->ranges[slot] : type_range(expr->resolved_type);
+        }
+
+        case EXPR_BINARY_OP:
+            return eval_binary(f, env, expr);
+
+        case EXPR_UNARY_OP: {
+            Range operand = eval(f, env, expr->as.unary_op.operand);
+            if (expr->as.unary_op.op == UNOP_NOT) {
+                return make_range(1 - operand.max, 1 - operand.min);
+            }
+            if (expr->as.unary_op.op == UNOP_BIT_NOT) return bits_domain(expr->resolved_type);
+            if (expr->as.unary_op.op == UNOP_CAST) {
+                /* Values the target can hold pass through; others wrap */
+                Range target = type_range(expr->resolved_type);
+                if (expr->resolved_type == TYPE_U64 && operand.min < 0) return target;
+                return clamp_to(operand, target);
+            }
+            if (expr->as.unary_op.op != UNOP_NEG) {
+                /* popcount, clz and ctz count the bits of the type */
+                return make_range(0, get_type_size_bits(expr->resolved_type));
+            }
+            if (is_full(operand)) return narrow_result(expr->resolved_type, domain_range(expr->resolved_type));
+            return narrow_result(expr->resolved_type,
+                                 clamp_to(make_range(-operand.max, -operand.min), domain_range(expr->resolved_type)));
+        }
+
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                eval(f, env, &expr->as.function_call.arguments[i]);
+            }
+            /* Return values are converted to the declared type */
+            return type_range(expr->resolved_type);
+
+        case EXPR_INDEX: {
+            const ASTIndexExpr* index = &expr->as.index;
+            eval(f, env, index->index);
+            /* Past a checked access the index is known to be in bounds */
+            if (index->index->type == EXPR_VARIABLE && env->live) {
+                int slot = scope_lookup(f, index->index->as.variable.name);
+                if (slot >= 0) restrict_slot(env, slot, 0, index->array_length - 1);
+            }
+            return type_range(expr->resolved_type);
+        }
+
+        case EXPR_FIELD:
+            /* Field stores are not tracked */
+            return type_range(expr->resolved_type);
+    }
+    return FULL;
+}
+
+static Range eval(RangeFacts* f, Env* env, const ASTExpression* expr) {
+    if (!expr) return FULL;
+    Range r = eval_uncached(f, env, expr);
+    if (expr->resolved_type == TYPE_U64) r = FULL;
+    if (env->live) record(f, expr, r);
+    return r;
+}
+
+/* Helper: Narrow a variable's range; an empty range makes env dead */
+static void restrict_slot(Env* env, int slot, long long min, long long max) {
+    Range* r = &env->ranges[slot];
+    if (min > r->min) r->min = min;
+    if (max < r->max) r->max = max;
+    if (r->min > r->max) env->live = 0;
+}
+
+/* Helper: Apply `var op bound` being true */
+static void refine_variable(Env* env, int slot, BinaryOpType op, Range bound) {
+    Range current = env->ranges[slot];
+    if (is_full(current) || is_full(bound)) return;
+
+    switch (op) {
+        case BINOP_LT: restrict_slot(env, slot, LLONG_MIN + 1, bound.max - 1); break;
+        case BINOP_LE: restrict_slot(env, slot, LLONG_MIN + 1, bound.max); break;
+        case BINOP_GT: restrict_slot(env, slot, bound.min + 1, LLONG_MAX - 1); break;
+        case BINOP_GE: restrict_slot(env, slot, bound.min, LLONG_MAX - 1); break;
+        case BINOP_EQ: restrict_slot(env, slot, bound.min, bound.max); break;
+        case BINOP_NE:
+            if (bound.min == bound.max) {
+                if (current.min == bound.min) restrict_slot(env, slot, current.min + 1, current.max);
+                else if (current.max == bound.min) restrict_slot(env, slot, current.min, current.max - 1);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static BinaryOpType negate_comparison(BinaryOpType op) {
+    switch (op) {
+        case BINOP_LT: return BINOP_GE;
+        case BINOP_LE: return BINOP_GT;
+        case BINOP_GT: return BINOP_LE;
+        case BINOP_GE: return BINOP_LT;
+        case BINOP_EQ: return BINOP_NE;
+        case BINOP_NE: return BINOP_EQ;
+        default: return op;
+    }
+}
+
+static BinaryOpType mirror_comparison(BinaryOpType op) {
+    switch (op) {
+        case BINOP_LT: return BINOP_GT;
+        case BINOP_LE: return BINOP_GE;
+        case BINOP_GT: return BINOP_LT;
+        case BINOP_GE: return BINOP_LE;
+        default: return op;
+    }
+}
+
+/* Helper: Range of a literal or variable operand, without recording */
+static int operand_range(const RangeFacts* f, const Env* env, const ASTExpression* expr, Range* out) {
+    if (expr->resolved_type == TYPE_U64) return 0;
+    if (expr->type == EXPR_LITERAL && expr->as.literal.type == LITERAL_INT) {
+        *out = make_range(expr->as.literal.value.int_value, expr->as.literal.value.int_value);
+        return 1;
+    }
+    if (expr->type == EXPR_VARIABLE) {
+        int slot = scope_lookup(f, expr->as.variable.name);
+        if (slot < 0) return 0;
+        *out = env->ranges[slot];
+        return 1;
+    }
+    return 0;
+}
+
+/* Narrow env to the states where `cond` evaluated to `truth`. Only
+ * comparisons between variables and literals/variables refine anything. */
+static void refine(RangeFacts* f, Env* env, const ASTExpression* cond, int truth) {
+    if (!env->live) return;
+
+    if (cond->type == EXPR_LITERAL && cond->as.literal.type == LITERAL_BOOL) {
+        if (cond->as.literal.value.bool_value != truth) env->live = 0;
+        return;
+    }
+    if (cond->type == EXPR_UNARY_OP && cond->as.unary_op.op == UNOP_NOT) {
+        refine(f, env, cond->as.unary_op.operand, !truth);
+        return;
+    }
+    if (cond->type == EXPR_VARIABLE && cond->resolved_type == TYPE_BOOL) {
+        int slot = scope_lookup(f, cond->as.variable.name);
+        if (slot >= 0) restrict_slot(env, slot, truth, truth);
+        return;
+    }
+    if (cond->type != EXPR_BINARY_OP) return;
+
+    const ASTBinaryOp* bin = &cond->as.binary_op;
+    if (bin->op == BINOP_AND || bin->op == BINOP_OR) {
+        /* Both sides known: `a && b` true, `a || b` false */
+        if ((bin->op == BINOP_AND) == truth) {
+            refine(f, env, bin->left, truth);
+            refine(f, env, bin->right, truth);
+            return;
+        }
+        /* Either side decided it */
+        Env other = env_copy(f, env);
+        refine(f, env, bin->left, truth);
+        refine(f, &other, bin->left, !truth);
+        refine(f, &other, bin->right, truth);
+        env_join(f, env, &other);
+        env_free(&other);
+        return;
+    }
+    if (bin->op < BINOP_EQ || bin->op > BINOP_GE) return;
+
+    BinaryOpType op = truth ? bin->op : negate_comparison(bin->op);
+    Range left, right;
+    if (!operand_range(f, env, bin->left, &left) || !operand_range(f, env, bin->right, &right)) {
+        return;
+    }
+    if (bin->left->type == EXPR_VARIABLE) {
+        refine_variable(env, scope_lookup(f, bin->left->as.variable.name), op, right);
+    }
+    if (env->live && bin->right->type == EXPR_VARIABLE) {
+        refine_variable(env, scope_lookup(f, bin->right->as.variable.name),
+                        mirror_comparison(op), left);
+    }
+}
+
+/* ========================================================================
+ * Statements
+ * ======================================================================== */
+
+static void analyze_block(RangeFacts* f, Env* env, const ASTBlock* block);
+static void analyze_statement(RangeFacts* f, Env* env, const ASTStatement* stmt);
+
+/* Helper: One trip around a loop from `head`: condition, body, update.
+ * Leaves the state after the update in `env` and the state where the
+ * condition failed or a `break` left in `exit` (if non-NULL). */
+static void loop_round(RangeFacts* f, const Env* head, Env* env, Env* exit,
+                       const ASTExpression* condition, const ASTBlock* body,
+                       const ASTExpression* update) {
+    env_assign(f, env, head);
+    if (condition) eval(f, env, condition);
+    if (exit) {
+        env_assign(f, exit, env);
+        if (condition) {
+            refine(f, exit, condition, 0);
+        } else {
+            exit->live = 0;
+        }
+    }
+    if (condition) refine(f, env, condition, 1);
+
+    Env* saved_break = f->break_env;
+    Env* saved_continue = f->continue_env;
+    Env breaks = env_copy(f, env);
+    Env continues = env_copy(f, env);
+    breaks.live = 0;
+    continues.live = 0;
+    f->break_env = &breaks;
+    f->continue_env = &continues;
+
+    int saved_scope = f->scope_count;
+    analyze_block(f, env, body);
+    f->scope_count = saved_scope;
+
+    f->break_env = saved_break;
+    f->continue_env = saved_continue;
+    env_join(f, env, &continues);
+    if (update && env->live) eval(f, env, update);
+    if (exit) env_join(f, exit, &breaks);
+    env_free(&breaks);
+    env_free(&continues);
+}
+
+static void analyze_loop(RangeFacts* f, Env* env, const ASTExpression* condition,
+                         const ASTBlock* body, const ASTExpression* update) {
+    int recording = f->recording;
+    f->recording = 0;
+
+    Env head = env_copy(f, env);
+    Env round = env_copy(f, env);
+    Env next = env_copy(f, env);
+
+    /* Each round only adds to the head state, so bounds can move outward
+     * only, and widening stops them after a few rounds */
+    for (int iteration = 0; ; iteration++) {
+        loop_round(f, &head, &round, NULL, condition, body, update);
+        env_assign(f, &next, &head);
+        env_join(f, &next, &round);
+        if (env_equal(f, &next, &head)) break;
+        if (iteration >= WIDEN_AFTER) env_widen(f, &next, &head);
+        env_assign(f, &head, &next);
+    }
+    for (int i = 0; i < NARROW_ROUNDS; i++) {
+        loop_round(f, &head, &round, NULL, condition, body, update);
+        env_assign(f, &next, env);
+        env_join(f, &next, &round);
+        if (env_equal(f, &next, &head)) break;
+        env_assign(f, &head, &next);
+    }
+
+    /* Record with the stable entry state; leave with the exit state */
+    f->recording = recording;
+    loop_round(f, &head, &round, env, condition, body, update);
+
+    env_free(&head);
+    env_free(&round);
+    env_free(&next);
+}
+
+static void analyze_if(RangeFacts* f, Env* env, const ASTExpression* condition,
+                       const ASTBlock* then_body, const ASTElseIfClause* elif,
+                       const ASTBlock* else_body) {
+    eval(f, env, condition);
+    Env then_env = env_copy(f, env);
+    refine(f, &then_env, condition, 1);
+    refine(f, env, condition, 0);
+
+    int saved_scope = f->scope_count;
+    analyze_block(f, &then_env, then_body);
+    f->scope_count = saved_scope;
+
+    if (elif) {
+        analyze_if(f, env, elif->condition, &elif->body, elif->next, else_body);
+    } else if (else_body) {
+        analyze_block(f, env, else_body);
+        f->scope_count = saved_scope;
+    }
+    env_join(f, env, &then_env);
+    env_free(&then_env);
+}
+
+static void analyze_statement(RangeFacts* f, Env* env, const ASTStatement* stmt) {
+    if (!env->live) return;
+
+    switch (stmt->type) {
+        case STMT_VAR_DECL: {
+            const ASTVarDecl* decl = &stmt->as.var_decl_stmt.var_decl;
+            int slot = ptr_map_get(&f->slots, decl);
+            Range value = type_range(decl->type.type);
+            if (decl->initializer) {
+                value = clamp_to(eval(f, env, decl->initializer), value);
+            }
+            if (slot >= 0) {
+                env->ranges[slot] = value;
+                scope_bind(f, decl->name, slot);
+            }
+            break;
+        }
+        case STMT_EXPR:
+            eval(f, env, stmt->as.expr_stmt.expr);
+            break;
+        case STMT_RETURN:
+            eval(f, env, stmt->as.return_stmt.value);
+            env->live = 0;
+            break;
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                eval(f, env, &stmt->as.dbg_stmt.arguments[i]);
+            }
+            break;
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            analyze_if(f, env, if_stmt->condition, &if_stmt->then_body,
+                       if_stmt->else_if_chain, if_stmt->else_body);
+            break;
+        }
+        case STMT_WHILE:
+            analyze_loop(f, env, stmt->as.while_stmt.condition, &stmt->as.while_stmt.body, NULL);
+            break;
+        case STMT_FOR: {
+            const ASTForStmt* for_stmt = &stmt->as.for_stmt;
+            int saved_scope = f->scope_count;
+            if (for_stmt->init) analyze_statement(f, env, for_stmt->init);
+            if (env->live) {
+                analyze_loop(f, env, for_stmt->condition, &for_stmt->body, for_stmt->update);
+            }
+            f->scope_count = saved_scope;
+            break;
+        }
+        case STMT_BLOCK: {
+            int saved_scope = f->scope_count;
+            analyze_block(f, env, &stmt->as.block_stmt.block);
+            f->scope_count = saved_scope;
+            break;
+        }
+        case STMT_BREAK:
+            env_join(f, f->break_env, env);
+            env->live = 0;
+            break;
+        case STMT_CONTINUE:
+            env_join(f, f->continue_env, env);
+            env->live = 0;
+            break;
+    }
+}
+
+static void analyze_block(RangeFacts* f, Env* env, const ASTBlock* block) {
+    for (int i = 0; i < block->statement_count && env->live; i++) {
+        analyze_statement(f, env, &block->statements[i]);
+    }
+}
+
+/* ========================================================================
+ * Public API
+ * ======================================================================== */
+
+RangeFacts* range_analyze_function(const ASTFunctionDef* func) {
+    RangeFacts* f = xmalloc(sizeof(RangeFacts));
+    memset(f, 0, sizeof(RangeFacts));
+    f->recording = 1;
+
+    for (int i = 0; i < func->parameter_count; i++) {
+        scope_bind(f, func->parameters[i].name, add_slot(f, func->parameters[i].type.type));
+    }
+    assign_slots_block(f, &func->body);
+
+    Env env = env_create(f);
+    analyze_block(f, &env, &func->body);
+    env_free(&env);
+    return f;
+}
+
+void range_facts_free(RangeFacts* facts) {
+    if (!facts) return;
+    ptr_map_free(&facts->slots);
+    ptr_map_free(&facts->recorded);
+    xfree(facts->slot_types);
+    xfree(facts->scope);
+    xfree(facts->seen);
+    xfree(facts);
+}
+
+int range_fits_type(const RangeFacts* facts, const ASTExpression* expr, CasmType type) {
+    if (!facts) return 0;
+    int index = ptr_map_get(&facts->recorded, expr);
+    if (index < 0) return 0;
+    Range r = facts->seen[index];
+    return !is_full(r) && range_within(r, type_range(type));
+}
+
+int range_bounds(const RangeFacts* facts, const ASTExpression* expr, long long* min, long long* max) {
+    if (!facts) return 0;
+    int index = ptr_map_get(&facts->recorded, expr);
+    if (index < 0 || is_full(facts->seen[index])) return 0;
+    *min = facts->seen[index].min;
+    *max = facts->seen[index].max;
+    return 1;
+}
+
+/* Helper: Replace decided comparisons in an expression tree */
+static int fold_expression(const RangeFacts* facts, ASTExpression* expr) {
+    if (!expr) return 0;
+
+    switch (expr->type) {
+        case EXPR_BINARY_OP: {
+            ASTBinaryOp* bin = &expr->as.binary_op;
+            if (bin->op >= BINOP_EQ && bin->op <= BINOP_GE && !optimize_has_side_effects(expr)) {
+                int index = ptr_map_get(&facts->recorded, expr);
+                if (index >= 0 && facts->seen[index].min == facts->seen[index].max) {
+                    int value = (int)facts->seen[index].min;
+                    ast_expression_free_contents(expr);
+                    expr->type = EXPR_LITERAL;
+                    expr->as.literal.type = LITERAL_BOOL;
+                    expr->as.literal.value.bool_value = value;
+                    return 1;
+                }
+            }
+            return fold_expression(facts, bin->left) + fold_expression(facts, bin->right);
+        }
+        case EXPR_UNARY_OP:
+            return fold_expression(facts, expr->as.unary_op.operand);
+        case EXPR_FUNCTION_CALL: {
+            int folded = 0;
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                folded += fold_expression(facts, &expr->as.function_call.arguments[i]);
+            }
+            return folded;
+        }
+        case EXPR_INDEX:
+            return fold_expression(facts, expr->as.index.index);
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Clear the checks on accesses whose index was proven in bounds */
+static int remove_checks_expression(const RangeFacts* facts, ASTExpression* expr) {
+    if (!expr) return 0;
+
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            return remove_checks_expression(facts, expr->as.binary_op.left) +
+                   remove_checks_expression(facts, expr->as.binary_op.right);
+        case EXPR_UNARY_OP:
+            return remove_checks_expression(facts, expr->as.unary_op.operand);
+        case EXPR_FUNCTION_CALL: {
+            int removed = 0;
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                removed += remove_checks_expression(facts, &expr->as.function_call.arguments[i]);
+            }
+            return removed;
+        }
+        case EXPR_INDEX: {
+            ASTIndexExpr* index = &expr->as.index;
+            int removed = remove_checks_expression(facts, index->index);
+            long long min, max;
+            if (index->bounds_checked && range_bounds(facts, index->index, &min, &max) &&
+                min >= 0 && max < index->array_length) {
+                index->bounds_checked = 0;
+                removed++;
+            }
+            return removed;
+        }
+        default:
+            return 0;
+    }
+}
+
+typedef int (*ExpressionRewrite)(const RangeFacts* facts, ASTExpression* expr);
+
+static int rewrite_block(const RangeFacts* facts, ASTBlock* block, ExpressionRewrite rewrite);
+
+/* Helper: Apply `rewrite` to every expression in a statement */
+static int rewrite_statement(const RangeFacts* facts, ASTStatement* stmt, ExpressionRewrite rewrite) {
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            return rewrite(facts, stmt->as.var_decl_stmt.var_decl.initializer);
+        case STMT_EXPR:
+            return rewrite(facts, stmt->as.expr_stmt.expr);
+        case STMT_RETURN:
+            return rewrite(facts, stmt->as.return_stmt.value);
+        case STMT_DBG: {
+            int count = 0;
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                count += rewrite(facts, &stmt->as.dbg_stmt.arguments[i]);
+            }
+            return count;
+        }
+        case STMT_IF: {
+            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            int count = rewrite(facts, if_stmt->condition) +
+                        rewrite_block(facts, &if_stmt->then_body, rewrite);
+            for (ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                count += rewrite(facts, clause->condition) + rewrite_block(facts, &clause->body, rewrite);
+            }
+            if (if_stmt->else_body) count += rewrite_block(facts, if_stmt->else_body, rewrite);
+            return count;
+        }
+        case STMT_WHILE:
+            return rewrite(facts, stmt->as.while_stmt.condition) +
+                   rewrite_block(facts, &stmt->as.while_stmt.body, rewrite);
+        case STMT_FOR: {
+            ASTForStmt* for_stmt = &stmt->as.for_stmt;
+            int count = rewrite(facts, for_stmt->condition) +
+                        rewrite(facts, for_stmt->update) +
+                        rewrite_block(facts, &for_stmt->body, rewrite);
+            if (for_stmt->init) count += rewrite_statement(facts, for_stmt->init, rewrite);
+            return count;
+        }
+        case STMT_BLOCK:
+            return rewrite_block(facts, &stmt->as.block_stmt.block, rewrite);
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            return 0;
+    }
+    return 0;
+}
+
+static int rewrite_block(const RangeFacts* facts, ASTBlock* block, ExpressionRewrite rewrite) {
+    int count = 0;
+    for (int i = 0; i < block->statement_count; i++) {
+        count += rewrite_statement(facts, &block->statements[i], rewrite);
+    }
+    return count;
+}
+
+/* Helper: Analyze every function and apply `rewrite` with its facts */
+static int rewrite_program(ASTProgram* program, ExpressionRewrite rewrite) {
+    if (!program) return 0;
+
+    int count = 0;
+    for (int i = 0; i < program->function_count; i++) {
+        RangeFacts* facts = range_analyze_function(&program->functions[i]);
+        count += rewrite_block(facts, &program->functions[i].body, rewrite);
+        range_facts_free(facts);
+    }
+    return count;
+}
+
+int fold_conditions_by_range(ASTProgram* program) {
+    return rewrite_program(program, fold_expression);
+}
+
+int remove_bounds_checks_by_range(ASTProgram* program) {
+    return rewrite_program(program, remove_checks_expression);
+}
@@ -0,0 +1,34 @@
+#ifndef RANGES_H
+#define RANGES_H
+
+#include "ast.h"
+
+/* Interval analysis over one function body. Every integer and bool
+ * expression gets a [min, max] range of the values it can produce, seeded
+ * from literals, the declared types (get_type_size_bits) and the
+ * conditions guarding if bodies and loops. Values are tracked as the C
+ * backend computes them: sub-32-bit operands are promoted, so `i8 + i8`
+ * may exceed 127 until it is stored. */
+typedef struct RangeFacts RangeFacts;
+
+RangeFacts* range_analyze_function(const ASTFunctionDef* func);
+void range_facts_free(RangeFacts* facts);
+
+/* Check if every value `expr` can produce was proven to fit `type`, so
+ * converting it to that type needs no wrap. Unreachable or unanalyzed
+ * expressions are never proven. */
+int range_fits_type(const RangeFacts* facts, const ASTExpression* expr, CasmType type);
+
+/* Get the bounds proven for `expr`. Returns 0 (leaving min/max alone)
+ * when nothing useful is known. */
+int range_bounds(const RangeFacts* facts, const ASTExpression* expr, long long* min, long long* max);
+
+/* Replace side-effect-free comparisons whose outcome the analysis proves
+ * with true/false. Returns the number of comparisons replaced. */
+int fold_conditions_by_range(ASTProgram* program);
+
+/* Drop the bounds checks of array accesses whose index the analysis
+ * proves is within the array. Returns the number of checks removed. */
+int remove_bounds_checks_by_range(ASTProgram* program);
+
+#endif /* RANGES_H */
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <limits.h>
 #include "semantics.h"
+#include "layout.h"
 
 /* Semantic error list operations */
 SemanticErrorList* semantic_error_list_create(void) {
@@ -49,13 +50,16 @@ static CasmType analyze_expression(ASTExpression* expr, SymbolTable* table, Sema
 static void analyze_statement(ASTStatement* stmt, SymbolTable* table, CasmType return_type, SemanticErrorList* errors);
 static void analyze_block(ASTBlock* block, SymbolTable* table, CasmType return_type, SemanticErrorList* errors);
 
-static int literal_fits_type(ASTExpression* expr, CasmType target) {
-    if (!expr || expr->type != EXPR_LITERAL || expr->as.literal.type != LITERAL_INT) {
-        return 0;
-    }
+/* Program and module whose function bodies are being analyzed (for
+ * resolving module-level arrays and struct types) */
+static ASTProgram* g_program = NULL;
+static const char* g_module_path = NULL;
 
-    long long value = expr->as.literal.value.int_value;
+/* Number of loops around the statement being analyzed (for break/continue) */
+static int g_loop_depth = 0;
 
+/* Helper: Check whether a constant is representable in a type */
+static int value_fits_type(long long value, CasmType target) {
     switch (target) {
         case TYPE_I8:
             return value >= INT8_MIN && value <= INT8_MAX;
@@ -72,12 +76,308 @@ static int literal_fits_type(ASTExpression* expr, CasmType target) {
         case TYPE_U32:
             return value >= 0 && value <= UINT32_MAX;
         case TYPE_U64:
-            return value >= 0 && value <= (long long)UINT64_MAX;
+            return value >= 0;  /* Literals are at most INT64_MAX */
         default:
             return 0;
     }
 }
 
+static int literal_fits_type(ASTExpression* expr, CasmType target) {
+    if (!expr || expr->type != EXPR_LITERAL || expr->as.literal.type != LITERAL_INT) {
+        return 0;
+    }
+    return value_fits_type(expr->as.literal.value.int_value, target);
+}
+
+/* Helper: Type an `as` cast. Integers convert freely between widths and
+ * signedness and bool widens to 0/1; turning an integer into a bool must
+ * be spelled as a comparison. An integer literal operand takes the target
+ * type when it fits and i64 otherwise, so the cast sees its exact value. */
+static CasmType analyze_cast(ASTExpression* expr, CasmType operand_type, SemanticErrorList* errors) {
+    ASTExpression* operand = expr->as.unary_op.operand;
+    CasmType target = expr->as.unary_op.target_type;
+    
+    if (operand_type == TYPE_VOID) {
+        /* Already reported */
+    } else if (!is_numeric_type(operand_type) && operand_type != TYPE_BOOL) {
+        semantic_error_list_add(errors, "Cast requires an integer or bool operand", expr->location);
+    } else if (target == TYPE_BOOL && operand_type != TYPE_BOOL) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Cannot cast %s to bool; compare with 0 instead",
+                 type_to_string(operand_type));
+        semantic_error_list_add(errors, msg, expr->location);
+    }
+    
+    if (operand->type == EXPR_LITERAL && operand->as.literal.type == LITERAL_INT) {
+        operand->resolved_type = literal_fits_type(operand, target) ? target : TYPE_I64;
+    }
+    expr->resolved_type = target;
+    return target;
+}
+
+/* Helper: Whether two module paths name the same module (NULL = main file) */
+static int same_module(const char* a, const char* b) {
+    if (!a || !b) return a == b;
+    return strcmp(a, b) == 0;
+}
+
+/* Helper: Find a module-level variable visible from the current module */
+static int find_global(const char* name) {
+    if (!g_program) return -1;
+    for (int i = 0; i < g_program->global_count; i++) {
+        ASTGlobalVar* global = &g_program->globals[i];
+        if (strcmp(global->decl.name, name) == 0 && same_module(global->module_path, g_module_path)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Helper: Find a struct type visible from the current module */
+static int find_struct(const char* name) {
+    if (!g_program) return -1;
+    for (int i = 0; i < g_program->struct_count; i++) {
+        ASTStructDef* def = &g_program->structs[i];
+        if (strcmp(def->name, name) == 0 && same_module(def->module_path, g_module_path)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Helper: Resolve a struct type name, reporting unknown names. Returns -1 if unknown. */
+static int resolve_struct(const char* name, SourceLocation location, SemanticErrorList* errors) {
+    int index = find_struct(name);
+    if (index < 0) {
+        char msg[256];
+        snprintf(msg, sizeof(msg), "Unknown type '%s'", name);
+        semantic_error_list_add(errors, msg, location);
+    }
+    return index;
+}
+
+/* Helper: Validate a struct variable declaration and its initializer list */
+static void check_struct_decl(ASTVarDecl* decl, SemanticErrorList* errors) {
+    char msg[256];
+    if (decl->array_length > 0) {
+        semantic_error_list_add(errors, "Arrays of structs are not supported", decl->location);
+        return;
+    }
+    if (decl->initializer) {
+        snprintf(msg, sizeof(msg), "Struct '%s' must be initialized with a list of constants", decl->name);
+        semantic_error_list_add(errors, msg, decl->location);
+        return;
+    }
+    if (decl->struct_index < 0) return;
+    
+    ASTStructDef* def = &g_program->structs[decl->struct_index];
+    if (decl->element_count > def->field_count) {
+        snprintf(msg, sizeof(msg), "Too many initializers for struct '%s'", decl->name);
+        semantic_error_list_add(errors, msg, decl->location);
+        return;
+    }
+    for (int i = 0; i < decl->element_count; i++) {
+        if (!value_fits_type(decl->elements[i], def->fields[i].type.type)) {
+            snprintf(msg, sizeof(msg), "Initializer for field '%s' does not fit in %s", def->fields[i].name,
+                     type_to_string(def->fields[i].type.type));
+            semantic_error_list_add(errors, msg, decl->location);
+            return;
+        }
+    }
+}
+
+/* Helper: Resolve and type-check a struct field access */
+static CasmType analyze_field(ASTExpression* expr, SymbolTable* table, SemanticErrorList* errors) {
+    ASTFieldExpr* field = &expr->as.field;
+    char msg[256];
+    expr->resolved_type = TYPE_VOID;
+    
+    VariableSymbol* var = symbol_table_lookup_variable(table, field->object_name);
+    if (!var) {
+        snprintf(msg, sizeof(msg), "Undefined variable '%s'", field->object_name);
+        semantic_error_list_add(errors, msg, expr->location);
+        return TYPE_VOID;
+    }
+    if (var->struct_index < 0) {
+        snprintf(msg, sizeof(msg), "'%s' is not a struct", field->object_name);
+        semantic_error_list_add(errors, msg, expr->location);
+        return TYPE_VOID;
+    }
+    
+    ASTStructDef* def = &g_program->structs[var->struct_index];
+    field->struct_index = var->struct_index;
+    field->by_reference = var->by_reference;
+    field->field_index = -1;
+    for (int i = 0; i < def->field_count; i++) {
+        if (strcmp(def->fields[i].name, field->field_name) == 0) {
+            field->field_index = i;
+            break;
+        }
+    }
+    if (field->field_index < 0) {
+        snprintf(msg, sizeof(msg), "Struct '%s' has no field '%s'", def->name, field->field_name);
+        semantic_error_list_add(errors, msg, expr->location);
+        return TYPE_VOID;
+    }
+    
+    expr->resolved_type = def->fields[field->field_index].type.type;
+    return expr->resolved_type;
+}
+
+/* Helper: Report a use of a struct variable where a value is expected. Returns 1 if reported. */
+static int check_not_struct(const char* name, VariableSymbol* var, SourceLocation location,
+                            SemanticErrorList* errors) {
+    if (!var || var->struct_index < 0) {
+        return 0;
+    }
+    char msg[256];
+    snprintf(msg, sizeof(msg), "Struct '%s' cannot be used as a value", name);
+    semantic_error_list_add(errors, msg, location);
+    return 1;
+}
+
+/* Helper: Check a struct argument: the name of a struct variable of the
+ * parameter's type. Struct arguments are passed by reference. */
+static void analyze_struct_argument(ASTExpression* arg, int struct_index, int position,
+                                    SymbolTable* table, SemanticErrorList* errors) {
+    char msg[256];
+    VariableSymbol* var = NULL;
+    if (arg->type == EXPR_VARIABLE) {
+        var = symbol_table_lookup_variable(table, arg->as.variable.name);
+    }
+    if (!var || var->struct_index != struct_index) {
+        if (!var || var->struct_index < 0) {
+            analyze_expression(arg, table, errors);
+        }
+        snprintf(msg, sizeof(msg), "Argument %d must be a struct %s variable", position,
+                 g_program->structs[struct_index].name);
+        semantic_error_list_add(errors, msg, arg->location);
+        return;
+    }
+    arg->as.variable.struct_index = var->struct_index;
+    arg->as.variable.by_reference = var->by_reference;
+    arg->resolved_type = TYPE_STRUCT;
+}
+
+/* Helper: Validate an array declaration's element type, length and initializer */
+static void check_array_decl(ASTVarDecl* decl, int max_length, SemanticErrorList* errors) {
+    char msg[256];
+    if (!is_numeric_type(decl->type.type)) {
+        semantic_error_list_add(errors, "Array elements must have an integer type", decl->location);
+    }
+    if (decl->array_length > max_length) {
+        snprintf(msg, sizeof(msg), "Array '%s' is too large (at most %d elements)", decl->name, max_length);
+        semantic_error_list_add(errors, msg, decl->location);
+        return;
+    }
+    if (decl->element_count > decl->array_length) {
+        snprintf(msg, sizeof(msg), "Too many initializers for array '%s'", decl->name);
+        semantic_error_list_add(errors, msg, decl->location);
+        return;
+    }
+    for (int i = 0; i < decl->element_count; i++) {
+        if (!value_fits_type(decl->elements[i], decl->type.type)) {
+            snprintf(msg, sizeof(msg), "Array initializer %d does not fit in %s", i + 1,
+                     type_to_string(decl->type.type));
+            semantic_error_list_add(errors, msg, decl->location);
+            return;
+        }
+    }
+}
+
+/* Helper: Turn a use of the scalar global `global_index` (a variable
+ * expression) into an access to element 0 of a one-element array, so the
+ * optimizer and backends treat it like any other module-level memory */
+static CasmType resolve_scalar_global(ASTExpression* expr, int global_index) {
+    char* name = expr->as.variable.name;
+    SourceLocation location = expr->as.variable.location;
+    ASTExpression* zero = ast_expression_create(EXPR_LITERAL, location);
+    zero->as.literal.type = LITERAL_INT;
+    zero->as.literal.value.int_value = 0;
+    zero->as.literal.location = location;
+    zero->resolved_type = TYPE_I32;
+    
+    expr->type = EXPR_INDEX;
+    memset(&expr->as.index, 0, sizeof(ASTIndexExpr));
+    expr->as.index.array_name = name;
+    expr->as.index.index = zero;
+    expr->as.index.global_index = global_index;
+    expr->as.index.array_length = 1;
+    expr->as.index.scalar = 1;
+    expr->as.index.location = location;
+    expr->resolved_type = g_program->globals[global_index].decl.type.type;
+    return expr->resolved_type;
+}
+
+/* Helper: Resolve and type-check an array element access */
+static CasmType analyze_index(ASTExpression* expr, SymbolTable* table, SemanticErrorList* errors) {
+    ASTIndexExpr* index = &expr->as.index;
+    char msg[256];
+    int length = 0;
+    CasmType element_type = TYPE_VOID;
+    
+    if (index->scalar) {
+        /* Already resolved to a scalar global */
+        expr->resolved_type = g_program->globals[index->global_index].decl.type.type;
+        return expr->resolved_type;
+    }
+    
+    VariableSymbol* var = symbol_table_lookup_variable(table, index->array_name);
+    if (var) {
+        if (var->array_length == 0) {
+            snprintf(msg, sizeof(msg), "'%s' is not an array", index->array_name);
+            semantic_error_list_add(errors, msg, expr->location);
+        } else {
+            element_type = var->type;
+            length = var->array_length;
+        }
+        index->global_index = -1;
+    } else {
+        index->global_index = find_global(index->array_name);
+        if (index->global_index < 0) {
+            snprintf(msg, sizeof(msg), "Undefined array '%s'", index->array_name);
+            semantic_error_list_add(errors, msg, expr->location);
+        } else if (g_program->globals[index->global_index].decl.array_length == 0) {
+            snprintf(msg, sizeof(msg), "'%s' is not an array", index->array_name);
+            semantic_error_list_add(errors, msg, expr->location);
+        } else {
+            ASTVarDecl* decl = &g_program->globals[index->global_index].decl;
+            element_type = decl->type.type;
+            length = decl->array_length;
+        }
+    }
+    
+    CasmType index_type = analyze_expression(index->index, table, errors);
+    if (!is_numeric_type(index_type)) {
+        semantic_error_list_add(errors, "Array index must be an integer", index->index->location);
+    } else if (index->index->type == EXPR_LITERAL && length > 0 &&
+               (index->index->as.literal.value.int_value < 0 ||
+                index->index->as.literal.value.int_value >= length)) {
+        snprintf(msg, sizeof(msg), "Array index %ld is out of bounds for '%s' (length %d)",
+                 index->index->as.literal.value.int_value, index->array_name, length);
+        semantic_error_list_add(errors, msg, index->index->location);
+    }
+    
+    index->array_length = length;
+    expr->resolved_type = element_type;
+    return element_type;
+}
+
+/* Helper: Report a use of an array name where a value is expected. Returns 1 if reported. */
+static int check_not_array(const char* name, VariableSymbol* var, SourceLocation location,
+                           SemanticErrorList* errors) {
+    int global_index = var ? -1 : find_global(name);
+    int is_array = var ? var->array_length > 0
+                       : global_index >= 0 && g_program->globals[global_index].decl.array_length > 0;
+    if (!is_array) {
+        return 0;
+    }
+    char msg[256];
+    snprintf(msg, sizeof(msg), "Array '%s' cannot be used as a value", name);
+    semantic_error_list_add(errors, msg, location);
+    return 1;
+}
+
 /* Analyze an expression and return its type */
 static CasmType analyze_expression(ASTExpression* expr, SymbolTable* table, SemanticErrorList* errors) {
     if (!expr) {
@@ -96,6 +396,14 @@ static CasmType analyze_expression(ASTExpression* expr, SymbolTable* table, Sema
         
         case EXPR_VARIABLE: {
             VariableSymbol* var = symbol_table_lookup_variable(table, expr->as.variable.name);
+            if (check_not_array(expr->as.variable.name, var, expr->location, errors) ||
+                check_not_struct(expr->as.variable.name, var, expr->location, errors)) {
+                expr->resolved_type = TYPE_VOID;
+                return TYPE_VOID;
+            }
+            if (!var && find_global(expr->as.variable.name) >= 0) {
+                return resolve_scalar_global(expr, find_global(expr->as.variable.name));
+            }
             if (!var) {
                 char msg[256];
                 snprintf(msg, sizeof(msg), "Undefined variable '%s'", expr->as.variable.name);
@@ -124,9 +432,28 @@ static CasmType analyze_expression(ASTExpression* expr, SymbolTable* table, Sema
             /* For assignment, don't check initialization on left side */
             if (op == BINOP_ASSIGN) {
                 /* Get type of left side without checking initialization */
-                if (expr->as.binary_op.left->type == EXPR_VARIABLE) {
+                if (expr->as.binary_op.left->type == EXPR_INDEX) {
+                    left_type = analyze_index(expr->as.binary_op.left, table, errors);
+                } else if (expr->as.binary_op.left->type == EXPR_FIELD) {
+                    ASTExpression* target = expr->as.binary_op.left;
+                    left_type = analyze_field(target, table, errors);
+                    if (left_type != TYPE_VOID && target->as.field.by_reference) {
+                        char msg[256];
+                        snprintf(msg, sizeof(msg), "Cannot assign to a field of struct parameter '%s'",
+                                 target->as.field.object_name);
+                        semantic_error_list_add(errors, msg, target->location);
+                    }
+                } else if (expr->as.binary_op.left->type == EXPR_VARIABLE) {
                     VariableSymbol* var = symbol_table_lookup_variable(table, expr->as.binary_op.left->as.variable.name);
-                    if (!var) {
+                    if (check_not_array(expr->as.binary_op.left->as.variable.name, var,
+                                        expr->as.binary_op.left->location, errors) ||
+                        check_not_struct(expr->as.binary_op.left->as.variable.name, var,
+                                         expr->as.binary_op.left->location, errors)) {
+                        left_type = TYPE_VOID;
+                    } else if (!var && find_global(expr->as.binary_op.left->as.variable.name) >= 0) {
+                        ASTExpression* target = expr->as.binary_op.left;
+                        left_type = resolve_scalar_global(target, find_global(target->as.variable.name));
+                    } else if (!var) {
                         char msg[256];
                         snprintf(msg, sizeof(msg), "Undefined variable '%s'", expr->as.binary_op.left->as.variable.name);
                         semantic_error_list_add(errors, msg, expr->as.binary_op.left->location);
@@ -163,7 +490,14 @@ static CasmType analyze_expression(ASTExpression* expr, SymbolTable* table, Sema
             right_type = analyze_expression(expr->as.binary_op.right, table, errors);
             
             /* Check type compatibility */
-            if (op >= BINOP_ADD && op <= BINOP_MOD) {
+            if (op >= BINOP_SHL && op <= BINOP_ROTR) {
+                /* Shifts and rotates - the count may have any integer type */
+                if (!is_numeric_type(left_type) || !is_numeric_type(right_type)) {
+                    semantic_error_list_add(errors, "Shift operators require integer operands", expr->location);
+                    expr->resolved_type = TYPE_VOID;
+                    return TYPE_VOID;
+                }
+            } else if (op >= BINOP_ADD && op <= BINOP_BIT_XOR) {
                 /* Arithmetic operators - both must be numeric and compatible */
                 if (!is_numeric_type(left_type) || !is_numeric_type(right_type)) {
                     semantic_error_list_add(errors, "Arithmetic operators require numeric operands", expr->location);
@@ -206,6 +540,9 @@ static CasmType analyze_expression(ASTExpression* expr, SymbolTable* table, Sema
             
             UnaryOpType op = expr->as.unary_op.op;
             
+            if (op == UNOP_CAST) {
+                return analyze_cast(expr, operand_type, errors);
+            }
             if (op == UNOP_NEG) {
                 if (!is_numeric_type(operand_type)) {
                     semantic_error_list_add(errors, "Unary negation requires numeric operand", expr->location);
@@ -214,12 +551,20 @@ static CasmType analyze_expression(ASTExpression* expr, SymbolTable* table, Sema
                 if (operand_type != TYPE_BOOL) {
                     semantic_error_list_add(errors, "Logical NOT requires boolean operand", expr->location);
                 }
+            } else if (!is_numeric_type(operand_type)) {
+                semantic_error_list_add(errors, "Bit operations require an integer operand", expr->location);
             }
             
             expr->resolved_type = get_unary_op_result_type(op, operand_type);
             return expr->resolved_type;
         }
         
+        case EXPR_INDEX:
+            return analyze_index(expr, table, errors);
+        
+        case EXPR_FIELD:
+            return analyze_field(expr, table, errors);
+        
         case EXPR_FUNCTION_CALL: {
             FunctionSymbol* func = symbol_table_lookup_function(table, expr->as.function_call.function_name);
             
@@ -242,6 +587,11 @@ static CasmType analyze_expression(ASTExpression* expr, SymbolTable* table, Sema
             
             /* Check argument types */
             for (int i = 0; i < expr->as.function_call.argument_count && i < func->param_count; i++) {
+                if (func->param_structs && func->param_structs[i] >= 0) {
+                    analyze_struct_argument(&expr->as.function_call.arguments[i], func->param_structs[i],
+                                            i + 1, table, errors);
+                    continue;
+                }
                 CasmType arg_type = analyze_expression(&expr->as.function_call.arguments[i], table, errors);
                 if (!types_compatible(arg_type, func->param_types[i]) &&
                     !literal_fits_type(&expr->as.function_call.arguments[i], func->param_types[i])) {
@@ -291,6 +641,25 @@ static void analyze_statement(ASTStatement* stmt, SymbolTable* table, CasmType r
                 semantic_error_list_add(errors, msg, var_decl->location);
             }
             
+            /* Structs start out zeroed (or from their initializer list) */
+            if (var_decl->type.type == TYPE_STRUCT) {
+                var_decl->struct_index = resolve_struct(var_decl->struct_name, var_decl->location, errors);
+                VariableSymbol* var = symbol_table_lookup_variable(table, var_decl->name);
+                var->struct_index = var_decl->struct_index;
+                var->initialized = 1;
+                check_struct_decl(var_decl, errors);
+                break;
+            }
+            
+            /* Arrays start out zeroed (or from their initializer list) */
+            if (var_decl->array_length > 0) {
+                VariableSymbol* var = symbol_table_lookup_variable(table, var_decl->name);
+                var->array_length = var_decl->array_length;
+                var->initialized = 1;
+                check_array_decl(var_decl, MAX_LOCAL_ARRAY_LENGTH, errors);
+                break;
+            }
+            
             /* Analyze initializer if present */
             if (var_decl->initializer) {
                 CasmType init_type = analyze_expression(var_decl->initializer, table, errors);
@@ -347,7 +716,9 @@ static void analyze_statement(ASTStatement* stmt, SymbolTable* table, CasmType r
             }
             
             /* Analyze body block */
+            g_loop_depth++;
             analyze_block(&while_stmt->body, table, return_type, errors);
+            g_loop_depth--;
             break;
         }
         
@@ -376,7 +747,9 @@ static void analyze_statement(ASTStatement* stmt, SymbolTable* table, CasmType r
             }
             
             /* Analyze body block */
+            g_loop_depth++;
             analyze_block(&for_stmt->body, table, return_type, errors);
+            g_loop_depth--;
             
             /* Pop scope */
             symbol_table_pop_scope(table);
@@ -404,6 +777,18 @@ static void analyze_statement(ASTStatement* stmt, SymbolTable* table, CasmType r
             }
             break;
         }
+        
+        case STMT_BREAK:
+            if (g_loop_depth == 0) {
+                semantic_error_list_add(errors, "'break' outside of a loop", stmt->location);
+            }
+            break;
+        
+        case STMT_CONTINUE:
+            if (g_loop_depth == 0) {
+                semantic_error_list_add(errors, "'continue' outside of a loop", stmt->location);
+            }
+            break;
     }
 }
 
@@ -424,9 +809,22 @@ static void analyze_block(ASTBlock* block, SymbolTable* table, CasmType return_t
 
 /* Pass 1: Collect all function definitions */
 static void collect_functions(ASTProgram* program, SymbolTable* table, SemanticErrorList* errors) {
-    (void)errors;  /* No longer used after Phase 3 - collision errors are removed */
     for (int i = 0; i < program->function_count; i++) {
         ASTFunctionDef* func = &program->functions[i];
+        g_module_path = func->module_path;
+        
+        /* Resolve struct parameter types */
+        int* param_structs = NULL;
+        for (int j = 0; j < func->parameter_count; j++) {
+            ASTParameter* param = &func->parameters[j];
+            if (param->type.type != TYPE_STRUCT) continue;
+            param->struct_index = resolve_struct(param->struct_name, param->location, errors);
+            if (!param_structs) {
+                param_structs = xmalloc(func->parameter_count * sizeof(int));
+                for (int k = 0; k < func->parameter_count; k++) param_structs[k] = -1;
+            }
+            param_structs[j] = param->struct_index;
+        }
         
         /* Convert parameter types */
         CasmType* param_types = NULL;
@@ -440,8 +838,12 @@ static void collect_functions(ASTProgram* program, SymbolTable* table, SemanticE
         /* Add function to symbol table 
          * Note: With symbol IDs, we allow multiple functions with the same name
          * from different modules. The duplicate check is now obsolete. */
-        symbol_table_add_function(table, func->name, func->return_type.type, 
-                                  param_types, func->parameter_count, func->location);
+        if (symbol_table_add_function(table, func->name, func->return_type.type,
+                                      param_types, func->parameter_count, func->location)) {
+            table->functions[table->function_count - 1].param_structs = param_structs;
+        } else {
+            xfree(param_structs);
+        }
         
         if (param_types) {
             xfree(param_types);
@@ -453,6 +855,8 @@ static void collect_functions(ASTProgram* program, SymbolTable* table, SemanticE
 static void validate_functions(ASTProgram* program, SymbolTable* table, SemanticErrorList* errors) {
     for (int i = 0; i < program->function_count; i++) {
         ASTFunctionDef* func = &program->functions[i];
+        g_module_path = func->module_path;
+        g_loop_depth = 0;
         
         /* Push scope for function parameters */
         symbol_table_push_scope(table);
@@ -464,6 +868,11 @@ static void validate_functions(ASTProgram* program, SymbolTable* table, Semantic
                                       func->parameters[j].location);
             /* Function parameters are initialized by the call */
             symbol_table_mark_initialized(table, func->parameters[j].name);
+            if (func->parameters[j].type.type == TYPE_STRUCT) {
+                VariableSymbol* var = symbol_table_lookup_variable(table, func->parameters[j].name);
+                var->struct_index = func->parameters[j].struct_index;
+                var->by_reference = 1;
+            }
         }
         
         /* Analyze function body */
@@ -474,6 +883,164 @@ static void validate_functions(ASTProgram* program, SymbolTable* table, Semantic
     }
 }
 
+/* Helper: Wrap a constant to the range of an integer type */
+static long long wrap_constant(long long value, CasmType type) {
+    switch (type) {
+        case TYPE_I8:  return (int8_t)(uint8_t)value;
+        case TYPE_I16: return (int16_t)(uint16_t)value;
+        case TYPE_I32: return (int32_t)(uint32_t)value;
+        case TYPE_U8:  return (uint8_t)value;
+        case TYPE_U16: return (uint16_t)value;
+        case TYPE_U32: return (uint32_t)value;
+        case TYPE_BOOL: return value != 0;
+        default:       return value;
+    }
+}
+
+/* Helper: Evaluate a scalar global's initializer: an integer or bool
+ * literal, optionally negated, complemented or cast. Returns 0 if it is
+ * not such a constant. */
+static int eval_global_initializer(const ASTExpression* expr, long long* value, int* is_bool) {
+    if (expr->type == EXPR_LITERAL) {
+        *is_bool = expr->as.literal.type == LITERAL_BOOL;
+        *value = *is_bool ? expr->as.literal.value.bool_value : expr->as.literal.value.int_value;
+        return 1;
+    }
+    if (expr->type != EXPR_UNARY_OP) {
+        return 0;
+    }
+    const ASTUnaryOp* unop = &expr->as.unary_op;
+    if (!eval_global_initializer(unop->operand, value, is_bool)) {
+        return 0;
+    }
+    switch (unop->op) {
+        case UNOP_NEG:
+            if (*is_bool) return 0;
+            *value = (long long)(0ULL - (unsigned long long)*value);
+            return 1;
+        case UNOP_BIT_NOT:
+            if (*is_bool) return 0;
+            *value = ~*value;
+            return 1;
+        case UNOP_NOT:
+            if (!*is_bool) return 0;
+            *value = !*value;
+            return 1;
+        case UNOP_CAST:
+            if (unop->target_type == TYPE_BOOL && !*is_bool) return 0;
+            *value = wrap_constant(*value, unop->target_type);
+            *is_bool = unop->target_type == TYPE_BOOL;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Check a scalar global's initializer and store its value as the
+ * declaration's single element */
+static void check_scalar_global(ASTVarDecl* decl, SemanticErrorList* errors) {
+    if (!decl->initializer) {
+        return;
+    }
+    char msg[256];
+    long long value;
+    int is_bool;
+    /* A cast already produced a value of its (compatible) target type */
+    int cast = decl->initializer->type == EXPR_UNARY_OP && decl->initializer->as.unary_op.op == UNOP_CAST;
+    if (!eval_global_initializer(decl->initializer, &value, &is_bool)) {
+        snprintf(msg, sizeof(msg), "Global '%s' must be initialized with a constant", decl->name);
+        semantic_error_list_add(errors, msg, decl->location);
+    } else if (is_bool != (decl->type.type == TYPE_BOOL) ||
+               (cast && !types_compatible(decl->initializer->as.unary_op.target_type, decl->type.type))) {
+        semantic_error_list_add(errors, "Initializer type mismatch", decl->location);
+    } else if (!is_bool && !cast && !value_fits_type(value, decl->type.type)) {
+        snprintf(msg, sizeof(msg), "Initializer of '%s' does not fit in %s", decl->name,
+                 type_to_string(decl->type.type));
+        semantic_error_list_add(errors, msg, decl->location);
+    } else {
+        xfree(decl->elements);
+        decl->elements = xmalloc(sizeof(long));
+        decl->elements[0] = (long)wrap_constant(value, decl->type.type);
+        decl->element_count = 1;
+    }
+    ast_expression_free(decl->initializer);
+    decl->initializer = NULL;
+}
+
+/* Validate module-level variables: declarations, and names unique within a module */
+static void validate_globals(ASTProgram* program, SemanticErrorList* errors) {
+    for (int i = 0; i < program->global_count; i++) {
+        ASTGlobalVar* global = &program->globals[i];
+        const char* kind = global->decl.array_length > 0 ? "Array" : "Global";
+        char msg[256];
+        if (global->decl.type.type == TYPE_STRUCT) {
+            /* Struct storage is per call frame; there is no module-level layout */
+            snprintf(msg, sizeof(msg), "Global '%s' cannot have struct type '%s'", global->decl.name,
+                     global->decl.struct_name);
+            semantic_error_list_add(errors, msg, global->decl.location);
+            ast_expression_free(global->decl.initializer);
+            global->decl.initializer = NULL;
+        } else if (global->decl.array_length > 0) {
+            check_array_decl(&global->decl, MAX_ARRAY_LENGTH, errors);
+        } else {
+            check_scalar_global(&global->decl, errors);
+        }
+        
+        for (int j = 0; j < i; j++) {
+            if (strcmp(program->globals[j].decl.name, global->decl.name) == 0 &&
+                same_module(program->globals[j].module_path, global->module_path)) {
+                snprintf(msg, sizeof(msg), "%s '%s' already defined", kind, global->decl.name);
+                semantic_error_list_add(errors, msg, global->decl.location);
+                break;
+            }
+        }
+        for (int j = 0; j < program->function_count; j++) {
+            if (strcmp(program->functions[j].name, global->decl.name) == 0 &&
+                same_module(program->functions[j].module_path, global->module_path)) {
+                snprintf(msg, sizeof(msg), "%s '%s' has the same name as a function", kind, global->decl.name);
+                semantic_error_list_add(errors, msg, global->decl.location);
+                break;
+            }
+        }
+    }
+}
+
+/* Validate struct types and lay out their fields: integer fields with
+ * unique names, struct names unique within a module */
+static void validate_structs(ASTProgram* program, SemanticErrorList* errors) {
+    char msg[256];
+    for (int i = 0; i < program->struct_count; i++) {
+        ASTStructDef* def = &program->structs[i];
+        for (int j = 0; j < i; j++) {
+            if (strcmp(program->structs[j].name, def->name) == 0 &&
+                same_module(program->structs[j].module_path, def->module_path)) {
+                snprintf(msg, sizeof(msg), "Struct '%s' already defined", def->name);
+                semantic_error_list_add(errors, msg, def->location);
+                break;
+            }
+        }
+        if (def->field_count == 0) {
+            snprintf(msg, sizeof(msg), "Struct '%s' has no fields", def->name);
+            semantic_error_list_add(errors, msg, def->location);
+        }
+        for (int f = 0; f < def->field_count; f++) {
+            ASTStructField* field = &def->fields[f];
+            if (!is_numeric_type(field->type.type)) {
+                snprintf(msg, sizeof(msg), "Field '%s' must have an integer type", field->name);
+                semantic_error_list_add(errors, msg, field->location);
+            }
+            for (int g = 0; g < f; g++) {
+                if (strcmp(def->fields[g].name, field->name) == 0) {
+                    snprintf(msg, sizeof(msg), "Duplicate field '%s' in struct '%s'", field->name, def->name);
+                    semantic_error_list_add(errors, msg, field->location);
+                    break;
+                }
+            }
+        }
+        layout_struct(def);
+    }
+}
+
 /* Validate that imported names only come from specified files (no collisions) */
 /* Validate that imported names are not colliding from different sources
  * An explicit collision occurs when the same function name is imported from
@@ -608,15 +1175,25 @@ int analyze_program(ASTProgram* program, SymbolTable* table, SemanticErrorList*
         return 0;  /* Stop if there are errors */
     }
     
-    /* Pass 3: Collect all function definitions */
+    /* Pass 3: Validate struct types, then collect all function definitions */
+    validate_structs(program, errors);
+    g_program = program;
     collect_functions(program, table, errors);
+    g_program = NULL;
+    g_module_path = NULL;
     
     if (errors->error_count > 0) {
         return 0;  /* Stop if there are errors */
     }
     
-    /* Pass 4: Validate function bodies and expressions */
+    /* Pass 4: Validate module-level variables */
+    validate_globals(program, errors);
+    
+    /* Pass 5: Validate function bodies and expressions */
+    g_program = program;
     validate_functions(program, table, errors);
+    g_program = NULL;
+    g_module_path = NULL;
     
     return errors->error_count == 0;
 }
@@ -0,0 +1,694 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "specialize.h"
+#include "optimizer.h"
+#include "call_graph.h"
+#include "utils.h"
+
+/* For a call such as pow_mod(x, 2, 1000) the clone is
+ *     i32 pow_mod__spec1(i32 x) { ...body with e := 2, m := 1000... }
+ * and the call becomes pow_mod__spec1(x). Calls with the same constants
+ * share a clone. Clones are walked like any other function, so a
+ * recursive call that passes the constants through ends up calling the
+ * clone itself, and one whose arguments fold to other constants (e / 2
+ * in pow_mod) gets a clone of its own while the limits allow. A
+ * recursive `return f(...)` is left alone unless it stays in the same
+ * function, so backends can still turn it into a loop. Originals whose
+ * calls all went to clones are dropped. */
+
+#define SPECIALIZE_CALLEE_SIZE_LIMIT 200   /* AST nodes in the largest function cloned */
+#define SPECIALIZE_MAX_CLONES 8            /* Clones per function */
+#define SPECIALIZE_MIN_GROWTH 256          /* AST nodes clones may always add */
+
+typedef struct {
+    int callee;             /* Index of the original function */
+    char* clone_name;
+    int* is_constant;       /* Per parameter of the original */
+    long long* values;
+} Specialization;
+
+typedef struct {
+    ASTProgram* program;
+    int original_count;         /* Functions before cloning */
+    const char* module_path;    /* Of the function being walked */
+    int walking_origin;         /* Original of the function being walked */
+    int walking_spec;           /* Its specialization, or -1 for an original */
+    const ASTExpression* tail_call;  /* Call a `return` is made of, if any */
+    int* clone_counts;          /* Per original function */
+    Specialization* specs;
+    int spec_count;
+    int spec_capacity;
+    ASTFunctionDef* pending;    /* Clones made while walking a function */
+    int pending_count;
+    int pending_capacity;
+    uint32_t next_symbol_id;
+    int growth_left;
+    int redirected;
+    SpecializeStats* stats;
+} Specializer;
+
+/* ===== Size helpers ===== */
+
+static int expression_size(const ASTExpression* expr) {
+    if (!expr) return 0;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            return 1 + expression_size(expr->as.binary_op.left) + expression_size(expr->as.binary_op.right);
+        case EXPR_UNARY_OP:
+            return 1 + expression_size(expr->as.unary_op.operand);
+        case EXPR_FUNCTION_CALL: {
+            int size = 1;
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                size += expression_size(&expr->as.function_call.arguments[i]);
+            }
+            return size;
+        }
+        case EXPR_INDEX:
+            return 1 + expression_size(expr->as.index.index);
+        default:
+            return 1;
+    }
+}
+
+static int block_size(const ASTBlock* block);
+
+static int statement_size(const ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            return 1 + expression_size(stmt->as.return_stmt.value);
+        case STMT_EXPR:
+            return 1 + expression_size(stmt->as.expr_stmt.expr);
+        case STMT_VAR_DECL:
+            return 1 + expression_size(stmt->as.var_decl_stmt.var_decl.initializer);
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            int size = 1 + expression_size(if_stmt->condition) + block_size(&if_stmt->then_body);
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                size += expression_size(clause->condition) + block_size(&clause->body);
+            }
+            if (if_stmt->else_body) size += block_size(if_stmt->else_body);
+            return size;
+        }
+        case STMT_WHILE:
+            return 1 + expression_size(stmt->as.while_stmt.condition) + block_size(&stmt->as.while_stmt.body);
+        case STMT_FOR: {
+            const ASTForStmt* for_stmt = &stmt->as.for_stmt;
+            return 1 + (for_stmt->init ? statement_size(for_stmt->init) : 0) +
+                   expression_size(for_stmt->condition) + expression_size(for_stmt->update) +
+                   block_size(&for_stmt->body);
+        }
+        case STMT_BLOCK:
+            return block_size(&stmt->as.block_stmt.block);
+        case STMT_DBG: {
+            int size = 1;
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                size += expression_size(&stmt->as.dbg_stmt.arguments[i]);
+            }
+            return size;
+        }
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            return 1;
+    }
+    return 1;
+}
+
+static int block_size(const ASTBlock* block) {
+    int size = 0;
+    for (int i = 0; i < block->statement_count; i++) {
+        size += statement_size(&block->statements[i]);
+    }
+    return size;
+}
+
+/* ===== Variable references ===== */
+
+/* Helper: Check if an expression reads `name` or, with `writes`, assigns it */
+static int expression_mentions(const ASTExpression* expr, const char* name, int writes) {
+    if (!expr) return 0;
+    switch (expr->type) {
+        case EXPR_VARIABLE:
+            return !writes && strcmp(expr->as.variable.name, name) == 0;
+        case EXPR_BINARY_OP: {
+            const ASTBinaryOp* binop = &expr->as.binary_op;
+            if (writes && binop->op == BINOP_ASSIGN && binop->left->type == EXPR_VARIABLE &&
+                strcmp(binop->left->as.variable.name, name) == 0) {
+                return 1;
+            }
+            return expression_mentions(binop->left, name, writes) ||
+                   expression_mentions(binop->right, name, writes);
+        }
+        case EXPR_UNARY_OP:
+            return expression_mentions(expr->as.unary_op.operand, name, writes);
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                if (expression_mentions(&expr->as.function_call.arguments[i], name, writes)) return 1;
+            }
+            return 0;
+        case EXPR_INDEX:
+            return expression_mentions(expr->as.index.index, name, writes);
+        case EXPR_FIELD:
+        case EXPR_LITERAL:
+            return 0;
+    }
+    return 0;
+}
+
+static int block_mentions(const ASTBlock* block, const char* name, int writes);
+
+static int statement_mentions(const ASTStatement* stmt, const char* name, int writes) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            return expression_mentions(stmt->as.return_stmt.value, name, writes);
+        case STMT_EXPR:
+            return expression_mentions(stmt->as.expr_stmt.expr, name, writes);
+        case STMT_VAR_DECL:
+            return expression_mentions(stmt->as.var_decl_stmt.var_decl.initializer, name, writes);
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            if (expression_mentions(if_stmt->condition, name, writes) ||
+                block_mentions(&if_stmt->then_body, name, writes)) {
+                return 1;
+            }
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                if (expression_mentions(clause->condition, name, writes) ||
+                    block_mentions(&clause->body, name, writes)) {
+                    return 1;
+                }
+            }
+            return if_stmt->else_body && block_mentions(if_stmt->else_body, name, writes);
+        }
+        case STMT_WHILE:
+            return expression_mentions(stmt->as.while_stmt.condition, name, writes) ||
+                   block_mentions(&stmt->as.while_stmt.body, name, writes);
+        case STMT_FOR:
+            return (stmt->as.for_stmt.init && statement_mentions(stmt->as.for_stmt.init, name, writes)) ||
+                   expression_mentions(stmt->as.for_stmt.condition, name, writes) ||
+                   expression_mentions(stmt->as.for_stmt.update, name, writes) ||
+                   block_mentions(&stmt->as.for_stmt.body, name, writes);
+        case STMT_BLOCK:
+            return block_mentions(&stmt->as.block_stmt.block, name, writes);
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                if (expression_mentions(&stmt->as.dbg_stmt.arguments[i], name, writes)) return 1;
+            }
+            return 0;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            return 0;
+    }
+    return 0;
+}
+
+static int block_mentions(const ASTBlock* block, const char* name, int writes) {
+    for (int i = 0; i < block->statement_count; i++) {
+        if (statement_mentions(&block->statements[i], name, writes)) return 1;
+    }
+    return 0;
+}
+
+/* ===== Substitution ===== */
+
+/* Helper: Wrap a literal argument to the parameter's type, as the call
+ * would convert it */
+static long long convert_to_type(long long value, CasmType type) {
+    unsigned long long bits = (unsigned long long)value;
+    switch (type) {
+        case TYPE_I8:   return (int8_t)(uint8_t)bits;
+        case TYPE_I16:  return (int16_t)(uint16_t)bits;
+        case TYPE_I32:  return (int32_t)(uint32_t)bits;
+        case TYPE_U8:   return (uint8_t)bits;
+        case TYPE_U16:  return (uint16_t)bits;
+        case TYPE_U32:  return (uint32_t)bits;
+        case TYPE_BOOL: return value != 0;
+        default:        return value;
+    }
+}
+
+/* Helper: Replace references to `name` with a literal of the parameter's type */
+static void substitute_expression(ASTExpression* expr, const char* name, CasmType type, long long value) {
+    if (!expr) return;
+    switch (expr->type) {
+        case EXPR_VARIABLE:
+            if (strcmp(expr->as.variable.name, name) != 0) break;
+            ast_expression_free_contents(expr);
+            expr->type = EXPR_LITERAL;
+            expr->as.literal.location = expr->location;
+            expr->resolved_type = type;
+            if (type == TYPE_BOOL) {
+                expr->as.literal.type = LITERAL_BOOL;
+                expr->as.literal.value.bool_value = value ? 1 : 0;
+            } else {
+                expr->as.literal.type = LITERAL_INT;
+                expr->as.literal.value.int_value = value;
+            }
+            break;
+        case EXPR_BINARY_OP:
+            substitute_expression(expr->as.binary_op.left, name, type, value);
+            substitute_expression(expr->as.binary_op.right, name, type, value);
+            break;
+        case EXPR_UNARY_OP:
+            substitute_expression(expr->as.unary_op.operand, name, type, value);
+            break;
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                substitute_expression(&expr->as.function_call.arguments[i], name, type, value);
+            }
+            break;
+        case EXPR_INDEX:
+            substitute_expression(expr->as.index.index, name, type, value);
+            break;
+        case EXPR_FIELD:
+        case EXPR_LITERAL:
+            break;
+    }
+}
+
+static void substitute_block(ASTBlock* block, const char* name, CasmType type, long long value);
+
+/* Helper: Substitute within a statement. Returns 1 if the statement
+ * declares a local with the same name, which hides the parameter for the
+ * rest of the block (including its own initializer). */
+static int substitute_statement(ASTStatement* stmt, const char* name, CasmType type, long long value) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            substitute_expression(stmt->as.return_stmt.value, name, type, value);
+            break;
+        case STMT_EXPR:
+            substitute_expression(stmt->as.expr_stmt.expr, name, type, value);
+            break;
+        case STMT_VAR_DECL:
+            if (strcmp(stmt->as.var_decl_stmt.var_decl.name, name) == 0) return 1;
+            substitute_expression(stmt->as.var_decl_stmt.var_decl.initializer, name, type, value);
+            break;
+        case STMT_IF:
+            substitute_expression(stmt->as.if_stmt.condition, name, type, value);
+            substitute_block(&stmt->as.if_stmt.then_body, name, type, value);
+            for (ASTElseIfClause* clause = stmt->as.if_stmt.else_if_chain; clause; clause = clause->next) {
+                substitute_expression(clause->condition, name, type, value);
+                substitute_block(&clause->body, name, type, value);
+            }
+            if (stmt->as.if_stmt.else_body) {
+                substitute_block(stmt->as.if_stmt.else_body, name, type, value);
+            }
+            break;
+        case STMT_WHILE:
+            substitute_expression(stmt->as.while_stmt.condition, name, type, value);
+            substitute_block(&stmt->as.while_stmt.body, name, type, value);
+            break;
+        case STMT_FOR:
+            /* A loop variable with the same name hides the parameter in the whole loop */
+            if (stmt->as.for_stmt.init && substitute_statement(stmt->as.for_stmt.init, name, type, value)) {
+                break;
+            }
+            substitute_expression(stmt->as.for_stmt.condition, name, type, value);
+            substitute_expression(stmt->as.for_stmt.update, name, type, value);
+            substitute_block(&stmt->as.for_stmt.body, name, type, value);
+            break;
+        case STMT_BLOCK:
+            substitute_block(&stmt->as.block_stmt.block, name, type, value);
+            break;
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                substitute_expression(&stmt->as.dbg_stmt.arguments[i], name, type, value);
+            }
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+    return 0;
+}
+
+static void substitute_block(ASTBlock* block, const char* name, CasmType type, long long value) {
+    for (int i = 0; i < block->statement_count; i++) {
+        if (substitute_statement(&block->statements[i], name, type, value)) return;
+    }
+}
+
+/* ===== Cloning ===== */
+
+static ASTFunctionDef* function_at(Specializer* sp, int index) {
+    if (index < sp->program->function_count) return &sp->program->functions[index];
+    return &sp->pending[index - sp->program->function_count];
+}
+
+static int function_total(const Specializer* sp) {
+    return sp->program->function_count + sp->pending_count;
+}
+
+static int same_module(const char* a, const char* b) {
+    if (!a || !b) return a == b;
+    return strcmp(a, b) == 0;
+}
+
+/* Helper: Find the function a call made from the current module refers
+ * to: that module's definition, else the only definition with that name.
+ * Returns -1 if the call is ambiguous or unknown. */
+static int resolve_call(Specializer* sp, const char* name) {
+    int match = -1;
+    int match_count = 0;
+    for (int i = 0; i < function_total(sp); i++) {
+        ASTFunctionDef* func = function_at(sp, i);
+        if (strcmp(func->name, name) != 0) continue;
+        if (same_module(func->module_path, sp->module_path)) return i;
+        match = i;
+        match_count++;
+    }
+    return match_count == 1 ? match : -1;
+}
+
+/* Helper: A function name not used in any module yet, derived from `base` */
+static char* fresh_name(Specializer* sp, const char* base) {
+    char name[512];
+    for (int suffix = 1; ; suffix++) {
+        snprintf(name, sizeof(name), "%s__spec%d", base, suffix);
+        int taken = 0;
+        for (int i = 0; i < function_total(sp) && !taken; i++) {
+            taken = strcmp(function_at(sp, i)->name, name) == 0;
+        }
+        if (!taken) return xstrdup(name);
+    }
+}
+
+static const Specialization* find_specialization(const Specializer* sp, int callee,
+                                                 const int* is_constant, const long long* values) {
+    int param_count = sp->program->functions[callee].parameter_count;
+    for (int i = 0; i < sp->spec_count; i++) {
+        const Specialization* spec = &sp->specs[i];
+        if (spec->callee != callee) continue;
+        int same = 1;
+        for (int p = 0; p < param_count && same; p++) {
+            same = spec->is_constant[p] == is_constant[p] &&
+                   (!is_constant[p] || spec->values[p] == values[p]);
+        }
+        if (same) return spec;
+    }
+    return NULL;
+}
+
+/* Create the clone of `callee` for these constants and record it */
+static const Specialization* make_specialization(Specializer* sp, int callee,
+                                                 const int* is_constant, const long long* values) {
+    const ASTFunctionDef* func = &sp->program->functions[callee];
+    int param_count = func->parameter_count;
+
+    ASTFunctionDef clone;
+    memset(&clone, 0, sizeof(clone));
+    clone.name = fresh_name(sp, func->name);
+    clone.return_type = func->return_type;
+    clone.location = func->location;
+    clone.symbol_id = sp->next_symbol_id++;
+    clone.original_name = xstrdup(clone.name);
+    clone.module_path = func->module_path ? xstrdup(func->module_path) : NULL;
+    clone.parameters = xmalloc((param_count + 1) * sizeof(ASTParameter));
+    clone.body = ast_block_clone(&func->body);
+    for (int p = 0; p < param_count; p++) {
+        const ASTParameter* param = &func->parameters[p];
+        if (is_constant[p]) {
+            substitute_block(&clone.body, param->name, param->type.type, values[p]);
+        } else {
+            ASTParameter* kept = &clone.parameters[clone.parameter_count++];
+            kept->name = xstrdup(param->name);
+            kept->type = param->type;
+            kept->struct_name = xstrdup(param->struct_name);
+            kept->struct_index = param->struct_index;
+            kept->location = param->location;
+        }
+    }
+
+    if (sp->pending_count >= sp->pending_capacity) {
+        sp->pending_capacity = sp->pending_capacity == 0 ? 4 : sp->pending_capacity * 2;
+        sp->pending = xrealloc(sp->pending, sp->pending_capacity * sizeof(ASTFunctionDef));
+    }
+    sp->pending[sp->pending_count++] = clone;
+
+    if (sp->spec_count >= sp->spec_capacity) {
+        sp->spec_capacity = sp->spec_capacity == 0 ? 8 : sp->spec_capacity * 2;
+        sp->specs = xrealloc(sp->specs, sp->spec_capacity * sizeof(Specialization));
+    }
+    Specialization* spec = &sp->specs[sp->spec_count++];
+    spec->callee = callee;
+    spec->clone_name = xstrdup(clone.name);
+    spec->is_constant = xmalloc((param_count + 1) * sizeof(int));
+    spec->values = xmalloc((param_count + 1) * sizeof(long long));
+    memcpy(spec->is_constant, is_constant, param_count * sizeof(int));
+    memcpy(spec->values, values, param_count * sizeof(long long));
+
+    sp->clone_counts[callee]++;
+    sp->growth_left -= block_size(&func->body);
+    if (sp->stats) {
+        sp->stats->clones++;
+    }
+    return spec;
+}
+
+/* Redirect a call to a specialized clone */
+static void specialize_call(Specializer* sp, ASTExpression* expr) {
+    ASTFunctionCall* call = &expr->as.function_call;
+    int callee = resolve_call(sp, call->function_name);
+    if (callee < 0 || callee >= sp->original_count) return;
+
+    const ASTFunctionDef* func = &sp->program->functions[callee];
+    if (strcmp(func->name, "main") == 0 || call->argument_count != func->parameter_count) return;
+
+    int param_count = func->parameter_count;
+    int* is_constant = xmalloc((param_count + 1) * sizeof(int));
+    long long* values = xmalloc((param_count + 1) * sizeof(long long));
+    int useful = 0;
+    for (int p = 0; p < param_count; p++) {
+        const ASTExpression* arg = &call->arguments[p];
+        const ASTParameter* param = &func->parameters[p];
+        is_constant[p] = arg->type == EXPR_LITERAL && !block_mentions(&func->body, param->name, 1);
+        values[p] = 0;
+        if (!is_constant[p]) continue;
+        long long raw = arg->as.literal.type == LITERAL_BOOL
+            ? arg->as.literal.value.bool_value
+            : arg->as.literal.value.int_value;
+        values[p] = convert_to_type(raw, param->type.type);
+        if (block_mentions(&func->body, param->name, 0)) useful = 1;
+    }
+
+    const Specialization* spec = NULL;
+    if (useful && expr == sp->tail_call && callee == sp->walking_origin) {
+        /* A self tail call must stay one: a clone calling back into the
+         * original, or two clones calling each other, would grow the stack
+         * where one function looping would not */
+        spec = find_specialization(sp, callee, is_constant, values);
+        if (spec && spec - sp->specs != sp->walking_spec) spec = NULL;
+    } else if (useful) {
+        spec = find_specialization(sp, callee, is_constant, values);
+        int size = block_size(&func->body);
+        if (!spec && sp->clone_counts[callee] < SPECIALIZE_MAX_CLONES &&
+            size <= SPECIALIZE_CALLEE_SIZE_LIMIT && size <= sp->growth_left) {
+            spec = make_specialization(sp, callee, is_constant, values);
+        }
+    }
+
+    if (spec) {
+        /* Keep only the arguments the clone still takes */
+        int kept = 0;
+        for (int p = 0; p < param_count; p++) {
+            if (spec->is_constant[p]) {
+                ast_expression_free_contents(&call->arguments[p]);
+            } else {
+                call->arguments[kept++] = call->arguments[p];
+            }
+        }
+        call->argument_count = kept;
+        xfree(call->function_name);
+        call->function_name = xstrdup(spec->clone_name);
+        sp->redirected++;
+        if (sp->stats) {
+            sp->stats->specialized_calls++;
+        }
+    }
+
+    xfree(is_constant);
+    xfree(values);
+}
+
+/* ===== Walk ===== */
+
+static void specialize_block(Specializer* sp, ASTBlock* block);
+
+static void specialize_expression(Specializer* sp, ASTExpression* expr) {
+    if (!expr) return;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            specialize_expression(sp, expr->as.binary_op.left);
+            specialize_expression(sp, expr->as.binary_op.right);
+            break;
+        case EXPR_UNARY_OP:
+            specialize_expression(sp, expr->as.unary_op.operand);
+            break;
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                specialize_expression(sp, &expr->as.function_call.arguments[i]);
+                /* Substituted constants make arguments like `m` or `e / 2` literal */
+                optimize_fold_expression(&expr->as.function_call.arguments[i]);
+            }
+            specialize_call(sp, expr);
+            break;
+        case EXPR_INDEX:
+            specialize_expression(sp, expr->as.index.index);
+            break;
+        default:
+            break;
+    }
+}
+
+static void specialize_statement(Specializer* sp, ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            sp->tail_call = stmt->as.return_stmt.value;
+            specialize_expression(sp, stmt->as.return_stmt.value);
+            sp->tail_call = NULL;
+            break;
+        case STMT_EXPR:
+            specialize_expression(sp, stmt->as.expr_stmt.expr);
+            break;
+        case STMT_VAR_DECL:
+            specialize_expression(sp, stmt->as.var_decl_stmt.var_decl.initializer);
+            break;
+        case STMT_IF:
+            specialize_expression(sp, stmt->as.if_stmt.condition);
+            specialize_block(sp, &stmt->as.if_stmt.then_body);
+            for (ASTElseIfClause* clause = stmt->as.if_stmt.else_if_chain; clause; clause = clause->next) {
+                specialize_expression(sp, clause->condition);
+                specialize_block(sp, &clause->body);
+            }
+            if (stmt->as.if_stmt.else_body) {
+                specialize_block(sp, stmt->as.if_stmt.else_body);
+            }
+            break;
+        case STMT_WHILE:
+            specialize_expression(sp, stmt->as.while_stmt.condition);
+            specialize_block(sp, &stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            if (stmt->as.for_stmt.init) {
+                specialize_statement(sp, stmt->as.for_stmt.init);
+            }
+            specialize_expression(sp, stmt->as.for_stmt.condition);
+            specialize_expression(sp, stmt->as.for_stmt.update);
+            specialize_block(sp, &stmt->as.for_stmt.body);
+            break;
+        case STMT_BLOCK:
+            specialize_block(sp, &stmt->as.block_stmt.block);
+            break;
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                specialize_expression(sp, &stmt->as.dbg_stmt.arguments[i]);
+            }
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+}
+
+static void specialize_block(Specializer* sp, ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        specialize_statement(sp, &block->statements[i]);
+    }
+}
+
+/* Helper: Move the clones made so far into the program */
+static void flush_pending(Specializer* sp) {
+    if (sp->pending_count == 0) return;
+    ASTProgram* program = sp->program;
+    int total = function_total(sp);
+    program->functions = xrealloc(program->functions, total * sizeof(ASTFunctionDef));
+    memcpy(&program->functions[program->function_count], sp->pending,
+           sp->pending_count * sizeof(ASTFunctionDef));
+    program->function_count = total;
+    sp->pending_count = 0;
+}
+
+/* Helper: Remove originals that got clones and can no longer be reached
+ * from main, such as a recursive function only its clones called */
+static void drop_replaced_originals(Specializer* sp) {
+    ASTProgram* program = sp->program;
+    CallGraph* graph = call_graph_create(program);
+    int reachable_count = 0;
+    uint32_t* reachable = call_graph_get_reachable_functions(graph, &reachable_count);
+    call_graph_free(graph);
+    if (!reachable) return;
+
+    int kept = 0;
+    for (int i = 0; i < program->function_count; i++) {
+        ASTFunctionDef* func = &program->functions[i];
+        int used = i >= sp->original_count || sp->clone_counts[i] == 0;
+        for (int j = 0; j < reachable_count && !used; j++) {
+            used = reachable[j] == func->symbol_id;
+        }
+        if (used) {
+            program->functions[kept++] = *func;
+        } else {
+            ast_function_free(func);
+        }
+    }
+    program->function_count = kept;
+    xfree(reachable);
+}
+
+int specialize_functions(ASTProgram* program, SpecializeStats* stats) {
+    int n = program ? program->function_count : 0;
+    if (n == 0) return 0;
+
+    /* Clones need symbol ids of their own; programs that did not go
+     * through the module loader have none yet */
+    uint32_t max_id = 0;
+    for (int i = 0; i < n; i++) {
+        if (program->functions[i].symbol_id == 0) {
+            for (int j = 0; j < n; j++) {
+                program->functions[j].symbol_id = (uint32_t)(j + 1);
+            }
+            max_id = (uint32_t)n;
+            break;
+        }
+        if (program->functions[i].symbol_id > max_id) {
+            max_id = program->functions[i].symbol_id;
+        }
+    }
+
+    Specializer sp;
+    memset(&sp, 0, sizeof(sp));
+    sp.program = program;
+    sp.original_count = n;
+    sp.clone_counts = xmalloc(n * sizeof(int));
+    sp.next_symbol_id = max_id + 1;
+    sp.stats = stats;
+
+    int program_size = 0;
+    for (int i = 0; i < n; i++) {
+        sp.clone_counts[i] = 0;
+        program_size += block_size(&program->functions[i].body);
+    }
+    sp.growth_left = program_size / 2 > SPECIALIZE_MIN_GROWTH ? program_size / 2 : SPECIALIZE_MIN_GROWTH;
+
+    /* Clones are appended after the function being walked, then walked
+     * themselves */
+    for (int i = 0; i < program->function_count; i++) {
+        sp.module_path = program->functions[i].module_path;
+        sp.walking_spec = i < n ? -1 : i - n;
+        sp.walking_origin = i < n ? i : sp.specs[i - n].callee;
+        specialize_block(&sp, &program->functions[i].body);
+        flush_pending(&sp);
+    }
+    if (sp.redirected > 0) {
+        drop_replaced_originals(&sp);
+    }
+
+    for (int i = 0; i < sp.spec_count; i++) {
+        xfree(sp.specs[i].clone_name);
+        xfree(sp.specs[i].is_constant);
+        xfree(sp.specs[i].values);
+    }
+    xfree(sp.specs);
+    xfree(sp.pending);
+    xfree(sp.clone_counts);
+    return sp.redirected;
+}
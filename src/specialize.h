@@ -0,0 +1,23 @@
+#ifndef SPECIALIZE_H
+#define SPECIALIZE_H
+
+#include "ast.h"
+
+typedef struct {
+    int specialized_calls;  /* Call sites redirected to a clone */
+    int clones;             /* Specialized copies created */
+} SpecializeStats;
+
+/* Clone functions for the constant arguments they are called with: for
+ * each distinct combination of literal arguments (to parameters the
+ * callee never assigns), a copy of the callee gets those parameters
+ * replaced by the literals and dropped from its signature, and the call
+ * sites are redirected to it. Clones are ordinary functions with fresh
+ * names and symbol ids, so name allocation mangles them like any other.
+ * Growth is limited per function and per program. Run the folding passes
+ * again afterwards to propagate the constants. Must run before name
+ * allocation. Returns the number of call sites redirected; `stats` may be
+ * NULL. */
+int specialize_functions(ASTProgram* program, SpecializeStats* stats);
+
+#endif /* SPECIALIZE_H */
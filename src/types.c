@@ -41,6 +41,7 @@ void symbol_table_free(SymbolTable* table) {
         if (table->functions[i].param_types) {
             xfree(table->functions[i].param_types);
         }
+        xfree(table->functions[i].param_structs);
     }
     xfree(table->functions);
     
@@ -90,6 +91,7 @@ int symbol_table_add_function(SymbolTable* table, const char* name, CasmType ret
     } else {
         func->param_types = NULL;
     }
+    func->param_structs = NULL;
     
     table->function_count++;
     return 1;  /* Success */
@@ -128,6 +130,9 @@ int symbol_table_add_variable(SymbolTable* table, const char* name, CasmType typ
     var->type = type;
     var->location = location;
     var->initialized = 0;  /* Initially uninitialized */
+    var->array_length = 0;
+    var->struct_index = -1;
+    var->by_reference = 0;
     
     scope->variable_count++;
     return 1;  /* Success */
@@ -269,6 +274,9 @@ CasmType get_binary_op_result_type(CasmType left, BinaryOpType op, CasmType righ
         case BINOP_MUL:
         case BINOP_DIV:
         case BINOP_MOD:
+        case BINOP_BIT_AND:
+        case BINOP_BIT_OR:
+        case BINOP_BIT_XOR:
             /* Arithmetic: result is the wider type */
             if (left == TYPE_I64 || right == TYPE_I64) return TYPE_I64;
             if (left == TYPE_I32 || right == TYPE_I32) return TYPE_I32;
@@ -279,6 +287,13 @@ CasmType get_binary_op_result_type(CasmType left, BinaryOpType op, CasmType righ
             if (left == TYPE_U16 || right == TYPE_U16) return TYPE_U16;
             return TYPE_U8;
         
+        case BINOP_SHL:
+        case BINOP_SHR:
+        case BINOP_ROTL:
+        case BINOP_ROTR:
+            /* Shifts and rotates: the count does not affect the type */
+            return left;
+        
         case BINOP_EQ:
         case BINOP_NE:
         case BINOP_LT:
@@ -305,11 +320,18 @@ CasmType get_binary_op_result_type(CasmType left, BinaryOpType op, CasmType righ
 CasmType get_unary_op_result_type(UnaryOpType op, CasmType operand) {
     switch (op) {
         case UNOP_NEG:
-            /* Negation preserves type */
+        case UNOP_BIT_NOT:
+        case UNOP_POPCOUNT:
+        case UNOP_CLZ:
+        case UNOP_CTZ:
+            /* Negation and bit operations preserve type */
             return operand;
         case UNOP_NOT:
             /* Logical not returns bool */
             return TYPE_BOOL;
+        case UNOP_CAST:
+            /* Casts take their target type, set by semantic analysis */
+            return operand;
     }
     return TYPE_VOID;  /* Should not reach */
 }
@@ -318,3 +340,69 @@ CasmType get_unary_op_result_type(UnaryOpType op, CasmType operand) {
 int is_numeric_type(CasmType type) {
     return type >= TYPE_I8 && type <= TYPE_U64;
 }
+
+/* Helper: Wrap the low bits of a value to the canonical form of a type */
+static long long wrap_to_type(unsigned long long bits, CasmType type) {
+    switch (type) {
+        case TYPE_I8:  return (int8_t)(uint8_t)bits;
+        case TYPE_I16: return (int16_t)(uint16_t)bits;
+        case TYPE_I32: return (int32_t)(uint32_t)bits;
+        case TYPE_U8:  return (uint8_t)bits;
+        case TYPE_U16: return (uint16_t)bits;
+        case TYPE_U32: return (uint32_t)bits;
+        default:       return (long long)bits;
+    }
+}
+
+/* Evaluate a bitwise, shift or rotate operator on canonical values.
+ * Shifts mask the count to the width of the promoted type (31 or 63);
+ * rotates work on the type's own width. */
+long long eval_bit_op(BinaryOpType op, long long left, long long right, CasmType type) {
+    int width = get_type_size_bits(type);
+    unsigned long long mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+    unsigned long long a = (unsigned long long)left & mask;
+    unsigned long long b = (unsigned long long)right;
+    int count;
+    switch (op) {
+        case BINOP_BIT_AND: return wrap_to_type(a & b, type);
+        case BINOP_BIT_OR:  return wrap_to_type(a | b, type);
+        case BINOP_BIT_XOR: return wrap_to_type(a ^ b, type);
+        case BINOP_SHL:
+            count = (int)(b & (width > 32 ? 63 : 31));
+            return wrap_to_type(a << count, type);
+        case BINOP_SHR:
+            count = (int)(b & (width > 32 ? 63 : 31));
+            if (type == TYPE_I8 || type == TYPE_I16 || type == TYPE_I32 || type == TYPE_I64) {
+                return wrap_to_type((unsigned long long)(left >> count), type);
+            }
+            return wrap_to_type(a >> count, type);
+        case BINOP_ROTL:
+        case BINOP_ROTR:
+            count = (int)(b & (unsigned long long)(width - 1));
+            if (op == BINOP_ROTR) count = (width - count) & (width - 1);
+            if (count == 0) return left;
+            return wrap_to_type(((a << count) | (a >> (width - count))) & mask, type);
+        default:
+            return left;
+    }
+}
+
+/* Evaluate popcount, clz or ctz over the bits of a type's own width */
+long long eval_bit_count(UnaryOpType op, long long value, CasmType type) {
+    int width = get_type_size_bits(type);
+    unsigned long long a = (unsigned long long)value;
+    int n = 0;
+    switch (op) {
+        case UNOP_POPCOUNT:
+            for (int i = 0; i < width; i++) n += (int)((a >> i) & 1);
+            return n;
+        case UNOP_CLZ:
+            while (n < width && !((a >> (width - 1 - n)) & 1)) n++;
+            return n;
+        case UNOP_CTZ:
+            while (n < width && !((a >> n) & 1)) n++;
+            return n;
+        default:
+            return value;
+    }
+}
@@ -15,6 +15,7 @@ struct FunctionSymbol {
     char* module_name;       /* Module alias if imported, NULL for local */
     CasmType return_type;
     CasmType* param_types;
+    int* param_structs;      /* Struct index per parameter, -1 for scalars (NULL if none) */
     int param_count;
     SourceLocation location;
     /* Symbol deduplication fields */
@@ -30,6 +31,9 @@ struct VariableSymbol {
     CasmType type;
     SourceLocation location;
     int initialized;  /* Whether the variable has been assigned a value */
+    int array_length; /* Element count for arrays, 0 for scalars */
+    int struct_index; /* Index into ASTProgram.structs, -1 unless a struct */
+    int by_reference; /* Struct parameter (read-only, passed as an address) */
 };
 
 /* Scope - manages variables in a block */
@@ -76,4 +80,9 @@ CasmType get_unary_op_result_type(UnaryOpType op, CasmType operand);
 /* Helper to check if type is numeric */
 int is_numeric_type(CasmType type);
 
+/* Constant evaluation of bit operations, shared by the folders and the
+ * interpreter. Operands and results are canonical values of the type. */
+long long eval_bit_op(BinaryOpType op, long long left, long long right, CasmType type);
+long long eval_bit_count(UnaryOpType op, long long value, CasmType type);
+
 #endif /* TYPES_H */
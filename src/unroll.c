@@ -0,0 +1,600 @@
+#include <limits.h>
+#include <string.h>
+#include "unroll.h"
+#include "ranges.h"
+#include "utils.h"
+
+/* Loops are rewritten one at a time, innermost first, re-running the range
+ * analysis in between: it supplies trip counts (a bound may be a variable
+ * holding a known value) and proves that the x4/x8 guard `i < bound - K`
+ * cannot overflow.
+ *
+ * Full unrolling:                 Partial unrolling (x4 shown):
+ *     {                               {
+ *         body[i := 0]                    T i = start;
+ *         body[i := 1]                    for (; i < bound - 3 * step; i = i + step) {
+ *         ...                                 body i = i + step;
+ *     }                                       body i = i + step;
+ *                                             body i = i + step;
+ *                                             body
+ *                                         }
+ *                                         for (; i < bound; i = i + step) body
+ *                                     }
+ * Each copy of the body gets its own block if it declares locals. */
+
+#define UNROLL_FULL_MAX_TRIPS 16    /* Longest loop unrolled completely */
+#define UNROLL_LOOP_BUDGET 128      /* AST nodes the copies of one loop may take */
+#define UNROLL_FUNCTION_GROWTH 512  /* AST nodes a function may grow by */
+#define UNROLL_MAX_ROUNDS 64
+
+typedef struct {
+    const char* counter;
+    CasmType type;
+    long long step;             /* Negative when counting down */
+    ASTExpression* bound;       /* Right side of the condition */
+} CountedLoop;
+
+typedef struct {
+    const RangeFacts* facts;
+    int growth_left;
+    UnrollStats* stats;
+} Unroller;
+
+/* ===== Size helpers ===== */
+
+static int expression_size(const ASTExpression* expr) {
+    if (!expr) return 0;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            return 1 + expression_size(expr->as.binary_op.left) + expression_size(expr->as.binary_op.right);
+        case EXPR_UNARY_OP:
+            return 1 + expression_size(expr->as.unary_op.operand);
+        case EXPR_FUNCTION_CALL: {
+            int size = 1;
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                size += expression_size(&expr->as.function_call.arguments[i]);
+            }
+            return size;
+        }
+        case EXPR_INDEX:
+            return 1 + expression_size(expr->as.index.index);
+        default:
+            return 1;
+    }
+}
+
+static int block_size(const ASTBlock* block);
+
+static int statement_size(const ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_RETURN:
+            return 1 + expression_size(stmt->as.return_stmt.value);
+        case STMT_EXPR:
+            return 1 + expression_size(stmt->as.expr_stmt.expr);
+        case STMT_VAR_DECL:
+            return 1 + expression_size(stmt->as.var_decl_stmt.var_decl.initializer);
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            int size = 1 + expression_size(if_stmt->condition) + block_size(&if_stmt->then_body);
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                size += expression_size(clause->condition) + block_size(&clause->body);
+            }
+            if (if_stmt->else_body) size += block_size(if_stmt->else_body);
+            return size;
+        }
+        case STMT_WHILE:
+            return 1 + expression_size(stmt->as.while_stmt.condition) + block_size(&stmt->as.while_stmt.body);
+        case STMT_FOR: {
+            const ASTForStmt* for_stmt = &stmt->as.for_stmt;
+            return 1 + (for_stmt->init ? statement_size(for_stmt->init) : 0) +
+                   expression_size(for_stmt->condition) + expression_size(for_stmt->update) +
+                   block_size(&for_stmt->body);
+        }
+        case STMT_BLOCK:
+            return block_size(&stmt->as.block_stmt.block);
+        case STMT_DBG: {
+            int size = 1;
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                size += expression_size(&stmt->as.dbg_stmt.arguments[i]);
+            }
+            return size;
+        }
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            return 1;
+    }
+    return 1;
+}
+
+static int block_size(const ASTBlock* block) {
+    int size = 0;
+    for (int i = 0; i < block->statement_count; i++) {
+        size += statement_size(&block->statements[i]);
+    }
+    return size;
+}
+
+/* ===== Loop shape ===== */
+
+/* Helper: Values a loop counter type can hold (0 if not a counter type) */
+static int counter_limits(CasmType type, long long* min, long long* max) {
+    switch (type) {
+        case TYPE_I32: *min = INT_MIN; *max = INT_MAX; return 1;
+        case TYPE_U32: *min = 0; *max = UINT_MAX; return 1;
+        case TYPE_I64: *min = LLONG_MIN; *max = LLONG_MAX; return 1;
+        default: return 0;
+    }
+}
+
+static int is_variable(const ASTExpression* expr, const char* name) {
+    return expr && expr->type == EXPR_VARIABLE && strcmp(expr->as.variable.name, name) == 0;
+}
+
+/* Helper: Check if an expression assigns to a variable */
+static int expression_writes(const ASTExpression* expr, const char* name) {
+    if (!expr) return 0;
+    switch (expr->type) {
+        case EXPR_BINARY_OP:
+            if (expr->as.binary_op.op == BINOP_ASSIGN && is_variable(expr->as.binary_op.left, name)) {
+                return 1;
+            }
+            return expression_writes(expr->as.binary_op.left, name) ||
+                   expression_writes(expr->as.binary_op.right, name);
+        case EXPR_UNARY_OP:
+            return expression_writes(expr->as.unary_op.operand, name);
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                if (expression_writes(&expr->as.function_call.arguments[i], name)) return 1;
+            }
+            return 0;
+        case EXPR_INDEX:
+            return expression_writes(expr->as.index.index, name);
+        default:
+            return 0;
+    }
+}
+
+static int block_writes(const ASTBlock* block, const char* name);
+
+/* Helper: Check if a statement assigns or declares a variable (a
+ * declaration would shadow it, which copies cannot be checked against) */
+static int statement_writes(const ASTStatement* stmt, const char* name) {
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            return strcmp(stmt->as.var_decl_stmt.var_decl.name, name) == 0 ||
+                   expression_writes(stmt->as.var_decl_stmt.var_decl.initializer, name);
+        case STMT_EXPR:
+            return expression_writes(stmt->as.expr_stmt.expr, name);
+        case STMT_RETURN:
+            return expression_writes(stmt->as.return_stmt.value, name);
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                if (expression_writes(&stmt->as.dbg_stmt.arguments[i], name)) return 1;
+            }
+            return 0;
+        case STMT_IF: {
+            const ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            if (expression_writes(if_stmt->condition, name) || block_writes(&if_stmt->then_body, name)) {
+                return 1;
+            }
+            for (const ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                if (expression_writes(clause->condition, name) || block_writes(&clause->body, name)) return 1;
+            }
+            return if_stmt->else_body && block_writes(if_stmt->else_body, name);
+        }
+        case STMT_WHILE:
+            return expression_writes(stmt->as.while_stmt.condition, name) ||
+                   block_writes(&stmt->as.while_stmt.body, name);
+        case STMT_FOR: {
+            const ASTForStmt* for_stmt = &stmt->as.for_stmt;
+            return (for_stmt->init && statement_writes(for_stmt->init, name)) ||
+                   expression_writes(for_stmt->condition, name) ||
+                   expression_writes(for_stmt->update, name) ||
+                   block_writes(&for_stmt->body, name);
+        }
+        case STMT_BLOCK:
+            return block_writes(&stmt->as.block_stmt.block, name);
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            return 0;
+    }
+    return 1;
+}
+
+static int block_writes(const ASTBlock* block, const char* name) {
+    for (int i = 0; i < block->statement_count; i++) {
+        if (statement_writes(&block->statements[i], name)) return 1;
+    }
+    return 0;
+}
+
+/* Helper: Recognize `for (T i = start; i op bound; i = i +/- step)` */
+static int match_counted_loop(const ASTForStmt* loop, CountedLoop* out) {
+    long long min, max;
+    if (!loop->init || loop->init->type != STMT_VAR_DECL || !loop->condition || !loop->update) return 0;
+    const ASTVarDecl* decl = &loop->init->as.var_decl_stmt.var_decl;
+    if (!decl->initializer || !counter_limits(decl->type.type, &min, &max)) return 0;
+
+    const ASTExpression* cond = loop->condition;
+    if (cond->type != EXPR_BINARY_OP || !is_variable(cond->as.binary_op.left, decl->name)) return 0;
+    BinaryOpType op = cond->as.binary_op.op;
+    if (op != BINOP_LT && op != BINOP_LE && op != BINOP_GT && op != BINOP_GE) return 0;
+    ASTExpression* bound = cond->as.binary_op.right;
+    if (bound->type == EXPR_VARIABLE) {
+        if (!counter_limits(bound->resolved_type, &min, &max)) return 0;
+        if (strcmp(bound->as.variable.name, decl->name) == 0) return 0;
+        if (block_writes(&loop->body, bound->as.variable.name)) return 0;
+    } else if (bound->type != EXPR_LITERAL || bound->as.literal.type != LITERAL_INT) {
+        return 0;
+    }
+
+    const ASTExpression* update = loop->update;
+    if (update->type != EXPR_BINARY_OP || update->as.binary_op.op != BINOP_ASSIGN ||
+        !is_variable(update->as.binary_op.left, decl->name)) {
+        return 0;
+    }
+    const ASTExpression* next = update->as.binary_op.right;
+    if (next->type != EXPR_BINARY_OP || !is_variable(next->as.binary_op.left, decl->name)) return 0;
+    const ASTExpression* step = next->as.binary_op.right;
+    if (step->type != EXPR_LITERAL || step->as.literal.type != LITERAL_INT) return 0;
+    long long amount = step->as.literal.value.int_value;
+    if (amount <= 0 || amount > INT_MAX) return 0;
+
+    int up = op == BINOP_LT || op == BINOP_LE;
+    if (next->as.binary_op.op == BINOP_ADD && up) {
+        out->step = amount;
+    } else if (next->as.binary_op.op == BINOP_SUB && !up) {
+        out->step = -amount;
+    } else {
+        return 0;
+    }
+
+    if (block_writes(&loop->body, decl->name)) return 0;
+    /* Copies are spliced without the loop around them */
+    if (ast_block_exits_loop(&loop->body, STMT_BREAK) || ast_block_exits_loop(&loop->body, STMT_CONTINUE)) {
+        return 0;
+    }
+    out->counter = decl->name;
+    out->type = decl->type.type;
+    out->bound = bound;
+    return 1;
+}
+
+/* Helper: Trip count of a loop with known start and bound, or -1 if the
+ * counter would leave its type on the way out */
+static long long trip_count(const CountedLoop* loop, BinaryOpType op, long long start, long long bound) {
+    long long min, max;
+    if (!counter_limits(loop->type, &min, &max)) return -1;
+    /* Keep the arithmetic below well inside long long */
+    if (start < -(1LL << 62) || start > (1LL << 62) || bound < -(1LL << 62) || bound > (1LL << 62)) {
+        return -1;
+    }
+
+    long long step = loop->step > 0 ? loop->step : -loop->step;
+    long long distance = loop->step > 0 ? bound - start : start - bound;
+    long long trips;
+    if (op == BINOP_LT || op == BINOP_GT) {
+        trips = distance > 0 ? (distance + step - 1) / step : 0;
+    } else {
+        trips = distance >= 0 ? distance / step + 1 : 0;
+    }
+
+    long long exit_value = start + trips * loop->step;
+    if (exit_value < min || exit_value > max) return -1;
+    return trips;
+}
+
+/* ===== Rewriting ===== */
+
+static void substitute_block(ASTBlock* block, const char* name, long long value, CasmType type);
+
+/* Helper: Replace reads of a variable with a literal */
+static void substitute_expression(ASTExpression* expr, const char* name, long long value, CasmType type) {
+    if (!expr) return;
+    switch (expr->type) {
+        case EXPR_VARIABLE:
+            if (strcmp(expr->as.variable.name, name) == 0) {
+                ast_expression_free_contents(expr);
+                expr->type = EXPR_LITERAL;
+                expr->as.literal.type = LITERAL_INT;
+                expr->as.literal.value.int_value = value;
+                expr->as.literal.location = expr->location;
+                expr->resolved_type = type;
+            }
+            break;
+        case EXPR_BINARY_OP:
+            substitute_expression(expr->as.binary_op.left, name, value, type);
+            substitute_expression(expr->as.binary_op.right, name, value, type);
+            break;
+        case EXPR_UNARY_OP:
+            substitute_expression(expr->as.unary_op.operand, name, value, type);
+            break;
+        case EXPR_FUNCTION_CALL:
+            for (int i = 0; i < expr->as.function_call.argument_count; i++) {
+                substitute_expression(&expr->as.function_call.arguments[i], name, value, type);
+            }
+            break;
+        case EXPR_INDEX:
+            substitute_expression(expr->as.index.index, name, value, type);
+            break;
+        case EXPR_FIELD:
+        case EXPR_LITERAL:
+            break;
+    }
+}
+
+static void substitute_statement(ASTStatement* stmt, const char* name, long long value, CasmType type) {
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            substitute_expression(stmt->as.var_decl_stmt.var_decl.initializer, name, value, type);
+            break;
+        case STMT_EXPR:
+            substitute_expression(stmt->as.expr_stmt.expr, name, value, type);
+            break;
+        case STMT_RETURN:
+            substitute_expression(stmt->as.return_stmt.value, name, value, type);
+            break;
+        case STMT_DBG:
+            for (int i = 0; i < stmt->as.dbg_stmt.argument_count; i++) {
+                substitute_expression(&stmt->as.dbg_stmt.arguments[i], name, value, type);
+            }
+            break;
+        case STMT_IF: {
+            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            substitute_expression(if_stmt->condition, name, value, type);
+            substitute_block(&if_stmt->then_body, name, value, type);
+            for (ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                substitute_expression(clause->condition, name, value, type);
+                substitute_block(&clause->body, name, value, type);
+            }
+            if (if_stmt->else_body) substitute_block(if_stmt->else_body, name, value, type);
+            break;
+        }
+        case STMT_WHILE:
+            substitute_expression(stmt->as.while_stmt.condition, name, value, type);
+            substitute_block(&stmt->as.while_stmt.body, name, value, type);
+            break;
+        case STMT_FOR: {
+            ASTForStmt* for_stmt = &stmt->as.for_stmt;
+            if (for_stmt->init) substitute_statement(for_stmt->init, name, value, type);
+            substitute_expression(for_stmt->condition, name, value, type);
+            substitute_expression(for_stmt->update, name, value, type);
+            substitute_block(&for_stmt->body, name, value, type);
+            break;
+        }
+        case STMT_BLOCK:
+            substitute_block(&stmt->as.block_stmt.block, name, value, type);
+            break;
+        case STMT_BREAK:
+        case STMT_CONTINUE:
+            break;
+    }
+}
+
+static void substitute_block(ASTBlock* block, const char* name, long long value, CasmType type) {
+    for (int i = 0; i < block->statement_count; i++) {
+        substitute_statement(&block->statements[i], name, value, type);
+    }
+}
+
+/* Helper: Make a bare block statement owning `body` */
+static ASTStatement make_block_statement(ASTBlock body, SourceLocation location) {
+    ASTStatement stmt;
+    stmt.type = STMT_BLOCK;
+    stmt.location = location;
+    stmt.as.block_stmt.block = body;
+    stmt.as.block_stmt.location = location;
+    return stmt;
+}
+
+static ASTStatement make_expression_statement(ASTExpression* expr, SourceLocation location) {
+    ASTStatement stmt;
+    stmt.type = STMT_EXPR;
+    stmt.location = location;
+    stmt.as.expr_stmt.expr = expr;
+    stmt.as.expr_stmt.location = location;
+    return stmt;
+}
+
+static ASTStatement make_for_statement(ASTExpression* condition, ASTExpression* update,
+                                       ASTBlock body, SourceLocation location) {
+    ASTStatement stmt;
+    stmt.type = STMT_FOR;
+    stmt.location = location;
+    stmt.as.for_stmt.init = NULL;
+    stmt.as.for_stmt.condition = condition;
+    stmt.as.for_stmt.update = update;
+    stmt.as.for_stmt.body = body;
+    stmt.as.for_stmt.location = location;
+    return stmt;
+}
+
+static ASTExpression* make_int_literal(long long value, CasmType type, SourceLocation location) {
+    ASTExpression* expr = ast_expression_create(EXPR_LITERAL, location);
+    expr->as.literal.type = LITERAL_INT;
+    expr->as.literal.value.int_value = value;
+    expr->as.literal.location = location;
+    expr->resolved_type = type;
+    return expr;
+}
+
+static ASTBlock empty_block(SourceLocation location) {
+    ASTBlock block;
+    block.statements = NULL;
+    block.statement_count = 0;
+    block.location = location;
+    return block;
+}
+
+/* Helper: Append a copy of a loop body to a block. Copies that declare
+ * nothing are spliced in directly so straight-line passes see one run. */
+static void append_copy(ASTBlock* block, ASTBlock copy, SourceLocation location) {
+    for (int i = 0; i < copy.statement_count; i++) {
+        if (copy.statements[i].type == STMT_VAR_DECL) {
+            ast_block_add_statement(block, make_block_statement(copy, location));
+            return;
+        }
+    }
+    for (int i = 0; i < copy.statement_count; i++) {
+        ast_block_add_statement(block, copy.statements[i]);
+    }
+    xfree(copy.statements);
+}
+
+/* Replace the loop with one copy of its body per trip */
+static void unroll_fully(ASTStatement* stmt, const CountedLoop* loop, long long start, long long trips) {
+    ASTForStmt* for_stmt = &stmt->as.for_stmt;
+    ASTBlock copies = empty_block(stmt->location);
+    for (long long k = 0; k < trips; k++) {
+        ASTBlock copy = ast_block_clone(&for_stmt->body);
+        substitute_block(&copy, loop->counter, start + k * loop->step, loop->type);
+        append_copy(&copies, copy, stmt->location);
+    }
+    ast_statement_free_contents(stmt);
+    *stmt = make_block_statement(copies, stmt->location);
+}
+
+/* Run `factor` copies of the body per iteration while at least that many
+ * trips remain; the original loop runs the rest */
+static void unroll_partially(ASTStatement* stmt, const CountedLoop* loop, int factor) {
+    ASTForStmt* for_stmt = &stmt->as.for_stmt;
+    SourceLocation location = stmt->location;
+
+    /* i < bound - (factor - 1) * step, or i > bound + ... counting down */
+    long long shift = (long long)(factor - 1) * loop->step;
+    ASTExpression* limit;
+    if (loop->bound->type == EXPR_LITERAL) {
+        limit = make_int_literal(loop->bound->as.literal.value.int_value - shift,
+                                 loop->bound->resolved_type, location);
+    } else {
+        limit = ast_expression_create(EXPR_BINARY_OP, location);
+        limit->as.binary_op.op = shift > 0 ? BINOP_SUB : BINOP_ADD;
+        limit->as.binary_op.left = ast_expression_clone(loop->bound);
+        limit->as.binary_op.right = make_int_literal(shift > 0 ? shift : -shift,
+                                                     loop->bound->resolved_type, location);
+        limit->as.binary_op.location = location;
+        limit->resolved_type = loop->bound->resolved_type;
+    }
+
+    ASTExpression* guard = ast_expression_create(EXPR_BINARY_OP, location);
+    *guard = *for_stmt->condition;
+    guard->as.binary_op.left = ast_expression_clone(for_stmt->condition->as.binary_op.left);
+    guard->as.binary_op.right = limit;
+
+    ASTBlock body = empty_block(for_stmt->body.location);
+    for (int k = 0; k < factor; k++) {
+        append_copy(&body, ast_block_clone(&for_stmt->body), location);
+        if (k + 1 < factor) {
+            ast_block_add_statement(&body, make_expression_statement(ast_expression_clone(for_stmt->update),
+                                                                     location));
+        }
+    }
+
+    ASTBlock outer = empty_block(location);
+    ast_block_add_statement(&outer, *for_stmt->init);
+    xfree(for_stmt->init);
+    ast_block_add_statement(&outer, make_for_statement(guard, ast_expression_clone(for_stmt->update),
+                                                       body, location));
+    ast_block_add_statement(&outer, make_for_statement(for_stmt->condition, for_stmt->update,
+                                                       for_stmt->body, location));
+    *stmt = make_block_statement(outer, location);
+}
+
+/* Helper: Unroll a for statement if it qualifies. Returns 1 if it did. */
+static int try_unroll(Unroller* u, ASTStatement* stmt) {
+    ASTForStmt* for_stmt = &stmt->as.for_stmt;
+    CountedLoop loop;
+    if (!match_counted_loop(for_stmt, &loop)) return 0;
+
+    long long bound_min, bound_max;
+    if (!range_bounds(u->facts, loop.bound, &bound_min, &bound_max)) return 0;
+
+    BinaryOpType op = for_stmt->condition->as.binary_op.op;
+    int body = block_size(&for_stmt->body);
+    int old_size = statement_size(stmt);
+
+    /* Constant trip count: unroll completely if it is short enough */
+    const ASTExpression* init = for_stmt->init->as.var_decl_stmt.var_decl.initializer;
+    long long trips = -1;
+    if (init->type == EXPR_LITERAL && bound_min == bound_max) {
+        trips = trip_count(&loop, op, init->as.literal.value.int_value, bound_min);
+    }
+    if (trips >= 0 && trips <= UNROLL_FULL_MAX_TRIPS && trips * body <= UNROLL_LOOP_BUDGET &&
+        trips * body - old_size <= u->growth_left) {
+        u->growth_left -= (int)(trips * body) - old_size;
+        unroll_fully(stmt, &loop, init->as.literal.value.int_value, trips);
+        if (u->stats) u->stats->fully_unrolled++;
+        return 1;
+    }
+
+    int copy = body + expression_size(for_stmt->update);
+    int factor = (8 * copy <= UNROLL_LOOP_BUDGET) ? 8 : (4 * copy <= UNROLL_LOOP_BUDGET) ? 4 : 0;
+    if (factor == 0 || factor * copy > u->growth_left) return 0;
+    if (trips >= 0 && trips < 2 * factor) return 0;
+
+    /* The guard's bound - K must not wrap (it is computed in the bound's type) */
+    long long min, max;
+    if (!counter_limits(loop.bound->resolved_type, &min, &max)) return 0;
+    long long slack = (long long)(factor - 1) * (loop.step > 0 ? loop.step : -loop.step);
+    if (loop.step > 0 ? bound_min < min + slack : bound_max > max - slack) return 0;
+
+    u->growth_left -= factor * copy;
+    unroll_partially(stmt, &loop, factor);
+    if (u->stats) u->stats->partially_unrolled++;
+    return 1;
+}
+
+static int unroll_block(Unroller* u, ASTBlock* block);
+
+/* Helper: Unroll the first qualifying loop in or below a statement,
+ * innermost first */
+static int unroll_statement(Unroller* u, ASTStatement* stmt) {
+    switch (stmt->type) {
+        case STMT_IF: {
+            ASTIfStmt* if_stmt = &stmt->as.if_stmt;
+            if (unroll_block(u, &if_stmt->then_body)) return 1;
+            for (ASTElseIfClause* clause = if_stmt->else_if_chain; clause; clause = clause->next) {
+                if (unroll_block(u, &clause->body)) return 1;
+            }
+            return if_stmt->else_body && unroll_block(u, if_stmt->else_body);
+        }
+        case STMT_WHILE:
+            return unroll_block(u, &stmt->as.while_stmt.body);
+        case STMT_FOR:
+            return unroll_block(u, &stmt->as.for_stmt.body) || try_unroll(u, stmt);
+        case STMT_BLOCK:
+            return unroll_block(u, &stmt->as.block_stmt.block);
+        default:
+            return 0;
+    }
+}
+
+static int unroll_block(Unroller* u, ASTBlock* block) {
+    for (int i = 0; i < block->statement_count; i++) {
+        if (unroll_statement(u, &block->statements[i])) return 1;
+    }
+    return 0;
+}
+
+int unroll_loops(ASTProgram* program, UnrollStats* stats) {
+    if (!program) return 0;
+
+    int unrolled = 0;
+    for (int i = 0; i < program->function_count; i++) {
+        ASTFunctionDef* func = &program->functions[i];
+        Unroller u;
+        u.growth_left = UNROLL_FUNCTION_GROWTH;
+        u.stats = stats;
+
+        /* Every rewrite invalidates the facts, so re-analyze per loop */
+        for (int round = 0; round < UNROLL_MAX_ROUNDS; round++) {
+            RangeFacts* facts = range_analyze_function(func);
+            u.facts = facts;
+            int changed = unroll_block(&u, &func->body);
+            range_facts_free(facts);
+            if (!changed) break;
+            unrolled++;
+        }
+    }
+    return unrolled;
+}
@@ -0,0 +1,22 @@
+#ifndef UNROLL_H
+#define UNROLL_H
+
+#include "ast.h"
+
+typedef struct {
+    int fully_unrolled;     /* Loops replaced by one copy of the body per trip */
+    int partially_unrolled; /* Loops given a x4/x8 body and a remainder loop */
+} UnrollStats;
+
+/* Unroll counted loops of the form
+ *     for (T i = start; i < bound; i = i + step) body
+ * (or counting down with > / >=), where T is i32, u32 or i64, `step` is a
+ * literal and neither `i` nor `bound` is written by the body. Loops with a
+ * small constant trip count become straight-line copies of the body with
+ * `i` replaced by its value; others run 4 or 8 copies per iteration while
+ * enough trips remain, then finish in the original loop. Growth is
+ * limited per loop and per function. Returns the number of loops
+ * unrolled; `stats` may be NULL. */
+int unroll_loops(ASTProgram* program, UnrollStats* stats);
+
+#endif /* UNROLL_H */
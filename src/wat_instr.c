@@ -0,0 +1,260 @@
+#include <string.h>
+#include "wat_instr.h"
+#include "utils.h"
+
+/* Helper: Grow a WatLocal array to hold at least one more entry */
+static void ensure_local_capacity(WatLocal** items, int count, int* capacity) {
+    if (count >= *capacity) {
+        *capacity = (*capacity == 0) ? 8 : *capacity * 2;
+        *items = xrealloc(*items, *capacity * sizeof(WatLocal));
+    }
+}
+
+WatFunction* wat_function_create(const char* name) {
+    WatFunction* func = xmalloc(sizeof(WatFunction));
+    memset(func, 0, sizeof(WatFunction));
+    func->name = xstrdup(name);
+    return func;
+}
+
+void wat_function_free(WatFunction* func) {
+    if (!func) return;
+
+    for (int i = 0; i < func->param_count; i++) {
+        xfree(func->params[i].name);
+    }
+    xfree(func->params);
+
+    for (int i = 0; i < func->local_count; i++) {
+        xfree(func->locals[i].name);
+    }
+    xfree(func->locals);
+
+    for (int i = 0; i < func->instr_count; i++) {
+        xfree(func->instrs[i].name);
+    }
+    xfree(func->instrs);
+
+    xfree(func->name);
+    xfree(func);
+}
+
+void wat_function_add_param(WatFunction* func, const char* name, WatValType type) {
+    ensure_local_capacity(&func->params, func->param_count, &func->param_capacity);
+    func->params[func->param_count].name = xstrdup(name);
+    func->params[func->param_count].type = type;
+    func->param_count++;
+}
+
+void wat_function_set_result(WatFunction* func, WatValType type) {
+    func->has_result = 1;
+    func->result_type = type;
+}
+
+int wat_function_local_type(const WatFunction* func, const char* name, WatValType* out_type) {
+    for (int i = 0; i < func->param_count; i++) {
+        if (strcmp(func->params[i].name, name) == 0) {
+            if (out_type) *out_type = func->params[i].type;
+            return 1;
+        }
+    }
+    for (int i = 0; i < func->local_count; i++) {
+        if (strcmp(func->locals[i].name, name) == 0) {
+            if (out_type) *out_type = func->locals[i].type;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int wat_function_add_local(WatFunction* func, const char* name, WatValType type) {
+    if (wat_function_local_type(func, name, NULL)) {
+        return 0;
+    }
+    ensure_local_capacity(&func->locals, func->local_count, &func->local_capacity);
+    func->locals[func->local_count].name = xstrdup(name);
+    func->locals[func->local_count].type = type;
+    func->local_count++;
+    return 1;
+}
+
+/* Helper: Append a zeroed instruction and return it */
+static WatInstr* push_instr(WatFunction* func, WatOpcode op, WatValType type) {
+    if (func->instr_count >= func->instr_capacity) {
+        func->instr_capacity = (func->instr_capacity == 0) ? 64 : func->instr_capacity * 2;
+        func->instrs = xrealloc(func->instrs, func->instr_capacity * sizeof(WatInstr));
+    }
+    WatInstr* instr = &func->instrs[func->instr_count++];
+    instr->op = op;
+    instr->type = type;
+    instr->value = 0;
+    instr->name = NULL;
+    return instr;
+}
+
+void wat_emit(WatFunction* func, WatOpcode op, WatValType type) {
+    push_instr(func, op, type);
+}
+
+void wat_emit_const(WatFunction* func, WatValType type, long long value) {
+    WatInstr* instr = push_instr(func, WAT_OP_CONST, type);
+    /* Keep i32 immediates in canonical signed 32-bit form */
+    instr->value = (type == WAT_TYPE_I32) ? (long long)(int)(unsigned int)value : value;
+}
+
+void wat_emit_named(WatFunction* func, WatOpcode op, const char* name) {
+    WatInstr* instr = push_instr(func, op, WAT_TYPE_I32);
+    instr->name = name ? xstrdup(name) : NULL;
+}
+
+void wat_emit_store(WatFunction* func, WatValType type, long long offset) {
+    wat_emit_memory(func, WAT_OP_STORE, type, offset);
+}
+
+void wat_emit_memory(WatFunction* func, WatOpcode op, WatValType type, long long offset) {
+    WatInstr* instr = push_instr(func, op, type);
+    instr->value = offset;
+}
+
+/* Mnemonics for memory opcodes, indexed by [op - WAT_OP_STORE][type] */
+static const char* const g_memory_mnemonics[][2] = {
+    { "i32.store",    "i64.store" },
+    { "i32.store8",   "i64.store8" },
+    { "i32.store16",  "i64.store16" },
+    { "i32.store",    "i64.store32" },
+    { "i32.load",     "i64.load" },
+    { "i32.load8_s",  "i64.load8_s" },
+    { "i32.load8_u",  "i64.load8_u" },
+    { "i32.load16_s", "i64.load16_s" },
+    { "i32.load16_u", "i64.load16_u" },
+    { "i32.load",     "i64.load32_s" },
+    { "i32.load",     "i64.load32_u" }
+};
+
+/* Mnemonics for typed numeric opcodes, indexed by [op - WAT_OP_ADD][type] */
+static const char* const g_numeric_mnemonics[][2] = {
+    { "i32.add",   "i64.add" },
+    { "i32.sub",   "i64.sub" },
+    { "i32.mul",   "i64.mul" },
+    { "i32.div_s", "i64.div_s" },
+    { "i32.div_u", "i64.div_u" },
+    { "i32.rem_s", "i64.rem_s" },
+    { "i32.rem_u", "i64.rem_u" },
+    { "i32.and",   "i64.and" },
+    { "i32.or",    "i64.or" },
+    { "i32.xor",   "i64.xor" },
+    { "i32.shl",   "i64.shl" },
+    { "i32.shr_s", "i64.shr_s" },
+    { "i32.shr_u", "i64.shr_u" },
+    { "i32.rotl",  "i64.rotl" },
+    { "i32.rotr",  "i64.rotr" },
+    { "i32.clz",   "i64.clz" },
+    { "i32.ctz",   "i64.ctz" },
+    { "i32.popcnt", "i64.popcnt" },
+    { "i32.eqz",   "i64.eqz" },
+    { "i32.eq",    "i64.eq" },
+    { "i32.ne",    "i64.ne" },
+    { "i32.lt_s",  "i64.lt_s" },
+    { "i32.lt_u",  "i64.lt_u" },
+    { "i32.gt_s",  "i64.gt_s" },
+    { "i32.gt_u",  "i64.gt_u" },
+    { "i32.le_s",  "i64.le_s" },
+    { "i32.le_u",  "i64.le_u" },
+    { "i32.ge_s",  "i64.ge_s" },
+    { "i32.ge_u",  "i64.ge_u" }
+};
+
+const char* wat_instr_mnemonic(const WatInstr* instr) {
+    switch (instr->op) {
+        case WAT_OP_CONST:       return instr->type == WAT_TYPE_I64 ? "i64.const" : "i32.const";
+        case WAT_OP_LOCAL_GET:   return "local.get";
+        case WAT_OP_LOCAL_SET:   return "local.set";
+        case WAT_OP_LOCAL_TEE:   return "local.tee";
+        case WAT_OP_GLOBAL_GET:  return "global.get";
+        case WAT_OP_GLOBAL_SET:  return "global.set";
+        case WAT_OP_BLOCK:       return "block";
+        case WAT_OP_LOOP:        return "loop";
+        case WAT_OP_IF:          return "if";
+        case WAT_OP_ELSE:        return "else";
+        case WAT_OP_END:         return "end";
+        case WAT_OP_BR:          return "br";
+        case WAT_OP_BR_IF:       return "br_if";
+        case WAT_OP_RETURN:      return "return";
+        case WAT_OP_CALL:        return "call";
+        case WAT_OP_RETURN_CALL: return "return_call";
+        case WAT_OP_DROP:        return "drop";
+        case WAT_OP_UNREACHABLE: return "unreachable";
+        case WAT_OP_I32_WRAP_I64:     return "i32.wrap_i64";
+        case WAT_OP_I64_EXTEND_I32_S: return "i64.extend_i32_s";
+        case WAT_OP_I64_EXTEND_I32_U: return "i64.extend_i32_u";
+        default:
+            break;
+    }
+    if (instr->op >= WAT_OP_STORE && instr->op <= WAT_OP_LOAD32_U) {
+        return g_memory_mnemonics[instr->op - WAT_OP_STORE][instr->type == WAT_TYPE_I64 ? 1 : 0];
+    }
+    if (instr->op >= WAT_OP_ADD && instr->op <= WAT_OP_GE_U) {
+        return g_numeric_mnemonics[instr->op - WAT_OP_ADD][instr->type == WAT_TYPE_I64 ? 1 : 0];
+    }
+    return "unreachable";
+}
+
+/* Helper: Append a " (kind $name type)" declaration */
+static void append_decl(OutputSink* buf, const char* kind, const WatLocal* local) {
+    output_sink_append(buf, " (");
+    output_sink_append(buf, kind);
+    output_sink_append(buf, " $");
+    output_sink_append(buf, local->name);
+    output_sink_append(buf, local->type == WAT_TYPE_I64 ? " i64)" : " i32)");
+}
+
+void wat_function_serialize(const WatFunction* func, OutputSink* buf, int indent) {
+    output_sink_append_spaces(buf, indent * 2);
+    output_sink_append(buf, "(func $");
+    output_sink_append(buf, func->name);
+    for (int i = 0; i < func->param_count; i++) {
+        append_decl(buf, "param", &func->params[i]);
+    }
+    if (func->has_result) {
+        output_sink_append(buf, func->result_type == WAT_TYPE_I64 ? " (result i64)" : " (result i32)");
+    }
+    for (int i = 0; i < func->local_count; i++) {
+        append_decl(buf, "local", &func->locals[i]);
+    }
+    output_sink_append(buf, "\n");
+
+    int depth = indent + 1;
+    for (int i = 0; i < func->instr_count; i++) {
+        const WatInstr* instr = &func->instrs[i];
+
+        /* else/end close the current nesting level */
+        if (instr->op == WAT_OP_ELSE || instr->op == WAT_OP_END) {
+            if (depth > indent + 1) depth--;
+        }
+
+        output_sink_append_spaces(buf, depth * 2);
+        output_sink_append(buf, wat_instr_mnemonic(instr));
+
+        if (instr->op == WAT_OP_CONST) {
+            output_sink_append(buf, " ");
+            output_sink_append_int(buf, instr->value);
+        } else if (instr->op >= WAT_OP_STORE && instr->op <= WAT_OP_LOAD32_U) {
+            if (instr->value != 0) {
+                output_sink_append(buf, " offset=");
+                output_sink_append_int(buf, instr->value);
+            }
+        } else if (instr->name) {
+            output_sink_append(buf, " $");
+            output_sink_append(buf, instr->name);
+        }
+        output_sink_append(buf, "\n");
+
+        if (instr->op == WAT_OP_BLOCK || instr->op == WAT_OP_LOOP ||
+            instr->op == WAT_OP_IF || instr->op == WAT_OP_ELSE) {
+            depth++;
+        }
+    }
+
+    output_sink_append_spaces(buf, indent * 2);
+    output_sink_append(buf, ")\n");
+}
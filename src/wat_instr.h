@@ -0,0 +1,152 @@
+#ifndef WAT_INSTR_H
+#define WAT_INSTR_H
+
+#include "output_sink.h"
+
+/* In-memory WebAssembly instruction lists.
+ *
+ * The WAT backend lowers each function into a flat list of WatInstr
+ * (opcode + immediates) instead of printing text directly. The lists can
+ * be inspected or rewritten by later passes and are serialized to WAT
+ * text in one go. */
+
+/* WebAssembly value types used by CASM */
+typedef enum {
+    WAT_TYPE_I32,
+    WAT_TYPE_I64
+} WatValType;
+
+/* Opcodes. Numeric opcodes are typed by WatInstr.type (i32 or i64). */
+typedef enum {
+    /* Constants and locals */
+    WAT_OP_CONST,           /* value */
+    WAT_OP_LOCAL_GET,       /* name */
+    WAT_OP_LOCAL_SET,       /* name */
+    WAT_OP_LOCAL_TEE,       /* name */
+    WAT_OP_GLOBAL_GET,      /* name */
+    WAT_OP_GLOBAL_SET,      /* name */
+
+    /* Memory (value = static offset). The 32-bit forms are i64 only. */
+    WAT_OP_STORE,
+    WAT_OP_STORE8,
+    WAT_OP_STORE16,
+    WAT_OP_STORE32,
+    WAT_OP_LOAD,
+    WAT_OP_LOAD8_S,
+    WAT_OP_LOAD8_U,
+    WAT_OP_LOAD16_S,
+    WAT_OP_LOAD16_U,
+    WAT_OP_LOAD32_S,
+    WAT_OP_LOAD32_U,
+
+    /* Control flow */
+    WAT_OP_BLOCK,           /* name = label (may be NULL) */
+    WAT_OP_LOOP,            /* name = label (may be NULL) */
+    WAT_OP_IF,
+    WAT_OP_ELSE,
+    WAT_OP_END,
+    WAT_OP_BR,              /* name = label */
+    WAT_OP_BR_IF,           /* name = label */
+    WAT_OP_RETURN,
+    WAT_OP_CALL,            /* name = function */
+    WAT_OP_RETURN_CALL,     /* name = function (tail-call proposal) */
+    WAT_OP_DROP,
+    WAT_OP_UNREACHABLE,
+
+    /* Arithmetic and logic */
+    WAT_OP_ADD,
+    WAT_OP_SUB,
+    WAT_OP_MUL,
+    WAT_OP_DIV_S,
+    WAT_OP_DIV_U,
+    WAT_OP_REM_S,
+    WAT_OP_REM_U,
+    WAT_OP_AND,
+    WAT_OP_OR,
+    WAT_OP_XOR,
+    WAT_OP_SHL,
+    WAT_OP_SHR_S,
+    WAT_OP_SHR_U,
+    WAT_OP_ROTL,
+    WAT_OP_ROTR,
+    WAT_OP_CLZ,             /* unary */
+    WAT_OP_CTZ,             /* unary */
+    WAT_OP_POPCNT,          /* unary */
+
+    /* Comparisons (always produce i32) */
+    WAT_OP_EQZ,
+    WAT_OP_EQ,
+    WAT_OP_NE,
+    WAT_OP_LT_S,
+    WAT_OP_LT_U,
+    WAT_OP_GT_S,
+    WAT_OP_GT_U,
+    WAT_OP_LE_S,
+    WAT_OP_LE_U,
+    WAT_OP_GE_S,
+    WAT_OP_GE_U,
+
+    /* Conversions (type field is ignored) */
+    WAT_OP_I32_WRAP_I64,
+    WAT_OP_I64_EXTEND_I32_S,
+    WAT_OP_I64_EXTEND_I32_U
+} WatOpcode;
+
+/* A single instruction */
+typedef struct {
+    WatOpcode op;
+    WatValType type;    /* Operand type for numeric ops and constants */
+    long long value;    /* Immediate for WAT_OP_CONST, offset for memory ops */
+    char* name;         /* Local, label or function immediate (owned, may be NULL) */
+} WatInstr;
+
+/* A named, typed parameter or local */
+typedef struct {
+    char* name;
+    WatValType type;
+} WatLocal;
+
+/* A function: signature, locals and body instruction list */
+typedef struct {
+    char* name;             /* Function name without the leading '$' */
+    WatLocal* params;
+    int param_count;
+    int param_capacity;
+    WatLocal* locals;
+    int local_count;
+    int local_capacity;
+    int has_result;         /* 1 if the function returns a value */
+    WatValType result_type;
+    WatInstr* instrs;
+    int instr_count;
+    int instr_capacity;
+} WatFunction;
+
+/* Function construction */
+WatFunction* wat_function_create(const char* name);
+void wat_function_free(WatFunction* func);
+void wat_function_add_param(WatFunction* func, const char* name, WatValType type);
+void wat_function_set_result(WatFunction* func, WatValType type);
+
+/* Declare a local. Returns 1 if added, 0 if a param or local of that name
+ * already exists. */
+int wat_function_add_local(WatFunction* func, const char* name, WatValType type);
+
+/* Look up the type of a param or local. Returns 1 and sets *out_type if found. */
+int wat_function_local_type(const WatFunction* func, const char* name, WatValType* out_type);
+
+/* Instruction emission */
+void wat_emit(WatFunction* func, WatOpcode op, WatValType type);
+void wat_emit_const(WatFunction* func, WatValType type, long long value);
+void wat_emit_named(WatFunction* func, WatOpcode op, const char* name);
+void wat_emit_store(WatFunction* func, WatValType type, long long offset);
+void wat_emit_memory(WatFunction* func, WatOpcode op, WatValType type, long long offset);
+
+/* Textual name of an instruction, e.g. "i64.add" or "local.get" */
+const char* wat_instr_mnemonic(const WatInstr* instr);
+
+/* Serialize a function definition as WAT text at the given indent level
+ * (2 spaces per level). Body instructions are nested one level deeper. */
+void wat_function_serialize(const WatFunction* func, OutputSink* buf, int indent);
+
+#endif /* WAT_INSTR_H */
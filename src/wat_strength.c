@@ -0,0 +1,302 @@
+#include <stdint.h>
+#include "wat_strength.h"
+#include "utils.h"
+
+#define SCRATCH_X_I32 "__sr_x_i32"
+#define SCRATCH_Q_I32 "__sr_q_i32"
+#define SCRATCH_X_I64 "__sr_x_i64"
+
+/* Reciprocal for unsigned 32-bit division (Hacker's Delight, magicu2).
+ * q = (x * (add ? 2^32 + multiplier : multiplier)) >> (32 + shift) */
+typedef struct {
+    uint32_t multiplier;
+    int add;
+    int shift;
+} UnsignedMagic;
+
+/* Reciprocal for signed 32-bit division (Hacker's Delight, magic).
+ * q = mulhs(x, multiplier), adjusted by x, then >> shift, then rounded
+ * towards zero */
+typedef struct {
+    int32_t multiplier;
+    int shift;
+} SignedMagic;
+
+/* Helper: k if value == 2^k, else -1 */
+static int exact_log2(uint64_t value) {
+    if (value == 0 || (value & (value - 1)) != 0) return -1;
+    int k = 0;
+    while (value > 1) {
+        value >>= 1;
+        k++;
+    }
+    return k;
+}
+
+/* Helper: Unsigned magic number for 2 <= d < 2^31, d not a power of two */
+static UnsignedMagic unsigned_magic(uint32_t d) {
+    UnsignedMagic magic;
+    uint32_t p32 = 0;
+    uint32_t q = 0x7FFFFFFFu / d;
+    uint32_t r = 0x7FFFFFFFu - q * d;
+    uint32_t delta;
+    int p = 31;
+
+    magic.add = 0;
+    do {
+        p++;
+        p32 = (p == 32) ? 1 : 2 * p32;
+        if (r + 1 >= d - r) {
+            if (q >= 0x7FFFFFFFu) magic.add = 1;
+            q = 2 * q + 1;
+            r = 2 * r + 1 - d;
+        } else {
+            if (q >= 0x80000000u) magic.add = 1;
+            q = 2 * q;
+            r = 2 * r + 1;
+        }
+        delta = d - 1 - r;
+    } while (p < 64 && p32 < delta);
+
+    magic.multiplier = q + 1;
+    magic.shift = p - 32;
+    return magic;
+}
+
+/* Helper: Signed magic number for d outside {-1, 0, 1, INT32_MIN} */
+static SignedMagic signed_magic(int32_t d) {
+    const uint32_t two31 = 0x80000000u;
+    uint32_t ad = d < 0 ? (uint32_t)(-(int64_t)d) : (uint32_t)d;
+    uint32_t t = two31 + ((uint32_t)d >> 31);
+    uint32_t anc = t - 1 - t % ad;
+    uint32_t q1 = two31 / anc;
+    uint32_t r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad;
+    uint32_t r2 = two31 - q2 * ad;
+    uint32_t delta;
+    int p = 31;
+
+    do {
+        p++;
+        q1 = 2 * q1;
+        r1 = 2 * r1;
+        if (r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 = 2 * q2;
+        r2 = 2 * r2;
+        if (r2 >= ad) {
+            q2++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    SignedMagic magic;
+    magic.multiplier = (int32_t)(q2 + 1);
+    if (d < 0) magic.multiplier = (int32_t)(0u - (uint32_t)magic.multiplier);
+    magic.shift = p - 32;
+    return magic;
+}
+
+/* Helper: Emit `op` with an immediate right operand */
+static void emit_with_const(WatFunction* func, WatOpcode op, WatValType type, long long value) {
+    wat_emit_const(func, type, value);
+    wat_emit(func, op, type);
+}
+
+/* Helper: Emit x / 2^k (signed, truncating) with x in `scratch` */
+static void emit_signed_pow2_quotient(WatFunction* func, WatValType type, const char* scratch, int k) {
+    int bits = (type == WAT_TYPE_I64) ? 64 : 32;
+    /* Negative dividends get 2^k - 1 added first */
+    wat_emit_named(func, WAT_OP_LOCAL_GET, scratch);
+    wat_emit_named(func, WAT_OP_LOCAL_GET, scratch);
+    emit_with_const(func, WAT_OP_SHR_S, type, bits - 1);
+    emit_with_const(func, WAT_OP_SHR_U, type, bits - k);
+    wat_emit(func, WAT_OP_ADD, type);
+    emit_with_const(func, WAT_OP_SHR_S, type, k);
+}
+
+/* Helper: Emit the unsigned 32-bit quotient of the x in SCRATCH_X_I32 by
+ * a divisor that is not a power of two */
+static void emit_unsigned_quotient(WatFunction* func, uint32_t d) {
+    if (d > 0x80000000u) {
+        /* The quotient can only be 0 or 1 */
+        wat_emit_named(func, WAT_OP_LOCAL_GET, SCRATCH_X_I32);
+        emit_with_const(func, WAT_OP_GE_U, WAT_TYPE_I32, (long long)d);
+        return;
+    }
+
+    UnsignedMagic magic = unsigned_magic(d);
+    wat_emit_named(func, WAT_OP_LOCAL_GET, SCRATCH_X_I32);
+    wat_emit(func, WAT_OP_I64_EXTEND_I32_U, WAT_TYPE_I64);
+    emit_with_const(func, WAT_OP_MUL, WAT_TYPE_I64, (long long)magic.multiplier);
+    if (!magic.add) {
+        emit_with_const(func, WAT_OP_SHR_U, WAT_TYPE_I64, 32 + magic.shift);
+    } else {
+        /* 33-bit multiplier: add the 2^32 * x part after taking the high half */
+        emit_with_const(func, WAT_OP_SHR_U, WAT_TYPE_I64, 32);
+        wat_emit_named(func, WAT_OP_LOCAL_GET, SCRATCH_X_I32);
+        wat_emit(func, WAT_OP_I64_EXTEND_I32_U, WAT_TYPE_I64);
+        wat_emit(func, WAT_OP_ADD, WAT_TYPE_I64);
+        emit_with_const(func, WAT_OP_SHR_U, WAT_TYPE_I64, magic.shift);
+    }
+    wat_emit(func, WAT_OP_I32_WRAP_I64, WAT_TYPE_I32);
+}
+
+/* Helper: Emit the signed 32-bit quotient of the x in SCRATCH_X_I32 */
+static void emit_signed_quotient(WatFunction* func, int32_t d) {
+    SignedMagic magic = signed_magic(d);
+
+    /* High half of the 64-bit product */
+    wat_emit_named(func, WAT_OP_LOCAL_GET, SCRATCH_X_I32);
+    wat_emit(func, WAT_OP_I64_EXTEND_I32_S, WAT_TYPE_I64);
+    emit_with_const(func, WAT_OP_MUL, WAT_TYPE_I64, (long long)magic.multiplier);
+    emit_with_const(func, WAT_OP_SHR_S, WAT_TYPE_I64, 32);
+    wat_emit(func, WAT_OP_I32_WRAP_I64, WAT_TYPE_I32);
+
+    if (d > 0 && magic.multiplier < 0) {
+        wat_emit_named(func, WAT_OP_LOCAL_GET, SCRATCH_X_I32);
+        wat_emit(func, WAT_OP_ADD, WAT_TYPE_I32);
+    } else if (d < 0 && magic.multiplier > 0) {
+        wat_emit_named(func, WAT_OP_LOCAL_GET, SCRATCH_X_I32);
+        wat_emit(func, WAT_OP_SUB, WAT_TYPE_I32);
+    }
+    if (magic.shift > 0) {
+        emit_with_const(func, WAT_OP_SHR_S, WAT_TYPE_I32, magic.shift);
+    }
+
+    /* Round towards zero: add one if the quotient is negative */
+    wat_emit_named(func, WAT_OP_LOCAL_TEE, SCRATCH_Q_I32);
+    wat_emit_named(func, WAT_OP_LOCAL_GET, SCRATCH_Q_I32);
+    emit_with_const(func, WAT_OP_SHR_U, WAT_TYPE_I32, 31);
+    wat_emit(func, WAT_OP_ADD, WAT_TYPE_I32);
+}
+
+/* Helper: Emit a cheaper equivalent of `<x on stack> <const> <op>`.
+ * Returns 0 (emitting nothing) if there is none. */
+static int emit_reduced(WatFunction* func, WatOpcode op, WatValType type, long long immediate) {
+    int is64 = (type == WAT_TYPE_I64);
+    int bits = is64 ? 64 : 32;
+    uint64_t unsigned_value = is64 ? (uint64_t)immediate : (uint64_t)(uint32_t)immediate;
+    int64_t signed_value = is64 ? (int64_t)immediate : (int64_t)(int32_t)immediate;
+    const char* scratch = is64 ? SCRATCH_X_I64 : SCRATCH_X_I32;
+    int k;
+
+    switch (op) {
+        case WAT_OP_MUL:
+            k = exact_log2(unsigned_value);
+            if (k < 1) return 0;
+            emit_with_const(func, WAT_OP_SHL, type, k);
+            return 1;
+
+        case WAT_OP_DIV_U:
+        case WAT_OP_REM_U:
+            k = exact_log2(unsigned_value);
+            if (k == 0 || unsigned_value == 0) return 0;
+            if (k > 0) {
+                if (op == WAT_OP_DIV_U) {
+                    emit_with_const(func, WAT_OP_SHR_U, type, k);
+                } else {
+                    emit_with_const(func, WAT_OP_AND, type, (long long)(unsigned_value - 1));
+                }
+                return 1;
+            }
+            if (is64) return 0;
+            wat_function_add_local(func, SCRATCH_X_I32, WAT_TYPE_I32);
+            wat_emit_named(func, WAT_OP_LOCAL_SET, SCRATCH_X_I32);
+            if (op == WAT_OP_REM_U) {
+                wat_emit_named(func, WAT_OP_LOCAL_GET, SCRATCH_X_I32);
+            }
+            emit_unsigned_quotient(func, (uint32_t)unsigned_value);
+            if (op == WAT_OP_REM_U) {
+                emit_with_const(func, WAT_OP_MUL, WAT_TYPE_I32, (long long)unsigned_value);
+                wat_emit(func, WAT_OP_SUB, WAT_TYPE_I32);
+            }
+            return 1;
+
+        case WAT_OP_DIV_S:
+        case WAT_OP_REM_S: {
+            if (signed_value == INT64_MIN) return 0;
+            /* The remainder takes the dividend's sign, so only |d| matters */
+            int64_t magnitude = (op == WAT_OP_REM_S && signed_value < 0) ? -signed_value : signed_value;
+            k = (magnitude > 0) ? exact_log2((uint64_t)magnitude) : -1;
+            if (k >= 1 && k <= bits - 2) {
+                wat_function_add_local(func, scratch, type);
+                wat_emit_named(func, WAT_OP_LOCAL_SET, scratch);
+                if (op == WAT_OP_DIV_S) {
+                    emit_signed_pow2_quotient(func, type, scratch, k);
+                } else {
+                    /* x - (x rounded towards zero to a multiple of 2^k) */
+                    wat_emit_named(func, WAT_OP_LOCAL_GET, scratch);
+                    wat_emit_named(func, WAT_OP_LOCAL_GET, scratch);
+                    wat_emit_named(func, WAT_OP_LOCAL_GET, scratch);
+                    emit_with_const(func, WAT_OP_SHR_S, type, bits - 1);
+                    emit_with_const(func, WAT_OP_SHR_U, type, bits - k);
+                    wat_emit(func, WAT_OP_ADD, type);
+                    emit_with_const(func, WAT_OP_AND, type, -magnitude);
+                    wat_emit(func, WAT_OP_SUB, type);
+                }
+                return 1;
+            }
+            if (is64 || signed_value == 0 || signed_value == 1 || signed_value == -1 ||
+                signed_value == INT32_MIN) {
+                return 0;
+            }
+            wat_function_add_local(func, SCRATCH_X_I32, WAT_TYPE_I32);
+            wat_function_add_local(func, SCRATCH_Q_I32, WAT_TYPE_I32);
+            wat_emit_named(func, WAT_OP_LOCAL_SET, SCRATCH_X_I32);
+            if (op == WAT_OP_REM_S) {
+                wat_emit_named(func, WAT_OP_LOCAL_GET, SCRATCH_X_I32);
+            }
+            emit_signed_quotient(func, (int32_t)signed_value);
+            if (op == WAT_OP_REM_S) {
+                emit_with_const(func, WAT_OP_MUL, WAT_TYPE_I32, signed_value);
+                wat_emit(func, WAT_OP_SUB, WAT_TYPE_I32);
+            }
+            return 1;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+/* Helper: Append a copy of an instruction */
+static void copy_instr(WatFunction* func, const WatInstr* instr) {
+    if (instr->name) {
+        wat_emit_named(func, instr->op, instr->name);
+    } else {
+        wat_emit(func, instr->op, instr->type);
+    }
+    func->instrs[func->instr_count - 1].type = instr->type;
+    func->instrs[func->instr_count - 1].value = instr->value;
+}
+
+int wat_strength_reduce(WatFunction* func) {
+    WatInstr* old = func->instrs;
+    int old_count = func->instr_count;
+    int rewritten = 0;
+
+    func->instrs = NULL;
+    func->instr_count = 0;
+    func->instr_capacity = 0;
+
+    for (int i = 0; i < old_count; i++) {
+        const WatInstr* instr = &old[i];
+        if (instr->op == WAT_OP_CONST && i + 1 < old_count && old[i + 1].type == instr->type &&
+            emit_reduced(func, old[i + 1].op, instr->type, instr->value)) {
+            rewritten++;
+            i++;
+            continue;
+        }
+        copy_instr(func, instr);
+    }
+
+    for (int i = 0; i < old_count; i++) {
+        xfree(old[i].name);
+    }
+    xfree(old);
+    return rewritten;
+}
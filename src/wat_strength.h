@@ -0,0 +1,26 @@
+#ifndef WAT_STRENGTH_H
+#define WAT_STRENGTH_H
+
+#include "wat_instr.h"
+
+/* Strength reduction over a lowered WAT function.
+ *
+ * Rewrites `x * c`, `x / c` and `x % c` where c is a constant pushed right
+ * before the operator:
+ *   - multiply by 2^k          -> shl
+ *   - unsigned divide by 2^k   -> shr_u, unsigned remainder -> and
+ *   - signed divide/remainder by 2^k -> shifts with a rounding bias, so
+ *     results still truncate towards zero
+ *   - 32-bit divide/remainder by any other constant -> multiply by a
+ *     "magic" reciprocal in i64 and keep the high bits
+ * 64-bit division by a non-power-of-two is left alone: WebAssembly has no
+ * 64x64->128 multiply to build the reciprocal with. Divisors 0 and -1 are
+ * never rewritten, so traps stay where they were.
+ *
+ * The rewritten code matches the original instruction bit for bit on
+ * every input. It uses the scratch locals $__sr_x_i32, $__sr_q_i32 and
+ * $__sr_x_i64, declared on demand. Returns the number of operations
+ * rewritten. */
+int wat_strength_reduce(WatFunction* func);
+
+#endif /* WAT_STRENGTH_H */
@@ -0,0 +1,344 @@
+#include <limits.h>
+#include <string.h>
+#include "x86_regalloc.h"
+#include "utils.h"
+
+static const char* const g_reg_names[X86_REG_COUNT][4] = {
+    {"rax", "eax", "ax", "al"},     {"rcx", "ecx", "cx", "cl"},
+    {"rdx", "edx", "dx", "dl"},     {"rbx", "ebx", "bx", "bl"},
+    {"rsp", "esp", "sp", "spl"},    {"rbp", "ebp", "bp", "bpl"},
+    {"rsi", "esi", "si", "sil"},    {"rdi", "edi", "di", "dil"},
+    {"r8", "r8d", "r8w", "r8b"},    {"r9", "r9d", "r9w", "r9b"},
+    {"r10", "r10d", "r10w", "r10b"}, {"r11", "r11d", "r11w", "r11b"},
+    {"r12", "r12d", "r12w", "r12b"}, {"r13", "r13d", "r13w", "r13b"},
+    {"r14", "r14d", "r14w", "r14b"}, {"r15", "r15d", "r15w", "r15b"}
+};
+
+/* Allocatable registers, caller-saved first: short-lived values take
+ * those so fewer callee-saved registers need saving in the prologue */
+static const X86Reg g_allocatable[] = {
+    X86_RSI, X86_RDI, X86_R8, X86_R9, X86_R10, X86_R11,
+    X86_RBX, X86_R12, X86_R13, X86_R14, X86_R15
+};
+#define ALLOCATABLE_COUNT ((int)(sizeof(g_allocatable) / sizeof(g_allocatable[0])))
+
+const char* x86_reg_name(X86Reg reg, int bits) {
+    int width = bits == 64 ? 0 : bits == 32 ? 1 : bits == 16 ? 2 : 3;
+    return g_reg_names[reg][width];
+}
+
+int x86_reg_is_caller_saved(X86Reg reg) {
+    switch (reg) {
+        case X86_RBX:
+        case X86_RSP:
+        case X86_RBP:
+        case X86_R12:
+        case X86_R13:
+        case X86_R14:
+        case X86_R15:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+typedef struct {
+    int value;
+    int start;
+    int end;
+    int crosses_call;
+} Interval;
+
+/* Helper: Widen an interval to cover a position */
+static void extend(Interval* iv, int pos) {
+    if (pos < iv->start) iv->start = pos;
+    if (pos > iv->end) iv->end = pos;
+}
+
+/* Helper: Bit set operations over value ids */
+static int bit_test(const unsigned long long* set, int bit) {
+    return (int)((set[bit / 64] >> (bit % 64)) & 1u);
+}
+
+static void bit_set(unsigned long long* set, int bit) {
+    set[bit / 64] |= 1ull << (bit % 64);
+}
+
+/* Helper: Index of `pred` among a block's predecessors, or -1 */
+static int pred_index(const IrBlock* block, int pred) {
+    for (int i = 0; i < block->pred_count; i++) {
+        if (block->preds[i] == pred) return i;
+    }
+    return -1;
+}
+
+/* Helper: Compute per-block live-in and live-out sets (phi operands count
+ * as live at the end of the predecessor they come from, phi results are
+ * not live-in). Both arrays hold block_count sets of `words` words. */
+static void compute_liveness(const IrFunction* func, int words,
+                             unsigned long long* live_in, unsigned long long* live_out) {
+    int n = func->block_count;
+    unsigned long long* scratch = xmalloc((size_t)words * sizeof(unsigned long long));
+    memset(live_in, 0, (size_t)n * words * sizeof(unsigned long long));
+    memset(live_out, 0, (size_t)n * words * sizeof(unsigned long long));
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int b = n - 1; b >= 0; b--) {
+            const IrBlock* block = &func->blocks[b];
+            unsigned long long* out = live_out + (size_t)b * words;
+
+            /* live_out = union over successors of (live_in minus their
+             * phis) plus the phi operands flowing along this edge */
+            memset(scratch, 0, (size_t)words * sizeof(unsigned long long));
+            int succs[2];
+            int succ_count = ir_block_successors(block, succs);
+            for (int s = 0; s < succ_count; s++) {
+                const IrBlock* succ = &func->blocks[succs[s]];
+                const unsigned long long* in = live_in + (size_t)succs[s] * words;
+                for (int w = 0; w < words; w++) scratch[w] |= in[w];
+                int k = pred_index(succ, b);
+                for (int i = 0; i < succ->instr_count; i++) {
+                    const IrInstr* phi = &func->values[succ->instrs[i]];
+                    if (phi->op != IR_PHI) break;
+                    if (k >= 0 && k < phi->arg_count) bit_set(scratch, phi->args[k]);
+                }
+            }
+            if (memcmp(scratch, out, (size_t)words * sizeof(unsigned long long)) != 0) {
+                memcpy(out, scratch, (size_t)words * sizeof(unsigned long long));
+                changed = 1;
+            }
+
+            /* live_in = (live_out + uses) minus definitions, walking backwards */
+            if (block->term.value >= 0 &&
+                (block->term.kind == IR_TERM_BRANCH || block->term.kind == IR_TERM_RETURN)) {
+                bit_set(scratch, block->term.value);
+            }
+            for (int i = block->instr_count - 1; i >= 0; i--) {
+                int v = block->instrs[i];
+                const IrInstr* instr = &func->values[v];
+                scratch[v / 64] &= ~(1ull << (v % 64));
+                if (instr->op == IR_PHI) continue;
+                for (int a = 0; a < instr->arg_count; a++) {
+                    bit_set(scratch, instr->args[a]);
+                }
+            }
+            unsigned long long* in = live_in + (size_t)b * words;
+            if (memcmp(scratch, in, (size_t)words * sizeof(unsigned long long)) != 0) {
+                memcpy(in, scratch, (size_t)words * sizeof(unsigned long long));
+                changed = 1;
+            }
+        }
+    }
+
+    xfree(scratch);
+}
+
+/* Helper: Whether a value is a constant usable as an immediate operand */
+static int is_immediate(const IrInstr* instr) {
+    if (instr->op == IR_UNDEF) return 1;
+    return instr->op == IR_CONST && instr->imm >= INT_MIN && instr->imm <= INT_MAX;
+}
+
+/* Helper: Build one interval per value that needs a location */
+static Interval* build_intervals(const IrFunction* func, int* out_count) {
+    int words = (func->value_count + 63) / 64;
+    if (words == 0) words = 1;
+    size_t set_bytes = (size_t)func->block_count * words * sizeof(unsigned long long);
+    unsigned long long* live_in = xmalloc(set_bytes);
+    unsigned long long* live_out = xmalloc(set_bytes);
+    compute_liveness(func, words, live_in, live_out);
+
+    int* pos = xmalloc((func->value_count + 1) * sizeof(int));
+    int* block_start = xmalloc((func->block_count + 1) * sizeof(int));
+    int* block_end = xmalloc((func->block_count + 1) * sizeof(int));
+    int* call_pos = xmalloc((func->value_count + 1) * sizeof(int));
+    int call_count = 0;
+
+    /* Number positions: block start, one per instruction, block end */
+    int next = 0;
+    for (int b = 0; b < func->block_count; b++) {
+        const IrBlock* block = &func->blocks[b];
+        block_start[b] = next++;
+        for (int i = 0; i < block->instr_count; i++) {
+            int v = block->instrs[i];
+            pos[v] = next++;
+            if (func->values[v].op == IR_CALL || func->values[v].op == IR_DBG) {
+                call_pos[call_count++] = pos[v];
+            }
+        }
+        block_end[b] = next++;
+    }
+
+    Interval* intervals = xmalloc((func->value_count + 1) * sizeof(Interval));
+    for (int v = 0; v < func->value_count; v++) {
+        intervals[v].value = v;
+        intervals[v].start = INT_MAX;
+        intervals[v].end = -1;
+        intervals[v].crosses_call = 0;
+    }
+
+    for (int b = 0; b < func->block_count; b++) {
+        const IrBlock* block = &func->blocks[b];
+        for (int v = 0; v < func->value_count; v++) {
+            if (bit_test(live_in + (size_t)b * words, v)) extend(&intervals[v], block_start[b]);
+            if (bit_test(live_out + (size_t)b * words, v)) extend(&intervals[v], block_end[b]);
+        }
+        for (int i = 0; i < block->instr_count; i++) {
+            int v = block->instrs[i];
+            const IrInstr* instr = &func->values[v];
+            extend(&intervals[v], pos[v]);
+            if (instr->op == IR_PARAM) {
+                extend(&intervals[v], 0);
+            }
+            if (instr->op == IR_PHI) {
+                /* Written by the copies at the end of each predecessor */
+                for (int a = 0; a < instr->arg_count && a < block->pred_count; a++) {
+                    extend(&intervals[v], block_end[block->preds[a]]);
+                    extend(&intervals[instr->args[a]], block_end[block->preds[a]]);
+                }
+                continue;
+            }
+            for (int a = 0; a < instr->arg_count; a++) {
+                extend(&intervals[instr->args[a]], pos[v]);
+            }
+        }
+        if (block->term.value >= 0 &&
+            (block->term.kind == IR_TERM_BRANCH || block->term.kind == IR_TERM_RETURN)) {
+            extend(&intervals[block->term.value], block_end[b]);
+        }
+    }
+
+    /* Keep the values that need a register or slot */
+    int count = 0;
+    for (int v = 0; v < func->value_count; v++) {
+        const IrInstr* instr = &func->values[v];
+        if (instr->type == TYPE_VOID || is_immediate(instr) || intervals[v].end < 0) continue;
+        Interval iv = intervals[v];
+        for (int c = 0; c < call_count; c++) {
+            if (iv.start < call_pos[c] && call_pos[c] < iv.end) {
+                iv.crosses_call = 1;
+                break;
+            }
+        }
+        intervals[count++] = iv;
+    }
+
+    xfree(live_in);
+    xfree(live_out);
+    xfree(pos);
+    xfree(block_start);
+    xfree(block_end);
+    xfree(call_pos);
+    *out_count = count;
+    return intervals;
+}
+
+/* Helper: Order intervals by start position (insertion sort keeps ties stable) */
+static void sort_by_start(Interval* intervals, int count) {
+    for (int i = 1; i < count; i++) {
+        Interval key = intervals[i];
+        int j = i - 1;
+        while (j >= 0 && intervals[j].start > key.start) {
+            intervals[j + 1] = intervals[j];
+            j--;
+        }
+        intervals[j + 1] = key;
+    }
+}
+
+/* Helper: Move a value to a fresh stack slot */
+static void spill(X86Allocation* alloc, int value) {
+    alloc->locations[value].kind = X86_LOC_STACK;
+    alloc->locations[value].slot = alloc->slot_count++;
+}
+
+X86Allocation* x86_allocate_registers(const IrFunction* func) {
+    X86Allocation* alloc = xmalloc(sizeof(X86Allocation));
+    alloc->locations = xmalloc((func->value_count + 1) * sizeof(X86Location));
+    alloc->slot_count = 0;
+    alloc->used_regs = 0;
+
+    for (int v = 0; v < func->value_count; v++) {
+        const IrInstr* instr = &func->values[v];
+        X86Location* loc = &alloc->locations[v];
+        loc->kind = X86_LOC_NONE;
+        loc->reg = X86_RAX;
+        loc->slot = -1;
+        loc->imm = 0;
+        if (instr->type != TYPE_VOID && is_immediate(instr)) {
+            loc->kind = X86_LOC_IMM;
+            loc->imm = instr->op == IR_CONST ? instr->imm : 0;
+        }
+    }
+
+    int count = 0;
+    Interval* intervals = build_intervals(func, &count);
+    sort_by_start(intervals, count);
+
+    /* Active intervals holding a register, and who holds each register */
+    Interval* active = xmalloc((ALLOCATABLE_COUNT + 1) * sizeof(Interval));
+    int active_count = 0;
+    int holder[X86_REG_COUNT];
+    for (int r = 0; r < X86_REG_COUNT; r++) holder[r] = -1;
+
+    for (int i = 0; i < count; i++) {
+        Interval cur = intervals[i];
+
+        /* Expire intervals that end where this one starts: every
+         * instruction reads its operands before writing its result */
+        int kept = 0;
+        for (int a = 0; a < active_count; a++) {
+            if (active[a].end <= cur.start) {
+                holder[alloc->locations[active[a].value].reg] = -1;
+            } else {
+                active[kept++] = active[a];
+            }
+        }
+        active_count = kept;
+
+        int chosen = -1;
+        for (int r = 0; r < ALLOCATABLE_COUNT; r++) {
+            X86Reg reg = g_allocatable[r];
+            if (holder[reg] >= 0) continue;
+            if (cur.crosses_call && x86_reg_is_caller_saved(reg)) continue;
+            chosen = reg;
+            break;
+        }
+
+        if (chosen < 0) {
+            /* Steal from the usable active interval that ends last, if it
+             * outlives this one; otherwise spill this one */
+            int victim = -1;
+            for (int a = 0; a < active_count; a++) {
+                X86Reg reg = alloc->locations[active[a].value].reg;
+                if (cur.crosses_call && x86_reg_is_caller_saved(reg)) continue;
+                if (victim < 0 || active[a].end > active[victim].end) victim = a;
+            }
+            if (victim < 0 || active[victim].end <= cur.end) {
+                spill(alloc, cur.value);
+                continue;
+            }
+            chosen = alloc->locations[active[victim].value].reg;
+            spill(alloc, active[victim].value);
+            active[victim] = active[--active_count];
+        }
+
+        alloc->locations[cur.value].kind = X86_LOC_REG;
+        alloc->locations[cur.value].reg = (X86Reg)chosen;
+        alloc->used_regs |= 1u << chosen;
+        holder[chosen] = cur.value;
+        active[active_count++] = cur;
+    }
+
+    xfree(active);
+    xfree(intervals);
+    return alloc;
+}
+
+void x86_allocation_free(X86Allocation* alloc) {
+    if (!alloc) return;
+    xfree(alloc->locations);
+    xfree(alloc);
+}
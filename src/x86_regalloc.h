@@ -0,0 +1,55 @@
+#ifndef X86_REGALLOC_H
+#define X86_REGALLOC_H
+
+#include "ir.h"
+
+/* x86-64 general purpose registers, in hardware encoding order */
+typedef enum {
+    X86_RAX, X86_RCX, X86_RDX, X86_RBX, X86_RSP, X86_RBP, X86_RSI, X86_RDI,
+    X86_R8, X86_R9, X86_R10, X86_R11, X86_R12, X86_R13, X86_R14, X86_R15,
+    X86_REG_COUNT
+} X86Reg;
+
+/* Register name at a width of 64, 32, 16 or 8 bits ("rax", "eax", "ax", "al") */
+const char* x86_reg_name(X86Reg reg, int bits);
+
+/* Registers the SysV ABI lets a callee clobber */
+int x86_reg_is_caller_saved(X86Reg reg);
+
+typedef enum {
+    X86_LOC_NONE,       /* No value (void) */
+    X86_LOC_REG,        /* Held in `reg` for its whole lifetime */
+    X86_LOC_STACK,      /* Spilled to stack slot `slot` */
+    X86_LOC_IMM         /* Constant that fits a sign-extended imm32; never materialized */
+} X86LocKind;
+
+typedef struct {
+    X86LocKind kind;
+    X86Reg reg;
+    int slot;
+    long long imm;
+} X86Location;
+
+typedef struct {
+    X86Location* locations;     /* One per IR value */
+    int slot_count;             /* Spill slots used */
+    unsigned used_regs;         /* Bit mask of registers handed out */
+} X86Allocation;
+
+/* Linear-scan register allocation over one function.
+ *
+ * Blocks are numbered in their IR order (reverse postorder) and every
+ * value gets one interval from its first to its last live position,
+ * without lifetime holes. Phi results live from the ends of their
+ * predecessors (where the edge copies write them) and parameters from
+ * function entry. Intervals are handed registers in order of their start;
+ * when none is free, the interval ending last is spilled to a stack slot.
+ *
+ * rax, rcx and rdx are never allocated: the code generator uses them as
+ * scratch (division needs rax:rdx). Values that stay live across a call
+ * or dbg statement only get callee-saved registers, so calls need no
+ * save/restore code. */
+X86Allocation* x86_allocate_registers(const IrFunction* func);
+void x86_allocation_free(X86Allocation* alloc);
+
+#endif /* X86_REGALLOC_H */
@@ -13,6 +13,8 @@
 set -e
 
 DBG_TEST_TIMEOUT=2
+# Optimization levels whose C and WAT output must match output.txt as well
+OPT_LEVELS="1 2"
 PASSED=0
 FAILED=0
 KNOWN_FAILURES=0
@@ -35,6 +37,12 @@ if ! python3 -c "import wasmtime" 2>/dev/null; then
     exit 1
 fi
 
+# The x86-64 backend is checked when its output can be assembled and run here
+HAVE_X86_64=false
+if [ "$(uname -m)" = "x86_64" ] && command -v as >/dev/null 2>&1 && command -v ld >/dev/null 2>&1; then
+    HAVE_X86_64=true
+fi
+
 # Find all dbg test directories (recursively find directories containing test.csm)
 while IFS= read -r test_file; do
     test_dir=$(dirname "$test_file")
@@ -229,6 +237,137 @@ while IFS= read -r test_file; do
         continue
     fi
     
+    # Step 8: Buffered dbg ABI must produce the same output
+    buffered_wat="$temp_dir/generated_buffered.wat"
+    if ! timeout ${DBG_TEST_TIMEOUT} "$CASM_BIN" --target=wat --dbg-abi=buffered --output="$buffered_wat" "test.csm" > "$wat_compile_output" 2>&1; then
+        echo "✗ (WAT compilation with buffered dbg ABI failed)"
+        cat "$wat_compile_output" | sed 's/^/        /'
+        FAILED=$((FAILED + 1))
+        cd "$ORIG_DIR"
+        continue
+    fi
+    
+    if ! timeout ${DBG_TEST_TIMEOUT} python3 "$wat_executor" "$buffered_wat" > "$temp_dir/buffered_stdout.txt" 2>"$temp_dir/buffered_stderr.txt"; then
+        EXIT_CODE=$?
+        if [ $EXIT_CODE -eq 124 ]; then
+            echo "✗ (buffered WAT execution timeout)"
+            FAILED=$((FAILED + 1))
+            cd "$ORIG_DIR"
+            continue
+        fi
+    fi
+    
+    cat "$temp_dir/buffered_stdout.txt" "$temp_dir/buffered_stderr.txt" > "$temp_dir/buffered_actual_output.txt"
+    actual_buffered_output=$(cat "$temp_dir/buffered_actual_output.txt")
+    
+    if [ "$expected_wat_output" != "$actual_buffered_output" ]; then
+        echo "✗ (buffered dbg ABI output mismatch)"
+        echo "      Expected output:"
+        echo "$expected_wat_output" | sed 's/^/        /'
+        echo "      Got output:"
+        echo "$actual_buffered_output" | sed 's/^/        /'
+        FAILED=$((FAILED + 1))
+        cd "$ORIG_DIR"
+        continue
+    fi
+    
+    # Step 9: Optimized builds must produce the same output on both targets
+    opt_failure=""
+    for level in $OPT_LEVELS; do
+        opt_c="$temp_dir/generated_O${level}.c"
+        opt_exe="$temp_dir/test_exe_O${level}"
+        opt_wat="$temp_dir/generated_O${level}.wat"
+        if ! timeout ${DBG_TEST_TIMEOUT} "$CASM_BIN" --target=c -O${level} --output="$opt_c" "test.csm" > "$compile_output" 2>&1 ||
+           ! timeout ${DBG_TEST_TIMEOUT} gcc -std=c99 -w -fsanitize=address -fsanitize=undefined "$opt_c" -o "$opt_exe" -lm > "$temp_dir/gcc_output.txt" 2>&1; then
+            opt_failure="-O${level} C compilation failed"
+            break
+        fi
+        timeout ${DBG_TEST_TIMEOUT} "$opt_exe" > "$temp_dir/opt_stdout.txt" 2>"$temp_dir/opt_stderr.txt" || true
+        if [ "$expected_output" != "$(cat "$temp_dir/opt_stdout.txt" "$temp_dir/opt_stderr.txt")" ]; then
+            opt_failure="-O${level} C output mismatch"
+            break
+        fi
+        if ! timeout ${DBG_TEST_TIMEOUT} "$CASM_BIN" --target=wat -O${level} --output="$opt_wat" "test.csm" > "$wat_compile_output" 2>&1; then
+            opt_failure="-O${level} WAT compilation failed"
+            break
+        fi
+        timeout ${DBG_TEST_TIMEOUT} python3 "$wat_executor" "$opt_wat" > "$temp_dir/opt_stdout.txt" 2>"$temp_dir/opt_stderr.txt" || true
+        if [ "$expected_wat_output" != "$(cat "$temp_dir/opt_stdout.txt" "$temp_dir/opt_stderr.txt")" ]; then
+            opt_failure="-O${level} WAT output mismatch"
+            break
+        fi
+    done
+    if [ -n "$opt_failure" ]; then
+        echo "✗ ($opt_failure)"
+        FAILED=$((FAILED + 1))
+        cd "$ORIG_DIR"
+        continue
+    fi
+    
+    # Step 10: The SSA IR must lower and verify at every level
+    ir_failure=""
+    for level in 0 $OPT_LEVELS; do
+        if ! timeout ${DBG_TEST_TIMEOUT} "$CASM_BIN" --dump-ir -O${level} "test.csm" > "$temp_dir/ir_O${level}.txt" 2>&1; then
+            ir_failure="-O${level} IR: $(tail -n 1 "$temp_dir/ir_O${level}.txt")"
+            break
+        fi
+    done
+    if [ -n "$ir_failure" ]; then
+        echo "✗ ($ir_failure)"
+        FAILED=$((FAILED + 1))
+        cd "$ORIG_DIR"
+        continue
+    fi
+    
+    # Step 11: Native x86-64 builds must produce the same output at every level
+    x86_failure=""
+    if [ "$HAVE_X86_64" = true ]; then
+        for level in 0 $OPT_LEVELS; do
+            x86_asm="$temp_dir/generated_O${level}.s"
+            x86_exe="$temp_dir/test_x86_O${level}"
+            if ! timeout ${DBG_TEST_TIMEOUT} "$CASM_BIN" --target=x86_64 -O${level} --output="$x86_asm" "test.csm" > "$compile_output" 2>&1 ||
+               ! as "$x86_asm" -o "$temp_dir/generated_O${level}.o" > "$temp_dir/as_output.txt" 2>&1 ||
+               ! ld "$temp_dir/generated_O${level}.o" -o "$x86_exe" > "$temp_dir/ld_output.txt" 2>&1; then
+                x86_failure="-O${level} x86-64 build failed"
+                break
+            fi
+            timeout ${DBG_TEST_TIMEOUT} "$x86_exe" > "$temp_dir/x86_stdout.txt" 2>"$temp_dir/x86_stderr.txt" || true
+            if [ "$expected_output" != "$(cat "$temp_dir/x86_stdout.txt" "$temp_dir/x86_stderr.txt")" ]; then
+                x86_failure="-O${level} x86-64 output mismatch"
+                break
+            fi
+        done
+    fi
+    if [ -n "$x86_failure" ]; then
+        echo "✗ ($x86_failure)"
+        FAILED=$((FAILED + 1))
+        cd "$ORIG_DIR"
+        continue
+    fi
+    
+    # Step 12: The built-in interpreter (and the JIT, where available) must
+    # produce the same output at every level
+    run_modes="--run"
+    if [ "$HAVE_X86_64" = true ]; then
+        run_modes="--run --jit"
+    fi
+    run_failure=""
+    for mode in $run_modes; do
+        for level in 0 $OPT_LEVELS; do
+            timeout ${DBG_TEST_TIMEOUT} "$CASM_BIN" $mode -O${level} "test.csm" > "$temp_dir/run_stdout.txt" 2>"$temp_dir/run_stderr.txt" || true
+            if [ "$expected_output" != "$(cat "$temp_dir/run_stdout.txt" "$temp_dir/run_stderr.txt")" ]; then
+                run_failure="-O${level} $mode output mismatch"
+                break 2
+            fi
+        done
+    done
+    if [ -n "$run_failure" ]; then
+        echo "✗ ($run_failure)"
+        FAILED=$((FAILED + 1))
+        cd "$ORIG_DIR"
+        continue
+    fi
+    
     # All checks passed
     echo "✓"
     PASSED=$((PASSED + 1))
@@ -3,135 +3,546 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <time.h>
 
 #include "parser.h"
+#include "semantics.h"
 #include "codegen.h"
+#include "codegen_wat.h"
+#include "output_sink.h"
+#include "wat_instr.h"
+#include "utils.h"
 #include "ast.h"
 
-/* Generate C code into a heap string. Caller must free(). */
-static char* generate_c_from_source(const char* src) {
+static int contains(const char* haystack, const char* needle) {
+    return haystack != NULL && strstr(haystack, needle) != NULL;
+}
+
+/* Analyze a program and generate C from its IR into a heap string.
+ * Caller must xfree(). */
+static char* generate_ir_c_from_source(const char* src) {
     Parser* p = parser_create(src);
     ASTProgram* prog = parser_parse(p);
+    SymbolTable* table = symbol_table_create();
+    SemanticErrorList* errors = semantic_error_list_create();
+    char* text = NULL;
 
-    if (p->errors->error_count != 0) {
-        parser_free(p);
-        ast_program_free(prog);
-        return NULL;
+    if (p->errors->error_count == 0 && analyze_program(prog, table, errors)) {
+        CodegenOptions options;
+        options.tail_calls = 0;
+        OutputSink out;
+        output_sink_init(&out);
+        if (codegen_ir_program_to_sink(prog, &out, "test.csm", &options).success) {
+            text = output_sink_detach(&out, NULL);
+        }
+        output_sink_free(&out);
     }
 
-    FILE* f = tmpfile();
-    if (f == NULL) {
-        parser_free(p);
-        ast_program_free(prog);
-        return NULL;
-    }
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+    ast_program_free(prog);
+    parser_free(p);
+    return text;
+}
 
-    CodegenResult r = codegen_program(prog, f, "test.csm");
-    
-    if (!r.success) {
-        fclose(f);
-        if (r.error_msg) free(r.error_msg);
-        parser_free(p);
-        ast_program_free(prog);
-        return NULL;
-    }
+static void test_assignment_as_add_operand_keeps_both_values(void) {
+    const char* src =
+        "i32 main() {\n"
+        "    i32 x;\n"
+        "    return (x = 1) + (x = 2);\n"
+        "}\n";
 
-    fflush(f);
-    fseek(f, 0, SEEK_END);
-    long sz = ftell(f);
-    if (sz < 0) {
-        fclose(f);
-        if (r.error_msg) free(r.error_msg);
-        parser_free(p);
-        ast_program_free(prog);
-        return NULL;
-    }
+    char* c = generate_ir_c_from_source(src);
 
-    fseek(f, 0, SEEK_SET);
+    ASSERT_TRUE(c != NULL);
+    /* Each assignment yields the value it stores */
+    ASSERT_TRUE(contains(c,
+        "    __v0 = 1;\n"
+        "    __v1 = 2;\n"
+        "    __v2 = (int32_t)((uint32_t)__v0 + (uint32_t)__v1);\n"
+        "    return __v2;\n"));
 
-    char* buf = (char*)malloc((size_t)sz + 1);
-    if (buf == NULL) {
-        fclose(f);
-        if (r.error_msg) free(r.error_msg);
-        parser_free(p);
-        ast_program_free(prog);
-        return NULL;
-    }
+    xfree(c);
+}
 
-    size_t n = fread(buf, 1, (size_t)sz, f);
-    buf[n] = '\0';
+static void test_assignment_under_unary_is_evaluated_first(void) {
+    const char* src =
+        "i32 main() {\n"
+        "    i32 x;\n"
+        "    return -(x = 3) + x;\n"
+        "}\n";
 
-    fclose(f);
-    if (r.error_msg) free(r.error_msg);
+    char* c = generate_ir_c_from_source(src);
 
-    ast_program_free(prog);
-    parser_free(p);
+    ASSERT_TRUE(c != NULL);
+    ASSERT_TRUE(contains(c,
+        "    __v0 = 3;\n"
+        "    __v1 = (int32_t)(0 - (uint32_t)__v0);\n"
+        "    __v2 = (int32_t)((uint32_t)__v1 + (uint32_t)__v0);\n"));
 
-    return buf;
+    xfree(c);
 }
 
-static int contains(const char* haystack, const char* needle) {
-    return haystack != NULL && strstr(haystack, needle) != NULL;
+static void test_nested_blocks_keep_their_own_locals(void) {
+    const char* src =
+        "i32 main() {\n"
+        "  { i32 x = 1; dbg(x); }\n"
+        "  { i32 x = 2; dbg(x); }\n"
+        "  return 0;\n"
+        "}\n";
+
+    char* c = generate_ir_c_from_source(src);
+
+    ASSERT_TRUE(c != NULL);
+
+    /* Each block's x is its own value */
+    ASSERT_TRUE(contains(c, "    __v0 = 1;\n"));
+    ASSERT_TRUE(contains(c, "    casm_dbg_i32(__v0);\n"));
+    ASSERT_TRUE(contains(c, "    __v2 = 2;\n"));
+    ASSERT_TRUE(contains(c, "    casm_dbg_i32(__v2);\n"));
+
+    xfree(c);
 }
 
-static void test_assignment_as_add_operand_is_parenthesized(void) {
+static void test_dbg_uses_buffered_runtime(void) {
     const char* src =
         "i32 main() {\n"
-        "    i32 x;\n"
-        "    return (x = 1) + (x = 2);\n"
+        "    i32 x = 1;\n"
+        "    dbg(x);\n"
+        "    return 0;\n"
         "}\n";
 
-    char* c = generate_c_from_source(src);
+    char* c = generate_ir_c_from_source(src);
 
     ASSERT_TRUE(c != NULL);
-    ASSERT_FALSE(contains(c, "x = 1 + x = 2"));
-    ASSERT_TRUE(contains(c, "(x = 1)"));
-    ASSERT_TRUE(contains(c, "(x = 2)"));
 
-    free(c);
+    /* dbg() goes through the generated runtime, not printf */
+    ASSERT_FALSE(contains(c, "printf("));
+    ASSERT_TRUE(contains(c, "casm_dbg_str(\"test.csm:3:4: x = \", 18);"));
+    ASSERT_TRUE(contains(c, "casm_dbg_str(\"\\n\", 1);"));
+
+    /* The buffer is flushed when main returns */
+    ASSERT_TRUE(contains(c, "    int32_t __v2;\n    atexit(casm_dbg_flush);\n"));
+
+    xfree(c);
 }
 
-static void test_assignment_under_unary_is_parenthesized(void) {
+static void test_dbg_piece_longer_than_buffer_is_written_directly(void) {
+    /* A name longer than the 64 KiB buffer makes one text piece too long
+     * to copy into it */
+    const int name_length = 70000;
+    OutputSink src;
+    output_sink_init(&src);
+    output_sink_append(&src, "i32 main() {\n    i32 ");
+    for (int i = 0; i < name_length; i++) output_sink_append_char(&src, 'v');
+    output_sink_append(&src, " = 7;\n    dbg(");
+    for (int i = 0; i < name_length; i++) output_sink_append_char(&src, 'v');
+    output_sink_append(&src, ");\n    return 0;\n}\n");
+
+    char* c = generate_ir_c_from_source(src.data);
+    ASSERT_TRUE(c != NULL);
+    ASSERT_TRUE(contains(c,
+        "    if (n > CASM_DBG_BUF_SIZE) {\n"
+        "        fwrite(s, 1, n, stdout);\n"));
+    /* The line is not reserved in one go; each piece goes through casm_dbg_text */
+    ASSERT_FALSE(contains(c, "    casm_dbg_reserve(7"));
+    ASSERT_TRUE(contains(c, "vvv = \", 70017);\n"));
+    ASSERT_TRUE(contains(c, "casm_dbg_text(\"test.csm:3:4: vvv"));
+    ASSERT_TRUE(contains(c, "    casm_dbg_text(\"\\n\", 1);\n"));
+    xfree(c);
+    output_sink_free(&src);
+}
+
+static void test_bounds_failure_flushes_dbg_output(void) {
     const char* src =
         "i32 main() {\n"
-        "    i32 x;\n"
-        "    return !(x = 0);\n"
+        "    i32 a[2];\n"
+        "    i32 i = 2;\n"
+        "    dbg(i);\n"
+        "    return a[i];\n"
         "}\n";
 
-    char* c = generate_c_from_source(src);
+    char* c = generate_ir_c_from_source(src);
+    ASSERT_TRUE(c != NULL);
+    /* Earlier dbg lines are written before the error */
+    ASSERT_TRUE(contains(c,
+        "static void casm_bounds_fail(void) {\n"
+        "    casm_dbg_flush();\n"
+        "    fprintf(stderr, "));
+    xfree(c);
 
+    /* Without dbg() there is no buffer to flush */
+    c = generate_ir_c_from_source("i32 main() {\n    i32 a[2];\n    i32 i = 2;\n    return a[i];\n}\n");
     ASSERT_TRUE(c != NULL);
-    ASSERT_FALSE(contains(c, "!x = 0"));
-    ASSERT_TRUE(contains(c, "!(x = 0)"));
+    ASSERT_TRUE(contains(c, "static void casm_bounds_fail(void) {\n    fprintf(stderr, "));
+    xfree(c);
+}
 
-    free(c);
+static void test_ir_struct_params_pass_by_reference(void) {
+    const char* src =
+        "packed struct H { u8 tag; u32 len; }\n"
+        "struct P { u8 kind; i64 mass; }\n"
+        "i64 weigh(P p) {\n"
+        "    return p.mass;\n"
+        "}\n"
+        "i64 forward(P p) {\n"
+        "    return weigh(p);\n"
+        "}\n"
+        "u32 size(H h) {\n"
+        "    return h.len;\n"
+        "}\n"
+        "i32 main() {\n"
+        "    P p = {1, 40};\n"
+        "    H h = {2, 3};\n"
+        "    dbg(forward(p), size(h));\n"
+        "    return 0;\n"
+        "}\n";
+
+    char* c = generate_ir_c_from_source(src);
+    ASSERT_TRUE(c != NULL);
+    /* Fields in layout order; packed keeps declaration order */
+    ASSERT_TRUE(contains(c, "struct P {\n    int64_t mass;\n    uint8_t kind;\n};\n"));
+    ASSERT_TRUE(contains(c, "struct H {\n    uint8_t tag;\n    uint32_t len;\n} __attribute__((packed));\n"));
+    ASSERT_TRUE(contains(c, "int64_t weigh(const struct P* __s0);\n"));
+    ASSERT_TRUE(contains(c, "return __s0->mass;\n"));
+    /* A struct parameter passed on unchanged keeps its pointer */
+    ASSERT_TRUE(contains(c, "weigh(__s0)"));
+    ASSERT_TRUE(contains(c, "forward(&(struct P){.kind = "));
+    xfree(c);
 }
 
-static void test_nested_block_emits_braces(void) {
+static const char* const g_tail_call_source =
+    "i64 sum_to(i64 n, i64 acc) {\n"
+    "    if (n == 0) {\n"
+    "        return acc;\n"
+    "    }\n"
+    "    return sum_to(n - 1, acc + n);\n"
+    "}\n"
+    "i32 keep(i32 x) {\n"
+    "    return keep2(x);\n"
+    "}\n"
+    "i32 keep2(i32 x) {\n"
+    "    return x;\n"
+    "}\n"
+    "i32 main() {\n"
+    "    return keep(0);\n"
+    "}\n";
+
+enum { OUTPUT_WAT, OUTPUT_IR_C };
+
+/* Generate C or WAT for an analyzed program into a heap string */
+static char* generate_tail_call_output(int target, int tail_calls, int return_call) {
+    Parser* p = parser_create(g_tail_call_source);
+    ASTProgram* prog = parser_parse(p);
+    SymbolTable* table = symbol_table_create();
+    SemanticErrorList* errors = semantic_error_list_create();
+    ASSERT_TRUE(p->errors->error_count == 0);
+    ASSERT_TRUE(analyze_program(prog, table, errors));
+
+    OutputSink out;
+    output_sink_init(&out);
+    if (target == OUTPUT_WAT) {
+        CodegenWatOptions options;
+        options.debug_abi = WAT_DEBUG_ABI_CALLS;
+        options.strength_reduce = 0;
+        options.tail_calls = tail_calls;
+        options.return_call = return_call;
+        options.range_analysis = 0;
+        ASSERT_TRUE(codegen_wat_program_to_sink(prog, &out, "test.csm", &options).success);
+    } else {
+        CodegenOptions options;
+        options.tail_calls = tail_calls;
+        ASSERT_TRUE(codegen_ir_program_to_sink(prog, &out, "test.csm", &options).success);
+    }
+    char* text = output_sink_detach(&out, NULL);
+
+    output_sink_free(&out);
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+    ast_program_free(prog);
+    parser_free(p);
+    return text;
+}
+
+static void test_ir_self_tail_call_becomes_jump(void) {
+    char* c = generate_tail_call_output(OUTPUT_IR_C, 1, 0);
+    ASSERT_TRUE(contains(c, "int64_t sum_to(int64_t __p0, int64_t __p1) {\n"));
+    /* The arguments go to the loop header's phis */
+    ASSERT_TRUE(contains(c,
+        "    __phi8 = __v5;\n"
+        "    __phi9 = __v6;\n"
+        "b3:;\n"));
+    ASSERT_FALSE(contains(c, "sum_to(__v"));
+    /* Wrapping arithmetic is done on the unsigned type of the same width */
+    ASSERT_TRUE(contains(c, "(int64_t)((uint64_t)__v8 - (uint64_t)__v4)"));
+    ASSERT_TRUE(contains(c, "__v1 = keep2(__v0);\n"));
+    xfree(c);
+
+    c = generate_tail_call_output(OUTPUT_IR_C, 0, 0);
+    ASSERT_FALSE(contains(c, "__phi"));
+    ASSERT_TRUE(contains(c, "sum_to(__v5, __v6);"));
+    xfree(c);
+}
+
+static void test_self_tail_call_becomes_wat_loop(void) {
+    char* wat = generate_tail_call_output(OUTPUT_WAT, 1, 0);
+    /* The header is the loop and the arguments go to its phis' locals */
+    ASSERT_TRUE(contains(wat, "    local.set $v8\n    loop $l3\n"));
+    ASSERT_TRUE(contains(wat,
+        "        local.set $v9\n"
+        "        local.set $v8\n"
+        "        br $l3\n"));
+    ASSERT_FALSE(contains(wat, "call $sum_to"));
+    ASSERT_FALSE(contains(wat, "return_call"));
+    xfree(wat);
+
+    /* With the tail-call feature every call in tail position uses return_call */
+    wat = generate_tail_call_output(OUTPUT_WAT, 1, 1);
+    ASSERT_FALSE(contains(wat, "loop"));
+    ASSERT_TRUE(contains(wat, "return_call $sum_to\n"));
+    ASSERT_TRUE(contains(wat, "return_call $keep2\n"));
+    ASSERT_TRUE(contains(wat, "return_call $keep\n"));
+    xfree(wat);
+}
+
+static int count_occurrences(const char* haystack, const char* needle) {
+    int count = 0;
+    for (const char* at = strstr(haystack, needle); at; at = strstr(at + 1, needle)) {
+        count++;
+    }
+    return count;
+}
+
+/* Generate WAT for a narrow-type loop with or without range analysis */
+static char* generate_narrow_loop_wat(int range_analysis) {
     const char* src =
         "i32 main() {\n"
-        "  { i32 x = 1; }\n"
-        "  { i32 x = 2; }\n"
-        "  return 0;\n"
+        "    u8 limit = 100;\n"
+        "    u8 one = 1;\n"
+        "    u8 total = 0;\n"
+        "    for (u8 i = 0; i < limit; i = i + one) {\n"
+        "        total = total + i;\n"
+        "    }\n"
+        "    dbg(total);\n"
+        "    return 0;\n"
         "}\n";
+    Parser* p = parser_create(src);
+    ASTProgram* prog = parser_parse(p);
+    SymbolTable* table = symbol_table_create();
+    SemanticErrorList* errors = semantic_error_list_create();
+    ASSERT_TRUE(p->errors->error_count == 0);
+    ASSERT_TRUE(analyze_program(prog, table, errors));
 
-    char* c = generate_c_from_source(src);
+    CodegenWatOptions options;
+    options.debug_abi = WAT_DEBUG_ABI_CALLS;
+    options.strength_reduce = 0;
+    options.tail_calls = 0;
+    options.return_call = 0;
+    options.range_analysis = range_analysis;
+    OutputSink out;
+    output_sink_init(&out);
+    ASSERT_TRUE(codegen_wat_program_to_sink(prog, &out, "test.csm", &options).success);
+    char* text = output_sink_detach(&out, NULL);
 
-    ASSERT_TRUE(c != NULL);
-    
-    /* If braces are missing, both declarations would be in same scope */
-    ASSERT_FALSE(contains(c, "int32_t x = 1;\n    int32_t x = 2;"));
+    output_sink_free(&out);
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+    ast_program_free(prog);
+    parser_free(p);
+    return text;
+}
+
+static void test_narrow_stores_wrap_unless_proven_in_range(void) {
+    /* Both u8 sums are computed in i32 and masked when stored */
+    char* wat = generate_narrow_loop_wat(0);
+    ASSERT_EQ(count_occurrences(wat, "i32.const 255\n"), 2);
+    ASSERT_EQ(count_occurrences(wat, "i32.and\n"), 2);
+    xfree(wat);
+
+    /* The counter stays below 100, the running total does not */
+    wat = generate_narrow_loop_wat(1);
+    ASSERT_EQ(count_occurrences(wat, "i32.and\n"), 1);
+    ASSERT_TRUE(contains(wat,
+        "local.get $v5\n"
+        "        local.get $v4\n"
+        "        i32.add\n"
+        "        i32.const 255\n"
+        "        i32.and\n"
+        "        local.set $v5\n"));
+    xfree(wat);
+}
 
-    /* Positive signal: braces should separate the declarations */
-    ASSERT_TRUE(contains(c, "int32_t x = 1;"));
-    ASSERT_TRUE(contains(c, "int32_t x = 2;"));
+static void test_wat_instr_list_serializes_nested_control_flow(void) {
+    WatFunction* fn = wat_function_create("f");
+    wat_function_add_param(fn, "x", WAT_TYPE_I64);
+    wat_function_set_result(fn, WAT_TYPE_I64);
+    ASSERT_TRUE(wat_function_add_local(fn, "y", WAT_TYPE_I32));
+    ASSERT_FALSE(wat_function_add_local(fn, "x", WAT_TYPE_I32));
 
-    free(c);
+    wat_emit_named(fn, WAT_OP_LOCAL_GET, "x");
+    wat_emit(fn, WAT_OP_EQZ, WAT_TYPE_I64);
+    wat_emit(fn, WAT_OP_IF, WAT_TYPE_I32);
+    wat_emit_const(fn, WAT_TYPE_I64, 5000000000LL);
+    wat_emit(fn, WAT_OP_RETURN, WAT_TYPE_I32);
+    wat_emit(fn, WAT_OP_ELSE, WAT_TYPE_I32);
+    wat_emit_const(fn, WAT_TYPE_I32, 0xFFFFFFFFLL);
+    wat_emit_named(fn, WAT_OP_LOCAL_SET, "y");
+    wat_emit(fn, WAT_OP_END, WAT_TYPE_I32);
+    wat_emit_named(fn, WAT_OP_LOCAL_GET, "x");
+
+    OutputSink buf;
+    output_sink_init(&buf);
+    wat_function_serialize(fn, &buf, 1);
+
+    ASSERT_STR_EQ(buf.data,
+        "  (func $f (param $x i64) (result i64) (local $y i32)\n"
+        "    local.get $x\n"
+        "    i64.eqz\n"
+        "    if\n"
+        "      i64.const 5000000000\n"
+        "      return\n"
+        "    else\n"
+        "      i32.const -1\n"
+        "      local.set $y\n"
+        "    end\n"
+        "    local.get $x\n"
+        "  )\n");
+
+    output_sink_free(&buf);
+    wat_function_free(fn);
+}
+
+static void test_output_sink_appends_and_writes(void) {
+    OutputSink sink;
+    output_sink_init(&sink);
+    output_sink_append(&sink, "a");
+    output_sink_append_spaces(&sink, 3);
+    output_sink_append_int(&sink, LLONG_MIN);
+    output_sink_append_char(&sink, ' ');
+    output_sink_append_int(&sink, 0);
+    output_sink_append_n(&sink, " xyz", 2);
+    ASSERT_STR_EQ(sink.data, "a   -9223372036854775808 0 x");
+
+    /* Both write paths produce the same bytes */
+    char path[] = "/tmp/casm_sink_test.txt";
+    for (int use_mmap = 0; use_mmap <= 1; use_mmap++) {
+        ASSERT_TRUE(output_sink_write_path(&sink, path, use_mmap));
+        FILE* f = fopen(path, "rb");
+        char contents[64] = {0};
+        size_t n = f ? fread(contents, 1, sizeof(contents) - 1, f) : 0;
+        if (f) fclose(f);
+        ASSERT_TRUE(n == sink.length);
+        ASSERT_STR_EQ(contents, sink.data);
+    }
+    remove(path);
+
+    size_t length = 0;
+    char* data = output_sink_detach(&sink, &length);
+    ASSERT_TRUE(length == 28);
+    ASSERT_TRUE(sink.data == NULL && sink.length == 0);
+    xfree(data);
+
+    /* Detaching an empty sink still yields a string */
+    data = output_sink_detach(&sink, &length);
+    ASSERT_STR_EQ(data, "");
+    ASSERT_TRUE(length == 0);
+    xfree(data);
+}
+
+/* Helper: Build a program with many functions and statements */
+static char* build_emit_benchmark_source(int function_count) {
+    OutputSink src;
+    output_sink_init(&src);
+    for (int i = 0; i < function_count; i++) {
+        output_sink_append(&src, "i64 f");
+        output_sink_append_int(&src, i);
+        output_sink_append(&src, "(i64 a, i32 b) {\n"
+                                 "    i64 acc = a;\n"
+                                 "    i32 k = 0;\n"
+                                 "    while (k < b) {\n"
+                                 "        if (k % 3 == 0) {\n"
+                                 "            acc = acc + k * 7;\n"
+                                 "        } else if (k % 3 == 1) {\n"
+                                 "            acc = acc - 11;\n"
+                                 "        } else {\n"
+                                 "            acc = acc * 2;\n"
+                                 "        }\n"
+                                 "        k = k + 1;\n"
+                                 "    }\n"
+                                 "    dbg(acc, k);\n"
+                                 "    return acc;\n"
+                                 "}\n");
+    }
+    output_sink_append(&src, "i32 main() {\n    f0(1, 2);\n    return 0;\n}\n");
+    return output_sink_detach(&src, NULL);
+}
+
+/* Reports emitter throughput for both targets, timing each the way the
+ * compiler drives it (C through the IR). Timings are informational; the
+ * assertions only check that generation succeeds and produces output. */
+static void test_emit_throughput(void) {
+    char* src = build_emit_benchmark_source(400);
+    Parser* p = parser_create(src);
+    ASTProgram* prog = parser_parse(p);
+    ASSERT_TRUE(p->errors->error_count == 0);
+
+    SymbolTable* table = symbol_table_create();
+    SemanticErrorList* errors = semantic_error_list_create();
+    ASSERT_TRUE(analyze_program(prog, table, errors));
+
+    const int rounds = 5;
+    OutputSink out;
+    output_sink_init(&out);
+    CodegenOptions c_options;
+    c_options.tail_calls = 0;
+
+    clock_t start = clock();
+    size_t c_bytes = 0;
+    for (int i = 0; i < rounds; i++) {
+        out.length = 0;
+        CodegenResult r = codegen_ir_program_to_sink(prog, &out, "bench.csm", &c_options);
+        ASSERT_TRUE(r.success);
+        c_bytes += out.length;
+    }
+    double c_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    start = clock();
+    size_t wat_bytes = 0;
+    for (int i = 0; i < rounds; i++) {
+        out.length = 0;
+        CodegenWatResult r = codegen_wat_program_to_sink(prog, &out, "bench.csm", NULL);
+        ASSERT_TRUE(r.success);
+        wat_bytes += out.length;
+    }
+    double wat_seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    ASSERT_TRUE(c_bytes > 0 && wat_bytes > 0);
+    printf("  emit throughput: C %.1f MB/s (%zu bytes), WAT %.1f MB/s (%zu bytes)\n",
+           c_seconds > 0 ? c_bytes / c_seconds / 1e6 : 0.0, c_bytes,
+           wat_seconds > 0 ? wat_bytes / wat_seconds / 1e6 : 0.0, wat_bytes);
+
+    output_sink_free(&out);
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+    ast_program_free(prog);
+    parser_free(p);
+    xfree(src);
 }
 
 int main(void) {
-    RUN_TEST(test_assignment_as_add_operand_is_parenthesized);
-    RUN_TEST(test_assignment_under_unary_is_parenthesized);
-    RUN_TEST(test_nested_block_emits_braces);
+    RUN_TEST(test_assignment_as_add_operand_keeps_both_values);
+    RUN_TEST(test_assignment_under_unary_is_evaluated_first);
+    RUN_TEST(test_nested_blocks_keep_their_own_locals);
+    RUN_TEST(test_dbg_uses_buffered_runtime);
+    RUN_TEST(test_bounds_failure_flushes_dbg_output);
+    RUN_TEST(test_dbg_piece_longer_than_buffer_is_written_directly);
+    RUN_TEST(test_ir_struct_params_pass_by_reference);
+    RUN_TEST(test_ir_self_tail_call_becomes_jump);
+    RUN_TEST(test_self_tail_call_becomes_wat_loop);
+    RUN_TEST(test_narrow_stores_wrap_unless_proven_in_range);
+    RUN_TEST(test_wat_instr_list_serializes_nested_control_flow);
+    RUN_TEST(test_output_sink_appends_and_writes);
+    RUN_TEST(test_emit_throughput);
     PRINT_SUMMARY();
 }
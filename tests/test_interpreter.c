@@ -0,0 +1,364 @@
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+#include "semantics.h"
+#include "ir.h"
+#include "bytecode.h"
+#include "interpreter.h"
+#include "jit_x86.h"
+#include "utils.h"
+
+/* Result of running a source program */
+typedef struct {
+    int compiled;       /* 0 if the program failed to parse, analyze or verify */
+    InterpretResult run;
+    char* output;       /* Captured dbg output */
+} RunOutcome;
+
+/* Parse and analyze. Returns NULL on any front-end error. */
+static ASTProgram* analyze_source(const char* src) {
+    Parser* p = parser_create(src);
+    ASTProgram* prog = parser_parse(p);
+    if (p->errors->error_count != 0) {
+        parser_free(p);
+        ast_program_free(prog);
+        return NULL;
+    }
+
+    SymbolTable* table = symbol_table_create();
+    SemanticErrorList* errors = semantic_error_list_create();
+    int ok = analyze_program(prog, table, errors);
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+    parser_free(p);
+    if (!ok) {
+        ast_program_free(prog);
+        return NULL;
+    }
+    return prog;
+}
+
+/* Helper: Read everything written to a temporary file */
+static char* read_back(FILE* file) {
+    long size = ftell(file);
+    char* text = xmalloc((size_t)size + 1);
+    rewind(file);
+    size_t n = fread(text, 1, (size_t)size, file);
+    text[n] = '\0';
+    return text;
+}
+
+/* Run a program with the interpreter, or the JIT when `jit` is set,
+ * capturing dbg output; `tail_calls` turns self tail calls into loops
+ * first, as -O1 does */
+static RunOutcome run_source_with(const char* src, int jit, int tail_calls) {
+    RunOutcome outcome = {0, {0, NULL, 0}, NULL};
+    ASTProgram* prog = analyze_source(src);
+    if (!prog) return outcome;
+
+    IrModule* module = ir_lower_program(prog);
+    if (tail_calls) {
+        ir_eliminate_self_tail_calls(module);
+    }
+    char* error = NULL;
+    if (!ir_verify_module(module, &error)) {
+        xfree(error);
+        ir_module_free(module);
+        ast_program_free(prog);
+        return outcome;
+    }
+
+    FILE* out = tmpfile();
+    outcome.compiled = 1;
+    if (jit) {
+        outcome.run = jit_x86_run_main(module, "test.csm", out);
+    } else {
+        BcProgram* bytecode = bc_compile_module(module, "test.csm");
+        outcome.run = bc_run_main(bytecode, out);
+        bc_program_free(bytecode);
+    }
+    outcome.output = read_back(out);
+    fclose(out);
+    ir_module_free(module);
+    ast_program_free(prog);
+    return outcome;
+}
+
+static RunOutcome run_source(const char* src) {
+    return run_source_with(src, 0, 0);
+}
+
+static void outcome_free(RunOutcome* outcome) {
+    xfree(outcome->run.error_msg);
+    xfree(outcome->output);
+}
+
+static int contains(const char* haystack, const char* needle) {
+    return haystack != NULL && strstr(haystack, needle) != NULL;
+}
+
+void test_dbg_output_and_exit_code(void) {
+    RunOutcome r = run_source(
+        "i32 main() {\n"
+        "    i32 x = 5;\n"
+        "    bool b = x > 3;\n"
+        "    dbg(x, b, x - 9);\n"
+        "    dbg(!b);\n"
+        "    return 42;\n"
+        "}\n");
+    ASSERT_TRUE(r.compiled);
+    ASSERT_TRUE(r.run.success);
+    ASSERT_EQ(r.run.result, 42);
+    ASSERT_STR_EQ(r.output,
+                  "test.csm:4:4: x = 5, b = true, expr(-) = -4\n"
+                  "test.csm:5:4: !expr = false\n");
+    outcome_free(&r);
+}
+
+void test_calls_and_recursion(void) {
+    RunOutcome r = run_source(
+        "i32 fib(i32 n) {\n"
+        "    if (n < 2) { return n; }\n"
+        "    return fib(n - 1) + fib(n - 2);\n"
+        "}\n"
+        "i32 depth(i32 n) {\n"
+        "    if (n == 0) { return 0; }\n"
+        "    return depth(n - 1) + 1;\n"
+        "}\n"
+        "i32 main() {\n"
+        "    dbg(fib(20), depth(50000));\n"
+        "    return 0;\n"
+        "}\n");
+    ASSERT_TRUE(r.compiled);
+    ASSERT_TRUE(r.run.success);
+    ASSERT_STR_EQ(r.output, "test.csm:10:4: fib() = 6765, depth() = 50000\n");
+    outcome_free(&r);
+}
+
+void test_narrow_arithmetic_wraps(void) {
+    RunOutcome r = run_source(
+        "i32 main() {\n"
+        "    i32 big = 2147483647;\n"
+        "    i32 wrapped = big + 1;\n"
+        "    u8 small = 250;\n"
+        "    u8 five = 10;\n"
+        "    u8 sum = small + five;\n"
+        "    u32 zero = 0;\n"
+        "    u32 one = 1;\n"
+        "    u32 max = zero - one;\n"
+        "    dbg(wrapped, sum, max);\n"
+        "    return 0;\n"
+        "}\n");
+    ASSERT_TRUE(r.compiled);
+    ASSERT_TRUE(r.run.success);
+    ASSERT_STR_EQ(r.output, "test.csm:10:4: wrapped = -2147483648, sum = 4, max = 4294967295\n");
+    outcome_free(&r);
+}
+
+void test_division_traps(void) {
+    RunOutcome r = run_source(
+        "i32 divide(i32 a, i32 b) {\n"
+        "    return a / b;\n"
+        "}\n"
+        "i32 main() {\n"
+        "    dbg(divide(7, 2));\n"
+        "    dbg(divide(7, 0));\n"
+        "    return 0;\n"
+        "}\n");
+    ASSERT_TRUE(r.compiled);
+    ASSERT_FALSE(r.run.success);
+    ASSERT_TRUE(contains(r.run.error_msg, "division by zero"));
+    /* Output before the trap is still written */
+    ASSERT_STR_EQ(r.output, "test.csm:5:4: divide() = 3\n");
+    outcome_free(&r);
+
+    r = run_source(
+        "i32 divide(i32 a, i32 b) {\n"
+        "    return a / b;\n"
+        "}\n"
+        "i32 main() {\n"
+        "    i32 min = -2147483647 - 1;\n"
+        "    return divide(min, -1);\n"
+        "}\n");
+    ASSERT_TRUE(r.compiled);
+    ASSERT_FALSE(r.run.success);
+    ASSERT_TRUE(contains(r.run.error_msg, "overflow"));
+    outcome_free(&r);
+}
+
+static void check_jit_matches(const char* src);
+
+void test_array_bounds_trap(void) {
+    const char* src =
+        "i64 table[3] = {10, 20, 30};\n"
+        "i32 main() {\n"
+        "    i32 local[4];\n"
+        "    for (i32 i = 0; i < 4; i = i + 1) {\n"
+        "        local[i] = i * 2;\n"
+        "        table[i] = table[i] + local[i];\n"
+        "        dbg(table[i]);\n"
+        "    }\n"
+        "    return 0;\n"
+        "}\n";
+    RunOutcome r = run_source(src);
+    ASSERT_TRUE(r.compiled);
+    ASSERT_FALSE(r.run.success);
+    ASSERT_TRUE(contains(r.run.error_msg, "array index out of bounds"));
+    ASSERT_STR_EQ(r.output,
+        "test.csm:7:8: table[i] = 10\n"
+        "test.csm:7:8: table[i] = 22\n"
+        "test.csm:7:8: table[i] = 34\n");
+    outcome_free(&r);
+
+    if (jit_x86_supported()) check_jit_matches(src);
+}
+
+void test_compare_fuses_into_branch(void) {
+    ASTProgram* prog = analyze_source(
+        "i32 count(i32 n) {\n"
+        "    i32 total = 0;\n"
+        "    for (i32 i = 0; i < n; i = i + 1) {\n"
+        "        total = total + i;\n"
+        "    }\n"
+        "    return total;\n"
+        "}\n");
+    ASSERT_TRUE(prog != NULL);
+    IrModule* module = ir_lower_program(prog);
+    BcProgram* bytecode = bc_compile_module(module, "test.csm");
+    ASSERT_EQ(bytecode->function_count, 1);
+    ASSERT_EQ(bytecode->main_index, -1);
+
+    const BcFunction* func = bytecode->functions[0];
+    int fused = 0;
+    int standalone = 0;
+    for (int i = 0; i < func->code_count; i++) {
+        BcOpcode op = func->code[i].op;
+        if (op >= BC_JEQ && op <= BC_JLE_U) fused++;
+        if (op >= BC_EQ && op <= BC_LE_U) standalone++;
+    }
+    ASSERT_EQ(fused, 1);
+    ASSERT_EQ(standalone, 0);
+
+    bc_program_free(bytecode);
+    ir_module_free(module);
+    ast_program_free(prog);
+}
+
+/* The JIT must agree with the interpreter, traps included */
+static void check_jit_matches(const char* src) {
+    RunOutcome expected = run_source_with(src, 0, 0);
+    RunOutcome actual = run_source_with(src, 1, 0);
+    ASSERT_TRUE(expected.compiled && actual.compiled);
+    ASSERT_EQ(actual.run.success, expected.run.success);
+    ASSERT_EQ(actual.run.result, expected.run.result);
+    ASSERT_STR_EQ(actual.output, expected.output);
+    if (!expected.run.success) {
+        ASSERT_STR_EQ(actual.run.error_msg, expected.run.error_msg);
+    }
+    outcome_free(&expected);
+    outcome_free(&actual);
+}
+
+void test_jit_matches_interpreter(void) {
+    if (!jit_x86_supported()) return;
+    check_jit_matches(
+        "i64 many(i32 a, i32 b, i32 c, i32 d, i32 e, i32 f, i32 g, i64 h, i32 i) {\n"
+        "    i64 wide = a;\n"
+        "    return wide * 100000000 + b * 10000000 + c * 1000000 + h * 10 + i;\n"
+        "}\n"
+        "u8 bump(u8 x) { return x + x; }\n"
+        "i32 main() {\n"
+        "    i64 h = 8;\n"
+        "    u8 small = 200;\n"
+        "    i32 total = 0;\n"
+        "    for (i32 i = 0; i < 100; i = i + 1) {\n"
+        "        if (i % 3 == 0) { total = total + i; } else { total = total - 1; }\n"
+        "    }\n"
+        "    dbg(many(1, 2, 3, 4, 5, 6, 7, h, 9), bump(small), total, total > 0);\n"
+        "    return total;\n"
+        "}\n");
+    check_jit_matches(
+        "u32 hash(u32 h, u32 v) { return rotl(h ^ v, 5) ^ h >> 3; }\n"
+        "i32 main() {\n"
+        "    i8 one = 1;\n"
+        "    i8 small = -one - one - one;\n"
+        "    u16 half = 40000;\n"
+        "    i64 wide = -1;\n"
+        "    u32 h = 7;\n"
+        "    u32 step = 1;\n"
+        "    for (i32 i = 0; i < 20; i = i + 1) { h = hash(h, step); step = step + h; }\n"
+        "    dbg(h, rotl(small, small), rotr(half, 3), clz(half), ctz(small));\n"
+        "    dbg(popcount(wide), wide >> 70, wide << 63, ~small & 255 | 1);\n"
+        "    return 0;\n"
+        "}\n");
+    check_jit_matches(
+        "i32 divide(i32 a, i32 b) { return a / b; }\n"
+        "i32 modulo(i32 a, i32 b) { return a % b; }\n"
+        "i32 main() {\n"
+        "    i32 min = -2147483647 - 1;\n"
+        "    dbg(modulo(min, -1), divide(-7, 2));\n"
+        "    dbg(divide(1, 0));\n"
+        "    return 0;\n"
+        "}\n");
+    check_jit_matches(
+        "i32 divide(i32 a, i32 b) { return a / b; }\n"
+        "i32 main() {\n"
+        "    i32 min = -2147483647 - 1;\n"
+        "    return divide(min, -1);\n"
+        "}\n");
+}
+
+void test_jit_stops_runaway_recursion(void) {
+    if (!jit_x86_supported()) return;
+    RunOutcome r = run_source_with(
+        "i32 depth(i32 n) {\n"
+        "    if (n == 0) { return 0; }\n"
+        "    return depth(n - 1) + 1;\n"
+        "}\n"
+        "i32 main() {\n"
+        "    dbg(depth(10));\n"
+        "    return depth(1000000000);\n"
+        "}\n", 1, 0);
+    ASSERT_TRUE(r.compiled);
+    ASSERT_FALSE(r.run.success);
+    ASSERT_TRUE(contains(r.run.error_msg, "stack"));
+    ASSERT_STR_EQ(r.output, "test.csm:6:4: depth() = 10\n");
+    outcome_free(&r);
+}
+
+void test_tail_recursion_runs_in_constant_stack(void) {
+    const char* src =
+        "i64 sum_to(i64 n, i64 acc) {\n"
+        "    if (n == 0) { return acc; }\n"
+        "    return sum_to(n - 1, acc + n);\n"
+        "}\n"
+        "i32 main() {\n"
+        "    dbg(sum_to(1500000, 0));\n"
+        "    return 0;\n"
+        "}\n";
+    /* Deeper than the interpreter's call stack allows */
+    for (int jit = 0; jit <= jit_x86_supported(); jit++) {
+        RunOutcome r = run_source_with(src, jit, 1);
+        ASSERT_TRUE(r.run.success);
+        ASSERT_STR_EQ(r.output, "test.csm:6:4: sum_to() = 1125000750000\n");
+        outcome_free(&r);
+    }
+}
+
+int main(void) {
+    RUN_TEST(test_dbg_output_and_exit_code);
+    RUN_TEST(test_calls_and_recursion);
+    RUN_TEST(test_narrow_arithmetic_wraps);
+    RUN_TEST(test_division_traps);
+    RUN_TEST(test_array_bounds_trap);
+    RUN_TEST(test_compare_fuses_into_branch);
+    RUN_TEST(test_jit_matches_interpreter);
+    RUN_TEST(test_jit_stops_runaway_recursion);
+    RUN_TEST(test_tail_recursion_runs_in_constant_stack);
+
+    PRINT_SUMMARY();
+}
@@ -0,0 +1,385 @@
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+#include "semantics.h"
+#include "ir.h"
+#include "output_sink.h"
+#include "utils.h"
+
+/* The lowered IR points into the AST (dbg statements), so the program is
+ * kept alive until free_lowered() */
+static ASTProgram* g_program = NULL;
+
+/* Parse, analyze and lower to IR. Returns NULL on any front-end error. */
+static IrModule* lower_source(const char* src) {
+    Parser* p = parser_create(src);
+    ASTProgram* prog = parser_parse(p);
+    if (p->errors->error_count != 0) {
+        parser_free(p);
+        ast_program_free(prog);
+        return NULL;
+    }
+
+    SymbolTable* table = symbol_table_create();
+    SemanticErrorList* errors = semantic_error_list_create();
+    IrModule* module = NULL;
+
+    if (analyze_program(prog, table, errors)) {
+        module = ir_lower_program(prog);
+    }
+
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+    parser_free(p);
+    g_program = prog;
+    return module;
+}
+
+static void free_lowered(IrModule* module) {
+    ir_module_free(module);
+    ast_program_free(g_program);
+    g_program = NULL;
+}
+
+/* Dump a whole module to text. Caller must xfree(). */
+static char* dump_module(const IrModule* module) {
+    OutputSink out;
+    output_sink_init(&out);
+    ir_dump_module(module, &out);
+    char* text = output_sink_detach(&out, NULL);
+    output_sink_free(&out);
+    return text;
+}
+
+static int verifies(const IrModule* module) {
+    char* error = NULL;
+    int ok = ir_verify_module(module, &error);
+    if (!ok) {
+        printf("  verifier: %s\n", error);
+    }
+    xfree(error);
+    return ok;
+}
+
+static int contains(const char* haystack, const char* needle) {
+    return haystack != NULL && strstr(haystack, needle) != NULL;
+}
+
+static void test_dump_format(void) {
+    const char* src =
+        "i32 add(i32 a, i32 b) {\n"
+        "    return a + b;\n"
+        "}\n";
+
+    IrModule* module = lower_source(src);
+    ASSERT_TRUE(module != NULL);
+    char* text = dump_module(module);
+    ASSERT_STR_EQ(text,
+        "func @add(i32, i32) -> i32 {\n"
+        "bb0:\n"
+        "  %0 = param i32 0\n"
+        "  %1 = param i32 1\n"
+        "  %2 = add i32 %0, %1\n"
+        "  ret %2\n"
+        "}\n");
+    xfree(text);
+    free_lowered(module);
+}
+
+static void test_if_else_merges_with_phi(void) {
+    const char* src =
+        "i32 pick(bool c) {\n"
+        "    i32 x = 1;\n"
+        "    if (c) {\n"
+        "        x = 2;\n"
+        "    } else {\n"
+        "        x = 3;\n"
+        "    }\n"
+        "    return x;\n"
+        "}\n";
+
+    IrModule* module = lower_source(src);
+    ASSERT_TRUE(module != NULL);
+    ASSERT_TRUE(verifies(module));
+    char* text = dump_module(module);
+    ASSERT_TRUE(contains(text, "br %0, bb1, bb2"));
+    ASSERT_TRUE(contains(text, "bb3:  ; preds bb1, bb2"));
+    ASSERT_TRUE(contains(text, "= phi i32 [bb1: %"));
+    xfree(text);
+    free_lowered(module);
+}
+
+static void test_while_loop_header_phi(void) {
+    const char* src =
+        "i32 sum(i32 n) {\n"
+        "    i32 total = 0;\n"
+        "    i32 i = 0;\n"
+        "    while (i < n) {\n"
+        "        total = total + i;\n"
+        "        i = i + 1;\n"
+        "    }\n"
+        "    return total;\n"
+        "}\n";
+
+    IrModule* module = lower_source(src);
+    ASSERT_TRUE(module != NULL);
+    ASSERT_TRUE(verifies(module));
+    char* text = dump_module(module);
+    /* Header joins the entry and the back edge; one phi per variable */
+    ASSERT_TRUE(contains(text, "bb1:  ; preds bb0, bb2"));
+    ASSERT_TRUE(contains(text, "%3 = phi i32 [bb0: %2], [bb2: %8]"));
+    ASSERT_TRUE(contains(text, "%4 = phi i32 [bb0: %1], [bb2: %6]"));
+    ASSERT_TRUE(contains(text, "%6 = add i32 %4, %3"));
+    ASSERT_TRUE(contains(text, "jmp bb1"));
+    xfree(text);
+    free_lowered(module);
+}
+
+static void test_unmodified_variable_needs_no_phi(void) {
+    const char* src =
+        "i32 f(i32 n) {\n"
+        "    i32 k = 7;\n"
+        "    for (i32 i = 0; i < n; i = i + 1) {\n"
+        "        dbg(k);\n"
+        "    }\n"
+        "    return k;\n"
+        "}\n";
+
+    IrModule* module = lower_source(src);
+    ASSERT_TRUE(module != NULL);
+    ASSERT_TRUE(verifies(module));
+    char* text = dump_module(module);
+    /* Only the induction variable is a phi; k stays the constant */
+    ASSERT_TRUE(contains(text, "%1 = const i32 7"));
+    ASSERT_TRUE(contains(text, "dbg void %1  ; 4:8 k"));
+    ASSERT_TRUE(contains(text, "ret %1"));
+    ASSERT_FALSE(contains(text, "phi i32 [bb0: %1]"));
+    xfree(text);
+    free_lowered(module);
+}
+
+static void test_short_circuit_is_control_flow(void) {
+    const char* src =
+        "bool check(i32 x) {\n"
+        "    return x > 0;\n"
+        "}\n"
+        "bool both(i32 a, i32 b) {\n"
+        "    return check(a) && check(b);\n"
+        "}\n";
+
+    IrModule* module = lower_source(src);
+    ASSERT_TRUE(module != NULL);
+    ASSERT_TRUE(verifies(module));
+    ASSERT_EQ(module->function_count, 2);
+    char* text = dump_module(module);
+    ASSERT_TRUE(contains(text, "= call bool @check(%0)"));
+    ASSERT_TRUE(contains(text, "phi bool"));
+    xfree(text);
+    free_lowered(module);
+}
+
+static void test_narrow_types_are_promoted(void) {
+    const char* src =
+        "u8 inc(u8 x, u8 y) {\n"
+        "    return x + y;\n"
+        "}\n";
+
+    IrModule* module = lower_source(src);
+    ASSERT_TRUE(module != NULL);
+    ASSERT_TRUE(verifies(module));
+    char* text = dump_module(module);
+    ASSERT_TRUE(contains(text, "%2 = conv u32 %0"));
+    ASSERT_TRUE(contains(text, "%3 = conv u32 %1"));
+    ASSERT_TRUE(contains(text, "%4 = add u32 %2, %3"));
+    ASSERT_TRUE(contains(text, "%5 = conv u8 %4"));
+    ASSERT_TRUE(contains(text, "ret %5"));
+    xfree(text);
+    free_lowered(module);
+}
+
+static void test_shadowing_and_code_after_return(void) {
+    const char* src =
+        "i32 f(bool c) {\n"
+        "    i32 x = 1;\n"
+        "    if (c) {\n"
+        "        i32 x = 2;\n"
+        "        return x;\n"
+        "        x = 3;\n"
+        "    }\n"
+        "    return x;\n"
+        "}\n";
+
+    IrModule* module = lower_source(src);
+    ASSERT_TRUE(module != NULL);
+    ASSERT_TRUE(verifies(module));
+    char* text = dump_module(module);
+    ASSERT_TRUE(contains(text, "ret %2"));
+    ASSERT_TRUE(contains(text, "ret %1"));
+    /* The unreachable assignment and its block are gone */
+    ASSERT_FALSE(contains(text, "const i32 3"));
+    ASSERT_FALSE(contains(text, "unreachable"));
+    xfree(text);
+    free_lowered(module);
+}
+
+static void test_self_tail_call_becomes_loop(void) {
+    const char* src =
+        "i64 sum_to(i64 n, i64 acc) {\n"
+        "    if (n == 0) {\n"
+        "        return acc;\n"
+        "    }\n"
+        "    return sum_to(n - 1, acc + n);\n"
+        "}\n";
+
+    IrModule* module = lower_source(src);
+    ASSERT_TRUE(module != NULL);
+    ir_eliminate_self_tail_calls(module);
+    ASSERT_TRUE(verifies(module));
+    char* text = dump_module(module);
+    /* The entry keeps the parameters; the header's phis take the arguments */
+    ASSERT_TRUE(contains(text, "bb0:\n  %0 = param i64 0\n  %1 = param i64 1\n  jmp bb3\n"));
+    ASSERT_TRUE(contains(text, "bb3:  ; preds bb0, bb2\n"));
+    ASSERT_TRUE(contains(text, "%8 = phi i64 [bb0: %0], [bb2: %5]"));
+    ASSERT_TRUE(contains(text, "%9 = phi i64 [bb0: %1], [bb2: %6]"));
+    ASSERT_TRUE(contains(text, "ret %9"));
+    ASSERT_FALSE(contains(text, "call"));
+    xfree(text);
+    free_lowered(module);
+}
+
+static void test_ranges_follow_branch_conditions(void) {
+    const char* src =
+        "i32 main() {\n"
+        "    u8 limit = 100;\n"
+        "    u8 one = 1;\n"
+        "    u8 total = 0;\n"
+        "    for (u8 i = 0; i < limit; i = i + one) {\n"
+        "        total = total + i;\n"
+        "    }\n"
+        "    dbg(total);\n"
+        "    return 0;\n"
+        "}\n";
+
+    IrModule* module = lower_source(src);
+    ASSERT_TRUE(module != NULL);
+    ASSERT_TRUE(verifies(module));
+    const IrFunction* func = module->functions[0];
+    char* text = dump_module(module);
+    ASSERT_TRUE(contains(text, "%8 = lt bool %6, %7\n  br %8, bb2, bb3"));
+    ASSERT_TRUE(contains(text, "%11 = add u32 %9, %10\n  %12 = conv u8 %11"));
+    ASSERT_TRUE(contains(text, "%15 = add u32 %13, %14\n  %16 = conv u8 %15"));
+    xfree(text);
+
+    IrRanges* ranges = ir_analyze_ranges(func);
+    /* i < 100 in the body, so i + 1 fits in i8; total + i is at most 354 */
+    ASSERT_TRUE(ir_range_fits(ranges, 15, 2, TYPE_U8));
+    ASSERT_TRUE(ir_range_fits(ranges, 15, 2, TYPE_I8));
+    ASSERT_FALSE(ir_range_fits(ranges, 11, 2, TYPE_U8));
+    ASSERT_TRUE(ir_range_fits(ranges, 11, 2, TYPE_U16));
+    ir_ranges_free(ranges);
+    free_lowered(module);
+}
+
+/* Helper: cond ? 1 : 2 as a hand-built diamond */
+static IrFunction* build_diamond(void) {
+    IrFunction* func = ir_function_create("diamond", TYPE_I32);
+    ir_function_add_param(func, TYPE_BOOL);
+    int entry = ir_add_block(func);
+    int left = ir_add_block(func);
+    int right = ir_add_block(func);
+    int merge = ir_add_block(func);
+
+    int cond = ir_emit(func, entry, IR_PARAM, TYPE_BOOL);
+    ir_set_branch(func, entry, cond, left, right);
+    int one = ir_emit_const(func, left, TYPE_I32, 1);
+    ir_set_jump(func, left, merge);
+    int two = ir_emit_const(func, right, TYPE_I32, 2);
+    ir_set_jump(func, right, merge);
+    int phi = ir_insert_phi(func, merge, TYPE_I32);
+    ir_add_arg(func, phi, one);
+    ir_add_arg(func, phi, two);
+    ir_set_return(func, merge, phi);
+    return func;
+}
+
+static int verify_message_contains(IrFunction* func, const char* needle) {
+    char* error = NULL;
+    int ok = ir_verify_function(func, &error);
+    int matched = !ok && contains(error, needle);
+    if (!matched) {
+        printf("  verifier said: %s\n", error ? error : "(valid)");
+    }
+    xfree(error);
+    return matched;
+}
+
+static void test_verifier_accepts_hand_built_ir(void) {
+    IrFunction* func = build_diamond();
+    char* error = NULL;
+    ASSERT_TRUE(ir_verify_function(func, &error));
+    ASSERT_TRUE(error == NULL);
+    ir_function_free(func);
+}
+
+static void test_verifier_rejects_broken_ir(void) {
+    /* Phi with too few operands */
+    IrFunction* func = build_diamond();
+    func->values[3].arg_count = 1;
+    ASSERT_TRUE(verify_message_contains(func, "operands but bb3 has 2 predecessors"));
+    ir_function_free(func);
+
+    /* Use not dominated by its definition */
+    func = build_diamond();
+    int bad = ir_emit(func, 3, IR_ADD, TYPE_I32);
+    ir_add_arg(func, bad, 1);
+    ir_add_arg(func, bad, 1);
+    ASSERT_TRUE(verify_message_contains(func, "does not dominate"));
+    ir_function_free(func);
+
+    /* Operand type mismatch */
+    func = build_diamond();
+    bad = ir_emit(func, 3, IR_ADD, TYPE_I64);
+    ir_add_arg(func, bad, 3);
+    ir_add_arg(func, bad, 3);
+    ASSERT_TRUE(verify_message_contains(func, "has type i32, expected i64"));
+    ir_function_free(func);
+
+    /* Missing terminator */
+    func = build_diamond();
+    func->blocks[3].term.kind = IR_TERM_NONE;
+    ASSERT_TRUE(verify_message_contains(func, "bb3 has no terminator"));
+    ir_function_free(func);
+
+    /* Predecessor list out of sync with the branch */
+    func = build_diamond();
+    func->blocks[2].pred_count = 0;
+    ASSERT_TRUE(verify_message_contains(func, "bb0 is missing from the predecessors of bb2"));
+    ir_function_free(func);
+
+    /* Non-bool branch condition */
+    func = build_diamond();
+    func->values[0].type = TYPE_I32;
+    func->param_types[0] = TYPE_I32;
+    ASSERT_TRUE(verify_message_contains(func, "is not bool"));
+    ir_function_free(func);
+}
+
+int main(void) {
+    RUN_TEST(test_dump_format);
+    RUN_TEST(test_if_else_merges_with_phi);
+    RUN_TEST(test_while_loop_header_phi);
+    RUN_TEST(test_unmodified_variable_needs_no_phi);
+    RUN_TEST(test_short_circuit_is_control_flow);
+    RUN_TEST(test_narrow_types_are_promoted);
+    RUN_TEST(test_shadowing_and_code_after_return);
+    RUN_TEST(test_self_tail_call_becomes_loop);
+    RUN_TEST(test_ranges_follow_branch_conditions);
+    RUN_TEST(test_verifier_accepts_hand_built_ir);
+    RUN_TEST(test_verifier_rejects_broken_ir);
+
+    PRINT_SUMMARY();
+}
@@ -154,6 +154,16 @@ void test_keyword_return() {
     free_token_list(list);
 }
 
+void test_keyword_break_continue() {
+    TokenList list = tokenize("break continue breaks continued");
+    ASSERT_EQ(list.tokens[0].type, TOK_BREAK);
+    ASSERT_EQ(list.tokens[1].type, TOK_CONTINUE);
+    ASSERT_EQ(list.tokens[2].type, TOK_IDENTIFIER);
+    ASSERT_EQ(list.tokens[3].type, TOK_IDENTIFIER);
+    ASSERT_EQ(list.tokens[4].type, TOK_EOF);
+    free_token_list(list);
+}
+
 void test_single_char_operators() {
     TokenList list = tokenize("+ - * / % ; , ( )");
     ASSERT_EQ(list.tokens[0].type, TOK_PLUS);
@@ -181,6 +191,21 @@ void test_multi_char_operators() {
     free_token_list(list);
 }
 
+void test_bitwise_operators() {
+    TokenList list = tokenize("& | ^ ~ << >> && <= >=");
+    ASSERT_EQ(list.tokens[0].type, TOK_AMP);
+    ASSERT_EQ(list.tokens[1].type, TOK_PIPE);
+    ASSERT_EQ(list.tokens[2].type, TOK_CARET);
+    ASSERT_EQ(list.tokens[3].type, TOK_TILDE);
+    ASSERT_EQ(list.tokens[4].type, TOK_SHL);
+    ASSERT_EQ(list.tokens[5].type, TOK_SHR);
+    ASSERT_EQ(list.tokens[6].type, TOK_AND);
+    ASSERT_EQ(list.tokens[7].type, TOK_LE);
+    ASSERT_EQ(list.tokens[8].type, TOK_GE);
+    ASSERT_EQ(list.tokens[9].type, TOK_EOF);
+    free_token_list(list);
+}
+
 void test_comparison_operators() {
     TokenList list = tokenize("< > = ! ");
     ASSERT_EQ(list.tokens[0].type, TOK_LT);
@@ -199,6 +224,37 @@ void test_braces() {
     free_token_list(list);
 }
 
+void test_brackets() {
+    TokenList list = tokenize("a[0]");
+    ASSERT_EQ(list.tokens[0].type, TOK_IDENTIFIER);
+    ASSERT_EQ(list.tokens[1].type, TOK_LBRACKET);
+    ASSERT_EQ(list.tokens[2].type, TOK_INT_LITERAL);
+    ASSERT_EQ(list.tokens[3].type, TOK_RBRACKET);
+    ASSERT_EQ(list.tokens[4].type, TOK_EOF);
+    free_token_list(list);
+}
+
+void test_struct_tokens() {
+    TokenList list = tokenize("packed struct p.x");
+    ASSERT_EQ(list.tokens[0].type, TOK_PACKED);
+    ASSERT_EQ(list.tokens[1].type, TOK_STRUCT);
+    ASSERT_EQ(list.tokens[2].type, TOK_IDENTIFIER);
+    ASSERT_EQ(list.tokens[3].type, TOK_DOT);
+    ASSERT_EQ(list.tokens[4].type, TOK_IDENTIFIER);
+    ASSERT_EQ(list.tokens[5].type, TOK_EOF);
+    free_token_list(list);
+}
+
+void test_cast_tokens() {
+    TokenList list = tokenize("x as u8 ask");
+    ASSERT_EQ(list.tokens[0].type, TOK_IDENTIFIER);
+    ASSERT_EQ(list.tokens[1].type, TOK_AS);
+    ASSERT_EQ(list.tokens[2].type, TOK_U8);
+    ASSERT_EQ(list.tokens[3].type, TOK_IDENTIFIER);
+    ASSERT_EQ(list.tokens[4].type, TOK_EOF);
+    free_token_list(list);
+}
+
 void test_simple_function() {
     TokenList list = tokenize("i32 add(i32 a, i32 b) { return a + b; }");
     ASSERT_EQ(list.tokens[0].type, TOK_I32);
@@ -299,10 +355,15 @@ int main() {
     RUN_TEST(test_keyword_while);
     RUN_TEST(test_keyword_for);
     RUN_TEST(test_keyword_return);
+    RUN_TEST(test_keyword_break_continue);
     RUN_TEST(test_single_char_operators);
     RUN_TEST(test_multi_char_operators);
+    RUN_TEST(test_bitwise_operators);
     RUN_TEST(test_comparison_operators);
     RUN_TEST(test_braces);
+    RUN_TEST(test_brackets);
+    RUN_TEST(test_struct_tokens);
+    RUN_TEST(test_cast_tokens);
     RUN_TEST(test_simple_function);
     RUN_TEST(test_single_line_comment);
     RUN_TEST(test_multi_line_comment);
@@ -0,0 +1,1208 @@
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+#include "semantics.h"
+#include "optimizer.h"
+#include "codegen.h"
+#include "output_sink.h"
+#include "utils.h"
+
+/* Call sites inlined by the last optimize_to_c() */
+static int g_inlined_calls = 0;
+
+/* Parse, analyze, optimize at `level` and generate C from the IR, as the
+ * C target does. Caller must xfree(). */
+static char* optimize_to_c(const char* src, int level) {
+    Parser* p = parser_create(src);
+    ASTProgram* prog = parser_parse(p);
+    if (p->errors->error_count != 0) {
+        parser_free(p);
+        ast_program_free(prog);
+        return NULL;
+    }
+
+    SymbolTable* table = symbol_table_create();
+    SemanticErrorList* errors = semantic_error_list_create();
+    char* result = NULL;
+
+    if (analyze_program(prog, table, errors)) {
+        OptimizerStats stats;
+        optimizer_stats_init(&stats);
+        optimize_program(prog, level, &stats);
+        g_inlined_calls = stats.inlining.inlined_calls;
+        optimizer_stats_free(&stats);
+
+        CodegenOptions options;
+        options.tail_calls = 0;
+        OutputSink out;
+        output_sink_init(&out);
+        CodegenResult r = codegen_ir_program_to_sink(prog, &out, "test.csm", &options);
+        if (r.success) {
+            result = output_sink_detach(&out, NULL);
+        }
+        output_sink_free(&out);
+    }
+
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+    ast_program_free(prog);
+    parser_free(p);
+    return result;
+}
+
+static int contains(const char* haystack, const char* needle) {
+    return haystack != NULL && strstr(haystack, needle) != NULL;
+}
+
+
+static int count_occurrences(const char* haystack, const char* needle) {
+    int count = 0;
+    for (const char* at = strstr(haystack, needle); at; at = strstr(at + 1, needle)) {
+        count++;
+    }
+    return count;
+}
+
+/* Helper: The generated C from the definition of the function with this
+ * signature onwards, or NULL */
+static const char* definition(const char* c, const char* signature) {
+    if (c == NULL) return NULL;
+    size_t length = strlen(signature);
+    for (const char* at = strstr(c, signature); at; at = strstr(at + 1, signature)) {
+        if (strncmp(at + length, " {\n", 3) == 0) return at;
+    }
+    return NULL;
+}
+
+/* Helper: Check that `first` occurs in the output and `second` only after it */
+static int appears_before(const char* haystack, const char* first, const char* second) {
+    const char* a = haystack ? strstr(haystack, first) : NULL;
+    return a != NULL && strstr(a + strlen(first), second) != NULL;
+}
+
+static void test_folds_integer_arithmetic(void) {
+    const char* src =
+        "i32 main() {\n"
+        "    i32 a = 2 * 3 + 1;\n"
+        "    i32 b = 7 / 2 - 10 % 4;\n"
+        "    i32 c = 0 - 5;\n"
+        "    return a + b + c;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 1);
+    ASSERT_TRUE(contains(c, "    __v0 = 7;\n    __v1 = 1;\n    __v2 = (-5);\n"));
+    ASSERT_FALSE(contains(c, " / "));
+    ASSERT_FALSE(contains(c, " % "));
+    xfree(c);
+}
+
+static void test_folding_wraps_per_type(void) {
+    const char* src =
+        "i32 main() {\n"
+        "    i32 a = 2147483647 + 1;\n"
+        "    i32 b = 65536 * 65536;\n"
+        "    i32 c = 0 - 2147483647 - 1;\n"
+        "    return a + b + c;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 1);
+    ASSERT_TRUE(contains(c, "__v0 = (-2147483648);"));
+    ASSERT_TRUE(contains(c, "__v1 = 0;"));
+    ASSERT_TRUE(contains(c, "__v2 = (-2147483648);"));
+    xfree(c);
+}
+
+static void test_folds_bitwise_operators(void) {
+    const char* src =
+        "i32 main() {\n"
+        "    i32 x = 5;\n"
+        "    i32 a = 12 & 10 | 1;\n"
+        "    i32 b = -16 >> 2;\n"
+        "    i32 c = rotl(1, 33);\n"
+        "    i32 d = ~0 ^ 3;\n"
+        "    i32 n = clz(1) + popcount(255) + ctz(8);\n"
+        "    i32 s = x << 0 | 0;\n"
+        "    return a + b + c + d + n + s;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 1);
+    ASSERT_TRUE(contains(c, "__v1 = 9;"));
+    ASSERT_TRUE(contains(c, "__v2 = (-4);"));
+    /* Shift and rotate counts are taken modulo the width */
+    ASSERT_TRUE(contains(c, "__v3 = 2;"));
+    ASSERT_TRUE(contains(c, "__v4 = (-4);"));
+    ASSERT_TRUE(contains(c, "__v5 = 42;"));
+    /* s is x itself */
+    ASSERT_TRUE(contains(c, "__v10 = (int32_t)((uint32_t)__v9 + (uint32_t)__v0);"));
+    ASSERT_FALSE(contains(definition(c, "int32_t main(void)"), "<<"));
+    xfree(c);
+}
+
+static void test_keeps_narrow_unsigned_shifts(void) {
+    const char* src =
+        "i32 main(i32 n) {\n"
+        "    u16 s = n as u16;\n"
+        "    i16 t = n as i16;\n"
+        "    bool a = (-(s << (0 as u8))) > (100 as u16);\n"
+        "    i16 b = t >> (0 as u8);\n"
+        "    dbg(a, b);\n"
+        "    return 0;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 1);
+    /* The shift is what makes the negation unsigned in C */
+    ASSERT_TRUE(contains(c,
+        "    __v5 = (uint32_t)((uint32_t)__v3 << ((uint32_t)__v4 & 31));\n"
+        "    __v6 = (uint32_t)(0 - (uint32_t)__v5);\n"));
+    /* Signed narrow shifts promote to int like the bare operand */
+    ASSERT_TRUE(contains(c, "    __v2 = (int16_t)__v0;\n"));
+    ASSERT_TRUE(contains(c, "casm_dbg_i32(__v2);"));
+    ASSERT_FALSE(contains(c, ">> "));
+    xfree(c);
+}
+
+static void test_folds_constant_casts(void) {
+    const char* src =
+        "i32 main() {\n"
+        "    i64 x = 5;\n"
+        "    u8 a = 300 as u8;\n"
+        "    i16 b = -1 as i16;\n"
+        "    u32 c = -1 as u32;\n"
+        "    i32 d = true as i32;\n"
+        "    i64 e = x as i64;\n"
+        "    dbg(a, b, c, e);\n"
+        "    return d;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 1);
+    ASSERT_TRUE(contains(c,
+        "    __v0 = 5;\n"
+        "    __v1 = 44;\n"
+        "    __v2 = (-1);\n"
+        "    __v3 = 4294967295;\n"
+        "    __v4 = 1;\n"));
+    /* A cast to the operand's own type disappears */
+    ASSERT_TRUE(contains(c, "casm_dbg_i64(__v0);"));
+    ASSERT_TRUE(contains(c, "return __v4;"));
+    xfree(c);
+}
+
+static void test_folds_read_only_globals(void) {
+    const char* src =
+        "i32 scale = 3;\n"
+        "bool verbose = true;\n"
+        "i32 count = 0;\n"
+        "i32 bump() {\n"
+        "    count = count + scale;\n"
+        "    return count;\n"
+        "}\n"
+        "i32 main() {\n"
+        "    if (verbose) {\n"
+        "        bump();\n"
+        "    }\n"
+        "    return count * scale;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 1);
+    /* Never assigned: uses become literals and the static goes away */
+    ASSERT_TRUE(!contains(c, "scale"));
+    ASSERT_TRUE(!contains(c, "verbose"));
+    ASSERT_TRUE(contains(c,
+        "    __v2 = count[__v1];\n"
+        "    __v3 = 3;\n"
+        "    __v4 = (int32_t)((uint32_t)__v2 + (uint32_t)__v3);\n"
+        "    count[__v0] = __v4;\n"));
+    const char* main_def = definition(c, "int32_t main(void)");
+    ASSERT_TRUE(contains(main_def, "    bump();\n"));
+    ASSERT_FALSE(contains(main_def, "if ("));
+    ASSERT_TRUE(contains(c,
+        "    __v3 = 3;\n"
+        "    __v4 = (int32_t)((uint32_t)__v2 * (uint32_t)__v3);\n"
+        "    return __v4;\n"));
+    /* Assigned somewhere: stays a variable */
+    ASSERT_TRUE(contains(c, "static int32_t count[1] = {0};"));
+    xfree(c);
+
+    c = optimize_to_c(src, 0);
+    ASSERT_TRUE(contains(c, "static int32_t scale[1] = {3};"));
+    xfree(c);
+}
+
+static void test_does_not_fold_trapping_division(void) {
+    const char* src =
+        "i32 main() {\n"
+        "    i32 a = 1 / 0;\n"
+        "    i32 b = 5 % 0;\n"
+        "    return a + b;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 1);
+    ASSERT_TRUE(contains(c,
+        "    __v0 = 1;\n"
+        "    __v1 = 0;\n"
+        "    if (__v1 == 0) casm_div_fail(0);\n"
+        "    __v2 = __v0 / __v1;\n"));
+    ASSERT_TRUE(contains(c,
+        "    __v3 = 5;\n"
+        "    __v4 = 0;\n"
+        "    if (__v4 == 0) casm_div_fail(0);\n"
+        "    __v5 = __v3 % __v4;\n"));
+    xfree(c);
+}
+
+static void test_simplifies_identities(void) {
+    const char* src =
+        "i32 f() {\n"
+        "    return 4;\n"
+        "}\n"
+        "i32 main() {\n"
+        "    i32 x = 5;\n"
+        "    i64 y = 6;\n"
+        "    bool b = x > 1;\n"
+        "    i32 a = x * 1 + 0;\n"
+        "    i32 z = x * 0;\n"
+        "    i32 k = f() * 0;\n"
+        "    i64 w = 0 + y / 1;\n"
+        "    bool nb = !!b;\n"
+        "    bool t = b && true;\n"
+        "    bool o = false || b;\n"
+        "    dbg(b, w, nb, t, o);\n"
+        "    return a + z + k;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 1);
+    /* a is x and z is 0 */
+    ASSERT_TRUE(contains(c, "    __v4 = 0;\n"));
+    ASSERT_TRUE(contains(c, "__v9 = (int32_t)((uint32_t)__v0 + (uint32_t)__v4);"));
+    /* The call must still happen */
+    ASSERT_TRUE(contains(c,
+        "    __v5 = f();\n"
+        "    __v6 = 0;\n"
+        "    __v7 = (int32_t)((uint32_t)__v5 * (uint32_t)__v6);\n"));
+    /* w is y */
+    ASSERT_TRUE(contains(c, "casm_dbg_i64(__v1);"));
+    ASSERT_FALSE(contains(definition(c, "int32_t main(void)"), " / "));
+    /* b, nb, t and o are all the comparison */
+    ASSERT_TRUE(contains(c, "__v3 = __v0 > __v2;"));
+    ASSERT_EQ(count_occurrences(c, "casm_dbg_bool(__v3);"), 4);
+    ASSERT_FALSE(contains(definition(c, "int32_t main(void)"), "if ("));
+    xfree(c);
+}
+
+static void test_folds_boolean_logic(void) {
+    const char* src =
+        "bool f() {\n"
+        "    return true;\n"
+        "}\n"
+        "i32 main() {\n"
+        "    bool a = 1 < 2 && !(3 == 3);\n"
+        "    bool b = false && f();\n"
+        "    bool c = f() || true;\n"
+        "    dbg(a, b, c);\n"
+        "    return 0;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 1);
+    ASSERT_TRUE(contains(c, "    __v0 = 0;\n    __v1 = 0;\n    __v2 = f();\n"));
+    /* f() is never evaluated on the left of a false && */
+    ASSERT_EQ(count_occurrences(c, "= f();"), 1);
+    /* ...but must be kept when it would have run */
+    ASSERT_TRUE(contains(c,
+        "    if (__v2) {\n"
+        "        __phi4 = __v2;\n"
+        "        goto b2;\n"
+        "    }\n"
+        "    __v3 = 1;\n"
+        "    __phi4 = __v3;\n"));
+    ASSERT_TRUE(contains(c, "casm_dbg_bool(__v4);"));
+    xfree(c);
+}
+
+static void test_folds_constant_conditions(void) {
+    const char* src =
+        "i32 main() {\n"
+        "    i32 x = 1;\n"
+        "    if (1 > 2) {\n"
+        "        x = 10;\n"
+        "    } else if (x == 1) {\n"
+        "        x = 20;\n"
+        "    } else if (true) {\n"
+        "        x = 30;\n"
+        "    } else {\n"
+        "        x = 40;\n"
+        "    }\n"
+        "    dbg(x);\n"
+        "    while (2 < 1) {\n"
+        "        x = 50;\n"
+        "    }\n"
+        "    if (false) {\n"
+        "        x = 60;\n"
+        "    }\n"
+        "    if (true) {\n"
+        "        x = 70;\n"
+        "    }\n"
+        "    return x;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 1);
+    const char* main_def = definition(c, "int32_t main(void)");
+    ASSERT_TRUE(contains(main_def,
+        "    __v2 = __v0 == __v1;\n"
+        "    if (!__v2) {\n"
+        "        goto b2;\n"
+        "    }\n"
+        "    __v3 = 20;\n"));
+    ASSERT_TRUE(contains(main_def, "b2:;\n    __v4 = 30;\n    __phi5 = __v4;\nb3:;\n"));
+    ASSERT_FALSE(contains(main_def, " = 10;"));
+    ASSERT_FALSE(contains(main_def, " = 40;"));
+    ASSERT_FALSE(contains(main_def, " = 50;"));
+    ASSERT_FALSE(contains(main_def, " = 60;"));
+    /* No loop is left, and the last if runs unconditionally */
+    ASSERT_FALSE(contains(main_def, "b4:;"));
+    ASSERT_TRUE(contains(main_def, "    casm_dbg_str(\"\\n\", 1);\n    __v7 = 70;\n    return __v7;\n"));
+    xfree(c);
+}
+
+static void test_level_zero_leaves_program_unchanged(void) {
+    const char* src =
+        "i32 main() {\n"
+        "    i32 a = 2 * 3 + 1;\n"
+        "    if (false) {\n"
+        "        a = 0;\n"
+        "    }\n"
+        "    return a;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 0);
+    ASSERT_TRUE(contains(c, "__v2 = (int32_t)((uint32_t)__v0 * (uint32_t)__v1);"));
+    ASSERT_TRUE(contains(c, "    __v5 = 0;\n    if (!__v5) {\n"));
+    xfree(c);
+}
+
+static void test_inlines_single_expression_functions(void) {
+    const char* src =
+        "i32 square(i32 x) {\n"
+        "    return x * x;\n"
+        "}\n"
+        "i32 side(i32 v) {\n"
+        "    dbg(v);\n"
+        "    return v;\n"
+        "}\n"
+        "i32 main() {\n"
+        "    i32 a = 3;\n"
+        "    i32 b = square(a) + 1;\n"
+        "    i32 c = square(side(a)) + 1;\n"
+        "    i32 d = square(a + 1) + 1;\n"
+        "    return b + c + d;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    const char* main_def = definition(c, "int32_t main(void)");
+    ASSERT_TRUE(contains(main_def,
+        "    __v0 = 3;\n"
+        "    __v1 = (int32_t)((uint32_t)__v0 * (uint32_t)__v0);\n"));
+    /* Arguments with effects or used twice are not substituted */
+    ASSERT_TRUE(contains(main_def, "    __v4 = side(__v0);\n    __v5 = square(__v4);\n"));
+    ASSERT_TRUE(contains(main_def,
+        "    __v9 = (int32_t)((uint32_t)__v0 + (uint32_t)__v8);\n"
+        "    __v10 = square(__v9);\n"));
+    ASSERT_EQ(g_inlined_calls, 1);
+    xfree(c);
+}
+
+static void test_inlines_statements_with_renamed_locals(void) {
+    const char* src =
+        "i32 clamp(i32 v, i32 lo, i32 hi) {\n"
+        "    if (v < lo) {\n"
+        "        return lo;\n"
+        "    }\n"
+        "    i32 r = v;\n"
+        "    if (r > hi) {\n"
+        "        r = hi;\n"
+        "    }\n"
+        "    return r;\n"
+        "}\n"
+        "i32 main(i32 v) {\n"
+        "    i32 r = clamp(v, 0, 20);\n"
+        "    v = clamp(r, 5, 15);\n"
+        "    return clamp(v, 10, 12);\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    const char* main_def = definition(c, "int32_t main(int32_t __p0)");
+    ASSERT_FALSE(contains(main_def, "clamp("));
+    ASSERT_TRUE(contains(main_def,
+        "    __v1 = 0;\n"
+        "    __v2 = 20;\n"
+        "    __v3 = __v0 < __v1;\n"
+        "    if (!__v3) {\n"
+        "        goto b2;\n"
+        "    }\n"
+        "    __phi6 = __v1;\n"
+        "    goto b5;\n"));
+    /* The second call reads the first one's result */
+    ASSERT_TRUE(contains(main_def, "    __v9 = __v6 < __v7;\n"));
+    /* Inlined into a return, the callee's returns are kept */
+    ASSERT_TRUE(contains(main_def, "    return __v13;\n"));
+    ASSERT_EQ(g_inlined_calls, 3);
+    xfree(c);
+}
+
+static void test_does_not_inline_recursion_or_early_returns(void) {
+    const char* src =
+        "i32 fact(i32 n) {\n"
+        "    if (n <= 1) {\n"
+        "        return 1;\n"
+        "    }\n"
+        "    return n * fact(n - 1);\n"
+        "}\n"
+        "i32 first(i32 n) {\n"
+        "    i32 i = 0;\n"
+        "    while (i < n) {\n"
+        "        if (i * i > n) {\n"
+        "            return i;\n"
+        "        }\n"
+        "        i = i + 1;\n"
+        "    }\n"
+        "    return n;\n"
+        "}\n"
+        "i32 main(i32 n) {\n"
+        "    i32 a = fact(n);\n"
+        "    i32 b = first(n);\n"
+        "    return a + b;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    ASSERT_TRUE(contains(c, "    __v1 = fact(__v0);\n    __v2 = first(__v0);\n"));
+    ASSERT_EQ(g_inlined_calls, 0);
+    xfree(c);
+
+    /* -O1 never inlines */
+    c = optimize_to_c("i32 one() {\n    return 1;\n}\ni32 main() {\n    return one();\n}\n", 1);
+    ASSERT_TRUE(contains(c, "    __v0 = one();\n    return __v0;\n"));
+    ASSERT_EQ(g_inlined_calls, 0);
+    xfree(c);
+}
+
+static void test_removes_dead_stores_keeping_calls(void) {
+    const char* src =
+        "i32 next(i32 n) {\n"
+        "    if (n > 100) {\n"
+        "        return next(n - 100);\n"
+        "    }\n"
+        "    return n + 1;\n"
+        "}\n"
+        "i32 main() {\n"
+        "    i32 unused = 5;\n"
+        "    i32 a = 1;\n"
+        "    a = next(a);\n"
+        "    i32 ignored = next(a);\n"
+        "    a = 7;\n"
+        "    i32 q = a / 0;\n"
+        "    return a;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    /* Nothing is computed for `unused`, so `a = 1` is the first value.
+     * The call survives its dead store; the read of `a` keeps `a = 1` */
+    ASSERT_TRUE(contains(c,
+        "int32_t main(void) {\n"
+        "    int32_t __v0;\n"
+        "    int32_t __v1;\n"));
+    ASSERT_TRUE(contains(c,
+        "    __v0 = 1;\n"
+        "    __v1 = next(__v0);\n"
+        "    next(__v1);\n"
+        "    __v3 = 7;\n"));
+    /* A division that may trap is left alone */
+    ASSERT_TRUE(contains(c, "    __v4 = 0;\n    if (__v4 == 0) casm_div_fail(0);\n    return __v3;\n"));
+    xfree(c);
+
+    /* -O1 keeps every store */
+    c = optimize_to_c(src, 1);
+    ASSERT_TRUE(contains(c, "    __v1 = 1;\n    __v2 = next(__v1);\n"));
+    xfree(c);
+}
+
+static void test_removes_self_updating_locals(void) {
+    const char* src =
+        "i32 main(i32 n) {\n"
+        "    i32 k = 0;\n"
+        "    i32 steps = 0;\n"
+        "    for (i32 j = 0; k < 4; j = j + 1) {\n"
+        "        steps = steps + 1;\n"
+        "        k = k + 1;\n"
+        "    }\n"
+        "    for (i32 i = 0; i < n; i = i + 1) {\n"
+        "        dbg(k);\n"
+        "    }\n"
+        "    return k;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    /* j and steps only feed themselves; i controls its loop */
+    ASSERT_TRUE(contains(c,
+        "b1:;\n"
+        "    __v2 = __phi2;\n"
+        "    __v3 = 4;\n"
+        "    __v4 = __v2 < __v3;\n"));
+    ASSERT_EQ(count_occurrences(c, " = __phi"), 2);
+    ASSERT_TRUE(contains(c, "b4:;\n    __v8 = __phi8;\n    __v9 = __v8 < __v0;\n"));
+    xfree(c);
+
+    c = optimize_to_c(src, 1);
+    ASSERT_EQ(count_occurrences(c, " = __phi"), 4);
+    xfree(c);
+}
+
+static void test_keeps_stores_read_by_later_iterations(void) {
+    const char* src =
+        "i32 main(i32 n) {\n"
+        "    i32 prev = 0;\n"
+        "    i32 i = 0;\n"
+        "    i32 seen = 1;\n"
+        "    while (i < n) {\n"
+        "        dbg(prev);\n"
+        "        prev = i;\n"
+        "        seen = 2;\n"
+        "        seen = 3;\n"
+        "        i = i + 1;\n"
+        "    }\n"
+        "    if (i > 1) {\n"
+        "        seen = 4;\n"
+        "    }\n"
+        "    return seen;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    /* prev carries i into the next iteration */
+    ASSERT_TRUE(contains(c, "    __phi5 = __v4;\n"));
+    /* Overwritten in the same iteration before any read */
+    ASSERT_FALSE(contains(c, " = 2;"));
+    ASSERT_TRUE(contains(c, "    __v9 = 3;\n"));
+    ASSERT_TRUE(contains(c, "    __phi6 = __v9;\n"));
+    ASSERT_TRUE(contains(c, "    __v14 = 4;\n"));
+    ASSERT_TRUE(contains(c, "    __v3 = 1;\n"));
+    ASSERT_TRUE(contains(c, "    __phi6 = __v3;\n"));
+    xfree(c);
+}
+
+static void test_hoists_loop_invariants(void) {
+    const char* src =
+        "i32 twice(i32 v) {\n"
+        "    return v * 2;\n"
+        "}\n"
+        "i32 main() {\n"
+        "    i32 n = 4;\n"
+        "    i32 total = 0;\n"
+        "    i32 i = 0;\n"
+        "    while (i < n * 4) {\n"
+        "        total = total + n * 4 + twice(n + i);\n"
+        "        i = i + 1;\n"
+        "    }\n"
+        "    return total;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    const char* main_def = definition(c, "int32_t main(void)");
+    /* Both copies share one value computed before the loop; `n + i` varies */
+    ASSERT_TRUE(appears_before(main_def,
+        "    __v4 = (int32_t)((uint32_t)__v0 * (uint32_t)__v3);\n", "b1:;\n"));
+    ASSERT_EQ(count_occurrences(main_def, " * "), 2);
+    ASSERT_TRUE(contains(main_def, "    __v7 = __v5 < __v4;\n"));
+    ASSERT_TRUE(contains(main_def,
+        "    __v8 = (int32_t)((uint32_t)__v6 + (uint32_t)__v4);\n"
+        "    __v9 = (int32_t)((uint32_t)__v0 + (uint32_t)__v5);\n"
+        "    __v10 = 2;\n"
+        "    __v11 = (int32_t)((uint32_t)__v9 * (uint32_t)__v10);\n"));
+    xfree(c);
+}
+
+static void test_does_not_hoist_impure_or_unsafe_code(void) {
+    const char* src =
+        "i32 noisy(i32 v) {\n"
+        "    dbg(v);\n"
+        "    return v;\n"
+        "}\n"
+        "i32 spin(i32 v) {\n"
+        "    i32 r = 0;\n"
+        "    while (r < v) {\n"
+        "        r = r + 1;\n"
+        "    }\n"
+        "    return r;\n"
+        "}\n"
+        "i32 main() {\n"
+        "    i32 n = 4;\n"
+        "    i32 d = 0;\n"
+        "    i32 total = 0;\n"
+        "    for (i32 i = 0; i < spin(n); i = i + 1) {\n"
+        "        total = total + noisy(n) + spin(n + 1) + 10 / d;\n"
+        "    }\n"
+        "    return total;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    const char* main_def = definition(c, "int32_t main(void)");
+    /* The condition runs on entry, so even a looping pure call moves */
+    ASSERT_TRUE(appears_before(main_def, "    __v3 = spin(__v0);\n", "b1:;\n"));
+    /* In the body: dbg() is an effect, spin() may not return and the
+     * division may trap, so only `n + 1` is hoisted */
+    ASSERT_TRUE(appears_before(main_def,
+        "    __v5 = (int32_t)((uint32_t)__v0 + (uint32_t)__v4);\n", "b1:;\n"));
+    ASSERT_TRUE(appears_before(main_def, "b1:;\n", "    __v10 = noisy(__v0);\n"));
+    ASSERT_TRUE(appears_before(main_def, "b1:;\n", "    __v12 = spin(__v5);\n"));
+    ASSERT_TRUE(appears_before(main_def, "b1:;\n",
+        "    if (__v1 == 0) casm_div_fail(0);\n    __v15 = __v14 / __v1;\n"));
+    xfree(c);
+}
+
+static void test_shares_common_subexpressions(void) {
+    const char* src =
+        "i32 main() {\n"
+        "    i32 a = 3;\n"
+        "    i32 b = 4;\n"
+        "    dbg((a + b) * (a + b), (a + b) * (a + b));\n"
+        "    i32 c = a * b;\n"
+        "    a = 5;\n"
+        "    return a * b + c;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    /* The product is shared first, then the sum inside it */
+    ASSERT_TRUE(contains(c,
+        "    __v2 = (int32_t)((uint32_t)__v0 + (uint32_t)__v1);\n"
+        "    __v3 = (int32_t)((uint32_t)__v2 * (uint32_t)__v2);\n"));
+    ASSERT_EQ(count_occurrences(c, "casm_dbg_i32(__v3);"), 2);
+    ASSERT_EQ(count_occurrences(c, " + (uint32_t)__v1);"), 1);
+    /* The assignment to `a` kills `a * b` */
+    ASSERT_TRUE(contains(c,
+        "    __v5 = (int32_t)((uint32_t)__v0 * (uint32_t)__v1);\n"
+        "    __v6 = 5;\n"
+        "    __v7 = (int32_t)((uint32_t)__v6 * (uint32_t)__v1);\n"
+        "    __v8 = (int32_t)((uint32_t)__v7 + (uint32_t)__v5);\n"));
+    xfree(c);
+}
+
+static void test_does_not_share_impure_or_conditional_code(void) {
+    const char* src =
+        "i32 noisy(i32 v) {\n"
+        "    dbg(v);\n"
+        "    if (v > 0) {\n"
+        "        return noisy(v - 1);\n"
+        "    }\n"
+        "    return v;\n"
+        "}\n"
+        "i32 main() {\n"
+        "    i32 a = 3;\n"
+        "    i32 d = 0;\n"
+        "    i32 x = noisy(a) + noisy(a);\n"
+        "    i32 w = noisy(x) + a / d + a / d;\n"
+        "    bool p = x > 100 && a / d > 1;\n"
+        "    bool q = a / d > 1;\n"
+        "    dbg(p, q, w);\n"
+        "    return 0;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    const char* main_def = definition(c, "int32_t main(void)");
+    ASSERT_TRUE(contains(main_def,
+        "    __v2 = noisy(__v0);\n"
+        "    __v3 = noisy(__v0);\n"
+        "    __v4 = (int32_t)((uint32_t)__v2 + (uint32_t)__v3);\n"));
+    /* Computing the division early would trap before noisy() prints */
+    ASSERT_TRUE(contains(main_def,
+        "    __v5 = noisy(__v4);\n"
+        "    if (__v1 == 0) casm_div_fail(0);\n"
+        "    __v6 = __v0 / __v1;\n"
+        "    __v7 = (int32_t)((uint32_t)__v5 + (uint32_t)__v6);\n"
+        "    if (__v1 == 0) casm_div_fail(0);\n"
+        "    __v8 = __v0 / __v1;\n"));
+    /* Only evaluated when x > 100, so q cannot reuse it */
+    ASSERT_EQ(count_occurrences(main_def, " = __v0 / __v1;"), 4);
+    ASSERT_TRUE(contains(main_def, "    __v16 = __v0 / __v1;\n    __v17 = 1;\n    __v18 = __v16 > __v17;\n"));
+    xfree(c);
+}
+
+static void test_folds_conditions_proven_by_ranges(void) {
+    const char* src =
+        "i32 main(i32 n) {\n"
+        "    i32 total = 0;\n"
+        "    for (i32 i = 0; i < 1000; i = i + 1) {\n"
+        "        if (i >= 0 && i < 1000) {\n"
+        "            total = total + i;\n"
+        "        }\n"
+        "        if (i == 1000) {\n"
+        "            total = 0;\n"
+        "        }\n"
+        "        dbg(i < n);\n"
+        "    }\n"
+        "    dbg(total);\n"
+        "    return 0;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    const char* main_def = definition(c, "int32_t main(int32_t __p0)");
+    /* Both guards are decided by the loop bound; the branches fold away */
+    ASSERT_FALSE(contains(main_def, " >= "));
+    ASSERT_FALSE(contains(main_def, " == "));
+    ASSERT_TRUE(contains(main_def,
+        "    if (!__v50) {\n"
+        "        goto b6;\n"
+        "    }\n"
+        "    __v51 = (int32_t)((uint32_t)__v48 + (uint32_t)__v47);\n"));
+    /* The loop condition and comparisons against unknown values stay */
+    ASSERT_TRUE(contains(main_def, "    __v49 = 1000;\n    __v50 = __v47 < __v49;\n"));
+    ASSERT_TRUE(contains(main_def, "    __v52 = __v47 < __v0;\n"));
+    xfree(c);
+}
+
+static void test_does_not_fold_narrow_arithmetic_by_range(void) {
+    /* -s and 1 - 15 are negative in C's int but large in the u32 the
+     * other backends compute in, so neither comparison is decided */
+    const char* src =
+        "i32 main() {\n"
+        "    u16 s = 7;\n"
+        "    if ((-s) > (100 as u16)) {\n"
+        "        dbg(s);\n"
+        "    }\n"
+        "    if ((1 as u16) - (15 as u16) > (8 as u16)) {\n"
+        "        dbg(s);\n"
+        "    }\n"
+        "    u8 b = 3;\n"
+        "    if (b + b > (100 as u8)) {\n"
+        "        dbg(b);\n"
+        "    }\n"
+        "    return 0;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    ASSERT_TRUE(contains(c, "    __v3 = 100;\n    __v4 = __v2 > __v3;\n"));
+    ASSERT_TRUE(contains(c, "    __v9 = 8;\n    __v10 = __v8 > __v9;\n"));
+    /* Non-negative narrow results still fold */
+    ASSERT_FALSE(contains(c, ": b = "));
+    xfree(c);
+}
+
+static void test_range_analysis_reaches_a_fixpoint(void) {
+    /* Exit tests that cut bounds down on every round used to keep the
+     * analysis narrowing them one step at a time */
+    const char* src =
+        "i32 main() {\n"
+        "    i32 n = 0;\n"
+        "    while (n != 5000) {\n"
+        "        n = n + 1;\n"
+        "        if (n > 100) {\n"
+        "            return 0;\n"
+        "        }\n"
+        "    }\n"
+        "    i32 m = 0;\n"
+        "    while (true) {\n"
+        "        m = m + 1;\n"
+        "        if (m > 100) {\n"
+        "            break;\n"
+        "        }\n"
+        "    }\n"
+        "    return m;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    /* n never gets past 101, so the exit test is decided */
+    ASSERT_FALSE(contains(c, " != "));
+    ASSERT_TRUE(contains(c, "    __v5 = 100;\n    __v6 = __v4 > __v5;\n"));
+    ASSERT_TRUE(contains(c, "    __v13 = 100;\n    __v14 = __v12 > __v13;\n"));
+    xfree(c);
+}
+
+static void test_removes_bounds_checks_proven_by_ranges(void) {
+    const char* src =
+        "i32 g[10];\n"
+        "i32 main(i32 k) {\n"
+        "    i32 i = 0;\n"
+        "    while (i < 10) {\n"
+        "        g[i] = i;\n"
+        "        i = i + 1;\n"
+        "    }\n"
+        "    if (k >= 0 && k < 10) {\n"
+        "        dbg(g[k]);\n"
+        "    }\n"
+        "    dbg(g[k + 1]);\n"
+        "    return g[k];\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    /* The loop condition and the guard keep the indexes in bounds */
+    ASSERT_TRUE(contains(c, "    __v5 = (int64_t)__v2;\n    g[__v5] = __v2;\n"));
+    ASSERT_TRUE(contains(c, "    __v14 = (int64_t)__v0;\n    __v15 = g[__v14];\n"));
+    /* Unknown indexes keep their checks */
+    ASSERT_TRUE(contains(c, "    if ((uint64_t)__v19 >= 10) casm_bounds_fail();\n    __v21 = g[__v19];\n"));
+    ASSERT_TRUE(contains(c, "    if ((uint64_t)__v23 >= 10) casm_bounds_fail();\n    __v25 = g[__v23];\n"));
+    ASSERT_EQ(count_occurrences(definition(c, "int32_t main(int32_t __p0)"), "casm_bounds_fail();"), 2);
+    xfree(c);
+
+    /* Nothing is removed below -O2 */
+    c = optimize_to_c(src, 1);
+    ASSERT_TRUE(contains(c, "    if ((uint64_t)__v5 >= 10) casm_bounds_fail();\n    g[__v5] = __v2;\n"));
+    ASSERT_EQ(count_occurrences(definition(c, "int32_t main(int32_t __p0)"), "casm_bounds_fail();"), 4);
+    xfree(c);
+}
+
+static void test_unrolls_counted_loops(void) {
+    const char* src =
+        "i32 main() {\n"
+        "    i32 total = 0;\n"
+        "    for (i32 i = 0; i < 3; i = i + 1) {\n"
+        "        dbg(i * 10);\n"
+        "    }\n"
+        "    i32 n = 1000;\n"
+        "    for (i32 j = 0; j < n; j = j + 1) {\n"
+        "        total = total + j;\n"
+        "    }\n"
+        "    for (i32 k = 0; k < n; k = k + 1) {\n"
+        "        k = k + total;\n"
+        "    }\n"
+        "    return total;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    const char* main_def = definition(c, "int32_t main(void)");
+    /* Three trips: the counter becomes a literal in each copy */
+    ASSERT_TRUE(contains(main_def, "    __v1 = 0;\n    casm_dbg_reserve(36);\n"));
+    ASSERT_TRUE(contains(main_def, "    __v3 = 10;\n    casm_dbg_reserve(36);\n"));
+    ASSERT_TRUE(appears_before(main_def, "    __v5 = 20;\n    casm_dbg_reserve(36);\n", "b1:;\n"));
+    ASSERT_FALSE(contains(main_def, " * "));
+    /* Eight copies per trip while at least eight remain, then the rest */
+    ASSERT_TRUE(contains(main_def,
+        "    __v11 = 7;\n"
+        "    __v12 = (int32_t)((uint32_t)__v7 - (uint32_t)__v11);\n"
+        "    __v13 = __v9 < __v12;\n"
+        "    if (!__v13) {\n"
+        "        goto b3;\n"
+        "    }\n"
+        "    __v14 = (int32_t)((uint32_t)__v10 + (uint32_t)__v9);\n"
+        "    __v15 = 1;\n"
+        "    __v16 = (int32_t)((uint32_t)__v9 + (uint32_t)__v15);\n"
+        "    __v17 = (int32_t)((uint32_t)__v14 + (uint32_t)__v16);\n"));
+    ASSERT_TRUE(contains(main_def,
+        "    __v35 = (int32_t)((uint32_t)__v32 + (uint32_t)__v34);\n"
+        "    __v36 = 1;\n"
+        "    __v37 = (int32_t)((uint32_t)__v34 + (uint32_t)__v36);\n"
+        "    __phi9 = __v37;\n"));
+    ASSERT_TRUE(contains(main_def,
+        "    __v40 = __v38 < __v7;\n"
+        "    if (!__v40) {\n"
+        "        goto b6;\n"
+        "    }\n"
+        "    __v41 = (int32_t)((uint32_t)__v39 + (uint32_t)__v38);\n"
+        "    __v42 = 1;\n"
+        "    __v43 = (int32_t)((uint32_t)__v38 + (uint32_t)__v42);\n"
+        "    __phi38 = __v43;\n"));
+    /* A body that writes the counter is left alone */
+    ASSERT_TRUE(contains(main_def,
+        "    __v47 = (int32_t)((uint32_t)__v45 + (uint32_t)__v39);\n"
+        "    __v48 = 1;\n"
+        "    __v49 = (int32_t)((uint32_t)__v47 + (uint32_t)__v48);\n"
+        "    __phi45 = __v49;\n"
+        "    goto b7;\n"));
+    xfree(c);
+
+    /* Unrolling is an -O2 pass */
+    c = optimize_to_c(src, 1);
+    ASSERT_TRUE(contains(c, "    __v3 = 3;\n    __v4 = __v2 < __v3;\n"));
+    xfree(c);
+}
+
+static void test_respects_break_and_continue(void) {
+    const char* src =
+        "i32 main(i32 k) {\n"
+        "    i32 total = 0;\n"
+        "    for (i32 i = 0; i < 4; i = i + 1) {\n"
+        "        if (i == k) {\n"
+        "            continue;\n"
+        "        }\n"
+        "        total = total + i;\n"
+        "    }\n"
+        "    i32 j = 0;\n"
+        "    while (j < 10) {\n"
+        "        if (j == k) {\n"
+        "            break;\n"
+        "        }\n"
+        "        j = j + 1;\n"
+        "    }\n"
+        "    dbg(j == 10);\n"
+        "    i32 r = 0;\n"
+        "    while (true) {\n"
+        "        r = j;\n"
+        "        if (j > 20) {\n"
+        "            break;\n"
+        "        }\n"
+        "        j = j + 1;\n"
+        "        r = 0;\n"
+        "    }\n"
+        "    return total + r;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    /* continue skips to the update, break leaves the loop */
+    ASSERT_TRUE(contains(c,
+        "    __v8 = __v4 == __v0;\n"
+        "    if (!__v8) {\n"
+        "        goto b4;\n"
+        "    }\n"
+        "    __phi10 = __v5;\n"
+        "    goto b5;\n"));
+    ASSERT_TRUE(contains(c,
+        "    __v17 = __v14 == __v0;\n"
+        "    if (!__v17) {\n"
+        "        goto b10;\n"
+        "    }\n"
+        "    goto b11;\n"));
+    /* A loop that can leave early keeps its shape */
+    ASSERT_TRUE(contains(c, "    __v6 = 4;\n    __v7 = __v4 < __v6;\n"));
+    /* The loop may end by break before j reaches 10 */
+    ASSERT_TRUE(contains(c, "    __v20 = 10;\n    __v21 = __v14 == __v20;\n"));
+    /* The store is read after the break; the one before the back edge is not */
+    ASSERT_TRUE(contains(c, "    __phi30 = __v23;\n    goto b16;\n"));
+    ASSERT_TRUE(contains(c, "    __phi24 = __v23;\n    goto b12;\n"));
+    ASSERT_TRUE(contains(c, "b12:;\n"));
+    ASSERT_FALSE(contains(strstr(c, "b12:;\n"), " = 0;"));
+    xfree(c);
+}
+
+static void test_evaluates_pure_calls_with_constant_arguments(void) {
+    const char* src =
+        "i32 fact(i32 n) {\n"
+        "    if (n <= 1) {\n"
+        "        return 1;\n"
+        "    }\n"
+        "    return n * fact(n - 1);\n"
+        "}\n"
+        "u8 mask(i32 bits) {\n"
+        "    u8 m = 0;\n"
+        "    u8 one = 1;\n"
+        "    for (i32 i = 0; i < bits; i = i + 1) {\n"
+        "        m = m + m + one;\n"
+        "    }\n"
+        "    return m;\n"
+        "}\n"
+        "bool even(i32 n) {\n"
+        "    return n % 2 == 0;\n"
+        "}\n"
+        "i32 main(i32 n) {\n"
+        "    dbg(fact(5), fact(13), mask(10), even(fact(4)), fact(n));\n"
+        "    return 0;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    ASSERT_TRUE(contains(c, " = 120;"));
+    /* 13! wraps in i32 and 1023 wraps in u8, as at runtime */
+    ASSERT_TRUE(contains(c, " = 1932053504;"));
+    ASSERT_TRUE(contains(c, " = 255;"));
+    /* Folded results feed further calls */
+    ASSERT_TRUE(contains(c, "    __v4 = 1;\n    __v5 = fact(__v0);\n"));
+    ASSERT_TRUE(contains(c, "casm_dbg_bool(__v4);"));
+    ASSERT_EQ(count_occurrences(definition(c, "int32_t main(int32_t __p0)"), "= fact("), 1);
+    xfree(c);
+
+    /* Evaluation is an -O2 pass */
+    c = optimize_to_c(src, 1);
+    ASSERT_TRUE(contains(c, "    __v1 = 5;\n    __v2 = fact(__v1);\n"));
+    xfree(c);
+}
+
+static void test_does_not_evaluate_impure_or_failing_calls(void) {
+    const char* src =
+        "i32 loud(i32 x) {\n"
+        "    dbg(x);\n"
+        "    return x;\n"
+        "}\n"
+        "i32 quiet(i32 x) {\n"
+        "    return loud(x) + 1;\n"
+        "}\n"
+        "i32 ratio(i32 a, i32 b) {\n"
+        "    i32 r = a / b;\n"
+        "    return r;\n"
+        "}\n"
+        "i32 sum(i32 n) {\n"
+        "    i32 total = 0;\n"
+        "    for (i32 i = 0; i < n; i = i + 1) {\n"
+        "        total = total + i;\n"
+        "    }\n"
+        "    return total;\n"
+        "}\n"
+        "i32 forever(i32 n) {\n"
+        "    return forever(n + 1);\n"
+        "}\n"
+        "i32 main() {\n"
+        "    dbg(quiet(1), ratio(1, 0), sum(100000000), forever(0), sum(4));\n"
+        "    return 0;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    /* dbg() anywhere below the callee keeps the call (inlined here).
+     * The calls that stay may go to specialized clones. */
+    ASSERT_TRUE(contains(c, "= loud"));
+    /* The trap must still happen at runtime */
+    ASSERT_TRUE(contains(c, "= ratio"));
+    /* Too many steps, or unbounded recursion */
+    ASSERT_TRUE(contains(c, "= sum"));
+    ASSERT_TRUE(contains(c, "= forever"));
+    ASSERT_TRUE(contains(c, " = 6;"));
+    xfree(c);
+}
+
+static void test_does_not_evaluate_narrow_results_backends_disagree_on(void) {
+    const char* src =
+        "bool below(u16 s) {\n"
+        "    return (-s) > (100 as u16);\n"
+        "}\n"
+        "u16 scale(u16 a) {\n"
+        "    return a * (3 as u16) + (1 as u16);\n"
+        "}\n"
+        "i32 main() {\n"
+        "    dbg(below(7), scale(5));\n"
+        "    return 0;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    /* -s is negative in C but wraps in u32 elsewhere, so it runs */
+    ASSERT_TRUE(contains(c, "= below"));
+    /* In-range narrow arithmetic is still evaluated */
+    ASSERT_FALSE(contains(c, "= scale"));
+    ASSERT_TRUE(contains(c, " = 16;"));
+    xfree(c);
+}
+
+static void test_specializes_functions_on_constant_arguments(void) {
+    const char* src =
+        "i32 pow_mod(i32 x, i32 e, i32 m) {\n"
+        "    if (e == 0) {\n"
+        "        return 1;\n"
+        "    }\n"
+        "    i32 half = pow_mod(x, e / 2, m);\n"
+        "    if (e % 2 == 1) {\n"
+        "        return half * half % m * x % m;\n"
+        "    }\n"
+        "    return half * half % m;\n"
+        "}\n"
+        "i32 shift(i32 x, i32 k) {\n"
+        "    k = k + 1;\n"
+        "    if (x > 1000) {\n"
+        "        return shift(x / 2, k);\n"
+        "    }\n"
+        "    return x * k;\n"
+        "}\n"
+        "i32 main(i32 n) {\n"
+        "    i32 a = pow_mod(n, 2, 1000);\n"
+        "    i32 b = pow_mod(n + 1, 2, 1000);\n"
+        "    i32 c = pow_mod(n, 3, 7);\n"
+        "    i32 d = shift(n, 3);\n"
+        "    return a + b + c + d;\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    /* One clone per distinct set of constants, shared by matching calls */
+    ASSERT_TRUE(contains(c, "    __v1 = pow_mod__spec1(__v0);\n"));
+    ASSERT_TRUE(contains(c,
+        "    __v3 = (int32_t)((uint32_t)__v0 + (uint32_t)__v2);\n"
+        "    __v4 = pow_mod__spec1(__v3);\n"));
+    ASSERT_TRUE(contains(c, "    __v5 = pow_mod__spec2(__v0);\n"));
+    /* The constants fold into the clone, whose recursive call gets a
+     * clone of its own */
+    ASSERT_TRUE(contains(c,
+        "int32_t pow_mod__spec1(int32_t __p0) {\n"
+        "    int32_t __v0;\n"
+        "    int32_t __v1;\n"
+        "    int32_t __v2;\n"
+        "    int32_t __v3;\n"
+        "    int32_t __v4;\n"
+        "    __v0 = __p0;\n"
+        "    __v1 = pow_mod__spec3(__v0);\n"
+        "    __v2 = (int32_t)((uint32_t)__v1 * (uint32_t)__v1);\n"
+        "    __v3 = 1000;\n"
+        "    __v4 = __v2 % __v3;\n"
+        "    return __v4;\n"));
+    /* A parameter the callee assigns is not specialized */
+    ASSERT_TRUE(contains(c, "    __v6 = 3;\n    __v7 = shift(__v0, __v6);\n"));
+    xfree(c);
+
+    /* Specialization is an -O2 pass */
+    c = optimize_to_c(src, 1);
+    ASSERT_TRUE(contains(c,
+        "    __v1 = 2;\n"
+        "    __v2 = 1000;\n"
+        "    __v3 = pow_mod(__v0, __v1, __v2);\n"));
+    xfree(c);
+}
+
+static void test_specialization_keeps_self_tail_calls(void) {
+    const char* src =
+        "i32 swapper(i32 n, i32 a, i32 b) {\n"
+        "    if (n == 0) {\n"
+        "        return a - b;\n"
+        "    }\n"
+        "    return swapper(n - 1, b, a);\n"
+        "}\n"
+        "i32 count(i32 n, i32 k) {\n"
+        "    if (n == 0) {\n"
+        "        return k;\n"
+        "    }\n"
+        "    return count(n - 1, k);\n"
+        "}\n"
+        "i32 main(i32 n) {\n"
+        "    return swapper(n, 1, 2) + count(n, 5);\n"
+        "}\n";
+
+    char* c = optimize_to_c(src, 2);
+    /* Swapped constants would need a second clone calling the first */
+    ASSERT_TRUE(contains(c,
+        "    __v6 = 2;\n"
+        "    __v7 = 1;\n"
+        "    __v8 = swapper(__v5, __v6, __v7);\n"));
+    ASSERT_FALSE(contains(c, "swapper__spec2"));
+    /* Constants passed through stay in the clone */
+    ASSERT_TRUE(contains(c, "    __v6 = count__spec1(__v5);\n"));
+    /* ...so the original is no longer called and goes away */
+    ASSERT_FALSE(contains(c, "int32_t count(int32_t __p0, int32_t __p1)"));
+    xfree(c);
+}
+
+int main(void) {
+    RUN_TEST(test_folds_integer_arithmetic);
+    RUN_TEST(test_folding_wraps_per_type);
+    RUN_TEST(test_folds_bitwise_operators);
+    RUN_TEST(test_keeps_narrow_unsigned_shifts);
+    RUN_TEST(test_folds_constant_casts);
+    RUN_TEST(test_folds_read_only_globals);
+    RUN_TEST(test_does_not_fold_trapping_division);
+    RUN_TEST(test_simplifies_identities);
+    RUN_TEST(test_folds_boolean_logic);
+    RUN_TEST(test_folds_constant_conditions);
+    RUN_TEST(test_level_zero_leaves_program_unchanged);
+    RUN_TEST(test_inlines_single_expression_functions);
+    RUN_TEST(test_inlines_statements_with_renamed_locals);
+    RUN_TEST(test_does_not_inline_recursion_or_early_returns);
+    RUN_TEST(test_removes_dead_stores_keeping_calls);
+    RUN_TEST(test_removes_self_updating_locals);
+    RUN_TEST(test_keeps_stores_read_by_later_iterations);
+    RUN_TEST(test_hoists_loop_invariants);
+    RUN_TEST(test_does_not_hoist_impure_or_unsafe_code);
+    RUN_TEST(test_shares_common_subexpressions);
+    RUN_TEST(test_does_not_share_impure_or_conditional_code);
+    RUN_TEST(test_folds_conditions_proven_by_ranges);
+    RUN_TEST(test_range_analysis_reaches_a_fixpoint);
+    RUN_TEST(test_does_not_fold_narrow_arithmetic_by_range);
+    RUN_TEST(test_removes_bounds_checks_proven_by_ranges);
+    RUN_TEST(test_unrolls_counted_loops);
+    RUN_TEST(test_respects_break_and_continue);
+    RUN_TEST(test_evaluates_pure_calls_with_constant_arguments);
+    RUN_TEST(test_does_not_evaluate_impure_or_failing_calls);
+    RUN_TEST(test_does_not_evaluate_narrow_results_backends_disagree_on);
+    RUN_TEST(test_specializes_functions_on_constant_arguments);
+    RUN_TEST(test_specialization_keeps_self_tail_calls);
+
+    PRINT_SUMMARY();
+}
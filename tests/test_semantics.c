@@ -441,6 +441,288 @@ static int test_nested_blocks_same_var_name(TestSuite* suite) {
     TEST_PASS;
 }
 
+/* Test: Bit operations require integer operands of one signedness */
+static int test_bitwise_errors(TestSuite* suite) {
+    TEST_START("Bitwise errors");
+
+    const char* invalid[] = {
+        "i32 main() { bool b = true; return 1 & b; }",
+        "i32 main() { bool b = true; return ~b; }",
+        "i32 main() { bool b = true; return b << 1; }",
+        "i32 main() { u8 x = 1; return x & 15; }",
+        "i32 main() { u32 x = 1; i32 y = 2; return x | y; }",
+        "i32 main() { bool b = true; return popcount(b); }",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        SymbolTable* table;
+        SemanticErrorList* errors;
+        int result = parse_and_analyze(invalid[i], &table, &errors);
+        ASSERT_TRUE(errors != NULL, "Program should parse");
+        ASSERT_EQ(result, 0, "Program should be invalid");
+        semantic_error_list_free(errors);
+        symbol_table_free(table);
+    }
+
+    SymbolTable* table;
+    SemanticErrorList* errors;
+    int result = parse_and_analyze(
+        "i32 main() { u8 x = 200; u8 m = 15; i64 w = 1;\n"
+        "  u32 r = rotl(x, m) & m | x >> 2; i64 s = w << 40 ^ ~w;\n"
+        "  i64 c = popcount(w) + ctz(w); u32 z = clz(x) + ctz(x); return 1 << 3 | 6 & 3; }",
+        &table, &errors);
+    ASSERT_EQ(result, 1, "Program should be valid");
+
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+    TEST_PASS;
+}
+
+/* Test: Casts convert between integers and from bool, never to bool */
+static int test_cast_errors(TestSuite* suite) {
+    TEST_START("Cast errors");
+
+    const char* invalid[] = {
+        "i32 main() { i32 x = 1; bool b = x as bool; return 0; }",
+        "i32 main() { i32 a[2]; return a as i32; }",
+        "i32 main() { i64 x = 1; return x as u32; }",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        SymbolTable* table;
+        SemanticErrorList* errors;
+        int result = parse_and_analyze(invalid[i], &table, &errors);
+        ASSERT_TRUE(errors != NULL, "Program should parse");
+        ASSERT_EQ(result, 0, "Program should be invalid");
+        semantic_error_list_free(errors);
+        symbol_table_free(table);
+    }
+
+    SymbolTable* table;
+    SemanticErrorList* errors;
+    int result = parse_and_analyze(
+        "i32 main() { i64 x = 1; bool b = true; u8 low = x as u8;\n"
+        "  u64 wide = low as u64 + b as u64; bool same = b as bool;\n"
+        "  return -x as i32 + 300 as u8 as i32; }",
+        &table, &errors);
+    ASSERT_EQ(result, 1, "Program should be valid");
+
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+    TEST_PASS;
+}
+
+/* Test: Array misuse is rejected; valid indexing is accepted */
+static int test_array_errors(TestSuite* suite) {
+    TEST_START("Array errors");
+
+    const char* invalid[] = {
+        "i32 main() { i32 a[2]; return a; }",
+        "i32 main() { i32 x = 0; return x[0]; }",
+        "i32 main() { i32 a[2]; return a[2]; }",
+        "i32 main() { i32 a[2]; return a[true]; }",
+        "i32 main() { i32 a[2] = {1, 2, 3}; return 0; }",
+        "i32 main() { u8 a[2] = {256}; return 0; }",
+        "i32 main() { bool a[2]; return 0; }",
+        "i32 main() { return b[0]; }",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        SymbolTable* table;
+        SemanticErrorList* errors;
+        int result = parse_and_analyze(invalid[i], &table, &errors);
+        ASSERT_TRUE(errors != NULL, "Program should parse");
+        ASSERT_EQ(result, 0, "Program should be invalid");
+        semantic_error_list_free(errors);
+        symbol_table_free(table);
+    }
+
+    SymbolTable* table;
+    SemanticErrorList* errors;
+    int result = parse_and_analyze(
+        "i64 g[4] = {1};\n"
+        "i32 main() { i32 a[3]; a[2] = 5; g[a[2] - 2] = 7; return a[2]; }",
+        &table, &errors);
+    ASSERT_EQ(result, 1, "Program should be valid");
+
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+    TEST_PASS;
+}
+
+/* Test: Scalar globals need constant initializers of their type */
+static int test_global_errors(TestSuite* suite) {
+    TEST_START("Global variable errors");
+
+    const char* invalid[] = {
+        "i32 n = 1 + 2;\ni32 main() { return n; }",
+        "i32 f() { return 1; }\ni32 n = f();\ni32 main() { return n; }",
+        "u8 n = 256;\ni32 main() { return 0; }",
+        "u32 n = -1;\ni32 main() { return 0; }",
+        "bool b = 1;\ni32 main() { return 0; }",
+        "i32 n = true;\ni32 main() { return 0; }",
+        "i32 n = 5 as u64;\ni32 main() { return 0; }",
+        "i32 n;\ni32 n;\ni32 main() { return 0; }",
+        "i32 main;\ni32 main() { return 0; }",
+        "i32 n;\ni32 main() { return n[0]; }",
+        "i32 g[2];\ni32 main() { return g; }",
+        "i64 n;\ni32 main() { u64 x = n; return 0; }",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        SymbolTable* table;
+        SemanticErrorList* errors;
+        int result = parse_and_analyze(invalid[i], &table, &errors);
+        ASSERT_TRUE(errors != NULL, "Program should parse");
+        ASSERT_EQ(result, 0, "Program should be invalid");
+        semantic_error_list_free(errors);
+        symbol_table_free(table);
+    }
+
+    Parser* parser = parser_create(
+        "i16 low = -(300 as i16);\n"
+        "u64 all = ~0 as u64;\n"
+        "bool on = !false;\n"
+        "i32 count;\n"
+        "i32 main() { count = count + 1; i32 low = 2; return count + low; }");
+    ASTProgram* program = parser_parse(parser);
+    SymbolTable* table = symbol_table_create();
+    SemanticErrorList* errors = semantic_error_list_create();
+    ASSERT_EQ(analyze_program(program, table, errors), 1, "Program should be valid");
+    ASSERT_EQ((int)program->globals[0].decl.elements[0], -300, "Negated cast is constant");
+    ASSERT_EQ((int)program->globals[1].decl.elements[0], -1, "u64 keeps the bit pattern");
+    ASSERT_EQ((int)program->globals[2].decl.elements[0], 1, "Bool initializer");
+    ASSERT_EQ(program->globals[3].decl.element_count, 0, "No initializer starts at zero");
+
+    ASTExpression* assign = program->functions[0].body.statements[0].as.expr_stmt.expr;
+    ASSERT_EQ(assign->as.binary_op.left->type, EXPR_INDEX, "Global is accessed as memory");
+    ASSERT_EQ(assign->as.binary_op.left->as.index.scalar, 1, "Access is marked scalar");
+    ASSERT_EQ(assign->as.binary_op.left->as.index.global_index, 3, "Access names the global");
+
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+    parser_free(parser);
+    ast_program_free(program);
+    TEST_PASS;
+}
+
+/* Test: Struct misuse is rejected; field access is accepted */
+static int test_struct_errors(TestSuite* suite) {
+    TEST_START("Struct errors");
+
+    const char* invalid[] = {
+        "struct P { i32 x; }\nstruct P { i32 y; }\ni32 main() { return 0; }",
+        "struct P { i32 x; i64 x; }\ni32 main() { return 0; }",
+        "struct P { bool ok; }\ni32 main() { return 0; }",
+        "struct P { i32 x; }\ni32 main() { Q q; return 0; }",
+        "struct P { i32 x; }\ni32 main() { P p; return p.y; }",
+        "struct P { i32 x; }\ni32 main() { i32 n = 1; return n.x; }",
+        "struct P { i32 x; }\ni32 main() { P p; return p; }",
+        "struct P { i32 x; }\ni32 main() { P p; P q; q = p; return 0; }",
+        "struct P { u8 x; }\ni32 main() { P p = {256}; return 0; }",
+        "struct P { i32 x; }\ni32 main() { P p = {1, 2}; return 0; }",
+        "struct P { i32 x; }\nvoid set(P p) { p.x = 1; }\ni32 main() { return 0; }",
+        "struct P { i32 x; }\nstruct Q { i32 x; }\n"
+        "i32 get(P p) { return p.x; }\ni32 main() { Q q; return get(q); }",
+        "struct P { i32 x; }\ni32 get(P p) { return p.x; }\ni32 main() { return get(1); }",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        SymbolTable* table;
+        SemanticErrorList* errors;
+        int result = parse_and_analyze(invalid[i], &table, &errors);
+        ASSERT_TRUE(errors != NULL, "Program should parse");
+        ASSERT_EQ(result, 0, "Program should be invalid");
+        semantic_error_list_free(errors);
+        symbol_table_free(table);
+    }
+
+    SymbolTable* table;
+    SemanticErrorList* errors;
+    int result = parse_and_analyze(
+        "struct P { i32 x; i64 y; }\n"
+        "i64 sum(P p) { return p.y + p.x; }\n"
+        "i32 main() { P p = {1}; p.y = p.x + 2; i64 r = sum(p); return p.x; }",
+        &table, &errors);
+    ASSERT_EQ(result, 1, "Program should be valid");
+
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+    TEST_PASS;
+}
+
+/* Test: Fields are laid out largest-first unless the struct is packed */
+static int test_struct_layout(TestSuite* suite) {
+    TEST_START("Struct layout");
+
+    Parser* parser = parser_create(
+        "struct A { u8 a; i64 b; i16 c; u8 d; }\n"
+        "packed struct B { u8 a; i64 b; i16 c; }\n"
+        "i32 main() { return 0; }");
+    ASTProgram* program = parser_parse(parser);
+    SymbolTable* table = symbol_table_create();
+    SemanticErrorList* errors = semantic_error_list_create();
+    ASSERT_EQ(analyze_program(program, table, errors), 1, "Program should be valid");
+
+    ASTStructDef* natural = &program->structs[0];
+    ASSERT_EQ(natural->fields[1].offset, 0, "i64 field comes first");
+    ASSERT_EQ(natural->fields[2].offset, 8, "i16 field follows");
+    ASSERT_EQ(natural->fields[0].offset, 10, "u8 fields keep their order");
+    ASSERT_EQ(natural->fields[3].offset, 11, "u8 fields keep their order");
+    ASSERT_EQ(natural->size, 16, "Size rounds up to the alignment");
+    ASSERT_EQ(natural->align, 8, "Alignment is the widest field's");
+
+    ASTStructDef* packed = &program->structs[1];
+    ASSERT_EQ(packed->fields[1].offset, 1, "Packed fields keep declaration order");
+    ASSERT_EQ(packed->fields[2].offset, 9, "Packed fields have no padding");
+    ASSERT_EQ(packed->size, 11, "Packed size is the sum of the fields");
+
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+    parser_free(parser);
+    ast_program_free(program);
+    TEST_PASS;
+}
+
+/* Test: break and continue must be inside a loop of their own function */
+static int test_loop_exit_errors(TestSuite* suite) {
+    TEST_START("break/continue placement");
+
+    const char* invalid[] = {
+        "i32 main() { break; return 0; }",
+        "i32 main() { continue; return 0; }",
+        "i32 main() { if (true) { break; } return 0; }",
+        "i32 main() { { continue; } return 0; }",
+        "void f() { break; }\ni32 main() { while (true) { f(); } return 0; }",
+        "i32 main() { while (true) { } break; return 0; }",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        SymbolTable* table;
+        SemanticErrorList* errors;
+        int result = parse_and_analyze(invalid[i], &table, &errors);
+        ASSERT_TRUE(errors != NULL, "Program should parse");
+        ASSERT_EQ(result, 0, "Program should be invalid");
+        semantic_error_list_free(errors);
+        symbol_table_free(table);
+    }
+
+    SymbolTable* table;
+    SemanticErrorList* errors;
+    int result = parse_and_analyze(
+        "i32 main() {\n"
+        "    i32 n = 0;\n"
+        "    for (i32 i = 0; i < 10; i = i + 1) {\n"
+        "        while (true) { if (n > i) { break; } n = n + 1; }\n"
+        "        if (i % 2 == 0) { continue; }\n"
+        "        { if (n > 5) { break; } }\n"
+        "    }\n"
+        "    return n;\n"
+        "}",
+        &table, &errors);
+    ASSERT_EQ(result, 1, "Program should be valid");
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+
+    result = parse_and_analyze("i32 main() { while (true) { break } return 0; }", &table, &errors);
+    ASSERT_TRUE(errors == NULL, "Missing ';' after break is a parse error");
+    TEST_PASS;
+}
+
 /* Run all tests */
 int main(void) {
     TestSuite suite = {
@@ -473,6 +755,13 @@ int main(void) {
     test_logical_op_types(&suite);
     test_assignment_expression_type_is_lhs(&suite);
     test_nested_blocks_same_var_name(&suite);
+    test_bitwise_errors(&suite);
+    test_cast_errors(&suite);
+    test_array_errors(&suite);
+    test_global_errors(&suite);
+    test_struct_errors(&suite);
+    test_struct_layout(&suite);
+    test_loop_exit_errors(&suite);
     
     printf("\n");
     printf("Passed: %d\n", suite.passed);
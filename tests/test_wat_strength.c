@@ -0,0 +1,316 @@
+#include "test_harness.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "wat_instr.h"
+#include "wat_strength.h"
+#include "output_sink.h"
+#include "utils.h"
+
+/* Property test: for many divisors and random dividends, the strength-
+ * reduced instruction sequence must produce exactly what the original
+ * mul/div/rem produces. Both are run on a small evaluator for the
+ * straight-line subset of WatInstr used here. */
+
+#define MAX_STACK 16
+#define MAX_LOCALS 8
+
+typedef struct {
+    const char* names[MAX_LOCALS];
+    uint64_t values[MAX_LOCALS];
+    int count;
+} Locals;
+
+static uint64_t g_rng_state = 0x9E3779B97F4A7C15ull;
+
+/* Helper: xorshift64*, deterministic across runs */
+static uint64_t next_random(void) {
+    g_rng_state ^= g_rng_state >> 12;
+    g_rng_state ^= g_rng_state << 25;
+    g_rng_state ^= g_rng_state >> 27;
+    return g_rng_state * 0x2545F4914F6CDD1Dull;
+}
+
+static uint64_t* local_slot(Locals* locals, const char* name) {
+    for (int i = 0; i < locals->count; i++) {
+        if (strcmp(locals->names[i], name) == 0) return &locals->values[i];
+    }
+    locals->names[locals->count] = name;
+    locals->values[locals->count] = 0;
+    return &locals->values[locals->count++];
+}
+
+/* Helper: Normalize a value to its type (i32 values are kept zero-extended) */
+static uint64_t norm(WatValType type, uint64_t value) {
+    return type == WAT_TYPE_I32 ? (uint32_t)value : value;
+}
+
+static int64_t as_signed(WatValType type, uint64_t value) {
+    return type == WAT_TYPE_I32 ? (int64_t)(int32_t)(uint32_t)value : (int64_t)value;
+}
+
+/* Run a function with one parameter `x`. Returns 0 on a trap. */
+static int evaluate(const WatFunction* func, uint64_t x, uint64_t* result) {
+    uint64_t stack[MAX_STACK];
+    int sp = 0;
+    Locals locals;
+    locals.count = 0;
+    *local_slot(&locals, "x") = x;
+
+    for (int i = 0; i < func->instr_count; i++) {
+        const WatInstr* in = &func->instrs[i];
+        WatValType t = in->type;
+        int bits = (t == WAT_TYPE_I64) ? 64 : 32;
+        uint64_t a, b;
+
+        switch (in->op) {
+            case WAT_OP_CONST:
+                stack[sp++] = norm(t, (uint64_t)in->value);
+                continue;
+            case WAT_OP_LOCAL_GET:
+                stack[sp++] = *local_slot(&locals, in->name);
+                continue;
+            case WAT_OP_LOCAL_SET:
+                *local_slot(&locals, in->name) = stack[--sp];
+                continue;
+            case WAT_OP_LOCAL_TEE:
+                *local_slot(&locals, in->name) = stack[sp - 1];
+                continue;
+            case WAT_OP_I32_WRAP_I64:
+                stack[sp - 1] = (uint32_t)stack[sp - 1];
+                continue;
+            case WAT_OP_I64_EXTEND_I32_S:
+                stack[sp - 1] = (uint64_t)(int64_t)(int32_t)(uint32_t)stack[sp - 1];
+                continue;
+            case WAT_OP_I64_EXTEND_I32_U:
+                continue;
+            default:
+                break;
+        }
+
+        b = stack[--sp];
+        a = stack[--sp];
+        switch (in->op) {
+            case WAT_OP_ADD:   a = a + b; break;
+            case WAT_OP_SUB:   a = a - b; break;
+            case WAT_OP_MUL:   a = a * b; break;
+            case WAT_OP_AND:   a = a & b; break;
+            case WAT_OP_SHL:   a = a << (b % bits); break;
+            case WAT_OP_SHR_U: a = a >> (b % bits); break;
+            case WAT_OP_SHR_S: {
+                int64_t sa = as_signed(t, a);
+                int shift = (int)(b % bits);
+                a = (uint64_t)(sa < 0 ? ~(~sa >> shift) : sa >> shift);
+                break;
+            }
+            case WAT_OP_GE_U:  stack[sp++] = a >= b; continue;
+            case WAT_OP_DIV_U:
+            case WAT_OP_REM_U:
+                if (b == 0) return 0;
+                a = (in->op == WAT_OP_DIV_U) ? a / b : a % b;
+                break;
+            case WAT_OP_DIV_S:
+            case WAT_OP_REM_S: {
+                int64_t sa = as_signed(t, a);
+                int64_t sb = as_signed(t, b);
+                int64_t min = (t == WAT_TYPE_I64) ? INT64_MIN : INT32_MIN;
+                if (sb == 0) return 0;
+                if (sb == -1) {
+                    if (in->op == WAT_OP_DIV_S && sa == min) return 0;
+                    a = (in->op == WAT_OP_DIV_S) ? (uint64_t)0 - (uint64_t)sa : 0;
+                    break;
+                }
+                a = (uint64_t)((in->op == WAT_OP_DIV_S) ? sa / sb : sa % sb);
+                break;
+            }
+            default:
+                fprintf(stderr, "  evaluator: unsupported %s\n", wat_instr_mnemonic(in));
+                return 0;
+        }
+        stack[sp++] = norm(t, a);
+    }
+
+    *result = stack[sp - 1];
+    return 1;
+}
+
+/* Helper: `x <op> c` as the backend would emit it */
+static WatFunction* build_operation(WatOpcode op, WatValType type, long long c) {
+    WatFunction* func = wat_function_create("f");
+    wat_function_add_param(func, "x", type);
+    wat_function_set_result(func, type);
+    wat_emit_named(func, WAT_OP_LOCAL_GET, "x");
+    wat_emit_const(func, type, c);
+    wat_emit(func, op, type);
+    return func;
+}
+
+static int contains_op(const WatFunction* func, WatOpcode op) {
+    for (int i = 0; i < func->instr_count; i++) {
+        if (func->instrs[i].op == op) return 1;
+    }
+    return 0;
+}
+
+/* Helper: Dividends that tend to break rounding: extremes, multiples of
+ * the divisor and their neighbours, then random values */
+static uint64_t pick_dividend(WatValType type, long long c, int index) {
+    uint64_t top = (type == WAT_TYPE_I64) ? (1ull << 63) : (1ull << 31);
+    switch (index) {
+        case 0: return 0;
+        case 1: return 1;
+        case 2: return norm(type, (uint64_t)-1);
+        case 3: return top;
+        case 4: return top - 1;
+        case 5: return top + 1;
+        default: break;
+    }
+    if (index < 12) {
+        int64_t multiple = (int64_t)(next_random() % 1000) - 500;
+        return norm(type, (uint64_t)multiple * (uint64_t)c + (uint64_t)(index % 3) - 1);
+    }
+    return norm(type, next_random());
+}
+
+/* Check one operation and divisor; returns the number of mismatches */
+static int check_operation(WatOpcode op, WatValType type, long long c, int* reduced) {
+    WatFunction* naive = build_operation(op, type, c);
+    WatFunction* fast = build_operation(op, type, c);
+    *reduced = wat_strength_reduce(fast);
+
+    int mismatches = 0;
+    for (int i = 0; i < 40; i++) {
+        uint64_t x = pick_dividend(type, c, i);
+        uint64_t expected = 0, actual = 0;
+        int ok_expected = evaluate(naive, x, &expected);
+        int ok_actual = evaluate(fast, x, &actual);
+        if (ok_expected != ok_actual || expected != actual) {
+            if (mismatches == 0) {
+                fprintf(stderr, "  mismatch: op %d, %s, c = %lld, x = %llu: %llu vs %llu\n",
+                        (int)op, type == WAT_TYPE_I64 ? "i64" : "i32", c,
+                        (unsigned long long)x, (unsigned long long)expected,
+                        (unsigned long long)actual);
+            }
+            mismatches++;
+        }
+    }
+
+    wat_function_free(naive);
+    wat_function_free(fast);
+    return mismatches;
+}
+
+/* Helper: Run every operation over a set of interesting divisors */
+static void check_all_divisors(WatValType type, int* mismatches, int* reductions) {
+    static const WatOpcode ops[] = {
+        WAT_OP_MUL, WAT_OP_DIV_S, WAT_OP_DIV_U, WAT_OP_REM_S, WAT_OP_REM_U
+    };
+    int bits = (type == WAT_TYPE_I64) ? 64 : 32;
+    long long divisors[900];
+    int count = 0;
+
+    for (long long c = -260; c <= 260; c++) {
+        divisors[count++] = c;
+    }
+    for (int k = 9; k < bits; k++) {
+        uint64_t power = 1ull << k;
+        divisors[count++] = (long long)power;
+        divisors[count++] = (long long)(0 - power);
+        divisors[count++] = (long long)(power + 1);
+        divisors[count++] = (long long)(power - 1);
+    }
+    while (count < (int)(sizeof(divisors) / sizeof(divisors[0]))) {
+        divisors[count++] = (long long)norm(type, next_random());
+    }
+
+    for (int d = 0; d < count; d++) {
+        for (int o = 0; o < (int)(sizeof(ops) / sizeof(ops[0])); o++) {
+            int reduced = 0;
+            *mismatches += check_operation(ops[o], type, divisors[d], &reduced);
+            *reductions += reduced;
+        }
+    }
+}
+
+static void test_i32_matches_naive_code(void) {
+    int mismatches = 0, reductions = 0;
+    check_all_divisors(WAT_TYPE_I32, &mismatches, &reductions);
+    ASSERT_EQ(mismatches, 0);
+    ASSERT_TRUE(reductions > 2500);
+}
+
+static void test_i64_matches_naive_code(void) {
+    int mismatches = 0, reductions = 0;
+    check_all_divisors(WAT_TYPE_I64, &mismatches, &reductions);
+    ASSERT_EQ(mismatches, 0);
+    ASSERT_TRUE(reductions > 0);
+}
+
+static void test_rewrites_and_leaves_alone(void) {
+    int reduced = 0;
+
+    /* Power of two: a single shift */
+    WatFunction* func = build_operation(WAT_OP_DIV_U, WAT_TYPE_I32, 16);
+    ASSERT_EQ(wat_strength_reduce(func), 1);
+    ASSERT_TRUE(contains_op(func, WAT_OP_SHR_U));
+    ASSERT_FALSE(contains_op(func, WAT_OP_DIV_U));
+    ASSERT_EQ(func->local_count, 0);
+    wat_function_free(func);
+
+    /* Arbitrary 32-bit divisor: multiply by the reciprocal */
+    func = build_operation(WAT_OP_DIV_S, WAT_TYPE_I32, 7);
+    ASSERT_EQ(wat_strength_reduce(func), 1);
+    ASSERT_FALSE(contains_op(func, WAT_OP_DIV_S));
+    ASSERT_TRUE(contains_op(func, WAT_OP_I64_EXTEND_I32_S));
+    wat_function_free(func);
+
+    /* Traps (divide by zero, INT_MIN / -1) and 64-bit odd divisors stay */
+    func = build_operation(WAT_OP_DIV_S, WAT_TYPE_I32, 0);
+    ASSERT_EQ(wat_strength_reduce(func), 0);
+    wat_function_free(func);
+    func = build_operation(WAT_OP_DIV_S, WAT_TYPE_I32, -1);
+    ASSERT_EQ(wat_strength_reduce(func), 0);
+    wat_function_free(func);
+    func = build_operation(WAT_OP_REM_U, WAT_TYPE_I64, 10);
+    ASSERT_EQ(wat_strength_reduce(func), 0);
+    wat_function_free(func);
+
+    /* Operations whose constant is not the right operand are untouched */
+    func = wat_function_create("g");
+    wat_function_add_param(func, "x", WAT_TYPE_I32);
+    wat_emit_const(func, WAT_TYPE_I32, 8);
+    wat_emit_named(func, WAT_OP_LOCAL_GET, "x");
+    wat_emit(func, WAT_OP_DIV_S, WAT_TYPE_I32);
+    ASSERT_EQ(wat_strength_reduce(func), 0);
+    ASSERT_EQ(func->instr_count, 3);
+    wat_function_free(func);
+
+    ASSERT_EQ(check_operation(WAT_OP_REM_S, WAT_TYPE_I32, -8, &reduced), 0);
+    ASSERT_EQ(reduced, 1);
+}
+
+static void test_serialized_shifts(void) {
+    WatFunction* func = build_operation(WAT_OP_MUL, WAT_TYPE_I64, 8);
+    wat_strength_reduce(func);
+
+    OutputSink out;
+    output_sink_init(&out);
+    wat_function_serialize(func, &out, 0);
+    char* text = output_sink_detach(&out, NULL);
+    ASSERT_TRUE(strstr(text, "i64.const 3\n") != NULL);
+    ASSERT_TRUE(strstr(text, "i64.shl\n") != NULL);
+    xfree(text);
+    output_sink_free(&out);
+    wat_function_free(func);
+}
+
+int main(void) {
+    RUN_TEST(test_i32_matches_naive_code);
+    RUN_TEST(test_i64_matches_naive_code);
+    RUN_TEST(test_rewrites_and_leaves_alone);
+    RUN_TEST(test_serialized_shifts);
+
+    PRINT_SUMMARY();
+}
@@ -0,0 +1,266 @@
+#include "test_harness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser.h"
+#include "semantics.h"
+#include "ir.h"
+#include "x86_regalloc.h"
+#include "codegen_x86.h"
+#include "output_sink.h"
+#include "utils.h"
+
+/* The lowered IR points into the AST (dbg statements), so the program is
+ * kept alive until free_lowered() */
+static ASTProgram* g_program = NULL;
+
+/* Parse and analyze. Returns NULL on any front-end error. */
+static ASTProgram* analyze_source(const char* src) {
+    Parser* p = parser_create(src);
+    ASTProgram* prog = parser_parse(p);
+    if (p->errors->error_count != 0) {
+        parser_free(p);
+        ast_program_free(prog);
+        return NULL;
+    }
+
+    SymbolTable* table = symbol_table_create();
+    SemanticErrorList* errors = semantic_error_list_create();
+    int ok = analyze_program(prog, table, errors);
+    semantic_error_list_free(errors);
+    symbol_table_free(table);
+    parser_free(p);
+    if (!ok) {
+        ast_program_free(prog);
+        return NULL;
+    }
+    return prog;
+}
+
+/* Parse, analyze and lower to IR */
+static IrModule* lower_source(const char* src) {
+    g_program = analyze_source(src);
+    return g_program ? ir_lower_program(g_program) : NULL;
+}
+
+static void free_lowered(IrModule* module) {
+    ir_module_free(module);
+    ast_program_free(g_program);
+    g_program = NULL;
+}
+
+/* Generate assembly for a program. Caller must xfree(). */
+static char* generate_asm(const char* src) {
+    ASTProgram* prog = analyze_source(src);
+    if (!prog) return NULL;
+    OutputSink out;
+    output_sink_init(&out);
+    CodegenX86Result result = codegen_x86_program_to_sink(prog, &out, "test.csm", NULL);
+    char* text = result.success ? output_sink_detach(&out, NULL) : NULL;
+    output_sink_free(&out);
+    xfree(result.error_msg);
+    ast_program_free(prog);
+    return text;
+}
+
+static int contains(const char* haystack, const char* needle) {
+    return haystack != NULL && strstr(haystack, needle) != NULL;
+}
+
+static int count_occurrences(const char* haystack, const char* needle) {
+    int count = 0;
+    for (const char* at = strstr(haystack, needle); at; at = strstr(at + 1, needle)) {
+        count++;
+    }
+    return count;
+}
+
+static const IrFunction* find_function(const IrModule* module, const char* name) {
+    for (int i = 0; i < module->function_count; i++) {
+        if (strcmp(module->functions[i]->name, name) == 0) return module->functions[i];
+    }
+    return NULL;
+}
+
+/* First value with the given opcode, or -1 */
+static int find_value(const IrFunction* func, IrOpcode op) {
+    for (int v = 0; v < func->value_count; v++) {
+        if (func->values[v].op == op) return v;
+    }
+    return -1;
+}
+
+static void test_values_live_across_calls_avoid_caller_saved(void) {
+    const char* src =
+        "i32 g(i32 x) {\n"
+        "    return x + 1;\n"
+        "}\n"
+        "i32 f(i32 a) {\n"
+        "    i32 b = a * 3;\n"
+        "    i32 c = g(a);\n"
+        "    return b + c;\n"
+        "}\n";
+
+    IrModule* module = lower_source(src);
+    ASSERT_TRUE(module != NULL);
+    const IrFunction* f = find_function(module, "f");
+    ASSERT_TRUE(f != NULL);
+    X86Allocation* alloc = x86_allocate_registers(f);
+
+    int product = find_value(f, IR_MUL);
+    ASSERT_TRUE(product >= 0);
+    const X86Location* loc = &alloc->locations[product];
+    ASSERT_TRUE(loc->kind == X86_LOC_STACK ||
+                (loc->kind == X86_LOC_REG && !x86_reg_is_caller_saved(loc->reg)));
+
+    /* The call result is only live afterwards, so any register will do */
+    int call = find_value(f, IR_CALL);
+    ASSERT_EQ(alloc->locations[call].kind, X86_LOC_REG);
+
+    x86_allocation_free(alloc);
+    free_lowered(module);
+}
+
+static void test_register_pressure_spills(void) {
+    /* Fourteen parameters are all live until the final sum */
+    const char* src =
+        "i32 sum(i32 a0, i32 a1, i32 a2, i32 a3, i32 a4, i32 a5, i32 a6,\n"
+        "        i32 a7, i32 a8, i32 a9, i32 a10, i32 a11, i32 a12, i32 a13) {\n"
+        "    return a13 + a12 + a11 + a10 + a9 + a8 + a7 + a6 + a5 + a4 + a3 + a2 + a1 + a0;\n"
+        "}\n";
+
+    IrModule* module = lower_source(src);
+    ASSERT_TRUE(module != NULL);
+    const IrFunction* func = module->functions[0];
+    X86Allocation* alloc = x86_allocate_registers(func);
+
+    ASSERT_TRUE(alloc->slot_count > 0);
+    unsigned seen = 0;
+    int collisions = 0;
+    for (int v = 0; v < func->value_count; v++) {
+        const X86Location* loc = &alloc->locations[v];
+        if (func->values[v].op != IR_PARAM || loc->kind != X86_LOC_REG) continue;
+        if (seen & (1u << loc->reg)) collisions++;
+        seen |= 1u << loc->reg;
+        ASSERT_TRUE(loc->reg != X86_RAX && loc->reg != X86_RCX && loc->reg != X86_RDX);
+    }
+    ASSERT_EQ(collisions, 0);
+
+    x86_allocation_free(alloc);
+    free_lowered(module);
+}
+
+static void test_constants_become_immediates(void) {
+    IrFunction* func = ir_function_create("f", TYPE_I64);
+    int entry = ir_add_block(func);
+    int small = ir_emit_const(func, entry, TYPE_I64, 42);
+    int large = ir_emit_const(func, entry, TYPE_I64, 1LL << 40);
+    int sum = ir_emit(func, entry, IR_ADD, TYPE_I64);
+    ir_add_arg(func, sum, small);
+    ir_add_arg(func, sum, large);
+    ir_set_return(func, entry, sum);
+
+    X86Allocation* alloc = x86_allocate_registers(func);
+    ASSERT_EQ(alloc->locations[small].kind, X86_LOC_IMM);
+    ASSERT_EQ((int)alloc->locations[small].imm, 42);
+    ASSERT_EQ(alloc->locations[large].kind, X86_LOC_REG);
+    ASSERT_EQ(alloc->slot_count, 0);
+
+    x86_allocation_free(alloc);
+    ir_function_free(func);
+}
+
+static void test_program_is_self_contained(void) {
+    const char* src =
+        "i32 main() {\n"
+        "    i32 x = 5;\n"
+        "    dbg(x, x > 3);\n"
+        "    return 0;\n"
+        "}\n";
+
+    char* text = generate_asm(src);
+    ASSERT_TRUE(text != NULL);
+    ASSERT_TRUE(contains(text, "_start:"));
+    ASSERT_TRUE(contains(text, "call main"));
+    ASSERT_TRUE(contains(text, "call __casm_dbg_flush"));
+    ASSERT_TRUE(contains(text, "syscall"));
+    /* Labels match the C backend */
+    ASSERT_TRUE(contains(text, ".ascii \"test.csm:3:4: x = \""));
+    ASSERT_TRUE(contains(text, ".ascii \", expr(>) = \""));
+    ASSERT_TRUE(contains(text, "call __casm_dbg_i64"));
+    ASSERT_TRUE(contains(text, "call __casm_dbg_bool"));
+    /* No libc */
+    ASSERT_FALSE(contains(text, "printf"));
+    xfree(text);
+}
+
+static void test_calls_follow_sysv(void) {
+    const char* src =
+        "i64 many(i64 a, i64 b, i64 c, i64 d, i64 e, i64 f, i64 g, i64 h) {\n"
+        "    return a + h;\n"
+        "}\n"
+        "i64 main() {\n"
+        "    return many(1, 2, 3, 4, 5, 6, 7, 8);\n"
+        "}\n";
+
+    char* text = generate_asm(src);
+    ASSERT_TRUE(text != NULL);
+    /* Two stack arguments, pushed last-first, then six registers */
+    ASSERT_TRUE(contains(text, "pushq $8\n    pushq $7\n"));
+    ASSERT_TRUE(contains(text, "xorl %edi, %edi") || contains(text, "movq $1, %rdi"));
+    ASSERT_TRUE(contains(text, "movq $6, %r9"));
+    ASSERT_TRUE(contains(text, "addq $16, %rsp"));
+    /* The callee finds the eighth argument above its return address */
+    ASSERT_TRUE(contains(text, "movq 24(%rbp), %rax"));
+    xfree(text);
+}
+
+static void test_compare_fuses_into_branch(void) {
+    const char* src =
+        "i32 count(i32 n) {\n"
+        "    i32 i = 0;\n"
+        "    while (i < n) {\n"
+        "        i = i + 1;\n"
+        "    }\n"
+        "    return i;\n"
+        "}\n";
+
+    char* text = generate_asm(src);
+    ASSERT_TRUE(text != NULL);
+    ASSERT_TRUE(contains(text, "jge .L0_"));
+    ASSERT_FALSE(contains(text, "setl"));
+    xfree(text);
+}
+
+static void test_division_traps_instead_of_faulting(void) {
+    const char* src =
+        "i32 divide(i32 a, i32 b) {\n"
+        "    return a / b;\n"
+        "}\n"
+        "i32 halve(i32 a) {\n"
+        "    return a / 2;\n"
+        "}\n";
+
+    char* text = generate_asm(src);
+    ASSERT_TRUE(text != NULL);
+    ASSERT_TRUE(contains(text, "je __casm_div_zero_fail"));
+    ASSERT_TRUE(contains(text, "cmpq $-2147483648, %rax\n    je __casm_overflow_fail"));
+    ASSERT_TRUE(contains(text, "__casm_div_zero_msg:\n    .ascii \"Error: integer division by zero\\n\""));
+    /* A constant divisor other than 0 and -1 needs neither check */
+    ASSERT_EQ(count_occurrences(text, "je __casm_div_zero_fail"), 1);
+    xfree(text);
+}
+
+int main(void) {
+    RUN_TEST(test_values_live_across_calls_avoid_caller_saved);
+    RUN_TEST(test_register_pressure_spills);
+    RUN_TEST(test_constants_become_immediates);
+    RUN_TEST(test_program_is_self_contained);
+    RUN_TEST(test_calls_follow_sysv);
+    RUN_TEST(test_compare_fuses_into_branch);
+    RUN_TEST(test_division_traps_instead_of_faulting);
+
+    PRINT_SUMMARY();
+}
@@ -3,11 +3,14 @@
 WAT executor with debug output support using Python wasmtime bindings.
 
 This executor loads a WAT module and implements host functions for debug output.
-The debug_begin/debug_value_*/debug_end pattern is used to capture debug information.
+Two debug ABIs are supported:
+  - calls: debug_begin/debug_value_*/debug_end per dbg() statement
+  - buffered: debug_flush(ptr, len) hands over a block of dbg records
 """
 
 import sys
 import os
+import struct
 
 try:
     from wasmtime import Engine, Module, Store, Linker, FuncType, ValType
@@ -48,12 +51,12 @@ class DebugState:
         self.values.append((value, 'i64'))
     
     def add_value_u32(self, value):
-        """Add an u32 value."""
-        self.values.append((value, 'u32'))
+        """Add an u32 value (wasm passes i32 arguments as signed)."""
+        self.values.append((value & 0xFFFFFFFF, 'u32'))
     
     def add_value_u64(self, value):
-        """Add an u64 value."""
-        self.values.append((value, 'u64'))
+        """Add an u64 value (wasm passes i64 arguments as signed)."""
+        self.values.append((value & 0xFFFFFFFFFFFFFFFF, 'u64'))
     
     def add_value_bool(self, value):
         """Add a bool value."""
@@ -116,6 +119,49 @@ class DebugState:
         return self.output
 
 
+def decode_debug_records(data, read_memory):
+    """Decode a block of buffered dbg records into output lines.
+
+    Each record is: u32 format offset, u32 format length, then one 8-byte
+    little-endian value per placeholder. Placeholders are %d (signed),
+    %u (unsigned) and %b (bool); %% is a literal percent sign.
+    """
+    output = ""
+    pos = 0
+    while pos < len(data):
+        fmt_ptr, fmt_len = struct.unpack_from('<II', data, pos)
+        pos += 8
+        pattern = bytes(read_memory(fmt_ptr, fmt_ptr + fmt_len)).decode('utf-8')
+
+        line = ""
+        i = 0
+        while i < len(pattern):
+            if pattern[i] == '%' and i + 1 < len(pattern):
+                kind = pattern[i + 1]
+                if kind == '%':
+                    line += '%'
+                else:
+                    if kind == 'd':
+                        value = struct.unpack_from('<q', data, pos)[0]
+                        line += str(value)
+                    elif kind == 'u':
+                        value = struct.unpack_from('<Q', data, pos)[0]
+                        line += str(value)
+                    elif kind == 'b':
+                        value = struct.unpack_from('<Q', data, pos)[0]
+                        line += "true" if value else "false"
+                    else:
+                        print(f"Error: unknown dbg placeholder %{kind}", file=sys.stderr)
+                        sys.exit(1)
+                    pos += 8
+                i += 2
+            else:
+                line += pattern[i]
+                i += 1
+        output += line + "\n"
+    return output
+
+
 def create_host_functions(store, memory_obj, debug_state):
     """Create host functions for debug output."""
     
@@ -163,6 +209,19 @@ def create_host_functions(store, memory_obj, debug_state):
             sys.stdout.flush()
         return None
     
+    def debug_flush(*args):
+        """void debug_flush(i32 buffer_ptr, i32 buffer_len)"""
+        buffer_ptr, buffer_len = args[0], args[1]
+        if debug_state.memory is None:
+            raise RuntimeError("Memory not available for debug_flush")
+        data = bytes(debug_state.memory.read(debug_state.store, buffer_ptr, buffer_ptr + buffer_len))
+        read_memory = lambda start, end: debug_state.memory.read(debug_state.store, start, end)
+        output = decode_debug_records(data, read_memory)
+        if output:
+            sys.stdout.write(output)
+            sys.stdout.flush()
+        return None
+    
     # Create function types
     debug_begin_type = FuncType([ValType.i32(), ValType.i32()], [])
     debug_value_i32_type = FuncType([ValType.i32()], [])
@@ -171,6 +230,7 @@ def create_host_functions(store, memory_obj, debug_state):
     debug_value_u64_type = FuncType([ValType.i64()], [])
     debug_value_bool_type = FuncType([ValType.i32()], [])
     debug_end_type = FuncType([], [])
+    debug_flush_type = FuncType([ValType.i32(), ValType.i32()], [])
     
     return {
         "debug_begin": (debug_begin_type, debug_begin),
@@ -180,9 +240,31 @@ def create_host_functions(store, memory_obj, debug_state):
         "debug_value_u64": (debug_value_u64_type, debug_value_u64),
         "debug_value_bool": (debug_value_bool_type, debug_value_bool),
         "debug_end": (debug_end_type, debug_end),
+        "debug_flush": (debug_flush_type, debug_flush),
     }
 
 
+def describe_trap(error):
+    """Name a trap in the words the other backends use for it, or None.
+
+    A failed bounds check traps inside $__casm_bounds_fail, so the
+    innermost frame of the backtrace tells it apart from other traps.
+    """
+    frames = getattr(error, 'frames', None) or []
+    if frames and getattr(frames[0], 'func_name', None) == '__casm_bounds_fail':
+        return "array index out of bounds"
+    message = str(getattr(error, 'message', error))
+    if 'divide by zero' in message:
+        return "integer division by zero"
+    if 'integer overflow' in message:
+        return "integer overflow"
+    if 'call stack exhausted' in message or 'stack overflow' in message:
+        return "call stack exhausted"
+    if 'unreachable' in message:
+        return "unreachable code reached"
+    return None
+
+
 def execute_wat(wat_file):
     """
     Execute a WAT file and capture debug output.
@@ -254,6 +336,15 @@ def execute_wat(wat_file):
         result = main_func(store)
         return 0
     except Exception as e:
+        # Records the buffered dbg ABI had not handed over yet still
+        # belong before the error
+        flush = instance.exports(store).get("__dbg_flush")
+        if flush is not None:
+            flush(store)
+        reason = describe_trap(e)
+        if reason is not None:
+            print(f"Error: {reason}", file=sys.stderr)
+            return 1
         print(f"Error calling main function: {e}", file=sys.stderr)
         import traceback
         traceback.print_exc()